@@ -0,0 +1,726 @@
+/*
+ * sim800_bench.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+/*
+ * On-target benchmark of the driver and the module.
+ *
+ * The file is added to the project of the application (e.g., next to the example) and SIM800_Bench_Run is
+ * called once the module is initialized and registered; SIM800_Bench_Print then writes the summary table,
+ * e.g. to a debug UART. The times are taken from HAL_GetTick, so they include the network: they measure what
+ * an application gets from one modem, not the driver alone (see host/bench for that).
+ */
+
+#include "stdio.h"
+#include "string.h"
+#include "sim800_bench.h"
+
+
+/*
+ * State of a request submitted by the benchmark
+ */
+typedef struct
+{
+    volatile uint8_t done;
+    SIM800_Status_t status;
+} bench_request_t;
+
+
+/*
+ * Echo of a TCP test, the bytes received and the ticks of the first and the last ones
+ */
+typedef struct
+{
+    SIM800_Handle_t *handle;
+    uint32_t received;
+    uint32_t first;
+    uint32_t last;
+} bench_echo_t;
+
+
+#if SIM800_USE_GPRS
+static bench_echo_t transparentEcho;
+static uint8_t chunk[SIM800_BENCH_CHUNK];
+#endif
+
+static const char *const rowNames[SIM800_BenchRow_Count] =
+{
+    "SMS send (CMGS)",
+    "inbox drain (CMGL)",
+    "inbox drain (CMGR)",
+    "inbox direct (CMT)",
+    "TCP upload (command)",
+    "TCP download (command)",
+    "TCP upload (CIPRXGET)",
+    "TCP download (CIPRXGET)",
+    "TCP upload (transparent)",
+    "TCP download (transparent)",
+};
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static void request_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static SIM800_Status_t wait_request(SIM800_Handle_t *handle, bench_request_t *request, uint32_t timeout);
+static void finish_row(SIM800_BenchResult_t *row, uint32_t count, uint32_t goal, uint32_t tickStart, SIM800_Status_t status);
+#if SIM800_USE_SMS
+static void list_message(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message, void *ctx);
+static SIM800_Status_t send_messages(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_BenchResult_t *row);
+static SIM800_Status_t wait_stored(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config);
+static SIM800_Status_t bench_sms(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench);
+static SIM800_Status_t bench_inbox(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench);
+#endif
+#if SIM800_USE_GPRS
+static void count_echo(bench_echo_t *echo, uint32_t length);
+static void take_echo(SIM800_Handle_t *handle, uint8_t manual, bench_echo_t *echo);
+static void fill_chunk(void);
+static SIM800_Status_t bench_socket(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, uint8_t manual,
+                                    SIM800_BenchResult_t *upload, SIM800_BenchResult_t *download);
+static SIM800_Status_t bench_transparent(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench);
+#endif
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Runs the selected tests of the benchmark.
+ *
+ * The SMS tests delete all stored messages first, the inbox test leaves the module in the stored
+ * delivery mode with the SMS notifications and the inbound queue set back as they were. The TCP tests
+ * bring the bearer up and use the socket 0 (or the transparent pipe), the bearer is left up. A failed
+ * test does not stop the others, its row keeps the status.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of an initialized, registered module.
+ * @param   *config: Settings of the run.
+ * @param   *bench: Pointer to store the results, see SIM800_Bench_Print.
+ * @retval  SIM800_OK if every test reached its goal, the status of the first failed test otherwise.
+ */
+SIM800_Status_t SIM800_Bench_Run(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench)
+{
+    SIM800_Status_t status = SIM800_OK;
+#if SIM800_USE_SMS || SIM800_USE_GPRS
+    SIM800_Status_t result;
+#endif
+
+    memset(bench, 0, sizeof(*bench));
+
+    if (config->messages > SIM800_BENCH_MESSAGES_MAX ||
+        ((config->tests & SIM800_Bench_Transparent) && (config->tests & (SIM800_Bench_TCP | SIM800_Bench_CIPRXGET))))
+    {
+        return SIM800_ERROR;
+    }
+
+#if SIM800_USE_SMS
+    if ((config->tests & SIM800_Bench_SMS) && (result = bench_sms(handle, config, bench)) != SIM800_OK && status == SIM800_OK)
+    {
+        status = result;
+    }
+
+    if ((config->tests & SIM800_Bench_Inbox) && (result = bench_inbox(handle, config, bench)) != SIM800_OK && status == SIM800_OK)
+    {
+        status = result;
+    }
+#endif
+
+#if SIM800_USE_GPRS
+    if ((config->tests & (SIM800_Bench_TCP | SIM800_Bench_CIPRXGET)) &&
+        ((result = SIM800_BearerInit(handle, config->apn)) != SIM800_OK || (result = SIM800_SocketInit(handle)) != SIM800_OK))
+    {
+        return result;
+    }
+
+    if ((config->tests & SIM800_Bench_TCP) &&
+        (result = bench_socket(handle, config, 0, &bench->rows[SIM800_BenchRow_TCPUpload],
+                               &bench->rows[SIM800_BenchRow_TCPDownload])) != SIM800_OK && status == SIM800_OK)
+    {
+        status = result;
+    }
+
+    if ((config->tests & SIM800_Bench_CIPRXGET) &&
+        (result = bench_socket(handle, config, 1, &bench->rows[SIM800_BenchRow_RxGetUpload],
+                               &bench->rows[SIM800_BenchRow_RxGetDownload])) != SIM800_OK && status == SIM800_OK)
+    {
+        status = result;
+    }
+
+    if ((config->tests & SIM800_Bench_Transparent) && (result = bench_transparent(handle, config, bench)) != SIM800_OK &&
+        status == SIM800_OK)
+    {
+        status = result;
+    }
+#endif
+
+    return status;
+}
+
+
+/**
+ * @brief   Prints the summary table of a benchmark run.
+ *
+ * One line is printed per measured row: the count of messages or bytes, the duration and the rate
+ * (SMS/min for sending, ms per message for the inbox, bytes per second for the transfers). Integer
+ * arithmetic only, so no floating point printf support is needed.
+ *
+ * @param   *bench: Pointer to the results, see SIM800_Bench_Run.
+ * @param   print: Callback printing one line.
+ * @param   *ctx: Argument of the callback.
+ */
+void SIM800_Bench_Print(const SIM800_Bench_t *bench, SIM800_BenchPrint_t print, void *ctx)
+{
+    const SIM800_BenchResult_t *row;
+    char line[80], rate[24];
+    uint32_t tenths;
+
+    snprintf(line, sizeof(line), "%-26s %8s %8s  %s", "test", "count", "ms", "rate");
+    print(line, ctx);
+
+    for (uint8_t i = 0; i < SIM800_BenchRow_Count; i++)
+    {
+        row = &bench->rows[i];
+        if (!row->run)
+        {
+            continue;
+        }
+
+        if (row->count == 0 || row->elapsed == 0)
+        {
+            snprintf(rate, sizeof(rate), "-");
+        }
+        else if (i == SIM800_BenchRow_SMSSend)
+        {
+            tenths = (uint32_t)((uint64_t)row->count * 600000u / row->elapsed);
+            snprintf(rate, sizeof(rate), "%lu.%lu SMS/min", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+        }
+        else if (i <= SIM800_BenchRow_InboxCMT)
+        {
+            tenths = (uint32_t)((uint64_t)row->elapsed * 10u / row->count);
+            snprintf(rate, sizeof(rate), "%lu.%lu ms/msg", (unsigned long)(tenths / 10), (unsigned long)(tenths % 10));
+        }
+        else
+        {
+            snprintf(rate, sizeof(rate), "%lu B/s", (unsigned long)((uint64_t)row->count * 1000u / row->elapsed));
+        }
+
+        snprintf(line, sizeof(line), "%-26s %8lu %8lu  %s%s", rowNames[i], (unsigned long)row->count,
+                 (unsigned long)row->elapsed, rate,
+                 row->status == SIM800_OK ? "" : (row->status == SIM800_TIMEOUT ? " (timeout)" : " (error)"));
+        print(line, ctx);
+    }
+}
+
+
+#if SIM800_USE_GPRS
+/**
+ * @brief   Counts the echo received through the transparent data pipe.
+ *
+ * The benchmark takes the data of the pipe: an application with a SIM800_TransparentRxCallBack of its own
+ * does not add the transparent test.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Received data.
+ * @param   length: Count of bytes.
+ */
+void SIM800_TransparentRxCallBack(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length)
+{
+    if (handle == transparentEcho.handle)
+    {
+        count_echo(&transparentEcho, length);
+    }
+}
+#endif
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Completion callback of the requests submitted by the benchmark.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the bench_request_t of the request.
+ */
+static void request_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    bench_request_t *request = ctx;
+
+    request->status = status;
+    request->done = 1;
+}
+
+
+/**
+ * @brief   Polls the driver until a submitted request is finished.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *request: State of the request.
+ * @param   timeout: Longest wait (ms).
+ * @retval  Status of the request, SIM800_TIMEOUT if it has not finished in time.
+ */
+static SIM800_Status_t wait_request(SIM800_Handle_t *handle, bench_request_t *request, uint32_t timeout)
+{
+    uint32_t tickStart = HAL_GetTick();
+
+    while (!request->done)
+    {
+        if (HAL_GetTick() - tickStart > timeout)
+        {
+            return SIM800_TIMEOUT;
+        }
+
+        SIM800_Poll(handle);
+    }
+
+    return request->status;
+}
+
+
+/**
+ * @brief   Stores the result of a row.
+ *
+ * @param   *row: Row of the summary table.
+ * @param   count: Count of messages or bytes reached.
+ * @param   goal: Count the test aimed at.
+ * @param   tickStart: Tick at which the measurement has started.
+ * @param   status: Status of the test, SIM800_OK is replaced by SIM800_TIMEOUT if the goal is not reached.
+ */
+static void finish_row(SIM800_BenchResult_t *row, uint32_t count, uint32_t goal, uint32_t tickStart, SIM800_Status_t status)
+{
+    row->run = 1;
+    row->count = count;
+    row->elapsed = HAL_GetTick() - tickStart;
+    row->status = (status == SIM800_OK && count < goal) ? SIM800_TIMEOUT : status;
+}
+
+
+#if SIM800_USE_SMS
+/**
+ * @brief   Keeps the storage index of a listed message.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *message: Listed message.
+ * @param   *ctx: Array of SIM800_BENCH_MESSAGES_MAX indexes, preceded by their count.
+ */
+static void list_message(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message, void *ctx)
+{
+    uint16_t *indexes = ctx;
+
+    if (indexes[0] < SIM800_BENCH_MESSAGES_MAX)
+    {
+        indexes[++indexes[0]] = message->index;
+    }
+}
+
+
+/**
+ * @brief   Sends N numbered messages to the module itself.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *config: Settings of the run.
+ * @param   *row: Row to store the result in, NULL - none.
+ * @retval  SIM800_OK if every message is sent, the status of the failed one otherwise.
+ */
+static SIM800_Status_t send_messages(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_BenchResult_t *row)
+{
+    char number[SMS_SENDER_MAX_LEN], text[24];
+    uint32_t tickStart = HAL_GetTick();
+    SIM800_Status_t status = SIM800_OK;
+    uint16_t sent = 0;
+
+    strncpy(number, config->phone, sizeof(number) - 1);
+    number[sizeof(number) - 1] = '\0';
+
+    while (sent < config->messages)
+    {
+        snprintf(text, sizeof(text), "bench %u/%u", sent + 1, config->messages);
+        if ((status = SIM800_SendSMSMessage(handle, number, text)) != SIM800_OK)
+        {
+            break;
+        }
+        sent++;
+    }
+
+    if (row != NULL)
+    {
+        finish_row(row, sent, config->messages, tickStart, status);
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Waits until N messages are stored by the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *config: Settings of the run.
+ * @retval  SIM800_OK once they are stored, SIM800_TIMEOUT if they have not arrived in time.
+ */
+static SIM800_Status_t wait_stored(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config)
+{
+    uint32_t tickStart = HAL_GetTick();
+    SIM800_SMSStorage_t storage;
+
+    while (SIM800_GetSMSStorage(handle, &storage) != SIM800_OK || storage.used < config->messages)
+    {
+        if (HAL_GetTick() - tickStart > config->timeout)
+        {
+            return SIM800_TIMEOUT;
+        }
+
+        HAL_Delay(SIM800_BENCH_STORE_POLL);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Measures the count of SMS messages sent per minute.
+ *
+ * The messages come back to the module and are stored, they are deleted at the end.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *config: Settings of the run.
+ * @param   *bench: Results.
+ * @retval  SIM800_OK if every message is sent, the status of the failed one otherwise.
+ */
+static SIM800_Status_t bench_sms(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench)
+{
+    SIM800_Status_t status;
+
+    if ((status = SIM800_DeleteAllSMSMessages(handle)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    status = send_messages(handle, config, &bench->rows[SIM800_BenchRow_SMSSend]);
+
+    // Drop the messages as they come back, they are not measured here
+    wait_stored(handle, config);
+    SIM800_DeleteAllSMSMessages(handle);
+
+    return status;
+}
+
+
+/**
+ * @brief   Measures the drain of the inbox in the three ways of the driver.
+ *
+ * N messages are stored with the +CMTI handling of the driver off, so the application does not read
+ * them first. They are listed by one "AT+CMGL" (which also gives their indexes), then read one by one by
+ * "AT+CMGR". Finally N more are received in the direct delivery mode, where no command reads them:
+ * the row gives the time from the first submission to the last message handed over by +CMT.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *config: Settings of the run.
+ * @param   *bench: Results.
+ * @retval  SIM800_OK if every message is drained, the status of the first failure otherwise.
+ */
+static SIM800_Status_t bench_inbox(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench)
+{
+    uint16_t indexes[SIM800_BENCH_MESSAGES_MAX + 1] = { 0 };
+    uint8_t notifications = (handle->smsNotifications != 0), queue = handle->smsQueue;
+    SIM800_SMSMessage_t message;
+    bench_request_t request;
+    SIM800_Status_t status;
+    uint32_t tickStart;
+    uint16_t received = 0;
+
+    if ((status = SIM800_ManageSMSDelivery(handle, SIM800_SMSDelivery_Stored)) != SIM800_OK ||
+        (status = SIM800_ManageSMSNotifications(handle, DISABLE)) != SIM800_OK ||
+        (status = SIM800_DeleteAllSMSMessages(handle)) != SIM800_OK ||
+        (status = send_messages(handle, config, NULL)) != SIM800_OK ||
+        (status = wait_stored(handle, config)) != SIM800_OK)
+    {
+        if (notifications)
+        {
+            SIM800_ManageSMSNotifications(handle, ENABLE);
+        }
+        return status;
+    }
+
+    // One command for the whole inbox
+    tickStart = HAL_GetTick();
+    status = SIM800_ReadAllSMS(handle, SIM800_SMS_All, &list_message, indexes);
+    finish_row(&bench->rows[SIM800_BenchRow_InboxCMGL], indexes[0], config->messages, tickStart, status);
+
+    // One command per message
+    tickStart = HAL_GetTick();
+    for (uint16_t i = 1; i <= indexes[0]; i++)
+    {
+        request.done = 0;
+        if ((status = SIM800_SubmitReadSMSMessage(handle, indexes[i], &message, &request_done, &request)) != SIM800_OK ||
+            (status = wait_request(handle, &request, SIM800_TIMEOUT_SHORT)) != SIM800_OK)
+        {
+            break;
+        }
+        received++;
+    }
+    finish_row(&bench->rows[SIM800_BenchRow_InboxCMGR], received, config->messages, tickStart, status);
+
+    // No command at all, the messages are taken from the inbound queue as they arrive
+    SIM800_DeleteAllSMSMessages(handle);
+    SIM800_ManageSMSQueue(handle, ENABLE);
+    while (SIM800_ReceiveSMS(handle) != NULL)
+    {
+        SIM800_ReleaseSMS(handle);
+    }
+
+    received = 0;
+    tickStart = HAL_GetTick();
+    if ((status = SIM800_ManageSMSDelivery(handle, SIM800_SMSDelivery_Direct)) == SIM800_OK &&
+        (status = send_messages(handle, config, NULL)) == SIM800_OK)
+    {
+        while (received < config->messages && HAL_GetTick() - tickStart <= config->timeout)
+        {
+            SIM800_Poll(handle);
+
+            while (SIM800_ReceiveSMS(handle) != NULL)
+            {
+                SIM800_ReleaseSMS(handle);
+                received++;
+            }
+        }
+    }
+    finish_row(&bench->rows[SIM800_BenchRow_InboxCMT], received, config->messages, tickStart, status);
+
+    // Back to the settings of the application
+    SIM800_ManageSMSQueue(handle, queue);
+    SIM800_ManageSMSDelivery(handle, SIM800_SMSDelivery_Stored);
+    if (!notifications)
+    {
+        SIM800_ManageSMSNotifications(handle, DISABLE);
+    }
+    SIM800_DeleteAllSMSMessages(handle);
+
+    if (bench->rows[SIM800_BenchRow_InboxCMGL].status != SIM800_OK)
+    {
+        return bench->rows[SIM800_BenchRow_InboxCMGL].status;
+    }
+
+    return (bench->rows[SIM800_BenchRow_InboxCMGR].status != SIM800_OK) ? bench->rows[SIM800_BenchRow_InboxCMGR].status :
+                                                                          bench->rows[SIM800_BenchRow_InboxCMT].status;
+}
+#endif /* SIM800_USE_SMS */
+
+
+#if SIM800_USE_GPRS
+/**
+ * @brief   Counts received echo bytes with the ticks of the first and the last ones.
+ *
+ * @param   *echo: State of the echo.
+ * @param   length: Count of received bytes.
+ */
+static void count_echo(bench_echo_t *echo, uint32_t length)
+{
+    if (length == 0)
+    {
+        return;
+    }
+
+    if (echo->received == 0)
+    {
+        echo->first = HAL_GetTick();
+    }
+    echo->received += length;
+    echo->last = HAL_GetTick();
+}
+
+
+/**
+ * @brief   Takes the echo received by the socket 0.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   manual: 1 - read the data waiting in the module, 0 - take the data of the ring of the socket.
+ * @param   *echo: State of the echo.
+ */
+static void take_echo(SIM800_Handle_t *handle, uint8_t manual, bench_echo_t *echo)
+{
+    static uint8_t echoed[SIM800_BENCH_CHUNK];
+    uint16_t length;
+
+    if (!manual)
+    {
+        count_echo(echo, SIM800_SocketRecv(handle, 0, echoed, sizeof(echoed)));
+    }
+    else if (handle->sockets[0].rxPending && SIM800_SocketRead(handle, 0, echoed, sizeof(echoed), &length) == SIM800_OK)
+    {
+        count_echo(echo, length);
+    }
+}
+
+
+/**
+ * @brief   Fills the data block of the TCP tests with a printable pattern.
+ */
+static void fill_chunk(void)
+{
+    for (uint32_t i = 0; i < sizeof(chunk); i++)
+    {
+        chunk[i] = (uint8_t)('0' + i % 64);
+    }
+}
+
+
+/**
+ * @brief   Measures a TCP transfer through the socket 0.
+ *
+ * The data is sent in blocks of SIM800_BENCH_CHUNK bytes, the echo is taken between the blocks and
+ * after the last one. In command mode the echo arrives as "+RECEIVE" data into the ring of the socket,
+ * what overflows it while a block is sent is lost (rxDropped) and shows as a short download; in manual
+ * receive mode it waits in the module until "AT+CIPRXGET=2" reads it. The download row is timed from
+ * the first to the last echoed byte.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_SocketInit.
+ * @param   *config: Settings of the run.
+ * @param   manual: 1 - manual receive mode, 0 - command mode.
+ * @param   *upload: Row of the upload.
+ * @param   *download: Row of the download.
+ * @retval  SIM800_OK if every byte is sent and echoed, the status of the failure otherwise.
+ */
+static SIM800_Status_t bench_socket(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, uint8_t manual,
+                                    SIM800_BenchResult_t *upload, SIM800_BenchResult_t *download)
+{
+    bench_echo_t echo = { handle, 0, 0, 0 };
+    SIM800_Status_t status;
+    uint32_t tickStart, sent = 0;
+    uint16_t length;
+
+    // The receive mode is set while the socket is closed
+    if (handle->sockets[0].state != SIM800_Socket_Closed)
+    {
+        SIM800_SocketClose(handle, 0);
+    }
+
+    if ((status = SIM800_ManageManualReceive(handle, manual ? ENABLE : DISABLE)) != SIM800_OK ||
+        (status = SIM800_SocketOpen(handle, 0, SIM800_Socket_TCP, config->host, config->port)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    tickStart = HAL_GetTick();
+    while (handle->sockets[0].state == SIM800_Socket_Connecting && HAL_GetTick() - tickStart <= config->timeout)
+    {
+        SIM800_Poll(handle);
+    }
+
+    if (handle->sockets[0].state != SIM800_Socket_Connected)
+    {
+        return SIM800_TIMEOUT;
+    }
+
+    fill_chunk();
+
+    tickStart = HAL_GetTick();
+    while (sent < config->transfer)
+    {
+        length = (config->transfer - sent < sizeof(chunk)) ? (uint16_t)(config->transfer - sent) : sizeof(chunk);
+        if ((status = SIM800_SocketSend(handle, 0, chunk, length)) != SIM800_OK)
+        {
+            break;
+        }
+        sent += length;
+
+        take_echo(handle, manual, &echo);
+    }
+    finish_row(upload, sent, config->transfer, tickStart, status);
+
+    // The rest of the echo
+    tickStart = HAL_GetTick();
+    while (status == SIM800_OK && echo.received < sent && HAL_GetTick() - tickStart <= config->timeout &&
+           handle->sockets[0].state == SIM800_Socket_Connected)
+    {
+        SIM800_Poll(handle);
+
+        take_echo(handle, manual, &echo);
+    }
+
+    download->run = 1;
+    download->count = echo.received;
+    download->elapsed = echo.last - echo.first;
+    download->status = (status == SIM800_OK && echo.received < config->transfer) ? SIM800_TIMEOUT : status;
+
+    SIM800_SocketClose(handle, 0);
+
+    return (upload->status != SIM800_OK) ? upload->status : download->status;
+}
+
+
+/**
+ * @brief   Measures a TCP transfer through the transparent data pipe.
+ *
+ * The blocks of SIM800_BENCH_CHUNK bytes are queued one by one, every block is sent once the previous
+ * one is finished. The echo is counted by SIM800_TransparentRxCallBack as it arrives, the download row
+ * is timed from the first to the last echoed byte. The pipe is closed at the end.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *config: Settings of the run.
+ * @param   *bench: Results.
+ * @retval  SIM800_OK if every byte is sent and echoed, the status of the failure otherwise.
+ */
+static SIM800_Status_t bench_transparent(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config, SIM800_Bench_t *bench)
+{
+    SIM800_BenchResult_t *upload = &bench->rows[SIM800_BenchRow_TransparentUpload];
+    SIM800_BenchResult_t *download = &bench->rows[SIM800_BenchRow_TransparentDownload];
+    bench_request_t request;
+    SIM800_Status_t status;
+    uint32_t tickStart, sent = 0;
+    uint16_t length;
+
+    if ((status = SIM800_BearerInit(handle, config->apn)) != SIM800_OK ||
+        (status = SIM800_TransparentInit(handle)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    memset(&transparentEcho, 0, sizeof(transparentEcho));
+    transparentEcho.handle = handle;
+
+    if ((status = SIM800_TransparentOpen(handle, SIM800_Socket_TCP, config->host, config->port)) != SIM800_OK)
+    {
+        transparentEcho.handle = NULL;
+        return status;
+    }
+
+    fill_chunk();
+
+    tickStart = HAL_GetTick();
+    while (sent < config->transfer)
+    {
+        length = (config->transfer - sent < sizeof(chunk)) ? (uint16_t)(config->transfer - sent) : sizeof(chunk);
+        request.done = 0;
+        if ((status = SIM800_TransparentSend(handle, chunk, length, &request_done, &request)) != SIM800_OK ||
+            (status = wait_request(handle, &request, config->timeout)) != SIM800_OK)
+        {
+            break;
+        }
+        sent += length;
+    }
+    finish_row(upload, sent, config->transfer, tickStart, status);
+
+    tickStart = HAL_GetTick();
+    while (status == SIM800_OK && transparentEcho.received < sent && HAL_GetTick() - tickStart <= config->timeout &&
+           handle->transparent == SIM800_Transparent_Online)
+    {
+        SIM800_Poll(handle);
+    }
+
+    download->run = 1;
+    download->count = transparentEcho.received;
+    download->elapsed = transparentEcho.last - transparentEcho.first;
+    download->status = (status == SIM800_OK && transparentEcho.received < config->transfer) ? SIM800_TIMEOUT : status;
+
+    SIM800_TransparentClose(handle);
+    transparentEcho.handle = NULL;
+
+    return (upload->status != SIM800_OK) ? upload->status : download->status;
+}
+#endif /* SIM800_USE_GPRS */
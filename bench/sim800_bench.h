@@ -0,0 +1,122 @@
+/*
+ * sim800_bench.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_BENCH_H_
+#define INC_SIM800_BENCH_H_
+
+#include "sim800.h"
+
+#ifndef SIM800_BENCH_MESSAGES_MAX
+#define SIM800_BENCH_MESSAGES_MAX				32		/* Most SMS messages of one run. */
+#endif
+
+#ifndef SIM800_BENCH_CHUNK
+#define SIM800_BENCH_CHUNK						SIM800_SOCKET_TX_MAX	/* Bytes of one data block of the TCP tests. */
+#endif
+
+#ifndef SIM800_BENCH_STORE_POLL
+#define SIM800_BENCH_STORE_POLL					2000	/* Period (ms) of the storage queries while the messages arrive. */
+#endif
+
+
+/**
+ * @brief   Enumeration of the tests of the benchmark, combined into SIM800_BenchConfig_t.tests.
+ *
+ * The socket tests and the transparent test exclude each other (see SIM800_TransparentInit),
+ * the transparent test is run alone, on a module that has not used the sockets since its start.
+ */
+typedef enum
+{
+    SIM800_Bench_SMS         = 0x01,            /*!< SMS messages sent per minute ("AT+CMGS"). */
+    SIM800_Bench_Inbox       = 0x02,            /*!< Drain of N stored messages by "AT+CMGL" and by "AT+CMGR", then N forwarded by +CMT. */
+    SIM800_Bench_TCP         = 0x04,            /*!< TCP upload/download in command mode ("+RECEIVE" data). */
+    SIM800_Bench_CIPRXGET    = 0x08,            /*!< TCP upload/download in manual receive mode ("AT+CIPRXGET"). */
+    SIM800_Bench_Transparent = 0x10,            /*!< TCP upload/download through the transparent data pipe. */
+} SIM800_BenchTest_t;
+
+
+/**
+ * @brief   Enumeration of the rows of the summary table.
+ */
+typedef enum
+{
+    SIM800_BenchRow_SMSSend,                    /*!< Messages sent. */
+    SIM800_BenchRow_InboxCMGL,                  /*!< Stored messages listed by one "AT+CMGL". */
+    SIM800_BenchRow_InboxCMGR,                  /*!< Stored messages read one by one by "AT+CMGR". */
+    SIM800_BenchRow_InboxCMT,                   /*!< Messages forwarded by +CMT, from the first submission to the last arrival. */
+    SIM800_BenchRow_TCPUpload,                  /*!< Bytes sent in command mode. */
+    SIM800_BenchRow_TCPDownload,                /*!< Bytes echoed back in command mode. */
+    SIM800_BenchRow_RxGetUpload,                /*!< Bytes sent in manual receive mode. */
+    SIM800_BenchRow_RxGetDownload,              /*!< Bytes echoed back in manual receive mode. */
+    SIM800_BenchRow_TransparentUpload,          /*!< Bytes sent through the transparent pipe. */
+    SIM800_BenchRow_TransparentDownload,        /*!< Bytes echoed back through the transparent pipe. */
+    SIM800_BenchRow_Count,
+} SIM800_BenchRow_t;
+
+
+/**
+ * @brief   Structure representing the result of one row of the benchmark.
+ */
+typedef struct
+{
+    uint8_t run;                                /*!< 1 if the row has been measured. */
+    SIM800_Status_t status;                     /*!< Status of the test, SIM800_OK if count reached its goal. */
+    uint32_t count;                             /*!< Count of messages or bytes. */
+    uint32_t elapsed;                           /*!< Duration (ms). */
+} SIM800_BenchResult_t;
+
+
+/**
+ * @brief   Callback printing one line of the summary table, without the line end.
+ *
+ * @param   *line: Text of the line.
+ * @param   *ctx: Argument given to SIM800_Bench_Print.
+ */
+typedef void (*SIM800_BenchPrint_t)(const char *line, void *ctx);
+
+
+/**
+ * @brief   Structure representing the settings of the benchmark.
+ *
+ * The SMS tests send the messages to the number of the SIM card itself, so they come back to the
+ * module. The TCP tests need a server echoing every received byte (e.g., "ncat -l -k -e /bin/cat").
+ */
+typedef struct
+{
+    uint8_t tests;                              /*!< Tests to run, see SIM800_BenchTest_t. */
+    const char *phone;                          /*!< Phone number of the SIM card of the module. */
+    uint16_t messages;                          /*!< Count of messages N, at most SIM800_BENCH_MESSAGES_MAX. */
+    const char *apn;                            /*!< Access point name of the bearer. */
+    const char *host;                           /*!< Host name or IP address of the echo server. */
+    uint16_t port;                              /*!< TCP port of the echo server. */
+    uint32_t transfer;                          /*!< Bytes sent (and echoed back) by every TCP test. */
+    uint32_t timeout;                           /*!< Longest wait (ms) for the messages to arrive or the echo to end. */
+} SIM800_BenchConfig_t;
+
+
+/**
+ * @brief   Structure representing the results of a benchmark run.
+ */
+typedef struct
+{
+    SIM800_BenchResult_t rows[SIM800_BenchRow_Count];  /*!< Results, see SIM800_BenchRow_t. */
+} SIM800_Bench_t;
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_Bench_Run					(SIM800_Handle_t *handle, const SIM800_BenchConfig_t *config,
+													 SIM800_Bench_t *bench);
+void SIM800_Bench_Print								(const SIM800_Bench_t *bench, SIM800_BenchPrint_t print, void *ctx);
+
+
+
+
+#endif /* INC_SIM800_BENCH_H_ */
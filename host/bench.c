@@ -0,0 +1,241 @@
+/*
+ * bench.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+/*
+ * Host benchmark of the receive path.
+ *
+ * Recorded traffic (a file given as the first argument, or the sample below) is fed character by character
+ * through SIM800_MessageHandler and parsed by SIM800_Process, as the UART interrupt and the main loop do on
+ * the target. Then command round trips are run against the simulated module. A dump of the trace ring
+ * (SIM800_TraceDump) is accepted as well, its received lines are replayed.
+ *
+ *     make -C host && host/bench [traffic.txt] [repeats]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim800.h"
+#include "sim_modem.h"
+
+#define BENCH_REPEATS							2000	/* Times the traffic is fed. */
+#define BENCH_ROUND_TRIPS						2000	/* Count of "AT+CSQ" round trips. */
+#define BENCH_PROCESS_EVERY						64		/* Characters received between the calls of SIM800_Process. */
+
+
+static const SIM_Script_t script[] =
+{
+    { "AT+CPIN?", "\r\n+CPIN: READY\r\n\r\nOK\r\n\r\nCall Ready\r\n\r\nSMS Ready\r\n" },
+    { "AT+CREG?", "\r\n+CREG: 2,1,\"1A2B\",\"0C3D\"\r\n\r\nOK\r\n" },
+    { "AT+CSQ", "\r\n+CSQ: 17,0\r\n\r\nOK\r\n" },
+    { "AT+CPMS?", "\r\n+CPMS: \"SM\",0,10,\"SM\",0,10,\"SM\",0,10\r\n\r\nOK\r\n" },
+};
+
+/*
+ * Sample of the traffic of a registered module: notifications the driver handles, notifications it drops
+ * and a long line parsed in chunks
+ */
+static const char sample[] =
+    "\r\n+CREG: 5,\"1A2B\",\"0C3D\"\r\n"
+    "\r\n+CREG: 1,\"1A2B\",\"0C3E\"\r\n"
+    "\r\n*PSUTTZ: 2023,11,5,10,0,0,\"+12\",0\r\n"
+    "\r\nDST: 0\r\n"
+    "\r\n+CIEV: 10,\"25001\",\"MTS\",\"MTS RUS\", 0, 0\r\n"
+    "\r\nRING\r\n"
+    "\r\n+CUSD: 0,\"Balance 123.45 RUB. Tariff: Basic. Internet package 1.5 GB left till 30.11. "
+    "Dial *100# to check the balance, *111# for the services menu.\",15\r\n";
+
+static UART_HandleTypeDef huart;
+static SIM800_Handle_t sim800h;
+
+
+/**
+ * @brief   Reads the cycle counter of the host, 0 where there is none.
+ *
+ * @retval  Count of cycles.
+ */
+static uint64_t cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief   Reads the monotonic clock of the host.
+ *
+ * @retval  Seconds.
+ */
+static double seconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+
+/**
+ * @brief   Keeps the received characters of a dump of the trace ring, see SIM800_Trace_t.
+ *
+ * @param   *traffic: Dump, replaced by the received characters.
+ * @param   *length: Count of characters, updated.
+ */
+static void replay_trace(char *traffic, size_t *length)
+{
+    size_t magic = sizeof(SIM800_TRACE_MAGIC) - 1;
+    size_t in = magic + 1, out = 0, size;
+
+    while (in + SIM800_TRACE_HEADER <= *length)
+    {
+        size = (uint8_t)traffic[in + 1] | (uint8_t)traffic[in + 2] << 8;
+        if (in + SIM800_TRACE_HEADER + size > *length)
+        {
+            break;
+        }
+
+        if (traffic[in] == SIM800_Trace_RX)
+        {
+            memmove(&traffic[out], &traffic[in + SIM800_TRACE_HEADER], size);
+            out += size;
+        }
+        in += SIM800_TRACE_HEADER + size;
+    }
+
+    *length = out;
+}
+
+
+/**
+ * @brief   Loads the recorded traffic.
+ *
+ * @param   *path: Path of the file, NULL - the sample.
+ * @param   *length: Pointer to store the count of characters.
+ * @retval  Pointer to the traffic, NULL on failure.
+ */
+static char *load_traffic(const char *path, size_t *length)
+{
+    FILE *file;
+    char *traffic;
+    long size;
+
+    if (path == NULL)
+    {
+        *length = sizeof(sample) - 1;
+        return strdup(sample);
+    }
+
+    if ((file = fopen(path, "rb")) == NULL || fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) <= 0)
+    {
+        return NULL;
+    }
+
+    rewind(file);
+    if ((traffic = malloc(size)) != NULL && fread(traffic, 1, size, file) != (size_t)size)
+    {
+        free(traffic);
+        traffic = NULL;
+    }
+    fclose(file);
+
+    *length = size;
+
+    if (traffic != NULL && *length > sizeof(SIM800_TRACE_MAGIC) &&
+        memcmp(traffic, SIM800_TRACE_MAGIC, sizeof(SIM800_TRACE_MAGIC) - 1) == 0 &&
+        traffic[sizeof(SIM800_TRACE_MAGIC) - 1] == SIM800_TRACE_VERSION)
+    {
+        replay_trace(traffic, length);
+    }
+
+    return traffic;
+}
+
+
+int main(int argc, char **argv)
+{
+    uint32_t repeats = (argc > 2) ? strtoul(argv[2], NULL, 10) : BENCH_REPEATS;
+    SIM800_Signal_t signal;
+    size_t length, lines = 0;
+    uint64_t c0, c1;
+    double t0, t1;
+    char *traffic;
+
+    if ((traffic = load_traffic(argc > 1 ? argv[1] : NULL, &length)) == NULL || length == 0)
+    {
+        fprintf(stderr, "can not read %s\n", argv[1]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        lines += (traffic[i] == '\n');
+    }
+
+    // Start the simulated module and the driver
+    huart.gState = HAL_UART_STATE_READY;
+    sim800h.uart = &huart;
+    SIM_Modem_Script(script, sizeof(script) / sizeof(script[0]));
+    SIM_Modem_Send("\r\nRDY\r\n\r\n+CFUN: 1\r\n");
+
+    if (SIM800_ManageReceiving(&sim800h, ENABLE) != SIM800_OK || SIM800_Init(&sim800h, NULL) != SIM800_OK ||
+        SIM800_ManageRegNotifications(&sim800h, 2) != SIM800_OK || SIM800_ManageNetworkTime(&sim800h, ENABLE) != SIM800_OK)
+    {
+        fprintf(stderr, "the driver did not start\n");
+        return 1;
+    }
+
+    // Receive path: the interrupt handler and the line parser
+    t0 = seconds();
+    c0 = cycles();
+    for (uint32_t r = 0; r < repeats; r++)
+    {
+        for (size_t i = 0; i < length; i++)
+        {
+            sim800h.rcvdByte = traffic[i];
+            SIM800_MessageHandler(&sim800h);
+
+            if (i % BENCH_PROCESS_EVERY == BENCH_PROCESS_EVERY - 1)
+            {
+                SIM800_Process(&sim800h);
+            }
+        }
+        SIM800_Process(&sim800h);
+    }
+    c1 = cycles();
+    t1 = seconds();
+
+    printf("receive:    %zu bytes, %zu lines x %u\n", length, lines, repeats);
+    printf("            %.0f lines/s, %.1f ns/byte", lines * (double)repeats / (t1 - t0),
+           (t1 - t0) * 1e9 / ((double)length * repeats));
+    if (c1 != c0)
+    {
+        printf(", %.1f cycles/byte", (double)(c1 - c0) / ((double)length * repeats));
+    }
+    printf(", %lu overruns\n", (unsigned long)sim800h.rxOverruns);
+
+    // Command round trips through the request queue and the simulated UART
+    t0 = seconds();
+    for (uint32_t i = 0; i < BENCH_ROUND_TRIPS; i++)
+    {
+        if (SIM800_GetSignalQuality(&sim800h, &signal) != SIM800_OK || signal.rssi != 17)
+        {
+            fprintf(stderr, "round trip %u failed\n", i);
+            return 1;
+        }
+    }
+    t1 = seconds();
+
+    printf("round trip: %u x AT+CSQ, %.1f us each\n", BENCH_ROUND_TRIPS, (t1 - t0) * 1e6 / BENCH_ROUND_TRIPS);
+
+    free(traffic);
+
+    return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * fuzz.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+/*
+ * Fuzzing target of the receive path and the response parsers.
+ *
+ * Every input starts a fresh driver on the simulated module: the notifications of the SMS messages, the
+ * network registration, the network time, the incoming calls and the sockets are enabled and a USSD query waits
+ * for its response, then one request selected by the first byte of the input is submitted and the module falls silent. The rest of the input is fed through
+ * SIM800_MessageHandler as the answer of the module, SIM800_Poll runs every (second byte + 1) characters,
+ * so the parsers see the lines cut at any point. A dump of the trace ring (SIM800_TraceDump) is taken as it is:
+ * its received lines are fed with no request in flight, so recorded traffic seeds the corpus.
+ *
+ *     make -C host fuzz && host/fuzz host/corpus       libFuzzer (clang)
+ *     make -C host fuzz-replay && host/fuzz-replay f...  the inputs once each, with the sanitizers of $(CC)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim800.h"
+#include "sim_modem.h"
+
+#define FUZZ_RESPONSE_SIZE						1024	/* Bytes of the structure a batched query is parsed into. */
+
+
+/*
+ * Requests the input may select, the queries of the command table follow them
+ */
+typedef enum
+{
+    FUZZ_None,                                  /* Notifications only. */
+    FUZZ_ReadSMS,                               /* "AT+CMGR", cmgr_parser. */
+    FUZZ_ReadAllSMS,                            /* "AT+CMGL", cmgl_parser. */
+    FUZZ_SendSMS,                               /* "AT+CMGS" with its prompt. */
+    FUZZ_SocketRead,                            /* "AT+CIPRXGET=2", the raw payload. */
+    FUZZ_Phonebook,                             /* "AT+CPBR=?", then "AT+CPBR=1,<size>" into the index. */
+    FUZZ_Count,
+} fuzz_request_t;
+
+
+/*
+ * The module answers the setup with these lines and "OK" otherwise
+ */
+static const SIM_Script_t setupScript[] =
+{
+    { "AT+CPIN?", "\r\n+CPIN: READY\r\n\r\nOK\r\n" },
+    { "AT+SAPBR=2,1", "\r\n+SAPBR: 1,1,\"10.0.0.1\"\r\n\r\nOK\r\n" },
+    { "AT+CGATT?", "\r\n+CGATT: 1\r\n\r\nOK\r\n" },
+    { "AT+CIFSR", "\r\n10.0.0.1\r\n" },
+    { "AT+CIPSHUT", "\r\nSHUT OK\r\n" },
+};
+
+/*
+ * A hung module: every command is taken, none is answered
+ */
+static const SIM_Script_t silentScript[] =
+{
+    { "", NULL },
+};
+
+static const SIM800_Config_t config = { .textMode = 1, .smsNotifications = 1, .errorMode = 1, .timeout = 100 };
+
+static UART_HandleTypeDef huart;
+static SIM800_Handle_t sim800h;
+static SIM800_SMSMessage_t message;
+static uint8_t payload[SIM800_SOCKET_TX_MAX];
+static SIM800_SocketRead_t socketRead;
+static _Alignas(8) uint8_t response[FUZZ_RESPONSE_SIZE];
+static SIM800_BatchItem_t batch[1];
+
+
+/**
+ * @brief   Takes a listed message, nothing to do with it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *listed: Listed message.
+ * @param   *ctx: Unused.
+ */
+static void list_message(SIM800_Handle_t *handle, SIM800_SMSMessage_t *listed, void *ctx)
+{
+}
+
+
+/**
+ * @brief   Starts the driver on the simulated module with every notification enabled.
+ */
+static void start_driver(void)
+{
+    memset(&sim800h, 0, sizeof(sim800h));
+    huart.gState = HAL_UART_STATE_READY;
+    sim800h.uart = &huart;
+
+    SIM_Modem_Reset();
+    SIM_Modem_Script(setupScript, sizeof(setupScript) / sizeof(setupScript[0]));
+
+    SIM800_Init(&sim800h, &config);
+    SIM800_ManageSMSDelivery(&sim800h, SIM800_SMSDelivery_Direct);
+    SIM800_ManageRegNotifications(&sim800h, 2);
+    SIM800_ManageNetworkTime(&sim800h, ENABLE);
+    SIM800_ManageCalls(&sim800h, SIM800_Calls_Reject);
+    SIM800_BearerInit(&sim800h, "internet");
+    SIM800_SocketInit(&sim800h);
+    SIM800_ManageManualReceive(&sim800h, ENABLE);
+
+    // A USSD query waits for its "+CUSD" response
+    SIM800_SendUSSD(&sim800h, "*100#", NULL, NULL);
+    while (sim800h.reqTail != sim800h.reqHead)
+    {
+        SIM800_Poll(&sim800h);
+    }
+
+    SIM_Modem_Script(silentScript, 1);
+}
+
+
+/**
+ * @brief   Submits the request selected by the input.
+ *
+ * @param   selector: First byte of the input.
+ */
+static void submit(uint8_t selector)
+{
+    selector %= FUZZ_Count + SIM800_Cmd_Count;
+
+    switch (selector)
+    {
+    case FUZZ_None:
+        break;
+
+    case FUZZ_ReadSMS:
+        SIM800_SubmitReadSMSMessage(&sim800h, 1, &message, NULL, NULL);
+        break;
+
+    case FUZZ_ReadAllSMS:
+        SIM800_SubmitReadAllSMS(&sim800h, SIM800_SMS_All, &list_message, NULL, NULL, NULL);
+        break;
+
+    case FUZZ_SendSMS:
+        SIM800_SubmitSMSMessage(&sim800h, "+12025550123", "fuzz", NULL, NULL);
+        break;
+
+    case FUZZ_SocketRead:
+        socketRead.buffer = payload;
+        socketRead.size = sizeof(payload);
+        SIM800_SubmitSocketRead(&sim800h, 0, &socketRead, NULL, NULL);
+        break;
+
+    case FUZZ_Phonebook:
+        SIM800_SubmitLoadPhonebook(&sim800h, NULL, NULL);
+        break;
+
+    default:
+        // A query of the command table, the ones that can not be batched are refused
+        memset(response, 0, sizeof(response));
+        batch[0].cmd = (SIM800_Command_t)(selector - FUZZ_Count);
+        batch[0].response = response;
+        SIM800_SubmitBatch(&sim800h, batch, 1, NULL, NULL);
+        break;
+    }
+
+    // Send the command
+    SIM800_Poll(&sim800h);
+    HAL_GetTick();
+}
+
+
+/**
+ * @brief   Feeds the answer of the module through the receive path.
+ *
+ * @param   *data: Received characters.
+ * @param   length: Count of characters.
+ * @param   every: Characters received between the calls of SIM800_Poll.
+ */
+static void feed(const uint8_t *data, size_t length, size_t every)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        sim800h.rcvdByte = data[i];
+        SIM800_MessageHandler(&sim800h);
+
+        if (i % every == every - 1)
+        {
+            SIM800_Poll(&sim800h);
+        }
+    }
+
+    SIM800_Poll(&sim800h);
+}
+
+
+/**
+ * @brief   Runs one input, see the top of the file.
+ *
+ * @param   *data: Input.
+ * @param   size: Count of bytes.
+ * @retval  0.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    size_t magic = sizeof(SIM800_TRACE_MAGIC) - 1, length;
+
+    start_driver();
+
+    if (size > magic && memcmp(data, SIM800_TRACE_MAGIC, magic) == 0)
+    {
+        // A dump of the trace ring, its received lines in order
+        for (size_t in = magic + 1; in + SIM800_TRACE_HEADER <= size; in += SIM800_TRACE_HEADER + length)
+        {
+            length = data[in + 1] | data[in + 2] << 8;
+            if (in + SIM800_TRACE_HEADER + length > size)
+            {
+                break;
+            }
+
+            if (data[in] == SIM800_Trace_RX)
+            {
+                feed(&data[in + SIM800_TRACE_HEADER], length, length != 0 ? length : 1);
+            }
+        }
+        return 0;
+    }
+
+    if (size < 2)
+    {
+        return 0;
+    }
+
+    submit(data[0]);
+    feed(&data[2], size - 2, (size_t)data[1] + 1);
+
+    return 0;
+}
+
+
+#ifdef FUZZ_REPLAY
+/**
+ * @brief   Runs the files given as arguments once each, built without libFuzzer.
+ */
+int main(int argc, char **argv)
+{
+    FILE *file;
+    uint8_t *data;
+    long size;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((file = fopen(argv[i], "rb")) == NULL || fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0)
+        {
+            fprintf(stderr, "can not read %s\n", argv[i]);
+            return 1;
+        }
+
+        rewind(file);
+        if ((data = malloc(size + 1)) == NULL || fread(data, 1, size, file) != (size_t)size)
+        {
+            fprintf(stderr, "can not read %s\n", argv[i]);
+            return 1;
+        }
+        fclose(file);
+
+        LLVMFuzzerTestOneInput(data, size);
+        free(data);
+    }
+
+    printf("%d inputs\n", argc - 1);
+
+    return 0;
+}
+#endif
@@ -0,0 +1,168 @@
+/*
+ * hal_host.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include <time.h>
+#include "main.h"
+#include "sim800.h"
+#include "sim_modem.h"
+
+#define HOST_UART_BURST							64		/* Characters delivered by one pump, like a FIFO of the UART. */
+
+
+/*
+ * State of the simulated UART, one UART is connected to the simulated module
+ */
+volatile uint32_t host_primask;
+
+static UART_HandleTypeDef *uart;
+static uint8_t *rxData;
+static uint8_t rxArmed;
+static const uint8_t *txData;
+static uint16_t txLength;
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Gives the milliseconds elapsed on the host clock.
+ *
+ * The blocking functions of the library spin on the tick, so the simulated UART is pumped from here.
+ *
+ * @retval  Milliseconds of a monotonic clock.
+ */
+uint32_t HAL_GetTick(void)
+{
+    struct timespec now;
+
+    Host_UART_Pump();
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint32_t)(now.tv_sec * 1000u + now.tv_nsec / 1000000);
+}
+
+
+/**
+ * @brief   Waits for a count of milliseconds.
+ *
+ * @param   delay: Milliseconds to wait.
+ */
+void HAL_Delay(uint32_t delay)
+{
+    uint32_t start = HAL_GetTick();
+
+    while (HAL_GetTick() - start < delay)
+    {
+    }
+}
+
+
+/**
+ * @brief   Moves the characters between the driver and the simulated module.
+ *
+ * A pending transmission is handed to the module and completed, then up to HOST_UART_BURST characters of the
+ * module are received one by one. Nothing moves while the interrupts are masked.
+ */
+void Host_UART_Pump(void)
+{
+    static uint8_t busy;
+    const uint8_t *data;
+    uint8_t c;
+
+    if (busy || host_primask || uart == NULL)
+    {
+        return;
+    }
+    busy = 1;
+
+    if (txData != NULL)
+    {
+        data = txData;
+        txData = NULL;
+        SIM_Modem_Input(data, txLength);
+        uart->gState = HAL_UART_STATE_READY;
+        SIM800_UART_TxCpltCallback(uart);
+    }
+
+    for (uint8_t i = 0; i < HOST_UART_BURST && rxArmed && SIM_Modem_Output(&c); i++)
+    {
+        rxArmed = 0;
+        *rxData = c;
+        SIM800_UART_RxCpltCallback(uart);
+    }
+
+    busy = 0;
+}
+
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    huart->gState = HAL_UART_STATE_READY;
+
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+    uart = huart;
+    rxData = data;
+    rxArmed = 1;
+
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size)
+{
+    if (txData != NULL)
+    {
+        return HAL_BUSY;
+    }
+
+    uart = huart;
+    huart->gState = HAL_UART_STATE_BUSY_TX;
+    txData = data;
+    txLength = size;
+
+    return HAL_OK;
+}
+
+
+/*
+ * The DMA of the target is not simulated, the driver is used in its interrupt modes
+ */
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size)
+{
+    return HAL_ERROR;
+}
+
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size)
+{
+    return HAL_ERROR;
+}
+
+
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart)
+{
+    rxArmed = 0;
+
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_UART_DMAPause(UART_HandleTypeDef *huart)
+{
+    return HAL_OK;
+}
+
+
+HAL_StatusTypeDef HAL_UART_DMAResume(UART_HandleTypeDef *huart)
+{
+    return HAL_OK;
+}
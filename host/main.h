@@ -0,0 +1,101 @@
+/*
+ * main.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_MAIN_H_
+#define INC_MAIN_H_
+
+/*
+ * Host stand-in for the main.h of the STM32CubeIDE project: the types, macros and functions of the HAL
+ * the library uses, implemented by hal_host.c on top of the simulated module of sim_modem.c.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define __weak									__attribute__((weak))
+#define __DMB()									__sync_synchronize()
+#define __WFI()									do { } while (0)
+
+#define ENABLE									1
+#define DISABLE									0
+
+#define HAL_UART_STATE_READY					0x20U
+#define HAL_UART_STATE_BUSY_TX					0x21U
+
+#define HAL_UART_ERROR_NONE						0x00U
+#define HAL_UART_ERROR_PE						0x01U
+#define HAL_UART_ERROR_NE						0x02U
+#define HAL_UART_ERROR_FE						0x04U
+#define HAL_UART_ERROR_ORE						0x08U
+
+#define UART_HWCONTROL_NONE						0x000U
+#define UART_HWCONTROL_RTS_CTS					0x300U
+
+#define FLASH_BASE								0x08000000UL
+
+
+typedef enum
+{
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U,
+} HAL_StatusTypeDef;
+
+
+typedef struct
+{
+    uint32_t BaudRate;
+    uint32_t HwFlowCtl;
+} UART_InitTypeDef;
+
+
+typedef struct __UART_HandleTypeDef
+{
+    void *Instance;
+    UART_InitTypeDef Init;
+    volatile uint32_t gState;
+    volatile uint32_t RxState;
+    volatile uint32_t ErrorCode;
+} UART_HandleTypeDef;
+
+
+/*
+ * Interrupt mask, the simulated module delivers nothing while it is set
+ */
+extern volatile uint32_t host_primask;
+
+static inline uint32_t __get_PRIMASK(void)
+{
+    return host_primask;
+}
+
+static inline void __set_PRIMASK(uint32_t primask)
+{
+    host_primask = primask;
+}
+
+static inline void __disable_irq(void)
+{
+    host_primask = 1;
+}
+
+
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t delay);
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_DMA(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_AbortReceive(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_DMAPause(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_DMAResume(UART_HandleTypeDef *huart);
+
+void Host_UART_Pump(void);
+
+#endif /* INC_MAIN_H_ */
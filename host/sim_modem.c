@@ -0,0 +1,164 @@
+/*
+ * sim_modem.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include <string.h>
+#include "sim_modem.h"
+
+
+/*
+ * State of the simulated module
+ */
+static const SIM_Script_t *script;
+static uint16_t scriptCount;
+static char command[SIM_MODEM_COMMAND_LENGTH];
+static uint16_t commandLength;
+static uint8_t output[SIM_MODEM_OUTPUT_LENGTH];
+static uint32_t outputHead, outputTail;
+static uint32_t commands;
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static void answer(void);
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Sets the script the simulated module answers the commands with.
+ *
+ * The first line whose command starts the received command line is taken, a command without a line is
+ * answered with "OK".
+ *
+ * @param   *lines: Lines of the script, kept by reference.
+ * @param   count: Count of lines.
+ */
+void SIM_Modem_Script(const SIM_Script_t *lines, uint16_t count)
+{
+    script = lines;
+    scriptCount = count;
+}
+
+
+/**
+ * @brief   Drops the queued output and the partial command line of the simulated module.
+ */
+void SIM_Modem_Reset(void)
+{
+    outputHead = outputTail = 0;
+    commandLength = 0;
+}
+
+
+/**
+ * @brief   Queues characters sent by the module on its own, e.g. an unsolicited result code.
+ *
+ * Characters that do not fit the output queue are dropped.
+ *
+ * @param   *text: Characters to send.
+ */
+void SIM_Modem_Send(const char *text)
+{
+    while (*text != '\0' && outputHead - outputTail < SIM_MODEM_OUTPUT_LENGTH)
+    {
+        output[outputHead++ % SIM_MODEM_OUTPUT_LENGTH] = (uint8_t)*text++;
+    }
+}
+
+
+/**
+ * @brief   Takes the characters transmitted by the driver.
+ *
+ * Every command line ended by '\r' (or the data of a prompt ended by Ctrl-Z) is answered from the script.
+ * The echo is off, the commands are not sent back.
+ *
+ * @param   *data: Transmitted characters.
+ * @param   length: Count of characters.
+ */
+void SIM_Modem_Input(const uint8_t *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        if (data[i] == '\n' && commandLength == 0)
+        {
+            continue;
+        }
+
+        if (data[i] == '\r' || data[i] == 0x1A)
+        {
+            command[commandLength] = '\0';
+            answer();
+            commandLength = 0;
+            continue;
+        }
+
+        if (commandLength < SIM_MODEM_COMMAND_LENGTH - 1)
+        {
+            command[commandLength++] = (char)data[i];
+        }
+    }
+}
+
+
+/**
+ * @brief   Takes the next character the module sends to the UART.
+ *
+ * @param   *c: Pointer to store the character.
+ * @retval  1 if a character is taken, 0 if the module has nothing to send.
+ */
+uint8_t SIM_Modem_Output(uint8_t *c)
+{
+    if (outputTail == outputHead)
+    {
+        return 0;
+    }
+
+    *c = output[outputTail++ % SIM_MODEM_OUTPUT_LENGTH];
+
+    return 1;
+}
+
+
+/**
+ * @brief   Gives the count of command lines received by the module.
+ *
+ * @retval  Count of command lines.
+ */
+uint32_t SIM_Modem_Commands(void)
+{
+    return commands;
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Answers the received command line from the script.
+ */
+static void answer(void)
+{
+    commands++;
+
+    for (uint16_t i = 0; i < scriptCount; i++)
+    {
+        if (strncmp(command, script[i].command, strlen(script[i].command)) == 0)
+        {
+            if (script[i].response != NULL)
+            {
+                SIM_Modem_Send(script[i].response);
+            }
+            return;
+        }
+    }
+
+    SIM_Modem_Send("\r\nOK\r\n");
+}
@@ -0,0 +1,46 @@
+/*
+ * sim_modem.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM_MODEM_H_
+#define INC_SIM_MODEM_H_
+
+#include <stdint.h>
+
+#ifndef SIM_MODEM_OUTPUT_LENGTH
+#define SIM_MODEM_OUTPUT_LENGTH					4096	/* Characters the module may have queued for the UART. */
+#endif
+
+#ifndef SIM_MODEM_COMMAND_LENGTH
+#define SIM_MODEM_COMMAND_LENGTH				512		/* Longest command line, longer ones are cut. */
+#endif
+
+
+/**
+ * @brief   Structure representing a line of the script of the simulated module.
+ *
+ * A command starting with command is answered with response, e.g. { "AT+CSQ", "\r\n+CSQ: 17,0\r\n\r\nOK\r\n" }.
+ */
+typedef struct
+{
+    const char *command;                        /*!< Start of the command line, without the line end. */
+    const char *response;                       /*!< Characters sent back, NULL - no answer (a hung module). */
+} SIM_Script_t;
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+void SIM_Modem_Script						(const SIM_Script_t *script, uint16_t count);
+void SIM_Modem_Reset						(void);
+void SIM_Modem_Send							(const char *text);
+void SIM_Modem_Input						(const uint8_t *data, uint16_t length);
+uint8_t SIM_Modem_Output					(uint8_t *c);
+uint32_t SIM_Modem_Commands					(void);
+
+#endif /* INC_SIM_MODEM_H_ */
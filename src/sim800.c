@@ -6,27 +6,424 @@
  */
 
 #include "string.h"
-#include "stdlib.h"
+#include "stdarg.h"
 #include "sim800.h"
+#include "sim800_pdu.h"
 
 
 /*
  * Static helpful functions
  * See the functions definitions for more details
  */
-static uint8_t add_pending_message(SIM800_Handle_t *handle, char *code, void (*messageHandler)(void*, uint32_t));
+typedef SIM800_Status_t (*response_parser_t)(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+
+typedef struct
+{
+    SIM800_Status_t status;
+    uint8_t done;
+} blocking_result_t;    // Result of a request executed by a blocking function
+
+#if SIM800_USE_FS
+typedef struct
+{
+    uint8_t *buffer;
+    uint16_t length;
+    uint8_t started;
+} fs_read_t;            // Window of "AT+FSREAD", its data follows the empty line that opens the response
+#endif
+
+typedef enum
+{
+    FIELD_NONE,             // No field is left in the line
+    FIELD_NUMBER,           // Decimal number, the value is in value
+    FIELD_STRING,           // Quoted string, start and end exclude the quotes
+    FIELD_TEXT,             // Anything else, e.g. an empty field
+} line_field_type_t;
+
+typedef struct
+{
+    uint32_t next;          // Position of the following field in the line
+    uint32_t start;         // Position of the first character of the field
+    uint32_t end;           // Position behind the last character of the field
+    int32_t value;          // Value of a number
+    line_field_type_t type;
+} line_field_t;    // Cursor over the comma separated fields of a response line, see line_field
+
+typedef struct
+{
+    char type;              // Conversion of the field: 'd', 's' or '*'
+    void *value;            // Destination of the field, NULL for a skipped field
+    size_t size;            // Size of the destination of a string
+} query_field_t;
+
+typedef struct
+{
+    query_field_t fields[SIM800_QUERY_MAX_FIELDS];
+    uint8_t count;          // Count of fields
+    uint8_t done;           // 1 once the response line has been parsed
+    SIM800_Status_t status; // Result of the parse
+} query_t;    // Compiled format of SIM800_Query
+
+static uint8_t add_pending_message(SIM800_Handle_t *handle, const char *code, response_parser_t parser, void *response,
+                                   void (*messageHandler)(void*, uint32_t));
 static void remove_expected_code(SIM800_Handle_t *handle, uint8_t index);
 
-static SIM800_Status_t send_command(char *cmd);
-static SIM800_Status_t validate_message(char *message);
+static SIM800_Status_t start_receiving(SIM800_Handle_t *handle);
+static SIM800_Status_t register_uart(SIM800_Handle_t *handle);
+static SIM800_Status_t configure_uart(SIM800_Handle_t *handle, uint32_t baud, uint32_t flow);
+static uint32_t uart_baud(SIM800_Handle_t *handle);
+static uint32_t uart_flow(SIM800_Handle_t *handle);
+static void resume_receiving(SIM800_Handle_t *handle);
+static SIM800_Status_t verify_link(SIM800_Handle_t *handle);
+static uint32_t uart_slot(UART_HandleTypeDef *huart);
+static void process_line(SIM800_Handle_t *handle, SIM800_Line_t *line);
+static uint8_t final_result(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_Status_t *result);
+static void consume_line(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static void boot_line(SIM800_Handle_t *handle, const SIM800_Line_t *line);
+static void post_event(SIM800_Handle_t *handle, SIM800_EventType_t type, uint8_t arg, uint8_t arg2, uint32_t value);
+static void dispatch_events(SIM800_Handle_t *handle);
+static void flow_poll(SIM800_Handle_t *handle);
+static void publish_event(SIM800_Handle_t *handle, const SIM800_Event_t *event);
+static void watchdog_poll(SIM800_Handle_t *handle);
+static void watchdog_enter(SIM800_Handle_t *handle, SIM800_WatchdogState_t state);
+static void watchdog_next(SIM800_Handle_t *handle);
+static void watchdog_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+#if SIM800_USE_SLEEP
+static void sleep_poll(SIM800_Handle_t *handle);
+static uint8_t sleep_idle(SIM800_Handle_t *handle);
+#endif
+#if SIM800_USE_PHONEBOOK
+static void phonebook_size_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void phonebook_read_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void phonebook_poll(SIM800_Handle_t *handle);
+static uint64_t phonebook_key(const char *number);
+static uint16_t phonebook_find(const SIM800_Phonebook_t *phonebook, uint64_t key);
+static SIM800_Status_t cpbr_size_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cpbr_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+#endif
+static void end_notification(SIM800_Handle_t *handle, uint8_t index);
+static uint8_t result_index(SIM800_Handle_t *handle);
+static uint8_t wait_for_boot(SIM800_Handle_t *handle, uint8_t state, uint32_t timeout);
+static uint32_t code_hash(const char *code, size_t len);
+static uint32_t line_code_hash(SIM800_Handle_t *handle, const SIM800_Line_t *line, size_t *len);
+
+static uint8_t scan_newline(SIM800_Handle_t *handle, uint32_t end);
+static char line_char(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t pos);
+static uint8_t line_starts_with(SIM800_Handle_t *handle, const SIM800_Line_t *line, const char *prefix, size_t len);
+static uint8_t line_equals(SIM800_Handle_t *handle, const SIM800_Line_t *line, const char *text);
+static int32_t line_find(SIM800_Handle_t *handle, const SIM800_Line_t *line, char c, uint32_t from);
+static int32_t line_to_int(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t *pos);
+static size_t line_copy(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t from, uint32_t to, char *dst, size_t size);
+static void line_fields(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field);
+static line_field_type_t line_field(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field);
+static uint8_t line_numbers(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field, int32_t *values, uint8_t count);
+static SIM800_Status_t query_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+
+static uint8_t start_command(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, uint8_t ucs2, void *response,
+                             void (*messageHandler)(void*, uint32_t));
+static SIM800_Status_t execute_command(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, const char *data, void *response);
+static SIM800_Request_t *submit_request(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, const char *data,
+                                        void *response, SIM800_RequestCallback_t done, void *ctx,
+                                        const SIM800_RequestOptions_t *options);
+static SIM800_Request_t *claim_request(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, const char *data,
+                                       void *response, SIM800_RequestCallback_t done, void *ctx,
+                                       const SIM800_RequestOptions_t *options);
+static void commit_request(SIM800_Handle_t *handle);
+static void release_request(SIM800_Handle_t *handle);
+static const SIM800_RequestOptions_t *take_options(SIM800_Handle_t *handle, SIM800_RequestOptions_t *options);
+static void executor_poll(SIM800_Handle_t *handle);
+static uint8_t step_request(SIM800_Handle_t *handle, SIM800_Request_t *req);
+static uint8_t start_batch(SIM800_Handle_t *handle, SIM800_Request_t *req);
+static uint8_t step_batch(SIM800_Handle_t *handle, SIM800_Request_t *req);
+static SIM800_Status_t wait_for_request(SIM800_Handle_t *handle, blocking_result_t *result);
+static uint8_t finish_request(SIM800_Handle_t *handle, SIM800_Request_t *req, SIM800_Status_t status);
+static uint8_t retry_request(SIM800_Handle_t *handle, SIM800_Request_t *req);
+static uint8_t cancel_request(SIM800_Handle_t *handle, SIM800_Request_t *req, SIM800_Status_t status);
+static uint8_t drop_requests(SIM800_Handle_t *handle, uint32_t token);
+#if SIM800_USE_GPRS
+static void socket_abort(SIM800_Handle_t *handle, uint8_t socket);
+static void socket_abort_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+#endif
+#if SIM800_USE_LATENCY || SIM800_USE_ISR_BUDGET
+static uint32_t dwt_cycles(void);
+#endif
+#if SIM800_USE_ISR_BUDGET
+static void isr_exit(SIM800_Handle_t *handle, uint32_t start);
+static uint32_t cycles_to_ns(uint32_t cycles);
+#endif
+#if SIM800_USE_LATENCY
+static void latency_stamp(SIM800_Handle_t *handle, uint8_t stamp);
+static void latency_start(SIM800_Handle_t *handle);
+static void latency_sent(SIM800_Handle_t *handle, SIM800_Request_t *req);
+static void latency_tx(SIM800_Handle_t *handle);
+static void latency_line(SIM800_Handle_t *handle, uint8_t index);
+static void latency_finish(SIM800_Handle_t *handle, SIM800_Request_t *req, SIM800_Status_t status);
+static uint32_t latency_us(SIM800_LatencyMonitor_t *latency, uint8_t from, uint8_t to);
+#endif
+
+static SIM800_Status_t send_command(SIM800_Handle_t *handle, const char *cmd);
+static SIM800_Status_t send_data(SIM800_Handle_t *handle, const char *data);
+static SIM800_Status_t send_hex(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length);
+static SIM800_Status_t send_iov(SIM800_Handle_t *handle, const SIM800_IOVec_t *iov, uint8_t count);
+#if SIM800_USE_SMS
+static SIM800_Status_t send_ucs2(SIM800_Handle_t *handle, const char *text);
+#endif
+static SIM800_Status_t tx_enqueue(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, uint8_t copy,
+                                  SIM800_TxCallback_t done, void *ctx);
+static void tx_start(SIM800_Handle_t *handle);
+static void tx_complete(SIM800_Handle_t *handle, SIM800_Status_t status);
+static void tx_poll(SIM800_Handle_t *handle);
+#if SIM800_USE_TRACE
+static void trace_record(SIM800_Handle_t *handle, uint8_t type, const uint8_t *first, uint16_t firstLength,
+                         const uint8_t *second, uint16_t secondLength);
+static void trace_rx(SIM800_Handle_t *handle, uint32_t start, uint32_t length);
+static void trace_put(SIM800_Trace_t *trace, const uint8_t *data, uint16_t length);
+#endif
+static void link_transmit(SIM800_Handle_t *handle);
+static void raw_rx(SIM800_Handle_t *handle, uint32_t head);
+static SIM800_Status_t validate_response(SIM800_Handle_t *handle, uint8_t index);
+
+static void uint_to_str(uint32_t value, char *str);
+static SIM800_Status_t append_setting(char *line, size_t size, const char *setting, const char *value, const char *end);
+static SIM800_Status_t init_settings(const SIM800_Config_t *config, uint8_t ucs2, char *line, size_t size);
+static uint32_t profile_fingerprint(const char *line);
+static SIM800_Status_t save_profile(SIM800_Handle_t *handle, uint32_t fingerprint);
+
+static SIM800_Status_t cached_query(SIM800_Handle_t *handle, SIM800_CacheItem_t item, void *value, size_t size);
+static uint8_t cache_expired(SIM800_Handle_t *handle, SIM800_CacheItem_t item);
+static void *cache_value(SIM800_Handle_t *handle, SIM800_CacheItem_t item, size_t *size);
+static void cache_refresh(SIM800_Handle_t *handle);
+
+static void blocking_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void cache_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void signal_poll(SIM800_Handle_t *handle);
+static void signal_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+
+static SIM800_Status_t cbc_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t creg_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t csq_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cpin_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t marker_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t id_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t creg_urc_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t ring_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t clip_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static void call_ring(SIM800_Handle_t *handle);
+static void hang_up_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+#if SIM800_USE_GNSS
+static SIM800_Status_t ugnsinf_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static uint8_t parse_fixed(SIM800_Handle_t *handle, const SIM800_Line_t *line, const line_field_t *field, uint8_t decimals,
+                           int32_t *value);
+#endif
+#if SIM800_USE_REG_CACHE
+static SIM800_Status_t cops_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cband_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static void reg_cache_select(SIM800_Handle_t *handle);
+static void reg_cache_registered(SIM800_Handle_t *handle);
+static void reg_cache_poll(SIM800_Handle_t *handle);
+static void reg_cache_operator_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void reg_cache_band_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+#endif
+static SIM800_Status_t cusd_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static void ussd_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void ussd_poll(SIM800_Handle_t *handle);
+static void ussd_balance(SIM800_Handle_t *handle);
+static SIM800_Status_t cclk_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t ceng_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t psuttz_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t dst_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static uint8_t parse_timestamp(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t start, uint32_t end,
+                               SIM800_Time_t *time);
+static uint8_t time_to_seconds(const SIM800_Time_t *time, uint32_t *seconds);
+static void seconds_to_time(uint32_t seconds, int8_t zone, SIM800_Time_t *time);
+static void clock_set(SIM800_Handle_t *handle, uint32_t seconds, int8_t zone);
+static SIM800_Status_t update_reg_status(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field);
+#if SIM800_USE_SMS
+static void read_sms_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void list_sms_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static SIM800_Status_t cmti_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cmgr_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cmt_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cmgl_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t sms_header(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_SMSMessage_t *message, uint8_t sender);
+static void sms_body(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_SMSMessage_t *message, uint8_t separate);
+static void ucs2_reset(SIM800_Handle_t *handle);
+static void ucs2_append(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t from, uint32_t to, char *dst, size_t size);
+static void ucs2_decode(char *text);
+static uint16_t ucs2_length(const char *text);
+static uint8_t sms_text_fits(SIM800_Handle_t *handle, const char *text);
+static void sms_template_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static SIM800_Status_t cpms_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cmgs_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t cds_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t sms_indication(SIM800_Handle_t *handle);
+static void sms_batch_fill(SIM800_Handle_t *handle);
+static void sms_batch_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static uint8_t sms_rate(uint32_t *tat, uint32_t now, uint16_t burst, uint32_t period, uint8_t take);
+static SIM800_SMSBucket_t *sms_bucket(SIM800_SMSScheduler_t *sched, uint32_t key, uint32_t now);
+static void sms_sched_fill(SIM800_Handle_t *handle);
+static void sms_sched_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void check_sms_storage(SIM800_Handle_t *handle);
+static void sms_consumed(SIM800_Handle_t *handle, uint16_t sms_index);
+static SIM800_SMSMessage_t *sms_slot(SIM800_Handle_t *handle);
+static void sms_deliver(SIM800_Handle_t *handle);
+static void sms_release_flush(SIM800_Handle_t *handle);
+static void sms_delete_flush(SIM800_Handle_t *handle);
+static void sms_delete_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+#if SIM800_USE_PDU
+static void pdu_rx_reset(SIM800_Handle_t *handle);
+static SIM800_Status_t pdu_rx_append(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_SMSMessage_t *message);
+static uint8_t sms_part(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message);
+static void long_sms_expire(SIM800_Handle_t *handle);
+#endif
+static void sms_report(SIM800_Handle_t *handle, uint8_t reference, uint8_t status);
+static SIM800_Status_t sms_params(SIM800_Handle_t *handle);
+#endif /* SIM800_USE_SMS */
+#if SIM800_USE_GPRS
+static SIM800_Status_t ip_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t socket_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t receive_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t ciprxget_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t ciprxget_urc_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static void complete_request(SIM800_Handle_t *handle, SIM800_Command_t cmd, char first, SIM800_Status_t status);
+static void socket_rx(SIM800_Handle_t *handle, uint32_t head);
+static SIM800_Status_t shut_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t pdp_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static void bearer_poll(SIM800_Handle_t *handle);
+static void bearer_next(SIM800_Handle_t *handle);
+static void bearer_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void bearer_lost(SIM800_Handle_t *handle);
+static SIM800_Status_t cdnsgip_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static uint8_t dns_is_address(const char *host);
+static SIM800_DNSEntry_t *dns_slot(SIM800_Handle_t *handle, const char *host);
+static const char *dns_address(SIM800_Handle_t *handle, const char *host, char *ip);
+static uint8_t transparent_data(SIM800_Handle_t *handle);
+static uint8_t transparent_busy(SIM800_Handle_t *handle);
+static void transparent_rx(SIM800_Handle_t *handle, uint32_t head);
+static void transparent_line(SIM800_Handle_t *handle, const SIM800_Line_t *line);
+static void transparent_open_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+#if SIM800_USE_HTTP
+static SIM800_Status_t sapbr_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t httpaction_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t httpread_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static SIM800_Status_t clbs_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static uint8_t parse_degrees(SIM800_Handle_t *handle, const SIM800_Line_t *line, const line_field_t *field, int32_t *value);
+static SIM800_Status_t http_bearer(SIM800_Handle_t *handle);
+static SIM800_Status_t http_request(SIM800_Handle_t *handle, const char *url, const char *contentType,
+                                    const uint8_t *data, uint16_t length, uint16_t *status);
+static SIM800_Status_t http_exchange(SIM800_Handle_t *handle, const char *url, const char *contentType,
+                                     const uint8_t *data, uint16_t length, uint16_t *status);
+#endif
+#if SIM800_USE_FS
+static SIM800_Status_t fsflsize_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line);
+static uint8_t fs_name_valid(const char *name);
+static void fs_write_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void fs_read_start(SIM800_Handle_t *handle);
+#endif
+#endif /* SIM800_USE_GPRS */
+
+
+/*
+ * Descriptors of the supported AT commands, generated from SIM800_COMMANDS
+ */
+typedef struct
+{
+    const char *command;
+    const char *suffix;
+    const char *code;
+    uint32_t timeout;
+    response_parser_t parser;
+} command_descriptor_t;
+
+/*
+ * Handles of the modems by their UART, see register_uart
+ */
+static SIM800_Handle_t *uart_table[UART_TABLE_SIZE];
+
+/*
+ * Baud rates probed by SIM800_AutoBaud, the most common first
+ */
+static const uint32_t baud_rates[] = { 115200, 460800, 230400, 57600, 38400, 19200, 9600 };
+
+/*
+ * Causes retried by a retry policy without a list of its own: network failures and a busy SIM card
+ */
+static const uint16_t transient_causes[] =
+{
+    SIM800_CMS_NetworkOutOfOrder, SIM800_CMS_TemporaryFailure, SIM800_CMS_Congestion, SIM800_CMS_ResourcesUnavailable,
+    SIM800_CMS_SIMBusy, SIM800_CMS_NoNetwork, SIM800_CMS_NetworkTimeout,
+    SIM800_CME_SIMBusy, SIM800_CME_NoNetwork, SIM800_CME_NetworkTimeout,
+};
+
+/*
+ * Configuration applied by SIM800_Init without a configuration
+ */
+static const SIM800_Config_t default_config =
+{
+    .textMode = 1,
+    .smsNotifications = 1,
+    .errorMode = 1,
+    .regNotifications = 0,
+    .charset = "GSM",
+    .storage = NULL,
+    .timeout = SIM800_INIT_TIMEOUT,
+};
+
+/*
+ * Power-on notifications of the module and the boot state bits they set
+ */
+static const struct
+{
+    const char *line;
+    uint8_t length;
+    uint8_t state;
+} boot_lines[] =
+{
+    { "RDY",          3,  SIM800_Boot_Ready },
+    { "+CFUN: 1",     8,  SIM800_Boot_FullFunc },
+    { "+CPIN: READY", 12, SIM800_Boot_SIMReady },
+    { "Call Ready",   10, SIM800_Boot_CallReady },
+    { "SMS Ready",    9,  SIM800_Boot_SMSReady },
+};
+
+#if SIM800_USE_SMS
+/*
+ * Arguments of "AT+CMGL=" in the order of SIM800_SMSFilter_t, in text mode and in PDU mode
+ */
+static const char *const sms_filters[2][SIM800_SMS_FilterCount] =
+{
+    { "\"REC UNREAD\"", "\"REC READ\"", "\"STO UNSENT\"", "\"STO SENT\"", "\"ALL\"" },
+    { "0", "1", "2", "3", "4" },
+};
+#endif
 
-static SIM800_Status_t wait_for_state(SIM800_Handle_t *handle, SIM800_ExpectedCodeState_t state, uint8_t index);
+/*
+ * Commands reading the cached values, in the order of SIM800_CacheItem_t
+ */
+static const SIM800_Command_t cache_commands[SIM800_Cache_Count] =
+{
+    SIM800_Cmd_BatteryInfo, SIM800_Cmd_SignalQuality, SIM800_Cmd_IMEI, SIM800_Cmd_ICCID, SIM800_Cmd_CellInfo,
+#if SIM800_USE_HTTP
+    SIM800_Cmd_Location,
+#endif
+};
 
-static void cmti_handler(void *handle_ptr, uint32_t msg_index);
-static void cmgr_handler(void *handle_ptr, uint32_t msg_index);
+#if SIM800_USE_GPRS
+/*
+ * Steps of the bring-up of the GPRS bearer, the shut of the IP stack only follows a failure or a deactivation
+ */
+static const SIM800_Command_t bearer_steps[] =
+{
+    SIM800_Cmd_GPRSShut, SIM800_Cmd_GPRSAttach, SIM800_Cmd_GPRSAPN, SIM800_Cmd_GPRSUp, SIM800_Cmd_LocalIP,
+};
+#endif
 
-static SIM800_Status_t cbc_parser(SIM800_Battery_t *batt, char *message);
-static void cmgr_parser(SIM800_SMSMessage_t *sms_message, char *message);
+static const command_descriptor_t commands[SIM800_Cmd_Count] =
+{
+#define COMMAND_DESCRIPTOR(name, command, suffix, code, timeout, parser)	{ command, suffix, code, timeout, parser },
+    SIM800_COMMANDS(COMMAND_DESCRIPTOR)
+#undef COMMAND_DESCRIPTOR
+};
 
 
 /*********************************************************************************************
@@ -39,6 +436,10 @@ static void cmgr_parser(SIM800_SMSMessage_t *sms_message, char *message);
  * This function is used to control the reception of messages from the module. If receiving
  * needs to be started (enordi = 1), it initiates the receiving process. If receiving needs
  * to be stopped (enordi = 0), it stops the receiving process.
+ * The receiving mode is taken from handle->rxMode, see SIM800_RxMode_t. When receiving is started
+ * for the first time, the handle is registered for its UART (handle->uart), so the SIM800_UART_...
+ * callbacks find it. A handle with a link (see SIM800_AttachLink) receives through SIM800_LinkInput,
+ * its reception is started and stopped by link->receive.
  *
  * @param   *handle: Pointer to the handle structure.
  * @param   enordi: ENABLE(1) to start receiving, DISABLE(0) to stop receiving.
@@ -51,18 +452,36 @@ SIM800_Status_t SIM800_ManageReceiving(SIM800_Handle_t *handle, uint8_t enordi)
 	{
 		if( handle->recStatus == SIM800_DoesntReceive )
 		{
-			if( HAL_UART_Receive_IT(SIM800_UART, (uint8_t *)&handle->rcvdByte, 1) != HAL_OK )
+			if( handle->link == NULL && (handle->uart == NULL || register_uart(handle) != SIM800_OK) )
+			{
+				return SIM800_ERROR;
+			}
+
+			if( start_receiving(handle) != SIM800_OK )
 			{
 				return SIM800_ERROR;
 			}
 
 			handle->recStatus = SIM800_Receives;
-			return SIM800_OK;
 		}
+
+		return SIM800_OK;
 	}
 
 	if( handle->recStatus == SIM800_Receives )
 	{
+		if( handle->link != NULL )
+		{
+			if( handle->link->receive != NULL )
+			{
+				handle->link->receive(handle, DISABLE, handle->linkCtx);
+			}
+		}
+		else if( handle->rxMode == SIM800_RxMode_DMA )
+		{
+			HAL_UART_AbortReceive(handle->uart);
+		}
+
 		handle->recStatus = SIM800_DoesntReceive;
 		return SIM800_OK;
 	}
@@ -72,769 +491,13985 @@ SIM800_Status_t SIM800_ManageReceiving(SIM800_Handle_t *handle, uint8_t enordi)
 
 
 /**
- * @brief   Retrieves battery information from the SIM800 module.
+ * @brief   Connects a handle to a link instead of a UART, e.g. a virtual channel of the multiplexer.
  *
- * This function sends the "AT+CBC" command to the SIM800 module to retrieve battery information.
- * It then waits for the response, validates the received message, and parses the battery data
- * into the provided `battery` structure.
+ * The queued blocks are handed to link->transmit instead of the UART and the received characters are
+ * written to the receive ring by SIM800_LinkInput. Everything else works as with a UART: the handle is
+ * started by SIM800_Init. The baud rate and the flow control (SIM800_NegotiateBaud, SIM800_AutoBaud,
+ * SIM800_ManageFlowControl) are set through link->configure, they fail on a link without one.
  *
- * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   *battery: Pointer to the SIM800_Battery_t structure to store battery information.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
- * @return  Execution status. For details, refer to the SIM800_Status_t in the corresponding .h file.
+ * @param   *handle: Pointer to the SIM800 handle structure, it must not be receiving yet.
+ * @param   *link: Link functions, NULL - detach the link.
+ * @param   *ctx: Argument of the link functions.
  */
-SIM800_Status_t SIM800_GetBatteryInfo(SIM800_Handle_t *handle, SIM800_Battery_t *battery)
+void SIM800_AttachLink(SIM800_Handle_t *handle, const SIM800_Link_t *link, void *ctx)
 {
-	char cmd[] = "AT+CBC\r\n";
-	uint8_t index = add_pending_message(handle, "+CBC", NULL);
-
-	if( send_command(cmd) == SIM800_ERROR )
-	{
-		remove_expected_code(handle, index);
-		return SIM800_ERROR;
-	}
-
-	if( wait_for_state(handle, SIM800_ReceivedStatus, index) == SIM800_TIMEOUT )
-	{
-		remove_expected_code(handle, index);
-		return SIM800_TIMEOUT;
-	}
-
-	if( validate_message(handle->expected_codes[index].data) == SIM800_ERROR)
-	{
-		remove_expected_code(handle, index);
-		return SIM800_ERROR;
-	}
-
-	cbc_parser(battery, handle->expected_codes[index].data);
-
-	remove_expected_code(handle, index);
-
-	return  SIM800_OK;
+    handle->link = link;
+    handle->linkCtx = ctx;
+    handle->linkOffset = 0;
 }
 
 
 /**
- * @brief   Retrieves the status from the SIM800 module.
+ * @brief   Writes the characters received by the link of a handle into its receive ring.
  *
- * This function sends the "AT" command to the SIM800 module to check its status.
- * It waits for a response and validates the received message.
+ * The characters that do not fit the ring are dropped and counted in handle->rxOverruns. With flow
+ * control, the reception of the link is stopped once the ring fills up to RX_HIGH_WATER, SIM800_Process
+ * starts it again. The function may be called from an interrupt.
  *
- * @param   *handle: Pointer to the SIM800 handle structure.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
- * @return  Execution status. For details, refer to the SIM800_Status_t in the corresponding .h file.
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_AttachLink.
+ * @param   *data: Received characters.
+ * @param   length: Count of characters.
+ * @retval  Count of characters written into the ring.
  */
-SIM800_Status_t SIM800_GetStatus(SIM800_Handle_t *handle)
+uint16_t SIM800_LinkInput(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length)
 {
-	char cmd[] = "AT\r\n";
-	uint8_t index = add_pending_message(handle, "DUMMY", NULL);
-
-	if( send_command(cmd) == SIM800_ERROR )
-	{
-		remove_expected_code(handle, index);
-		return SIM800_ERROR;
-	}
-
-	if( wait_for_state(handle, SIM800_ReceivedStatus, index) == SIM800_TIMEOUT )
-	{
-		remove_expected_code(handle, index);
-		return SIM800_TIMEOUT;
-	}
-
-	if( validate_message(handle->expected_codes[index].data) == SIM800_ERROR)
-	{
-		remove_expected_code(handle, index);
-		return SIM800_ERROR;
-	}
-
-	return  SIM800_OK;
-}
+    uint32_t head = handle->rxHead;
+    uint16_t count = 0;
 
+    if (handle->recStatus != SIM800_Receives)
+    {
+        return 0;
+    }
 
-/**
- * @brief   Retrieves the network registration status from the SIM800 module.
- *
- * This function sends the "AT+CREG?" command to the SIM800 module to query its network registration status.
- * It waits for a response, validates the received message, and returns the network registration status.
- *
- * @param   *handle: Pointer to the SIM800 handle structure.
- * @retval  SIM800_NetworkRegStatus_t enumeration value representing the network registration status.
- * @return  Network registration status. For possible values, refer to the SIM800_NetworkRegStatus_t enumeration.
- */
-SIM800_NetworkRegStatus_t SIM800_GetNetworkRegStatus(SIM800_Handle_t *handle)
-{
-	char cmd[] = "AT+CREG?\r\n", *ptr;
-	uint8_t index = add_pending_message(handle, "+CREG", NULL);
-	SIM800_NetworkRegStatus_t status;
-
-	if( send_command(cmd) == SIM800_ERROR )
-	{
-		remove_expected_code(handle, index);
-		return SIM800_FAIL;
-	}
+    while (count < length && head - handle->rxTail < RX_RING_LENGTH)
+    {
+        handle->rxRing[head++ & (RX_RING_LENGTH - 1)] = data[count++];
+    }
 
-	if( wait_for_state(handle, SIM800_ReceivedStatus, index) == SIM800_TIMEOUT )
-	{
-		remove_expected_code(handle, index);
-		return SIM800_FAIL;
-	}
+    // Make sure the characters are written before they are published to the consumer
+    __DMB();
+    handle->rxHead = head;
 
-	if( validate_message(handle->expected_codes[index].data) == SIM800_ERROR)
-	{
-		remove_expected_code(handle, index);
-		return SIM800_FAIL;
-	}
+    handle->rxOverruns += length - count;
 
-	ptr = strchr(handle->expected_codes[index].data, ',');
-	status = strtol(++ptr, NULL, 10);
+    if (handle->flowControl && !handle->rxStalled && handle->link->receive != NULL &&
+        head - handle->rxTail >= RX_HIGH_WATER)
+    {
+        handle->rxStalled = 1;
+        handle->link->receive(handle, DISABLE, handle->linkCtx);
+    }
 
-	remove_expected_code(handle, index);
+    SIM800_OS_Signal(handle);
 
-	return status;
+    return count;
 }
 
 
 /**
- * @brief   Sets the SMS text mode for the SIM800 module.
+ * @brief   Switches the module to the GSM 07.10 multiplexer mode ("AT+CMUX=0").
  *
- * This function sends the "AT+CMGF=1" command to the SIM800 module to set it to SMS text mode.
- * It then waits for the response, validates the received message, and removes the expected message.
+ * From the "OK" on, the characters of the UART are frames of the multiplexer: they are handed to the
+ * raw receiver instead of being parsed as lines, and the handle must not send commands any more. The
+ * framing itself is done by the multiplexer, see SIM800_CMUX_Start.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   rx: Receiver of the characters.
+ * @param   *ctx: Argument of the receiver.
  * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
- * @return  Execution status. For details, refer to the SIM800_Status_t in the corresponding .h file.
  */
-SIM800_Status_t SIM800_SetSMSTextMode(SIM800_Handle_t *handle)
+SIM800_Status_t SIM800_EnterMux(SIM800_Handle_t *handle, SIM800_RawRxCallback_t rx, void *ctx)
 {
-    char cmd[] = "AT+CMGF=1\r\n";
-    uint8_t index = add_pending_message(handle, "+CMGF", NULL);
+    SIM800_Status_t status;
 
-    if (send_command(cmd) == SIM800_ERROR)
+    if (rx == NULL || handle->rawRx != NULL)
     {
-        remove_expected_code(handle, index);
         return SIM800_ERROR;
     }
 
-    if (wait_for_state(handle, SIM800_ReceivedStatus, index) == SIM800_TIMEOUT)
+#if SIM800_USE_GPRS
+    if (transparent_busy(handle))
     {
-        remove_expected_code(handle, index);
-        return SIM800_TIMEOUT;
+        return SIM800_ERROR;
     }
+#endif
 
-    if (validate_message(handle->expected_codes[index].data) == SIM800_ERROR)
+    if ((status = execute_command(handle, SIM800_Cmd_Mux, NULL, NULL, NULL)) != SIM800_OK)
     {
-        remove_expected_code(handle, index);
-        return SIM800_ERROR;
+        return status;
     }
 
-    remove_expected_code(handle, index);
+    // The frames only start once the multiplexer opens its control channel, no character is lost
+    handle->rawCtx = ctx;
+    handle->rawRx = rx;
 
     return SIM800_OK;
 }
 
 
 /**
- * @brief   Deletes all SMS messages from the SIM800 module.
- *
- * This function sends the "AT+CMGD=1,4" command to the SIM800 module to delete all SMS messages stored on it.
- * It waits for a response, validates the received message, and returns the status.
+ * @brief   Parses the characters of the UART as lines again, once the multiplexer has been closed down.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
- * @return  Execution status. For details, refer to the SIM800_Status_t enumeration.
  */
-SIM800_Status_t SIM800_DeleteAllSMSMessages(SIM800_Handle_t *handle)
+void SIM800_LeaveMux(SIM800_Handle_t *handle)
 {
-	char cmd[] = "AT+CMGD=1,4\r\n";
-	uint8_t index = add_pending_message(handle, "+CMGD", NULL);
-
-	if (send_command(cmd) == SIM800_ERROR)
-	{
-		remove_expected_code(handle, index);
-		return SIM800_ERROR;
-	}
-
-	if (wait_for_state(handle, SIM800_ReceivedStatus, index) == SIM800_TIMEOUT)
-	{
-		remove_expected_code(handle, index);
-		return SIM800_TIMEOUT;
-	}
-
-	if (validate_message(handle->expected_codes[index].data) == SIM800_ERROR)
-	{
-		remove_expected_code(handle, index);
-		return SIM800_ERROR;
-	}
-
-	remove_expected_code(handle, index);
-
-	return SIM800_OK;
+    handle->rawRx = NULL;
+    handle->rawCtx = NULL;
 }
 
 
 /**
- * @brief   Sends an SMS message via the SIM800 module.
+ * @brief   Starts and configures the SIM800 module in one call.
  *
- * This function sends an SMS message to the specified destination number using the SIM800 module.
- * It constructs the appropriate AT command, sends the message, and waits for a response.
- * The expected code is removed after the operation.
+ * This function starts receiving, waits until the module answers and turns the echo off ("ATE0"), so the module
+ * stops sending every command back. The settings are then sent as one combined command line
+ * (e.g. "AT+CMGF=1;+CNMI=2,1;+CMEE=1;+CSCS="GSM""), which the module executes in a single round trip.
+ * Finally the function waits until the SIM card is ready ("+CPIN: READY") and enables the notifications
+ * selected by the configuration. If the module has just been powered on ("RDY" received), it also waits for
+ * "SMS Ready". The power-on notifications end the waits, so it returns as soon as the module is ready.
+ *
+ * With config->saveProfile, the settings are stored in the profile of the module ("AT&W"), which it loads
+ * at every start, and a fingerprint of them is kept in the APN of bearer profile SIM800_PROFILE_CID. At the
+ * next start the fingerprint is read back ("AT+SAPBR=4,<cid>") first: if it matches the configuration,
+ * "ATE0" and the settings are not sent again.
+ *
+ * With SIM800_USE_REG_CACHE, a module not registered yet is pointed at the operator and the band of the last
+ * registration (see SIM800_SetRegCache), and the time to register is measured from the call.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   *destination: Destination phone number.
- * @param   *message: SMS message to be sent.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
- * @return  Execution status. For details, refer to the SIM800_Status_t enumeration.
+ * @param   *config: Pointer to the configuration, NULL for the default one (text mode, SMS notifications,
+ *                   numeric error causes, GSM character set). It is kept by the handle and must stay valid,
+ *                   the watchdog sends it again after a restart of the module (see SIM800_ManageWatchdog).
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if the module or the SIM card is not ready in time.
  */
-SIM800_Status_t SIM800_SendSMSMessage(SIM800_Handle_t *handle, char *destination, char *message)
+SIM800_Status_t SIM800_Init(SIM800_Handle_t *handle, const SIM800_Config_t *config)
 {
-    char buff[SMS_TX_MAX_LEN];
-    // Add an expected code for the +CMGS code
-    uint8_t index = add_pending_message(handle, "+CMGS", NULL);
-
-    if (strlen(destination) > (SMS_TX_MAX_LEN - 3) || strlen(message) > (SMS_TX_MAX_LEN - 3))
+    char line[TX_ARENA_LENGTH / 2];
+    char cid[4];
+    uint32_t tickStart = HAL_GetTick();
+    uint32_t timeout, elapsed;
+    uint32_t fingerprint = 0, marker = 0;
+    uint8_t ready = 0;
+#if SIM800_USE_SMS
+    uint8_t ucs2;
+#endif
+#if SIM800_USE_REG_CACHE
+    SIM800_NetworkRegStatus_t reg;
+#endif
+    SIM800_Status_t status;
+
+    if (config == NULL)
+    {
+        config = &default_config;
+    }
+    timeout = config->timeout != 0 ? config->timeout : SIM800_INIT_TIMEOUT;
+    handle->config = config;
+
+#if SIM800_USE_REG_CACHE
+    handle->regCache.timing = 1;
+    handle->regCache.targeted = 0;
+    handle->regCache.cached = 0;
+    handle->regCache.bootTick = tickStart;
+    handle->regCache.time = 0;
+#endif
+
+    if (config->errorMode > 2 || SIM800_ManageReceiving(handle, ENABLE) != SIM800_OK)
     {
-        // Remove the expected code if the data is too large
-        remove_expected_code(handle, index);
         return SIM800_ERROR;
     }
 
-    // Prepare the AT command for sending an SMS
-    strcpy(buff, "AT+CMGS=\"");
-    strcat(buff, destination);
-    strcat(buff, "\"\r\n");
+    // Wait until the module answers
+    while (execute_command(handle, SIM800_Cmd_Status, NULL, NULL, NULL) != SIM800_OK)
+    {
+        if (HAL_GetTick() - tickStart > timeout)
+        {
+            return SIM800_TIMEOUT;
+        }
+    }
 
-    // Send the command
-    if (send_command(buff) == SIM800_ERROR)
+    // Combine the settings into one command line, "AT" is added by the command
+#if SIM800_USE_SMS
+    ucs2 = (config->charset != NULL) ? (strcmp(config->charset, "UCS2") == 0) : handle->smsUCS2;
+    if (init_settings(config, ucs2, line, sizeof(line)) != SIM800_OK)
+#else
+    if (init_settings(config, 0, line, sizeof(line)) != SIM800_OK)
+#endif
     {
-        // Remove the expected code in case of failure
-        remove_expected_code(handle, index);
         return SIM800_ERROR;
     }
 
-    // Wait after sending the first command
-    HAL_Delay(500);
+    if (config->saveProfile)
+    {
+        // A module without the marker (or with another one) is configured as usual
+        fingerprint = profile_fingerprint(line);
+        uint_to_str(SIM800_PROFILE_CID, cid);
+        execute_command(handle, SIM800_Cmd_ProfileMarker, cid, NULL, &marker);
+    }
+
+    if (!config->saveProfile || marker != fingerprint)
+    {
+        if ((status = execute_command(handle, SIM800_Cmd_EchoOff, NULL, NULL, NULL)) != SIM800_OK)
+        {
+            return status;
+        }
 
-    // Prepare the message for sending and add an end character
-    strcpy(buff, message);
-    strcat(buff, "\032");
+        if ((status = execute_command(handle, SIM800_Cmd_Configure, line, NULL, NULL)) != SIM800_OK)
+        {
+            return status;
+        }
 
-    // Send the SMS message
-    if (send_command(buff) == SIM800_ERROR)
+        if (config->saveProfile && (status = save_profile(handle, fingerprint)) != SIM800_OK)
+        {
+            return status;
+        }
+    }
+#if SIM800_USE_SMS
+#if SIM800_USE_PDU
+    handle->smsPDU = !config->textMode;
+#endif
+    handle->smsUCS2 = ucs2;
+#endif
+
+    // Wait until the SIM card is ready, "+CPIN: READY" ends the wait between the queries
+    while (!(handle->bootState & SIM800_Boot_SIMReady) &&
+           (execute_command(handle, SIM800_Cmd_SIMStatus, NULL, NULL, &ready) != SIM800_OK || !ready))
     {
-        // Send the end character in case of failure
-        send_command("\032");
-        // Remove the expected code
-        remove_expected_code(handle, index);
-        return SIM800_ERROR;
+        if (HAL_GetTick() - tickStart > timeout)
+        {
+            return SIM800_TIMEOUT;
+        }
+
+        wait_for_boot(handle, SIM800_Boot_SIMReady, SIM800_SIM_POLL_PERIOD);
     }
 
-    // Wait for a response to the sent SMS
-    if (wait_for_state(handle, SIM800_ReceivedStatus, index) == SIM800_TIMEOUT)
+    // A module that has just started accepts SMS commands after "SMS Ready"
+    elapsed = HAL_GetTick() - tickStart;
+    if ((handle->bootState & SIM800_Boot_Ready) &&
+        !wait_for_boot(handle, SIM800_Boot_SMSReady, elapsed < timeout ? timeout - elapsed : 0))
     {
-        // Send the end character in case of a timeout
-        send_command("\032");
-        // Remove the expected code
-        remove_expected_code(handle, index);
         return SIM800_TIMEOUT;
     }
 
-    // Validate the response message
-    if (validate_message(handle->expected_codes[index].data) == SIM800_ERROR)
+#if SIM800_USE_SMS
+    if (config->smsNotifications && handle->smsNotifications == 0 &&
+        SIM800_ManageSMSNotifications(handle, ENABLE) != SIM800_OK)
     {
-        // Send the end character in case of an error
-        send_command("\032");
-        // Remove the expected code
-        remove_expected_code(handle, index);
         return SIM800_ERROR;
     }
+#endif
+
+    if (config->regNotifications != 0 &&
+        (status = SIM800_ManageRegNotifications(handle, config->regNotifications)) != SIM800_OK)
+    {
+        return status;
+    }
+
+#if SIM800_USE_REG_CACHE
+    // A module registered already keeps its registration, the selection is not waited for
+    reg = SIM800_GetNetworkRegStatus(handle);
+    if (reg != SIM800_Registered_HomeNetwork && reg != SIM800_Registered_Roaming)
+    {
+        reg_cache_select(handle);
+    }
+#endif
+
+    handle->bootState |= SIM800_Boot_Configured;
 
-    // Remove the expected code since the SMS is sent
-    remove_expected_code(handle, index);
     return SIM800_OK;
 }
 
 
 /**
- * @brief   Manages SMS notifications from the SIM800 module.
+ * @brief   Retrieves battery information from the SIM800 module.
  *
- * This function enables or disables the reception and handling of SMS notifications from the SIM800 module.
- * When enabled, it adds an expected code for incoming SMS notifications to the pending messages.
- * When disabled, it removes the expected code.
+ * This function sends the "AT+CBC" command to the SIM800 module to retrieve battery information.
+ * It then waits for the response, validates the received message, and parses the battery data
+ * into the provided `battery` structure. If the value is cached (see SIM800_SetCacheTTL) and not
+ * expired, it is returned without sending the command.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   enordi: ENABLE to enable SMS notifications, DISABLE to disable SMS notifications.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure.
- * @return  Execution status. For details, refer to the SIM800_Status_t enumeration.
+ * @param   *battery: Pointer to the SIM800_Battery_t structure to store battery information.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ * @return  Execution status. For details, refer to the SIM800_Status_t in the corresponding .h file.
  */
-SIM800_Status_t SIM800_ManageSMSNotifications(SIM800_Handle_t *handle, uint8_t enordi)
+SIM800_Status_t SIM800_GetBatteryInfo(SIM800_Handle_t *handle, SIM800_Battery_t *battery)
 {
-    static uint32_t index = 0xFFFF;
-
-    if (enordi == ENABLE)
-    {
-        if (index == 0xFFFF)
-        {
-            // Add an expected code for incoming SMS notifications
-            index = add_pending_message(handle, "+CMTI", &cmti_handler);
-            return SIM800_OK;
-        }
-        return SIM800_ERROR;
-    }
-    else
-    {
-        if (index != 0xFFFF)
-        {
-            // Remove the expected code for incoming SMS notifications
-            remove_expected_code(handle, index);
-            index = 0xFFFF;
-        }
-    }
-
-    return SIM800_OK;
+	return cached_query(handle, SIM800_Cache_Battery, battery, sizeof(*battery));
 }
 
 
 /**
- * @brief   Requests an SMS message from the SIM800 module.
+ * @brief   Retrieves the signal quality from the SIM800 module.
  *
- * This function sends an AT command to the SIM800 module to request an SMS message by its index.
+ * This function sends the "AT+CSQ" command unless the value is cached and not expired.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   sms_index: Index of the SMS message to request.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ * @param   *signal: Pointer to the SIM800_Signal_t structure to store the signal quality.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
  */
-SIM800_Status_t SIM800_RequestSMSMessage(SIM800_Handle_t *handle, uint32_t sms_index)
+SIM800_Status_t SIM800_GetSignalQuality(SIM800_Handle_t *handle, SIM800_Signal_t *signal)
 {
-    char cmd[strlen("AT+CMGR=") + 12];
-    char str_sms_index[10];
+    return cached_query(handle, SIM800_Cache_Signal, signal, sizeof(*signal));
+}
 
-    // Add an expected +CMGR code and associate it with the cmgr_handler function
-    uint8_t index = add_pending_message(handle, "+CMGR", &cmgr_handler);
 
-    // Prepare the AT command to request the SMS message
-    strcpy(cmd, "AT+CMGR=");
-    itoa(sms_index, str_sms_index, 10);
-    strcat(cmd, str_sms_index);
-    strcat(cmd, "\r\n");
+/**
+ * @brief   Manages the background sampling of the signal quality.
+ *
+ * SIM800_Poll submits "AT+CSQ" every period milliseconds when no other request is queued, so the sampling
+ * never blocks nor delays the application's commands. The latest SIM800_SIGNAL_SAMPLES samples are kept,
+ * see SIM800_GetSignalStats, and every sample refreshes the cached signal quality as well.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   period: Sampling period (ms), 0 - stop the sampling.
+ */
+void SIM800_ManageSignalSampling(SIM800_Handle_t *handle, uint32_t period)
+{
+    SIM800_SignalSampler_t *sampler = &handle->signalSampler;
 
-    // Send the command to request the SMS message
-    if (send_command(cmd) == SIM800_ERROR)
+    if (sampler->period == 0 && period != 0)
     {
-        remove_expected_code(handle, index);
-        return SIM800_ERROR;
+        // The first sample is taken right away
+        sampler->tick = HAL_GetTick() - period;
     }
-
-    return SIM800_OK;
+    sampler->period = period;
 }
 
 
 /**
- * @brief   Handles incoming messages from the SIM800 module.
- *
- * This function is responsible for processing incoming characters from the SIM800 module.
- * It collects received characters and checks for specific responses or expected codes.
- * If an "OK" or "ERROR" response is received, it appends the data to the expected code buffer,
- * sets the received status to SIM800_ReceivedStatus, and invokes the associated handler if available.
- * If a known expected code is received, it stores the data in the corresponding buffer and
- * sets the received status to SIM800_Received. It also invokes the associated handler if available.
- * If none of the expected codes match, it appends the received characters to the current expected code buffer.
- * The function is designed to work with asynchronous UART communication.
+ * @brief   Calculates the statistics of the latest signal samples.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   window: Count of the latest samples, 0 - all kept samples.
+ * @param   *stats: Pointer to the structure to store the statistics.
+ * @retval  SIM800_OK on success, SIM800_ERROR if no sample has been taken yet.
  */
-void SIM800_MessageHandler(SIM800_Handle_t *handle)
+SIM800_Status_t SIM800_GetSignalStats(SIM800_Handle_t *handle, uint8_t window, SIM800_SignalStats_t *stats)
 {
-    uint32_t counter = 0;
-    uint8_t flag = 1; // Flag to check if the first part of a response (e.g., +CODE) is received
-    size_t data_str_len;
+    const SIM800_SignalSampler_t *sampler = &handle->signalSampler;
+    uint32_t count = (sampler->head < SIM800_SIGNAL_SAMPLES) ? sampler->head : SIM800_SIGNAL_SAMPLES;
+    uint32_t sum = 0;
+    const SIM800_Signal_t *sample;
 
-    if (handle->rcvdByte != '\n')
+    if (window != 0 && window < count)
     {
-        // Store the received character in the buffer(if buffer is not full)
-        if (handle->rxCounter < RX_BUFFER_LENGTH)
-        {
-            handle->rxBuffer[handle->rxCounter] = handle->rcvdByte;
-            handle->rxCounter++;
-        }
-
-        // Continue receiving characters
-        HAL_UART_Receive_IT(SIM800_UART, (uint8_t *)&handle->rcvdByte, 1);
-        return;
+        count = window;
     }
 
-    // Append the newline character and terminate the buffer
-    handle->rxBuffer[handle->rxCounter] = handle->rcvdByte;
-    handle->rxCounter++;
-    handle->rxBuffer[handle->rxCounter] = '\0';
-
-    if (!strncmp(handle->rxBuffer, "OK", 2) || !strncmp(handle->rxBuffer, "ERROR", 2))
+    if (count == 0)
     {
-        // Check if the received response is "OK" or "ERROR"
-        data_str_len = strlen(handle->expected_codes[handle->curProccesPacket_index].data);
-
-        // Append the data to the expected code buffer
-        strncpy(&handle->expected_codes[handle->curProccesPacket_index].data[data_str_len],
-                handle->rxBuffer,
-                RECEIVE_DATA_MAX_LENGTH - data_str_len);
-
-        // Set the received status to SIM800_ReceivedStatus
-        handle->expected_codes[handle->curProccesPacket_index].state = SIM800_ReceivedStatus;
-
-        // Invoke the associated handler if available
-        if (handle->expected_codes[handle->curProccesPacket_index].handle != NULL)
-        {
-            handle->expected_codes[handle->curProccesPacket_index].handle(handle, handle->curProccesPacket_index);
-        }
+        return SIM800_ERROR;
     }
-    else
-    {
-        for (uint32_t i = 0; i < EXPECTED_CODES_MAX_COUNT; i++)
-        {
-            if (handle->expected_codes[i].state == SIM800_WaitingFor)
-            {
-                if (!strncmp(handle->rxBuffer, handle->expected_codes[i].code, handle->expected_codes[i].code_length))
-                {
-                    // Store the data in the corresponding buffer
-                    strcpy(handle->expected_codes[i].data, handle->rxBuffer);
 
-                    // Update the current processed packet index
-                    handle->curProccesPacket_index = i;
+    stats->count = count;
+    stats->unknown = 0;
+    stats->rssiMin = 99;
+    stats->rssiMax = 0;
+    stats->berMax = 0;
 
-                    // Set the received status to SIM800_Received
-                    handle->expected_codes[i].state = SIM800_Received;
-
-                    flag = 0;
-
-                    // Invoke the associated handler if available
-                    if (handle->expected_codes[i].handle != NULL)
-                    {
-                        handle->expected_codes[i].handle(handle, i);
-                    }
-                }
+    for (uint32_t i = 1; i <= count; i++)
+    {
+        sample = &sampler->samples[(sampler->head - i) & (SIM800_SIGNAL_SAMPLES - 1)];
 
-                counter++;
-                if (counter >= handle->expected_codes_count)
-                {
-                    break; // Exit the loop when all expected codes have been processed
-                }
-            }
+        if (sample->ber != 99 && sample->ber > stats->berMax)
+        {
+            stats->berMax = sample->ber;
         }
 
-        if (flag && handle->expected_codes[handle->curProccesPacket_index].state == SIM800_Received &&
-            strncmp(handle->expected_codes[handle->curProccesPacket_index].data, "\r\n", 2))
+        if (sample->rssi == 99)
         {
-            data_str_len = strlen(handle->expected_codes[handle->curProccesPacket_index].data);
-
-            // Append the received characters to the current expected code buffer
-            strncpy(&handle->expected_codes[handle->curProccesPacket_index].data[data_str_len],
-                    handle->rxBuffer,
-                    RECEIVE_DATA_MAX_LENGTH - data_str_len);
+            stats->unknown++;
+            continue;
         }
-    }
 
-    // Reset the receive counter
-    handle->rxCounter = 0;
+        sum += sample->rssi;
+        stats->rssiMin = (sample->rssi < stats->rssiMin) ? sample->rssi : stats->rssiMin;
+        stats->rssiMax = (sample->rssi > stats->rssiMax) ? sample->rssi : stats->rssiMax;
+    }
 
-    // If still in receive status, continue to receive characters
-    if (handle->recStatus == SIM800_Receives)
+    if (stats->unknown == count)
     {
-        HAL_UART_Receive_IT(SIM800_UART, (uint8_t *)&handle->rcvdByte, 1);
+        stats->rssiMax = 99;
+        stats->rssiMean = 99;
+        stats->berMax = 99;
+    }
+    else
+    {
+        stats->rssiMean = sum / (count - stats->unknown);
     }
-}
 
+    return SIM800_OK;
+}
 
-/*********************************************************************************************
- *										Static helpful functions
- ********************************************************************************************/
 
 /**
- * @brief   Adds an expected message code to the SIM800 module handler.
+ * @brief   Checks whether the signal is good enough to send.
  *
- * This function adds an expected message code to the list of codes that the SIM800 module handler should watch for.
- * It also allows specifying a custom message handler function that will be called when the expected code is received.
- * If the maximum number of expected codes is reached or if the provided code is too long, the function returns 0xFF,
- * indicating an error.
+ * The latest sample of the sampler (see SIM800_ManageSignalSampling) is checked against SIM800_SIGNAL_MIN_RSSI.
+ * Without sampling, or before the first sample, the signal is assumed to be usable.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   *code: Expected message code to watch for (e.g., "+CMGS").
- * @param   messageHandler: Custom message handler function to call upon receiving the expected code.
- * @retval  The index under which the code is added or 0xFF on error.
+ * @retval  1 if the signal is usable, 0 otherwise.
  */
-static uint8_t add_pending_message(SIM800_Handle_t *handle, char *code, void (*messageHandler)(void*, uint32_t))
+uint8_t SIM800_IsSignalUsable(SIM800_Handle_t *handle)
 {
-    size_t code_len = strlen(code);
+    const SIM800_SignalSampler_t *sampler = &handle->signalSampler;
+    const SIM800_Signal_t *last = &sampler->samples[(sampler->head - 1) & (SIM800_SIGNAL_SAMPLES - 1)];
 
-    if (code_len > CODE_MAX_LENGTH)
+    if (sampler->period == 0 || sampler->head == 0)
     {
-        return 0xFF; // Error: Code is too long
+        return 1;
     }
 
-    for (uint32_t i = 0; i < EXPECTED_CODES_MAX_COUNT; i++)
-    {
-        if (handle->expected_codes[i].state == SIM800_DoesntExpects)
-        {
-            // Store the code, its length, and the associated message handler (if any)
-            strcpy(handle->expected_codes[i].code, code);
-            handle->expected_codes[i].code_length = code_len;
-            handle->expected_codes[i].handle = messageHandler;
-            handle->expected_codes[i].state = SIM800_WaitingFor;
+    return last->rssi != 99 && last->rssi >= SIM800_SIGNAL_MIN_RSSI;
+}
 
-            // Increase the count of expected codes
-            handle->expected_codes_count++;
 
-            // Set the current processed packet index
-            handle->curProccesPacket_index = i;
+/**
+ * @brief   Retrieves the IMEI of the SIM800 module.
+ *
+ * This function sends the "AT+GSN" command unless the value is cached and not expired.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *imei: Buffer of SIM800_ID_LENGTH characters for the IMEI string.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_GetIMEI(SIM800_Handle_t *handle, char *imei)
+{
+    return cached_query(handle, SIM800_Cache_IMEI, imei, SIM800_ID_LENGTH);
+}
 
-            return i; // Return the index under which the code is added
-        }
-    }
 
-    return 0xFF; // Error: Maximum expected codes count reached
+/**
+ * @brief   Retrieves the ICCID of the SIM card.
+ *
+ * This function sends the "AT+CCID" command unless the value is cached and not expired.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *iccid: Buffer of SIM800_ID_LENGTH characters for the ICCID string.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_GetICCID(SIM800_Handle_t *handle, char *iccid)
+{
+    return cached_query(handle, SIM800_Cache_ICCID, iccid, SIM800_ID_LENGTH);
 }
 
 
 /**
- * @brief   Removes an expected message code from the SIM800 module handler.
+ * @brief   Retrieves the serving and the neighbour cells ("AT+CENG=3;+CENG?").
  *
- * This function removes an expected message code from the list of codes that the SIM800 module handler watches for.
- * It takes the index of the code to remove and clears the corresponding data structure.
- * Additionally, it decreases the count of expected codes.
+ * With the location notifications enabled (SIM800_ManageRegNotifications mode 2), the cells are cached until the
+ * serving cell reported by "+CREG" changes, SIM800_SetCacheTTL may limit their age further. Otherwise they are
+ * read on every call, as a change of the serving cell would not be seen.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   index: The index of the expected code to remove.
+ * @param   *info: Pointer to store the cells.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
  */
-static void remove_expected_code(SIM800_Handle_t *handle, uint8_t index)
+SIM800_Status_t SIM800_GetCellInfo(SIM800_Handle_t *handle, SIM800_CellInfo_t *info)
 {
-    memset(&handle->expected_codes[index], 0, sizeof(handle->expected_codes[index]));
-    handle->expected_codes_count--;
+    return cached_query(handle, SIM800_Cache_CellInfo, info, sizeof(*info));
 }
 
 
+#if SIM800_USE_HTTP
+
 /**
- * @brief   Sends an AT command to the SIM800 module.
+ * @brief   Retrieves the location of the module from the location service of the network ("AT+CLBS=1,1").
  *
- * This function sends an AT command to the SIM800 module via UART communication.
- * It takes the command string `cmd` and transmits it to the SIM800 module.
- * The function uses an asynchronous UART transmission and returns SIM800_OK on success
- * or SIM800_ERROR in case of a transmission failure.
+ * The service runs on the bearer of the HTTP client, which is opened if needed, see SIM800_HttpGet. The lookup
+ * takes seconds, so the location is cached like the cells, see SIM800_GetCellInfo.
  *
- * @param   *cmd: Pointer to the AT command string to be sent.
- * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @param   *location: Pointer to store the location.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure or if the service has no location, SIM800_TIMEOUT on timeout.
  */
-static SIM800_Status_t send_command(char *cmd)
+SIM800_Status_t SIM800_GetLocation(SIM800_Handle_t *handle, SIM800_Location_t *location)
 {
-    if (HAL_UART_Transmit_IT(SIM800_UART, (uint8_t *)cmd, strlen(cmd)) != HAL_OK)
+    SIM800_Status_t status;
+
+    if (cache_expired(handle, SIM800_Cache_Location) && (status = http_bearer(handle)) != SIM800_OK)
     {
-        return SIM800_ERROR;
+        return status;
     }
 
-    return SIM800_OK;
+    return cached_query(handle, SIM800_Cache_Location, location, sizeof(*location));
 }
 
+#endif /* SIM800_USE_HTTP */
+
 
 /**
- * @brief   Validates an AT command response message.
+ * @brief   Retrieves the status from the SIM800 module.
  *
- * This function validates an AT command response message received from the SIM800 module.
- * It checks if the response message contains the "OK" string, indicating a successful command execution.
+ * This function sends the "AT" command to the SIM800 module to check its status.
+ * It waits for a response and validates the received message.
  *
- * @param   *message: Pointer to the response message to be validated.
- * @retval  SIM800_OK if the message contains "OK," SIM800_ERROR otherwise.
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ * @return  Execution status. For details, refer to the SIM800_Status_t in the corresponding .h file.
  */
-static SIM800_Status_t validate_message(char *message)
+SIM800_Status_t SIM800_GetStatus(SIM800_Handle_t *handle)
 {
-    if (strstr(message, "OK"))
-    {
-        return SIM800_OK;
-    }
-
-    return SIM800_ERROR;
+	return execute_command(handle, SIM800_Cmd_Status, NULL, NULL, NULL);
 }
 
 
 /**
- * @brief   Waits for a specific state in the pending message.
+ * @brief   Executes an arbitrary AT command and extracts typed fields from its response line.
  *
- * This function waits for the specified state in the pending message associated with the given index.
- * It uses a timeout mechanism to prevent infinite waiting.
+ * The format is read once, before the command is sent, into a table of destinations; the response
+ * line starting with the code is then scanned in one pass by the field tokenizer, nothing is allocated.
+ * Conversions, one per comma separated field of the line:
+ *  - "%d": a number, stored to an int32_t *
+ *  - "%s": a string (quoted or not), stored to a char * followed by the size of the buffer (size_t)
+ *  - "%*": a field that is skipped
+ * Characters between the conversions are ignored, e.g. SIM800_Query(handle, "AT+CSQ", "+CSQ", "%d,%d", &rssi, &ber).
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   state: The expected state to wait for in the pending message.
- * @param   index: The index of the expected message code to check.
- * @retval  SIM800_OK if the expected state is reached, SIM800_TIMEOUT if the timeout is reached.
+ * @param   *command: Command line, with or without the leading "AT" (e.g. "AT+CSQ").
+ * @param   *code: Code of the response line (e.g. "+CSQ"), a constant string: it is not copied.
+ * @param   *format: Conversions of the fields, see above.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure or if the response does not match the format,
+ *          SIM800_TIMEOUT on timeout.
  */
-static SIM800_Status_t wait_for_state(SIM800_Handle_t *handle, SIM800_ExpectedCodeState_t state, uint8_t index)
+SIM800_Status_t SIM800_Query(SIM800_Handle_t *handle, const char *command, const char *code, const char *format, ...)
 {
-    uint32_t tickStart = HAL_GetTick();
+    query_t query = { .count = 0, .done = 0, .status = SIM800_ERROR };
+    SIM800_Status_t status;
+    va_list args;
+    uint8_t index;
 
-    while (handle->expected_codes[index].state != state)
+    if (code == NULL || *code == '\0')
     {
-        if (HAL_GetTick() - tickStart > SIM800_MAX_DELAY)
+        return SIM800_ERROR;
+    }
+
+    va_start(args, format);
+    for (; *format != '\0'; format++)
+    {
+        if (*format != '%')
         {
-            return SIM800_TIMEOUT;
+            continue;
+        }
+
+        if (query.count == SIM800_QUERY_MAX_FIELDS)
+        {
+            va_end(args);
+            return SIM800_ERROR;
+        }
+
+        query_field_t *field = &query.fields[query.count++];
+
+        field->type = *++format;
+        field->value = NULL;
+        field->size = 0;
+
+        if (field->type == 'd')
+        {
+            field->value = va_arg(args, int32_t *);
+        }
+        else if (field->type == 's')
+        {
+            field->value = va_arg(args, char *);
+            field->size = va_arg(args, size_t);
+        }
+        else if (field->type != '*')
+        {
+            va_end(args);
+            return SIM800_ERROR;
         }
     }
+    va_end(args);
 
-    return SIM800_OK;
+    if ((command[0] == 'A' || command[0] == 'a') && (command[1] == 'T' || command[1] == 't'))
+    {
+        command += 2;
+    }
+
+    // The response line is taken by a temporary code, it hands the following lines back to the command
+    if ((index = add_pending_message(handle, code, &query_parser, &query, NULL)) == 0xFF)
+    {
+        return SIM800_ERROR;
+    }
+
+    status = execute_command(handle, SIM800_Cmd_Configure, command, NULL, NULL);
+
+    remove_expected_code(handle, index);
+
+    if (status != SIM800_OK)
+    {
+        return status;
+    }
+
+    return query.done ? query.status : SIM800_ERROR;
 }
 
+
 /**
- * @brief   Handles the +CMTI notification.
+ * @brief   Retrieves the network registration status from the SIM800 module.
  *
- * This function is called when a +CMTI notification is received from the SIM800 module.
- * It extracts the SMS index from the notification and triggers the corresponding callback function.
+ * This function sends the "AT+CREG?" command to the SIM800 module to query its network registration status.
+ * It waits for a response, validates the received message, and returns the network registration status.
+ *
+ * While the registration notifications are enabled (see SIM800_ManageRegNotifications), the status
+ * reported by the module is returned without sending any command.
  *
- * @param   *handle_ptr: Pointer to the SIM800 handle structure.
- * @param   msg_index: Index of the pending message associated with the +CMTI notification.
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_NetworkRegStatus_t enumeration value representing the network registration status.
+ * @return  Network registration status. For possible values, refer to the SIM800_NetworkRegStatus_t enumeration.
  */
-static void cmti_handler(void *handle_ptr, uint32_t msg_index)
+SIM800_NetworkRegStatus_t SIM800_GetNetworkRegStatus(SIM800_Handle_t *handle)
 {
-    /*
-     * +CMTI: <mem3>,<index>
-     */
-    SIM800_Handle_t *handle = (SIM800_Handle_t *)handle_ptr;
-    char *ptr;
-    uint32_t sms_index;
+	SIM800_NetworkRegStatus_t status;
 
-    ptr = strchr(handle->expected_codes[msg_index].data, ',');
-    sms_index = strtol(++ptr, NULL, 10);
+	if (handle->regNotifications != 0)
+	{
+		executor_poll(handle);
+		return handle->regStatus;
+	}
 
-    handle->expected_codes[msg_index].state = SIM800_WaitingFor;
+	if( execute_command(handle, SIM800_Cmd_NetworkReg, NULL, NULL, &status) != SIM800_OK )
+	{
+		return SIM800_FAIL;
+	}
 
-    SIM800_NewSMSNotificationCallBack(handle, sms_index);
+	return status;
 }
 
+
+#if SIM800_USE_SMS
+
 /**
- * @brief   Handles the +CMGR response.
+ * @brief   Sets the SMS text mode for the SIM800 module.
  *
- * This function is called when a +CMGR response is received from the SIM800 module.
- * It parses the response message and triggers the corresponding callback function for SMS handling.
+ * This function sends the "AT+CMGF=1" command to the SIM800 module to set it to SMS text mode.
+ * It then waits for the response and validates the received message.
  *
- * @param   *handle_ptr: Pointer to the SIM800 handle structure.
- * @param   msg_index: Index of the pending message associated with the +CMGR response.
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ * @return  Execution status. For details, refer to the SIM800_Status_t in the corresponding .h file.
  */
-static void cmgr_handler(void *handle_ptr, uint32_t msg_index)
+SIM800_Status_t SIM800_SetSMSTextMode(SIM800_Handle_t *handle)
 {
-    SIM800_Handle_t *handle = (SIM800_Handle_t *)handle_ptr;
-    SIM800_SMSMessage_t message = {0};
+    SIM800_Status_t status = execute_command(handle, SIM800_Cmd_SMSTextMode, NULL, NULL, NULL);
 
-    if (handle->expected_codes[msg_index].state != SIM800_ReceivedStatus)
+    if (status == SIM800_OK)
     {
-        return;
+        handle->smsPDU = 0;
     }
 
-    cmgr_parser(&message, handle->expected_codes[msg_index].data);
+    return status;
+}
 
-    SIM800_RcvdSMSCallBack(handle, &message);
+#endif /* SIM800_USE_SMS */
 
-    remove_expected_code(handle, msg_index);
-}
 
+#if SIM800_USE_PDU
 
 /**
- * @brief   Parses the +CBC response to obtain battery information.
+ * @brief   Sets the SMS PDU mode for the SIM800 module.
  *
- * This function is called when a +CBC response is received from the SIM800 module.
- * It extracts battery information, including charge status, connection level, and battery level.
+ * This function sends the "AT+CMGF=0" command. In PDU mode the received messages are decoded from their
+ * PDUs (see sim800_pdu.c), which carries the concatenation headers of long messages: their parts are
+ * reassembled and handed to SIM800_RcvdLongSMSCallBack.
  *
- * @param   *batt: Pointer to the SIM800_Battery_t structure to store the battery information.
- * @param   *message: The response message containing battery information.
- * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
  */
-static SIM800_Status_t cbc_parser(SIM800_Battery_t *batt, char *message)
+SIM800_Status_t SIM800_SetSMSPDUMode(SIM800_Handle_t *handle)
 {
-    /*
-     * +CBC: <bcs>,<bcl>,<voltage>
-     */
-    char *ptr;
+    SIM800_Status_t status = execute_command(handle, SIM800_Cmd_SMSPDUMode, NULL, NULL, NULL);
 
-    if (validate_message(message) == SIM800_ERROR)
-        return SIM800_ERROR;
+    if (status == SIM800_OK)
+    {
+        handle->smsPDU = 1;
+    }
+
+    return status;
+}
+
+#endif /* SIM800_USE_PDU */
 
-    ptr = strchr(message, ':');
-    batt->charge_status = strtol(++ptr, NULL, 10);
 
-    ptr = strchr(ptr, ',');
-    batt->conection_level = strtol(++ptr, NULL, 10);
+/**
+ * @brief   Sets the character set of the SIM800 module.
+ *
+ * This function sends the "AT+CSCS" command. With "UCS2" the texts of the library are UTF-8: the sent texts
+ * and numbers are converted to UCS2 hex while they are transmitted and the received ones are converted back
+ * as they arrive, without holding the hex strings in memory. The messages are then sent with the UCS2 coding
+ * ("AT+CSMP=...,8"), at most SMS_UCS2_MAX_LEN characters each.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *charset: Character set, e.g. "GSM", "IRA" or "UCS2".
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SetCharset(SIM800_Handle_t *handle, const char *charset)
+{
+    SIM800_Status_t status = execute_command(handle, SIM800_Cmd_Charset, charset, NULL, NULL);
+
+    if (status != SIM800_OK)
+    {
+        return status;
+    }
 
-    ptr = strchr(ptr, ',');
-    batt->battery_level = strtol(++ptr, NULL, 10);
+#if SIM800_USE_SMS
+    handle->smsUCS2 = (strcmp(charset, "UCS2") == 0);
 
+    return sms_params(handle);
+#else
     return SIM800_OK;
+#endif
 }
 
+
+#if SIM800_USE_PDU
+
 /**
- * @brief   Parses the +CMGR response to extract SMS message details.
+ * @brief   Sends an SMS message of any length, split into concatenated parts if needed.
  *
- * This function is called when a +CMGR response is received from the SIM800 module.
- * It extracts SMS message details, including sender information and the message body.
+ * A text of up to 160 GSM 7-bit characters is sent as one message, a longer one as parts of up to 153
+ * characters with a concatenation header. Every part is encoded into one PDU straight from the caller's
+ * text and sent in hex on the "> " prompt, the text is never copied as a whole. In text mode the module
+ * is switched to PDU mode for the sending and back afterwards. Characters the GSM 7-bit alphabet has not
+ * are sent as '?'.
  *
- * @param   *sms_message: Pointer to the SIM800_SMSMessage_t structure to store the SMS message details.
- * @param   *message: The response message containing SMS message details.
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *destination: Destination phone number.
+ * @param   *text: SMS message to be sent.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
  */
-static void cmgr_parser(SIM800_SMSMessage_t *sms_message, char *message)
+SIM800_Status_t SIM800_SendLongSMSMessage(SIM800_Handle_t *handle, const char *destination, const char *text)
 {
-    /*
-     *  +CMGR: "REC UNREAD","+8613918186089","","02/01/30,20:40:31+00"
-     *	This is a test
-     *	OK
-     */
-    char *ptr1, *ptr2;
-    size_t len;
+    blocking_result_t result;
+    SIM800_RequestOptions_t options;
+    SIM800_PDUConcat_t concat = { 0, 1, 1 };
+    SIM800_Request_t *req;
+    SIM800_Status_t status = SIM800_OK, mode;
+    uint8_t pdu[SIM800_PDU_MAX_OCTETS];
+    uint16_t length = strlen(text), offset = 0, part, pdu_length;
+    uint8_t reference, text_mode = !handle->smsPDU;
+
+    if (SIM800_PDU_Septets(text, length) > SIM800_PDU_SINGLE_SEPTETS)
+    {
+        // Count the parts first, every header carries the total
+        concat.count = 0;
+        for (uint16_t i = 0; i < length; i += SIM800_PDU_Split(&text[i], length - i, SIM800_PDU_PART_SEPTETS))
+        {
+            concat.count++;
+        }
+        concat.reference = handle->smsConcatRef++;
+    }
 
-    if (validate_message(message) == SIM800_ERROR)
-        return;
+    if (text_mode && (status = SIM800_SetSMSPDUMode(handle)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    do
+    {
+        part = (concat.count > 1) ? SIM800_PDU_Split(&text[offset], length - offset, SIM800_PDU_PART_SEPTETS) : length;
 
-    ptr1 = strchr(message, '+');
-    ptr1 = strchr(++ptr1, '+');
+        if ((pdu_length = SIM800_PDU_EncodeSubmit(pdu, destination, &text[offset], part,
+                                                  concat.count > 1 ? &concat : NULL, handle->smsReports != 0)) == 0)
+        {
+            status = SIM800_ERROR;
+            break;
+        }
 
-    ptr2 = strchr(ptr1, '"');
-    ptr2--;
+        result.status = SIM800_ERROR;
+        result.done = 0;
 
-    len = ptr2 - ptr1;
+        if ((req = claim_request(handle, SIM800_Cmd_SendPDU, NULL, (const char *)pdu, &reference, &blocking_done, &result,
+                                 take_options(handle, &options))) == NULL)
+        {
+            status = SIM800_ERROR;
+            break;
+        }
 
-    strncpy(sms_message->sender, ptr1, len+1);
+        // The length of the TPDU, the service centre address is not counted
+        uint_to_str(pdu_length - 1, req->number);
+        req->arg = req->number;
+        req->dataHex = pdu_length;
+        commit_request(handle);
 
-    ptr1 = strchr(message, '\n');
-    ptr1++;
+        if ((status = wait_for_request(handle, &result)) != SIM800_OK)
+        {
+            break;
+        }
 
-    ptr2 = strchr(ptr1, '\n');
+        offset += part;
+        concat.index++;
+    } while (offset < length);
 
-    len = ptr2 - ptr1 - 1;
+    if (text_mode && (mode = SIM800_SetSMSTextMode(handle)) != SIM800_OK && status == SIM800_OK)
+    {
+        status = mode;
+    }
 
-    strncpy(sms_message->text, ptr1, len);
+    return status;
 }
 
+#endif /* SIM800_USE_PDU */
 
-/*********************************************************************************************
- *										Callback functions
- ********************************************************************************************/
+
+#if SIM800_USE_SMS
 
 /**
- * @brief   User-defined callback for handling new SMS notifications.
+ * @brief   Deletes all SMS messages from the SIM800 module.
  *
- * This function is called when a new SMS notification is received from the SIM800 module.
- * You can override this function to define custom behavior when new SMS notifications arrive.
+ * This function sends the "AT+CMGD=1,4" command to the SIM800 module to delete all SMS messages stored on it.
+ * It waits for a response, validates the received message, and returns the status.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   sms_index: Index of the new SMS notification.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ * @return  Execution status. For details, refer to the SIM800_Status_t enumeration.
  */
-__weak void SIM800_NewSMSNotificationCallBack(SIM800_Handle_t *handle, uint32_t sms_index)
+SIM800_Status_t SIM800_DeleteAllSMSMessages(SIM800_Handle_t *handle)
 {
-    // Your custom code for handling new SMS notifications can be added here.
+	return execute_command(handle, SIM800_Cmd_DeleteAllSMS, NULL, NULL, NULL);
 }
 
 
 /**
- * @brief   User-defined callback for handling received SMS messages.
+ * @brief   Sends an SMS message via the SIM800 module.
  *
- * This function is called when a new SMS message is successfully received and parsed.
- * You can override this function to define custom behavior for processing received SMS messages.
+ * This function sends an SMS message to the specified destination number using the SIM800 module.
+ * It sends the "AT+CMGS" command with the destination, then the message terminated by Ctrl+Z,
+ * and waits for a response.
  *
  * @param   *handle: Pointer to the SIM800 handle structure.
- * @param   *message: Pointer to the parsed SMS message details.
+ * @param   *destination: Destination phone number.
+ * @param   *message: SMS message to be sent.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ * @return  Execution status. For details, refer to the SIM800_Status_t enumeration.
  */
-__weak void SIM800_RcvdSMSCallBack(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message)
+SIM800_Status_t SIM800_SendSMSMessage(SIM800_Handle_t *handle, char *destination, char *message)
 {
-    // Your custom code for handling received SMS messages can be added here.
+    return SIM800_SendSMSMessageRef(handle, destination, message, NULL);
+}
+
+
+/**
+ * @brief   Sends an SMS message and returns its message reference.
+ *
+ * The reference is the number the module answers with ("+CMGS: <mr>"), the delivery report of the message
+ * carries the same number (see SIM800_ManageDeliveryReports).
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *destination: Destination phone number.
+ * @param   *message: SMS message to be sent.
+ * @param   *reference: Pointer to the message reference, may be NULL.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SendSMSMessageRef(SIM800_Handle_t *handle, const char *destination, const char *message,
+                                         uint8_t *reference)
+{
+    uint8_t mr;
+
+    if (strlen(destination) > (SMS_TX_MAX_LEN - 3) || !sms_text_fits(handle, message))
+    {
+        return SIM800_ERROR;
+    }
+
+    return execute_command(handle, SIM800_Cmd_SendSMS, destination, message, reference != NULL ? reference : &mr);
+}
+
+
+/**
+ * @brief   Encodes the constant parts of a message with one variable field, see SIM800_SubmitSMSTemplate.
+ *
+ * The message is the prefix, the field of fieldLength characters and the suffix. In text mode the prefix and the
+ * suffix are sent straight from the caller's strings, in PDU mode the whole message is packed into the template
+ * here, so a send only writes the septets of the field. The strings must stay unchanged while the template is
+ * used, e.g. string literals in flash. E.g., SIM800_PrepareSMSTemplate(&tpl, "+79991234567", "Alarm: zone ", 4, " open").
+ *
+ * @param   *tpl: Pointer to the template structure.
+ * @param   *destination: Destination phone number.
+ * @param   *prefix: Constant text before the field.
+ * @param   fieldLength: Characters of the field, at most SIM800_SMS_TEMPLATE_FIELD.
+ * @param   *suffix: Constant text after the field.
+ * @retval  SIM800_OK on success, SIM800_ERROR if a string is too long.
+ */
+SIM800_Status_t SIM800_PrepareSMSTemplate(SIM800_SMSTemplate_t *tpl, const char *destination, const char *prefix,
+                                          uint8_t fieldLength, const char *suffix)
+{
+    uint16_t prefixLength = strlen(prefix), suffixLength = strlen(suffix);
+    uint16_t length = prefixLength + fieldLength + suffixLength;
+#if SIM800_USE_PDU
+    char text[SMS_TX_MAX_LEN];
+#endif
+
+    if (fieldLength > SIM800_SMS_TEMPLATE_FIELD || strlen(destination) > (SMS_TX_MAX_LEN - 3) ||
+        length > (SMS_TX_MAX_LEN - 3))
+    {
+        return SIM800_ERROR;
+    }
+
+    tpl->destination = destination;
+    memset(tpl->field, ' ', fieldLength);
+    tpl->fieldLength = fieldLength;
+    tpl->text[0].data = (const uint8_t *)prefix;
+    tpl->text[0].length = prefixLength;
+    tpl->text[1].data = (const uint8_t *)tpl->field;
+    tpl->text[1].length = fieldLength;
+    tpl->text[2].data = (const uint8_t *)suffix;
+    tpl->text[2].length = suffixLength;
+    tpl->busy = 0;
+
+#if SIM800_USE_PDU
+    memcpy(text, prefix, prefixLength);
+    memset(&text[prefixLength], ' ', fieldLength);
+    memcpy(&text[prefixLength + fieldLength], suffix, suffixLength);
+
+    // The user data ends the PDU, the field starts behind the septets of the prefix
+    tpl->pduLength = SIM800_PDU_EncodeSubmit(tpl->pdu, destination, text, length, NULL, 0);
+    tpl->fieldBit = 8u * (tpl->pduLength - (7u * SIM800_PDU_Septets(text, length) + 7) / 8) +
+                    7u * SIM800_PDU_Septets(prefix, prefixLength);
+#endif
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Sends a message of a template, see SIM800_SubmitSMSTemplate.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *tpl: Pointer to the template structure, see SIM800_PrepareSMSTemplate.
+ * @param   *field: Text of the field, cut or padded with spaces to its length.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SendSMSTemplate(SIM800_Handle_t *handle, SIM800_SMSTemplate_t *tpl, const char *field)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitSMSTemplate(handle, tpl, field, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Sends one SMS message to several recipients.
+ *
+ * The function returns without waiting. The messages are submitted by SIM800_Poll so that the next "AT+CMGS"
+ * is queued while the previous one is executed: the module gets the next command line as soon as the
+ * previous +CMGS arrives. At most SIM800_SMS_BATCH_INFLIGHT messages are queued at a time, so the batch does
+ * not take the whole request queue. The text is shared by all recipients and is sent as is.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *recipients: Destination phone numbers, must stay unchanged until the batch is finished.
+ * @param   count: Count of recipients.
+ * @param   *text: SMS message to be sent, must stay unchanged until the batch is finished.
+ * @param   result: Callback invoked once per recipient, may be NULL.
+ * @param   *ctx: Argument of the callback.
+ * @retval  SIM800_OK if the batch is started, SIM800_ERROR if a batch is in progress or a string is too long.
+ */
+SIM800_Status_t SIM800_SendSMSBatch(SIM800_Handle_t *handle, const char *const *recipients, uint16_t count,
+                                    const char *text, SIM800_SMSBatchCallback_t result, void *ctx)
+{
+    SIM800_SMSBatch_t *batch = &handle->smsBatch;
+
+    if (batch->count != 0 || count == 0 || !sms_text_fits(handle, text))
+    {
+        return SIM800_ERROR;
+    }
+
+    // Check every recipient now, so a failed submission later only means a full queue
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (strlen(recipients[i]) > (SMS_TX_MAX_LEN - 3))
+            return SIM800_ERROR;
+    }
+
+    batch->recipients = recipients;
+    batch->next = 0;
+    batch->finished = 0;
+    batch->text = text;
+    batch->result = result;
+    batch->ctx = ctx;
+    batch->count = count;
+
+    sms_batch_fill(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Queues an SMS message in the priority scheduler.
+ *
+ * The function returns without waiting. SIM800_Poll submits the waiting messages of the highest priority
+ * class first, the oldest first within a class, as long as the rate limits allow (see SIM800_SetSMSRateLimit):
+ * one bucket for the module and one for each destination, so a destination at its limit does not hold back
+ * the messages to the others. Only the scheduled messages count against the limits.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *destination: Destination phone number, must stay unchanged until completion.
+ * @param   *text: SMS message to be sent, must stay unchanged until completion.
+ * @param   priority: Priority class of the message.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the message is queued, SIM800_ERROR if the scheduler is full or a string is too long.
+ */
+SIM800_Status_t SIM800_QueueSMS(SIM800_Handle_t *handle, const char *destination, const char *text,
+                                SIM800_SMSPriority_t priority, SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_SMSScheduler_t *sched = &handle->smsSched;
+    SIM800_SMSJob_t *job = NULL;
+    size_t length = strlen(destination);
+
+    if (priority >= SIM800_SMSPriority_Count || length > (SMS_TX_MAX_LEN - 3) || !sms_text_fits(handle, text))
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < SIM800_SMS_SCHED_LENGTH && job == NULL; i++)
+    {
+        if (sched->jobs[i].destination == NULL)
+        {
+            job = &sched->jobs[i];
+        }
+    }
+
+    if (job == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (!sched->configured)
+    {
+        SIM800_SetSMSRateLimit(handle, NULL);
+    }
+
+    job->text = text;
+    job->key = code_hash(destination, length);
+    job->order = sched->order++;
+    job->priority = priority;
+    job->done = done;
+    job->ctx = ctx;
+    job->destination = destination;
+
+    sms_sched_fill(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Sets the rate limits of the SMS scheduler, see SIM800_QueueSMS.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *limit: Pointer to the limits, NULL - the defaults (SIM800_SMS_RATE_BURST, SIM800_SMS_RATE_PERIOD,
+ *                  SIM800_SMS_DEST_BURST and SIM800_SMS_DEST_PERIOD).
+ */
+void SIM800_SetSMSRateLimit(SIM800_Handle_t *handle, const SIM800_SMSRateLimit_t *limit)
+{
+    SIM800_SMSScheduler_t *sched = &handle->smsSched;
+
+    if (limit != NULL)
+    {
+        sched->limit = *limit;
+    }
+    else
+    {
+        sched->limit.burst = SIM800_SMS_RATE_BURST;
+        sched->limit.period = SIM800_SMS_RATE_PERIOD;
+        sched->limit.destBurst = SIM800_SMS_DEST_BURST;
+        sched->limit.destPeriod = SIM800_SMS_DEST_PERIOD;
+    }
+
+    sched->configured = 1;
+}
+
+
+/**
+ * @brief   Manages the SMS delivery reports.
+ *
+ * When enabled, the sent messages request a status report ("AT+CSMP=49,...") and the module forwards the
+ * reports by +CDS notifications ("AT+CNMI=...,0,1"). Every sent message is tracked by its reference until
+ * its report arrives, then SIM800_SMSDeliveryCallBack is called with the time since its submission.
+ * At most SIM800_SMS_REPORTS_MAX messages are tracked, the oldest one is dropped for a new one.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE to request the delivery reports, DISABLE to stop.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageDeliveryReports(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    SIM800_Status_t status;
+    uint8_t index;
+
+    if (enordi == ENABLE)
+    {
+        if (handle->smsReports == 0)
+        {
+            // Add an expected code for the reports before the module starts sending them
+            if ((index = add_pending_message(handle, "+CDS", &cds_parser, NULL, NULL)) == 0xFF)
+            {
+                return SIM800_ERROR;
+            }
+            handle->smsReports = index + 1;
+        }
+
+        if ((status = sms_params(handle)) != SIM800_OK)
+        {
+            return status;
+        }
+
+        return sms_indication(handle);
+    }
+
+    if (handle->smsReports != 0)
+    {
+        remove_expected_code(handle, handle->smsReports - 1);
+        handle->smsReports = 0;
+    }
+    memset(handle->reports, 0, sizeof(handle->reports));
+
+    if ((status = sms_params(handle)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    return sms_indication(handle);
+}
+
+
+/**
+ * @brief   Manages SMS notifications from the SIM800 module.
+ *
+ * This function enables or disables the reception and handling of SMS notifications from the SIM800 module.
+ * When enabled, it adds an expected code for incoming SMS notifications to the pending messages.
+ * When disabled, it removes the expected code.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE to enable SMS notifications, DISABLE to disable SMS notifications.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ * @return  Execution status. For details, refer to the SIM800_Status_t enumeration.
+ */
+SIM800_Status_t SIM800_ManageSMSNotifications(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    uint8_t index;
+
+    if (enordi == ENABLE)
+    {
+        if (handle->smsNotifications == 0)
+        {
+            // Add an expected code for incoming SMS notifications
+            if ((index = add_pending_message(handle, "+CMTI", &cmti_parser, NULL, NULL)) == 0xFF)
+            {
+                return SIM800_ERROR;
+            }
+            handle->smsNotifications = index + 1;
+            return SIM800_OK;
+        }
+        return SIM800_ERROR;
+    }
+    else
+    {
+        if (handle->smsNotifications != 0)
+        {
+            // Remove the expected code for incoming SMS notifications
+            remove_expected_code(handle, handle->smsNotifications - 1);
+            handle->smsNotifications = 0;
+        }
+    }
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+/**
+ * @brief   Manages the network registration notifications of the SIM800 module.
+ *
+ * When enabled, the module reports every change of the registration with an unsolicited +CREG line
+ * ("AT+CREG=1", or "AT+CREG=2" to report the location area code and the cell ID as well). The status is kept
+ * in handle->regStatus, so SIM800_GetNetworkRegStatus returns it without a command round trip, and
+ * SIM800_NetworkRegCallBack is invoked whenever it changes. The status is queried once when enabled.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   mode: 1 - report the status, 2 - report the status and the location, DISABLE - stop the notifications.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageRegNotifications(SIM800_Handle_t *handle, uint8_t mode)
+{
+    SIM800_NetworkRegStatus_t status;
+    SIM800_Status_t result;
+    uint8_t index;
+
+    if (mode > 2)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (mode == DISABLE)
+    {
+        if (handle->regNotifications != 0)
+        {
+            remove_expected_code(handle, handle->regNotifications - 1);
+            handle->regNotifications = 0;
+        }
+        handle->regLac = 0;
+        handle->regCellId = 0;
+        return execute_command(handle, SIM800_Cmd_RegNotify, "0", NULL, NULL);
+    }
+
+    if ((result = execute_command(handle, SIM800_Cmd_RegNotify, mode == 2 ? "2" : "1", NULL, NULL)) != SIM800_OK)
+    {
+        return result;
+    }
+
+    if (handle->regNotifications == 0)
+    {
+        // Add an expected code for the registration notifications
+        if ((index = add_pending_message(handle, "+CREG", &creg_urc_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        handle->regNotifications = index + 1;
+    }
+
+    // Seed the cache, a change reported meanwhile is applied in order
+    handle->regStatus = SIM800_Registration_Unknown;
+    return execute_command(handle, SIM800_Cmd_NetworkReg, NULL, NULL, &status);
+}
+
+
+#if SIM800_USE_REG_CACHE
+/**
+ * @brief   Sets the operator and the band selected when the module has just been powered on.
+ *
+ * Call it before SIM800_Init with the value the application has kept from SIM800_RegCacheCallBack (e.g. in
+ * the flash or the backup registers of the MCU). If the module is not registered yet, SIM800_Init submits
+ * "AT+CBAND=<band>" and "AT+COPS=4,2,<plmn>": the module registers on that operator without a full scan,
+ * and selects the operator automatically if it cannot (mode 4). All bands are selected again ("ALL_BAND")
+ * if the module is not registered within SIM800_REG_FALLBACK. Every registration reads the operator ("AT+COPS?") and the band
+ * ("AT+CBAND?") back from SIM800_Poll, a change is given to SIM800_RegCacheCallBack.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *cache: Pointer to the operator and the band, NULL - the module scans as usual.
+ */
+void SIM800_SetRegCache(SIM800_Handle_t *handle, const SIM800_RegCache_t *cache)
+{
+    if (cache != NULL)
+    {
+        handle->regCache.cache = *cache;
+        handle->regCache.cache.plmn[SIM800_PLMN_LENGTH - 1] = '\0';
+        handle->regCache.cache.band[SIM800_BAND_LENGTH - 1] = '\0';
+    }
+    else
+    {
+        memset(&handle->regCache.cache, 0, sizeof(handle->regCache.cache));
+    }
+}
+
+
+/**
+ * @brief   Gives the time the module took to register after SIM800_Init.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *cached: Pointer to store 1 if the cached operator was selected, may be NULL.
+ * @retval  Time from the start of SIM800_Init to the registration (ms), 0 while not registered.
+ */
+uint32_t SIM800_GetRegTime(SIM800_Handle_t *handle, uint8_t *cached)
+{
+    if (cached != NULL)
+    {
+        *cached = handle->regCache.cached;
+    }
+
+    return handle->regCache.time;
+}
+#endif /* SIM800_USE_REG_CACHE */
+
+
+/**
+ * @brief   Enables or disables the synchronisation of the time with the network (NITZ).
+ *
+ * The module is asked to report the network time ("AT+CLTS=1"), which the network sends on registration as
+ * "*PSUTTZ" and "DST" notifications. The time is kept in the handle, so SIM800_GetTime reads it without a
+ * command round trip, and SIM800_NetworkTimeCallBack is invoked whenever it is received, e.g. to set the RTC
+ * of the MCU. If the clock of the module has already been set by the network, it is read once ("AT+CCLK?").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE or DISABLE.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageNetworkTime(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    SIM800_Time_t time = { 0 };
+    SIM800_Status_t result;
+    uint32_t seconds;
+    uint8_t index;
+
+    if (enordi == DISABLE)
+    {
+        if (handle->time.zoneCode != 0)
+        {
+            remove_expected_code(handle, handle->time.zoneCode - 1);
+            remove_expected_code(handle, handle->time.dstCode - 1);
+            handle->time.zoneCode = 0;
+            handle->time.dstCode = 0;
+        }
+        return execute_command(handle, SIM800_Cmd_NetworkTime, "0", NULL, NULL);
+    }
+
+    if ((result = execute_command(handle, SIM800_Cmd_NetworkTime, "1", NULL, NULL)) != SIM800_OK)
+    {
+        return result;
+    }
+
+    if (handle->time.zoneCode == 0)
+    {
+        // Add the expected codes for the network time notifications
+        if ((index = add_pending_message(handle, "*PSUTTZ", &psuttz_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        handle->time.zoneCode = index + 1;
+
+        if ((index = add_pending_message(handle, "DST", &dst_parser, NULL, NULL)) == 0xFF)
+        {
+            remove_expected_code(handle, handle->time.zoneCode - 1);
+            handle->time.zoneCode = 0;
+            return SIM800_ERROR;
+        }
+        handle->time.dstCode = index + 1;
+    }
+
+    // The clock of the module runs from a default date until the network has set it
+    if (!handle->time.valid && execute_command(handle, SIM800_Cmd_Clock, NULL, NULL, &time) == SIM800_OK &&
+        time.year >= SIM800_TIME_MIN_YEAR && time_to_seconds(&time, &seconds))
+    {
+        clock_set(handle, seconds, time.zone);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Gives the current local time of the network.
+ *
+ * The time is computed from the last network time and the ticks elapsed since, no command is sent.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *time: Pointer to store the time.
+ * @retval  SIM800_OK on success, SIM800_ERROR if no network time has been received, see SIM800_ManageNetworkTime.
+ */
+SIM800_Status_t SIM800_GetTime(SIM800_Handle_t *handle, SIM800_Time_t *time)
+{
+    uint32_t elapsed;
+
+    if (!handle->time.valid)
+    {
+        return SIM800_ERROR;
+    }
+
+    // Move the base forward by whole seconds, so it never lags by more than a tick wrap
+    elapsed = (HAL_GetTick() - handle->time.tick) / 1000;
+    handle->time.seconds += elapsed;
+    handle->time.tick += elapsed * 1000;
+
+    seconds_to_time(handle->time.seconds, handle->time.zone, time);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Manages the reporting of the incoming voice calls.
+ *
+ * With the caller ID enabled ("AT+CLIP=1") the module follows every "RING" of an incoming call with "+CLIP" and
+ * the number of the caller. SIM800_IncomingCallCallBack is invoked once per call, on its first "+CLIP", from
+ * SIM800_Poll. In the reject mode the call is hung up ("ATH") right from the parser, so the caller sees a
+ * rejected call within a second; missed calls of known numbers make triggers that cost nothing.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   mode: Handling of the calls, see SIM800_CallMode_t.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageCalls(SIM800_Handle_t *handle, SIM800_CallMode_t mode)
+{
+    SIM800_Call_t *call = &handle->call;
+    SIM800_Status_t status;
+    uint8_t index;
+
+    if (mode > SIM800_Calls_Reject)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (mode == SIM800_Calls_Off)
+    {
+        if (call->ringCode != 0)
+        {
+            remove_expected_code(handle, call->ringCode - 1);
+            call->ringCode = 0;
+        }
+        if (call->clipCode != 0)
+        {
+            remove_expected_code(handle, call->clipCode - 1);
+            call->clipCode = 0;
+        }
+        call->mode = SIM800_Calls_Off;
+        call->ringing = 0;
+        return execute_command(handle, SIM800_Cmd_CallerID, "0", NULL, NULL);
+    }
+
+    if ((status = execute_command(handle, SIM800_Cmd_CallerID, "1", NULL, NULL)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    if (call->ringCode == 0)
+    {
+        if ((index = add_pending_message(handle, "RING", &ring_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        call->ringCode = index + 1;
+    }
+
+    if (call->clipCode == 0)
+    {
+        if ((index = add_pending_message(handle, "+CLIP", &clip_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        call->clipCode = index + 1;
+    }
+
+    call->mode = mode;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Hangs up the ringing or the active voice call ("ATH").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_HangUp(SIM800_Handle_t *handle)
+{
+    SIM800_Status_t status = execute_command(handle, SIM800_Cmd_HangUp, NULL, NULL, NULL);
+
+    if (status == SIM800_OK)
+    {
+        handle->call.ringing = 0;
+    }
+
+    return status;
+}
+
+
+#if SIM800_USE_GNSS
+
+/**
+ * @brief   Powers the GNSS receiver of a SIM808/SIM868 on or off ("AT+CGNSPWR").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE(1) to power the receiver on, DISABLE(0) to power it off.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure (e.g. a SIM800 without a receiver), SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageGNSS(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    SIM800_Status_t status = execute_command(handle, SIM800_Cmd_GNSSPower, enordi == ENABLE ? "1" : "0", NULL, NULL);
+
+    if (status == SIM800_OK)
+    {
+        handle->gnss.power = (enordi == ENABLE);
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Manages the position stream of the GNSS receiver ("AT+CGNSURC").
+ *
+ * The receiver computes a position every second; the module reports every period-th one with "+UGNSINF", in
+ * the format of "AT+CGNSINF". Every report is parsed straight from the receive ring into handle->gnss.fix,
+ * then SIM800_GNSSCallBack and the subscribers of SIM800_EVT_GNSS get it from SIM800_Poll. Power the receiver
+ * on first, see SIM800_ManageGNSS.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   period: Positions per report, 0 to stop the stream.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageGNSSStream(SIM800_Handle_t *handle, uint8_t period)
+{
+    SIM800_GNSS_t *gnss = &handle->gnss;
+    SIM800_Status_t status;
+    char arg[4];
+    uint8_t index;
+
+    if (period != 0 && gnss->urcCode == 0)
+    {
+        if ((index = add_pending_message(handle, "+UGNSINF", &ugnsinf_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        gnss->urcCode = index + 1;
+    }
+
+    uint_to_str(period, arg);
+    status = execute_command(handle, SIM800_Cmd_GNSSReport, arg, NULL, NULL);
+
+    if (status == SIM800_OK)
+    {
+        gnss->period = period;
+    }
+
+    // A stopped stream frees its code, a failed start too
+    if ((period == 0 || gnss->period == 0) && gnss->urcCode != 0)
+    {
+        remove_expected_code(handle, gnss->urcCode - 1);
+        gnss->urcCode = 0;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Reads the last position reported by the stream, see SIM800_ManageGNSSStream.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *fix: Pointer to store the position.
+ * @retval  SIM800_OK if the position is fixed, SIM800_ERROR if no fixed position has been reported yet.
+ */
+SIM800_Status_t SIM800_GetGNSSFix(SIM800_Handle_t *handle, SIM800_GNSSFix_t *fix)
+{
+    *fix = handle->gnss.fix;
+
+    return fix->fix ? SIM800_OK : SIM800_ERROR;
+}
+
+#endif /* SIM800_USE_GNSS */
+
+
+/**
+ * @brief   Sends a USSD query (e.g., "*100#" of the balance) without waiting for its response.
+ *
+ * "AT+CUSD=1" is answered with "OK" at once, the response of the network follows seconds later as a "+CUSD"
+ * notification. Once it is received (decoded from UCS2 if its data coding scheme says so), or after
+ * SIM800_USSD_TIMEOUT, SIM800_Poll invokes the callback. The first amount of the response text is kept as the
+ * balance, see SIM800_GetBalance. One query is in progress at a time; the reply to a menu of the network
+ * (response status 1) is the next query, sent from the callback.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *code: USSD string, e.g. "*100#", valid until the callback is invoked.
+ * @param   callback: Callback invoked with the response, may be NULL.
+ * @param   *ctx: Argument of the callback.
+ * @retval  SIM800_OK if the query is submitted, SIM800_ERROR if a query is in progress or the request queue is full.
+ */
+SIM800_Status_t SIM800_SendUSSD(SIM800_Handle_t *handle, const char *code, SIM800_USSDCallback_t callback, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SendUSSDEx(handle, code, callback, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SendUSSD, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *code: USSD string, e.g. "*100#", valid until the callback is invoked.
+ * @param   callback: Callback invoked with the response, may be NULL.
+ * @param   *ctx: Argument of the callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the query is submitted, SIM800_ERROR if a query is in progress or the request queue is full.
+ */
+SIM800_Status_t SIM800_SendUSSDEx(SIM800_Handle_t *handle, const char *code, SIM800_USSDCallback_t callback, void *ctx,
+                                  const SIM800_RequestOptions_t *options)
+{
+    SIM800_USSDSession_t *ussd = &handle->ussd;
+    uint8_t index;
+
+    if (code == NULL || claim_request(handle, SIM800_Cmd_USSD, code, NULL, NULL, &ussd_sent, NULL, options) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The state is tested with the slot claimed, so two tasks never start a query each
+    if (ussd->state != 0)
+    {
+        release_request(handle);
+        return SIM800_ERROR;
+    }
+
+    // The code stays registered, so the responses the network sends on its own are parsed as well
+    if (ussd->code == 0)
+    {
+        if ((index = add_pending_message(handle, "+CUSD", &cusd_parser, NULL, NULL)) == 0xFF)
+        {
+            release_request(handle);
+            return SIM800_ERROR;
+        }
+        ussd->code = index + 1;
+    }
+
+    ussd->state = 1;
+    ussd->tick = HAL_GetTick();
+    ussd->callback = callback;
+    ussd->ctx = ctx;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Reads the last balance parsed from the response of SIM800_SendUSSD, no command is sent.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *balance: Pointer to store the balance, its tick and network time tell how old it is.
+ * @retval  SIM800_OK on success, SIM800_ERROR if no balance has been parsed yet.
+ */
+SIM800_Status_t SIM800_GetBalance(SIM800_Handle_t *handle, SIM800_Balance_t *balance)
+{
+    if (!handle->ussd.balance.valid)
+    {
+        return SIM800_ERROR;
+    }
+
+    *balance = handle->ussd.balance;
+
+    return SIM800_OK;
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Deletes a stored SMS message.
+ *
+ * The function returns without waiting. The deletions are collected and sent by SIM800_Poll as one
+ * command line ("AT+CMGD=3;+CMGD=4") once no other request is queued. If more messages are waiting than
+ * SIM800_SMS_DELETE_BATCH, all read messages are deleted instead ("AT+CMGD=1,1"), the unread ones are kept.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   sms_index: Storage index of the message.
+ * @retval  SIM800_OK if the deletion is queued, SIM800_ERROR if the index is invalid.
+ */
+SIM800_Status_t SIM800_DeleteSMSMessage(SIM800_Handle_t *handle, uint32_t sms_index)
+{
+    if (sms_index == 0 || sms_index > 999)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < handle->smsDeleteCount; i++)
+    {
+        if (handle->smsDeletes[i] == sms_index)
+        {
+            return SIM800_OK;
+        }
+    }
+
+    if (handle->smsDeleteCount < SIM800_SMS_DELETE_BATCH)
+    {
+        handle->smsDeletes[handle->smsDeleteCount++] = sms_index;
+    }
+    else
+    {
+        handle->smsDeleteRead = 1;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Reads the occupancy of the SMS storage.
+ *
+ * This function sends the "AT+CPMS?" command, the occupancy of the storage the received messages go to
+ * is also kept in handle->smsStorage and updated by the +CMTI notifications and the deletions.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *storage: Pointer to the structure to store the occupancy, may be NULL.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_GetSMSStorage(SIM800_Handle_t *handle, SIM800_SMSStorage_t *storage)
+{
+    SIM800_Status_t status = execute_command(handle, SIM800_Cmd_SMSStorage, NULL, NULL, &handle->smsStorage);
+
+    if (status == SIM800_OK && storage != NULL)
+    {
+        *storage = handle->smsStorage;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Manages the deletion of the consumed SMS messages.
+ *
+ * When enabled, every message read by SIM800_RequestSMSMessage or SIM800_ReadAllSMS is deleted after its
+ * callback has returned (see SIM800_DeleteSMSMessage), so the storage does not fill up and the inbox does not
+ * have to be wiped at startup. The occupancy of the storage is read when enabled, SIM800_SMSStorageLowCallBack
+ * is called whenever fewer than SIM800_SMS_LOW_SPACE slots are free.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE to delete the consumed messages, DISABLE to keep them.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageSMSAutoDelete(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    handle->smsAutoDelete = (enordi == ENABLE);
+
+    if (enordi == ENABLE)
+    {
+        return SIM800_GetSMSStorage(handle, NULL);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Selects how incoming SMS messages are delivered.
+ *
+ * In the direct mode ("AT+CNMI=2,2") the module forwards every message by a +CMT notification without
+ * storing it: the header and the text are parsed as they arrive and handed straight to SIM800_RcvdSMSCallBack,
+ * with no read or delete command and no SIM storage wear. The +CMTI notifications stay enabled, so messages the
+ * module still stores (e.g., class 2 messages) are read as before. The stored mode ("AT+CNMI=2,1") is the
+ * fallback for times the application can not take messages at once, the module keeps them until they are read.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   mode: Delivery mode, see SIM800_SMSDelivery_t.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageSMSDelivery(SIM800_Handle_t *handle, SIM800_SMSDelivery_t mode)
+{
+    uint8_t index;
+
+    if (mode == SIM800_SMSDelivery_Direct)
+    {
+        if (handle->smsNotifications == 0 && SIM800_ManageSMSNotifications(handle, ENABLE) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+
+        if (handle->smsDirect == 0)
+        {
+            // Add an expected code for the forwarded messages before the module starts sending them
+            if ((index = add_pending_message(handle, "+CMT", &cmt_parser, NULL, NULL)) == 0xFF)
+            {
+                return SIM800_ERROR;
+            }
+            handle->smsDirect = index + 1;
+        }
+
+        return sms_indication(handle);
+    }
+
+    if (handle->smsDirect != 0)
+    {
+        remove_expected_code(handle, handle->smsDirect - 1);
+        handle->smsDirect = 0;
+    }
+
+    return sms_indication(handle);
+}
+
+
+/**
+ * @brief   Requests an SMS message from the SIM800 module.
+ *
+ * This function submits an AT command to the SIM800 module to request an SMS message by its index.
+ * It does not wait for the response, the message is parsed by SIM800_Poll into a slot of the inbound
+ * queue and delivered to SIM800_RcvdSMSCallBack (and queued, see SIM800_ManageSMSQueue).
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   sms_index: Index of the SMS message to request.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure or if the inbound queue is full.
+ */
+SIM800_Status_t SIM800_RequestSMSMessage(SIM800_Handle_t *handle, uint32_t sms_index)
+{
+    if (handle->smsQueue && handle->smsHead + 1 - handle->smsFreed >= SIM800_SMS_QUEUE_LENGTH)
+    {
+        // No room for the message, it stays stored and can be read later
+        return SIM800_ERROR;
+    }
+
+    // The slot is selected when the response arrives (see cmgr_parser), a direct message may take the current one first
+    return SIM800_SubmitReadSMSMessage(handle, sms_index, sms_slot(handle), &read_sms_done, (void *)(uintptr_t)sms_index);
+}
+
+
+/**
+ * @brief   Manages the queueing of the received SMS messages.
+ *
+ * When enabled, every message delivered to SIM800_RcvdSMSCallBack (both read by SIM800_RequestSMSMessage and
+ * forwarded directly) is also kept in a slot of the inbound queue, so the callback may just signal the
+ * application, which takes the messages by SIM800_ReceiveSMS and releases them by SIM800_ReleaseSMS.
+ * The message is parsed in place into its slot, it is never copied. The queue holds SIM800_SMS_QUEUE_LENGTH - 1
+ * messages: when it is full, a stored message is left in the storage and a direct one is dropped, both
+ * are counted in handle->smsDropped. The auto deletion (see SIM800_ManageSMSAutoDelete) of a queued message
+ * happens once it is released.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE to queue the messages, DISABLE to only pass them to the callback.
+ */
+void SIM800_ManageSMSQueue(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    handle->smsQueue = (enordi == ENABLE);
+}
+
+
+/**
+ * @brief   Returns the oldest queued SMS message.
+ *
+ * This function may be called from another task than SIM800_Poll, the queue is lock-free for one consumer.
+ * The message stays valid until it is released by SIM800_ReleaseSMS.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  Pointer to the message, NULL if the queue is empty.
+ */
+SIM800_SMSMessage_t *SIM800_ReceiveSMS(SIM800_Handle_t *handle)
+{
+    uint32_t tail = handle->smsTail;
+
+    if (tail == handle->smsHead)
+    {
+        return NULL;
+    }
+
+    // Make sure the message is read only after the write index
+    __DMB();
+
+    return &handle->smsSlots[tail & (SIM800_SMS_QUEUE_LENGTH - 1)];
+}
+
+
+/**
+ * @brief   Releases the oldest queued SMS message returned by SIM800_ReceiveSMS.
+ *
+ * The slot is reused by SIM800_Poll, where the message is also queued for deletion if needed.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_ReleaseSMS(SIM800_Handle_t *handle)
+{
+    if (handle->smsTail == handle->smsHead)
+    {
+        return;
+    }
+
+    // Make sure the message is no longer accessed when the slot is released
+    __DMB();
+    handle->smsTail++;
+}
+
+
+/**
+ * @brief   Reads all stored SMS messages matching a filter in one command.
+ *
+ * This function sends "AT+CMGL=<filter>" and waits for the response. The listing is parsed as it arrives
+ * and the callback is invoked once per message, so the whole inbox is read in a single round trip with
+ * the memory of one message. Reading the "REC UNREAD" messages marks them as read.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   filter: Messages to read, see SIM800_SMSFilter_t.
+ * @param   callback: Callback invoked for every message.
+ * @param   *ctx: Argument of the callback.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ReadAllSMS(SIM800_Handle_t *handle, SIM800_SMSFilter_t filter,
+                                  SIM800_SMSCallback_t callback, void *ctx)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitReadAllSMS(handle, filter, callback, ctx, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+/**
+ * @brief   Submits the "AT" command without waiting for its response.
+ *
+ * All SIM800_Submit functions return immediately. The request is executed by SIM800_Poll, which
+ * invokes the completion callback with the status the corresponding blocking function would return.
+ * The requests are executed one after another in the order of submission. The options set by
+ * SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken apply to the call, whether it succeeds or
+ * not; the ...Ex variants take the options with the call instead.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitStatus(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitStatusEx(handle, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitStatus, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitStatusEx(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+                                      const SIM800_RequestOptions_t *options)
+{
+    return submit_request(handle, SIM800_Cmd_Status, NULL, NULL, NULL, done, ctx, options) != NULL ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Submits the "AT+CBC" command without waiting for its response.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *battery: Pointer to the structure filled with the battery information, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitBatteryInfo(SIM800_Handle_t *handle, SIM800_Battery_t *battery,
+                                         SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitBatteryInfoEx(handle, battery, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitBatteryInfo, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *battery: Pointer to the structure filled with the battery information, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitBatteryInfoEx(SIM800_Handle_t *handle, SIM800_Battery_t *battery,
+                                           SIM800_RequestCallback_t done, void *ctx,
+                                           const SIM800_RequestOptions_t *options)
+{
+    return submit_request(handle, SIM800_Cmd_BatteryInfo, NULL, NULL, battery, done, ctx, options) != NULL ? SIM800_OK
+                                                                                                      : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Submits the "AT+CREG?" command without waiting for its response.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *status: Pointer to the variable set to the registration status, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitNetworkRegStatus(SIM800_Handle_t *handle, SIM800_NetworkRegStatus_t *status,
+                                              SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitNetworkRegStatusEx(handle, status, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitNetworkRegStatus, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *status: Pointer to the variable set to the registration status, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitNetworkRegStatusEx(SIM800_Handle_t *handle, SIM800_NetworkRegStatus_t *status,
+                                                SIM800_RequestCallback_t done, void *ctx,
+                                                const SIM800_RequestOptions_t *options)
+{
+    return submit_request(handle, SIM800_Cmd_NetworkReg, NULL, NULL, status, done, ctx, options) != NULL ? SIM800_OK : SIM800_ERROR;
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Submits the "AT+CMGF=1" command without waiting for its response.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSMSTextMode(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitSMSTextModeEx(handle, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitSMSTextMode, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSMSTextModeEx(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+                                           const SIM800_RequestOptions_t *options)
+{
+    return submit_request(handle, SIM800_Cmd_SMSTextMode, NULL, NULL, NULL, done, ctx, options) != NULL ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Submits the "AT+CMGD=1,4" command without waiting for its response.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitDeleteAllSMSMessages(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitDeleteAllSMSMessagesEx(handle, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitDeleteAllSMSMessages, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitDeleteAllSMSMessagesEx(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+                                                    const SIM800_RequestOptions_t *options)
+{
+    return submit_request(handle, SIM800_Cmd_DeleteAllSMS, NULL, NULL, NULL, done, ctx, options) != NULL ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Submits an SMS message without waiting for it to be sent.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *destination: Destination phone number, must stay unchanged until completion.
+ * @param   *message: SMS message to be sent, must stay unchanged until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full or a string is too long.
+ */
+SIM800_Status_t SIM800_SubmitSMSMessage(SIM800_Handle_t *handle, const char *destination, const char *message,
+                                        SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitSMSMessageEx(handle, destination, message, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitSMSMessage, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *destination: Destination phone number, must stay unchanged until completion.
+ * @param   *message: SMS message to be sent, must stay unchanged until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full or a string is too long.
+ */
+SIM800_Status_t SIM800_SubmitSMSMessageEx(SIM800_Handle_t *handle, const char *destination, const char *message,
+                                          SIM800_RequestCallback_t done, void *ctx,
+                                          const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+
+    if (strlen(destination) > (SMS_TX_MAX_LEN - 3) || !sms_text_fits(handle, message))
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((req = claim_request(handle, SIM800_Cmd_SendSMS, destination, message, NULL, done, ctx, options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The message reference is kept in the request, it is only needed for the delivery reports
+    req->response = req->number;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Submits a message of a template without waiting for it to be sent.
+ *
+ * Only the field is written into the template, the rest was encoded by SIM800_PrepareSMSTemplate: in text mode
+ * the three pieces of the text are queued as they are, in PDU mode the prepared SMS-SUBMIT is sent in hex. The
+ * message reference is stored in tpl->reference. The UCS2 character set is not supported.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *tpl: Pointer to the template structure, it must stay valid until completion.
+ * @param   *field: Text of the field, cut or padded with spaces to its length.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the template is being sent or does not fit the
+ *          mode, or the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSMSTemplate(SIM800_Handle_t *handle, SIM800_SMSTemplate_t *tpl, const char *field,
+                                         SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitSMSTemplateEx(handle, tpl, field, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitSMSTemplate, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *tpl: Pointer to the template structure, it must stay valid until completion.
+ * @param   *field: Text of the field, cut or padded with spaces to its length.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the template is being sent or does not fit the
+ *          mode, or the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSMSTemplateEx(SIM800_Handle_t *handle, SIM800_SMSTemplate_t *tpl, const char *field,
+                                           SIM800_RequestCallback_t done, void *ctx,
+                                           const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+    uint8_t i;
+
+    if (handle->smsUCS2)
+    {
+        return SIM800_ERROR;
+    }
+
+#if SIM800_USE_PDU
+    if (handle->smsPDU)
+    {
+        if (tpl->pduLength == 0 ||
+            (req = claim_request(handle, SIM800_Cmd_SendPDU, NULL, (const char *)tpl->pdu, &tpl->reference,
+                                 &sms_template_done, tpl, options)) == NULL)
+        {
+            return SIM800_ERROR;
+        }
+
+        // The template is tested with the slot claimed, so a second task never patches a template being sent
+        if (tpl->busy)
+        {
+            release_request(handle);
+            return SIM800_ERROR;
+        }
+
+        SIM800_PDU_PatchSeptets(tpl->pdu, tpl->fieldBit, field, tpl->fieldLength);
+        tpl->pdu[1] = (tpl->pdu[1] & ~0x20) | (handle->smsReports != 0 ? 0x20 : 0);
+
+        // The length of the TPDU, the service centre address is not counted
+        uint_to_str(tpl->pduLength - 1, req->number);
+        req->arg = req->number;
+        req->dataHex = tpl->pduLength;
+    }
+    else
+#endif
+    {
+        if ((req = claim_request(handle, SIM800_Cmd_SendSMS, tpl->destination, (const char *)tpl->text, &tpl->reference,
+                                 &sms_template_done, tpl, options)) == NULL)
+        {
+            return SIM800_ERROR;
+        }
+
+        if (tpl->busy)
+        {
+            release_request(handle);
+            return SIM800_ERROR;
+        }
+
+        for (i = 0; i < tpl->fieldLength && field[i] != '\0'; i++)
+        {
+            tpl->field[i] = field[i];
+        }
+        memset(&tpl->field[i], ' ', tpl->fieldLength - i);
+
+        req->iov = tpl->text;
+        req->iovCount = 3;
+    }
+
+    tpl->busy = 1;
+    tpl->done = done;
+    tpl->ctx = ctx;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Submits the reading of an SMS message without waiting for its response.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   sms_index: Index of the SMS message to read.
+ * @param   *message: Pointer to the structure filled with the message, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitReadSMSMessage(SIM800_Handle_t *handle, uint32_t sms_index, SIM800_SMSMessage_t *message,
+                                            SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitReadSMSMessageEx(handle, sms_index, message, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitReadSMSMessage, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   sms_index: Index of the SMS message to read.
+ * @param   *message: Pointer to the structure filled with the message, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitReadSMSMessageEx(SIM800_Handle_t *handle, uint32_t sms_index, SIM800_SMSMessage_t *message,
+                                              SIM800_RequestCallback_t done, void *ctx,
+                                              const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req = claim_request(handle, SIM800_Cmd_ReadSMS, NULL, NULL, message, done, ctx, options);
+
+    if (req == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The number is kept in the request, so the argument lives as long as the request
+    uint_to_str(sms_index, req->number);
+    req->arg = req->number;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Submits the "AT+CMGL" command without waiting for its response.
+ *
+ * The message callback is invoked from SIM800_Poll for every listed message, the completion callback
+ * once the listing is finished. Only one listing can be submitted at a time.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   filter: Messages to read, see SIM800_SMSFilter_t.
+ * @param   callback: Callback invoked for every message.
+ * @param   *ctx: Argument of the message callback.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *doneCtx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if a listing is in progress or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitReadAllSMS(SIM800_Handle_t *handle, SIM800_SMSFilter_t filter,
+                                        SIM800_SMSCallback_t callback, void *ctx,
+                                        SIM800_RequestCallback_t done, void *doneCtx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitReadAllSMSEx(handle, filter, callback, ctx, done, doneCtx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitReadAllSMS, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   filter: Messages to read, see SIM800_SMSFilter_t.
+ * @param   callback: Callback invoked for every message.
+ * @param   *ctx: Argument of the message callback.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *doneCtx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if a listing is in progress or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitReadAllSMSEx(SIM800_Handle_t *handle, SIM800_SMSFilter_t filter,
+                                          SIM800_SMSCallback_t callback, void *ctx,
+                                          SIM800_RequestCallback_t done, void *doneCtx,
+                                          const SIM800_RequestOptions_t *options)
+{
+    SIM800_SMSList_t *list = &handle->smsList;
+
+    if (filter >= SIM800_SMS_FilterCount || callback == NULL ||
+        claim_request(handle, SIM800_Cmd_ListSMS, sms_filters[handle->smsPDU != 0][filter], NULL, list, &list_sms_done,
+                      list, options) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The listing is tested with the slot claimed, so two tasks never share the list
+    if (list->active)
+    {
+        release_request(handle);
+        return SIM800_ERROR;
+    }
+
+    list->callback = callback;
+    list->ctx = ctx;
+    list->done = done;
+    list->doneCtx = doneCtx;
+    list->lines = 0;
+    list->count = 0;
+    list->active = 1;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+#if SIM800_USE_GPRS
+
+/**
+ * @brief   Submits data for an open connection without waiting for it to be sent.
+ *
+ * The data is sent on the "> " prompt straight from the caller's buffer, the request is finished by
+ * "n, SEND OK" (or "n, SEND FAIL"), see SIM800_SocketSend.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *data: Data to send, must stay unchanged until completion.
+ * @param   length: Count of bytes to send, at most SIM800_SOCKET_TX_MAX.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the socket is not connected or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSocketSend(SIM800_Handle_t *handle, uint8_t socket, const uint8_t *data, uint16_t length,
+                                        SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitSocketSendEx(handle, socket, data, length, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitSocketSend, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *data: Data to send, must stay unchanged until completion.
+ * @param   length: Count of bytes to send, at most SIM800_SOCKET_TX_MAX.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the socket is not connected or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSocketSendEx(SIM800_Handle_t *handle, uint8_t socket, const uint8_t *data, uint16_t length,
+                                          SIM800_RequestCallback_t done, void *ctx,
+                                          const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+
+    if (socket >= SIM800_SOCKET_COUNT || handle->sockets[socket].state != SIM800_Socket_Connected ||
+        length == 0 || length > SIM800_SOCKET_TX_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((req = claim_request(handle, SIM800_Cmd_SocketSend, NULL, (const char *)data, NULL, done, ctx, options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+    req->dataLength = length;
+
+    // <n>,<length>, kept in the request so the argument lives as long as the request
+    req->number[0] = '0' + socket;
+    req->number[1] = ',';
+    uint_to_str(length, &req->number[2]);
+    req->arg = req->number;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Submits a data block scattered over several buffers without waiting for it to be sent.
+ *
+ * The pieces are sent back to back on the "> " prompt of a single "AT+CIPSEND", each straight from its
+ * buffer: e.g. a header and a payload need not be put together first. See SIM800_SubmitSocketSend.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *iov: Pieces of the data block, the array and the pieces must stay unchanged until completion.
+ * @param   count: Count of pieces, the total length is at most SIM800_SOCKET_TX_MAX.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the socket is not connected or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSocketSendV(SIM800_Handle_t *handle, uint8_t socket, const SIM800_IOVec_t *iov, uint8_t count,
+                                         SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitSocketSendVEx(handle, socket, iov, count, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitSocketSendV, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *iov: Pieces of the data block, the array and the pieces must stay unchanged until completion.
+ * @param   count: Count of pieces, the total length is at most SIM800_SOCKET_TX_MAX.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the socket is not connected or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSocketSendVEx(SIM800_Handle_t *handle, uint8_t socket, const SIM800_IOVec_t *iov, uint8_t count,
+                                           SIM800_RequestCallback_t done, void *ctx,
+                                           const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+    uint32_t length = 0;
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        length += iov[i].length;
+    }
+
+    if (socket >= SIM800_SOCKET_COUNT || handle->sockets[socket].state != SIM800_Socket_Connected ||
+        length == 0 || length > SIM800_SOCKET_TX_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((req = claim_request(handle, SIM800_Cmd_SocketSend, NULL, (const char *)iov, NULL, done, ctx, options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+    req->dataLength = length;
+    req->iov = iov;
+    req->iovCount = count;
+
+    req->number[0] = '0' + socket;
+    req->number[1] = ',';
+    uint_to_str(length, &req->number[2]);
+    req->arg = req->number;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Submits one read of the data waiting in the module in manual receive mode.
+ *
+ * At most read->size bytes (and at most SIM800_SOCKET_TX_MAX) are read by "AT+CIPRXGET=2,<n>,<length>",
+ * the payload is copied by SIM800_Process straight into read->buffer. On completion read->length holds
+ * the count of bytes read and read->remaining the count still waiting, see SIM800_ManageManualReceive.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *read: Pointer to the read with the buffer and its size set, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if manual receive is off or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSocketRead(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketRead_t *read,
+                                        SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitSocketReadEx(handle, socket, read, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitSocketRead, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *read: Pointer to the read with the buffer and its size set, must stay valid until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if manual receive is off or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitSocketReadEx(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketRead_t *read,
+                                          SIM800_RequestCallback_t done, void *ctx,
+                                          const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+
+    if (handle->socketManual == 0 || socket >= SIM800_SOCKET_COUNT || read->size == 0 ||
+        (req = claim_request(handle, SIM800_Cmd_SocketRxGet, NULL, NULL, read, done, ctx, options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    read->socket = socket;
+    read->length = 0;
+    read->remaining = 0;
+    read->header = 0;
+    if (read->size > SIM800_SOCKET_TX_MAX)
+    {
+        read->size = SIM800_SOCKET_TX_MAX;
+    }
+
+    // 2,<n>,<length>, kept in the request so the argument lives as long as the request
+    req->number[0] = '2';
+    req->number[1] = ',';
+    req->number[2] = '0' + socket;
+    req->number[3] = ',';
+    uint_to_str(read->size, &req->number[4]);
+    req->arg = req->number;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_GPRS */
+
+
+/**
+ * @brief   Retrieves several values from the SIM800 module in one round trip.
+ *
+ * This function is the blocking variant of SIM800_SubmitBatch.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *items: Array of the queries, the responses and statuses are filled in.
+ * @param   count: Count of queries, at most SIM800_BATCH_MAX_ITEMS.
+ * @retval  SIM800_OK if all queries succeeded, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_QueryBatch(SIM800_Handle_t *handle, SIM800_BatchItem_t *items, uint8_t count)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitBatch(handle, items, count, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Configures the caching of a slow-changing value.
+ *
+ * A value read from the module is served from the handle for ttl milliseconds. Once it has expired, the next
+ * read sends the command again; with background refresh enabled, SIM800_Poll submits the command when no other
+ * request is queued and the stale value is served meanwhile.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   item: Cached value, see SIM800_CacheItem_t.
+ * @param   ttl: Time to live of the value (ms), 0 - not cached, SIM800_CACHE_FOREVER - never expires.
+ * @param   background: 1 to refresh the expired value in the background, 0 to refresh it on read.
+ */
+void SIM800_SetCacheTTL(SIM800_Handle_t *handle, SIM800_CacheItem_t item, uint32_t ttl, uint8_t background)
+{
+    if (item < SIM800_Cache_Count)
+    {
+        handle->cache[item].ttl = ttl;
+        handle->cache[item].background = background;
+    }
+}
+
+
+/**
+ * @brief   Drops a cached value, the next read sends the command.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   item: Cached value, see SIM800_CacheItem_t.
+ */
+void SIM800_InvalidateCache(SIM800_Handle_t *handle, SIM800_CacheItem_t item)
+{
+    if (item < SIM800_Cache_Count)
+    {
+        handle->cache[item].valid = 0;
+    }
+}
+
+
+/**
+ * @brief   Sets the retry policy of a command.
+ *
+ * A request of the command that fails with a retryable "+CME ERROR"/"+CMS ERROR" cause is sent again by the
+ * request queue, so both the blocking and the submitted variants are retried; the caller only sees the result
+ * of the last attempt. E.g. to retry "AT+CMGS" on network congestion:
+ *     static const SIM800_RetryPolicy_t sms_retry = { .attempts = 4, .delay = 2000, .maxDelay = 16000 };
+ *     SIM800_SetRetryPolicy(handle, SIM800_Cmd_SendSMS, &sms_retry);
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command, see SIM800_Command_t.
+ * @param   *policy: Retry policy, a constant structure: it is not copied. NULL - the command is not retried.
+ * @retval  SIM800_OK on success, SIM800_ERROR if SIM800_RETRY_RULES commands have a policy already.
+ */
+SIM800_Status_t SIM800_SetRetryPolicy(SIM800_Handle_t *handle, SIM800_Command_t cmd, const SIM800_RetryPolicy_t *policy)
+{
+    SIM800_RetryRule_t *slot = NULL;
+
+    if (cmd >= SIM800_Cmd_Count)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < SIM800_RETRY_RULES; i++)
+    {
+        if (handle->retry[i].policy != NULL && handle->retry[i].cmd == cmd)
+        {
+            handle->retry[i].policy = policy;
+            return SIM800_OK;
+        }
+
+        if (handle->retry[i].policy == NULL && slot == NULL)
+        {
+            slot = &handle->retry[i];
+        }
+    }
+
+    if (policy == NULL)
+    {
+        return SIM800_OK;
+    }
+
+    if (slot == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    slot->cmd = cmd;
+    slot->policy = policy;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Subscribes a callback to events of the driver.
+ *
+ * Every subscriber whose mask takes an event gets it, after the callback of the event (e.g.,
+ * SIM800_NewSMSNotificationCallBack), so several parts of the application (a logger, a command dispatcher,
+ * a scheduler) consume the same notifications without registering expected codes of their own. The
+ * queued events are delivered from SIM800_Poll, see SIM800_EventQueue_t; SIM800_Event_SMSReceived is
+ * delivered at once by the parser with the message in data, so its subscribers must not call blocking functions.
+ * E.g., SIM800_Subscribe(handle, SIM800_EVT_SMS | SIM800_EVT_CREG, &log_event, NULL).
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   mask: Events to take, SIM800_EVT_... combined. A subscribed callback and ctx get the new mask.
+ * @param   callback: Callback of the subscriber.
+ * @param   *ctx: Argument of the callback.
+ * @retval  SIM800_OK on success, SIM800_ERROR if SIM800_SUBSCRIBERS callbacks are subscribed already.
+ */
+SIM800_Status_t SIM800_Subscribe(SIM800_Handle_t *handle, uint32_t mask, SIM800_EventCallback_t callback, void *ctx)
+{
+    SIM800_Subscriber_t *slot = NULL;
+
+    if (callback == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < SIM800_SUBSCRIBERS; i++)
+    {
+        if (handle->subscribers[i].callback == callback && handle->subscribers[i].ctx == ctx)
+        {
+            handle->subscribers[i].mask = mask;
+            return SIM800_OK;
+        }
+
+        if (handle->subscribers[i].callback == NULL && slot == NULL)
+        {
+            slot = &handle->subscribers[i];
+        }
+    }
+
+    if (slot == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    slot->mask = mask;
+    slot->ctx = ctx;
+    slot->callback = callback;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Removes an event subscriber, see SIM800_Subscribe.
+ *
+ * It may be called from an event callback, the removed subscriber gets no further events.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   callback: Callback of the subscriber.
+ * @param   *ctx: Argument of the callback given to SIM800_Subscribe.
+ */
+void SIM800_Unsubscribe(SIM800_Handle_t *handle, SIM800_EventCallback_t callback, void *ctx)
+{
+    for (uint8_t i = 0; i < SIM800_SUBSCRIBERS; i++)
+    {
+        if (handle->subscribers[i].callback == callback && handle->subscribers[i].ctx == ctx)
+        {
+            handle->subscribers[i].callback = NULL;
+            handle->subscribers[i].mask = 0;
+        }
+    }
+}
+
+
+/**
+ * @brief   Starts a flow, a sequential script over the non-blocking functions resumed by SIM800_Poll.
+ *
+ * The function of the flow is called from SIM800_Poll until it returns SIM800_FLOW_ENDED, it continues at
+ * the point it last waited at, see sim800_flow.h. The flow structure must stay valid until the flow has ended
+ * or is stopped. A flow must not call the blocking functions.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *flow: Pointer to the flow structure.
+ * @param   function: Body of the flow.
+ * @param   *ctx: Argument of the application, flow->ctx.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the flow is running already.
+ */
+SIM800_Status_t SIM800_StartFlow(SIM800_Handle_t *handle, SIM800_Flow_t *flow, SIM800_FlowFunction_t function,
+                                 void *ctx)
+{
+    SIM800_Flow_t **link = &handle->flows;
+
+    if (function == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The flows are resumed in the order they have been started
+    while (*link != NULL)
+    {
+        if (*link == flow)
+        {
+            return SIM800_ERROR;
+        }
+        link = &(*link)->next;
+    }
+
+    flow->line = 0;
+    flow->pending = 0;
+    flow->status = SIM800_OK;
+    flow->function = function;
+    flow->ctx = ctx;
+    flow->next = NULL;
+    *link = flow;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Stops a flow, see SIM800_StartFlow.
+ *
+ * A request the flow awaits still completes into the flow structure, so keep it valid until then (or cancel
+ * the request by its token, see SIM800_Cancel).
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *flow: Pointer to the flow structure.
+ */
+void SIM800_StopFlow(SIM800_Handle_t *handle, SIM800_Flow_t *flow)
+{
+    SIM800_Flow_t **link = &handle->flows;
+
+    while (*link != NULL)
+    {
+        if (*link == flow)
+        {
+            // The next pointer stays, flow_poll goes on from it
+            *link = flow->next;
+            return;
+        }
+        link = &(*link)->next;
+    }
+}
+
+
+/**
+ * @brief   Completion callback of the requests awaited by a flow, see SIM800_AWAIT.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the flow structure.
+ */
+void SIM800_FlowCallback(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_Flow_t *flow = (SIM800_Flow_t *)ctx;
+
+    flow->status = status;
+    flow->pending = 0;
+}
+
+
+/**
+ * @brief   Takes the status of a submission of SIM800_AWAIT, a request that is not queued is not awaited.
+ *
+ * The completion callback may have run already (e.g. a cached value), its status stays.
+ *
+ * @param   *flow: Pointer to the flow structure.
+ * @param   status: Status returned by the SIM800_Submit function.
+ */
+void SIM800_FlowSubmitted(SIM800_Flow_t *flow, SIM800_Status_t status)
+{
+    if (status != SIM800_OK)
+    {
+        flow->status = status;
+        flow->pending = 0;
+    }
+}
+
+
+#if SIM800_USE_STATS
+
+/**
+ * @brief   Reads the counters of the driver.
+ *
+ * Route HAL_UART_ErrorCallback to SIM800_UART_ErrorCallback for the UART errors to be counted.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *stats: Pointer to store the counters.
+ */
+void SIM800_GetStats(SIM800_Handle_t *handle, SIM800_Stats_t *stats)
+{
+    *stats = handle->stats;
+    stats->rxBytes += handle->rxHead - handle->rxCounted;
+    stats->overruns = handle->rxOverruns;
+    stats->retries = handle->retries;
+    stats->txErrors = handle->txErrors;
+    stats->resets = handle->resets;
+    stats->eventsDropped = handle->events.dropped;
+}
+
+
+/**
+ * @brief   Clears the counters of the driver.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_ResetStats(SIM800_Handle_t *handle)
+{
+    memset(&handle->stats, 0, sizeof(handle->stats));
+
+    // The characters received but not counted yet are taken back once SIM800_Process counts them
+    handle->stats.rxBytes = handle->rxCounted - handle->rxHead;
+    handle->rxOverruns = 0;
+    handle->retries = 0;
+    handle->txErrors = 0;
+    handle->resets = 0;
+    handle->events.dropped = 0;
+}
+
+#endif /* SIM800_USE_STATS */
+
+
+#if SIM800_USE_LATENCY
+
+/**
+ * @brief   Reads the latency histograms of a command.
+ *
+ * Every request executed by the request queue is measured, see SIM800_LatencyStage_t; the histograms are kept
+ * for the first SIM800_LATENCY_COMMANDS commands seen. Batches of queries are not measured.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command, see SIM800_Command_t.
+ * @param   *latency: Pointer to store the histograms.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the command has no histograms.
+ */
+SIM800_Status_t SIM800_GetLatency(SIM800_Handle_t *handle, SIM800_Command_t cmd, SIM800_Latency_t *latency)
+{
+    for (uint8_t i = 0; i < SIM800_LATENCY_COMMANDS; i++)
+    {
+        if (handle->latency.commands[i].count + handle->latency.commands[i].failed != 0 &&
+            handle->latency.commands[i].cmd == cmd)
+        {
+            *latency = handle->latency.commands[i];
+            return SIM800_OK;
+        }
+    }
+
+    return SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Clears the latency histograms of all commands.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_ResetLatency(SIM800_Handle_t *handle)
+{
+    memset(handle->latency.commands, 0, sizeof(handle->latency.commands));
+    handle->latency.untracked = 0;
+}
+
+#endif /* SIM800_USE_LATENCY */
+
+
+#if SIM800_USE_ISR_BUDGET
+
+/**
+ * @brief   Sets the execution time budget of the interrupt handlers.
+ *
+ * Every run of SIM800_MessageHandler, SIM800_RxEventHandler and SIM800_TxCpltHandler is timed with the DWT
+ * cycle counter. A run longer than the budget is counted and reported to SIM800_ISRBudgetCallBack.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   budget: Longest allowed run (ns), 0 - no budget.
+ */
+void SIM800_SetISRBudget(SIM800_Handle_t *handle, uint32_t budget)
+{
+    handle->isr.budget = (uint32_t)((uint64_t)budget * (SystemCoreClock / 1000000u) / 1000u);
+    if (budget != 0 && handle->isr.budget == 0)
+    {
+        handle->isr.budget = 1;
+    }
+}
+
+
+/**
+ * @brief   Reads the execution time statistics of the interrupt handlers.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *stats: Pointer to store the statistics.
+ */
+void SIM800_GetISRStats(SIM800_Handle_t *handle, SIM800_ISRStats_t *stats)
+{
+    uint32_t primask = __get_PRIMASK();
+    SIM800_ISRMonitor_t isr;
+
+    __disable_irq();
+    isr = handle->isr;
+    __set_PRIMASK(primask);
+
+    stats->count = isr.count;
+    stats->exceeded = isr.exceeded;
+    stats->max = cycles_to_ns(isr.max);
+    stats->mean = (isr.count != 0) ? cycles_to_ns((uint32_t)(isr.total / isr.count)) : 0;
+}
+
+
+/**
+ * @brief   Clears the execution time statistics of the interrupt handlers, the budget is kept.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_ResetISRStats(SIM800_Handle_t *handle)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    handle->isr.count = 0;
+    handle->isr.exceeded = 0;
+    handle->isr.max = 0;
+    handle->isr.total = 0;
+    __set_PRIMASK(primask);
+}
+
+#endif /* SIM800_USE_ISR_BUDGET */
+
+
+#if SIM800_USE_TRACE
+
+/**
+ * @brief   Dumps the trace of the traffic with the module, from the oldest record.
+ *
+ * The dump is SIM800_TRACE_MAGIC, the SIM800_TRACE_VERSION byte and the records (see SIM800_Trace_t). It is
+ * accepted as it is by the host benchmark (host/bench), which replays the received lines. E.g. over the SWO:
+ *     static void swo_write(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx)
+ *     {
+ *         while (length--) ITM_SendChar(*data++);
+ *     }
+ *     SIM800_TraceDump(handle, swo_write, NULL);
+ * Nothing is recorded while dumping, the trace is kept.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   write: Function writing a piece of the dump.
+ * @param   *ctx: Argument of write.
+ */
+void SIM800_TraceDump(SIM800_Handle_t *handle, SIM800_TraceWriter_t write, void *ctx)
+{
+    static const uint8_t version = SIM800_TRACE_VERSION;
+    SIM800_Trace_t *trace = &handle->trace;
+    uint32_t pos, length, first;
+
+    trace->paused = 1;
+    __DMB();
+
+    pos = trace->tail & (SIM800_TRACE_LENGTH - 1);
+    length = trace->head - trace->tail;
+    first = (SIM800_TRACE_LENGTH - pos < length) ? SIM800_TRACE_LENGTH - pos : length;
+
+    write(handle, (const uint8_t *)SIM800_TRACE_MAGIC, sizeof(SIM800_TRACE_MAGIC) - 1, ctx);
+    write(handle, &version, 1, ctx);
+    if (first != 0)
+    {
+        write(handle, &trace->ring[pos], first, ctx);
+    }
+    if (length != first)
+    {
+        write(handle, trace->ring, length - first, ctx);
+    }
+
+    __DMB();
+    trace->paused = 0;
+}
+
+
+/**
+ * @brief   Discards all the records of the trace.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_TraceClear(SIM800_Handle_t *handle)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    __disable_irq();
+    handle->trace.tail = handle->trace.head;
+    handle->trace.dropped = 0;
+    __set_PRIMASK(primask);
+}
+
+#endif /* SIM800_USE_TRACE */
+
+
+/**
+ * @brief   Manages the health watchdog of the module.
+ *
+ * The watchdog runs in SIM800_Poll. Once SIM800_WATCHDOG_TIMEOUTS requests in a row have timed out, it probes
+ * the module with "AT"; after SIM800_WATCHDOG_PROBES failed probes it restarts the module with "AT+CFUN=1,1",
+ * and if the module does not restart within SIM800_WATCHDOG_RESTART, it invokes SIM800_PowerCycleCallBack to
+ * toggle the PWRKEY or the reset line. Once the module has restarted (also by itself, e.g. after a brown-out),
+ * the configuration of SIM800_Init and the registration notifications are sent again and a wanted bearer is
+ * brought up again. SIM800_WatchdogCallBack is invoked on every change of the state.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE or DISABLE.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the module has not been configured by SIM800_Init.
+ */
+SIM800_Status_t SIM800_ManageWatchdog(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    SIM800_Watchdog_t *watchdog = &handle->watchdog;
+
+    if (enordi == DISABLE)
+    {
+        watchdog->state = SIM800_Watchdog_Off;
+        return SIM800_OK;
+    }
+
+    if (handle->config == NULL || !(handle->bootState & SIM800_Boot_Configured))
+    {
+        return SIM800_ERROR;
+    }
+
+    if (watchdog->state == SIM800_Watchdog_Off)
+    {
+        watchdog->timeouts = 0;
+        watchdog_enter(handle, SIM800_Watchdog_Healthy);
+    }
+
+    return SIM800_OK;
+}
+
+
+#if SIM800_USE_SLEEP
+
+/**
+ * @brief   Manages the sleep mode of the module on its DTR line ("AT+CSCLK=1").
+ *
+ * With the sleep mode the module may sleep while DTR is high and it has nothing to report. SIM800_Poll raises DTR
+ * once the driver has been idle for SIM800_SLEEP_IDLE, and pulls it low again when a request is queued or the
+ * ring indicator has fallen (see SIM800_RIHandler); the command is sent SIM800_SLEEP_WAKE_DELAY later. "AT+CFGRI=1"
+ * makes RI pulse on every notification as well, so its EXTI interrupt can wake the MCU from the STOP mode, see
+ * SIM800_EnterStop. The module is kept awake while the transparent pipe is connected or the multiplexer is in use, the blocks
+ * queued by SIM800_Transmit need an awake module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, connected to a UART.
+ * @param   *dtrPort: Port of the output pin driving DTR, NULL to leave the sleep mode.
+ * @param   dtrPin: Output pin driving DTR.
+ * @retval  SIM800_OK on success, SIM800_ERROR or SIM800_TIMEOUT on failure.
+ */
+SIM800_Status_t SIM800_ManageSleep(SIM800_Handle_t *handle, GPIO_TypeDef *dtrPort, uint16_t dtrPin)
+{
+    SIM800_Sleep_t *sleep = &handle->sleep;
+    SIM800_Status_t status;
+
+    if (handle->link != NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (dtrPort == NULL)
+    {
+        // The command wakes the module first, DTR stays low
+        if (sleep->state != SIM800_Sleep_Off &&
+            (status = execute_command(handle, SIM800_Cmd_SlowClock, "0", NULL, NULL)) != SIM800_OK)
+        {
+            return status;
+        }
+
+        sleep->state = SIM800_Sleep_Off;
+        return SIM800_OK;
+    }
+
+    if (sleep->state == SIM800_Sleep_Off)
+    {
+        HAL_GPIO_WritePin(dtrPort, dtrPin, GPIO_PIN_RESET);
+    }
+    sleep->dtrPort = dtrPort;
+    sleep->dtrPin = dtrPin;
+
+    if ((status = execute_command(handle, SIM800_Cmd_RingConfig, "1", NULL, NULL)) != SIM800_OK ||
+        (status = execute_command(handle, SIM800_Cmd_SlowClock, "1", NULL, NULL)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    if (sleep->state == SIM800_Sleep_Off)
+    {
+        sleep->ring = 0;
+        sleep->rxSeen = handle->rxHead;
+        sleep->tick = HAL_GetTick();
+        sleep->state = SIM800_Sleep_Awake;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Puts the MCU into the STOP mode while the module sleeps.
+ *
+ * Call this function from the main loop after SIM800_Poll. The MCU is stopped in SIM800_OS_Stop only if the
+ * module sleeps and the driver has nothing to do: no request, nothing to send, no character and no event
+ * to handle. The interrupts are masked meanwhile, so an interrupt that becomes pending just before the STOP
+ * mode ends it at once and runs after the clocks are restored. A reception stopped by an error while the
+ * clocks were stopped is armed again before the interrupts are unmasked.
+ *
+ * The HAL tick does not run in the STOP mode: the periodic work of the driver (e.g., the signal sampler or the
+ * background refresh of the cache) needs another wake-up source, such as the RTC wakeup timer.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_ManageSleep.
+ * @retval  SIM800_OK if the MCU has been stopped, SIM800_ERROR if the driver is busy.
+ */
+SIM800_Status_t SIM800_EnterStop(SIM800_Handle_t *handle)
+{
+    uint32_t primask;
+
+    if (handle->sleep.state != SIM800_Sleep_Asleep || !sleep_idle(handle) ||
+        handle->events.head != handle->events.tail)
+    {
+        return SIM800_ERROR;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    // A character or a ring received after the checks above keeps the MCU running
+    if (handle->rxHead != handle->rxTail || handle->sleep.ring)
+    {
+        __set_PRIMASK(primask);
+        return SIM800_ERROR;
+    }
+
+    SIM800_OS_Stop(handle);
+    handle->sleep.stops++;
+
+    // The ring is empty, the reception may start over
+    if (handle->recStatus == SIM800_Receives && handle->uart->RxState == HAL_UART_STATE_READY)
+    {
+        start_receiving(handle);
+    }
+
+    __set_PRIMASK(primask);
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_SLEEP */
+
+
+#if SIM800_USE_PHONEBOOK
+
+/**
+ * @brief   Loads the numbers of the SIM phonebook into the in-RAM index and waits for the end of the load.
+ *
+ * See SIM800_SubmitLoadPhonebook.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_LoadPhonebook(SIM800_Handle_t *handle)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitLoadPhonebook(handle, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Loads the numbers of the SIM phonebook into the in-RAM index without waiting for the end of the load.
+ *
+ * The size of the phonebook is queried first ("AT+CPBR=?"), then all of its entries are read by a single
+ * "AT+CPBR=1,<size>" and their numbers are inserted into the sorted index as the lines arrive; nothing else
+ * of an entry is kept. A reload marks the numbers it reads and drops the unmarked ones only once it has
+ * succeeded, so SIM800_IsInPhonebook never sees a half-loaded index. The numbers that do not fit into
+ * SIM800_PHONEBOOK_ENTRIES are counted in handle->phonebook.dropped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the load is submitted, SIM800_ERROR if a load is in progress or the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitLoadPhonebook(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitLoadPhonebookEx(handle, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitLoadPhonebook, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the load is submitted, SIM800_ERROR if a load is in progress or the request queue is full.
+ */
+SIM800_Status_t SIM800_SubmitLoadPhonebookEx(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+                                             const SIM800_RequestOptions_t *options)
+{
+    SIM800_Phonebook_t *phonebook = &handle->phonebook;
+
+    if (claim_request(handle, SIM800_Cmd_PhonebookSize, NULL, NULL, phonebook, &phonebook_size_done, NULL, options) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The load is tested with the slot claimed, so two tasks never start a load each
+    if (phonebook->loading)
+    {
+        release_request(handle);
+        return SIM800_ERROR;
+    }
+
+    phonebook->loading = 1;
+    phonebook->dropped = 0;
+    phonebook->done = done;
+    phonebook->ctx = ctx;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Checks a phone number (e.g., the sender of an SMS message) against the phonebook index, no command is sent.
+ *
+ * The number is looked up by a binary search of its last SIM800_PHONEBOOK_DIGITS digits, the other
+ * characters are ignored, so "+7 900 123-45-67" matches "89001234567".
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *number: Phone number.
+ * @retval  1 if the number is in the phonebook, 0 otherwise or if the phonebook has not been loaded.
+ */
+uint8_t SIM800_IsInPhonebook(SIM800_Handle_t *handle, const char *number)
+{
+    SIM800_Phonebook_t *phonebook = &handle->phonebook;
+    uint64_t key = (number != NULL) ? phonebook_key(number) : 0;
+    uint16_t i;
+
+    if (key == 0)
+    {
+        return 0;
+    }
+
+    i = phonebook_find(phonebook, key);
+
+    return i < phonebook->count && (phonebook->keys[i] >> 1) == (key >> 1);
+}
+
+
+/**
+ * @brief   Sets the period of the background reload of the phonebook index.
+ *
+ * The module does not report changes of the phonebook, so a loaded index is reloaded by SIM800_Poll
+ * every period, whenever no other request is queued. It is also reloaded after a restart of the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   period: Period (ms), 0 - no periodic reload.
+ */
+void SIM800_SetPhonebookRefresh(SIM800_Handle_t *handle, uint32_t period)
+{
+    handle->phonebook.refresh = period;
+}
+
+
+/**
+ * @brief   Makes SIM800_Poll reload the phonebook index in the background, e.g. after the phonebook has been edited.
+ *
+ * The current index keeps answering SIM800_IsInPhonebook until the reload has succeeded.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_InvalidatePhonebook(SIM800_Handle_t *handle)
+{
+    handle->phonebook.stale = 1;
+    handle->phonebook.tick = HAL_GetTick() - SIM800_PHONEBOOK_RETRY;
+}
+
+#endif /* SIM800_USE_PHONEBOOK */
+
+
+/**
+ * @brief   Switches the module and the UART to another baud rate.
+ *
+ * This function sends "AT+IPR=<baud>" at the current rate; the module answers and switches.
+ * Then the UART is reconfigured to the new rate and the link is verified with "AT". If the
+ * verification fails, the UART falls back to the last good rate, where the link is verified again
+ * (the module may have ignored the command). Receiving must be started.
+ * SIM800 supports the fixed rates 1200 to 460800.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   baud: Baud rate to switch to.
+ * @retval  SIM800_OK if the link works at the new rate, SIM800_ERROR otherwise.
+ */
+SIM800_Status_t SIM800_NegotiateBaud(SIM800_Handle_t *handle, uint32_t baud)
+{
+    uint32_t last = uart_baud(handle);
+    char str_baud[11];
+
+    uint_to_str(baud, str_baud);
+
+    if (execute_command(handle, SIM800_Cmd_SetBaud, str_baud, NULL, NULL) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (configure_uart(handle, baud, uart_flow(handle)) == SIM800_OK && verify_link(handle) == SIM800_OK)
+    {
+        handle->baudRate = baud;
+        return SIM800_OK;
+    }
+
+    // Fall back to the last good rate
+    if (configure_uart(handle, last, uart_flow(handle)) == SIM800_OK && verify_link(handle) == SIM800_OK)
+    {
+        handle->baudRate = last;
+    }
+    else
+    {
+        handle->baudRate = 0;
+    }
+
+    return SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Finds the baud rate the module is running at.
+ *
+ * This function probes the current UART rate first and then the rates the module is usually set to,
+ * with "AT" at every rate, until the module answers. The module autobauds on "AT" if it is set to
+ * AT+IPR=0. Receiving must be started.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK if the module answers at one of the rates, SIM800_ERROR otherwise.
+ */
+SIM800_Status_t SIM800_AutoBaud(SIM800_Handle_t *handle)
+{
+    if (verify_link(handle) == SIM800_OK)
+    {
+        handle->baudRate = uart_baud(handle);
+        return SIM800_OK;
+    }
+
+    for (uint32_t i = 0; i < sizeof(baud_rates) / sizeof(baud_rates[0]); i++)
+    {
+        if (configure_uart(handle, baud_rates[i], uart_flow(handle)) == SIM800_OK && verify_link(handle) == SIM800_OK)
+        {
+            handle->baudRate = baud_rates[i];
+            return SIM800_OK;
+        }
+    }
+
+    handle->baudRate = 0;
+
+    return SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Controls the RTS/CTS hardware flow control.
+ *
+ * This function switches the flow control of the module ("AT+IFC=2,2" or "AT+IFC=0,0") and of the UART
+ * together. The RTS and CTS pins must be configured in HAL_UART_MspInit. With flow control enabled,
+ * the reception is stopped when the receive ring fills up to RX_HIGH_WATER, so the UART drops RTS and
+ * the module holds the data instead of the characters being lost; SIM800_Process resumes the reception
+ * once the ring has drained to RX_LOW_WATER.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE to enable the flow control, DISABLE to disable it.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+SIM800_Status_t SIM800_ManageFlowControl(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    uint32_t baud = uart_baud(handle);
+
+    if (enordi == ENABLE)
+    {
+        // Assert RTS first, so the module is allowed to answer once it obeys it
+        if (configure_uart(handle, baud, UART_HWCONTROL_RTS_CTS) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+
+        handle->flowControl = 1;
+
+        if (execute_command(handle, SIM800_Cmd_FlowControl, "2,2", NULL, NULL) != SIM800_OK)
+        {
+            handle->flowControl = 0;
+            configure_uart(handle, baud, UART_HWCONTROL_NONE);
+            return SIM800_ERROR;
+        }
+
+        return SIM800_OK;
+    }
+
+    // Release the module first, then the UART
+    if (execute_command(handle, SIM800_Cmd_FlowControl, "0,0", NULL, NULL) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->flowControl = 0;
+
+    return configure_uart(handle, baud, UART_HWCONTROL_NONE);
+}
+
+
+#if SIM800_USE_GPRS
+
+/**
+ * @brief   Sets the access point of the GPRS bearer and starts watching its deactivation.
+ *
+ * The bearer is shared: the sockets, the transparent pipe and the HTTP client all use it, so GPRS is
+ * brought up once for all of them. "+PDP: DEACT" marks the bearer as down and closes the sockets, a
+ * wanted bearer is then brought up again by SIM800_Poll, see SIM800_BearerUp.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *apn: Access point name, e.g. "internet", at most SIM800_SOCKET_HOST_MAX characters. The string must stay valid.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+SIM800_Status_t SIM800_BearerInit(SIM800_Handle_t *handle, const char *apn)
+{
+    uint8_t index;
+
+    if (apn == NULL || strlen(apn) > SIM800_SOCKET_HOST_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (handle->bearer.pdp == 0)
+    {
+        if ((index = add_pending_message(handle, "+PDP", &pdp_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        handle->bearer.pdp = index + 1;
+    }
+
+    handle->bearer.apn = apn;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Brings up the GPRS bearer and keeps it up.
+ *
+ * The module is attached to GPRS ("AT+CGATT=1"), the access point is set ("AT+CSTT"), the wireless
+ * connection is brought up ("AT+CIICR") and the local IP address is read ("AT+CIFSR") into
+ * handle->localIP. A bearer already up is used as it is. From then on SIM800_Poll brings a lost
+ * bearer up again, the delays between the attempts double from SIM800_BEARER_RETRY_MIN up to
+ * SIM800_BEARER_RETRY_MAX; the changes are reported to SIM800_BearerCallBack.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+SIM800_Status_t SIM800_BearerUp(SIM800_Handle_t *handle)
+{
+    SIM800_Bearer_t *bearer = &handle->bearer;
+    uint16_t failures = bearer->failures;
+
+    if (bearer->apn == NULL || transparent_busy(handle))
+    {
+        return SIM800_ERROR;
+    }
+
+    bearer->wanted = 1;
+
+    if (bearer->state == SIM800_Bearer_Down)
+    {
+        // Do not wait for the backoff delay of an earlier failure
+        bearer->retryTick = HAL_GetTick();
+    }
+
+    while (bearer->state != SIM800_Bearer_Up)
+    {
+        executor_poll(handle);
+
+        if (bearer->state == SIM800_Bearer_Down && bearer->failures != failures)
+        {
+            return SIM800_ERROR;
+        }
+
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Shuts the GPRS bearer down and stops keeping it up.
+ *
+ * All connections are closed ("AT+CIPSHUT").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_BearerDown(SIM800_Handle_t *handle)
+{
+    SIM800_Status_t status;
+
+    handle->bearer.wanted = 0;
+
+    if ((status = execute_command(handle, SIM800_Cmd_GPRSShut, NULL, NULL, &handle->bearer)) == SIM800_OK)
+    {
+        bearer_lost(handle);
+        handle->bearer.shut = 0;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Resolves a host name, answering from the DNS cache when possible.
+ *
+ * A name resolved less than SIM800_DNS_TTL ago is answered from the cache in the handle, otherwise the
+ * module is asked ("AT+CDNSGIP", over the GPRS bearer) and the result replaces the entry of the same
+ * name, a free or expired one, or the oldest one. An IP address is returned as it is. SIM800_SocketOpen
+ * and SIM800_TransparentOpen connect through this cache, call SIM800_DNSInvalidate when a connection to
+ * a cached address fails.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerUp.
+ * @param   *host: Host name, at most SIM800_SOCKET_HOST_MAX characters.
+ * @param   *ip: Buffer of at least 16 characters to store the IP address.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_Resolve(SIM800_Handle_t *handle, const char *host, char *ip)
+{
+    SIM800_DNS_t *dns = &handle->dns;
+    SIM800_DNSEntry_t *entry;
+    SIM800_Status_t status;
+    uint32_t tickStart;
+    uint8_t index;
+    size_t len = strlen(host);
+
+    if (len == 0 || len > SIM800_SOCKET_HOST_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (dns_is_address(host))
+    {
+        strcpy(ip, host);
+        return SIM800_OK;
+    }
+
+    entry = dns_slot(handle, host);
+    if (strcmp(entry->host, host) == 0 && HAL_GetTick() - entry->tick < SIM800_DNS_TTL)
+    {
+        dns->hits++;
+        strcpy(ip, entry->ip);
+        return SIM800_OK;
+    }
+
+    // The result is a notification that follows "OK" once the name server has answered
+    if ((index = add_pending_message(handle, "+CDNSGIP", &cdnsgip_parser, dns, NULL)) == 0xFF)
+    {
+        return SIM800_ERROR;
+    }
+    dns->done = 0;
+    dns->found = 0;
+    dns->lookups++;
+
+    if ((status = execute_command(handle, SIM800_Cmd_DNSLookup, host, NULL, NULL)) == SIM800_OK)
+    {
+        tickStart = HAL_GetTick();
+
+        while (!dns->done)
+        {
+            executor_poll(handle);
+
+            if (HAL_GetTick() - tickStart > SIM800_DNS_TIMEOUT)
+            {
+                status = SIM800_TIMEOUT;
+                break;
+            }
+
+            SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+        }
+    }
+
+    remove_expected_code(handle, index);
+
+    if (status != SIM800_OK)
+    {
+        return status;
+    }
+
+    if (!dns->found)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The lookup may have taken long, the slot is chosen again
+    entry = dns_slot(handle, host);
+    strcpy(entry->host, host);
+    strcpy(entry->ip, dns->ip);
+    entry->tick = HAL_GetTick();
+
+    strcpy(ip, dns->ip);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Drops a host name from the DNS cache, e.g. when a connection to its cached address fails.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *host: Host name, NULL - all of them.
+ */
+void SIM800_DNSInvalidate(SIM800_Handle_t *handle, const char *host)
+{
+    for (uint8_t i = 0; i < SIM800_DNS_CACHE_SIZE; i++)
+    {
+        if (host == NULL || strcmp(handle->dns.entries[i].host, host) == 0)
+        {
+            handle->dns.entries[i].host[0] = '\0';
+        }
+    }
+}
+
+
+/**
+ * @brief   Prepares the TCP/UDP sockets and brings up the GPRS bearer.
+ *
+ * The module is switched to the multi-connection mode ("AT+CIPMUX=1"), so up to SIM800_SOCKET_COUNT
+ * connections share it, and the bearer is brought up, see SIM800_BearerUp. From then on
+ * "n, CONNECT OK", "n, CLOSED" and the data of "+RECEIVE" are handled as notifications by the response
+ * dispatcher, see SIM800_SocketCallBack. The module must be registered to the network.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketInit(SIM800_Handle_t *handle)
+{
+    SIM800_Status_t status;
+    // The codes are kept by reference, one constant string per socket number
+    static const char codes[] = "0\0" "1\0" "2\0" "3\0" "4\0" "5";
+    uint8_t index;
+
+    if (handle->transparent != SIM800_Transparent_Off)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (handle->socketNotifications == 0)
+    {
+        if (handle->expected_codes_count + SIM800_SOCKET_COUNT + 1 > EXPECTED_CODES_MAX_COUNT - 2)
+        {
+            // Keep room for the commands and the batches
+            return SIM800_ERROR;
+        }
+
+        // The per-connection lines start with the socket number, "<n>, CONNECT OK"
+        for (uint8_t i = 0; i < SIM800_SOCKET_COUNT; i++)
+        {
+            add_pending_message(handle, &codes[2 * i], &socket_parser, &handle->sockets[i], NULL);
+            handle->sockets[i].state = SIM800_Socket_Closed;
+        }
+
+        index = add_pending_message(handle, "+RECEIVE", &receive_parser, NULL, NULL);
+        handle->socketNotifications = index + 1;
+    }
+
+    // The connection mode can only be changed while the bearer is down
+    if (handle->bearer.state != SIM800_Bearer_Up &&
+        (status = execute_command(handle, SIM800_Cmd_SocketMux, "1", NULL, NULL)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    return SIM800_BearerUp(handle);
+}
+
+
+/**
+ * @brief   Opens a TCP or UDP connection.
+ *
+ * The function returns as soon as the module accepts "AT+CIPSTART", the connection is established
+ * later: the socket state becomes SIM800_Socket_Connected and SIM800_SocketCallBack is invoked with
+ * SIM800_SocketEvent_Connected or SIM800_SocketEvent_ConnectFailed. Data received before the
+ * connection is opened again is dropped. A host name is resolved through the DNS cache, see SIM800_Resolve.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_SocketInit.
+ * @param   socket: Socket number, 0 ... SIM800_SOCKET_COUNT - 1.
+ * @param   type: SIM800_Socket_TCP or SIM800_Socket_UDP.
+ * @param   *host: Remote host name or IP address, at most SIM800_SOCKET_HOST_MAX characters.
+ * @param   port: Remote port.
+ * @retval  SIM800_OK if the connection is being opened, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketOpen(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketType_t type,
+                                  const char *host, uint16_t port)
+{
+    char arg[SIM800_SOCKET_HOST_MAX + 24];
+    char number[11];
+    char ip[16];
+    SIM800_Status_t status;
+    size_t len = strlen(host);
+
+    if (handle->socketNotifications == 0 || socket >= SIM800_SOCKET_COUNT ||
+        handle->sockets[socket].state != SIM800_Socket_Closed || len == 0 || len > SIM800_SOCKET_HOST_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    // <n>,"<mode>","<address>",<port>
+    arg[0] = '0' + socket;
+    arg[1] = '\0';
+    strcat(arg, type == SIM800_Socket_UDP ? ",\"UDP\",\"" : ",\"TCP\",\"");
+    strcat(arg, dns_address(handle, host, ip));
+    strcat(arg, "\",");
+    uint_to_str(port, number);
+    strcat(arg, number);
+
+    handle->sockets[socket].rxHead = 0;
+    handle->sockets[socket].rxTail = 0;
+
+    if ((status = execute_command(handle, SIM800_Cmd_SocketOpen, arg, NULL, NULL)) == SIM800_OK &&
+        handle->sockets[socket].state == SIM800_Socket_Closed)
+    {
+        handle->sockets[socket].state = SIM800_Socket_Connecting;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Sends data over an open connection.
+ *
+ * The data is sent on the "> " prompt of "AT+CIPSEND" straight from the caller's buffer, the function
+ * returns when the module reports "n, SEND OK" (or "n, SEND FAIL").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send, at most SIM800_SOCKET_TX_MAX.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketSend(SIM800_Handle_t *handle, uint8_t socket, const uint8_t *data, uint16_t length)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitSocketSend(handle, socket, data, length, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Sends a data block scattered over several buffers over an open connection.
+ *
+ * The pieces make up one "AT+CIPSEND" and are sent straight from the caller's buffers, no piece is
+ * copied or needs a terminating NUL, see SIM800_SubmitSocketSendV.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *iov: Pieces of the data block.
+ * @param   count: Count of pieces, the total length is at most SIM800_SOCKET_TX_MAX.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketSendV(SIM800_Handle_t *handle, uint8_t socket, const SIM800_IOVec_t *iov, uint8_t count)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitSocketSendV(handle, socket, iov, count, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Reads the data received by a connection.
+ *
+ * The data of "+RECEIVE" is buffered per socket as it arrives (SIM800_SOCKET_RX_LENGTH bytes, the
+ * bytes that do not fit are counted in rxDropped), this function takes it out of the buffer.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *buffer: Destination buffer.
+ * @param   size: Size of the destination buffer.
+ * @retval  Count of bytes copied, 0 if there is no data.
+ */
+uint16_t SIM800_SocketRecv(SIM800_Handle_t *handle, uint8_t socket, uint8_t *buffer, uint16_t size)
+{
+    SIM800_Socket_t *sock;
+    uint16_t count = 0;
+
+    if (socket >= SIM800_SOCKET_COUNT)
+    {
+        return 0;
+    }
+
+    sock = &handle->sockets[socket];
+
+    while (count < size && sock->rxTail != sock->rxHead)
+    {
+        buffer[count++] = sock->rx[sock->rxTail++ & (SIM800_SOCKET_RX_LENGTH - 1)];
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Closes a connection.
+ *
+ * The function returns when the module reports "n, CLOSE OK". The buffered received data can
+ * still be read by SIM800_SocketRecv.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketClose(SIM800_Handle_t *handle, uint8_t socket)
+{
+    char arg[2] = { 0 };
+    SIM800_Status_t status;
+
+    if (socket >= SIM800_SOCKET_COUNT || handle->sockets[socket].state == SIM800_Socket_Closed)
+    {
+        return SIM800_ERROR;
+    }
+
+    arg[0] = '0' + socket;
+
+    status = execute_command(handle, SIM800_Cmd_SocketClose, arg, NULL, NULL);
+
+    // The connection is gone once the module refuses to close it as well
+    if (status != SIM800_TIMEOUT)
+    {
+        handle->sockets[socket].state = SIM800_Socket_Closed;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Manages the manual receive mode of the sockets ("AT+CIPRXGET=1").
+ *
+ * In manual mode the module keeps the received data and only reports that some is waiting
+ * ("+CIPRXGET: 1,<n>", SIM800_SocketEvent_Pending), so no payload is interleaved with the command
+ * responses. The data is then read by SIM800_SocketRead. The mode must be set before the connections
+ * are opened.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_SocketInit.
+ * @param   enordi: ENABLE to read the data with SIM800_SocketRead, DISABLE to receive it with "+RECEIVE".
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_ManageManualReceive(SIM800_Handle_t *handle, uint8_t enordi)
+{
+    SIM800_Status_t status;
+    uint8_t index;
+
+    if (handle->socketNotifications == 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((status = execute_command(handle, SIM800_Cmd_SocketRxGet, enordi == ENABLE ? "1" : "0", NULL, NULL)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    if (enordi == ENABLE && handle->socketManual == 0)
+    {
+        if ((index = add_pending_message(handle, "+CIPRXGET", &ciprxget_urc_parser, NULL, NULL)) == 0xFF)
+        {
+            return SIM800_ERROR;
+        }
+        handle->socketManual = index + 1;
+    }
+    else if (enordi != ENABLE && handle->socketManual != 0)
+    {
+        remove_expected_code(handle, handle->socketManual - 1);
+        handle->socketManual = 0;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Reads the data waiting in the module in manual receive mode.
+ *
+ * The data is drained by "AT+CIPRXGET=2,<n>,<length>" commands of at most SIM800_SOCKET_TX_MAX bytes
+ * until the buffer is full or nothing is left. The payload of every response is copied by SIM800_Process
+ * straight into the buffer, it is not parsed as lines.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_ManageManualReceive.
+ * @param   socket: Socket number.
+ * @param   *buffer: Destination buffer.
+ * @param   size: Size of the destination buffer.
+ * @param   *length: Pointer to store the count of bytes read.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketRead(SIM800_Handle_t *handle, uint8_t socket, uint8_t *buffer, uint16_t size,
+                                  uint16_t *length)
+{
+    blocking_result_t result;
+    SIM800_SocketRead_t read;
+    SIM800_Status_t status = SIM800_OK;
+
+    *length = 0;
+
+    while (*length < size)
+    {
+        read.buffer = buffer + *length;
+        read.size = size - *length;
+        result.status = SIM800_ERROR;
+        result.done = 0;
+
+        if (SIM800_SubmitSocketRead(handle, socket, &read, &blocking_done, &result) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+
+        if ((status = wait_for_request(handle, &result)) != SIM800_OK)
+        {
+            break;
+        }
+
+        *length += read.length;
+
+        if (read.length == 0 || read.remaining == 0)
+        {
+            break;
+        }
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Prepares the transparent data pipe and brings up the GPRS connection.
+ *
+ * Transparent mode ("AT+CIPMODE=1") carries one connection: once it is open, every byte sent or
+ * received belongs to it, so bulk transfers (e.g., firmware or log uploads) need no "AT+CIPSEND"
+ * prompt per chunk. The module is switched to the single-connection mode ("AT+CIPMUX=0"), the DCD
+ * line is made to follow the carrier ("AT&C1", see SIM800_DCDHandler) and the bearer is brought up,
+ * see SIM800_BearerUp. Transparent mode and the sockets of SIM800_SocketInit exclude each other.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_TransparentInit(SIM800_Handle_t *handle)
+{
+    SIM800_Status_t status;
+
+    if (handle->socketNotifications != 0 || handle->transparent > SIM800_Transparent_Idle)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The connection mode can only be changed while the bearer is down
+    if (handle->bearer.state != SIM800_Bearer_Up &&
+        ((status = execute_command(handle, SIM800_Cmd_SocketMux, "0", NULL, NULL)) != SIM800_OK ||
+         (status = execute_command(handle, SIM800_Cmd_SocketMode, "1", NULL, NULL)) != SIM800_OK))
+    {
+        return status;
+    }
+
+    if ((status = execute_command(handle, SIM800_Cmd_CarrierDetect, NULL, NULL, NULL)) != SIM800_OK ||
+        (status = SIM800_BearerUp(handle)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    handle->transparent = SIM800_Transparent_Idle;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Opens the connection of the transparent data pipe and enters data mode.
+ *
+ * The function returns once the module reports "CONNECT". From then on the received bytes are handed
+ * to SIM800_TransparentRxCallBack straight from the receive ring, SIM800_TransparentSend queues the data
+ * to send, and the commands of the blocking and SIM800_Submit functions are held back until the pipe
+ * leaves data mode (SIM800_TransparentEscape, or the loss of the carrier). A host name is resolved
+ * through the DNS cache, see SIM800_Resolve.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_TransparentInit.
+ * @param   type: SIM800_Socket_TCP or SIM800_Socket_UDP.
+ * @param   *host: Remote host name or IP address, at most SIM800_SOCKET_HOST_MAX characters.
+ * @param   port: Remote port.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_TransparentOpen(SIM800_Handle_t *handle, SIM800_SocketType_t type, const char *host, uint16_t port)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+    SIM800_RequestOptions_t options;
+    char arg[SIM800_SOCKET_HOST_MAX + 24];
+    char number[11];
+    char ip[16];
+    uint32_t tickStart;
+    size_t len = strlen(host);
+
+    if (handle->transparent != SIM800_Transparent_Idle || len == 0 || len > SIM800_SOCKET_HOST_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    // "<mode>","<address>",<port>
+    strcpy(arg, type == SIM800_Socket_UDP ? "\"UDP\",\"" : "\"TCP\",\"");
+    strcat(arg, dns_address(handle, host, ip));
+    strcat(arg, "\",");
+    uint_to_str(port, number);
+    strcat(arg, number);
+
+    // The pipe is marked as connecting before the next request can be sent
+    if (submit_request(handle, SIM800_Cmd_SocketOpen, arg, NULL, NULL, &transparent_open_done, &result,
+                       take_options(handle, &options)) == NULL ||
+        wait_for_request(handle, &result) != SIM800_OK)
+    {
+        return result.done ? result.status : SIM800_ERROR;
+    }
+
+    tickStart = HAL_GetTick();
+
+    while (handle->transparent == SIM800_Transparent_Connecting)
+    {
+        executor_poll(handle);
+
+        if (HAL_GetTick() - tickStart > SIM800_TRANSPARENT_CONNECT_TIMEOUT)
+        {
+            handle->transparent = SIM800_Transparent_Idle;
+            return SIM800_TIMEOUT;
+        }
+
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+
+    return (handle->transparent == SIM800_Transparent_Online) ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Queues data for the connection of the transparent data pipe.
+ *
+ * The data is pinned and sent as it is, it must stay unchanged until the completion callback is invoked.
+ * It must not contain the "+++" escape sequence surrounded by SIM800_TRANSPARENT_GUARD of silence.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the data is queued, SIM800_ERROR if the pipe is not online or the data can not be queued.
+ */
+SIM800_Status_t SIM800_TransparentSend(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length,
+                                       SIM800_TxCallback_t done, void *ctx)
+{
+    if (handle->transparent != SIM800_Transparent_Online)
+    {
+        return SIM800_ERROR;
+    }
+
+    return tx_enqueue(handle, data, length, 0, done, ctx) == SIM800_OK ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Leaves data mode with the "+++" escape sequence, keeping the connection.
+ *
+ * The queued data is sent first. The sequence is surrounded by SIM800_TRANSPARENT_GUARD of silence;
+ * the bytes received during the first half of the guard after it still belong to the connection, then
+ * the received characters are parsed as lines again and the "OK" of the module is awaited. Commands can
+ * be executed afterwards, SIM800_TransparentResume returns to data mode.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the pipe is not online or the connection is lost, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_TransparentEscape(SIM800_Handle_t *handle)
+{
+    static const uint8_t escape[] = { '+', '+', '+' };
+    uint32_t tickStart = HAL_GetTick();
+    uint8_t index;
+
+    if (handle->transparent != SIM800_Transparent_Online)
+    {
+        return SIM800_ERROR;
+    }
+
+    // Silence before the sequence, counted from the end of the queued data
+    while (HAL_GetTick() - tickStart < SIM800_TRANSPARENT_GUARD)
+    {
+        executor_poll(handle);
+
+        if (handle->txHead != handle->txTail || handle->txBusy)
+        {
+            tickStart = HAL_GetTick();
+        }
+
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+
+    if (handle->transparent != SIM800_Transparent_Online ||
+        (index = add_pending_message(handle, "", NULL, NULL, NULL)) == 0xFF)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->transparent = SIM800_Transparent_Escaping;
+
+    if (tx_enqueue(handle, escape, sizeof(escape), 0, NULL, NULL) != SIM800_OK)
+    {
+        remove_expected_code(handle, index);
+        handle->transparent = SIM800_Transparent_Online;
+        return SIM800_ERROR;
+    }
+
+    tickStart = HAL_GetTick();
+
+    while (handle->expected_codes[index].state != SIM800_ReceivedStatus)
+    {
+        executor_poll(handle);
+
+        if (handle->transparent == SIM800_Transparent_Escaping &&
+            HAL_GetTick() - tickStart > SIM800_TRANSPARENT_GUARD / 2)
+        {
+            // The module stops forwarding data within the guard, its answer is a line
+            handle->transparent = SIM800_Transparent_EscapeAnswer;
+        }
+
+        if (handle->transparent == SIM800_Transparent_Idle)
+        {
+            remove_expected_code(handle, index);
+            return SIM800_ERROR;
+        }
+
+        if (HAL_GetTick() - tickStart > SIM800_TRANSPARENT_GUARD + SIM800_TIMEOUT_SHORT)
+        {
+            // The sequence has not been taken, the module is still in data mode
+            remove_expected_code(handle, index);
+            handle->transparent = SIM800_Transparent_Online;
+            return SIM800_TIMEOUT;
+        }
+
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+
+    remove_expected_code(handle, index);
+    handle->transparent = SIM800_Transparent_Suspended;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Returns to data mode after SIM800_TransparentEscape ("ATO").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_TransparentResume(SIM800_Handle_t *handle)
+{
+    if (handle->transparent != SIM800_Transparent_Suspended)
+    {
+        return SIM800_ERROR;
+    }
+
+    // "ATO" answers with "CONNECT" instead of a final result code, see transparent_line
+    return execute_command(handle, SIM800_Cmd_DataResume, NULL, NULL, NULL);
+}
+
+
+/**
+ * @brief   Closes the connection of the transparent data pipe.
+ *
+ * A pipe in data mode leaves it first, see SIM800_TransparentEscape.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_TransparentClose(SIM800_Handle_t *handle)
+{
+    SIM800_Status_t status;
+
+    if (handle->transparent == SIM800_Transparent_Online && (status = SIM800_TransparentEscape(handle)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    if (handle->transparent != SIM800_Transparent_Suspended)
+    {
+        return SIM800_ERROR;
+    }
+
+    // Quick close, answered with "CLOSE OK" instead of a final result code
+    status = execute_command(handle, SIM800_Cmd_SocketClose, "1", NULL, NULL);
+
+    if (status != SIM800_TIMEOUT)
+    {
+        handle->transparent = SIM800_Transparent_Idle;
+    }
+
+    return status;
+}
+
+
+#if SIM800_USE_HTTP
+
+/**
+ * @brief   Performs an HTTP GET request.
+ *
+ * The HTTP client runs on the bearer of the application layer ("AT+SAPBR", profile 1) configured with
+ * the access point of SIM800_BearerInit. That bearer is opened by the first request and left open, the
+ * following requests reuse it; it is only set up again when the module reports it closed. The body of the response is read by "AT+HTTPREAD" in chunks of SIM800_HTTP_READ_CHUNK bytes and
+ * handed to the body callback straight from the receive ring, so a response of any length needs no
+ * buffer of its size.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @param   *url: URL, at most SIM800_HTTP_URL_MAX characters, e.g. "http://example.com/config".
+ * @param   *status: Pointer to store the HTTP status code (6xx - network error reported by the module).
+ * @param   body: Callback receiving the body, NULL - the body is not read.
+ * @param   *ctx: Argument of the body callback.
+ * @retval  SIM800_OK if the request is performed, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_HttpGet(SIM800_Handle_t *handle, const char *url, uint16_t *status,
+                               SIM800_HttpBodyCallback_t body, void *ctx)
+{
+    handle->http.body = body;
+    handle->http.ctx = ctx;
+
+    return http_request(handle, url, NULL, NULL, 0, status);
+}
+
+
+/**
+ * @brief   Performs an HTTP POST request.
+ *
+ * The data is sent on the "DOWNLOAD" prompt of "AT+HTTPDATA" straight from the caller's buffer. The
+ * body of the response is handled as by SIM800_HttpGet.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @param   *url: URL, at most SIM800_HTTP_URL_MAX characters.
+ * @param   *contentType: Content type of the data, e.g. "application/json", NULL - the default of the module.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @param   *status: Pointer to store the HTTP status code.
+ * @param   body: Callback receiving the body of the response, NULL - the body is not read.
+ * @param   *ctx: Argument of the body callback.
+ * @retval  SIM800_OK if the request is performed, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_HttpPost(SIM800_Handle_t *handle, const char *url, const char *contentType,
+                                const uint8_t *data, uint16_t length, uint16_t *status,
+                                SIM800_HttpBodyCallback_t body, void *ctx)
+{
+    if (data == NULL || length == 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->http.body = body;
+    handle->http.ctx = ctx;
+
+    return http_request(handle, url, contentType, data, length, status);
+}
+
+#endif /* SIM800_USE_HTTP */
+
+
+#if SIM800_USE_FS
+
+/**
+ * @brief   Opens a file in the flash of the module (C:\User\<name>).
+ *
+ * The size of the file is read by "AT+FSFLSIZE"; a file that does not exist is created by "AT+FSCREATE"
+ * if asked to. The file keeps its content across restarts of the module, SIM800_FSDelete removes it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *file: Pointer to the file structure.
+ * @param   *name: Name of the file, at most SIM800_FS_NAME_MAX characters, without '\', ',' and '"'.
+ * @param   create: 1 to create the file if it does not exist, 0 to fail then.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_FSOpen(SIM800_Handle_t *handle, SIM800_File_t *file, const char *name, uint8_t create)
+{
+    SIM800_Status_t status;
+
+    if (name == NULL || !fs_name_valid(name))
+    {
+        return SIM800_ERROR;
+    }
+
+    strcpy(file->name, name);
+    file->size = 0;
+    file->busy = 0;
+
+    status = execute_command(handle, SIM800_Cmd_FSSize, file->name, NULL, &file->size);
+
+    if (status == SIM800_ERROR && create)
+    {
+        // The size of a file that does not exist is an error
+        file->size = 0;
+        status = execute_command(handle, SIM800_Cmd_FSCreate, file->name, NULL, NULL);
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Appends a block to a file.
+ *
+ * The block is sent on the "> " prompt of "AT+FSWRITE" straight from the caller's buffer, see
+ * SIM800_SubmitFSWrite.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *file: Pointer to the file structure, see SIM800_FSOpen.
+ * @param   *data: Data to append.
+ * @param   length: Count of bytes to append, at most SIM800_FS_CHUNK_MAX.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_FSWrite(SIM800_Handle_t *handle, SIM800_File_t *file, const uint8_t *data, uint16_t length)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+
+    if (SIM800_SubmitFSWrite(handle, file, data, length, &blocking_done, &result) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Submits a block to be appended to a file without waiting for it to be written.
+ *
+ * The block goes through the request queue like the data of a socket: it is sent on the "> " prompt of
+ * "AT+FSWRITE" straight from the caller's buffer, so data arriving faster than it is processed can be
+ * staged in the module without a copy. The size of the file grows once the module has written the block.
+ * Submit the next block of the file from the completion callback.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *file: Pointer to the file structure, see SIM800_FSOpen.
+ * @param   *data: Data to append, must stay unchanged until completion.
+ * @param   length: Count of bytes to append, at most SIM800_FS_CHUNK_MAX.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the block is submitted, SIM800_ERROR if a write of the file is in flight or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitFSWrite(SIM800_Handle_t *handle, SIM800_File_t *file, const uint8_t *data, uint16_t length,
+                                     SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitFSWriteEx(handle, file, data, length, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitFSWrite, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *file: Pointer to the file structure, see SIM800_FSOpen.
+ * @param   *data: Data to append, must stay unchanged until completion.
+ * @param   length: Count of bytes to append, at most SIM800_FS_CHUNK_MAX.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the block is submitted, SIM800_ERROR if a write of the file is in flight or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitFSWriteEx(SIM800_Handle_t *handle, SIM800_File_t *file, const uint8_t *data, uint16_t length,
+                                       SIM800_RequestCallback_t done, void *ctx,
+                                       const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+
+    if (file->busy || data == NULL || length == 0 || length > SIM800_FS_CHUNK_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    // <filename>,1,<size>,<inputtime>: the block is appended, the module waits up to 10 s for it
+    strcpy(file->arg, file->name);
+    strcat(file->arg, ",1,");
+    uint_to_str(length, file->arg + strlen(file->arg));
+    strcat(file->arg, ",10");
+
+    if ((req = claim_request(handle, SIM800_Cmd_FSWrite, file->arg, (const char *)data, NULL, &fs_write_done, file,
+                             options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+    req->dataLength = length;
+
+    file->length = length;
+    file->done = done;
+    file->ctx = ctx;
+    file->busy = 1;
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Reads a window of a file.
+ *
+ * The data of "AT+FSREAD" is copied from the receive ring straight into the buffer as it arrives, so a
+ * window needs no room in the ring. The window must lie within the file.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *file: Pointer to the file structure, see SIM800_FSOpen.
+ * @param   position: Offset of the window in the file.
+ * @param   *buffer: Buffer to store the window.
+ * @param   length: Count of bytes to read, at most SIM800_FS_CHUNK_MAX.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_FSRead(SIM800_Handle_t *handle, SIM800_File_t *file, uint32_t position, uint8_t *buffer,
+                              uint16_t length)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+    SIM800_RequestOptions_t options;
+    fs_read_t read = { buffer, length, 0 };
+    char arg[SIM800_FS_NAME_MAX + 24];
+    SIM800_Status_t status;
+
+    if (buffer == NULL || length == 0 || length > SIM800_FS_CHUNK_MAX || position > file->size ||
+        length > file->size - position)
+    {
+        return SIM800_ERROR;
+    }
+
+    // <filename>,1,<size>,<position>
+    strcpy(arg, file->name);
+    strcat(arg, ",1,");
+    uint_to_str(length, arg + strlen(arg));
+    strcat(arg, ",");
+    uint_to_str(position, arg + strlen(arg));
+
+    if (submit_request(handle, SIM800_Cmd_FSRead, arg, NULL, &read, &blocking_done, &result,
+                       take_options(handle, &options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((status = wait_for_request(handle, &result)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    return read.started ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Deletes a file.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *file: Pointer to the file structure, see SIM800_FSOpen.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_FSDelete(SIM800_Handle_t *handle, SIM800_File_t *file)
+{
+    SIM800_Status_t status;
+
+    if (file->busy)
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((status = execute_command(handle, SIM800_Cmd_FSDelete, file->name, NULL, NULL)) == SIM800_OK)
+    {
+        file->size = 0;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Sends a part of a file over an open connection.
+ *
+ * The part is read window by window into the buffer and every window is sent by one "AT+CIPSEND", so
+ * a payload of any size (e.g. the body of an HTTP POST after its header) needs only the buffer in the
+ * RAM of the MCU.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   *file: Pointer to the file structure, see SIM800_FSOpen.
+ * @param   position: Offset of the part in the file.
+ * @param   length: Count of bytes to send, the part must lie within the file.
+ * @param   *buffer: Buffer of a window.
+ * @param   size: Size of the buffer, windows of at most SIM800_SOCKET_TX_MAX bytes are sent.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_SocketSendFile(SIM800_Handle_t *handle, uint8_t socket, SIM800_File_t *file, uint32_t position,
+                                      uint32_t length, uint8_t *buffer, uint16_t size)
+{
+    SIM800_Status_t status;
+    uint16_t window;
+
+    if (buffer == NULL || size == 0 || position > file->size || length > file->size - position)
+    {
+        return SIM800_ERROR;
+    }
+
+    while (length != 0)
+    {
+        window = (length < size) ? length : size;
+        if (window > SIM800_SOCKET_TX_MAX)
+        {
+            window = SIM800_SOCKET_TX_MAX;
+        }
+
+        if ((status = SIM800_FSRead(handle, file, position, buffer, window)) != SIM800_OK ||
+            (status = SIM800_SocketSend(handle, socket, buffer, window)) != SIM800_OK)
+        {
+            return status;
+        }
+
+        position += window;
+        length -= window;
+    }
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_FS */
+
+#endif /* SIM800_USE_GPRS */
+
+
+/**
+ * @brief   Overrides the response timeout of the next request.
+ *
+ * The timeout applies to the next request submitted by a blocking or a SIM800_Submit function only,
+ * the following requests use the timeouts of the command table again. The requests the driver submits on its
+ * own never take it; see SIM800_RequestOptions_t for the options passed with the call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   timeout: Maximum response time (ms), 0 to use the timeout of the command table.
+ */
+void SIM800_SetTimeout(SIM800_Handle_t *handle, uint32_t timeout)
+{
+    handle->nextOptions.timeout = timeout;
+}
+
+
+/**
+ * @brief   Sets the deadline of the next request.
+ *
+ * The deadline applies to the next request submitted by a blocking or a SIM800_Submit function only. A request
+ * still queued at its deadline is dropped without being sent, a command in flight is aborted as by SIM800_Cancel;
+ * either way the request is finished with SIM800_TIMEOUT. The deadline bounds the response timeout of the
+ * command as well.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   deadline: Tick (HAL_GetTick) the request must be finished by, 0 - none.
+ */
+void SIM800_SetDeadline(SIM800_Handle_t *handle, uint32_t deadline)
+{
+    handle->nextOptions.deadline = deadline;
+}
+
+
+/**
+ * @brief   Sets the cancel token of the next request, see SIM800_Cancel.
+ *
+ * The token applies to the next request submitted by a blocking or a SIM800_Submit function only. Several
+ * requests may share a token, e.g. all the requests of one alarm.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   token: Token chosen by the application, 0 - none.
+ */
+void SIM800_SetCancelToken(SIM800_Handle_t *handle, uint32_t token)
+{
+    handle->nextOptions.token = token;
+}
+
+
+/**
+ * @brief   Cancels the requests carrying a cancel token.
+ *
+ * The queued requests are removed from the queue without being sent, their slots are free at once. The command
+ * in flight is aborted: a text data block waiting for its "> " prompt is left with ESC instead of being sent
+ * (e.g. "AT+CMGS", no message is sent), and a cancelled "AT+CIPSEND" or "AT+CIPSTART" is followed by
+ * "AT+CIPCLOSE" of its socket. The module still answers the aborted command, that answer is dropped, the next
+ * command is sent after it (or after SIM800_CANCEL_DRAIN).
+ *
+ * The completion callbacks are invoked with SIM800_ERROR before the function returns, with two exceptions that
+ * get it once their transfer is over: a fixed-length block (e.g. "AT+CIPSEND") waiting for its prompt, which the
+ * module takes in full, and the payload of a socket read being copied into its buffer. Call the function from the
+ * context of SIM800_Poll, e.g. from a callback.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   token: Cancel token given to SIM800_SetCancelToken, not 0.
+ * @retval  Count of cancelled requests.
+ */
+uint8_t SIM800_Cancel(SIM800_Handle_t *handle, uint32_t token)
+{
+    SIM800_Request_t *req = &handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)];
+    uint8_t count = 0;
+
+    if (token == 0)
+    {
+        return 0;
+    }
+
+    if (handle->reqTail != handle->reqHead && req->state != SIM800_Request_Queued && req->token == token &&
+        req->cancel == 0)
+    {
+        cancel_request(handle, req, SIM800_ERROR);
+        count++;
+    }
+
+    return count + drop_requests(handle, token);
+}
+
+
+/**
+ * @brief   Submits several queries combined into one command line.
+ *
+ * The queries are sent as one line, e.g. "AT+CBC;+CREG?", the module answers with the response
+ * line of every query followed by a single final result code. Every response line is handed to the
+ * parser of its own query. Only commands with a response code and without an argument can be combined.
+ * The status of every query is stored in its item; the completion callback gets SIM800_OK if all of them
+ * succeeded. The items must stay valid until completion.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *items: Array of the queries.
+ * @param   count: Count of queries, at most SIM800_BATCH_MAX_ITEMS.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the queries can not be combined or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitBatch(SIM800_Handle_t *handle, SIM800_BatchItem_t *items, uint8_t count,
+                                   SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_RequestOptions_t options;
+
+    return SIM800_SubmitBatchEx(handle, items, count, done, ctx, take_options(handle, &options));
+}
+
+
+/**
+ * @brief   Same as SIM800_SubmitBatch, with the options of the request passed with the call.
+ *
+ * The options set by SIM800_SetTimeout, SIM800_SetDeadline and SIM800_SetCancelToken stay for the next call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *items: Array of the queries.
+ * @param   count: Count of queries, at most SIM800_BATCH_MAX_ITEMS.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  SIM800_OK if the request is submitted, SIM800_ERROR if the queries can not be combined or the queue is full.
+ */
+SIM800_Status_t SIM800_SubmitBatchEx(SIM800_Handle_t *handle, SIM800_BatchItem_t *items, uint8_t count,
+                                     SIM800_RequestCallback_t done, void *ctx,
+                                     const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req;
+    const command_descriptor_t *desc;
+
+    if (count == 0 || count > SIM800_BATCH_MAX_ITEMS)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (items[i].cmd >= SIM800_Cmd_Count)
+        {
+            return SIM800_ERROR;
+        }
+
+        desc = &commands[items[i].cmd];
+        if (*desc->code == '\0' || *desc->suffix != '\0' || desc->command[strlen(desc->command) - 1] == '=')
+        {
+            return SIM800_ERROR; // The command has no response line or needs an argument
+        }
+    }
+
+    if ((req = claim_request(handle, items[0].cmd, NULL, NULL, NULL, done, ctx, options)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    req->batch = items;
+    req->batchCount = count;
+
+    if (options == NULL || options->timeout == 0)
+    {
+        // The module executes the queries one after another
+        req->timeout = 0;
+        for (uint8_t i = 0; i < count; i++)
+        {
+            req->timeout += commands[items[i].cmd].timeout;
+        }
+    }
+    commit_request(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Queues a data block for transmission to the SIM800 module.
+ *
+ * This function appends the block to the transmit queue and returns without waiting for it to be sent,
+ * so several blocks can be queued back-to-back. The block is pinned, not copied: the caller must keep
+ * the data unchanged until the completion callback is invoked. The callback is invoked from the
+ * TX-complete interrupt (or from SIM800_Process, see SIM800_TxCpltHandler).
+ * If the queue is full, the function waits until a slot is released.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if the queue stays full.
+ */
+SIM800_Status_t SIM800_Transmit(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length,
+                                SIM800_TxCallback_t done, void *ctx)
+{
+    return tx_enqueue(handle, data, length, 0, done, ctx);
+}
+
+
+/**
+ * @brief   Handles incoming characters from the SIM800 module in interrupt receiving mode.
+ *
+ * This function is called from HAL_UART_RxCpltCallback when handle->rxMode is SIM800_RxMode_IT.
+ * It only pushes the received character into the receive ring and re-arms the one-byte reception,
+ * the line parsing itself is done by SIM800_Process. If the ring is full the character is dropped
+ * and counted in handle->rxOverruns. With flow control enabled, the reception is not re-armed once
+ * the ring is filled to RX_HIGH_WATER, see SIM800_ManageFlowControl.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_MessageHandler(SIM800_Handle_t *handle)
+{
+#if SIM800_USE_ISR_BUDGET
+    uint32_t start = dwt_cycles();
+#endif
+    uint32_t head = handle->rxHead;
+
+    if (head - handle->rxTail < RX_RING_LENGTH)
+    {
+        handle->rxRing[head & (RX_RING_LENGTH - 1)] = handle->rcvdByte;
+
+        // Make sure the character is written before it is published to the consumer
+        __DMB();
+        handle->rxHead = head + 1;
+
+        // Wake a waiting task once a line (or the "> " prompt) is complete, not for every character
+        if (handle->rcvdByte == '\n' || (handle->rcvdByte == ' ' && handle->prompt == SIM800_Prompt_Waiting))
+        {
+            SIM800_OS_Signal(handle);
+        }
+    }
+    else
+    {
+        handle->rxOverruns++;
+    }
+
+    // If still in receive status, continue to receive characters
+    if (handle->recStatus == SIM800_Receives)
+    {
+        if (handle->flowControl && handle->rxHead - handle->rxTail >= RX_HIGH_WATER)
+        {
+            // Leave the next character in the UART, which drops RTS until SIM800_Process resumes
+            handle->rxStalled = 1;
+        }
+        else
+        {
+            HAL_UART_Receive_IT(handle->uart, (uint8_t *)&handle->rcvdByte, 1);
+        }
+    }
+
+#if SIM800_USE_ISR_BUDGET
+    isr_exit(handle, start);
+#endif
+}
+
+
+/**
+ * @brief   Handles a chunk of characters received by DMA from the SIM800 module.
+ *
+ * This function is called from HAL_UARTEx_RxEventCallback when handle->rxMode is SIM800_RxMode_DMA.
+ * The HAL reports an event on the UART IDLE line and when the circular buffer is full (or half full),
+ * with the position in the buffer up to which the DMA has written. The DMA writes straight into the
+ * receive ring, so this function only publishes the new characters to SIM800_Process by advancing
+ * the write index, taking the wrap-around of the circular buffer into account.
+ * The DMA keeps running, so nothing has to be re-armed. With flow control enabled, the DMA requests are
+ * paused once the ring is filled to RX_HIGH_WATER, see SIM800_ManageFlowControl.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   pos: Position in handle->rxRing reported by the HAL (Size argument of the callback).
+ */
+void SIM800_RxEventHandler(SIM800_Handle_t *handle, uint16_t pos)
+{
+#if SIM800_USE_ISR_BUDGET
+    uint32_t start = dwt_cycles();
+#endif
+    uint32_t head = handle->rxHead;
+
+    if (pos > RX_RING_LENGTH)
+    {
+        return;
+    }
+
+    // The DMA write position always equals the write index modulo the ring length
+    handle->rxHead = head + ((pos - head) & (RX_RING_LENGTH - 1));
+
+    if (handle->flowControl && !handle->rxStalled && handle->rxHead - handle->rxTail >= RX_HIGH_WATER)
+    {
+        // Stop reading the UART, which drops RTS until SIM800_Process resumes
+        handle->rxStalled = 1;
+        HAL_UART_DMAPause(handle->uart);
+    }
+
+    SIM800_OS_Signal(handle);
+
+#if SIM800_USE_ISR_BUDGET
+    isr_exit(handle, start);
+#endif
+}
+
+
+/**
+ * @brief   Handles the end of a transmission to the SIM800 module.
+ *
+ * This function is called from HAL_UART_TxCpltCallback. It releases the block that has been sent,
+ * invokes its completion callback and starts the next queued block right away, so the queue is
+ * drained without any waiting in the application. If the callback is not routed here, the finished
+ * transmissions are picked up by SIM800_Process instead, at the pace it is called.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_TxCpltHandler(SIM800_Handle_t *handle)
+{
+#if SIM800_USE_ISR_BUDGET
+    uint32_t start = dwt_cycles();
+#endif
+
+    if (handle->txBusy)
+    {
+        tx_complete(handle, SIM800_OK);
+    }
+
+    tx_start(handle);
+
+    SIM800_OS_Signal(handle);
+
+#if SIM800_USE_ISR_BUDGET
+    isr_exit(handle, start);
+#endif
+}
+
+
+/**
+ * @brief   Handles a receive error of the UART.
+ *
+ * This function is called from HAL_UART_ErrorCallback. The errors are counted by their type, see
+ * SIM800_GetStats. An overrun makes the HAL abort the reception: in interrupt mode it is armed again right
+ * away, in DMA mode SIM800_Process starts it again with an empty ring.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_ErrorHandler(SIM800_Handle_t *handle)
+{
+#if SIM800_USE_STATS
+    uint32_t error = handle->uart->ErrorCode;
+
+    handle->stats.uartOverruns += (error & HAL_UART_ERROR_ORE) != 0;
+    handle->stats.uartFraming += (error & HAL_UART_ERROR_FE) != 0;
+    handle->stats.uartNoise += (error & HAL_UART_ERROR_NE) != 0;
+    handle->stats.uartParity += (error & HAL_UART_ERROR_PE) != 0;
+#endif
+
+    if (handle->recStatus == SIM800_Receives && handle->uart->RxState == HAL_UART_STATE_READY)
+    {
+        if (handle->rxMode == SIM800_RxMode_DMA)
+        {
+            handle->rxRestart = 1;
+        }
+        else if (!handle->rxStalled)
+        {
+            HAL_UART_Receive_IT(handle->uart, (uint8_t *)&handle->rcvdByte, 1);
+        }
+    }
+
+    SIM800_OS_Signal(handle);
+}
+
+
+#if SIM800_USE_GPRS
+
+/**
+ * @brief   Handles a change of the DCD line of the module to "no carrier".
+ *
+ * Call this function from the EXTI interrupt of the pin connected to DCD (high - no carrier, see
+ * SIM800_TransparentInit). The bytes received so far are the last ones of the connection of the
+ * transparent pipe, the following characters are parsed as lines again by SIM800_Process.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_DCDHandler(SIM800_Handle_t *handle)
+{
+    if (transparent_data(handle) && !handle->carrierLost)
+    {
+        handle->carrierHead = handle->rxHead;
+        __DMB();
+        handle->carrierLost = 1;
+    }
+
+    SIM800_OS_Signal(handle);
+}
+
+#endif /* SIM800_USE_GPRS */
+
+
+#if SIM800_USE_SLEEP
+
+/**
+ * @brief   Handles the falling edge of the RI line of the module.
+ *
+ * Call this function from the EXTI interrupt of the pin connected to RI. The module pulls RI low for an
+ * incoming SMS message or call and, with "AT+CFGRI=1" (see SIM800_ManageSleep), for every notification.
+ * The interrupt ends the STOP mode of the MCU, SIM800_Poll pulls DTR low so the module stays awake for the
+ * commands that follow the notification.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_RIHandler(SIM800_Handle_t *handle)
+{
+    handle->sleep.ring = 1;
+
+    SIM800_OS_Signal(handle);
+}
+
+#endif /* SIM800_USE_SLEEP */
+
+
+/**
+ * @brief   Returns the handle of the modem connected to a UART.
+ *
+ * The handle is found in constant time in the table filled by SIM800_ManageReceiving. It lets one
+ * set of HAL UART callbacks serve any number of modems.
+ *
+ * @param   *huart: Pointer to the UART handle structure.
+ * @retval  Pointer to the SIM800 handle structure, NULL if no modem is connected to the UART.
+ */
+SIM800_Handle_t *SIM800_GetHandle(UART_HandleTypeDef *huart)
+{
+    uint32_t slot = uart_slot(huart);
+
+    for (uint32_t i = 0; i < UART_TABLE_SIZE; i++, slot = (slot + 1) & (UART_TABLE_SIZE - 1))
+    {
+        if (uart_table[slot] == NULL)
+        {
+            return NULL;
+        }
+
+        if (uart_table[slot]->uart == huart)
+        {
+            return uart_table[slot];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief   Routes a HAL receive complete event to the modem connected to the UART.
+ *
+ * Call this function from HAL_UART_RxCpltCallback, see SIM800_MessageHandler.
+ *
+ * @param   *huart: Pointer to the UART handle structure.
+ */
+void SIM800_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+    SIM800_Handle_t *handle = SIM800_GetHandle(huart);
+
+    if (handle != NULL)
+    {
+        SIM800_MessageHandler(handle);
+    }
+}
+
+
+/**
+ * @brief   Routes a HAL receive event to the modem connected to the UART.
+ *
+ * Call this function from HAL_UARTEx_RxEventCallback, see SIM800_RxEventHandler.
+ *
+ * @param   *huart: Pointer to the UART handle structure.
+ * @param   pos: Size argument of the HAL callback.
+ */
+void SIM800_UART_RxEventCallback(UART_HandleTypeDef *huart, uint16_t pos)
+{
+    SIM800_Handle_t *handle = SIM800_GetHandle(huart);
+
+    if (handle != NULL)
+    {
+        SIM800_RxEventHandler(handle, pos);
+    }
+}
+
+
+/**
+ * @brief   Routes a HAL transmit complete event to the modem connected to the UART.
+ *
+ * Call this function from HAL_UART_TxCpltCallback, see SIM800_TxCpltHandler.
+ *
+ * @param   *huart: Pointer to the UART handle structure.
+ */
+void SIM800_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+    SIM800_Handle_t *handle = SIM800_GetHandle(huart);
+
+    if (handle != NULL)
+    {
+        SIM800_TxCpltHandler(handle);
+    }
+}
+
+
+/**
+ * @brief   Routes a HAL error event to the modem connected to the UART.
+ *
+ * Call this function from HAL_UART_ErrorCallback, see SIM800_ErrorHandler.
+ *
+ * @param   *huart: Pointer to the UART handle structure.
+ */
+void SIM800_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+    SIM800_Handle_t *handle = SIM800_GetHandle(huart);
+
+    if (handle != NULL)
+    {
+        SIM800_ErrorHandler(handle);
+    }
+}
+
+
+/**
+ * @brief   Parses the characters received from the SIM800 module.
+ *
+ * This function scans the receive ring filled by SIM800_MessageHandler or SIM800_RxEventHandler
+ * for complete lines and processes them in place, handing every response line to the parser of its
+ * expected code and invoking the handlers. It is called by SIM800_Poll, which must be called regularly
+ * from the main loop or a task; the blocking functions of this library call it themselves while waiting
+ * for a response. The callbacks of the notifications (e.g., SIM800_NewSMSNotificationCallBack) are only posted
+ * here and invoked by SIM800_Poll afterwards, see SIM800_EventQueue_t; the other callbacks invoked from here
+ * must not call blocking functions.
+ * A line longer than RX_LINE_CHUNK_LENGTH is handed over in chunks as it arrives, so the length of a
+ * response is not limited by any buffer. While a data prompt is awaited, a line consisting of "> " is taken
+ * as the prompt as soon as it is received, without waiting for a newline that never comes. The ring space of a line is released as soon as it is parsed.
+ * The raw data announced by a "+RECEIVE" line is copied into the receive buffer of its socket, see SIM800_SocketRecv.
+ * In data mode of the transparent pipe the characters are not parsed at all, see SIM800_TransparentOpen.
+ * If the ring overruns, the buffered characters are discarded and the overrun is counted in handle->rxOverruns.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_Process(SIM800_Handle_t *handle)
+{
+    SIM800_Line_t line;
+    uint32_t head, end;
+    uint8_t newline;
+
+    if (handle->processing)
+    {
+        return;
+    }
+    handle->processing = 1;
+
+    tx_poll(handle);
+
+    head = handle->rxHead;
+
+    // Make sure the characters are read only after the write index
+    __DMB();
+
+#if SIM800_USE_STATS
+    handle->stats.rxBytes += head - handle->rxCounted;
+    handle->rxCounted = head;
+#endif
+
+    if (head - handle->rxTail > RX_RING_LENGTH)
+    {
+        // The DMA has overwritten characters that were not parsed yet, drop everything
+        handle->rxScan = head;
+        handle->rxLineStart = head;
+        handle->rxChunked = 0;
+#if SIM800_USE_GPRS
+        handle->rxRaw = 0;
+        handle->rxRawBuffer = NULL;
+#if SIM800_USE_HTTP
+        handle->rxRawHttp = 0;
+#endif
+        handle->carrierHead = head;
+#endif
+        handle->rxOverruns++;
+    }
+
+#if SIM800_USE_GPRS
+    if (handle->carrierLost)
+    {
+        transparent_rx(handle, head);
+    }
+#endif
+
+    if (handle->rawRx != NULL)
+    {
+        raw_rx(handle, head);
+    }
+
+    while (handle->rxScan != head)
+    {
+#if SIM800_USE_GPRS
+        if (handle->rxRaw != 0)
+        {
+            // The data of "+RECEIVE" follows its header line as it is, it is not split into lines
+            socket_rx(handle, head);
+            continue;
+        }
+
+        if (transparent_data(handle))
+        {
+            transparent_rx(handle, head);
+            continue;
+        }
+#endif
+
+        // Scan up to the end of the line, a chunk or the data prompt, which is checked once it has 2 characters
+        end = handle->rxLineStart + RX_LINE_CHUNK_LENGTH;
+        if (handle->prompt == SIM800_Prompt_Waiting && handle->rxScan - handle->rxLineStart < 2)
+        {
+            end = handle->rxLineStart + 2;
+        }
+        if ((int32_t)(head - end) < 0)
+        {
+            end = head;
+        }
+
+        newline = scan_newline(handle, end);
+
+        if (handle->prompt == SIM800_Prompt_Waiting && handle->rxScan - handle->rxLineStart == 2 &&
+            handle->rxRing[handle->rxLineStart & (RX_RING_LENGTH - 1)] == '>' &&
+            handle->rxRing[(handle->rxLineStart + 1) & (RX_RING_LENGTH - 1)] == ' ')
+        {
+            // The data prompt is not terminated, release it on its own
+#if SIM800_USE_TRACE
+            trace_rx(handle, handle->rxLineStart, 2);
+#endif
+            handle->prompt = SIM800_Prompt_Received;
+            handle->rxLineStart = handle->rxScan;
+            handle->rxTail = handle->rxLineStart;
+            continue;
+        }
+
+        if (!newline && handle->rxScan - handle->rxLineStart < RX_LINE_CHUNK_LENGTH)
+        {
+            continue;
+        }
+
+        // A complete line (or a chunk of a long one) is received, describe it without the "\r\n" terminator
+        line.start = handle->rxLineStart;
+        line.length = handle->rxScan - newline - handle->rxLineStart;
+        line.continued = handle->rxChunked;
+        line.complete = newline;
+        if (line.length && line_char(handle, &line, line.length - 1) == '\r')
+        {
+            line.length--;
+        }
+#if SIM800_USE_TRACE
+        trace_rx(handle, line.start, handle->rxScan - line.start);
+#endif
+        handle->rxLineStart = handle->rxScan;
+        handle->rxChunked = !newline;
+
+        process_line(handle, &line);
+
+        // The line is parsed, its ring space can be reused
+        handle->rxTail = handle->rxLineStart;
+    }
+
+    if (handle->rxStalled && handle->rxHead - handle->rxTail <= RX_LOW_WATER)
+    {
+        resume_receiving(handle);
+    }
+
+    if (handle->rxRestart)
+    {
+        // The DMA has been stopped by a receive error, the line being received is lost with it
+        handle->rxRestart = 0;
+        handle->rxStalled = 0;
+        if (handle->recStatus == SIM800_Receives)
+        {
+            start_receiving(handle);
+        }
+    }
+
+    handle->processing = 0;
+}
+
+
+/**
+ * @brief   Drives the SIM800 module communication.
+ *
+ * This function must be called regularly from the main loop or a task instead of SIM800_Process.
+ * It parses the received characters (see SIM800_Process) and advances the submitted requests:
+ * it sends the command of the next request, sends its data block on the "> " prompt, checks
+ * the timeouts and invokes the completion callbacks. It never waits.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+void SIM800_Poll(SIM800_Handle_t *handle)
+{
+    SIM800_Process(handle);
+
+#if SIM800_USE_SLEEP
+    sleep_poll(handle);
+#endif
+
+    // A finished request lets the next one start right away, no command is started in data mode
+    while (handle->reqTail != handle->reqHead &&
+#if SIM800_USE_GPRS
+           (!transparent_busy(handle) ||
+            handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)].state != SIM800_Request_Queued) &&
+#endif
+           step_request(handle, &handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)]))
+    {
+    }
+
+    // The requests waiting behind past their deadline free their slots
+    drop_requests(handle, 0);
+
+    dispatch_events(handle);
+    flow_poll(handle);
+    ussd_poll(handle);
+
+#if SIM800_USE_SMS
+    sms_release_flush(handle);
+    sms_batch_fill(handle);
+    sms_sched_fill(handle);
+#if SIM800_USE_PDU
+    long_sms_expire(handle);
+#endif
+#endif
+    cache_refresh(handle);
+#if SIM800_USE_PHONEBOOK
+    phonebook_poll(handle);
+#endif
+    signal_poll(handle);
+#if SIM800_USE_REG_CACHE
+    reg_cache_poll(handle);
+#endif
+#if SIM800_USE_SMS
+    sms_delete_flush(handle);
+#endif
+#if SIM800_USE_GPRS
+    bearer_poll(handle);
+#endif
+    watchdog_poll(handle);
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Adds an expected message code to the SIM800 module handler.
+ *
+ * This function adds an expected message code to the list of codes that the SIM800 module handler should watch for.
+ * It also allows specifying a custom message handler function that will be called when the expected code is received.
+ * The code is linked into the dispatch bucket selected by its hash, so received lines find it without a scan.
+ * If the maximum number of expected codes is reached or if the provided code is too long, the function returns 0xFF,
+ * indicating an error. The free entry is found and taken with the interrupts disabled, so tasks submitting
+ * requests at the same time never take the same entry.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *code: Expected message code to watch for (e.g., "+CMGS"), a constant string, it is not copied.
+ * @param   parser: Parser called for every response line of the code, may be NULL.
+ * @param   *response: Structure filled by the parser, may be NULL.
+ * @param   messageHandler: Custom message handler function to call upon receiving the expected code.
+ * @retval  The index under which the code is added or 0xFF on error.
+ */
+static uint8_t add_pending_message(SIM800_Handle_t *handle, const char *code, response_parser_t parser, void *response,
+                                   void (*messageHandler)(void*, uint32_t))
+{
+    size_t code_len = strlen(code);
+    uint32_t bucket = code_hash(code, code_len);
+    uint32_t primask;
+
+    if (code_len >= CODE_MAX_LENGTH)
+    {
+        return 0xFF; // Error: Code is too long
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    for (uint32_t i = 0; i < EXPECTED_CODES_MAX_COUNT; i++)
+    {
+        if (handle->expected_codes[i].state == SIM800_DoesntExpects)
+        {
+            // Store the code, its length, and the associated message handler (if any)
+            handle->expected_codes[i].code = code;
+            handle->expected_codes[i].code_length = code_len;
+            handle->expected_codes[i].handle = messageHandler;
+            handle->expected_codes[i].parser = parser;
+            handle->expected_codes[i].response = response;
+            handle->expected_codes[i].parsed = SIM800_ERROR;
+            handle->expected_codes[i].state = SIM800_WaitingFor;
+
+            // Link the code into its dispatch bucket
+            handle->expected_codes[i].next = handle->dispatch[bucket];
+            handle->dispatch[bucket] = i + 1;
+
+            // Increase the count of expected codes
+            handle->expected_codes_count++;
+
+            // Set the current processed packet index
+            handle->curProccesPacket_index = i;
+
+            __set_PRIMASK(primask);
+            return i; // Return the index under which the code is added
+        }
+    }
+
+    __set_PRIMASK(primask);
+    return 0xFF; // Error: Maximum expected codes count reached
+}
+
+
+/**
+ * @brief   Removes an expected message code from the SIM800 module handler.
+ *
+ * This function removes an expected message code from the list of codes that the SIM800 module handler watches for.
+ * It takes the index of the code to remove, unlinks it from its dispatch bucket and clears the corresponding
+ * data structure. Additionally, it decreases the count of expected codes.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code to remove.
+ */
+static void remove_expected_code(SIM800_Handle_t *handle, uint8_t index)
+{
+    uint32_t primask;
+    uint8_t *link;
+
+    if (index >= EXPECTED_CODES_MAX_COUNT)
+    {
+        return;
+    }
+
+    primask = __get_PRIMASK();
+    __disable_irq();
+
+    // Unlink the code from its dispatch bucket
+    link = &handle->dispatch[code_hash(handle->expected_codes[index].code, handle->expected_codes[index].code_length)];
+    while (*link != 0 && *link != index + 1)
+    {
+        link = &handle->expected_codes[*link - 1].next;
+    }
+    if (*link != 0)
+    {
+        *link = handle->expected_codes[index].next;
+    }
+
+    memset(&handle->expected_codes[index], 0, sizeof(handle->expected_codes[index]));
+    handle->expected_codes_count--;
+
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief   Starts receiving data from the SIM800 module in the mode selected by handle->rxMode.
+ *
+ * In interrupt mode a one-byte reception is armed. In DMA mode a circular DMA reception with
+ * idle-line detection is started over the whole handle->rxRing.
+ * A handle with a link only starts with an empty ring.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+static SIM800_Status_t start_receiving(SIM800_Handle_t *handle)
+{
+    // Start with an empty ring, in DMA mode the write index must match the DMA position
+    handle->rxHead = 0;
+    handle->rxTail = 0;
+    handle->rxScan = 0;
+    handle->rxLineStart = 0;
+    handle->rxChunked = 0;
+#if SIM800_USE_STATS
+    handle->rxCounted = 0;
+#endif
+
+    if (handle->link != NULL)
+    {
+        // The characters are written by SIM800_LinkInput
+        return handle->link->receive != NULL ? handle->link->receive(handle, ENABLE, handle->linkCtx) : SIM800_OK;
+    }
+
+    if (handle->rxMode == SIM800_RxMode_DMA)
+    {
+        if (HAL_UARTEx_ReceiveToIdle_DMA(handle->uart, handle->rxRing, RX_RING_LENGTH) != HAL_OK)
+        {
+            return SIM800_ERROR;
+        }
+
+        return SIM800_OK;
+    }
+
+    if (HAL_UART_Receive_IT(handle->uart, (uint8_t *)&handle->rcvdByte, 1) != HAL_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Registers the handle for its UART, see SIM800_GetHandle.
+ *
+ * The table is open addressed, a handle is stored at the slot selected by its UART or at the next
+ * free one. Registering an already registered handle does nothing.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the UART belongs to another handle or the table is full.
+ */
+static SIM800_Status_t register_uart(SIM800_Handle_t *handle)
+{
+    uint32_t slot = uart_slot(handle->uart);
+    SIM800_Handle_t *owner = SIM800_GetHandle(handle->uart);
+
+    if (owner != NULL)
+    {
+        return owner == handle ? SIM800_OK : SIM800_ERROR;
+    }
+
+    for (uint32_t i = 0; i < UART_TABLE_SIZE; i++, slot = (slot + 1) & (UART_TABLE_SIZE - 1))
+    {
+        if (uart_table[slot] == NULL)
+        {
+            uart_table[slot] = handle;
+            return SIM800_OK;
+        }
+    }
+
+    return SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Reconfigures the baud rate and the hardware flow control of the UART.
+ *
+ * The queued transmissions are sent with the old configuration first. The reception is stopped while
+ * the UART is reconfigured and restarted with an empty ring afterwards. A link is reconfigured by
+ * link->configure.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   baud: Baud rate to set.
+ * @param   flow: Hardware flow control to set, UART_HWCONTROL_NONE or UART_HWCONTROL_RTS_CTS.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+static SIM800_Status_t configure_uart(SIM800_Handle_t *handle, uint32_t baud, uint32_t flow)
+{
+    uint32_t tickStart = HAL_GetTick();
+
+    while (handle->txBusy || handle->txTail != handle->txHead)
+    {
+        tx_poll(handle);
+
+        if (HAL_GetTick() - tickStart > SIM800_MAX_DELAY)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    if (handle->link != NULL)
+    {
+        if (handle->link->configure == NULL)
+        {
+            return SIM800_ERROR;
+        }
+
+        if (handle->link->receive != NULL)
+        {
+            handle->link->receive(handle, DISABLE, handle->linkCtx);
+        }
+
+        handle->rxStalled = 0;
+        if (handle->link->configure(handle, baud, flow, handle->linkCtx) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+    }
+    else
+    {
+        HAL_UART_AbortReceive(handle->uart);
+
+        handle->uart->Init.BaudRate = baud;
+        handle->uart->Init.HwFlowCtl = flow;
+        handle->rxStalled = 0;
+        if (HAL_UART_Init(handle->uart) != HAL_OK)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    if (handle->recStatus == SIM800_Receives)
+    {
+        return start_receiving(handle);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Returns the baud rate of the UART or of the link of the handle.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  Baud rate, 0 if the link does not have one.
+ */
+static uint32_t uart_baud(SIM800_Handle_t *handle)
+{
+    if (handle->link != NULL)
+    {
+        return handle->link->baud != NULL ? handle->link->baud(handle, handle->linkCtx) : 0;
+    }
+
+    return handle->uart->Init.BaudRate;
+}
+
+
+/**
+ * @brief   Returns the hardware flow control of the UART or of the link of the handle.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  UART_HWCONTROL_NONE or UART_HWCONTROL_RTS_CTS.
+ */
+static uint32_t uart_flow(SIM800_Handle_t *handle)
+{
+    if (handle->link != NULL)
+    {
+        return handle->flowControl ? UART_HWCONTROL_RTS_CTS : UART_HWCONTROL_NONE;
+    }
+
+    return handle->uart->Init.HwFlowCtl;
+}
+
+
+/**
+ * @brief   Restarts the reception stopped at the high-water mark.
+ *
+ * In interrupt mode the next character is still held by the UART and is received as soon as the
+ * reception is re-armed, in DMA mode the DMA requests are enabled again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void resume_receiving(SIM800_Handle_t *handle)
+{
+    handle->rxStalled = 0;
+
+    if (handle->recStatus != SIM800_Receives)
+    {
+        return;
+    }
+
+    if (handle->link != NULL)
+    {
+        if (handle->link->receive != NULL)
+        {
+            handle->link->receive(handle, ENABLE, handle->linkCtx);
+        }
+    }
+    else if (handle->rxMode == SIM800_RxMode_DMA)
+    {
+        HAL_UART_DMAResume(handle->uart);
+    }
+    else
+    {
+        HAL_UART_Receive_IT(handle->uart, (uint8_t *)&handle->rcvdByte, 1);
+    }
+}
+
+
+/**
+ * @brief   Checks that the module answers at the current baud rate.
+ *
+ * Up to SIM800_BAUD_PROBES "AT" commands are sent, the first ones after a rate change may be lost.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK if the module answers, SIM800_ERROR otherwise.
+ */
+static SIM800_Status_t verify_link(SIM800_Handle_t *handle)
+{
+    for (uint8_t i = 0; i < SIM800_BAUD_PROBES; i++)
+    {
+        if (execute_command(handle, SIM800_Cmd_Status, NULL, NULL, NULL) == SIM800_OK)
+        {
+            return SIM800_OK;
+        }
+    }
+
+    return SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Selects the slot of a UART in the handle table.
+ *
+ * The UART handles are usually an array or consecutive variables, so their address divided by
+ * their size gives distinct slots.
+ *
+ * @param   *huart: Pointer to the UART handle structure.
+ * @retval  Index of the slot in the handle table.
+ */
+static uint32_t uart_slot(UART_HandleTypeDef *huart)
+{
+    return ((uintptr_t)huart / sizeof(UART_HandleTypeDef)) & (UART_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief   Processes one line received from the SIM800 module.
+ *
+ * This function checks a complete line for specific responses or expected codes.
+ * If a final result code is received ("OK", "ERROR", "+CME ERROR: <n>" or "+CMS ERROR: <n>", see final_result),
+ * it stores the result in the expected code of the command in flight (see result_index), whatever notification
+ * has been received since the command was sent, sets the received status to SIM800_ReceivedStatus, and invokes
+ * the associated handler if available.
+ * If a known expected code is received, it hands the line to the parser of the corresponding expected
+ * code and sets the received status to SIM800_Received. A line taken by a notification code and by the
+ * code of the command in flight (e.g., "+CREG: " of "AT+CREG?") is followed by the lines of the command.
+ * The expected code is looked up by the hash of the line code (the characters before ':' or ',', or the
+ * whole line), so the cost does not depend on how many codes are registered. It also invokes the
+ * associated handler if available.
+ * If none of the expected codes match, the line is handed to the parser of the current expected code as
+ * part of its response, as is every continuation chunk of a long line. For a current expected code without
+ * a code but with a parser, such a line is the first line of its response. "DOWNLOAD" releases a waiting
+ * data prompt.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the received line.
+ */
+static void process_line(SIM800_Handle_t *handle, SIM800_Line_t *line)
+{
+    SIM800_ExpectedCode_t *current = &handle->expected_codes[handle->curProccesPacket_index];
+    uint8_t command = result_index(handle);
+    size_t code_len;
+    uint8_t flag = 1; // Flag to check if the first part of a response (e.g., +CODE) is received
+
+    if (line->continued)
+    {
+        // The rest of a long line belongs to whatever its first chunk belonged to
+        if (current->state == SIM800_Received)
+        {
+            consume_line(handle, handle->curProccesPacket_index, line);
+        }
+        return;
+    }
+
+    if (line->length == 0)
+    {
+#if SIM800_USE_FS
+        fs_read_start(handle);
+#endif
+        return;
+    }
+
+#if SIM800_USE_STATS
+    handle->stats.lines++;
+#endif
+
+    if (handle->prompt == SIM800_Prompt_Waiting && line_equals(handle, line, "DOWNLOAD"))
+    {
+        // The data prompt of "AT+HTTPDATA" is a line of its own
+        handle->prompt = SIM800_Prompt_Received;
+        return;
+    }
+
+    if (final_result(handle, line, &handle->expected_codes[command].result))
+    {
+        // The final result code ends the command, a notification never takes it
+        handle->curProccesPacket_index = command;
+        current = &handle->expected_codes[command];
+
+#if SIM800_USE_LATENCY
+        latency_line(handle, command);
+#endif
+
+        // Set the received status to SIM800_ReceivedStatus
+        current->state = SIM800_ReceivedStatus;
+
+        // Invoke the associated handler if available
+        if (current->handle != NULL)
+        {
+            current->handle(handle, command);
+        }
+
+        return;
+    }
+
+    // Only the expected codes of the bucket selected by the line code have to be compared
+    for (uint8_t next = handle->dispatch[line_code_hash(handle, line, &code_len)]; next != 0; )
+    {
+        uint8_t i = next - 1;
+        next = handle->expected_codes[i].next;
+
+        if (handle->expected_codes[i].state == SIM800_WaitingFor && code_len &&
+            handle->expected_codes[i].code_length == code_len &&
+            line_starts_with(handle, line, handle->expected_codes[i].code, code_len))
+        {
+            // Update the current processed packet index, unless an earlier match of the line already
+            // took it (e.g., a query response that is also seen by a notification code); the command in flight
+            // takes it from a notification code
+            if (flag || i == command || handle->expected_codes[handle->curProccesPacket_index].state != SIM800_Received)
+            {
+                handle->curProccesPacket_index = i;
+            }
+
+            // Set the received status to SIM800_Received
+            handle->expected_codes[i].state = SIM800_Received;
+
+            flag = 0;
+
+            // Hand the line to the parser of the expected code
+            consume_line(handle, i, line);
+
+            // Invoke the associated handler if available
+            if (handle->expected_codes[i].handle != NULL)
+            {
+                handle->expected_codes[i].handle(handle, i);
+            }
+        }
+    }
+
+    if (flag && current->state == SIM800_Received)
+    {
+        // The line is a part of the response of the current expected code
+        consume_line(handle, handle->curProccesPacket_index, line);
+    }
+    else if (flag && current->state == SIM800_WaitingFor && current->code_length == 0 && current->parser != NULL &&
+             !line_starts_with(handle, line, "AT", 2))
+    {
+        // Responses without a code (e.g., the IMEI) are the first line that is not an echo
+        current->state = SIM800_Received;
+        consume_line(handle, handle->curProccesPacket_index, line);
+    }
+#if SIM800_USE_STATS
+    else if (flag)
+    {
+        handle->stats.unmatched++;
+    }
+#endif
+
+    boot_line(handle, line);
+#if SIM800_USE_GPRS
+    transparent_line(handle, line);
+#endif
+}
+
+
+/**
+ * @brief   Recognises a final result code and records it in handle->lastError.
+ *
+ * A "+CME ERROR: <n>" or "+CMS ERROR: <n>" ends the command just like "ERROR", so a failed command
+ * returns at once instead of waiting for its timeout. The cause is kept if it is numeric ("AT+CMEE=1").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the received line.
+ * @param   *result: Pointer to store the result, SIM800_OK or SIM800_ERROR.
+ * @retval  1 if the line is a final result code, 0 otherwise.
+ */
+static uint8_t final_result(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_Status_t *result)
+{
+    line_field_t field;
+
+    if (line_equals(handle, line, "OK"))
+    {
+        handle->lastError.type = SIM800_Error_None;
+        handle->lastError.cause = 0;
+        *result = SIM800_OK;
+        return 1;
+    }
+
+    if (line_equals(handle, line, "ERROR"))
+    {
+        handle->lastError.type = SIM800_Error_Generic;
+        handle->lastError.cause = 0;
+    }
+    else if (line_starts_with(handle, line, "+CME ERROR:", 11) || line_starts_with(handle, line, "+CMS ERROR:", 11))
+    {
+        handle->lastError.type = (line_char(handle, line, 3) == 'E') ? SIM800_Error_CME : SIM800_Error_CMS;
+
+        line_fields(handle, line, &field);
+        handle->lastError.cause = (line_field(handle, line, &field) == FIELD_NUMBER) ? (uint16_t)field.value : 0;
+    }
+    else
+    {
+        return 0;
+    }
+
+    *result = SIM800_ERROR;
+    return 1;
+}
+
+
+/**
+ * @brief   Tracks the power-on notifications of the module.
+ *
+ * Every notification sets its bit in handle->bootState. "RDY" received from a module that has already
+ * been seen running means the module has reset: the boot state starts over, the values cached from the
+ * module are dropped and SIM800_ResetCallBack is posted.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the received line.
+ */
+static void boot_line(SIM800_Handle_t *handle, const SIM800_Line_t *line)
+{
+    for (uint8_t i = 0; i < sizeof(boot_lines) / sizeof(boot_lines[0]); i++)
+    {
+        if (line->length != boot_lines[i].length || !line_starts_with(handle, line, boot_lines[i].line, boot_lines[i].length))
+        {
+            continue;
+        }
+
+        if (boot_lines[i].state == SIM800_Boot_Ready && handle->bootState != 0)
+        {
+            handle->bootState = 0;
+            handle->resets++;
+            handle->regStatus = SIM800_Registration_Unknown;
+            for (uint8_t j = 0; j < SIM800_Cache_Count; j++)
+            {
+                handle->cache[j].valid = 0;
+            }
+#if SIM800_USE_PHONEBOOK
+            // The SIM card may have been changed, its phonebook is read again once the module is up
+            if (handle->phonebook.valid)
+            {
+                handle->phonebook.stale = 1;
+                handle->phonebook.tick = HAL_GetTick();
+            }
+#endif
+
+            post_event(handle, SIM800_Event_Reset, 0, 0, 0);
+        }
+
+        handle->bootState |= boot_lines[i].state;
+        return;
+    }
+}
+
+
+/**
+ * @brief   Posts a notification to the event queue, its callback is invoked by SIM800_Poll.
+ *
+ * A notification that does not fit the queue is dropped and counted in handle->events.dropped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   type: Notification.
+ * @param   arg: First argument of the callback.
+ * @param   arg2: Second argument of the callback.
+ * @param   value: Wide argument of the callback.
+ */
+static void post_event(SIM800_Handle_t *handle, SIM800_EventType_t type, uint8_t arg, uint8_t arg2, uint32_t value)
+{
+    SIM800_EventQueue_t *queue = &handle->events;
+    SIM800_Event_t *event;
+
+    if ((uint8_t)(queue->head - queue->tail) >= SIM800_EVENT_QUEUE_LENGTH)
+    {
+        queue->dropped++;
+        return;
+    }
+
+    event = &queue->events[queue->head & (SIM800_EVENT_QUEUE_LENGTH - 1)];
+    event->type = type;
+    event->arg = arg;
+    event->arg2 = arg2;
+    event->value = value;
+    event->data = NULL;
+    queue->head++;
+}
+
+
+/**
+ * @brief   Invokes the callbacks of the posted notifications in order, then their subscribers.
+ *
+ * The callbacks run outside the line dispatch, so they may call the blocking functions. A callback
+ * waiting for a response polls the driver again; the notifications posted meanwhile wait until it returns.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void dispatch_events(SIM800_Handle_t *handle)
+{
+    SIM800_EventQueue_t *queue = &handle->events;
+    SIM800_Event_t event;
+    SIM800_Time_t time;
+
+    if (queue->dispatching)
+    {
+        return;
+    }
+    queue->dispatching = 1;
+
+    while (queue->tail != queue->head)
+    {
+        event = queue->events[queue->tail & (SIM800_EVENT_QUEUE_LENGTH - 1)];
+        queue->tail++;
+
+        switch (event.type)
+        {
+#if SIM800_USE_SMS
+        case SIM800_Event_NewSMS:
+            SIM800_NewSMSNotificationCallBack(handle, event.value);
+            break;
+
+        case SIM800_Event_SMSStorageLow:
+            SIM800_SMSStorageLowCallBack(handle, &handle->smsStorage);
+            break;
+
+        case SIM800_Event_SMSDelivery:
+            SIM800_SMSDeliveryCallBack(handle, event.arg, event.arg2, event.value);
+            break;
+#endif
+
+        case SIM800_Event_NetworkReg:
+            SIM800_NetworkRegCallBack(handle, (SIM800_NetworkRegStatus_t)event.arg);
+            break;
+
+        case SIM800_Event_NetworkTime:
+            seconds_to_time(event.value, (int8_t)event.arg, &time);
+            SIM800_NetworkTimeCallBack(handle, &time);
+            break;
+
+        case SIM800_Event_Reset:
+            SIM800_ResetCallBack(handle);
+            break;
+
+        case SIM800_Event_Call:
+            event.data = &handle->call.caller;
+            SIM800_IncomingCallCallBack(handle, &handle->call.caller);
+            break;
+
+        case SIM800_Event_USSD:
+            event.data = &handle->ussd.response;
+            break;
+
+#if SIM800_USE_GNSS
+        case SIM800_Event_GNSS:
+            event.data = &handle->gnss.fix;
+            SIM800_GNSSCallBack(handle, &handle->gnss.fix);
+            break;
+#endif
+
+#if SIM800_USE_GPRS
+        case SIM800_Event_Socket:
+            SIM800_SocketCallBack(handle, event.arg, (SIM800_SocketEvent_t)event.arg2);
+            break;
+
+        case SIM800_Event_Bearer:
+            SIM800_BearerCallBack(handle, (SIM800_BearerState_t)event.arg);
+            break;
+#endif
+
+        default:
+            break;
+        }
+
+        publish_event(handle, &event);
+    }
+
+    queue->dispatching = 0;
+}
+
+
+/**
+ * @brief   Resumes the flows that do not await a request, see SIM800_StartFlow.
+ *
+ * The next flow is taken once the current one has returned, so a flow may start other flows and stop itself.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void flow_poll(SIM800_Handle_t *handle)
+{
+    SIM800_Flow_t *flow = handle->flows, *next;
+
+    while (flow != NULL)
+    {
+        if (flow->pending == 0 && flow->function(handle, flow) == SIM800_FLOW_ENDED)
+        {
+            next = flow->next;
+            SIM800_StopFlow(handle, flow);
+        }
+        else
+        {
+            next = flow->next;
+        }
+
+        flow = next;
+    }
+}
+
+
+/**
+ * @brief   Hands an event to the subscribers taking it, see SIM800_Subscribe.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *event: Event.
+ */
+static void publish_event(SIM800_Handle_t *handle, const SIM800_Event_t *event)
+{
+    SIM800_Subscriber_t *subscriber;
+
+    for (uint8_t i = 0; i < SIM800_SUBSCRIBERS; i++)
+    {
+        subscriber = &handle->subscribers[i];
+        if (subscriber->callback != NULL && (subscriber->mask & SIM800_EVT(event->type)))
+        {
+            subscriber->callback(handle, event, subscriber->ctx);
+        }
+    }
+}
+
+
+/**
+ * @brief   Advances the health watchdog, see SIM800_ManageWatchdog.
+ *
+ * A restart of the module is recognised by "RDY" (the boot state starts over without the configured bit),
+ * a module that does not report it (e.g. with automatic baud rate detection) is probed once the restart time
+ * is over.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void watchdog_poll(SIM800_Handle_t *handle)
+{
+    SIM800_Watchdog_t *watchdog = &handle->watchdog;
+    uint8_t restarted = (handle->bootState & SIM800_Boot_Ready) && !(handle->bootState & SIM800_Boot_Configured);
+
+    if (watchdog->state == SIM800_Watchdog_Off || watchdog->busy)
+    {
+        return;
+    }
+
+    switch (watchdog->state)
+    {
+    case SIM800_Watchdog_Healthy:
+        if (restarted)
+        {
+            watchdog_enter(handle, SIM800_Watchdog_Restoring);
+        }
+        else if (watchdog->timeouts >= SIM800_WATCHDOG_TIMEOUTS)
+        {
+            watchdog->probes = 0;
+            watchdog_enter(handle, SIM800_Watchdog_Probing);
+        }
+        break;
+
+    case SIM800_Watchdog_Rebooting:
+    case SIM800_Watchdog_PowerCycling:
+        if (restarted || (watchdog->step != 0 && HAL_GetTick() - watchdog->tick >= SIM800_WATCHDOG_RESTART))
+        {
+            watchdog_enter(handle, SIM800_Watchdog_Restoring);
+            break;
+        }
+        // fall through
+
+    default:
+        watchdog_next(handle);
+        break;
+    }
+}
+
+
+/**
+ * @brief   Changes the state of the health watchdog and invokes SIM800_WatchdogCallBack.
+ *
+ * Entering SIM800_Watchdog_PowerCycling invokes SIM800_PowerCycleCallBack as well.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   state: New state.
+ */
+static void watchdog_enter(SIM800_Handle_t *handle, SIM800_WatchdogState_t state)
+{
+    SIM800_Watchdog_t *watchdog = &handle->watchdog;
+
+    watchdog->state = state;
+    watchdog->step = 0;
+    watchdog->tick = HAL_GetTick();
+
+    if (state == SIM800_Watchdog_PowerCycling)
+    {
+        SIM800_PowerCycleCallBack(handle);
+
+        // The restart time starts once the lines have been toggled
+        watchdog->step = 1;
+        watchdog->tick = HAL_GetTick();
+    }
+
+    SIM800_WatchdogCallBack(handle, state);
+}
+
+
+/**
+ * @brief   Submits the current request of the health watchdog.
+ *
+ * The restoration first waits for "SMS Ready" (at most SIM800_WATCHDOG_RESTART), then it sends "AT", "ATE0",
+ * the settings of SIM800_Init, the registration notifications mode, the network time reporting and the caller ID. A request that can not be submitted
+ * is submitted again by the next SIM800_Poll.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void watchdog_next(SIM800_Handle_t *handle)
+{
+    SIM800_Watchdog_t *watchdog = &handle->watchdog;
+    const SIM800_Config_t *config = handle->config;
+    SIM800_Command_t cmd = SIM800_Cmd_Status;
+    const char *arg = NULL;
+
+    switch (watchdog->state)
+    {
+    case SIM800_Watchdog_Probing:
+        break;
+
+    case SIM800_Watchdog_Rebooting:
+        if (watchdog->step != 0)
+        {
+            return;
+        }
+        cmd = SIM800_Cmd_Reboot;
+        break;
+
+    case SIM800_Watchdog_Restoring:
+        if (watchdog->step == 0)
+        {
+            if (!(handle->bootState & SIM800_Boot_SMSReady) && HAL_GetTick() - watchdog->tick < SIM800_WATCHDOG_RESTART)
+            {
+                return;
+            }
+            watchdog->step = 1;
+        }
+
+        if (watchdog->step == 4 && handle->regNotifications == 0)
+        {
+            watchdog->step = 5;
+        }
+
+        if (watchdog->step == 5 && handle->time.zoneCode == 0)
+        {
+            watchdog->step = 6;
+        }
+
+        if (watchdog->step == 2)
+        {
+            cmd = SIM800_Cmd_EchoOff;
+        }
+        else if (watchdog->step == 3)
+        {
+#if SIM800_USE_SMS
+            if (init_settings(config, handle->smsUCS2, watchdog->line, sizeof(watchdog->line)) != SIM800_OK)
+#else
+            if (init_settings(config, 0, watchdog->line, sizeof(watchdog->line)) != SIM800_OK)
+#endif
+            {
+                watchdog_done(handle, SIM800_ERROR, NULL);
+                return;
+            }
+            cmd = SIM800_Cmd_Configure;
+            arg = watchdog->line;
+        }
+        else if (watchdog->step == 4)
+        {
+            cmd = SIM800_Cmd_RegNotify;
+            arg = (config->regNotifications == 2) ? "2" : "1";
+        }
+        else if (watchdog->step == 5)
+        {
+            cmd = SIM800_Cmd_NetworkTime;
+            arg = "1";
+        }
+        else if (watchdog->step == 6)
+        {
+            if (handle->call.mode == SIM800_Calls_Off)
+            {
+                watchdog_done(handle, SIM800_OK, NULL);
+                return;
+            }
+            cmd = SIM800_Cmd_CallerID;
+            arg = "1";
+        }
+        break;
+
+    default:
+        return;
+    }
+
+    if (submit_request(handle, cmd, arg, NULL, NULL, &watchdog_done, NULL, NULL) != NULL)
+    {
+        watchdog->busy = 1;
+    }
+}
+
+
+/**
+ * @brief   Completion callback of a request of the health watchdog.
+ *
+ * A successful probe ends the supervision, the last failed probe restarts the module. A failed step of the
+ * restoration power-cycles the module, the last step marks the module as configured again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Not used.
+ */
+static void watchdog_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_Watchdog_t *watchdog = &handle->watchdog;
+
+    watchdog->busy = 0;
+
+    switch (watchdog->state)
+    {
+    case SIM800_Watchdog_Probing:
+        if (status == SIM800_OK)
+        {
+            watchdog_enter(handle, SIM800_Watchdog_Healthy);
+        }
+        else if (++watchdog->probes >= SIM800_WATCHDOG_PROBES)
+        {
+            watchdog_enter(handle, SIM800_Watchdog_Rebooting);
+        }
+        break;
+
+    case SIM800_Watchdog_Rebooting:
+        // Whatever the answer, the module gets the restart time
+        watchdog->step = 1;
+        watchdog->tick = HAL_GetTick();
+        break;
+
+    case SIM800_Watchdog_Restoring:
+        if (status != SIM800_OK)
+        {
+            watchdog_enter(handle, SIM800_Watchdog_PowerCycling);
+        }
+        else if (++watchdog->step > 6)
+        {
+            handle->bootState |= SIM800_Boot_Configured;
+            watchdog->timeouts = 0;
+            watchdog->recoveries++;
+#if SIM800_USE_GPRS
+            if (handle->bearer.state != SIM800_Bearer_Down)
+            {
+                bearer_lost(handle);
+            }
+#endif
+            watchdog_enter(handle, SIM800_Watchdog_Healthy);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+#if SIM800_USE_SLEEP
+
+/**
+ * @brief   Drives DTR of the module, see SIM800_ManageSleep.
+ *
+ * An awake module is let sleep once the driver has been idle for SIM800_SLEEP_IDLE, a received character
+ * counts as traffic. A sleeping module is woken when a request is queued or the ring indicator has fallen,
+ * it takes commands SIM800_SLEEP_WAKE_DELAY after DTR has fallen.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void sleep_poll(SIM800_Handle_t *handle)
+{
+    SIM800_Sleep_t *sleep = &handle->sleep;
+    uint32_t now = HAL_GetTick();
+
+    switch (sleep->state)
+    {
+    case SIM800_Sleep_Asleep:
+        if (handle->reqTail != handle->reqHead || sleep->ring)
+        {
+            sleep->ring = 0;
+            HAL_GPIO_WritePin(sleep->dtrPort, sleep->dtrPin, GPIO_PIN_RESET);
+            sleep->tick = now;
+            sleep->state = SIM800_Sleep_Waking;
+        }
+        break;
+
+    case SIM800_Sleep_Waking:
+        if (now - sleep->tick >= SIM800_SLEEP_WAKE_DELAY)
+        {
+            sleep->rxSeen = handle->rxHead;
+            sleep->tick = now;
+            sleep->state = SIM800_Sleep_Awake;
+        }
+        break;
+
+    case SIM800_Sleep_Awake:
+        if (!sleep_idle(handle) || sleep->ring || handle->rxHead != sleep->rxSeen)
+        {
+            sleep->ring = 0;
+            sleep->rxSeen = handle->rxHead;
+            sleep->tick = now;
+        }
+        else if (now - sleep->tick >= SIM800_SLEEP_IDLE)
+        {
+            HAL_GPIO_WritePin(sleep->dtrPort, sleep->dtrPin, GPIO_PIN_SET);
+            sleep->state = SIM800_Sleep_Asleep;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/**
+ * @brief   Checks whether the driver has nothing to exchange with the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  1 if no request is queued, nothing is sent or received and no data mode is in use, 0 otherwise.
+ */
+static uint8_t sleep_idle(SIM800_Handle_t *handle)
+{
+#if SIM800_USE_GPRS
+    // DTR must not change while the transparent pipe is connected
+    if (transparent_busy(handle) || handle->transparent == SIM800_Transparent_Suspended)
+    {
+        return 0;
+    }
+#endif
+
+    return handle->reqTail == handle->reqHead && handle->txHead == handle->txTail && !handle->txBusy &&
+           handle->rxHead == handle->rxTail && handle->rawRx == NULL;
+}
+
+#endif /* SIM800_USE_SLEEP */
+
+
+#if SIM800_USE_PHONEBOOK
+
+/**
+ * @brief   Starts reading the entries once the size of the phonebook is known.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of "AT+CPBR=?".
+ * @param   *ctx: Not used.
+ */
+static void phonebook_size_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_Phonebook_t *phonebook = &handle->phonebook;
+
+    if (status == SIM800_OK && phonebook->size != 0)
+    {
+        phonebook->arg[0] = '1';
+        phonebook->arg[1] = ',';
+        uint_to_str(phonebook->size, &phonebook->arg[2]);
+
+        if (submit_request(handle, SIM800_Cmd_PhonebookRead, phonebook->arg, NULL, phonebook, &phonebook_read_done, NULL,
+                           NULL) != NULL)
+        {
+            return;
+        }
+        status = SIM800_ERROR;
+    }
+
+    // A SIM card without phonebook has nothing to read
+    phonebook_read_done(handle, status, NULL);
+}
+
+
+/**
+ * @brief   Ends a load of the phonebook index and invokes its completion callback.
+ *
+ * A successful load drops the numbers it has not read, a failed one keeps the index as it was.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of "AT+CPBR=1,<size>".
+ * @param   *ctx: Not used.
+ */
+static void phonebook_read_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_Phonebook_t *phonebook = &handle->phonebook;
+    SIM800_RequestCallback_t done = phonebook->done;
+    uint16_t count = 0;
+
+    for (uint16_t i = 0; i < phonebook->count; i++)
+    {
+        if (status != SIM800_OK || (phonebook->keys[i] & 1))
+        {
+            phonebook->keys[count++] = phonebook->keys[i] & ~(uint64_t)1;
+        }
+    }
+    phonebook->count = count;
+
+    if (status == SIM800_OK)
+    {
+        phonebook->valid = 1;
+    }
+
+    // A loaded index that could not be refreshed is tried again later
+    phonebook->stale = (status != SIM800_OK) && phonebook->valid;
+    phonebook->loading = 0;
+    phonebook->tick = HAL_GetTick();
+    phonebook->done = NULL;
+
+    if (done != NULL)
+    {
+        done(handle, status, phonebook->ctx);
+    }
+}
+
+
+/**
+ * @brief   Reloads the phonebook index in the background, see SIM800_SetPhonebookRefresh.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void phonebook_poll(SIM800_Handle_t *handle)
+{
+    SIM800_Phonebook_t *phonebook = &handle->phonebook;
+    uint32_t wait;
+
+    if (phonebook->loading || handle->reqTail != handle->reqHead)
+    {
+        return;
+    }
+
+    if (phonebook->stale)
+        wait = SIM800_PHONEBOOK_RETRY;
+    else if (phonebook->valid && phonebook->refresh != 0)
+        wait = phonebook->refresh;
+    else
+        return;
+
+    if (HAL_GetTick() - phonebook->tick >= wait && SIM800_SubmitLoadPhonebookEx(handle, NULL, NULL, NULL) != SIM800_OK)
+    {
+        phonebook->tick = HAL_GetTick();
+    }
+}
+
+
+/**
+ * @brief   Makes the key of a phone number in the phonebook index.
+ *
+ * The key holds the value of the last SIM800_PHONEBOOK_DIGITS digits above their count, so "0123" and "123"
+ * differ. Bit 0 is left free, a load marks the keys it reads with it.
+ *
+ * @param   *number: Phone number, the characters other than digits are skipped.
+ * @retval  Key, 0 if the number has no digits.
+ */
+static uint64_t phonebook_key(const char *number)
+{
+    const char *end = number + strlen(number);
+    uint64_t value = 0, scale = 1;
+    uint8_t digits = 0;
+
+    // The trailing digits are compared, so the national and the international form of a number match
+    while (end > number && digits < SIM800_PHONEBOOK_DIGITS)
+    {
+        if (*--end >= '0' && *end <= '9')
+        {
+            value += (uint64_t)(*end - '0') * scale;
+            scale *= 10;
+            digits++;
+        }
+    }
+
+    return (digits != 0) ? (value << 6) | ((uint64_t)digits << 1) : 0;
+}
+
+
+/**
+ * @brief   Finds the position of a key in the phonebook index by a binary search.
+ *
+ * @param   *phonebook: Pointer to the phonebook index.
+ * @param   key: Key to find, its mark is ignored.
+ * @retval  Position of the key, or where it is to be inserted.
+ */
+static uint16_t phonebook_find(const SIM800_Phonebook_t *phonebook, uint64_t key)
+{
+    uint16_t low = 0, high = phonebook->count, middle;
+
+    key &= ~(uint64_t)1;
+
+    while (low < high)
+    {
+        middle = (low + high) / 2;
+
+        if (phonebook->keys[middle] < key)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+
+/**
+ * @brief   Parses the "AT+CPBR=?" response, the index range of the phonebook.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the line is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cpbr_size_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CPBR: (1-250),40,14
+     */
+    int32_t dash = line_find(handle, line, '-', 0);
+    uint32_t pos;
+    int32_t size;
+
+    if (line->continued)
+    {
+        return SIM800_OK;
+    }
+
+    if (dash < 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    pos = dash + 1;
+    size = line_to_int(handle, line, &pos);
+    if (size < 0 || size > UINT16_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->phonebook.size = size;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses an entry of the "AT+CPBR=1,<size>" listing and inserts its number into the phonebook index.
+ *
+ * Every entry is a line of its own, only its number is kept; the rest of a long name is skipped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the line is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cpbr_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CPBR: 1,"+79001234567",145,"Alice"
+     */
+    SIM800_Phonebook_t *phonebook = &handle->phonebook;
+    char number[4 * SIM800_CALLER_LENGTH];
+    line_field_t field;
+    uint64_t key;
+    uint16_t i;
+
+    if (line->continued || !line_starts_with(handle, line, "+CPBR:", 6))
+    {
+        return SIM800_OK;
+    }
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER || line_field(handle, line, &field) != FIELD_STRING)
+    {
+        return SIM800_ERROR;
+    }
+    line_copy(handle, line, field.start, field.end, number, sizeof(number));
+
+#if SIM800_USE_SMS
+    if (handle->smsUCS2)
+    {
+        ucs2_decode(number);
+    }
+#endif
+
+    if ((key = phonebook_key(number)) == 0)
+    {
+        return SIM800_OK;
+    }
+
+    // A number already in the index is only marked as read
+    i = phonebook_find(phonebook, key);
+    if (i < phonebook->count && (phonebook->keys[i] >> 1) == (key >> 1))
+    {
+        phonebook->keys[i] |= 1;
+        return SIM800_OK;
+    }
+
+    if (phonebook->count == SIM800_PHONEBOOK_ENTRIES)
+    {
+        phonebook->dropped++;
+        return SIM800_OK;
+    }
+
+    memmove(&phonebook->keys[i + 1], &phonebook->keys[i], (phonebook->count - i) * sizeof(phonebook->keys[0]));
+    phonebook->keys[i] = key | 1;
+    phonebook->count++;
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_PHONEBOOK */
+
+
+/**
+ * @brief   Makes a notification expected code wait for the next notification.
+ *
+ * If the notification has taken the current expected code, the following lines are handed back
+ * to the code of the command being executed.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the notification expected code.
+ */
+static void end_notification(SIM800_Handle_t *handle, uint8_t index)
+{
+    handle->expected_codes[index].state = SIM800_WaitingFor;
+    handle->expected_codes[index].lines_count = 0;
+
+    if (handle->curProccesPacket_index == index)
+    {
+        handle->curProccesPacket_index = result_index(handle);
+    }
+}
+
+
+/**
+ * @brief   Selects the expected code that takes the final result code.
+ *
+ * The commands are executed one at a time in the order of the request queue, so a final result code
+ * always belongs to the request at its tail once the command has been sent. The notifications have
+ * codes of their own and never take it. Without a command in flight (e.g., "+++" of SIM800_TransparentExit)
+ * the current expected code takes it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  Index of the expected code.
+ */
+static uint8_t result_index(SIM800_Handle_t *handle)
+{
+    SIM800_Request_t *req = &handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)];
+
+    if (handle->reqTail != handle->reqHead && req->state != SIM800_Request_Queued && req->index < EXPECTED_CODES_MAX_COUNT)
+    {
+        return req->index;
+    }
+
+    return handle->curProccesPacket_index;
+}
+
+
+/**
+ * @brief   Waits until the boot state has the given bits set.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   state: Boot state bits to wait for, see SIM800_BootState_t.
+ * @param   timeout: Maximum time to wait (ms).
+ * @retval  1 if the bits are set, 0 on timeout.
+ */
+static uint8_t wait_for_boot(SIM800_Handle_t *handle, uint8_t state, uint32_t timeout)
+{
+    uint32_t tickStart = HAL_GetTick();
+
+    while (1)
+    {
+        executor_poll(handle);
+
+        if ((handle->bootState & state) == state)
+        {
+            return 1;
+        }
+
+        if (HAL_GetTick() - tickStart >= timeout)
+        {
+            return 0;
+        }
+
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+}
+
+
+/**
+ * @brief   Hands a response line to the parser of an expected code.
+ *
+ * The parse status of the first line (the code line) becomes the parse status of the expected code,
+ * a failure of any following line turns it into SIM800_ERROR.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code.
+ * @param   *line: Pointer to the response line.
+ */
+static void consume_line(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    SIM800_ExpectedCode_t *code = &handle->expected_codes[index];
+    SIM800_Status_t status;
+
+    if (code->parser != NULL)
+    {
+        status = code->parser(handle, index, line);
+
+        if (code->lines_count == 0 || status != SIM800_OK)
+        {
+            code->parsed = status;
+        }
+    }
+
+    code->lines_count++;
+
+#if SIM800_USE_LATENCY
+    latency_line(handle, index);
+#endif
+}
+
+
+/**
+ * @brief   Calculates the dispatch bucket of an expected code.
+ *
+ * @param   *code: Expected code (e.g., "+CMTI").
+ * @param   len: Length of the code.
+ * @retval  Index of the dispatch bucket.
+ */
+static uint32_t code_hash(const char *code, size_t len)
+{
+    uint32_t hash = 5381;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        hash = hash * 33 + (uint8_t)code[i];
+    }
+
+    return hash & (DISPATCH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief   Calculates the dispatch bucket of a received line.
+ *
+ * The code of a line is the text before the first ':' or ',' (e.g., "+CMTI" of "+CMTI: "SM",3",
+ * "+RECEIVE" of "+RECEIVE,0,5:" or "0" of "0, CONNECT OK"), or the whole line if it has neither
+ * (e.g., "RING"). Codes longer than CODE_MAX_LENGTH can not
+ * be registered, so at most that many characters are hashed.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *len: Pointer to store the length of the line code.
+ * @retval  Index of the dispatch bucket.
+ */
+static uint32_t line_code_hash(SIM800_Handle_t *handle, const SIM800_Line_t *line, size_t *len)
+{
+    uint32_t hash = 5381;
+    size_t i;
+    char c;
+
+    for (i = 0; i < line->length && i < CODE_MAX_LENGTH; i++)
+    {
+        if ((c = line_char(handle, line, i)) == ':' || c == ',')
+        {
+            break;
+        }
+        hash = hash * 33 + (uint8_t)c;
+    }
+
+    *len = i;
+
+    return hash & (DISPATCH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief   Advances the scan position of the receive ring behind the next '\n'.
+ *
+ * The ring is tested 4 characters at a time: XOR with "\n\n\n\n" turns a '\n' into a zero byte, which
+ * (w - 0x01010101) & ~w & 0x80808080 detects in a word (no false positive before the first zero byte).
+ * The first and the last characters of a contiguous part of the ring are tested one by one.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   end: Ring index the scan stops at if no '\n' comes first.
+ * @retval  1 if the scan stopped behind a '\n', 0 if it reached end.
+ */
+static uint8_t scan_newline(SIM800_Handle_t *handle, uint32_t end)
+{
+    uint32_t scan = handle->rxScan;
+    uint32_t pos, stop, word;
+
+    while (scan != end)
+    {
+        pos = scan & (RX_RING_LENGTH - 1);
+        stop = end - scan < RX_RING_LENGTH - pos ? pos + (end - scan) : RX_RING_LENGTH;
+
+        while (pos < stop && ((uintptr_t)&handle->rxRing[pos] & 3) != 0)
+        {
+            if (handle->rxRing[pos++] == '\n')
+            {
+                handle->rxScan = scan + (pos - (scan & (RX_RING_LENGTH - 1)));
+                return 1;
+            }
+        }
+
+        while (stop - pos >= 4)
+        {
+            memcpy(&word, &handle->rxRing[pos], 4);
+            word ^= 0x0A0A0A0A;
+            if (((word - 0x01010101) & ~word & 0x80808080) != 0)
+            {
+                break;
+            }
+            pos += 4;
+        }
+
+        while (pos < stop)
+        {
+            if (handle->rxRing[pos++] == '\n')
+            {
+                handle->rxScan = scan + (pos - (scan & (RX_RING_LENGTH - 1)));
+                return 1;
+            }
+        }
+
+        scan += pos - (scan & (RX_RING_LENGTH - 1));
+    }
+
+    handle->rxScan = scan;
+
+    return 0;
+}
+
+
+/**
+ * @brief   Returns a character of a received line.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   pos: Position of the character in the line.
+ * @retval  The character, or '\0' if the position is behind the end of the line.
+ */
+static char line_char(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t pos)
+{
+    if (pos >= line->length)
+    {
+        return '\0';
+    }
+
+    return handle->rxRing[(line->start + pos) & (RX_RING_LENGTH - 1)];
+}
+
+
+/**
+ * @brief   Checks whether a received line starts with the given prefix.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *prefix: Prefix to compare with.
+ * @param   len: Count of prefix characters to compare.
+ * @retval  1 if the line starts with the prefix, 0 otherwise.
+ */
+static uint8_t line_starts_with(SIM800_Handle_t *handle, const SIM800_Line_t *line, const char *prefix, size_t len)
+{
+    if (len > line->length)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        if (line_char(handle, line, i) != prefix[i])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief   Checks if a received line (or a part of it) is the given text.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *text: Text to compare with.
+ * @retval  1 if the line is the text, 0 otherwise.
+ */
+static uint8_t line_equals(SIM800_Handle_t *handle, const SIM800_Line_t *line, const char *text)
+{
+    size_t len = strlen(text);
+
+    return line->length == len && line_starts_with(handle, line, text, len);
+}
+
+
+/**
+ * @brief   Finds a character in a received line.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   c: Character to find.
+ * @param   from: Position in the line to start the search from.
+ * @retval  Position of the character in the line, or -1 if it is not found.
+ */
+static int32_t line_find(SIM800_Handle_t *handle, const SIM800_Line_t *line, char c, uint32_t from)
+{
+    for (uint32_t i = from; i < line->length; i++)
+    {
+        if (line_char(handle, line, i) == c)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief   Converts the decimal number at the given position of a received line.
+ *
+ * Leading spaces and a sign are accepted. The position is advanced past the number.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *pos: Pointer to the position in the line, updated to the first character after the number.
+ * @retval  The converted number, 0 if there is no number at the position.
+ */
+static int32_t line_to_int(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t *pos)
+{
+    int32_t value = 0, sign = 1;
+    char c;
+
+    while (line_char(handle, line, *pos) == ' ')
+    {
+        (*pos)++;
+    }
+
+    c = line_char(handle, line, *pos);
+    if (c == '-' || c == '+')
+    {
+        sign = (c == '-') ? -1 : 1;
+        (*pos)++;
+    }
+
+    for (c = line_char(handle, line, *pos); c >= '0' && c <= '9'; c = line_char(handle, line, *pos))
+    {
+        // A malformed number saturates instead of overflowing
+        value = (value <= (INT32_MAX - 9) / 10) ? value * 10 + (c - '0') : INT32_MAX;
+        (*pos)++;
+    }
+
+    return sign * value;
+}
+
+
+/**
+ * @brief   Copies a part of a received line into a NUL-terminated string.
+ *
+ * At most size - 1 characters are copied, the rest is truncated.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   from: Position of the first character to copy.
+ * @param   to: Position behind the last character to copy.
+ * @param   *dst: Destination buffer.
+ * @param   size: Size of the destination buffer.
+ * @retval  Count of copied characters.
+ */
+static size_t line_copy(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t from, uint32_t to, char *dst, size_t size)
+{
+    size_t len = 0;
+
+    if (size == 0)
+    {
+        return 0;
+    }
+
+    if (to > line->length)
+    {
+        to = line->length;
+    }
+
+    while (from < to && len < size - 1)
+    {
+        dst[len++] = line_char(handle, line, from++);
+    }
+    dst[len] = '\0';
+
+#if SIM800_USE_STATS
+    if (from < to)
+    {
+        handle->stats.truncated++;
+    }
+#endif
+
+    return len;
+}
+
+
+/**
+ * @brief   Places a field cursor on the first field of a received line.
+ *
+ * The fields of "+CODE: a,b,..." (or "*CODE: a,b,...") start behind the colon, the fields of a line without
+ * a code at its start.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *field: Pointer to the cursor, see line_field.
+ */
+static void line_fields(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field)
+{
+    char c = line_char(handle, line, 0);
+    int32_t colon = (c == '+' || c == '*') ? line_find(handle, line, ':', 0) : -1;
+
+    field->next = colon + 1;
+    field->type = FIELD_NONE;
+}
+
+
+/**
+ * @brief   Reads the next comma separated field of a received line.
+ *
+ * The field is scanned once: a quoted string may contain commas and ends at its closing quote, an
+ * unquoted field is a number if it is made of an optional sign and decimal digits (surrounding spaces
+ * are skipped). Nothing is read behind the end of the line.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *field: Pointer to the cursor, see line_fields. It is moved to the following field.
+ * @retval  Type of the field, FIELD_NONE if the line has no more fields.
+ */
+static line_field_type_t line_field(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field)
+{
+    uint32_t pos = field->next;
+    int32_t sign = 1;
+    uint8_t digits = 0;
+    char c;
+
+    if (pos > line->length)
+    {
+        field->type = FIELD_NONE;
+        return FIELD_NONE;
+    }
+
+    while (line_char(handle, line, pos) == ' ')
+    {
+        pos++;
+    }
+
+    field->start = pos;
+    field->value = 0;
+
+    if (line_char(handle, line, pos) == '"')
+    {
+        field->start = ++pos;
+        while (pos < line->length && line_char(handle, line, pos) != '"')
+        {
+            pos++;
+        }
+        field->end = pos;
+        field->type = FIELD_STRING;
+    }
+    else
+    {
+        if ((c = line_char(handle, line, pos)) == '-' || c == '+')
+        {
+            sign = (c == '-') ? -1 : 1;
+            pos++;
+        }
+
+        for (c = line_char(handle, line, pos); c >= '0' && c <= '9'; c = line_char(handle, line, ++pos))
+        {
+            field->value = (field->value <= (INT32_MAX - 9) / 10) ? field->value * 10 + (c - '0') : INT32_MAX;
+            digits++;
+        }
+        field->value *= sign;
+        field->end = pos;
+
+        while (line_char(handle, line, pos) == ' ')
+        {
+            pos++;
+        }
+
+        field->type = (digits != 0 && (pos == line->length || line_char(handle, line, pos) == ',')) ? FIELD_NUMBER : FIELD_TEXT;
+    }
+
+    // Skip the rest of the field, the following one starts behind the comma
+    while (pos < line->length && line_char(handle, line, pos) != ',')
+    {
+        pos++;
+    }
+
+    if (field->type == FIELD_TEXT)
+    {
+        field->end = pos;
+    }
+    field->next = pos + 1;
+
+    return field->type;
+}
+
+
+/**
+ * @brief   Reads consecutive numeric fields of a received line.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *field: Pointer to the cursor, see line_fields.
+ * @param   *values: Array to store the numbers.
+ * @param   count: Count of numbers to read.
+ * @retval  Count of numbers read, less than count if a field is missing or is not a number.
+ */
+static uint8_t line_numbers(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field, int32_t *values, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (line_field(handle, line, field) != FIELD_NUMBER)
+        {
+            return i;
+        }
+        values[i] = field->value;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Parses the response line of SIM800_Query.
+ *
+ * Only the first line with the code is parsed, the expected code gives the current expected code
+ * back to the command at once.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the expected code of the query.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the line matches the format, SIM800_ERROR otherwise.
+ */
+static SIM800_Status_t query_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    query_t *query = (query_t *)handle->expected_codes[index].response;
+    line_field_t field;
+    line_field_type_t type;
+
+    end_notification(handle, index);
+
+    if (query->done)
+    {
+        return SIM800_OK;
+    }
+    query->done = 1;
+    query->status = SIM800_ERROR;
+
+    line_fields(handle, line, &field);
+    for (uint8_t i = 0; i < query->count; i++)
+    {
+        query_field_t *out = &query->fields[i];
+
+        if ((type = line_field(handle, line, &field)) == FIELD_NONE)
+        {
+            return SIM800_ERROR;
+        }
+
+        if (out->type == 'd')
+        {
+            if (type != FIELD_NUMBER)
+            {
+                return SIM800_ERROR;
+            }
+            *(int32_t *)out->value = field.value;
+        }
+        else if (out->type == 's')
+        {
+            line_copy(handle, line, field.start, field.end, (char *)out->value, out->size);
+        }
+    }
+
+    query->status = SIM800_OK;
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Starts an AT command without waiting for its response.
+ *
+ * This function adds the expected code of the command and queues the command text, the argument
+ * (if any), the suffix and the line terminator for transmission. The command strings are sent straight
+ * from the command table, only the argument supplied by the caller is copied into the transmit arena.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command to start, see SIM800_Command_t.
+ * @param   *arg: Command argument, NULL if the command has none.
+ * @param   ucs2: 1 to send the argument (UTF-8) as UCS2 hex.
+ * @param   *response: Structure filled by the response parser of the command, NULL to skip parsing.
+ * @param   messageHandler: Custom message handler function to call upon receiving the response, may be NULL.
+ * @retval  The index of the expected code or 0xFF on error.
+ */
+static uint8_t start_command(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, uint8_t ucs2, void *response,
+                             void (*messageHandler)(void*, uint32_t))
+{
+    const command_descriptor_t *desc = &commands[cmd];
+    uint8_t index = add_pending_message(handle, desc->code, response != NULL ? desc->parser : NULL, response,
+                                        messageHandler);
+
+    if (index == 0xFF)
+    {
+        return 0xFF;
+    }
+
+    if (send_command(handle, desc->command) != SIM800_OK ||
+#if SIM800_USE_SMS
+        (arg != NULL && (ucs2 ? send_ucs2(handle, arg) : send_data(handle, arg)) != SIM800_OK) ||
+#else
+        (arg != NULL && send_data(handle, arg) != SIM800_OK) ||
+#endif
+        (*desc->suffix != '\0' && send_command(handle, desc->suffix) != SIM800_OK) ||
+        send_command(handle, "\r\n") != SIM800_OK)
+    {
+        remove_expected_code(handle, index);
+        return 0xFF;
+    }
+
+    return index;
+}
+
+
+/**
+ * @brief   Executes an AT command and waits for its response.
+ *
+ * This is the shared executor of all blocking functions: it submits the request and calls SIM800_Poll
+ * until the request is finished, see step_request. If the request queue is full, it waits for a free slot.
+ * Between two polls it sleeps in SIM800_OS_Wait, which is woken by SIM800_OS_Signal from the UART interrupts.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command to execute, see SIM800_Command_t.
+ * @param   *arg: Command argument, NULL if the command has none.
+ * @param   *data: Data block sent after the command, NULL if the command has none.
+ * @param   *response: Pointer to the structure filled by the response parser, NULL to skip parsing.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t execute_command(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, const char *data, void *response)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+    uint32_t tickStart = HAL_GetTick();
+    SIM800_RequestOptions_t options;
+
+    take_options(handle, &options);
+
+    while (submit_request(handle, cmd, arg, data, response, &blocking_done, &result, &options) == NULL)
+    {
+        executor_poll(handle);
+
+        if (HAL_GetTick() - tickStart > SIM800_MAX_DELAY)
+        {
+            return SIM800_TIMEOUT;
+        }
+
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+
+    return wait_for_request(handle, &result);
+}
+
+
+/**
+ * @brief   Waits until a request submitted by a blocking function is finished.
+ *
+ * Between two polls the function sleeps in SIM800_OS_Wait, which is woken by SIM800_OS_Signal
+ * from the UART interrupts.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *result: Pointer to the result filled by blocking_done.
+ * @retval  Status of the request.
+ */
+static SIM800_Status_t wait_for_request(SIM800_Handle_t *handle, blocking_result_t *result)
+{
+    while (1)
+    {
+        executor_poll(handle);
+
+        if (result->done)
+        {
+            break;
+        }
+
+        // Sleep until the UART has something new, the slice bounds the sleep for the timeout checks
+        SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+    }
+
+    return result->status;
+}
+
+
+/**
+ * @brief   Appends a request to the request queue.
+ *
+ * Safe to call from several tasks at once, see claim_request.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command to execute, see SIM800_Command_t.
+ * @param   *arg: Command argument, NULL if the command has none.
+ * @param   *data: Data block sent on the "> " prompt, NULL if the command has none.
+ * @param   *response: Pointer to the structure filled by the response parser, NULL to skip parsing.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  Pointer to the queued request, NULL if the queue is full or the transparent pipe is in data mode.
+ */
+static SIM800_Request_t *submit_request(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, const char *data,
+                                        void *response, SIM800_RequestCallback_t done, void *ctx,
+                                        const SIM800_RequestOptions_t *options)
+{
+    SIM800_Request_t *req = claim_request(handle, cmd, arg, data, response, done, ctx, options);
+
+    if (req != NULL)
+    {
+        commit_request(handle);
+    }
+
+    return req;
+}
+
+
+/**
+ * @brief   Takes the next slot of the request queue and fills the common fields of the request.
+ *
+ * Requests may be submitted by several tasks while the executor (the task calling SIM800_Poll) runs the
+ * queue. The slot is claimed with the interrupts disabled and they stay disabled until commit_request
+ * publishes the request, so no task is preempted while it holds a half-written slot: the requests are
+ * executed in the order they were claimed and a low-priority producer never holds the queue up. Between
+ * the two calls only the fields of the request and of the caller's own structures are written, nothing
+ * waits there. A busy flag shared by the tasks is tested and set there too, release_request gives the slot
+ * back if it is taken.
+ *
+ * The options come with the call only. The ones set for the next request of the application (SIM800_SetTimeout,
+ * SIM800_SetDeadline, SIM800_SetCancelToken) are never read here, so the requests the driver submits on its own
+ * do not take them, see take_options.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command to execute, see SIM800_Command_t.
+ * @param   *arg: Command argument, NULL if the command has none.
+ * @param   *data: Data block sent on the "> " prompt, NULL if the command has none.
+ * @param   *response: Pointer to the structure filled by the response parser, NULL to skip parsing.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @param   *options: Options of the request, NULL - the defaults.
+ * @retval  Pointer to the claimed request, NULL (the interrupts are enabled again) if the queue is full or the
+ *          transparent pipe is in data mode.
+ */
+static SIM800_Request_t *claim_request(SIM800_Handle_t *handle, SIM800_Command_t cmd, const char *arg, const char *data,
+                                       void *response, SIM800_RequestCallback_t done, void *ctx,
+                                       const SIM800_RequestOptions_t *options)
+{
+    uint32_t primask = __get_PRIMASK();
+    SIM800_Request_t *req;
+
+    __disable_irq();
+
+#if SIM800_USE_GPRS
+    if (handle->reqHead - handle->reqTail >= REQUEST_QUEUE_LENGTH || transparent_busy(handle))
+#else
+    if (handle->reqHead - handle->reqTail >= REQUEST_QUEUE_LENGTH)
+#endif
+    {
+        __set_PRIMASK(primask);
+        return NULL;
+    }
+
+    handle->reqPrimask = primask;
+    req = &handle->requests[handle->reqHead & (REQUEST_QUEUE_LENGTH - 1)];
+
+    req->cmd = cmd;
+    req->arg = arg;
+    req->data = data;
+    req->dataHex = 0;
+    req->dataLength = 0;
+    req->iov = NULL;
+    req->iovCount = 0;
+#if SIM800_USE_SMS
+    // In the UCS2 character set the number and the text of a message, and a USSD string, are converted while they are sent
+    req->ucs2 = (cmd == SIM800_Cmd_SendSMS || cmd == SIM800_Cmd_USSD) && handle->smsUCS2;
+#else
+    req->ucs2 = 0;
+#endif
+    req->response = response;
+    req->batch = NULL;
+    req->batchCount = 0;
+    req->done = done;
+    req->ctx = ctx;
+    req->state = SIM800_Request_Queued;
+    req->index = 0xFF;
+    req->attempt = 0;
+    req->backoff = 0;
+    req->timeout = options != NULL && options->timeout != 0 ? options->timeout : commands[cmd].timeout;
+    req->deadline = options != NULL ? options->deadline : 0;
+    req->token = options != NULL ? options->token : 0;
+    req->cancel = 0;
+
+    return req;
+}
+
+
+/**
+ * @brief   Takes the options set for the next request of the application.
+ *
+ * A function of the application takes them at its start, before anything can fail, so they apply to that call
+ * only, whether it queues a request or not.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *options: Pointer to store the options.
+ * @retval  options.
+ */
+static const SIM800_RequestOptions_t *take_options(SIM800_Handle_t *handle, SIM800_RequestOptions_t *options)
+{
+    *options = handle->nextOptions;
+    memset(&handle->nextOptions, 0, sizeof(handle->nextOptions));
+
+    return options;
+}
+
+
+/**
+ * @brief   Publishes the request taken by claim_request to the executor and enables the interrupts again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void commit_request(SIM800_Handle_t *handle)
+{
+    handle->reqHead++;
+    __set_PRIMASK(handle->reqPrimask);
+}
+
+
+/**
+ * @brief   Gives back the slot taken by claim_request without publishing the request and enables the interrupts again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void release_request(SIM800_Handle_t *handle)
+{
+    __set_PRIMASK(handle->reqPrimask);
+}
+
+
+/**
+ * @brief   Runs the handle once on behalf of a blocking function.
+ *
+ * Only the executor polls: a blocking function called from another task just waits for the executor to
+ * finish its request, so the UART is never driven by two tasks. See SIM800_OS_IsExecutor.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void executor_poll(SIM800_Handle_t *handle)
+{
+    if (SIM800_OS_IsExecutor(handle))
+    {
+        SIM800_Poll(handle);
+    }
+}
+
+
+/**
+ * @brief   Advances the request being executed.
+ *
+ * A queued request sends its command. A request with a data block (e.g., the text of an SMS message)
+ * then waits for the "> " prompt and sends the data terminated by Ctrl+Z (a binary block of a known
+ * length is sent as it is), a final result code received instead of the prompt finishes it with an
+ * error. Finally the final result code is awaited within the request timeout (the timeout of the
+ * command table or the one of the request options). The response lines are parsed into `response` as
+ * they arrive, when the final result code is "OK" the parse status is the status of the request.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the request at the tail of the request queue.
+ * @retval  1 if the request is finished, 0 if it is still in progress.
+ */
+static uint8_t step_request(SIM800_Handle_t *handle, SIM800_Request_t *req)
+{
+    SIM800_ExpectedCode_t *code = &handle->expected_codes[req->index < EXPECTED_CODES_MAX_COUNT ? req->index : 0];
+    SIM800_Status_t status;
+
+    if (req->deadline != 0 && req->cancel == 0 && (int32_t)(HAL_GetTick() - req->deadline) >= 0)
+    {
+        // A request not sent yet is simply dropped, a command in flight is aborted
+        if (req->state == SIM800_Request_Queued)
+        {
+            return finish_request(handle, req, SIM800_TIMEOUT);
+        }
+
+        cancel_request(handle, req, SIM800_TIMEOUT);
+    }
+
+    switch (req->state)
+    {
+    case SIM800_Request_Queued:
+        // A request sent again waits for its backoff, see retry_request
+        if (req->backoff != 0 && HAL_GetTick() - req->tickStart < req->backoff)
+        {
+            return 0;
+        }
+
+#if SIM800_USE_SLEEP
+        // A sleeping module is woken first, see sleep_poll
+        if (handle->sleep.state == SIM800_Sleep_Asleep || handle->sleep.state == SIM800_Sleep_Waking)
+        {
+            return 0;
+        }
+#endif
+
+        // The prompt may follow the command immediately, it has to be awaited before the command is sent
+        handle->prompt = (req->data != NULL) ? SIM800_Prompt_Waiting : SIM800_Prompt_None;
+        req->tickStart = HAL_GetTick();
+#if SIM800_USE_LATENCY
+        latency_start(handle);
+#endif
+        req->index = (req->batch != NULL) ? start_batch(handle, req) :
+                                            start_command(handle, req->cmd, req->arg, req->ucs2, req->response, NULL);
+
+        if (req->index == 0xFF)
+        {
+            return finish_request(handle, req, SIM800_ERROR);
+        }
+
+#if SIM800_USE_LATENCY
+        latency_sent(handle, req);
+#endif
+
+        req->state = (req->data != NULL) ? SIM800_Request_WaitingPrompt : SIM800_Request_WaitingResult;
+
+        // The deadline bounds the response timeout
+        if (req->deadline != 0 && req->deadline - req->tickStart < req->timeout)
+        {
+            req->timeout = req->deadline - req->tickStart;
+        }
+        return 0;
+
+    case SIM800_Request_WaitingPrompt:
+        if (handle->prompt == SIM800_Prompt_Received && req->cancel == 2)
+        {
+            // The request is cancelled, its data block is left without being sent
+            handle->prompt = SIM800_Prompt_None;
+            send_command(handle, "\033");
+            req->state = SIM800_Request_WaitingResult;
+            return 0;
+        }
+
+        if (handle->prompt == SIM800_Prompt_Received)
+        {
+            // Send the data and the end character
+            handle->prompt = SIM800_Prompt_None;
+
+            if (req->iov != NULL)
+                status = send_iov(handle, req->iov, req->iovCount);
+            else if (req->dataLength)
+                status = tx_enqueue(handle, (const uint8_t *)req->data, req->dataLength, 0, NULL, NULL);
+            else if (req->dataHex)
+                status = send_hex(handle, (const uint8_t *)req->data, req->dataHex);
+            else
+#if SIM800_USE_SMS
+                status = req->ucs2 ? send_ucs2(handle, req->data) : send_data(handle, req->data);
+#else
+                status = send_data(handle, req->data);
+#endif
+
+            // A binary block has its length in the command, it is not terminated
+            if (status != SIM800_OK || (!req->dataLength && send_command(handle, "\032") != SIM800_OK))
+            {
+                return finish_request(handle, req, SIM800_ERROR);
+            }
+
+            req->state = SIM800_Request_WaitingResult;
+            return 0;
+        }
+
+        if (code->state == SIM800_ReceivedStatus)
+        {
+            return finish_request(handle, req, SIM800_ERROR);
+        }
+
+        if (HAL_GetTick() - req->tickStart > SIM800_PROMPT_TIMEOUT)
+        {
+            return finish_request(handle, req, SIM800_TIMEOUT);
+        }
+        return 0;
+
+    case SIM800_Request_WaitingResult:
+        if (req->batch != NULL)
+        {
+            return step_batch(handle, req);
+        }
+
+        if (code->state == SIM800_ReceivedStatus)
+        {
+            status = validate_response(handle, req->index);
+
+            // A listing without any entry is complete as well
+#if SIM800_USE_SMS
+            if (status == SIM800_OK && code->parser != NULL && (code->lines_count != 0 || req->cmd != SIM800_Cmd_ListSMS))
+#else
+            if (status == SIM800_OK && code->parser != NULL)
+#endif
+            {
+                status = code->parsed;
+            }
+
+            return finish_request(handle, req, status);
+        }
+
+        if (HAL_GetTick() - req->tickStart > req->timeout)
+        {
+            return finish_request(handle, req, SIM800_TIMEOUT);
+        }
+        return 0;
+    }
+
+    return finish_request(handle, req, SIM800_ERROR);
+}
+
+
+/**
+ * @brief   Starts a batch of queries combined into one command line.
+ *
+ * The expected codes of all queries are added first, then "AT" and the commands without their
+ * "AT" prefix, separated by ';', are queued. The strings are sent straight from the command table.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the batch request.
+ * @retval  The index of the expected code of the first query or 0xFF on error.
+ */
+static uint8_t start_batch(SIM800_Handle_t *handle, SIM800_Request_t *req)
+{
+    const command_descriptor_t *desc;
+    SIM800_Status_t status;
+    uint8_t i;
+
+    for (i = 0; i < req->batchCount; i++)
+    {
+        desc = &commands[req->batch[i].cmd];
+
+        req->batch[i].status = SIM800_ERROR;
+        req->batch[i].index = add_pending_message(handle, desc->code, req->batch[i].response != NULL ? desc->parser : NULL,
+                                                  req->batch[i].response, NULL);
+        if (req->batch[i].index == 0xFF)
+        {
+            break;
+        }
+    }
+
+    status = (i == req->batchCount) ? send_command(handle, "AT") : SIM800_ERROR;
+
+    for (uint8_t j = 0; j < req->batchCount && status == SIM800_OK; j++)
+    {
+        if ((j != 0 && send_command(handle, ";") != SIM800_OK) ||
+            send_command(handle, commands[req->batch[j].cmd].command + 2) != SIM800_OK)
+        {
+            status = SIM800_ERROR;
+        }
+    }
+
+    if (status == SIM800_OK && send_command(handle, "\r\n") == SIM800_OK)
+    {
+        return req->batch[0].index;
+    }
+
+    while (i--)
+    {
+        remove_expected_code(handle, req->batch[i].index);
+    }
+
+    return 0xFF;
+}
+
+
+/**
+ * @brief   Checks whether the final result code of a batch has been received.
+ *
+ * The final result code is stored in the expected code of whichever query has been answered last,
+ * so all of them are checked. Once it has been received, the status of every query is set: the parse
+ * status of its response if the result is "OK", the result otherwise.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the batch request.
+ * @retval  1 if the request is finished, 0 if it is still in progress.
+ */
+static uint8_t step_batch(SIM800_Handle_t *handle, SIM800_Request_t *req)
+{
+    SIM800_ExpectedCode_t *code;
+    SIM800_Status_t status = SIM800_OK;
+    int8_t final = -1;
+
+    for (uint8_t i = 0; i < req->batchCount; i++)
+    {
+        if (handle->expected_codes[req->batch[i].index].state == SIM800_ReceivedStatus)
+        {
+            final = req->batch[i].index;
+        }
+    }
+
+    if (final < 0)
+    {
+        if (HAL_GetTick() - req->tickStart > req->timeout)
+        {
+            for (uint8_t i = 0; i < req->batchCount; i++)
+            {
+                req->batch[i].status = SIM800_TIMEOUT;
+            }
+            return finish_request(handle, req, SIM800_TIMEOUT);
+        }
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < req->batchCount; i++)
+    {
+        code = &handle->expected_codes[req->batch[i].index];
+
+        req->batch[i].status = handle->expected_codes[final].result;
+        if (req->batch[i].status == SIM800_OK && code->parser != NULL)
+        {
+            req->batch[i].status = code->lines_count != 0 ? code->parsed : SIM800_ERROR;
+        }
+
+        if (req->batch[i].status != SIM800_OK)
+        {
+            status = req->batch[i].status;
+        }
+    }
+
+    return finish_request(handle, req, status);
+}
+
+
+/**
+ * @brief   Finishes the request being executed and invokes its completion callback.
+ *
+ * The expected code of the command is removed. If a request with a data block fails, the end character
+ * is sent so the module leaves the data input, and the rest of the payload of a failed read is dropped. A request
+ * failed by a retryable cause stays queued instead, see retry_request. The request is released before the callback
+ * is invoked, so the callback may submit new requests. A cancelled request is not retried, see cancel_request.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the request at the tail of the request queue.
+ * @param   status: Status of the request.
+ * @retval  1 if the request is finished, 0 if it is sent again.
+ */
+static uint8_t finish_request(SIM800_Handle_t *handle, SIM800_Request_t *req, SIM800_Status_t status)
+{
+    SIM800_RequestCallback_t done = req->done;
+    void *ctx = req->ctx;
+
+    if (req->cancel == 1)
+    {
+        // The transfer of a cancelled request is over, it gets the status of its cancellation
+        status = req->cancelStatus;
+    }
+    else if (req->cancel == 0 && status == SIM800_ERROR && retry_request(handle, req))
+    {
+        return 0;
+    }
+
+#if SIM800_USE_LATENCY
+    latency_finish(handle, req, status);
+#endif
+
+    // The watchdog counts the requests timed out in a row, any answer of the module clears the count
+    if (status != SIM800_TIMEOUT)
+    {
+        handle->watchdog.timeouts = 0;
+    }
+    else if (handle->watchdog.timeouts < 0xFF)
+    {
+        handle->watchdog.timeouts++;
+    }
+
+#if SIM800_USE_STATS
+    if (status == SIM800_TIMEOUT)
+    {
+        handle->stats.timeouts++;
+        if (req->cmd < SIM800_Cmd_Count && handle->stats.commandTimeouts[req->cmd] != 0xFFFF)
+        {
+            handle->stats.commandTimeouts[req->cmd]++;
+        }
+    }
+#endif
+
+    if (req->batch != NULL && req->index != 0xFF)
+    {
+        for (uint8_t i = 0; i < req->batchCount; i++)
+        {
+            remove_expected_code(handle, req->batch[i].index);
+        }
+    }
+    else if (req->index != 0xFF)
+    {
+        if (status != SIM800_OK && req->data != NULL && req->cancel == 0)
+        {
+            // Send the end character in case of a failure
+            send_command(handle, "\032");
+        }
+
+#if SIM800_USE_GPRS
+        if (status != SIM800_OK && (req->cmd == SIM800_Cmd_SocketRxGet
+#if SIM800_USE_HTTP
+                                    || req->cmd == SIM800_Cmd_HttpRead
+#endif
+#if SIM800_USE_FS
+                                    || req->cmd == SIM800_Cmd_FSRead
+#endif
+                                    ))
+        {
+            // Whatever is left of the payload must not land in the buffer of the failed read later
+            handle->rxRaw = 0;
+            handle->rxRawBuffer = NULL;
+#if SIM800_USE_HTTP
+            handle->rxRawHttp = 0;
+#endif
+        }
+#endif
+
+        remove_expected_code(handle, req->index);
+    }
+
+    handle->prompt = SIM800_Prompt_None;
+    handle->reqTail++;
+
+    if (done != NULL)
+    {
+        done(handle, status, ctx);
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief   Queues a failed request again if the retry policy of its command allows it.
+ *
+ * The request is retried if its command has a policy (see SIM800_SetRetryPolicy), attempts are left and the
+ * final result code carries one of the retryable causes. The backoff doubles with every attempt up to the upper
+ * bound; the request keeps its place at the tail of the queue meanwhile, so the requests behind it wait as well.
+ * The module has answered with a final result code, so it is not in the data input and no end character is sent.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the failed request.
+ * @retval  1 if the request is sent again, 0 if it is finished.
+ */
+static uint8_t retry_request(SIM800_Handle_t *handle, SIM800_Request_t *req)
+{
+    const SIM800_RetryPolicy_t *policy = NULL;
+    const uint16_t *causes;
+    uint8_t count, retryable = 0;
+    uint32_t backoff;
+
+    if (req->batch != NULL || (handle->lastError.type != SIM800_Error_CME && handle->lastError.type != SIM800_Error_CMS))
+    {
+        return 0;
+    }
+
+    for (uint8_t i = 0; i < SIM800_RETRY_RULES; i++)
+    {
+        if (handle->retry[i].policy != NULL && handle->retry[i].cmd == req->cmd)
+        {
+            policy = handle->retry[i].policy;
+            break;
+        }
+    }
+
+    if (policy == NULL || req->attempt + 1 >= policy->attempts)
+    {
+        return 0;
+    }
+
+    causes = (policy->causes != NULL) ? policy->causes : transient_causes;
+    count = (policy->causes != NULL) ? policy->causeCount : sizeof(transient_causes) / sizeof(transient_causes[0]);
+    for (uint8_t i = 0; i < count && !retryable; i++)
+    {
+        retryable = (causes[i] == handle->lastError.cause);
+    }
+
+    if (!retryable)
+    {
+        return 0;
+    }
+
+    backoff = policy->delay;
+    for (uint8_t i = 0; i < req->attempt && backoff < policy->maxDelay; i++)
+    {
+        backoff *= 2;
+    }
+
+    remove_expected_code(handle, req->index);
+    handle->prompt = SIM800_Prompt_None;
+
+    // Without a usable signal the retry is held off as long as the policy allows
+    if (!SIM800_IsSignalUsable(handle))
+    {
+        backoff = policy->maxDelay;
+    }
+
+    req->attempt++;
+    req->backoff = (backoff < policy->maxDelay) ? backoff : policy->maxDelay;
+    req->tickStart = HAL_GetTick();
+    req->index = 0xFF;
+    req->state = SIM800_Request_Queued;
+    handle->retries++;
+
+    return 1;
+}
+
+
+/**
+ * @brief   Aborts the command in flight of a cancelled request, see SIM800_Cancel.
+ *
+ * The queued blocks are sent first, they may point to the buffers of the caller. The response is detached from
+ * the caller's structures, then the completion callback is invoked and the request stays at the tail only until
+ * the module has answered the command (at most SIM800_CANCEL_DRAIN), so no answer is taken by the next command.
+ * A fixed-length block waiting for its prompt, or a socket read, is cancelled once its transfer is over instead.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the request at the tail of the request queue, its command is sent.
+ * @param   status: Status the request is finished with.
+ * @retval  1 if the callback has been invoked, 0 if it is invoked at the end of the transfer.
+ */
+static uint8_t cancel_request(SIM800_Handle_t *handle, SIM800_Request_t *req, SIM800_Status_t status)
+{
+    SIM800_RequestCallback_t done = req->done;
+    void *ctx = req->ctx;
+    SIM800_ExpectedCode_t *code;
+    uint32_t tickStart = HAL_GetTick();
+
+    if (req->cancel != 0)
+    {
+        return 0;
+    }
+
+    req->cancelStatus = status;
+
+#if SIM800_USE_GPRS
+    if (req->cmd == SIM800_Cmd_SocketSend || req->cmd == SIM800_Cmd_SocketOpen)
+    {
+        // The connection is closed behind the aborted command
+        socket_abort(handle, req->arg[0] - '0');
+    }
+
+#if SIM800_USE_FS
+    if ((req->state == SIM800_Request_WaitingPrompt && req->dataLength != 0) || req->cmd == SIM800_Cmd_SocketRxGet ||
+        req->cmd == SIM800_Cmd_FSRead)
+#else
+    if ((req->state == SIM800_Request_WaitingPrompt && req->dataLength != 0) || req->cmd == SIM800_Cmd_SocketRxGet)
+#endif
+#else
+    if (req->state == SIM800_Request_WaitingPrompt && req->dataLength != 0)
+#endif
+    {
+        req->cancel = 1;
+        return 0;
+    }
+
+    while (handle->txBusy || handle->txTail != handle->txHead)
+    {
+        tx_poll(handle);
+
+        if (HAL_GetTick() - tickStart > SIM800_MAX_DELAY)
+        {
+            break;
+        }
+    }
+
+    if (req->batch != NULL)
+    {
+        // The first query takes the final result, see result_index
+        for (uint8_t i = 0; i < req->batchCount; i++)
+        {
+            req->batch[i].status = status;
+            if (i != 0)
+            {
+                remove_expected_code(handle, req->batch[i].index);
+            }
+        }
+        req->batch = NULL;
+    }
+
+    if (req->index < EXPECTED_CODES_MAX_COUNT)
+    {
+        code = &handle->expected_codes[req->index];
+        code->parser = NULL;
+        code->response = NULL;
+    }
+
+    req->response = NULL;
+    req->done = NULL;
+    req->cancel = 2;
+    req->tickStart = HAL_GetTick();
+    req->timeout = SIM800_CANCEL_DRAIN;
+
+    if (done != NULL)
+    {
+        done(handle, status, ctx);
+    }
+
+    return 1;
+}
+
+
+#if SIM800_USE_GPRS
+
+/**
+ * @brief   Queues the closing of a connection whose "AT+CIPSTART" or "AT+CIPSEND" has been cancelled.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ */
+static void socket_abort(SIM800_Handle_t *handle, uint8_t socket)
+{
+    SIM800_Request_t *req = claim_request(handle, SIM800_Cmd_SocketClose, NULL, NULL, NULL, &socket_abort_done,
+                                          &handle->sockets[socket], NULL);
+
+    if (req != NULL)
+    {
+        req->number[0] = '0' + socket;
+        req->number[1] = '\0';
+        req->arg = req->number;
+        commit_request(handle);
+    }
+}
+
+
+/**
+ * @brief   Completion callback of socket_abort, the connection is gone unless the module did not answer.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of "AT+CIPCLOSE".
+ * @param   *ctx: Pointer to the socket.
+ */
+static void socket_abort_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    if (status != SIM800_TIMEOUT)
+    {
+        ((SIM800_Socket_t *)ctx)->state = SIM800_Socket_Closed;
+    }
+}
+
+#endif /* SIM800_USE_GPRS */
+
+
+/**
+ * @brief   Removes queued requests that have not been sent from the request queue.
+ *
+ * The requests behind are moved up, so their slots are free at once; no request is claimed meanwhile (see
+ * claim_request). The completion callbacks are invoked once the queue is consistent again, they may submit
+ * new requests.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   token: Cancel token of the requests to remove (SIM800_ERROR), 0 - the ones past their deadline (SIM800_TIMEOUT).
+ * @retval  Count of removed requests.
+ */
+static uint8_t drop_requests(SIM800_Handle_t *handle, uint32_t token)
+{
+    SIM800_RequestCallback_t done[REQUEST_QUEUE_LENGTH];
+    void *ctx[REQUEST_QUEUE_LENGTH];
+    SIM800_Request_t *req, *to;
+    uint32_t read = handle->reqTail, write;
+    uint32_t primask = __get_PRIMASK();
+    uint8_t count = 0;
+
+    __disable_irq();
+
+    // The request in flight stays
+    if (read != handle->reqHead && handle->requests[read & (REQUEST_QUEUE_LENGTH - 1)].state != SIM800_Request_Queued)
+    {
+        read++;
+    }
+
+    for (write = read; read != handle->reqHead; read++)
+    {
+        req = &handle->requests[read & (REQUEST_QUEUE_LENGTH - 1)];
+
+        if (token != 0 ? req->token == token : (req->deadline != 0 && (int32_t)(HAL_GetTick() - req->deadline) >= 0))
+        {
+            done[count] = req->done;
+            ctx[count] = req->ctx;
+            count++;
+            continue;
+        }
+
+        if (write != read)
+        {
+            // The numeric argument lives in the request itself
+            to = &handle->requests[write & (REQUEST_QUEUE_LENGTH - 1)];
+            *to = *req;
+            if (req->arg == req->number)
+            {
+                to->arg = to->number;
+            }
+            if (req->response == req->number)
+            {
+                to->response = to->number;
+            }
+        }
+        write++;
+    }
+
+    handle->reqHead = write;
+    __set_PRIMASK(primask);
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (done[i] != NULL)
+        {
+            done[i](handle, token != 0 ? SIM800_ERROR : SIM800_TIMEOUT, ctx[i]);
+        }
+    }
+
+    return count;
+}
+
+
+#if SIM800_USE_LATENCY || SIM800_USE_ISR_BUDGET
+
+/**
+ * @brief   Reads the DWT cycle counter, it is started the first time.
+ *
+ * @retval  Count of core clock cycles.
+ */
+static uint32_t dwt_cycles(void)
+{
+    if (!(DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk))
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    return DWT->CYCCNT;
+}
+
+#endif
+
+
+#if SIM800_USE_ISR_BUDGET
+
+/**
+ * @brief   Adds a run of an interrupt handler to the ISR statistics.
+ *
+ * The statistics are updated with interrupts disabled, the handlers of the UART and of its DMA may preempt
+ * each other. SIM800_ISRBudgetCallBack is invoked after the run, it is not counted in it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   start: Cycle counter at the entry of the handler.
+ */
+static void isr_exit(SIM800_Handle_t *handle, uint32_t start)
+{
+    SIM800_ISRMonitor_t *isr = &handle->isr;
+    uint32_t cycles = dwt_cycles() - start;
+    uint32_t primask = __get_PRIMASK();
+    uint8_t exceeded;
+
+    __disable_irq();
+    isr->count++;
+    isr->total += cycles;
+    if (cycles > isr->max)
+    {
+        isr->max = cycles;
+    }
+    exceeded = (isr->budget != 0 && cycles > isr->budget);
+    isr->exceeded += exceeded;
+    __set_PRIMASK(primask);
+
+    if (exceeded)
+    {
+        SIM800_ISRBudgetCallBack(handle, cycles_to_ns(cycles));
+    }
+}
+
+
+/**
+ * @brief   Converts core clock cycles to nanoseconds.
+ *
+ * @param   cycles: Count of cycles.
+ * @retval  Nanoseconds, 0 if the core clock is below 1 MHz.
+ */
+static uint32_t cycles_to_ns(uint32_t cycles)
+{
+    uint32_t mhz = SystemCoreClock / 1000000u;
+
+    return (mhz != 0) ? (uint32_t)((uint64_t)cycles * 1000u / mhz) : 0;
+}
+
+#endif /* SIM800_USE_ISR_BUDGET */
+
+
+#if SIM800_USE_LATENCY
+
+
+/**
+ * @brief   Stamps the request being measured.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   stamp: 0 - start, 1 - transmitted, 2 - first response line, 3 - final result code.
+ */
+static void latency_stamp(SIM800_Handle_t *handle, uint8_t stamp)
+{
+    handle->latency.cycles[stamp] = dwt_cycles();
+    handle->latency.ticks[stamp] = HAL_GetTick();
+}
+
+
+/**
+ * @brief   Stamps the start of a request, before its command is queued.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void latency_start(SIM800_Handle_t *handle)
+{
+    handle->latency.stage = 0;
+    latency_stamp(handle, 0);
+}
+
+
+/**
+ * @brief   Starts measuring a request whose command has been queued.
+ *
+ * The command may have been transmitted while it was queued, so the transmission is checked right away.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the request.
+ */
+static void latency_sent(SIM800_Handle_t *handle, SIM800_Request_t *req)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    if (req->batch != NULL)
+    {
+        return;
+    }
+
+    handle->latency.cmd = req->cmd;
+    handle->latency.index = req->index;
+    handle->latency.txEnd = handle->txHead;
+
+    __disable_irq();
+    handle->latency.stage = 1;
+    latency_tx(handle);
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief   Stamps the end of the transmission of the command being measured.
+ *
+ * Called with interrupts disabled or from the TX-complete interrupt, whenever a block has been sent.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void latency_tx(SIM800_Handle_t *handle)
+{
+    if (handle->latency.stage == 1 && (int32_t)(handle->txTail - handle->latency.txEnd) >= 0)
+    {
+        latency_stamp(handle, 1);
+        handle->latency.stage = 2;
+    }
+}
+
+
+/**
+ * @brief   Stamps the first response line of the request being measured.
+ *
+ * If the end of the transmission has not been seen yet (e.g. it is only picked up by SIM800_Process), it gets the
+ * same stamp.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code the line belongs to.
+ */
+static void latency_line(SIM800_Handle_t *handle, uint8_t index)
+{
+    SIM800_LatencyMonitor_t *latency = &handle->latency;
+
+    if ((latency->stage == 1 || latency->stage == 2) && index == latency->index)
+    {
+        latency_stamp(handle, 2);
+        if (latency->stage == 1)
+        {
+            latency->cycles[1] = latency->cycles[2];
+            latency->ticks[1] = latency->ticks[2];
+        }
+        latency->stage = 3;
+    }
+}
+
+
+/**
+ * @brief   Adds the request being measured to the histograms of its command.
+ *
+ * Only the requests finished with "OK" are added, the others are counted in failed.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *req: Pointer to the finished request.
+ * @param   status: Status of the request.
+ */
+static void latency_finish(SIM800_Handle_t *handle, SIM800_Request_t *req, SIM800_Status_t status)
+{
+    SIM800_LatencyMonitor_t *latency = &handle->latency;
+    SIM800_Latency_t *entry = NULL;
+    uint32_t us, bucket;
+
+    if (latency->stage == 0 || req->batch != NULL || req->cmd != latency->cmd)
+    {
+        return;
+    }
+
+    latency_stamp(handle, 3);
+
+    // Stamps not seen get the final one, the stage is merged into the next one
+    for (uint8_t i = latency->stage; i < 3; i++)
+    {
+        latency->cycles[i] = latency->cycles[3];
+        latency->ticks[i] = latency->ticks[3];
+    }
+    latency->stage = 0;
+
+    for (uint8_t i = 0; i < SIM800_LATENCY_COMMANDS; i++)
+    {
+        if (latency->commands[i].count + latency->commands[i].failed == 0)
+        {
+            if (entry == NULL)
+            {
+                entry = &latency->commands[i];
+            }
+        }
+        else if (latency->commands[i].cmd == req->cmd)
+        {
+            entry = &latency->commands[i];
+            break;
+        }
+    }
+
+    if (entry == NULL)
+    {
+        latency->untracked++;
+        return;
+    }
+
+    entry->cmd = req->cmd;
+
+    if (status != SIM800_OK)
+    {
+        entry->failed++;
+        return;
+    }
+
+    entry->count++;
+
+    for (uint8_t i = 0; i < SIM800_Latency_Count; i++)
+    {
+        us = (i == SIM800_Latency_Total) ? latency_us(latency, 0, 3) : latency_us(latency, i, i + 1);
+        bucket = (us != 0) ? 32 - __CLZ(us) : 0;
+        if (bucket >= SIM800_LATENCY_BUCKETS)
+        {
+            bucket = SIM800_LATENCY_BUCKETS - 1;
+        }
+
+        if (entry->histogram[i][bucket] != 0xFFFF)
+        {
+            entry->histogram[i][bucket]++;
+        }
+    }
+}
+
+
+/**
+ * @brief   Calculates the time between two stamps.
+ *
+ * The cycle counter wraps within seconds, longer stages are measured in ticks.
+ *
+ * @param   *latency: Pointer to the latency measurement.
+ * @param   from: First stamp.
+ * @param   to: Second stamp.
+ * @retval  Microseconds.
+ */
+static uint32_t latency_us(SIM800_LatencyMonitor_t *latency, uint8_t from, uint8_t to)
+{
+    uint32_t ticks = latency->ticks[to] - latency->ticks[from];
+    uint32_t mhz = SystemCoreClock / 1000000u;
+
+    if (ticks >= 1000 || mhz == 0)
+    {
+        return ticks * 1000;
+    }
+
+    return (latency->cycles[to] - latency->cycles[from]) / mhz;
+}
+
+#endif /* SIM800_USE_LATENCY */
+
+
+/**
+ * @brief   Sends an AT command to the SIM800 module.
+ *
+ * This function queues a constant string (or a part of a command) for transmission without copying it,
+ * so it may only be used for strings that are never changed, e.g. the strings of the command table.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *cmd: Pointer to the constant string to be sent.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if the queue stays full.
+ */
+static SIM800_Status_t send_command(SIM800_Handle_t *handle, const char *cmd)
+{
+    return tx_enqueue(handle, (const uint8_t *)cmd, strlen(cmd), 0, NULL, NULL);
+}
+
+
+/**
+ * @brief   Sends caller supplied data to the SIM800 module.
+ *
+ * This function copies the string into the transmit arena before it is queued, so the caller's buffer
+ * (e.g., a command argument on the stack) is free as soon as the function returns.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Pointer to the string to be sent.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if the queue stays full.
+ */
+static SIM800_Status_t send_data(SIM800_Handle_t *handle, const char *data)
+{
+    return tx_enqueue(handle, (const uint8_t *)data, strlen(data), 1, NULL, NULL);
+}
+
+
+/**
+ * @brief   Sends a binary data block in hex (e.g., a PDU).
+ *
+ * The block is converted in small pieces, each copied into the arena, so its hex form is never
+ * held in memory as a whole.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @retval  SIM800_OK on success, SIM800_ERROR if a piece can not be queued.
+ */
+static SIM800_Status_t send_hex(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char piece[64];
+    uint16_t n;
+
+    while (length != 0)
+    {
+        n = (length > sizeof(piece) / 2) ? sizeof(piece) / 2 : length;
+
+        for (uint16_t i = 0; i < n; i++)
+        {
+            piece[2 * i] = digits[data[i] >> 4];
+            piece[2 * i + 1] = digits[data[i] & 0x0F];
+        }
+
+        if (tx_enqueue(handle, (const uint8_t *)piece, 2 * n, 1, NULL, NULL) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+
+        data += n;
+        length -= n;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Queues the pieces of a scattered data block back to back.
+ *
+ * Every piece is pinned, the queue waits for free slots if there are more pieces than slots.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *iov: Pieces of the data block.
+ * @param   count: Count of pieces.
+ * @retval  SIM800_OK on success, SIM800_ERROR if a piece can not be queued.
+ */
+static SIM800_Status_t send_iov(SIM800_Handle_t *handle, const SIM800_IOVec_t *iov, uint8_t count)
+{
+    for (uint8_t i = 0; i < count; i++)
+    {
+        // Empty pieces are allowed, they are skipped
+        if (iov[i].length != 0 && tx_enqueue(handle, iov[i].data, iov[i].length, 0, NULL, NULL) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    return SIM800_OK;
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Sends a UTF-8 text as UCS2 hex (the "UCS2" character set).
+ *
+ * The text is converted in small pieces, each copied into the arena, so its hex form (four digits per
+ * character) is never held in memory as a whole. A character outside the basic plane is sent as a
+ * surrogate pair.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *text: Text to send.
+ * @retval  SIM800_OK on success, SIM800_ERROR if a piece can not be queued.
+ */
+static SIM800_Status_t send_ucs2(SIM800_Handle_t *handle, const char *text)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char piece[64];
+    uint16_t units[2];
+    uint32_t code;
+    uint8_t n, count;
+
+    while (*text != '\0')
+    {
+        n = 0;
+
+        // Stop a piece early rather than split a surrogate pair
+        while (*text != '\0' && (size_t)n + 8 <= sizeof(piece))
+        {
+            code = SIM800_UTF8_Decode(&text);
+
+            if (code >= 0x10000 && code <= 0x10FFFF)
+            {
+                units[0] = 0xD800 + ((code - 0x10000) >> 10);
+                units[1] = 0xDC00 + ((code - 0x10000) & 0x3FF);
+                count = 2;
+            }
+            else
+            {
+                units[0] = (code > 0xFFFF) ? 0xFFFD : (uint16_t)code;
+                count = 1;
+            }
+
+            for (uint8_t i = 0; i < count; i++)
+            {
+                piece[n++] = digits[units[i] >> 12];
+                piece[n++] = digits[(units[i] >> 8) & 0x0F];
+                piece[n++] = digits[(units[i] >> 4) & 0x0F];
+                piece[n++] = digits[units[i] & 0x0F];
+            }
+        }
+
+        if (tx_enqueue(handle, (const uint8_t *)piece, n, 1, NULL, NULL) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+/**
+ * @brief   Appends a block to the transmit queue and starts the transmission if the UART is idle.
+ *
+ * A copied block is placed in one piece into handle->txArena (a block that does not fit at the end of
+ * the arena starts at its beginning), so it can be sent by a single transfer. At most TX_ARENA_LENGTH / 2
+ * bytes can be copied at once. If the queue or the arena is full, the function waits for the transmissions
+ * in progress, picking up finished ones itself in case SIM800_TxCpltHandler is not called.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @param   copy: 1 to copy the data into the arena, 0 to pin it.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if the queue stays full.
+ */
+static SIM800_Status_t tx_enqueue(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, uint8_t copy,
+                                  SIM800_TxCallback_t done, void *ctx)
+{
+    uint32_t tickStart = HAL_GetTick();
+    uint32_t pos = handle->txArenaHead & (TX_ARENA_LENGTH - 1);
+    uint32_t skip = 0;
+    SIM800_TxBlock_t *block;
+
+    if (data == NULL || length == 0 || (copy && length > TX_ARENA_LENGTH / 2))
+    {
+        return SIM800_ERROR;
+    }
+
+    if (copy && TX_ARENA_LENGTH - pos < length)
+    {
+        // The copy does not fit at the end of the arena, skip the rest of it
+        skip = TX_ARENA_LENGTH - pos;
+    }
+
+    // Wait for a free queue slot and enough free arena space
+    while (handle->txHead - handle->txTail >= TX_QUEUE_LENGTH ||
+           (copy && handle->txArenaHead + skip + length - handle->txArenaTail > TX_ARENA_LENGTH))
+    {
+        tx_poll(handle);
+
+        if (HAL_GetTick() - tickStart > SIM800_MAX_DELAY)
+        {
+            return SIM800_TIMEOUT;
+        }
+    }
+
+    block = &handle->txQueue[handle->txHead & (TX_QUEUE_LENGTH - 1)];
+
+    if (copy)
+    {
+        uint8_t *dst = &handle->txArena[(handle->txArenaHead + skip) & (TX_ARENA_LENGTH - 1)];
+
+        memcpy(dst, data, length);
+        handle->txArenaHead += skip + length;
+        data = dst;
+    }
+
+    block->data = data;
+    block->length = length;
+    block->arena = copy ? skip + length : 0;
+    block->done = done;
+    block->ctx = ctx;
+
+    // Make sure the block is written before it is published to the TX-complete interrupt
+    __DMB();
+    handle->txHead++;
+
+#if SIM800_USE_TRACE
+    trace_record(handle, SIM800_Trace_TX, data, length, NULL, 0);
+#endif
+
+    tx_start(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Starts sending the block at the tail of the transmit queue if nothing is being sent.
+ *
+ * The function runs with interrupts disabled, so the submitting code and the TX-complete interrupt
+ * can not start a transmission at the same time. A block that the UART refuses is completed with
+ * SIM800_ERROR and counted in handle->txErrors, so the queue never stalls on it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void tx_start(SIM800_Handle_t *handle)
+{
+    uint32_t primask = __get_PRIMASK();
+    SIM800_TxBlock_t *block;
+    HAL_StatusTypeDef status;
+
+    if (handle->link != NULL)
+    {
+        link_transmit(handle);
+        return;
+    }
+
+    __disable_irq();
+
+    while (!handle->txBusy && handle->txTail != handle->txHead)
+    {
+        block = &handle->txQueue[handle->txTail & (TX_QUEUE_LENGTH - 1)];
+        handle->txBusy = 1;
+
+        if (handle->txMode == SIM800_TxMode_DMA)
+        {
+            status = HAL_UART_Transmit_DMA(handle->uart, (uint8_t *)block->data, block->length);
+        }
+        else
+        {
+            status = HAL_UART_Transmit_IT(handle->uart, (uint8_t *)block->data, block->length);
+        }
+
+        if (status != HAL_OK)
+        {
+            handle->txErrors++;
+            tx_complete(handle, SIM800_ERROR);
+        }
+    }
+
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief   Releases the block at the tail of the transmit queue and invokes its completion callback.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status passed to the completion callback.
+ */
+static void tx_complete(SIM800_Handle_t *handle, SIM800_Status_t status)
+{
+    // Copy the block, its slot can be reused by the completion callback
+    SIM800_TxBlock_t block = handle->txQueue[handle->txTail & (TX_QUEUE_LENGTH - 1)];
+
+    handle->txArenaTail += block.arena;
+    handle->txTail++;
+    handle->txBusy = 0;
+
+#if SIM800_USE_LATENCY
+    latency_tx(handle);
+#endif
+
+    if (block.done != NULL)
+    {
+        block.done(handle, status, block.ctx);
+    }
+}
+
+
+/**
+ * @brief   Picks up a finished transmission that has not been reported by SIM800_TxCpltHandler.
+ *
+ * The UART is back in the ready state once a transmission has finished. Interrupts are disabled
+ * while checking, so a transmission completed by the interrupt is never completed twice.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void tx_poll(SIM800_Handle_t *handle)
+{
+    uint32_t primask = __get_PRIMASK();
+
+    if (handle->link != NULL)
+    {
+        if (handle->link->poll != NULL)
+        {
+            handle->link->poll(handle, handle->linkCtx);
+        }
+
+        link_transmit(handle);
+        return;
+    }
+
+    __disable_irq();
+
+    if (handle->txBusy && handle->uart->gState == HAL_UART_STATE_READY)
+    {
+        tx_complete(handle, SIM800_OK);
+    }
+
+    __set_PRIMASK(primask);
+
+    tx_start(handle);
+}
+
+
+#if SIM800_USE_TRACE
+
+/**
+ * @brief   Appends a record to the trace ring.
+ *
+ * The characters are given in two pieces, so a line that wraps around the receive ring is recorded as it
+ * lies. Records longer than SIM800_TRACE_RECORD_MAX are cut, the oldest records make room for the new one.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   type: Type of the record, see SIM800_TraceType_t.
+ * @param   *first: First piece of the characters.
+ * @param   firstLength: Count of characters of the first piece.
+ * @param   *second: Second piece of the characters, may be NULL.
+ * @param   secondLength: Count of characters of the second piece.
+ */
+static void trace_record(SIM800_Handle_t *handle, uint8_t type, const uint8_t *first, uint16_t firstLength,
+                         const uint8_t *second, uint16_t secondLength)
+{
+    SIM800_Trace_t *trace = &handle->trace;
+    uint32_t primask = __get_PRIMASK();
+    uint32_t tick = HAL_GetTick();
+    uint8_t header[SIM800_TRACE_HEADER];
+    uint16_t length;
+
+    if (firstLength > SIM800_TRACE_RECORD_MAX)
+    {
+        firstLength = SIM800_TRACE_RECORD_MAX;
+    }
+    if (secondLength > SIM800_TRACE_RECORD_MAX - firstLength)
+    {
+        secondLength = SIM800_TRACE_RECORD_MAX - firstLength;
+    }
+    length = firstLength + secondLength;
+
+    header[0] = type;
+    header[1] = length & 0xFF;
+    header[2] = length >> 8;
+    header[3] = tick & 0xFF;
+    header[4] = (tick >> 8) & 0xFF;
+    header[5] = (tick >> 16) & 0xFF;
+    header[6] = tick >> 24;
+
+    // Blocks are also queued from the TX-complete interrupt
+    __disable_irq();
+
+    if (!trace->paused)
+    {
+        while (trace->head - trace->tail + SIM800_TRACE_HEADER + length > SIM800_TRACE_LENGTH)
+        {
+            trace->tail += SIM800_TRACE_HEADER + (trace->ring[(trace->tail + 1) & (SIM800_TRACE_LENGTH - 1)] |
+                                                  trace->ring[(trace->tail + 2) & (SIM800_TRACE_LENGTH - 1)] << 8);
+            trace->dropped++;
+        }
+
+        trace_put(trace, header, SIM800_TRACE_HEADER);
+        trace_put(trace, first, firstLength);
+        trace_put(trace, second, secondLength);
+    }
+
+    __set_PRIMASK(primask);
+}
+
+
+/**
+ * @brief   Records received characters kept in the receive ring.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   start: Free-running ring index of the first character.
+ * @param   length: Count of characters.
+ */
+static void trace_rx(SIM800_Handle_t *handle, uint32_t start, uint32_t length)
+{
+    uint32_t pos = start & (RX_RING_LENGTH - 1);
+    uint32_t first = (RX_RING_LENGTH - pos < length) ? RX_RING_LENGTH - pos : length;
+
+    trace_record(handle, SIM800_Trace_RX, (const uint8_t *)&handle->rxRing[pos], first,
+                 (const uint8_t *)handle->rxRing, length - first);
+}
+
+
+/**
+ * @brief   Copies characters to the head of the trace ring.
+ *
+ * @param   *trace: Pointer to the trace ring.
+ * @param   *data: Characters, may be NULL if length is 0.
+ * @param   length: Count of characters.
+ */
+static void trace_put(SIM800_Trace_t *trace, const uint8_t *data, uint16_t length)
+{
+    uint32_t pos = trace->head & (SIM800_TRACE_LENGTH - 1);
+    uint32_t first = (SIM800_TRACE_LENGTH - pos < length) ? SIM800_TRACE_LENGTH - pos : length;
+
+    if (length == 0)
+    {
+        return;
+    }
+
+    memcpy(&trace->ring[pos], data, first);
+    memcpy(trace->ring, data + first, length - first);
+    trace->head += length;
+}
+
+#endif /* SIM800_USE_TRACE */
+
+
+/**
+ * @brief   Hands the queued blocks of a handle to its link, see SIM800_AttachLink.
+ *
+ * No interrupt is involved, the blocks are completed as soon as the link has taken them. A block the link
+ * does not take at once stays at the tail of the queue and its rest is offered again by tx_poll.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void link_transmit(SIM800_Handle_t *handle)
+{
+    SIM800_TxBlock_t *block;
+
+    // A completion callback queueing a block ends up here again, the loop below sends it
+    if (handle->linkSending)
+    {
+        return;
+    }
+    handle->linkSending = 1;
+
+    while (handle->txTail != handle->txHead)
+    {
+        block = &handle->txQueue[handle->txTail & (TX_QUEUE_LENGTH - 1)];
+        handle->txBusy = 1;
+
+        handle->linkOffset += handle->link->transmit(handle, &block->data[handle->linkOffset],
+                                                     block->length - handle->linkOffset, handle->linkCtx);
+        if (handle->linkOffset < block->length)
+        {
+            break;
+        }
+
+        handle->linkOffset = 0;
+        tx_complete(handle, SIM800_OK);
+    }
+
+    handle->linkSending = 0;
+}
+
+
+/**
+ * @brief   Hands the received characters to the raw receiver instead of the line parser, see SIM800_EnterMux.
+ *
+ * The characters are passed straight from the receive ring, in at most two pieces when the ring wraps.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   head: Write index of the receive ring the characters are available up to.
+ */
+static void raw_rx(SIM800_Handle_t *handle, uint32_t head)
+{
+    uint32_t pos, length;
+
+    while (handle->rawRx != NULL && handle->rxScan != head)
+    {
+        pos = handle->rxScan & (RX_RING_LENGTH - 1);
+        length = head - handle->rxScan;
+        if (length > RX_RING_LENGTH - pos)
+        {
+            length = RX_RING_LENGTH - pos;
+        }
+
+        handle->rawRx(handle, &handle->rxRing[pos], length, handle->rawCtx);
+
+        handle->rxScan += length;
+        handle->rxLineStart = handle->rxScan;
+        handle->rxTail = handle->rxScan;
+    }
+}
+
+
+/**
+ * @brief   Validates an AT command response.
+ *
+ * This function validates the response of an expected code received from the SIM800 module.
+ * It checks if the final result code of the response is "OK", indicating a successful command execution.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected message code to check.
+ * @retval  SIM800_OK if the response was finished with "OK", SIM800_ERROR otherwise.
+ */
+static SIM800_Status_t validate_response(SIM800_Handle_t *handle, uint8_t index)
+{
+    if (handle->expected_codes[index].state == SIM800_ReceivedStatus &&
+        handle->expected_codes[index].result == SIM800_OK)
+    {
+        return SIM800_OK;
+    }
+
+    return SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Converts an unsigned number to a decimal string.
+ *
+ * @param   value: Number to convert.
+ * @param   *str: Destination buffer, at least 11 characters long.
+ */
+static void uint_to_str(uint32_t value, char *str)
+{
+    char tmp[10];
+    uint8_t len = 0;
+
+    do
+    {
+        tmp[len++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+
+    while (len)
+    {
+        *str++ = tmp[--len];
+    }
+    *str = '\0';
+}
+
+
+/**
+ * @brief   Reads a value through the cache of the handle.
+ *
+ * The value is read from the module into the handle unless it is cached and has not expired, a value refreshed
+ * in the background is served even if it has expired. The value is then copied to the caller.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   item: Value to read, see SIM800_CacheItem_t.
+ * @param   *value: Destination of the value.
+ * @param   size: Size of the destination.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t cached_query(SIM800_Handle_t *handle, SIM800_CacheItem_t item, void *value, size_t size)
+{
+    SIM800_CacheEntry_t *entry = &handle->cache[item];
+    void *cached = cache_value(handle, item, &size);
+    SIM800_Status_t status;
+
+    if (cache_expired(handle, item))
+    {
+        if ((status = execute_command(handle, cache_commands[item], NULL, NULL, cached)) != SIM800_OK)
+        {
+            entry->valid = 0;
+            return status;
+        }
+
+        entry->valid = 1;
+        entry->tick = HAL_GetTick();
+    }
+
+    memcpy(value, cached, size);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Checks whether a cached value has to be read from the module.
+ *
+ * The cells and the location are kept while the serving cell stays the same, which is only known with the
+ * location notifications enabled; their TTL, if set, limits their age further.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   item: Cached value, see SIM800_CacheItem_t.
+ * @retval  1 if the value has to be read, 0 if the cached one is served.
+ */
+static uint8_t cache_expired(SIM800_Handle_t *handle, SIM800_CacheItem_t item)
+{
+    SIM800_CacheEntry_t *entry = &handle->cache[item];
+    uint32_t ttl = entry->ttl;
+
+    if (item >= SIM800_Cache_CellInfo)
+    {
+        if (handle->regNotifications == 0 || handle->regCellId == 0)
+        {
+            return 1;
+        }
+
+        if (ttl == 0)
+        {
+            ttl = SIM800_CACHE_FOREVER;
+        }
+    }
+
+    return !entry->valid || ttl == 0 ||
+           (!entry->background && ttl != SIM800_CACHE_FOREVER && HAL_GetTick() - entry->tick >= ttl);
+}
+
+
+/**
+ * @brief   Returns the storage of a cached value in the handle.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   item: Cached value, see SIM800_CacheItem_t.
+ * @param   *size: Pointer to the size of the caller's buffer, limited to the size of the storage.
+ * @retval  Pointer to the storage.
+ */
+static void *cache_value(SIM800_Handle_t *handle, SIM800_CacheItem_t item, size_t *size)
+{
+    void *value;
+    size_t length;
+
+    switch (item)
+    {
+    case SIM800_Cache_Battery:
+        value = &handle->battery;
+        length = sizeof(handle->battery);
+        break;
+    case SIM800_Cache_Signal:
+        value = &handle->signal;
+        length = sizeof(handle->signal);
+        break;
+    case SIM800_Cache_IMEI:
+        value = handle->imei;
+        length = sizeof(handle->imei);
+        break;
+    case SIM800_Cache_CellInfo:
+        value = &handle->cellInfo;
+        length = sizeof(handle->cellInfo);
+        break;
+#if SIM800_USE_HTTP
+    case SIM800_Cache_Location:
+        value = &handle->location;
+        length = sizeof(handle->location);
+        break;
+#endif
+    default:
+        value = handle->iccid;
+        length = sizeof(handle->iccid);
+        break;
+    }
+
+    if (*size > length)
+    {
+        *size = length;
+    }
+
+    return value;
+}
+
+
+/**
+ * @brief   Submits a refresh of the expired cached values that are refreshed in the background.
+ *
+ * A refresh is only submitted when no other request is queued, so it never delays the application's commands.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void cache_refresh(SIM800_Handle_t *handle)
+{
+    SIM800_CacheEntry_t *entry;
+    size_t size = 0;
+
+    for (uint8_t i = 0; i < SIM800_Cache_Count && handle->reqTail == handle->reqHead; i++)
+    {
+        entry = &handle->cache[i];
+
+        if (entry->background && entry->valid && !entry->pending && entry->ttl != 0 &&
+            entry->ttl != SIM800_CACHE_FOREVER && HAL_GetTick() - entry->tick >= entry->ttl &&
+            submit_request(handle, cache_commands[i], NULL, NULL, cache_value(handle, i, &size), &cache_done, entry, NULL) != NULL)
+        {
+            entry->pending = 1;
+        }
+    }
+}
+
+
+/**
+ * @brief   Submits a signal sample once the sampling period is over and no other request is queued.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void signal_poll(SIM800_Handle_t *handle)
+{
+    SIM800_SignalSampler_t *sampler = &handle->signalSampler;
+
+    if (sampler->period != 0 && !sampler->pending && handle->reqTail == handle->reqHead &&
+        HAL_GetTick() - sampler->tick >= sampler->period &&
+        submit_request(handle, SIM800_Cmd_SignalQuality, NULL, NULL, &sampler->sample, &signal_done, NULL, NULL) != NULL)
+    {
+        sampler->pending = 1;
+    }
+}
+
+
+/**
+ * @brief   Completion callback of a signal sample.
+ *
+ * The sample is appended to the ring and refreshes the cached signal quality. A failed sample is not
+ * recorded, the next one is taken after the period.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Not used.
+ */
+static void signal_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_SignalSampler_t *sampler = &handle->signalSampler;
+    SIM800_CacheEntry_t *entry = &handle->cache[SIM800_Cache_Signal];
+
+    sampler->pending = 0;
+    sampler->tick = HAL_GetTick();
+
+    if (status != SIM800_OK)
+    {
+        return;
+    }
+
+    sampler->samples[sampler->head++ & (SIM800_SIGNAL_SAMPLES - 1)] = sampler->sample;
+
+    handle->signal = sampler->sample;
+    entry->valid = 1;
+    entry->tick = sampler->tick;
+}
+
+
+/**
+ * @brief   Appends a setting to a combined command line.
+ *
+ * The settings are separated by ';'.
+ *
+ * @param   *line: Command line being built, NUL-terminated.
+ * @param   size: Size of the command line buffer.
+ * @param   *setting: Setting command without "AT" (e.g., "+CSCS=\"").
+ * @param   *value: Value appended to the setting.
+ * @param   *end: String appended after the value (e.g., "\"").
+ * @retval  SIM800_OK on success, SIM800_ERROR if the line does not fit the buffer.
+ */
+static SIM800_Status_t append_setting(char *line, size_t size, const char *setting, const char *value, const char *end)
+{
+    size_t len = strlen(line);
+
+    if (len + (len != 0) + strlen(setting) + strlen(value) + strlen(end) >= size)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (len != 0)
+    {
+        strcat(line, ";");
+    }
+    strcat(line, setting);
+    strcat(line, value);
+    strcat(line, end);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Combines the settings of a configuration into one command line, see SIM800_Init.
+ *
+ * @param   *config: Pointer to the configuration.
+ * @param   ucs2: 1 if the character set is UCS2, the SMS parameters are set for UCS2 texts.
+ * @param   *line: Buffer of the command line, without the leading "AT".
+ * @param   size: Size of the buffer.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the settings do not fit the buffer.
+ */
+static SIM800_Status_t init_settings(const SIM800_Config_t *config, uint8_t ucs2, char *line, size_t size)
+{
+    char mode[2] = { (char)('0' + config->errorMode), 0 };
+
+    *line = '\0';
+
+#if SIM800_USE_SMS
+    if (append_setting(line, size, (config->textMode || !SIM800_USE_PDU) ? "+CMGF=1" : "+CMGF=0", "", "") != SIM800_OK ||
+        (config->smsNotifications && append_setting(line, size, "+CNMI=2,1", "", "") != SIM800_OK))
+    {
+        return SIM800_ERROR;
+    }
+#endif
+
+    if (append_setting(line, size, "+CMEE=", mode, "") != SIM800_OK ||
+        (config->charset != NULL && append_setting(line, size, "+CSCS=\"", config->charset, "\"") != SIM800_OK))
+    {
+        return SIM800_ERROR;
+    }
+
+#if SIM800_USE_SMS
+    if ((ucs2 && append_setting(line, size, "+CSMP=17,167,0,8", "", "") != SIM800_OK) ||
+        (config->storage != NULL && append_setting(line, size, "+CPMS=\"", config->storage, "\"") != SIM800_OK))
+    {
+        return SIM800_ERROR;
+    }
+#endif
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Calculates the fingerprint of the settings of SIM800_Init kept with the profile of the module.
+ *
+ * @param   *line: Command line of the settings, see init_settings.
+ * @retval  Fingerprint, never 0 (the value of a module without a marker).
+ */
+static uint32_t profile_fingerprint(const char *line)
+{
+    uint32_t hash = 5381;
+
+    // "ATE0" is a part of the profile as well
+    for (const char *c = "E0;"; *c != '\0'; c++)
+    {
+        hash = hash * 33 + (uint8_t)*c;
+    }
+
+    for (; *line != '\0'; line++)
+    {
+        hash = hash * 33 + (uint8_t)*line;
+    }
+
+    // The marker is read back by line_to_int
+    return (hash & 0x7FFFFFFF) | 1;
+}
+
+
+/**
+ * @brief   Stores the current settings in the profile of the module and their fingerprint next to it.
+ *
+ * The profile is stored first ("AT&W"), then the fingerprint is written into the APN of bearer profile
+ * SIM800_PROFILE_CID and saved to the NVRAM ("AT+SAPBR=5,<cid>"), so a marker never names settings the
+ * profile does not hold.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   fingerprint: Fingerprint of the settings, see profile_fingerprint.
+ * @retval  SIM800_OK on success, SIM800_ERROR or SIM800_TIMEOUT on failure.
+ */
+static SIM800_Status_t save_profile(SIM800_Handle_t *handle, uint32_t fingerprint)
+{
+    char line[64] = "&W;+SAPBR=3,";
+    char value[11];
+
+    uint_to_str(SIM800_PROFILE_CID, value);
+    strcat(line, value);
+    strcat(line, ",\"APN\",\"cfg");
+    uint_to_str(fingerprint, value);
+    strcat(line, value);
+    strcat(line, "\";+SAPBR=5,");
+    uint_to_str(SIM800_PROFILE_CID, value);
+    strcat(line, value);
+
+    return execute_command(handle, SIM800_Cmd_Configure, line, NULL, NULL);
+}
+
+
+/**
+ * @brief   Stores the result of a request executed by a blocking function.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the blocking_result_t structure of the waiting function.
+ */
+static void blocking_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    blocking_result_t *result = (blocking_result_t *)ctx;
+
+    result->status = status;
+    result->done = 1;
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Handles the end of an SMS message read by SIM800_RequestSMSMessage.
+ *
+ * The response has already been parsed into the current inbound slot line by line; if it has been read
+ * successfully, the message is delivered, see sms_deliver.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Storage index of the message.
+ */
+static void read_sms_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    if (status == SIM800_OK)
+    {
+        sms_slot(handle)->index = (uint16_t)(uintptr_t)ctx;
+        sms_deliver(handle);
+    }
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+/**
+ * @brief   Handles the end of a background refresh of a cached value.
+ *
+ * On failure the value is dropped, so the next read asks the module instead of serving it indefinitely.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the cache entry.
+ */
+static void cache_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_CacheEntry_t *entry = (SIM800_CacheEntry_t *)ctx;
+
+    entry->pending = 0;
+    entry->valid = (status == SIM800_OK);
+    entry->tick = HAL_GetTick();
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Handles the end of an SMS listing submitted by SIM800_SubmitReadAllSMS.
+ *
+ * The last listed message has no following header, it is delivered here if the listing succeeded.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to handle->smsList.
+ */
+static void list_sms_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_SMSList_t *list = (SIM800_SMSList_t *)ctx;
+
+#if SIM800_USE_PDU
+    if (status == SIM800_OK && list->lines != 0 && !sms_part(handle, sms_slot(handle)))
+#else
+    if (status == SIM800_OK && list->lines != 0)
+#endif
+    {
+        list->count++;
+        list->callback(handle, sms_slot(handle), list->ctx);
+        sms_consumed(handle, sms_slot(handle)->index);
+    }
+
+    list->lines = 0;
+    list->active = 0;
+
+    if (list->done != NULL)
+    {
+        list->done(handle, status, list->doneCtx);
+    }
+}
+
+
+/**
+ * @brief   Parses the +CMTI notification.
+ *
+ * This function is called when a +CMTI notification is received from the SIM800 module.
+ * It extracts the SMS index from the notification and triggers the corresponding callback function.
+ * The expected code keeps waiting for the next notification.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +CMTI notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cmti_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CMTI: <mem3>,<index>
+     */
+    line_field_t field;
+
+    end_notification(handle, index);
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_STRING || line_field(handle, line, &field) != FIELD_NUMBER)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (handle->smsStorage.total != 0 && handle->smsStorage.used < handle->smsStorage.total)
+    {
+        handle->smsStorage.used++;
+        check_sms_storage(handle);
+    }
+
+    post_event(handle, SIM800_Event_NewSMS, 0, 0, field.value);
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+/**
+ * @brief   Parses the +CBC response to obtain battery information.
+ *
+ * This function is called when a +CBC response is received from the SIM800 module.
+ * It extracts battery information, including charge status, connection level, and battery level.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_Battery_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cbc_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CBC: <bcs>,<bcl>,<voltage>
+     */
+    SIM800_Battery_t *batt = (SIM800_Battery_t *)handle->expected_codes[index].response;
+    line_field_t field;
+    int32_t values[3];
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_numbers(handle, line, &field, values, 3) != 3)
+        return SIM800_ERROR;
+
+    batt->charge_status = values[0];
+    batt->conection_level = values[1];
+    batt->battery_level = values[2];
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CREG response to obtain the network registration status.
+ *
+ * The status also refreshes the status cached in the handle.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_NetworkRegStatus_t variable.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t creg_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CREG: <n>,<stat>[,<lac>,<ci>]
+     */
+    line_field_t field;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER || update_reg_status(handle, line, &field) != SIM800_OK)
+        return SIM800_ERROR;
+
+    *(SIM800_NetworkRegStatus_t *)handle->expected_codes[index].response = handle->regStatus;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CSQ response to obtain the signal quality.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_Signal_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t csq_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CSQ: <rssi>,<ber>
+     */
+    SIM800_Signal_t *signal = (SIM800_Signal_t *)handle->expected_codes[index].response;
+    line_field_t field;
+    int32_t values[2];
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_numbers(handle, line, &field, values, 2) != 2)
+        return SIM800_ERROR;
+
+    signal->rssi = values[0];
+    signal->ber = values[1];
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CPIN response to check whether the SIM card is ready.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a uint8_t set to 1 if the SIM card is ready.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cpin_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CPIN: <code>
+     */
+    uint8_t *ready = (uint8_t *)handle->expected_codes[index].response;
+    int32_t colon = line_find(handle, line, ':', 0);
+    uint32_t pos;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    if (colon < 0)
+        return SIM800_ERROR;
+
+    for (pos = colon + 1; line_char(handle, line, pos) == ' '; pos++)
+    {
+    }
+
+    *ready = (line->length - pos == 5);
+    for (uint8_t i = 0; i < 5 && *ready; i++)
+    {
+        *ready = (line_char(handle, line, pos + i) == "READY"[i]);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the APN line of "AT+SAPBR=4,<cid>" for the fingerprint of the saved profile.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a uint32_t set to the fingerprint,
+ *                 it is left unchanged if the APN is not a marker.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK.
+ */
+static SIM800_Status_t marker_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * APN: cfg<fingerprint>
+     */
+    uint32_t pos = 8;
+
+    if (line_starts_with(handle, line, "APN: cfg", pos))
+    {
+        *(uint32_t *)handle->expected_codes[index].response = (uint32_t)line_to_int(handle, line, &pos);
+    }
+
+    return SIM800_OK;
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Parses the +CPMS response to obtain the occupancy of the SMS storage.
+ *
+ * The last storage of the response is the one the received messages are stored in.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_SMSStorage_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cpms_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CPMS: <mem1>,<used1>,<total1>,<mem2>,<used2>,<total2>,<mem3>,<used3>,<total3>
+     */
+    SIM800_SMSStorage_t *storage = (SIM800_SMSStorage_t *)handle->expected_codes[index].response;
+    line_field_t field;
+    line_field_type_t type;
+    int32_t values[2];
+    uint8_t found = 0;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    // The last named storage is the one of the received messages
+    line_fields(handle, line, &field);
+    while ((type = line_field(handle, line, &field)) != FIELD_NONE)
+    {
+        if (type == FIELD_STRING)
+        {
+            if (line_numbers(handle, line, &field, values, 2) != 2)
+                return SIM800_ERROR;
+            found = 1;
+        }
+    }
+
+    if (!found)
+        return SIM800_ERROR;
+
+    storage->used = values[0];
+    storage->total = values[1];
+
+    if (storage == &handle->smsStorage)
+    {
+        check_sms_storage(handle);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CMGS response to extract the message reference.
+ *
+ * If the delivery reports are enabled, the message is tracked until its report arrives. The executed
+ * request is the one at reqTail, its start tick is the start of the measured delivery latency.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a uint8_t message reference.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cmgs_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CMGS: <mr>
+     */
+    uint8_t *reference = (uint8_t *)handle->expected_codes[index].response;
+    SIM800_SMSReport_t *report = &handle->reports[0];
+    uint32_t tick = HAL_GetTick();
+    line_field_t field;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER)
+        return SIM800_ERROR;
+    *reference = (uint8_t)field.value;
+
+    if (handle->smsReports == 0)
+    {
+        return SIM800_OK;
+    }
+
+    // Take a free entry, or the one waiting the longest
+    for (uint8_t i = 0; i < SIM800_SMS_REPORTS_MAX; i++)
+    {
+        if (!handle->reports[i].used)
+        {
+            report = &handle->reports[i];
+            break;
+        }
+        if (tick - handle->reports[i].tickStart > tick - report->tickStart)
+        {
+            report = &handle->reports[i];
+        }
+    }
+
+    report->used = 1;
+    report->reference = *reference;
+    report->tickStart = handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)].tickStart;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the unsolicited +CDS delivery report.
+ *
+ * The report is matched against the tracked messages by its reference. Reports with a temporary
+ * error status (32..63) are skipped, the service centre is still trying to deliver the message.
+ * In SMS PDU mode the report is the SMS-STATUS-REPORT PDU on the line following "+CDS: <length>".
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +CDS notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the report is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cds_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CDS: <fo>,<mr>,"<ra>",<tora>,"<scts>","<dt>",<st>
+     */
+    line_field_t field, last;
+    int32_t values[2];
+    uint8_t reference, status;
+
+#if SIM800_USE_PDU
+    if (handle->smsPDU)
+    {
+        if (!line->continued && line_starts_with(handle, line, "+CDS:", 5))
+        {
+            pdu_rx_reset(handle);
+            return SIM800_OK;
+        }
+
+        if (pdu_rx_append(handle, line, NULL) != SIM800_OK)
+        {
+            end_notification(handle, index);
+            return SIM800_ERROR;
+        }
+
+        if (!line->complete)
+            return SIM800_OK;
+
+        end_notification(handle, index);
+
+        if (SIM800_PDU_DecodeStatusReport(handle->pduRx, handle->pduRxLength, &reference, &status) != SIM800_OK)
+            return SIM800_ERROR;
+
+        sms_report(handle, reference, status);
+
+        return SIM800_OK;
+    }
+#endif
+
+    end_notification(handle, index);
+
+    line_fields(handle, line, &field);
+    if (line_numbers(handle, line, &field, values, 2) != 2)
+        return SIM800_ERROR;
+    reference = (uint8_t)values[1];
+
+    // The status is the last field
+    last.type = FIELD_NONE;
+    while (line_field(handle, line, &field) != FIELD_NONE)
+    {
+        last = field;
+    }
+    if (last.type != FIELD_NUMBER)
+        return SIM800_ERROR;
+    status = (uint8_t)last.value;
+
+    sms_report(handle, reference, status);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Handles a delivery report of a sent message.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   reference: Reference of the reported message.
+ * @param   status: Status of the report.
+ */
+static void sms_report(SIM800_Handle_t *handle, uint8_t reference, uint8_t status)
+{
+    uint32_t latency = 0;
+
+    if (status >= 32 && status < 64)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < SIM800_SMS_REPORTS_MAX; i++)
+    {
+        if (handle->reports[i].used && handle->reports[i].reference == reference)
+        {
+            handle->reports[i].used = 0;
+            latency = HAL_GetTick() - handle->reports[i].tickStart;
+            break;
+        }
+    }
+
+    post_event(handle, SIM800_Event_SMSDelivery, reference, status, latency);
+}
+
+
+/**
+ * @brief   Submits the next messages of the SMS batch while fewer than SIM800_SMS_BATCH_INFLIGHT are queued.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void sms_batch_fill(SIM800_Handle_t *handle)
+{
+    SIM800_SMSBatch_t *batch = &handle->smsBatch;
+
+    while (batch->next < batch->count && batch->next - batch->finished < SIM800_SMS_BATCH_INFLIGHT)
+    {
+        if (SIM800_SubmitSMSMessageEx(handle, batch->recipients[batch->next], batch->text,
+                                      &sms_batch_done, (void *)(uintptr_t)batch->next, NULL) != SIM800_OK)
+        {
+            // The request queue is full, try again on the next poll
+            return;
+        }
+        batch->next++;
+    }
+}
+
+
+/**
+ * @brief   Handles the end of a message of the SMS batch.
+ *
+ * The batch is over once its last recipient is finished, the next message is submitted right away.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Index of the recipient.
+ */
+static void sms_batch_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_SMSBatch_t *batch = &handle->smsBatch;
+    SIM800_SMSBatchCallback_t result = batch->result;
+    void *result_ctx = batch->ctx;
+
+    if (++batch->finished == batch->count)
+    {
+        batch->count = 0;
+    }
+    else
+    {
+        sms_batch_fill(handle);
+    }
+
+    if (result != NULL)
+    {
+        result(handle, (uint16_t)(uintptr_t)ctx, status, result_ctx);
+    }
+}
+
+
+/**
+ * @brief   Checks a token bucket of the SMS scheduler and takes a token from it.
+ *
+ * The bucket is kept as the tick at which it is full again (the theoretical arrival time of the generic
+ * cell rate algorithm): a message is allowed while that tick is at most (burst - 1) periods ahead, and each
+ * message moves it one period further. A tick further ahead than a full bucket can be is a stale one from
+ * before the wrap of the tick counter.
+ *
+ * @param   *tat: Pointer to the tick of the bucket.
+ * @param   now: Current tick.
+ * @param   burst: Messages sent back to back.
+ * @param   period: Time after which one more message is allowed (ms), 0 - no limit.
+ * @param   take: 1 to take the token of an allowed message.
+ * @retval  1 if a message is allowed, 0 otherwise.
+ */
+static uint8_t sms_rate(uint32_t *tat, uint32_t now, uint16_t burst, uint32_t period, uint8_t take)
+{
+    uint32_t tolerance = (burst > 1) ? (uint32_t)(burst - 1) * period : 0;
+    uint32_t ahead = *tat - now;
+
+    if (period == 0)
+    {
+        return 1;
+    }
+
+    if ((int32_t)ahead <= 0 || ahead > tolerance + period)
+    {
+        ahead = 0;
+    }
+    else if (ahead > tolerance)
+    {
+        return 0;
+    }
+
+    if (take)
+    {
+        *tat = now + ahead + period;
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief   Finds the bucket of a destination of the SMS scheduler.
+ *
+ * A destination not tracked gets the bucket of one whose rate is back to full.
+ *
+ * @param   *sched: Pointer to the scheduler.
+ * @param   key: Hash of the destination.
+ * @param   now: Current tick.
+ * @retval  Pointer to the bucket, still keyed to the old destination if it is reused; NULL if every bucket is busy.
+ */
+static SIM800_SMSBucket_t *sms_bucket(SIM800_SMSScheduler_t *sched, uint32_t key, uint32_t now)
+{
+    SIM800_SMSBucket_t *free = NULL;
+
+    for (uint8_t i = 0; i < SIM800_SMS_DEST_BUCKETS; i++)
+    {
+        if (sched->buckets[i].key == key && sched->buckets[i].tat != 0)
+        {
+            return &sched->buckets[i];
+        }
+
+        if (free == NULL && (sched->buckets[i].tat == 0 || (int32_t)(sched->buckets[i].tat - now) <= 0))
+        {
+            free = &sched->buckets[i];
+        }
+    }
+
+    return free;
+}
+
+
+/**
+ * @brief   Submits the waiting messages of the SMS scheduler the rate limits allow, the highest priority first.
+ *
+ * Every message gets a slot of its own, so a request ended early (e.g. by SIM800_Cancel) does not end another
+ * message.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void sms_sched_fill(SIM800_Handle_t *handle)
+{
+    SIM800_SMSScheduler_t *sched = &handle->smsSched;
+    SIM800_SMSRateLimit_t *limit = &sched->limit;
+    SIM800_SMSJob_t *job, *best;
+    SIM800_SMSBucket_t *bucket, *bestBucket = NULL;
+    uint32_t now = HAL_GetTick();
+    uint8_t slot = 0;
+
+    while (sched->flightCount < SIM800_SMS_BATCH_INFLIGHT && sms_rate(&sched->tat, now, limit->burst, limit->period, 0))
+    {
+        best = NULL;
+
+        for (uint8_t i = 0; i < SIM800_SMS_SCHED_LENGTH; i++)
+        {
+            job = &sched->jobs[i];
+            if (job->destination == NULL ||
+                (best != NULL && (job->priority > best->priority ||
+                                  (job->priority == best->priority && (int32_t)(job->order - best->order) > 0))))
+            {
+                continue;
+            }
+
+            bucket = sms_bucket(sched, job->key, now);
+            if (limit->destPeriod != 0 &&
+                (bucket == NULL || (bucket->key == job->key && !sms_rate(&bucket->tat, now, limit->destBurst, limit->destPeriod, 0))))
+            {
+                continue;
+            }
+
+            best = job;
+            bestBucket = bucket;
+        }
+
+        if (best == NULL)
+        {
+            return;
+        }
+
+        while (sched->flight[slot].busy)
+        {
+            slot++;
+        }
+
+        if (SIM800_SubmitSMSMessageEx(handle, best->destination, best->text, &sms_sched_done, (void *)(uintptr_t)slot,
+                                      NULL) != SIM800_OK)
+        {
+            // The request queue is full, try again on the next poll
+            return;
+        }
+
+        sms_rate(&sched->tat, now, limit->burst, limit->period, 1);
+        if (limit->destPeriod != 0)
+        {
+            if (bestBucket->key != best->key)
+            {
+                bestBucket->key = best->key;
+                bestBucket->tat = now;
+            }
+            sms_rate(&bestBucket->tat, now, limit->destBurst, limit->destPeriod, 1);
+        }
+
+        sched->flight[slot].done = best->done;
+        sched->flight[slot].ctx = best->ctx;
+        sched->flight[slot].busy = 1;
+        sched->flightCount++;
+        best->destination = NULL;
+    }
+}
+
+
+/**
+ * @brief   Handles the end of a message of the SMS scheduler, in whatever order the requests end.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Index of the slot of the message.
+ */
+static void sms_sched_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_SMSScheduler_t *sched = &handle->smsSched;
+    SIM800_SMSFlight_t *flight = &sched->flight[(uintptr_t)ctx];
+    SIM800_RequestCallback_t done = flight->done;
+    void *done_ctx = flight->ctx;
+
+    flight->busy = 0;
+    sched->flightCount--;
+
+    sms_sched_fill(handle);
+
+    if (done != NULL)
+    {
+        done(handle, status, done_ctx);
+    }
+}
+
+
+/**
+ * @brief   Sets the new message indications according to the delivery mode and the delivery reports.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t sms_indication(SIM800_Handle_t *handle)
+{
+    // "<mode>,<mt>[,<bm>,<ds>]" by the direct delivery and the delivery reports
+    static const char *const modes[2][2] = { { "2,1", "2,1,0,1" }, { "2,2", "2,2,0,1" } };
+
+    return execute_command(handle, SIM800_Cmd_SMSIndication, modes[handle->smsDirect != 0][handle->smsReports != 0], NULL, NULL);
+}
+
+
+/**
+ * @brief   Sets the parameters of the sent messages according to the delivery reports and the character set.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t sms_params(SIM800_Handle_t *handle)
+{
+    // "<fo>,<vp>,<pid>,<dcs>": first octet 49 requests a status report, coding 8 is UCS2
+    static const char *const params[2][2] = { { "17,167,0,0", "17,167,0,8" }, { "49,167,0,0", "49,167,0,8" } };
+
+    return execute_command(handle, SIM800_Cmd_SMSParams, params[handle->smsReports != 0][handle->smsUCS2 != 0], NULL, NULL);
+}
+
+
+/**
+ * @brief   Posts SIM800_SMSStorageLowCallBack if the SMS storage is almost full.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void check_sms_storage(SIM800_Handle_t *handle)
+{
+    SIM800_SMSStorage_t *storage = &handle->smsStorage;
+
+    if (storage->total != 0 && storage->total - storage->used < SIM800_SMS_LOW_SPACE)
+    {
+        post_event(handle, SIM800_Event_SMSStorageLow, 0, 0, 0);
+    }
+}
+
+
+/**
+ * @brief   Queues a consumed SMS message for deletion if the automatic deletion is enabled.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   sms_index: Storage index of the message, 0 if it is not stored.
+ */
+static void sms_consumed(SIM800_Handle_t *handle, uint16_t sms_index)
+{
+    if (handle->smsAutoDelete && sms_index != 0)
+    {
+        SIM800_DeleteSMSMessage(handle, sms_index);
+    }
+}
+
+
+/**
+ * @brief   Returns the inbound slot the next received SMS message is parsed into.
+ *
+ * The slot at smsHead is never handed to the application, so it is free to be overwritten.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  Pointer to the message slot.
+ */
+static SIM800_SMSMessage_t *sms_slot(SIM800_Handle_t *handle)
+{
+    return &handle->smsSlots[handle->smsHead & (SIM800_SMS_QUEUE_LENGTH - 1)];
+}
+
+
+/**
+ * @brief   Delivers the SMS message parsed into the current inbound slot.
+ *
+ * Without the queue the message is passed to SIM800_RcvdSMSCallBack and its slot is reused right away.
+ * With the queue it is published first, unless the queue is full, and consumed once it is released.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void sms_deliver(SIM800_Handle_t *handle)
+{
+    SIM800_SMSMessage_t *message = sms_slot(handle);
+    SIM800_Event_t event = { .type = SIM800_Event_SMSReceived, .data = message };
+
+#if SIM800_USE_PDU
+    if (sms_part(handle, message))
+    {
+        return;
+    }
+#endif
+
+    if (!handle->smsQueue)
+    {
+        SIM800_RcvdSMSCallBack(handle, message);
+        publish_event(handle, &event);
+        sms_consumed(handle, message->index);
+        return;
+    }
+
+    // Keep a free slot for parsing, a message that does not fit stays stored (or is lost if direct)
+    if (handle->smsHead + 1 - handle->smsFreed >= SIM800_SMS_QUEUE_LENGTH)
+    {
+        handle->smsDropped++;
+        return;
+    }
+
+    // Make sure the message is written before it is published
+    __DMB();
+    handle->smsHead++;
+
+    SIM800_RcvdSMSCallBack(handle, message);
+    publish_event(handle, &event);
+}
+
+
+#if SIM800_USE_PDU
+
+/**
+ * @brief   Starts receiving the PDU of a new SMS message.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void pdu_rx_reset(SIM800_Handle_t *handle)
+{
+    handle->pduRxLength = 0;
+    handle->pduRxNibble = 0xFF;
+    handle->pduRxDone = 0;
+}
+
+
+/**
+ * @brief   Appends a chunk of the hex PDU line of a message and decodes it once the line is complete.
+ *
+ * The line is converted straight from the ring, so a PDU longer than a line chunk never needs a copy.
+ * Lines after the PDU (e.g., the empty line before "OK") are ignored.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the chunk of the line.
+ * @param   *message: Pointer to the message the PDU is decoded into as SMS-DELIVER, NULL to only collect it.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the PDU is too long or can not be decoded.
+ */
+static SIM800_Status_t pdu_rx_append(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_SMSMessage_t *message)
+{
+    uint8_t nibble;
+    char c;
+
+    if (handle->pduRxDone)
+    {
+        return SIM800_OK;
+    }
+
+    for (uint32_t i = 0; i < line->length; i++)
+    {
+        c = line_char(handle, line, i);
+
+        if (c >= '0' && c <= '9')
+            nibble = c - '0';
+        else if (c >= 'A' && c <= 'F')
+            nibble = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            nibble = c - 'a' + 10;
+        else
+            continue;
+
+        if (handle->pduRxNibble == 0xFF)
+        {
+            handle->pduRxNibble = nibble;
+            continue;
+        }
+
+        if (handle->pduRxLength >= SIM800_PDU_MAX_OCTETS)
+        {
+            handle->pduRxDone = 1;
+            return SIM800_ERROR;
+        }
+
+        handle->pduRx[handle->pduRxLength++] = (handle->pduRxNibble << 4) | nibble;
+        handle->pduRxNibble = 0xFF;
+    }
+
+    if (!line->complete || handle->pduRxLength == 0)
+    {
+        return SIM800_OK;
+    }
+
+    handle->pduRxDone = 1;
+
+    if (message == NULL)
+    {
+        return SIM800_OK;
+    }
+
+    return SIM800_PDU_DecodeDeliver(handle->pduRx, handle->pduRxLength, message);
+}
+
+
+/**
+ * @brief   Adds a received part of a long SMS message to its reassembly entry.
+ *
+ * A part is matched to an entry by its reference, count of parts and sender. A part of a new message takes
+ * a free entry, or the oldest one if none is free. Once all parts are in, the text is joined and passed to
+ * SIM800_RcvdLongSMSCallBack. Every part is consumed (deleted if enabled) as soon as it is copied.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *message: Pointer to the received message.
+ * @retval  1 if the message is a part of a long message (it must not be delivered), 0 otherwise.
+ */
+static uint8_t sms_part(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message)
+{
+    SIM800_LongSMS_t *entry = NULL;
+    uint8_t bit;
+    uint16_t length;
+
+    if (message->partCount < 2)
+    {
+        return 0;
+    }
+
+    if (message->partIndex == 0 || message->partIndex > message->partCount ||
+        message->partCount > SIM800_SMS_CONCAT_PARTS)
+    {
+        // Too long to be reassembled, drop the part
+        sms_consumed(handle, message->index);
+        return 1;
+    }
+
+    for (uint8_t i = 0; i < SIM800_SMS_CONCAT_MAX; i++)
+    {
+        SIM800_LongSMS_t *e = &handle->longSMS[i];
+
+        if (e->used && e->reference == message->partRef && e->count == message->partCount &&
+            strcmp(e->sender, message->sender) == 0)
+        {
+            entry = e;
+            break;
+        }
+
+        if (entry == NULL || (entry->used && (!e->used || (int32_t)(e->tick - entry->tick) < 0)))
+        {
+            entry = e;
+        }
+    }
+
+    if (!entry->used || entry->reference != message->partRef || entry->count != message->partCount ||
+        strcmp(entry->sender, message->sender) != 0)
+    {
+        memset(entry, 0, sizeof(*entry));
+        entry->used = 1;
+        entry->count = message->partCount;
+        entry->reference = message->partRef;
+        entry->tick = HAL_GetTick();
+        memcpy(entry->sender, message->sender, strnlen(message->sender, sizeof(entry->sender) - 1));
+    }
+
+    bit = 1 << (message->partIndex - 1);
+
+    if (!(entry->received & bit))
+    {
+        length = strlen(message->text);
+        if (length > SIM800_SMS_PART_TEXT)
+        {
+            length = SIM800_SMS_PART_TEXT;
+        }
+
+        memcpy(&entry->text[(message->partIndex - 1) * SIM800_SMS_PART_TEXT], message->text, length);
+        entry->lengths[message->partIndex - 1] = length;
+        entry->received |= bit;
+    }
+
+    sms_consumed(handle, message->index);
+
+    if (entry->received != (uint8_t)((1 << entry->count) - 1))
+    {
+        return 1;
+    }
+
+    // Close the gaps left by the parts shorter than SIM800_SMS_PART_TEXT
+    entry->length = 0;
+    for (uint8_t i = 0; i < entry->count; i++)
+    {
+        memmove(&entry->text[entry->length], &entry->text[i * SIM800_SMS_PART_TEXT], entry->lengths[i]);
+        entry->length += entry->lengths[i];
+    }
+    entry->text[entry->length] = '\0';
+
+    SIM800_RcvdLongSMSCallBack(handle, entry);
+    entry->used = 0;
+
+    return 1;
+}
+
+
+/**
+ * @brief   Drops the long SMS messages whose parts have not all arrived in SIM800_SMS_CONCAT_TIMEOUT.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void long_sms_expire(SIM800_Handle_t *handle)
+{
+    for (uint8_t i = 0; i < SIM800_SMS_CONCAT_MAX; i++)
+    {
+        if (handle->longSMS[i].used && HAL_GetTick() - handle->longSMS[i].tick > SIM800_SMS_CONCAT_TIMEOUT)
+        {
+            handle->longSMS[i].used = 0;
+        }
+    }
+}
+
+#endif /* SIM800_USE_PDU */
+
+
+/**
+ * @brief   Takes back the inbound slots released by the application.
+ *
+ * The released messages are consumed here rather than in SIM800_ReleaseSMS, so the deletion state is only
+ * touched by SIM800_Poll and a slot is not reused before its message is handled.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void sms_release_flush(SIM800_Handle_t *handle)
+{
+    uint32_t tail = handle->smsTail;
+
+    while (handle->smsFreed != tail)
+    {
+        sms_consumed(handle, handle->smsSlots[handle->smsFreed & (SIM800_SMS_QUEUE_LENGTH - 1)].index);
+        handle->smsFreed++;
+    }
+}
+
+
+/**
+ * @brief   Submits the queued SMS deletions as one command line.
+ *
+ * The deletion is only submitted when no other request is queued, so it never delays the application's commands.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void sms_delete_flush(SIM800_Handle_t *handle)
+{
+    SIM800_Request_t *req;
+    char number[11];
+    uint8_t count = handle->smsDeleteCount;
+
+    if (handle->smsDeletePending || (count == 0 && !handle->smsDeleteRead) || handle->reqTail != handle->reqHead)
+    {
+        return;
+    }
+
+    handle->smsDeleteLine[0] = '\0';
+
+    if (handle->smsDeleteRead)
+    {
+        // Too many messages for one line, the read ones can go at once
+        append_setting(handle->smsDeleteLine, sizeof(handle->smsDeleteLine), "+CMGD=1,1", "", "");
+        count = SIM800_SMS_DELETE_BATCH + 1;
+    }
+    else
+    {
+        for (uint8_t i = 0; i < count; i++)
+        {
+            uint_to_str(handle->smsDeletes[i], number);
+            append_setting(handle->smsDeleteLine, sizeof(handle->smsDeleteLine), "+CMGD=", number, "");
+        }
+    }
+
+    if ((req = claim_request(handle, SIM800_Cmd_Configure, handle->smsDeleteLine, NULL, NULL, &sms_delete_done,
+                             (void *)(uintptr_t)count, NULL)) != NULL)
+    {
+        // Every deletion may take as long as a single "AT+CMGD"
+        req->timeout = commands[SIM800_Cmd_Configure].timeout * (handle->smsDeleteRead ? 5 : count);
+        handle->smsDeleteCount = 0;
+        handle->smsDeleteRead = 0;
+        handle->smsDeletePending = 1;
+        commit_request(handle);
+    }
+}
+
+
+/**
+ * @brief   Handles the end of a submitted SMS deletion.
+ *
+ * The occupancy is decreased by the count of deleted messages. After a failure or a deletion of all read
+ * messages the exact count is unknown, so the occupancy is read again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Count of deleted messages, above SIM800_SMS_DELETE_BATCH for the deletion of all read ones.
+ */
+static void sms_delete_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    uint32_t count = (uint32_t)(uintptr_t)ctx;
+
+    handle->smsDeletePending = 0;
+
+    if (status == SIM800_OK && count <= SIM800_SMS_DELETE_BATCH)
+    {
+        handle->smsStorage.used = handle->smsStorage.used > count ? handle->smsStorage.used - count : 0;
+    }
+    else
+    {
+        submit_request(handle, SIM800_Cmd_SMSStorage, NULL, NULL, &handle->smsStorage, NULL, NULL, NULL);
+    }
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+/**
+ * @brief   Parses an identifier response without a code (the IMEI of "AT+GSN", the ICCID of "AT+CCID").
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a buffer of SIM800_ID_LENGTH characters.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the identifier is successfully parsed, SIM800_ERROR if the line is not an identifier.
+ */
+static SIM800_Status_t id_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * 869170031234567
+     * OK
+     */
+    char *id = (char *)handle->expected_codes[index].response;
+    char c;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    // ICCIDs may end with a hexadecimal filler digit
+    for (uint32_t i = 0; i < line->length; i++)
+    {
+        c = line_char(handle, line, i);
+        if (!((c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')))
+            return SIM800_ERROR;
+    }
+
+    line_copy(handle, line, 0, line->length, id, SIM800_ID_LENGTH);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the unsolicited +CREG notification.
+ *
+ * The notification carries the status as its first field, the response of "AT+CREG?" carries the
+ * notification mode first and is left to creg_parser. The expected code keeps waiting for the next notification.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +CREG notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t creg_urc_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CREG: <stat>[,<lac>,<ci>]
+     */
+    line_field_t field, probe;
+    line_field_type_t second;
+
+    end_notification(handle, index);
+
+    line_fields(handle, line, &field);
+    probe = field;
+    if (line_field(handle, line, &probe) != FIELD_NUMBER)
+    {
+        return SIM800_ERROR;
+    }
+
+    // A second number is the status of the response of "AT+CREG?", not of a notification
+    second = line_field(handle, line, &probe);
+    if (second == FIELD_NONE || second == FIELD_STRING)
+    {
+        return update_reg_status(handle, line, &field);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the "RING" notification of an incoming voice call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the RING notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK.
+ */
+static SIM800_Status_t ring_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    end_notification(handle, index);
+
+    call_ring(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CLIP notification, the caller of an incoming voice call.
+ *
+ * The caller is reported on the first +CLIP of a call, the following ones only keep the call ringing.
+ * In the reject mode the hang-up is submitted at once, ahead of whatever the callback submits.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +CLIP notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t clip_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CLIP: <number>,<type>,<subaddr>,<satype>,<alphaId>,<CLI validity>
+     */
+    SIM800_Call_t *call = &handle->call;
+    SIM800_Caller_t *caller = &call->caller;
+    line_field_t field;
+
+    end_notification(handle, index);
+
+    call_ring(handle);
+    if (call->reported)
+    {
+        return SIM800_OK;
+    }
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_STRING)
+    {
+        return SIM800_ERROR;
+    }
+    line_copy(handle, line, field.start, field.end, caller->number, sizeof(caller->number));
+    caller->type = (line_field(handle, line, &field) == FIELD_NUMBER) ? (uint8_t)field.value : 0;
+
+    // The subaddress, its type and the phonebook name are skipped
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        line_field(handle, line, &field);
+    }
+    if (line_field(handle, line, &field) == FIELD_NUMBER)
+    {
+        caller->validity = (uint8_t)field.value;
+    }
+    else
+    {
+        caller->validity = (caller->number[0] == '\0') ? 2 : 0;
+    }
+
+    call->reported = 1;
+    post_event(handle, SIM800_Event_Call, 0, 0, 0);
+
+    if (call->mode == SIM800_Calls_Reject && !call->hangUp &&
+        submit_request(handle, SIM800_Cmd_HangUp, NULL, NULL, NULL, &hang_up_done, NULL, NULL) != NULL)
+    {
+        call->hangUp = 1;
+    }
+
+    return SIM800_OK;
+}
+
+
+#if SIM800_USE_GNSS
+
+/**
+ * @brief   Parses the +UGNSINF notification, a position of the GNSS stream.
+ *
+ * The fields are read in place by the field cursor, the decimals are converted to fixed point as they are
+ * scanned; nothing is copied out of the receive ring.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +UGNSINF notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t ugnsinf_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +UGNSINF: <run>,<fix>,<UTC yyyyMMddhhmmss.sss>,<latitude>,<longitude>,<altitude>,<speed>,<course>,<mode>,,
+     *           <HDOP>,<PDOP>,<VDOP>,,<in view>,<GNSS used>,<GLONASS used>,...
+     * +UGNSINF: 1,1,20261014101530.000,55.755786,37.617633,143.600,0.00,285.1,1,,1.1,1.4,0.9,,12,8,3,,38,,
+     */
+    SIM800_GNSSFix_t *fix = &handle->gnss.fix;
+    SIM800_Time_t *time = &fix->time;
+    uint8_t digits[14], i;
+    line_field_t field;
+    int32_t value;
+
+    end_notification(handle, index);
+
+    memset(fix, 0, sizeof(*fix));
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER || line_field(handle, line, &field) != FIELD_NUMBER)
+    {
+        return SIM800_ERROR;
+    }
+    fix->fix = (field.value == 1);
+
+    line_field(handle, line, &field);
+    for (i = 0; i < sizeof(digits) && field.start + i < field.end; i++)
+    {
+        if ((digits[i] = line_char(handle, line, field.start + i) - '0') > 9)
+        {
+            break;
+        }
+    }
+
+    if (i == sizeof(digits))
+    {
+        time->year = digits[0] * 1000 + digits[1] * 100 + digits[2] * 10 + digits[3];
+        time->month = digits[4] * 10 + digits[5];
+        time->day = digits[6] * 10 + digits[7];
+        time->hour = digits[8] * 10 + digits[9];
+        time->minute = digits[10] * 10 + digits[11];
+        time->second = digits[12] * 10 + digits[13];
+    }
+
+    // The fields are empty without a fix, they stay 0
+    line_field(handle, line, &field);
+    parse_fixed(handle, line, &field, 6, &fix->latitude);
+    line_field(handle, line, &field);
+    parse_fixed(handle, line, &field, 6, &fix->longitude);
+    line_field(handle, line, &field);
+    parse_fixed(handle, line, &field, 2, &fix->altitude);
+    line_field(handle, line, &field);
+    fix->speed = parse_fixed(handle, line, &field, 2, &value) ? (uint16_t)value : 0;
+    line_field(handle, line, &field);
+    fix->course = parse_fixed(handle, line, &field, 1, &value) ? (uint16_t)value : 0;
+
+    // The fix mode and a reserved field come before HDOP
+    line_field(handle, line, &field);
+    line_field(handle, line, &field);
+    line_field(handle, line, &field);
+    fix->hdop = parse_fixed(handle, line, &field, 1, &value) ? (uint16_t)value : 0;
+
+    // PDOP, VDOP and a reserved field
+    for (i = 0; i < 3; i++)
+    {
+        line_field(handle, line, &field);
+    }
+    fix->satellitesInView = (line_field(handle, line, &field) == FIELD_NUMBER) ? (uint8_t)field.value : 0;
+    fix->satellitesUsed = (line_field(handle, line, &field) == FIELD_NUMBER) ? (uint8_t)field.value : 0;
+
+    handle->gnss.reports++;
+    post_event(handle, SIM800_Event_GNSS, fix->fix, 0, 0);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Converts a decimal number of a field (e.g., "-143.6") to a fixed-point integer.
+ *
+ * Digits behind the given count of decimals are dropped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *field: Pointer to the field.
+ * @param   decimals: Count of decimals of the result, e.g. 2 - hundredths.
+ * @param   *value: Pointer to store the value, it is kept if the field is not a number.
+ * @retval  1 on success, 0 if the field is empty or not a decimal number.
+ */
+static uint8_t parse_fixed(SIM800_Handle_t *handle, const SIM800_Line_t *line, const line_field_t *field, uint8_t decimals,
+                           int32_t *value)
+{
+    int32_t result = 0, sign = 1;
+    uint8_t point = 0, digits = 0, scale = decimals;
+    char c;
+
+    for (uint32_t pos = field->start; pos < field->end; pos++)
+    {
+        c = line_char(handle, line, pos);
+        if (c == '-' && pos == field->start)
+        {
+            sign = -1;
+        }
+        else if (c == '.' && !point)
+        {
+            point = 1;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            digits++;
+            if (!point || scale != 0)
+            {
+                if (result > (INT32_MAX - 9) / 10)
+                    return 0;
+                result = result * 10 + (c - '0');
+                scale -= point;
+            }
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    if (digits == 0)
+        return 0;
+
+    // Missing decimals are zeros
+    while (scale-- != 0)
+    {
+        result *= 10;
+    }
+
+    *value = sign * result;
+
+    return 1;
+}
+
+#endif /* SIM800_USE_GNSS */
+
+
+#if SIM800_USE_REG_CACHE
+
+/**
+ * @brief   Parses the +COPS response for the numeric operator the module is registered on.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a buffer of SIM800_PLMN_LENGTH characters,
+ *                 left empty without an operator.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if the operator is not numeric.
+ */
+static SIM800_Status_t cops_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +COPS: 0,2,"25001"
+     * +COPS: 0                 (not registered)
+     */
+    char *plmn = (char *)handle->expected_codes[index].response;
+    line_field_t field;
+    char c;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (line_field(handle, line, &field) != FIELD_NUMBER || field.value != 2 ||
+        line_field(handle, line, &field) != FIELD_STRING)
+    {
+        return SIM800_OK;
+    }
+
+    for (uint32_t pos = field.start; pos < field.end; pos++)
+    {
+        c = line_char(handle, line, pos);
+        if (c < '0' || c > '9')
+            return SIM800_ERROR;
+    }
+
+    line_copy(handle, line, field.start, field.end, plmn, SIM800_PLMN_LENGTH);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CBAND response for the band selection of the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a buffer of SIM800_BAND_LENGTH characters.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if the band is not a name.
+ */
+static SIM800_Status_t cband_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CBAND: EGSM_DCS_MODE
+     */
+    char *band = (char *)handle->expected_codes[index].response;
+    line_field_t field;
+    char c;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_TEXT || field.end - field.start >= SIM800_BAND_LENGTH)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The band is sent back as the argument of "AT+CBAND", only a name is taken
+    for (uint32_t pos = field.start; pos < field.end; pos++)
+    {
+        c = line_char(handle, line, pos);
+        if (!((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_'))
+            return SIM800_ERROR;
+    }
+
+    line_copy(handle, line, field.start, field.end, band, SIM800_BAND_LENGTH);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Points a module that has just been powered on at the cached operator and band.
+ *
+ * The requests are only submitted, SIM800_Init does not wait for the selection.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void reg_cache_select(SIM800_Handle_t *handle)
+{
+    SIM800_RegCacheState_t *rc = &handle->regCache;
+
+    if (rc->cache.plmn[0] == '\0')
+    {
+        return;
+    }
+
+    if (rc->cache.band[0] != '\0' &&
+        submit_request(handle, SIM800_Cmd_SelectBand, rc->cache.band, NULL, NULL, NULL, NULL, NULL) != NULL)
+    {
+        rc->targeted = 1;
+    }
+
+    // Mode 4: the cached operator, and the automatic selection if it cannot be registered on
+    if (submit_request(handle, SIM800_Cmd_SelectOperator, rc->cache.plmn, NULL, NULL, NULL, NULL, NULL) != NULL)
+    {
+        rc->cached = 1;
+    }
+}
+
+
+/**
+ * @brief   Records the time to register and schedules the read of the operator and the band.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void reg_cache_registered(SIM800_Handle_t *handle)
+{
+    SIM800_RegCacheState_t *rc = &handle->regCache;
+
+    if (rc->timing)
+    {
+        rc->timing = 0;
+        rc->time = HAL_GetTick() - rc->bootTick;
+        rc->time += (rc->time == 0);
+    }
+
+    rc->targeted = 0;
+    rc->record = 1;
+}
+
+
+/**
+ * @brief   Selects all bands again once the cached band has not given a registration in time, and reads the
+ *          operator of a new registration when no other request is queued.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void reg_cache_poll(SIM800_Handle_t *handle)
+{
+    SIM800_RegCacheState_t *rc = &handle->regCache;
+
+    if (rc->targeted && HAL_GetTick() - rc->bootTick >= SIM800_REG_FALLBACK &&
+        submit_request(handle, SIM800_Cmd_SelectBand, "ALL_BAND", NULL, NULL, NULL, NULL, NULL) != NULL)
+    {
+        rc->targeted = 0;
+    }
+
+    if (rc->record && !rc->pending && handle->reqTail == handle->reqHead)
+    {
+        rc->read.plmn[0] = '\0';
+
+        if (submit_request(handle, SIM800_Cmd_Operator, NULL, NULL, rc->read.plmn, &reg_cache_operator_done, NULL, NULL) != NULL)
+        {
+            rc->record = 0;
+            rc->pending = 1;
+        }
+    }
+}
+
+
+/**
+ * @brief   Completion callback of the read of the operator, the band is read next.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Not used.
+ */
+static void reg_cache_operator_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_RegCacheState_t *rc = &handle->regCache;
+
+    rc->read.band[0] = '\0';
+
+    if (status != SIM800_OK || rc->read.plmn[0] == '\0' ||
+        submit_request(handle, SIM800_Cmd_Band, NULL, NULL, rc->read.band, &reg_cache_band_done, NULL, NULL) == NULL)
+    {
+        rc->pending = 0;
+    }
+}
+
+
+/**
+ * @brief   Completion callback of the read of the band, a new operator or band replaces the cached one.
+ *
+ * A module without "AT+CBAND" keeps the operator without a band.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Not used.
+ */
+static void reg_cache_band_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_RegCacheState_t *rc = &handle->regCache;
+
+    rc->pending = 0;
+
+    if (status != SIM800_OK)
+    {
+        rc->read.band[0] = '\0';
+    }
+
+    if (strcmp(rc->read.plmn, rc->cache.plmn) != 0 || strcmp(rc->read.band, rc->cache.band) != 0)
+    {
+        rc->cache = rc->read;
+        SIM800_RegCacheCallBack(handle, &rc->cache);
+    }
+}
+
+#endif /* SIM800_USE_REG_CACHE */
+
+
+/**
+ * @brief   Keeps the incoming voice call ringing, a ring after a pause starts a new call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void call_ring(SIM800_Handle_t *handle)
+{
+    SIM800_Call_t *call = &handle->call;
+    uint32_t now = HAL_GetTick();
+
+    if (!call->ringing || now - call->tick > SIM800_CALL_RING_GAP)
+    {
+        call->ringing = 1;
+        call->reported = 0;
+        call->calls++;
+    }
+
+    call->tick = now;
+}
+
+
+/**
+ * @brief   Completion callback of the hang-up of a rejected call.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of "ATH".
+ * @param   *ctx: Not used.
+ */
+static void hang_up_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    handle->call.hangUp = 0;
+
+    if (status == SIM800_OK)
+    {
+        handle->call.ringing = 0;
+    }
+}
+
+
+/**
+ * @brief   Parses the +CUSD notification, the response of a USSD query or a message the network sends on its own.
+ *
+ * The line is parsed character by character as its chunks arrive, the text is copied until its closing quote
+ * and the data coding scheme behind it is read last. A UCS2 text (a UCS2 coding scheme, or the UCS2 character
+ * set of the module) is then decoded in place. The response completes the query in progress, see SIM800_SendUSSD.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +CUSD notification.
+ * @param   *line: Pointer to the notification line or a chunk of it.
+ * @retval  SIM800_OK.
+ */
+static SIM800_Status_t cusd_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CUSD: <n>[,<str>,<dcs>]
+     */
+    SIM800_USSDSession_t *ussd = &handle->ussd;
+    SIM800_USSD_t *response = &ussd->response;
+    uint32_t pos = 0;
+    char c;
+
+    if (!line->continued)
+    {
+        memset(response, 0, sizeof(*response));
+        ussd->field = 0;
+        ussd->length = 0;
+        pos = 6;
+    }
+
+    for (; pos < line->length; pos++)
+    {
+        c = line_char(handle, line, pos);
+
+        if (ussd->field == 1)
+        {
+            if (c == '"')
+            {
+                ussd->field = 2;
+            }
+            else if (ussd->length < SIM800_USSD_LENGTH - 1)
+            {
+                response->text[ussd->length++] = c;
+            }
+        }
+        else if (c == '"')
+        {
+            ussd->field = 1;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            if (ussd->field == 0)
+                response->status = response->status * 10 + (c - '0');
+            else
+                response->dcs = response->dcs * 10 + (c - '0');
+        }
+    }
+
+    if (!line->complete)
+    {
+        return SIM800_OK;
+    }
+
+    end_notification(handle, index);
+
+#if SIM800_USE_SMS
+    // The coding groups 01xx and 1001 carry the alphabet in bits 3..2, 0x11 is UCS2 behind a language code
+    if (handle->smsUCS2 || response->dcs == 0x11 ||
+        (((response->dcs & 0xC0) == 0x40 || (response->dcs & 0xF0) == 0x90) && (response->dcs & 0x0C) == 0x08))
+    {
+        ucs2_decode(response->text);
+    }
+#endif
+
+    if (ussd->state == 1)
+    {
+        ussd_balance(handle);
+        ussd->status = SIM800_OK;
+        ussd->state = 2;
+    }
+
+    post_event(handle, SIM800_Event_USSD, 0, 0, 0);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Completion callback of "AT+CUSD=1", a refused query is finished at once.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the command.
+ * @param   *ctx: Not used.
+ */
+static void ussd_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_USSDSession_t *ussd = &handle->ussd;
+
+    if (status != SIM800_OK && ussd->state == 1)
+    {
+        memset(&ussd->response, 0, sizeof(ussd->response));
+        ussd->status = status;
+        ussd->state = 2;
+    }
+}
+
+
+/**
+ * @brief   Times out the USSD query in progress and invokes its callback once it is finished.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void ussd_poll(SIM800_Handle_t *handle)
+{
+    SIM800_USSDSession_t *ussd = &handle->ussd;
+    SIM800_USSDCallback_t callback;
+
+    if (ussd->state == 1 && HAL_GetTick() - ussd->tick > SIM800_USSD_TIMEOUT)
+    {
+        memset(&ussd->response, 0, sizeof(ussd->response));
+        ussd->status = SIM800_TIMEOUT;
+        ussd->state = 2;
+    }
+
+    if (ussd->state != 2)
+    {
+        return;
+    }
+
+    // The callback may send the next query
+    ussd->state = 0;
+    callback = ussd->callback;
+    ussd->callback = NULL;
+
+    if (callback != NULL)
+    {
+        callback(handle, ussd->status, &ussd->response, ussd->ctx);
+    }
+}
+
+
+/**
+ * @brief   Keeps the first amount of the USSD response text as the balance.
+ *
+ * The amount is the first number of the text, with a '-' right before it and up to two decimals behind
+ * a '.' or ',', e.g. "Balance: -12.5 USD" - -1250. A text without a number keeps the previous balance.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void ussd_balance(SIM800_Handle_t *handle)
+{
+    SIM800_Balance_t *balance = &handle->ussd.balance;
+    const char *text = handle->ussd.response.text;
+    const char *p = text;
+    int32_t value = 0;
+    uint8_t decimals = 0, negative;
+
+    while (*p != '\0' && (*p < '0' || *p > '9'))
+    {
+        p++;
+    }
+    if (*p == '\0')
+    {
+        return;
+    }
+
+    negative = (p > text && p[-1] == '-');
+    for (; *p >= '0' && *p <= '9'; p++)
+    {
+        // Larger amounts saturate instead of overflowing the hundredths
+        if (value < 2000000)
+        {
+            value = value * 10 + (*p - '0');
+        }
+    }
+
+    if ((*p == '.' || *p == ',') && p[1] >= '0' && p[1] <= '9')
+    {
+        for (p++; decimals < 2 && *p >= '0' && *p <= '9'; p++, decimals++)
+        {
+            value = value * 10 + (*p - '0');
+        }
+    }
+    for (; decimals < 2; decimals++)
+    {
+        value *= 10;
+    }
+
+    balance->value = negative ? -value : value;
+    balance->valid = 1;
+    balance->tick = HAL_GetTick();
+    if (SIM800_GetTime(handle, &balance->time) != SIM800_OK)
+    {
+        memset(&balance->time, 0, sizeof(balance->time));
+    }
+}
+
+
+/**
+ * @brief   Stores the registration status and location of a +CREG line in the handle.
+ *
+ * SIM800_NetworkRegCallBack is invoked if the status has changed.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the +CREG line.
+ * @param   *field: Pointer to the field cursor, placed on the <stat> field.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the status is not a number.
+ */
+static SIM800_Status_t update_reg_status(SIM800_Handle_t *handle, const SIM800_Line_t *line, line_field_t *field)
+{
+    SIM800_NetworkRegStatus_t status;
+    uint16_t location[2] = { 0, 0 };
+    char c;
+
+    if (line_field(handle, line, field) != FIELD_NUMBER)
+    {
+        return SIM800_ERROR;
+    }
+    status = (SIM800_NetworkRegStatus_t)field->value;
+
+    // The location fields are quoted hexadecimal numbers: ,"1A2B","0C3D"
+    for (uint8_t i = 0; i < 2 && line_field(handle, line, field) == FIELD_STRING; i++)
+    {
+        for (uint32_t pos = field->start; pos < field->end; pos++)
+        {
+            c = line_char(handle, line, pos);
+            if (c >= '0' && c <= '9')
+                location[i] = (location[i] << 4) | (c - '0');
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+                location[i] = (location[i] << 4) | ((c | 0x20) - 'a' + 10);
+            else
+                break;
+        }
+    }
+
+    // The cells and the location are cached until the serving cell changes
+    if (location[0] != handle->regLac || location[1] != handle->regCellId)
+    {
+        for (uint8_t i = SIM800_Cache_CellInfo; i < SIM800_Cache_Count; i++)
+        {
+            handle->cache[i].valid = 0;
+        }
+    }
+
+    handle->regLac = location[0];
+    handle->regCellId = location[1];
+
+    if (status != handle->regStatus)
+    {
+#if SIM800_USE_REG_CACHE
+        if (status == SIM800_Registered_HomeNetwork || status == SIM800_Registered_Roaming)
+        {
+            reg_cache_registered(handle);
+        }
+#endif
+        handle->regStatus = status;
+        post_event(handle, SIM800_Event_NetworkReg, status, 0, 0);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CCLK response to extract the time of the clock of the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_Time_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cclk_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CCLK: "23/11/05,13:00:00+12"
+     */
+    SIM800_Time_t *time = (SIM800_Time_t *)handle->expected_codes[index].response;
+    line_field_t field;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_STRING ||
+        !parse_timestamp(handle, line, field.start, field.end, time))
+        return SIM800_ERROR;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CENG response to extract the serving and the neighbour cells.
+ *
+ * The first line gives the mode and is skipped, every other line describes a cell: the serving cell is
+ * stored first, the neighbour cells follow as far as they fit. Empty neighbour cells are skipped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_CellInfo_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t ceng_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CENG: 3,0
+     * +CENG: 0,"250,01,1a2b,0c3d,37,42"
+     * +CENG: 1,"250,01,1a2b,0c3e,12,20"
+     */
+    SIM800_CellInfo_t *info = (SIM800_CellInfo_t *)handle->expected_codes[index].response;
+    uint32_t values[6] = { 0 };
+    line_field_t field;
+    SIM800_Cell_t *cell;
+    uint8_t count = 0, digit;
+    int32_t number;
+    char c;
+
+    if (handle->expected_codes[index].lines_count == 0)
+    {
+        memset(info, 0, sizeof(*info));
+    }
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER)
+        return SIM800_ERROR;
+    number = field.value;
+
+    if (line_field(handle, line, &field) != FIELD_STRING)
+        return SIM800_OK;
+
+    // "<mcc>,<mnc>,<lac>,<cellid>,<bsic>,<rxl>", the location area code and the cell ID are hexadecimal
+    for (uint32_t pos = field.start; pos < field.end; pos++)
+    {
+        if ((c = line_char(handle, line, pos)) == ',')
+        {
+            if (++count == 6)
+                return SIM800_ERROR;
+            continue;
+        }
+
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if ((count == 2 || count == 3) && (c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+            digit = (c | 0x20) - 'a' + 10;
+        else
+            return SIM800_ERROR;
+
+        values[count] = values[count] * ((count == 2 || count == 3) ? 16 : 10) + digit;
+    }
+
+    if (count != 5)
+        return SIM800_ERROR;
+
+    if (number == 0)
+    {
+        cell = &info->cells[0];
+        if (info->count == 0)
+            info->count = 1;
+    }
+    else if (values[3] != 0 && info->count != 0 && info->count < SIM800_CELL_COUNT)
+    {
+        cell = &info->cells[info->count++];
+    }
+    else
+    {
+        return SIM800_OK;
+    }
+
+    cell->mcc = values[0];
+    cell->mnc = values[1];
+    cell->lac = values[2];
+    cell->cellId = values[3];
+    cell->bsic = values[4];
+    cell->rxl = values[5];
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the *PSUTTZ notification of the network time.
+ *
+ * The notification carries the UTC time and the time zone, the clock of the handle is set from it.
+ * The expected code keeps waiting for the next notification.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the *PSUTTZ notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t psuttz_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * *PSUTTZ: 2023,11,5,10,0,0,"+12",0
+     */
+    SIM800_Time_t time = { 0 };
+    line_field_t field;
+    int32_t values[6];
+    uint32_t seconds;
+    int32_t zone = 0;
+    int32_t sign = 1;
+    char c;
+
+    end_notification(handle, index);
+
+    line_fields(handle, line, &field);
+    if (line_numbers(handle, line, &field, values, 6) != 6 || line_field(handle, line, &field) != FIELD_STRING)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint32_t pos = field.start; pos < field.end; pos++)
+    {
+        if ((c = line_char(handle, line, pos)) == '-')
+            sign = -1;
+        else if (c >= '0' && c <= '9' && zone <= 56)
+            zone = zone * 10 + (c - '0');
+    }
+
+    if (zone > 56)
+    {
+        return SIM800_ERROR;
+    }
+
+    time.year = values[0];
+    time.month = values[1];
+    time.day = values[2];
+    time.hour = values[3];
+    time.minute = values[4];
+    time.second = values[5];
+
+    if (time.year < SIM800_TIME_MIN_YEAR || !time_to_seconds(&time, &seconds))
+    {
+        return SIM800_ERROR;
+    }
+
+    if (line_field(handle, line, &field) == FIELD_NUMBER)
+    {
+        handle->time.dst = field.value;
+    }
+
+    clock_set(handle, seconds, sign * zone);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the DST notification of the daylight saving adjustment of the network.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the DST notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t dst_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * DST: 1
+     */
+    line_field_t field;
+
+    end_notification(handle, index);
+
+    // The code has no prefix, the field follows "DST:"
+    line_fields(handle, line, &field);
+    field.next = 4;
+    if (line_field(handle, line, &field) != FIELD_NUMBER)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->time.dst = field.value;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses a time stamp of the module, "yy/MM/dd,hh:mm:ss+zz".
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   start: Position of the first character of the time stamp.
+ * @param   end: Position behind the last character of the time stamp.
+ * @param   *time: Pointer to store the time, left untouched if the time stamp is invalid.
+ * @retval  1 if the time stamp is valid, 0 otherwise.
+ */
+static uint8_t parse_timestamp(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t start, uint32_t end,
+                               SIM800_Time_t *time)
+{
+    uint8_t values[7] = { 0 };
+    uint8_t count = 0, digits = 0;
+    int8_t sign = 1;
+    char c;
+
+    for (uint32_t pos = start; pos < end; pos++)
+    {
+        c = line_char(handle, line, pos);
+        if (c >= '0' && c <= '9' && digits < 2)
+        {
+            values[count] = values[count] * 10 + (c - '0');
+            digits++;
+            continue;
+        }
+
+        // Every number has two digits and is followed by one separator, the zone by nothing
+        if (digits == 0 || count == 6)
+            return 0;
+
+        if (count == 5)
+        {
+            if (c != '+' && c != '-')
+                return 0;
+            sign = (c == '-') ? -1 : 1;
+        }
+
+        count++;
+        digits = 0;
+    }
+
+    if (count != 6 || digits == 0 || values[1] < 1 || values[1] > 12 || values[2] < 1 || values[2] > 31 ||
+        values[3] > 23 || values[4] > 59 || values[5] > 59 || values[6] > 56)
+        return 0;
+
+    time->year = 2000 + values[0];
+    time->month = values[1];
+    time->day = values[2];
+    time->hour = values[3];
+    time->minute = values[4];
+    time->second = values[5];
+    time->zone = sign * values[6];
+
+    return 1;
+}
+
+
+/**
+ * @brief   Converts a local time to the seconds since 2000-01-01 00:00 UTC.
+ *
+ * Every fourth year is a leap year, which holds until 2100.
+ *
+ * @param   *time: Pointer to the time.
+ * @param   *seconds: Pointer to store the seconds.
+ * @retval  1 on success, 0 if the time is out of range.
+ */
+static uint8_t time_to_seconds(const SIM800_Time_t *time, uint32_t *seconds)
+{
+    static const uint16_t daysBefore[12] = { 0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334 };
+    uint32_t years, days;
+    int64_t local;
+
+    if (time->year < 2000 || time->year >= 2100 || time->month < 1 || time->month > 12 || time->day < 1)
+    {
+        return 0;
+    }
+
+    years = time->year - 2000;
+    days = years * 365 + (years + 3) / 4 + daysBefore[time->month - 1] + time->day - 1;
+    if (time->month > 2 && years % 4 == 0)
+    {
+        days++;
+    }
+
+    local = ((int64_t)days * 24 + time->hour) * 3600 + time->minute * 60 + time->second;
+    local -= time->zone * 900;
+    if (local < 0)
+    {
+        return 0;
+    }
+
+    *seconds = (uint32_t)local;
+
+    return 1;
+}
+
+
+/**
+ * @brief   Converts the seconds since 2000-01-01 00:00 UTC to a local time.
+ *
+ * @param   seconds: Seconds since 2000-01-01 00:00 UTC.
+ * @param   zone: Offset of the local time from UTC in quarters of an hour.
+ * @param   *time: Pointer to store the time.
+ */
+static void seconds_to_time(uint32_t seconds, int8_t zone, SIM800_Time_t *time)
+{
+    static const uint8_t monthDays[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    uint32_t local = seconds + zone * 900;
+    uint32_t days = local / 86400;
+    uint32_t length;
+    uint8_t leap;
+
+    time->zone = zone;
+    time->second = local % 60;
+    time->minute = (local / 60) % 60;
+    time->hour = (local / 3600) % 24;
+
+    // Four years, the first one is a leap year
+    time->year = 2000 + 4 * (days / 1461);
+    days %= 1461;
+    for (leap = 1; days >= (length = leap ? 366 : 365); leap = 0)
+    {
+        days -= length;
+        time->year++;
+    }
+
+    for (time->month = 1; days >= (length = monthDays[time->month - 1] + (leap && time->month == 2)); time->month++)
+    {
+        days -= length;
+    }
+    time->day = days + 1;
+}
+
+
+/**
+ * @brief   Sets the clock of the handle from the network time.
+ *
+ * SIM800_NetworkTimeCallBack is posted with the new local time.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   seconds: Seconds since 2000-01-01 00:00 UTC.
+ * @param   zone: Offset of the local time from UTC in quarters of an hour.
+ */
+static void clock_set(SIM800_Handle_t *handle, uint32_t seconds, int8_t zone)
+{
+    handle->time.seconds = seconds;
+    handle->time.tick = HAL_GetTick();
+    handle->time.zone = zone;
+    handle->time.valid = 1;
+
+    post_event(handle, SIM800_Event_NetworkTime, (uint8_t)zone, 0, seconds);
+}
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Parses the +CMGR response to extract SMS message details.
+ *
+ * This function is called for every line of a +CMGR response received from the SIM800 module.
+ * The header line carries the sender, the second quoted field, and the service centre time stamp.
+ * All following lines (or chunks of long lines) form the message body and are appended to the text
+ * as they arrive, so the
+ * response never has to be buffered as a whole. A text longer than the message structure is truncated.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_SMSMessage_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cmgr_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     *  +CMGR: "REC UNREAD","+8613918186089","","02/01/30,20:40:31+00"
+     *	This is a test
+     *	OK
+     */
+    SIM800_SMSMessage_t *sms_message = (SIM800_SMSMessage_t *)handle->expected_codes[index].response;
+
+    // A message read into the inbound queue takes the slot being parsed now, not the one of the submission
+    if (sms_message >= handle->smsSlots && sms_message < handle->smsSlots + SIM800_SMS_QUEUE_LENGTH)
+    {
+        sms_message = sms_slot(handle);
+    }
+
+    if (handle->expected_codes[index].lines_count == 0)
+    {
+        memset(sms_message, 0, sizeof(*sms_message));
+#if SIM800_USE_PDU
+        pdu_rx_reset(handle);
+#endif
+
+        // The PDU mode header carries no message data: +CMGR: <stat>,[<alpha>],<length>
+        return handle->smsPDU ? SIM800_OK : sms_header(handle, line, sms_message, 1);
+    }
+
+#if SIM800_USE_PDU
+    if (handle->smsPDU)
+    {
+        return pdu_rx_append(handle, line, sms_message);
+    }
+#endif
+
+    // Separate the body lines, but not the chunks of one line
+    sms_body(handle, line, sms_message, handle->expected_codes[index].lines_count > 1 && !line->continued);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CMT notification of a directly delivered SMS message.
+ *
+ * The header carries the sender, the following line (including all its chunks) is the text. Once the
+ * text is complete, the message is delivered (see sms_deliver) and the expected code waits for the
+ * next notification.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the pending message associated with the +CMT notification.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the line is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cmt_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     *  +CMT: "+8613918186089","","02/01/30,20:40:31+00"
+     *	This is a test
+     */
+    SIM800_SMSMessage_t *sms_message = sms_slot(handle);
+
+    if (!line->continued && line_starts_with(handle, line, "+CMT:", 5))
+    {
+        memset(sms_message, 0, sizeof(*sms_message));
+#if SIM800_USE_PDU
+        pdu_rx_reset(handle);
+#endif
+
+        if (!handle->smsPDU && sms_header(handle, line, sms_message, 0) != SIM800_OK)
+        {
+            end_notification(handle, index);
+            return SIM800_ERROR;
+        }
+
+        return SIM800_OK;
+    }
+
+#if SIM800_USE_PDU
+    if (handle->smsPDU)
+    {
+        // +CMT: [<alpha>],<length> is followed by the PDU
+        if (pdu_rx_append(handle, line, sms_message) != SIM800_OK)
+        {
+            end_notification(handle, index);
+            return SIM800_ERROR;
+        }
+    }
+    else
+#endif
+    {
+        sms_body(handle, line, sms_message, 0);
+    }
+
+    if (line->complete)
+    {
+        end_notification(handle, index);
+        sms_deliver(handle);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CMGL listing of SMS messages.
+ *
+ * This function is called for every line of the listing. Only the first header line matches the
+ * expected code, the following ones arrive as response lines and start the next message. A message is
+ * handed to the listing callback when the next header or the end of the listing is received, so only
+ * one message is held at a time.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to handle->smsList.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the line is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cmgl_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     *  +CMGL: 1,"REC UNREAD","+8613918186089","","02/01/30,20:40:31+00"
+     *	This is a test
+     *  +CMGL: 2,"REC UNREAD","+8613918186089","","02/01/30,20:45:12+00"
+     *	This is another test
+     *	OK
+     */
+    SIM800_SMSList_t *list = (SIM800_SMSList_t *)handle->expected_codes[index].response;
+    SIM800_SMSMessage_t *sms_message = sms_slot(handle);
+    line_field_t field;
+
+    if (!line->continued && line_starts_with(handle, line, "+CMGL:", 6))
+    {
+#if SIM800_USE_PDU
+        if (list->lines != 0 && !sms_part(handle, sms_message))
+#else
+        if (list->lines != 0)
+#endif
+        {
+            list->count++;
+            list->callback(handle, sms_message, list->ctx);
+            sms_consumed(handle, sms_message->index);
+        }
+
+        memset(sms_message, 0, sizeof(*sms_message));
+#if SIM800_USE_PDU
+        pdu_rx_reset(handle);
+#endif
+        line_fields(handle, line, &field);
+        line_field(handle, line, &field);
+        sms_message->index = field.value;
+        list->lines = 1;
+
+        // +CMGL: <index>,<stat>,[<alpha>],<length> in PDU mode
+        return handle->smsPDU ? SIM800_OK : sms_header(handle, line, sms_message, 2);
+    }
+
+    if (list->lines == 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    list->lines++;
+
+#if SIM800_USE_PDU
+    if (handle->smsPDU)
+    {
+        return pdu_rx_append(handle, line, sms_message);
+    }
+#endif
+
+    sms_body(handle, line, sms_message, list->lines > 2 && !line->continued);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the sender and the time stamp of an SMS message header (+CMGR, +CMGL or +CMT).
+ *
+ * The sender is the first field of +CMT and follows the status in +CMGR and the index and status in +CMGL.
+ * The service centre time stamp follows the alpha field behind the sender.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the header line.
+ * @param   *message: Pointer to the message structure.
+ * @param   sender: Number of the sender field (1 for +CMGR, 2 for +CMGL, 0 for +CMT).
+ * @retval  SIM800_OK if the header is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t sms_header(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_SMSMessage_t *message, uint8_t sender)
+{
+    line_field_t field, stamp;
+
+    line_fields(handle, line, &field);
+    for (uint8_t i = 0; i < sender; i++)
+    {
+        if (line_field(handle, line, &field) == FIELD_NONE)
+            return SIM800_ERROR;
+    }
+
+    if (line_field(handle, line, &field) != FIELD_STRING)
+        return SIM800_ERROR;
+
+    // The time stamp follows the alpha field: ,"","02/01/30,20:40:31+00"
+    stamp = field;
+    if (line_field(handle, line, &stamp) != FIELD_NONE && line_field(handle, line, &stamp) == FIELD_STRING)
+    {
+        parse_timestamp(handle, line, stamp.start, stamp.end, &message->timestamp);
+    }
+
+    if (!handle->smsUCS2)
+    {
+        line_copy(handle, line, field.start, field.end, message->sender, SMS_SENDER_MAX_LEN);
+        return SIM800_OK;
+    }
+
+    // The sender and the text are UCS2 hex, the text follows on the next lines
+    ucs2_reset(handle);
+    ucs2_append(handle, line, field.start, field.end, message->sender, SMS_SENDER_MAX_LEN);
+    ucs2_reset(handle);
+    message->encoding = SIM800_SMSEncoding_UCS2;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Appends a body line (or line chunk) to the text of an SMS message.
+ *
+ * A text longer than the message structure is truncated.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the body line.
+ * @param   *message: Pointer to the message structure.
+ * @param   separate: 1 to separate the line from the previous one by '\n'.
+ */
+static void sms_body(SIM800_Handle_t *handle, const SIM800_Line_t *line, SIM800_SMSMessage_t *message, uint8_t separate)
+{
+    size_t len = strlen(message->text);
+
+    if (message->encoding == SIM800_SMSEncoding_UCS2)
+    {
+        // The line breaks of a UCS2 text are encoded in it
+        ucs2_append(handle, line, 0, line->length, message->text, SMS_TEXT_MAX_LEN);
+        return;
+    }
+
+    if (separate && len < SMS_TEXT_MAX_LEN - 1)
+    {
+        message->text[len++] = '\n';
+    }
+
+    line_copy(handle, line, 0, line->length, &message->text[len], SMS_TEXT_MAX_LEN - len);
+}
+
+
+/**
+ * @brief   Starts the conversion of a new UCS2 hex field.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void ucs2_reset(SIM800_Handle_t *handle)
+{
+    handle->ucs2Code = 0;
+    handle->ucs2Digits = 0;
+    handle->ucs2High = 0;
+}
+
+
+/**
+ * @brief   Converts a part of a received line from UCS2 hex and appends it to a UTF-8 string.
+ *
+ * The characters are taken straight from the ring. A character split between two line chunks is kept in
+ * the handle until its remaining digits arrive, so a long text is converted chunk by chunk. A character
+ * that does not fit into the string is dropped, a string is never cut inside a UTF-8 sequence.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   from: Position of the first hex digit.
+ * @param   to: Position behind the last hex digit.
+ * @param   *dst: NUL-terminated destination string.
+ * @param   size: Size of the destination buffer.
+ */
+static void ucs2_append(SIM800_Handle_t *handle, const SIM800_Line_t *line, uint32_t from, uint32_t to, char *dst, size_t size)
+{
+    size_t len = strlen(dst);
+    uint32_t code;
+    uint8_t nibble, n;
+    char utf8[4];
+    char c;
+
+    if (to > line->length)
+    {
+        to = line->length;
+    }
+
+    for (; from < to; from++)
+    {
+        c = line_char(handle, line, from);
+
+        if (c >= '0' && c <= '9')
+            nibble = c - '0';
+        else if (c >= 'A' && c <= 'F')
+            nibble = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            nibble = c - 'a' + 10;
+        else
+            continue;
+
+        handle->ucs2Code = (handle->ucs2Code << 4) | nibble;
+        if (++handle->ucs2Digits < 4)
+        {
+            continue;
+        }
+
+        code = handle->ucs2Code;
+        handle->ucs2Code = 0;
+        handle->ucs2Digits = 0;
+
+        if (code >= 0xD800 && code < 0xDC00)
+        {
+            handle->ucs2High = code;
+            continue;
+        }
+        if (code >= 0xDC00 && code < 0xE000)
+        {
+            code = handle->ucs2High ? 0x10000 + ((handle->ucs2High - 0xD800) << 10) + (code - 0xDC00) : 0xFFFD;
+        }
+        handle->ucs2High = 0;
+
+        if (len + (n = SIM800_UTF8_Encode(code, utf8)) < size)
+        {
+            memcpy(&dst[len], utf8, n);
+            len += n;
+        }
+    }
+
+    dst[len] = '\0';
+}
+
+
+/**
+ * @brief   Converts a NUL-terminated string from UCS2 hex to UTF-8 in place.
+ *
+ * A UTF-8 character is never longer than the four hex digits it comes from (eight for a surrogate pair),
+ * so the converted text never overtakes the digits still to be read. Trailing odd digits are dropped.
+ *
+ * @param   *text: String to convert.
+ */
+static void ucs2_decode(char *text)
+{
+    uint32_t code = 0, high = 0;
+    size_t in, out = 0;
+    uint8_t nibble, digits = 0, n;
+    char utf8[4];
+    char c;
+
+    for (in = 0; (c = text[in]) != '\0'; in++)
+    {
+        if (c >= '0' && c <= '9')
+            nibble = c - '0';
+        else if (c >= 'A' && c <= 'F')
+            nibble = c - 'A' + 10;
+        else if (c >= 'a' && c <= 'f')
+            nibble = c - 'a' + 10;
+        else
+            continue;
+
+        code = (code << 4) | nibble;
+        if (++digits < 4)
+        {
+            continue;
+        }
+        digits = 0;
+
+        if (code >= 0xD800 && code < 0xDC00)
+        {
+            high = code;
+            code = 0;
+            continue;
+        }
+        if (code >= 0xDC00 && code < 0xE000)
+        {
+            code = high ? 0x10000 + ((high - 0xD800) << 10) + (code - 0xDC00) : 0xFFFD;
+        }
+        high = 0;
+
+        n = SIM800_UTF8_Encode(code, utf8);
+        memcpy(&text[out], utf8, n);
+        out += n;
+        code = 0;
+    }
+
+    text[out] = '\0';
+}
+
+
+/**
+ * @brief   Counts the UCS2 characters of a UTF-8 text.
+ *
+ * @param   *text: Text to count.
+ * @retval  Count of UCS2 characters, a character outside the basic plane takes two.
+ */
+static uint16_t ucs2_length(const char *text)
+{
+    uint16_t count = 0;
+
+    while (*text != '\0')
+    {
+        count += (SIM800_UTF8_Decode(&text) >= 0x10000) ? 2 : 1;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Checks if a text fits into a single SMS message in the current character set.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *text: Text of the message.
+ * @retval  1 if the text fits, 0 otherwise.
+ */
+static uint8_t sms_text_fits(SIM800_Handle_t *handle, const char *text)
+{
+    if (handle->smsUCS2)
+    {
+        return ucs2_length(text) <= SMS_UCS2_MAX_LEN;
+    }
+
+    return strlen(text) <= (SMS_TX_MAX_LEN - 3);
+}
+
+
+/**
+ * @brief   Completion callback of a template send, the template may be sent again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the send.
+ * @param   *ctx: Pointer to the template structure.
+ */
+static void sms_template_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_SMSTemplate_t *tpl = (SIM800_SMSTemplate_t *)ctx;
+
+    tpl->busy = 0;
+
+    if (tpl->done != NULL)
+    {
+        tpl->done(handle, status, tpl->ctx);
+    }
+}
+
+#endif /* SIM800_USE_SMS */
+
+
+#if SIM800_USE_GPRS
+
+/**
+ * @brief   Parses the local IP address reported by "AT+CIFSR".
+ *
+ * The address is not followed by a final result code, so the parser completes the response itself.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a buffer of 16 characters.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t ip_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * <IP address>
+     */
+    SIM800_ExpectedCode_t *code = &handle->expected_codes[index];
+
+    if (line_find(handle, line, '.', 0) < 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    line_copy(handle, line, 0, line->length, (char *)code->response, sizeof(handle->localIP));
+
+    code->result = SIM800_OK;
+    code->state = SIM800_ReceivedStatus;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the status lines of a connection.
+ *
+ * The connection events are passed to SIM800_SocketCallBack. "SEND OK", "SEND FAIL" and "CLOSE OK"
+ * are the responses of "AT+CIPSEND" and "AT+CIPCLOSE", which have no final result code: they
+ * complete the request of the socket, see complete_request.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to the SIM800_Socket_t of the connection.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t socket_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * <n>, CONNECT OK | CONNECT FAIL | ALREADY CONNECT | CLOSED | CLOSE OK | SEND OK | SEND FAIL
+     */
+    SIM800_Socket_t *socket = (SIM800_Socket_t *)handle->expected_codes[index].response;
+    uint8_t n = socket - handle->sockets;
+    SIM800_Line_t status = *line;
+    uint32_t pos = 1;
+
+    end_notification(handle, index);
+
+    if (line_char(handle, line, pos++) != ',')
+    {
+        return SIM800_ERROR;
+    }
+    while (line_char(handle, line, pos) == ' ')
+    {
+        pos++;
+    }
+
+    status.start += pos;
+    status.length -= pos;
+
+    if (line_equals(handle, &status, "CONNECT OK") || line_equals(handle, &status, "ALREADY CONNECT"))
+    {
+        socket->state = SIM800_Socket_Connected;
+        post_event(handle, SIM800_Event_Socket, n, SIM800_SocketEvent_Connected, 0);
+    }
+    else if (line_equals(handle, &status, "CONNECT FAIL"))
+    {
+        socket->state = SIM800_Socket_Closed;
+        post_event(handle, SIM800_Event_Socket, n, SIM800_SocketEvent_ConnectFailed, 0);
+    }
+    else if (line_equals(handle, &status, "CLOSED"))
+    {
+        socket->state = SIM800_Socket_Closed;
+        post_event(handle, SIM800_Event_Socket, n, SIM800_SocketEvent_Closed, 0);
+    }
+    else if (line_equals(handle, &status, "CLOSE OK"))
+    {
+        socket->state = SIM800_Socket_Closed;
+        complete_request(handle, SIM800_Cmd_SocketClose, '0' + n, SIM800_OK);
+    }
+    else if (line_equals(handle, &status, "SEND OK"))
+    {
+        complete_request(handle, SIM800_Cmd_SocketSend, '0' + n, SIM800_OK);
+    }
+    else if (line_equals(handle, &status, "SEND FAIL"))
+    {
+        complete_request(handle, SIM800_Cmd_SocketSend, '0' + n, SIM800_ERROR);
+    }
+    else
+    {
+        return SIM800_ERROR;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the header of the data received by a connection.
+ *
+ * The raw data follows the header line, SIM800_Process copies it into the receive buffer of the
+ * socket, see socket_rx.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the +RECEIVE expected code.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t receive_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +RECEIVE,<n>,<length>:
+     */
+    uint32_t pos = 9;
+    int32_t socket = line_to_int(handle, line, &pos);
+    int32_t length;
+
+    end_notification(handle, index);
+
+    pos++;
+    length = line_to_int(handle, line, &pos);
+
+    if (socket < 0 || socket >= SIM800_SOCKET_COUNT || length <= 0 || line_char(handle, line, pos) != ':')
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->rxRawSocket = socket;
+    handle->rxRaw = length;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the response of "AT+CIPRXGET=2" and prepares the reading of its payload.
+ *
+ * The payload follows the header line, SIM800_Process copies it into the buffer of the read, see socket_rx.
+ * Pending data notifications seen by the expected code of the command are skipped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_SocketRead_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t ciprxget_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CIPRXGET: 2,<n>,<cnflength>,<remaining>
+     */
+    SIM800_SocketRead_t *read = (SIM800_SocketRead_t *)handle->expected_codes[index].response;
+    line_field_t field;
+    int32_t values[3];
+    int32_t length;
+
+    line_fields(handle, line, &field);
+    if (read->header || !line_starts_with(handle, line, "+CIPRXGET:", 10) ||
+        line_field(handle, line, &field) != FIELD_NUMBER || field.value != 2)
+    {
+        return SIM800_OK;
+    }
+
+    read->header = 1;
+    if (line_numbers(handle, line, &field, values, 3) != 3 || values[0] != read->socket)
+    {
+        return SIM800_ERROR;
+    }
+    length = values[1];
+
+    if (length < 0 || length > read->size || values[2] < 0)
+    {
+        return SIM800_ERROR;
+    }
+    read->remaining = values[2];
+
+    handle->sockets[read->socket].rxPending = (read->remaining != 0);
+
+    read->length = length;
+    if (length != 0)
+    {
+        handle->rxRawSocket = read->socket;
+        handle->rxRawBuffer = read->buffer;
+        handle->rxRaw = length;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the pending data notification of the manual receive mode.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the +CIPRXGET expected code.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t ciprxget_urc_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CIPRXGET: 1,<n>
+     */
+    line_field_t field;
+    int32_t socket;
+
+    end_notification(handle, index);
+
+    // The responses of "AT+CIPRXGET=2" are parsed by the command
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER || field.value != 1)
+    {
+        return SIM800_OK;
+    }
+
+    socket = (line_field(handle, line, &field) == FIELD_NUMBER) ? field.value : -1;
+    if (socket < 0 || socket >= SIM800_SOCKET_COUNT)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->sockets[socket].rxPending = 1;
+    post_event(handle, SIM800_Event_Socket, socket, SIM800_SocketEvent_Pending, 0);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Completes a request finished by a status line instead of a final result code.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   cmd: Command of the request, e.g. SIM800_Cmd_SocketSend.
+ * @param   first: First character of the argument of the request (the socket number), '\0' - any.
+ * @param   status: Result of the request.
+ */
+static void complete_request(SIM800_Handle_t *handle, SIM800_Command_t cmd, char first, SIM800_Status_t status)
+{
+    SIM800_Request_t *req = &handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)];
+
+    if (handle->reqTail == handle->reqHead || req->cmd != cmd || req->state != SIM800_Request_WaitingResult ||
+        req->index >= EXPECTED_CODES_MAX_COUNT || (first != '\0' && (req->arg == NULL || req->arg[0] != first)))
+    {
+        return;
+    }
+
+    handle->expected_codes[req->index].result = status;
+    handle->expected_codes[req->index].state = SIM800_ReceivedStatus;
+}
+
+
+/**
+ * @brief   Copies the received raw data of "+RECEIVE" into the receive buffer of its socket.
+ *
+ * Once all announced bytes are copied, SIM800_SocketCallBack is invoked with SIM800_SocketEvent_Received.
+ * The payload of "+CIPRXGET: 2" is copied into the buffer of SIM800_SocketRead instead, and the body
+ * of "+HTTPREAD" is handed to the body callback of the HTTP client piece by piece, as it lies in the ring.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   head: Write index of the receive ring the characters are available up to.
+ */
+static void socket_rx(SIM800_Handle_t *handle, uint32_t head)
+{
+    SIM800_Socket_t *socket = &handle->sockets[handle->rxRawSocket];
+
+#if SIM800_USE_HTTP
+    while (handle->rxRaw != 0 && handle->rxScan != head && handle->rxRawHttp)
+    {
+        uint32_t offset = handle->rxScan & (RX_RING_LENGTH - 1);
+        uint32_t count = head - handle->rxScan;
+
+        // Hand over the contiguous part of the ring
+        if (count > handle->rxRaw)
+        {
+            count = handle->rxRaw;
+        }
+        if (count > RX_RING_LENGTH - offset)
+        {
+            count = RX_RING_LENGTH - offset;
+        }
+
+        if (handle->http.body != NULL)
+        {
+            handle->http.body(handle, &handle->rxRing[offset], count, handle->http.ctx);
+        }
+
+        handle->rxScan += count;
+        handle->rxRaw -= count;
+    }
+#endif
+
+    while (handle->rxRaw != 0 && handle->rxScan != head && handle->rxRawBuffer != NULL)
+    {
+        *handle->rxRawBuffer++ = handle->rxRing[handle->rxScan++ & (RX_RING_LENGTH - 1)];
+        handle->rxRaw--;
+    }
+
+    while (handle->rxRaw != 0 && handle->rxScan != head)
+    {
+        if (socket->rxHead - socket->rxTail < SIM800_SOCKET_RX_LENGTH)
+        {
+            socket->rx[socket->rxHead++ & (SIM800_SOCKET_RX_LENGTH - 1)] = handle->rxRing[handle->rxScan & (RX_RING_LENGTH - 1)];
+        }
+        else
+        {
+            socket->rxDropped++;
+        }
+
+        handle->rxScan++;
+        handle->rxRaw--;
+    }
+
+    handle->rxLineStart = handle->rxScan;
+    handle->rxTail = handle->rxScan;
+
+    if (handle->rxRaw != 0)
+    {
+        return;
+    }
+
+#if SIM800_USE_HTTP
+    if (handle->rxRawHttp)
+    {
+        handle->rxRawHttp = 0;
+        return;
+    }
+#endif
+
+    if (handle->rxRawBuffer != NULL)
+    {
+        handle->rxRawBuffer = NULL;
+        return;
+    }
+
+    post_event(handle, SIM800_Event_Socket, handle->rxRawSocket, SIM800_SocketEvent_Received, 0);
+}
+
+
+/**
+ * @brief   Checks if the received characters belong to the connection of the transparent data pipe.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  1 if the pipe is online or escaping, 0 otherwise.
+ */
+static uint8_t transparent_data(SIM800_Handle_t *handle)
+{
+    return handle->transparent == SIM800_Transparent_Online || handle->transparent == SIM800_Transparent_Escaping;
+}
+
+
+/**
+ * @brief   Checks if commands are held back by the transparent data pipe.
+ *
+ * A command sent while the pipe is (about to be) in data mode would be sent as data, a command sent
+ * before the answer of "+++" would take it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  1 if no command may be started, 0 otherwise.
+ */
+static uint8_t transparent_busy(SIM800_Handle_t *handle)
+{
+    return handle->transparent == SIM800_Transparent_Connecting || transparent_data(handle) ||
+           handle->transparent == SIM800_Transparent_EscapeAnswer;
+}
+
+
+/**
+ * @brief   Hands the received bytes of the transparent data pipe to SIM800_TransparentRxCallBack.
+ *
+ * The bytes are passed straight from the receive ring, in at most two pieces when the ring wraps. If the
+ * carrier has been lost, the bytes received before are the last ones of the connection: the pipe becomes
+ * idle, SIM800_TransparentClosedCallBack is invoked and the following characters are parsed as lines.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   head: Write index of the receive ring the characters are available up to.
+ */
+static void transparent_rx(SIM800_Handle_t *handle, uint32_t head)
+{
+    uint32_t end = handle->carrierLost ? handle->carrierHead : head;
+    uint32_t pos, length;
+
+    while (transparent_data(handle) && handle->rxScan != end)
+    {
+        pos = handle->rxScan & (RX_RING_LENGTH - 1);
+        length = end - handle->rxScan;
+        if (length > RX_RING_LENGTH - pos)
+        {
+            length = RX_RING_LENGTH - pos;
+        }
+
+        SIM800_TransparentRxCallBack(handle, &handle->rxRing[pos], length);
+
+        handle->rxScan += length;
+        handle->rxLineStart = handle->rxScan;
+        handle->rxTail = handle->rxScan;
+    }
+
+    if (handle->carrierLost)
+    {
+        handle->carrierLost = 0;
+
+        if (handle->transparent > SIM800_Transparent_Idle)
+        {
+            handle->transparent = SIM800_Transparent_Idle;
+            SIM800_TransparentClosedCallBack(handle);
+        }
+    }
+}
+
+
+/**
+ * @brief   Tracks the connection of the transparent data pipe while the characters are parsed as lines.
+ *
+ * "CONNECT" starts data mode (the following characters are data) and completes "ATO", "CLOSE OK"
+ * completes "AT+CIPCLOSE", "CONNECT FAIL" and "CLOSED" end the connection.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the received line.
+ */
+static void transparent_line(SIM800_Handle_t *handle, const SIM800_Line_t *line)
+{
+    SIM800_Transparent_t state = handle->transparent;
+
+    if (state == SIM800_Transparent_Off)
+    {
+        return;
+    }
+
+    if (line_equals(handle, line, "CONNECT"))
+    {
+        handle->transparent = SIM800_Transparent_Online;
+        complete_request(handle, SIM800_Cmd_DataResume, '\0', SIM800_OK);
+    }
+    else if (line_equals(handle, line, "CLOSE OK"))
+    {
+        handle->transparent = SIM800_Transparent_Idle;
+        complete_request(handle, SIM800_Cmd_SocketClose, '\0', SIM800_OK);
+    }
+    else if (line_equals(handle, line, "CONNECT FAIL") || line_equals(handle, line, "CLOSED"))
+    {
+        handle->transparent = SIM800_Transparent_Idle;
+
+        if (state == SIM800_Transparent_Suspended)
+        {
+            SIM800_TransparentClosedCallBack(handle);
+        }
+    }
+}
+
+
+/**
+ * @brief   Parses the result of "AT+CDNSGIP".
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the +CDNSGIP expected code, its response points to the SIM800_DNS_t of the handle.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t cdnsgip_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CDNSGIP: 1,"<domain name>","<IP1>"[,"<IP2>"]
+     * +CDNSGIP: 0,<dns error code>
+     */
+    SIM800_DNS_t *dns = (SIM800_DNS_t *)handle->expected_codes[index].response;
+    line_field_t field;
+
+    end_notification(handle, index);
+
+    dns->done = 1;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER || field.value != 1)
+    {
+        return SIM800_OK;
+    }
+
+    // The address follows the name
+    if (line_field(handle, line, &field) != FIELD_STRING || line_field(handle, line, &field) != FIELD_STRING)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (line_copy(handle, line, field.start, field.end, dns->ip, sizeof(dns->ip)) != field.end - field.start ||
+        !dns_is_address(dns->ip))
+    {
+        return SIM800_ERROR;
+    }
+
+    dns->found = 1;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Checks whether a host is given as an IP address, which needs no lookup.
+ *
+ * @param   *host: Host name or IP address.
+ * @retval  1 if the host is made of digits and dots only, 0 otherwise.
+ */
+static uint8_t dns_is_address(const char *host)
+{
+    if (*host == '\0')
+    {
+        return 0;
+    }
+
+    for (; *host != '\0'; host++)
+    {
+        if ((*host < '0' || *host > '9') && *host != '.')
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief   Finds the entry of the DNS cache for a host name.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *host: Host name.
+ * @retval  The entry of the host name if there is one, otherwise a free or expired entry, or the oldest one.
+ */
+static SIM800_DNSEntry_t *dns_slot(SIM800_Handle_t *handle, const char *host)
+{
+    SIM800_DNSEntry_t *entries = handle->dns.entries;
+    SIM800_DNSEntry_t *slot = &entries[0];
+    uint32_t now = HAL_GetTick();
+    uint32_t age = 0;
+
+    for (uint8_t i = 0; i < SIM800_DNS_CACHE_SIZE; i++)
+    {
+        if (strcmp(entries[i].host, host) == 0)
+        {
+            return &entries[i];
+        }
+
+        if (entries[i].host[0] == '\0' || now - entries[i].tick >= SIM800_DNS_TTL)
+        {
+            // Free and expired entries come before the live ones
+            if (age != UINT32_MAX)
+            {
+                slot = &entries[i];
+                age = UINT32_MAX;
+            }
+        }
+        else if (now - entries[i].tick > age)
+        {
+            slot = &entries[i];
+            age = now - entries[i].tick;
+        }
+    }
+
+    return slot;
+}
+
+
+/**
+ * @brief   Gives the address to connect to for a host, see SIM800_Resolve.
+ *
+ * A failed lookup is not final: the host name is then passed on to "AT+CIPSTART", which resolves it itself.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *host: Host name or IP address.
+ * @param   *ip: Buffer of 16 characters for the resolved address.
+ * @retval  The resolved address, or the host itself.
+ */
+static const char *dns_address(SIM800_Handle_t *handle, const char *host, char *ip)
+{
+    if (dns_is_address(host) || SIM800_Resolve(handle, host, ip) != SIM800_OK)
+    {
+        return host;
+    }
+
+    return ip;
+}
+
+
+/**
+ * @brief   Handles the end of "AT+CIPSTART" of SIM800_TransparentOpen.
+ *
+ * The pipe is marked as connecting before SIM800_Poll can send the next request, which would otherwise
+ * become data once "CONNECT" arrives.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the blocking_result_t structure of the waiting function.
+ */
+static void transparent_open_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    if (status == SIM800_OK && handle->transparent == SIM800_Transparent_Idle)
+    {
+        handle->transparent = SIM800_Transparent_Connecting;
+    }
+
+    blocking_done(handle, status, ctx);
+}
+
+
+#if SIM800_USE_HTTP
+
+/**
+ * @brief   Parses the response of "AT+SAPBR=2,1".
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a uint8_t set to 1 if the bearer is open.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t sapbr_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +SAPBR: <cid>,<status>,<IP address>
+     */
+    line_field_t field;
+    int32_t values[2];
+
+    line_fields(handle, line, &field);
+    if (line_numbers(handle, line, &field, values, 2) != 2 || values[0] != 1)
+    {
+        return SIM800_ERROR;
+    }
+
+    *(uint8_t *)handle->expected_codes[index].response = (values[1] == 1);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the result of "AT+HTTPACTION".
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the +HTTPACTION expected code.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t httpaction_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +HTTPACTION: <method>,<status>,<datalen>
+     */
+    line_field_t field;
+    int32_t values[3];
+
+    end_notification(handle, index);
+
+    line_fields(handle, line, &field);
+    if (line_numbers(handle, line, &field, values, 3) != 3 || values[1] < 0 || values[2] < 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->http.status = values[1];
+    handle->http.length = values[2];
+    handle->http.done = 1;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the response of "AT+HTTPREAD" and prepares the reading of its body.
+ *
+ * The body follows the header line, SIM800_Process hands it to the body callback, see socket_rx.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a uint32_t to store the count of bytes.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t httpread_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +HTTPREAD: <length>
+     */
+    line_field_t field;
+    int32_t length = -1;
+
+    line_fields(handle, line, &field);
+    line_numbers(handle, line, &field, &length, 1);
+
+    if (length < 0 || length > SIM800_HTTP_READ_CHUNK)
+    {
+        return SIM800_ERROR;
+    }
+
+    *(uint32_t *)handle->expected_codes[index].response = length;
+    if (length != 0)
+    {
+        handle->rxRawHttp = 1;
+        handle->rxRaw = length;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the +CLBS response to extract the location of the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a SIM800_Location_t structure.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs or the service has no location.
+ */
+static SIM800_Status_t clbs_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +CLBS: <locationcode>[,<longitude>,<latitude>,<acc>]
+     * +CLBS: 0,37.617633,55.755786,550
+     */
+    SIM800_Location_t *location = (SIM800_Location_t *)handle->expected_codes[index].response;
+    line_field_t field;
+
+    if (handle->expected_codes[index].lines_count != 0)
+        return SIM800_OK;
+
+    line_fields(handle, line, &field);
+    if (line_field(handle, line, &field) != FIELD_NUMBER || field.value != 0)
+        return SIM800_ERROR;
+
+    if (line_field(handle, line, &field) == FIELD_NONE || !parse_degrees(handle, line, &field, &location->longitude) ||
+        line_field(handle, line, &field) == FIELD_NONE || !parse_degrees(handle, line, &field, &location->latitude) ||
+        line_field(handle, line, &field) != FIELD_NUMBER)
+        return SIM800_ERROR;
+
+    location->accuracy = field.value;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Converts a decimal number of degrees (e.g., "-37.617633") to millionths of a degree.
+ *
+ * Digits behind the sixth decimal are dropped.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *line: Pointer to the line.
+ * @param   *field: Pointer to the field.
+ * @param   *value: Pointer to store the value.
+ * @retval  1 on success, 0 if the field is not a number of degrees.
+ */
+static uint8_t parse_degrees(SIM800_Handle_t *handle, const SIM800_Line_t *line, const line_field_t *field, int32_t *value)
+{
+    int32_t whole = 0, fraction = 0, scale = 1000000, sign = 1;
+    uint8_t point = 0, digits = 0;
+    char c;
+
+    for (uint32_t pos = field->start; pos < field->end; pos++)
+    {
+        c = line_char(handle, line, pos);
+        if (c == '-' && pos == field->start)
+        {
+            sign = -1;
+        }
+        else if (c == '.' && !point)
+        {
+            point = 1;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            digits++;
+            if (!point)
+            {
+                if ((whole = whole * 10 + (c - '0')) > 180)
+                    return 0;
+            }
+            else if (scale > 1)
+            {
+                scale /= 10;
+                fraction += (c - '0') * scale;
+            }
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    if (digits == 0)
+        return 0;
+
+    *value = sign * (whole * 1000000 + fraction);
+
+    return 1;
+}
+
+
+/**
+ * @brief   Makes sure the bearer of the HTTP client is open.
+ *
+ * A bearer known to be open is used as it is. Otherwise the module is asked first, the bearer may
+ * have been left open (e.g., by an earlier run of the application), and only a closed one is
+ * configured and opened.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t http_bearer(SIM800_Handle_t *handle)
+{
+    char arg[SIM800_SOCKET_HOST_MAX + 16];
+    SIM800_Status_t status;
+    uint8_t open = 0;
+
+    if (handle->http.bearer)
+    {
+        return SIM800_OK;
+    }
+
+    if ((status = execute_command(handle, SIM800_Cmd_BearerQuery, NULL, NULL, &open)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    if (!open)
+    {
+        strcpy(arg, "3,1,\"APN\",\"");
+        strcat(arg, handle->bearer.apn);
+        strcat(arg, "\"");
+
+        if ((status = execute_command(handle, SIM800_Cmd_Bearer, "3,1,\"CONTYPE\",\"GPRS\"", NULL, NULL)) != SIM800_OK ||
+            (status = execute_command(handle, SIM800_Cmd_Bearer, arg, NULL, NULL)) != SIM800_OK ||
+            (status = execute_command(handle, SIM800_Cmd_Bearer, "1,1", NULL, NULL)) != SIM800_OK)
+        {
+            return status;
+        }
+    }
+
+    handle->http.bearer = 1;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Performs an HTTP request and reads the body of its response.
+ *
+ * The HTTP service is started ("AT+HTTPINIT", a service left running is terminated first), the URL
+ * and the data are set, "AT+HTTPACTION" is sent and its result awaited, then the body is read in
+ * chunks (see http_exchange) and the service is terminated. A network error (status 6xx) marks the
+ * bearer as closed, so the next request checks it again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *url: URL.
+ * @param   *contentType: Content type of the data, NULL - the default of the module.
+ * @param   *data: Data to send, NULL - GET request.
+ * @param   length: Count of bytes to send.
+ * @param   *status: Pointer to store the HTTP status code.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t http_request(SIM800_Handle_t *handle, const char *url, const char *contentType,
+                                    const uint8_t *data, uint16_t length, uint16_t *status)
+{
+    SIM800_Status_t ret;
+    size_t len;
+
+    *status = 0;
+
+    if (handle->bearer.apn == NULL || url == NULL || (len = strlen(url)) == 0 || len > SIM800_HTTP_URL_MAX ||
+        (contentType != NULL && strlen(contentType) > SIM800_SOCKET_HOST_MAX))
+    {
+        return SIM800_ERROR;
+    }
+
+    if ((ret = http_bearer(handle)) != SIM800_OK)
+    {
+        return ret;
+    }
+
+    if (execute_command(handle, SIM800_Cmd_HttpInit, NULL, NULL, NULL) != SIM800_OK)
+    {
+        // A service left running by an interrupted request refuses to start again
+        execute_command(handle, SIM800_Cmd_HttpTerm, NULL, NULL, NULL);
+        if ((ret = execute_command(handle, SIM800_Cmd_HttpInit, NULL, NULL, NULL)) != SIM800_OK)
+        {
+            return ret;
+        }
+    }
+
+    ret = http_exchange(handle, url, contentType, data, length, status);
+
+    if (execute_command(handle, SIM800_Cmd_HttpTerm, NULL, NULL, NULL) != SIM800_OK && ret == SIM800_OK)
+    {
+        ret = SIM800_ERROR;
+    }
+
+    return ret;
+}
+
+
+/**
+ * @brief   Sets up and performs an HTTP request on a started HTTP service, see http_request.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *url: URL.
+ * @param   *contentType: Content type of the data, NULL - the default of the module.
+ * @param   *data: Data to send, NULL - GET request.
+ * @param   length: Count of bytes to send.
+ * @param   *status: Pointer to store the HTTP status code.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t http_exchange(SIM800_Handle_t *handle, const char *url, const char *contentType,
+                                     const uint8_t *data, uint16_t length, uint16_t *status)
+{
+    blocking_result_t result = { SIM800_ERROR, 0 };
+    SIM800_RequestOptions_t options;
+    SIM800_Request_t *req;
+    SIM800_Status_t ret;
+    char arg[SIM800_SOCKET_HOST_MAX + 16];
+    uint32_t offset = 0;
+    uint32_t count;
+    uint32_t tickStart;
+    uint8_t index;
+
+    if ((ret = execute_command(handle, SIM800_Cmd_HttpParam, "\"CID\",1", NULL, NULL)) != SIM800_OK ||
+        (ret = execute_command(handle, SIM800_Cmd_HttpURL, url, NULL, NULL)) != SIM800_OK)
+    {
+        return ret;
+    }
+
+    if (data != NULL)
+    {
+        if (contentType != NULL)
+        {
+            strcpy(arg, "\"CONTENT\",\"");
+            strcat(arg, contentType);
+            strcat(arg, "\"");
+            if ((ret = execute_command(handle, SIM800_Cmd_HttpParam, arg, NULL, NULL)) != SIM800_OK)
+            {
+                return ret;
+            }
+        }
+
+        // <size>,<time>, the module waits up to 10 s for the data
+        uint_to_str(length, arg);
+        strcat(arg, ",10000");
+
+        if ((req = claim_request(handle, SIM800_Cmd_HttpData, arg, (const char *)data, NULL, &blocking_done, &result,
+                                 take_options(handle, &options))) == NULL)
+        {
+            return SIM800_ERROR;
+        }
+        req->dataLength = length;
+        commit_request(handle);
+
+        if ((ret = wait_for_request(handle, &result)) != SIM800_OK)
+        {
+            return ret;
+        }
+    }
+
+    // The result is a notification that follows "OK" once the server has answered
+    if ((index = add_pending_message(handle, "+HTTPACTION", &httpaction_parser, NULL, NULL)) == 0xFF)
+    {
+        return SIM800_ERROR;
+    }
+    handle->http.done = 0;
+
+    if ((ret = execute_command(handle, SIM800_Cmd_HttpAction, data != NULL ? "1" : "0", NULL, NULL)) == SIM800_OK)
+    {
+        tickStart = HAL_GetTick();
+
+        while (!handle->http.done)
+        {
+            executor_poll(handle);
+
+            if (HAL_GetTick() - tickStart > SIM800_HTTP_TIMEOUT)
+            {
+                ret = SIM800_TIMEOUT;
+                break;
+            }
+
+            SIM800_OS_Wait(handle, SIM800_WAIT_SLICE);
+        }
+    }
+
+    remove_expected_code(handle, index);
+
+    if (ret != SIM800_OK)
+    {
+        return ret;
+    }
+
+    *status = handle->http.status;
+    if (handle->http.status >= 600)
+    {
+        handle->http.bearer = 0;
+    }
+
+    while (handle->http.body != NULL && offset < handle->http.length)
+    {
+        // <start>,<length>
+        count = handle->http.length - offset;
+        if (count > SIM800_HTTP_READ_CHUNK)
+        {
+            count = SIM800_HTTP_READ_CHUNK;
+        }
+        uint_to_str(offset, arg);
+        strcat(arg, ",");
+        uint_to_str(count, &arg[strlen(arg)]);
+
+        count = 0;
+        if ((ret = execute_command(handle, SIM800_Cmd_HttpRead, arg, NULL, &count)) != SIM800_OK || count == 0)
+        {
+            break;
+        }
+        offset += count;
+    }
+
+    return ret;
+}
+
+#endif /* SIM800_USE_HTTP */
+
+
+#if SIM800_USE_FS
+
+/**
+ * @brief   Parses the +FSFLSIZE response to extract the size of a file.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to a uint32_t to store the size.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK if the message is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t fsflsize_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +FSFLSIZE: <size>
+     */
+    line_field_t field;
+    int32_t size = -1;
+
+    line_fields(handle, line, &field);
+    line_numbers(handle, line, &field, &size, 1);
+
+    if (size < 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    *(uint32_t *)handle->expected_codes[index].response = size;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Checks that a file name fits into the commands of the file system.
+ *
+ * @param   *name: Name of the file.
+ * @retval  1 if the name is usable, 0 otherwise.
+ */
+static uint8_t fs_name_valid(const char *name)
+{
+    size_t len = strlen(name);
+
+    if (len == 0 || len > SIM800_FS_NAME_MAX)
+    {
+        return 0;
+    }
+
+    // The name is a field of the command line, it is not quoted
+    for (size_t i = 0; i < len; i++)
+    {
+        if (name[i] == '\\' || name[i] == ',' || name[i] == '"' || name[i] < ' ')
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+/**
+ * @brief   Finishes a write of a file and invokes the completion callback of the caller.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the write.
+ * @param   *ctx: Pointer to the file structure.
+ */
+static void fs_write_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_File_t *file = (SIM800_File_t *)ctx;
+
+    if (status == SIM800_OK)
+    {
+        file->size += file->length;
+    }
+    file->busy = 0;
+
+    if (file->done != NULL)
+    {
+        file->done(handle, status, file->ctx);
+    }
+}
+
+
+/**
+ * @brief   Starts the reading of the data of "AT+FSREAD".
+ *
+ * The response has no header line: the data follows the empty line that opens it. Once the command is
+ * sent, that empty line hands the announced count of bytes to SIM800_Process, which copies them into
+ * the buffer of the window, see socket_rx.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void fs_read_start(SIM800_Handle_t *handle)
+{
+    SIM800_Request_t *req = &handle->requests[handle->reqTail & (REQUEST_QUEUE_LENGTH - 1)];
+    fs_read_t *read = (fs_read_t *)req->response;
+
+    if (handle->reqTail == handle->reqHead || req->cmd != SIM800_Cmd_FSRead ||
+        req->state != SIM800_Request_WaitingResult || read->started || handle->rxRaw != 0)
+    {
+        return;
+    }
+
+    read->started = 1;
+    handle->rxRawBuffer = read->buffer;
+    handle->rxRaw = read->length;
+}
+
+#endif /* SIM800_USE_FS */
+
+
+/**
+ * @brief   Parses the response of "AT+CIPSHUT", which has no final result code.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: The index of the expected code, its response points to the bearer.
+ * @param   *line: Pointer to the response line.
+ * @retval  SIM800_OK.
+ */
+static SIM800_Status_t shut_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * SHUT OK
+     */
+    handle->expected_codes[index].result = SIM800_OK;
+    handle->expected_codes[index].state = SIM800_ReceivedStatus;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Parses the deactivation notification of the PDP context.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   index: Index of the +PDP expected code.
+ * @param   *line: Pointer to the notification line.
+ * @retval  SIM800_OK if the notification is successfully parsed, SIM800_ERROR if an error occurs.
+ */
+static SIM800_Status_t pdp_parser(SIM800_Handle_t *handle, uint8_t index, const SIM800_Line_t *line)
+{
+    /*
+     * +PDP: DEACT
+     */
+    SIM800_Line_t status = *line;
+
+    end_notification(handle, index);
+
+    status.start += 6;
+    status.length -= (line->length > 6) ? 6 : line->length;
+    if (!line_equals(handle, &status, "DEACT"))
+    {
+        return SIM800_ERROR;
+    }
+
+    handle->bearer.deacts++;
+    bearer_lost(handle);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Starts the bring-up of a wanted bearer once its backoff delay is over and advances it.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void bearer_poll(SIM800_Handle_t *handle)
+{
+    SIM800_Bearer_t *bearer = &handle->bearer;
+
+    if (!bearer->wanted || bearer->busy)
+    {
+        return;
+    }
+
+    if (bearer->state == SIM800_Bearer_Down && (int32_t)(HAL_GetTick() - bearer->retryTick) >= 0)
+    {
+        bearer->state = SIM800_Bearer_Connecting;
+        bearer->step = bearer->shut ? 0 : 1;
+    }
+
+    if (bearer->state == SIM800_Bearer_Connecting)
+    {
+        bearer_next(handle);
+    }
+}
+
+
+/**
+ * @brief   Submits the current step of the bring-up of the bearer.
+ *
+ * A step that can not be submitted (the queue is full or the transparent pipe is online) is submitted
+ * again by the next SIM800_Poll.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void bearer_next(SIM800_Handle_t *handle)
+{
+    SIM800_Bearer_t *bearer = &handle->bearer;
+    SIM800_Command_t cmd = bearer_steps[bearer->step];
+    void *response = NULL;
+
+    if (cmd == SIM800_Cmd_GPRSShut)
+    {
+        response = bearer;
+    }
+    else if (cmd == SIM800_Cmd_LocalIP)
+    {
+        response = handle->localIP;
+    }
+
+    if (submit_request(handle, cmd, cmd == SIM800_Cmd_GPRSAPN ? bearer->apn : NULL, NULL, response,
+                       &bearer_done, NULL, NULL) != NULL)
+    {
+        bearer->busy = 1;
+    }
+}
+
+
+/**
+ * @brief   Completion callback of a step of the bring-up of the bearer.
+ *
+ * A failed step ends the attempt: the bearer stays down for the backoff delay, which doubles with
+ * every failure in a row.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Not used.
+ */
+static void bearer_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_Bearer_t *bearer = &handle->bearer;
+    uint32_t delay = SIM800_BEARER_RETRY_MIN;
+
+    bearer->busy = 0;
+
+    if (bearer->state != SIM800_Bearer_Connecting)
+    {
+        return;
+    }
+
+    if (status != SIM800_OK)
+    {
+        bearer->failures++;
+        for (uint16_t i = 1; i < bearer->failures && delay < SIM800_BEARER_RETRY_MAX; i++)
+        {
+            delay <<= 1;
+        }
+
+        bearer->state = SIM800_Bearer_Down;
+        bearer->shut = 1;
+        bearer->retryTick = HAL_GetTick() + (delay < SIM800_BEARER_RETRY_MAX ? delay : SIM800_BEARER_RETRY_MAX);
+        post_event(handle, SIM800_Event_Bearer, SIM800_Bearer_Down, 0, 0);
+        return;
+    }
+
+    if (++bearer->step < sizeof(bearer_steps) / sizeof(bearer_steps[0]))
+    {
+        bearer_next(handle);
+        return;
+    }
+
+    bearer->state = SIM800_Bearer_Up;
+    bearer->shut = 0;
+    bearer->failures = 0;
+    post_event(handle, SIM800_Event_Bearer, SIM800_Bearer_Up, 0, 0);
+}
+
+
+/**
+ * @brief   Marks the bearer as down after a deactivation or a shut.
+ *
+ * The connections do not outlive the bearer: the sockets are marked as closed (SIM800_SocketCallBack is
+ * invoked with SIM800_SocketEvent_Closed) and the HTTP client checks its bearer again. A wanted bearer
+ * is brought up again after SIM800_BEARER_RETRY_MIN.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+static void bearer_lost(SIM800_Handle_t *handle)
+{
+    SIM800_Bearer_t *bearer = &handle->bearer;
+
+    for (uint8_t i = 0; i < SIM800_SOCKET_COUNT; i++)
+    {
+        if (handle->sockets[i].state != SIM800_Socket_Closed)
+        {
+            handle->sockets[i].state = SIM800_Socket_Closed;
+            post_event(handle, SIM800_Event_Socket, i, SIM800_SocketEvent_Closed, 0);
+        }
+    }
+
+#if SIM800_USE_HTTP
+    handle->http.bearer = 0;
+#endif
+    handle->localIP[0] = '\0';
+
+    if (bearer->state == SIM800_Bearer_Down)
+    {
+        return;
+    }
+
+    bearer->state = SIM800_Bearer_Down;
+    bearer->shut = 1;
+    bearer->retryTick = HAL_GetTick() + SIM800_BEARER_RETRY_MIN;
+    post_event(handle, SIM800_Event_Bearer, SIM800_Bearer_Down, 0, 0);
+}
+
+#endif /* SIM800_USE_GPRS */
+
+
+/*********************************************************************************************
+ *									OS abstraction functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Sleeps until the UART signals an event or the timeout elapses.
+ *
+ * This function is called by the blocking functions between two checks of the response.
+ * The default implementation sleeps until the next interrupt (the UART interrupts and the
+ * HAL tick wake the core). Override it in an RTOS build to block the calling task, e.g. on
+ * a semaphore or a task notification given by SIM800_OS_Signal:
+ *
+ *  void SIM800_OS_Wait(SIM800_Handle_t *handle, uint32_t timeout)
+ *  {
+ *      ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout));
+ *  }
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   timeout: Maximum time to sleep (ms).
+ */
+__weak void SIM800_OS_Wait(SIM800_Handle_t *handle, uint32_t timeout)
+{
+    __WFI();
+}
+
+
+/**
+ * @brief   Wakes the task sleeping in SIM800_OS_Wait.
+ *
+ * This function is called from the UART interrupt handlers when a line has been received
+ * or a transmission has finished. The default implementation does nothing, the core is woken
+ * by the interrupt itself. Override it in an RTOS build together with SIM800_OS_Wait:
+ *
+ *  void SIM800_OS_Signal(SIM800_Handle_t *handle)
+ *  {
+ *      BaseType_t woken = pdFALSE;
+ *      vTaskNotifyGiveFromISR(sim800_task, &woken);
+ *      portYIELD_FROM_ISR(woken);
+ *  }
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+__weak void SIM800_OS_Signal(SIM800_Handle_t *handle)
+{
+}
+
+
+/**
+ * @brief   Tells whether the calling task is the one driving the module.
+ *
+ * The blocking functions call SIM800_Poll only from this task; in any other task they submit their
+ * request and sleep in SIM800_OS_Wait (with the timeout, the signal goes to the driving task) until
+ * it is finished. The default implementation returns 1, a build without an RTOS has one task only.
+ * Override it when several tasks use the handle:
+ *
+ *  uint8_t SIM800_OS_IsExecutor(SIM800_Handle_t *handle)
+ *  {
+ *      return xTaskGetCurrentTaskHandle() == sim800_task;
+ *  }
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @retval  1 in the task calling SIM800_Poll, 0 otherwise.
+ */
+__weak uint8_t SIM800_OS_IsExecutor(SIM800_Handle_t *handle)
+{
+    return 1;
+}
+
+
+#if SIM800_USE_SLEEP
+
+/**
+ * @brief   Stops the MCU until an interrupt, see SIM800_EnterStop.
+ *
+ * The default implementation enters the STOP mode with the main regulator on, the shortest wake-up of the
+ * STOP modes, so the "\r\n" leading every notification covers it. The core runs from the HSI after the
+ * STOP mode: a board clocked from the PLL overrides this function and restores its clocks first thing, the UART
+ * receives at the wrong baud rate until then:
+ *
+ *  void SIM800_OS_Stop(SIM800_Handle_t *handle)
+ *  {
+ *      HAL_SuspendTick();
+ *      HAL_PWR_EnterSTOPMode(PWR_MAINREGULATOR_ON, PWR_STOPENTRY_WFI);
+ *      SystemClock_Config();
+ *      HAL_ResumeTick();
+ *  }
+ *
+ * It is called with the interrupts masked, the pending interrupt that ends the STOP mode runs once it returns.
+ * The EXTI interrupt of RI (see SIM800_RIHandler) must be enabled to wake the MCU for the module.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+__weak void SIM800_OS_Stop(SIM800_Handle_t *handle)
+{
+    HAL_SuspendTick();
+    HAL_PWR_EnterSTOPMode(PWR_MAINREGULATOR_ON, PWR_STOPENTRY_WFI);
+    HAL_ResumeTick();
+}
+
+#endif /* SIM800_USE_SLEEP */
+
+
+/*********************************************************************************************
+ *										Callback functions
+ ********************************************************************************************/
+
+/**
+ * @brief   User-defined callback for handling new SMS notifications.
+ *
+ * This function is called when a new SMS notification is received from the SIM800 module.
+ * You can override this function to define custom behavior when new SMS notifications arrive.
+ * It is called from SIM800_Poll after the notification has been parsed, so it may call blocking functions.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   sms_index: Index of the new SMS notification.
+ */
+__weak void SIM800_NewSMSNotificationCallBack(SIM800_Handle_t *handle, uint32_t sms_index)
+{
+    // Your custom code for handling new SMS notifications can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling received SMS messages.
+ *
+ * This function is called when a new SMS message is successfully received and parsed.
+ * You can override this function to define custom behavior for processing received SMS messages.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *message: Pointer to the parsed SMS message details.
+ */
+__weak void SIM800_RcvdSMSCallBack(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message)
+{
+    // Your custom code for handling received SMS messages can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling received long SMS messages.
+ *
+ * This function is called when all parts of a concatenated message are received in SMS PDU mode, see
+ * SIM800_SetSMSPDUMode. The parts are not passed to SIM800_RcvdSMSCallBack. The entry is reused once
+ * the function returns, copy the text if it is needed later.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *message: Pointer to the reassembled message.
+ */
+__weak void SIM800_RcvdLongSMSCallBack(SIM800_Handle_t *handle, SIM800_LongSMS_t *message)
+{
+    // Your custom code for handling received long SMS messages can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling network registration changes.
+ *
+ * This function is called when the network registration status reported by the SIM800 module changes,
+ * see SIM800_ManageRegNotifications. You can override this function to react to a lost or regained network.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: New network registration status.
+ */
+__weak void SIM800_NetworkRegCallBack(SIM800_Handle_t *handle, SIM800_NetworkRegStatus_t status)
+{
+    // Your custom code for handling network registration changes can be added here.
+}
+
+
+#if SIM800_USE_REG_CACHE
+/**
+ * @brief   User-defined callback for keeping the operator and the band of a registration.
+ *
+ * This function is called from SIM800_Poll when a registration is on another operator or band than the
+ * cached one. Store the value, and give it to SIM800_SetRegCache before SIM800_Init at the next start.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *cache: Operator and band of the registration.
+ */
+__weak void SIM800_RegCacheCallBack(SIM800_Handle_t *handle, const SIM800_RegCache_t *cache)
+{
+    // Your custom code for storing the operator and the band can be added here.
+}
+#endif
+
+
+/**
+ * @brief   User-defined callback for handling the network time.
+ *
+ * This function is called whenever the time is received from the network, see SIM800_ManageNetworkTime.
+ * You can override this function to set the RTC of the MCU (HAL_RTC_SetTime and HAL_RTC_SetDate), later
+ * timestamps are then read from the RTC or by SIM800_GetTime.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *time: Local time of the network.
+ */
+__weak void SIM800_NetworkTimeCallBack(SIM800_Handle_t *handle, const SIM800_Time_t *time)
+{
+    // Your custom code for handling the network time can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling an unexpected reset of the module.
+ *
+ * This function is called when the module reports "RDY" after it has already been running (e.g., after a
+ * brown-out). The settings of the module are lost, you can override this function to run SIM800_Init again:
+ * it is called from SIM800_Poll after the line dispatch, so it may call blocking functions.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+__weak void SIM800_ResetCallBack(SIM800_Handle_t *handle)
+{
+    // Your custom code for handling module resets can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling an incoming voice call.
+ *
+ * This function is called once per call, when its caller is reported by the first +CLIP (see SIM800_ManageCalls).
+ * It is called from SIM800_Poll after the line dispatch, so it may call blocking functions, e.g. SIM800_HangUp.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *caller: Caller of the call, valid during the call of the callback.
+ */
+__weak void SIM800_IncomingCallCallBack(SIM800_Handle_t *handle, const SIM800_Caller_t *caller)
+{
+    // Your custom code for handling incoming calls can be added here.
+}
+
+
+#if SIM800_USE_GNSS
+
+/**
+ * @brief   User-defined callback for handling a position of the GNSS stream.
+ *
+ * This function is called from SIM800_Poll for every "+UGNSINF" report, see SIM800_ManageGNSSStream.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *fix: Position, fix->fix is 0 while the receiver has no fix yet.
+ */
+__weak void SIM800_GNSSCallBack(SIM800_Handle_t *handle, const SIM800_GNSSFix_t *fix)
+{
+    // Your custom code for handling the positions can be added here.
+}
+
+#endif
+
+
+/**
+ * @brief   User-defined callback for power-cycling a module that does not answer.
+ *
+ * This function is called by the watchdog (see SIM800_ManageWatchdog) when "AT+CFUN=1,1" did not restart the
+ * module. Override it to pulse the PWRKEY line (about 1.5 s) or the reset line of the module; it is called from
+ * SIM800_Poll, the restart time of the watchdog starts once it returns.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+__weak void SIM800_PowerCycleCallBack(SIM800_Handle_t *handle)
+{
+    // Your custom code for toggling the power key or the reset line can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling a change of the state of the watchdog.
+ *
+ * This function is called from SIM800_Poll whenever the watchdog changes its state (see SIM800_ManageWatchdog),
+ * SIM800_Watchdog_Healthy after SIM800_Watchdog_Restoring means the module is configured again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   state: New state of the watchdog.
+ */
+__weak void SIM800_WatchdogCallBack(SIM800_Handle_t *handle, SIM800_WatchdogState_t state)
+{
+    // Your custom code for handling the state of the watchdog can be added here.
+}
+
+
+#if SIM800_USE_ISR_BUDGET
+
+/**
+ * @brief   User-defined callback for handling an interrupt handler run over its budget.
+ *
+ * This function is called from the interrupt, right after the handler that has exceeded the budget set by
+ * SIM800_SetISRBudget, so keep it short (e.g. record the duration or set a flag).
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   duration: Duration of the run (ns).
+ */
+__weak void SIM800_ISRBudgetCallBack(SIM800_Handle_t *handle, uint32_t duration)
+{
+    // Your custom code for handling an interrupt over its budget can be added here.
+}
+
+#endif /* SIM800_USE_ISR_BUDGET */
+
+
+/**
+ * @brief   User-defined callback for handling an almost full SMS storage.
+ *
+ * This function is called when fewer than SIM800_SMS_LOW_SPACE storage slots are free. Once the storage is
+ * full, no more +CMTI notifications arrive, you can override this function to read or delete messages.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *storage: Pointer to the occupancy of the storage.
+ */
+__weak void SIM800_SMSStorageLowCallBack(SIM800_Handle_t *handle, SIM800_SMSStorage_t *storage)
+{
+    // Your custom code for handling a full SMS storage can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling SMS delivery reports.
+ *
+ * This function is called when the final delivery report of a sent message is received, see
+ * SIM800_ManageDeliveryReports. You can override this function to confirm or retry the message.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   reference: Message reference returned by SIM800_SendSMSMessageRef.
+ * @param   status: Status of the report, 0..31 - delivered, 64 and above - delivery failed.
+ * @param   latency: Time from the submission of the message to its report (ms), 0 if the message is not tracked.
+ */
+__weak void SIM800_SMSDeliveryCallBack(SIM800_Handle_t *handle, uint8_t reference, uint8_t status, uint32_t latency)
+{
+    // Your custom code for handling delivery reports can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling the data received by the transparent data pipe.
+ *
+ * This function is called from SIM800_Process with the received bytes straight from the receive ring,
+ * see SIM800_TransparentOpen. The bytes are only valid during the call and the ring space is released
+ * when it returns, so consume or copy them quickly or enable RTS/CTS flow control.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Received bytes.
+ * @param   length: Count of received bytes.
+ */
+__weak void SIM800_TransparentRxCallBack(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length)
+{
+    // Your custom code for handling the received data can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling the end of the connection of the transparent data pipe.
+ *
+ * This function is called when the carrier is lost in data mode (see SIM800_DCDHandler) or the module
+ * reports "CLOSED" while the connection is suspended. The pipe is idle afterwards, it can be opened again.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ */
+__weak void SIM800_TransparentClosedCallBack(SIM800_Handle_t *handle)
+{
+    // Your custom code for handling the end of the connection can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling socket events.
+ *
+ * This function is called from SIM800_Poll when a connection is established, fails, is closed by
+ * the remote side or receives data, see SIM800_SocketInit. The event is posted by the parser and delivered
+ * after the line dispatch, so it may call blocking functions; read the received data with SIM800_SocketRecv.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   socket: Socket number.
+ * @param   event: Event of the socket.
+ */
+__weak void SIM800_SocketCallBack(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketEvent_t event)
+{
+    // Your custom code for handling socket events can be added here.
+}
+
+
+/**
+ * @brief   User-defined callback for handling the changes of the GPRS bearer.
+ *
+ * This function is called from SIM800_Poll when the bearer comes up or goes down (a failed bring-up or
+ * "+PDP: DEACT"), see SIM800_BearerUp. It may call blocking functions, see SIM800_EventQueue_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   state: New state of the bearer.
+ */
+__weak void SIM800_BearerCallBack(SIM800_Handle_t *handle, SIM800_BearerState_t state)
+{
+    // Your custom code for handling bearer changes can be added here.
 }
@@ -9,24 +9,167 @@
 #define INC_SIM800_H_
 
 #include "main.h"
+#include "sim800_config.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 
-#define SIM800_MAX_DELAY						32000
 
-#define CODE_MAX_LENGTH							10
+/*
+ * Table of the supported AT commands.
+ *
+ * X(name, command, suffix, code, timeout, parser)
+ *  name    - command identifier, expands to SIM800_Cmd_<name>
+ *  command - command text sent before the argument
+ *  suffix  - text sent after the argument, before "\r\n"
+ *  code    - expected response code, "" if the command answers only with a result code
+ *  timeout - maximum response time (ms), taken from the SIM800 AT command manual; commands without a
+ *            specified maximum answer within SIM800_TIMEOUT_SHORT
+ *  parser  - response parser (see sim800.c), NULL if the response carries no data
+ *
+ * Every command is executed by one shared executor, the strings are kept once in flash. The commands
+ * of an optional feature are in a table of their own, which is empty when the feature is disabled
+ * (see sim800_config.h).
+ */
+#define SIM800_COMMANDS(X) \
+    SIM800_COMMANDS_CORE(X) \
+    SIM800_COMMANDS_SMS(X)  \
+    SIM800_COMMANDS_PDU(X)  \
+    SIM800_COMMANDS_GPRS(X) \
+    SIM800_COMMANDS_HTTP(X) \
+    SIM800_COMMANDS_SLEEP(X) \
+    SIM800_COMMANDS_PHONEBOOK(X) \
+    SIM800_COMMANDS_GNSS(X) \
+    SIM800_COMMANDS_FS(X) \
+    SIM800_COMMANDS_REG_CACHE(X)
+
+#define SIM800_COMMANDS_CORE(X) \
+    X(Status,        "AT",          "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(BatteryInfo,   "AT+CBC",      "",   "+CBC",  SIM800_TIMEOUT_SHORT, cbc_parser)   \
+    X(NetworkReg,    "AT+CREG?",    "",   "+CREG", SIM800_TIMEOUT_SHORT, creg_parser)  \
+    X(SetBaud,       "AT+IPR=",     "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(FlowControl,   "AT+IFC=",     "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(RegNotify,     "AT+CREG=",    "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SignalQuality, "AT+CSQ",      "",   "+CSQ",  SIM800_TIMEOUT_SHORT, csq_parser)   \
+    X(IMEI,          "AT+GSN",      "",   "",      SIM800_TIMEOUT_SHORT, id_parser)    \
+    X(ICCID,         "AT+CCID",     "",   "",      2000,                 id_parser)    \
+    X(EchoOff,       "ATE0",        "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(Configure,     "AT",          "",   "",      5000,                 NULL)         \
+    X(SIMStatus,     "AT+CPIN?",    "",   "+CPIN", 5000,                 cpin_parser)  \
+    X(Charset,       "AT+CSCS=\"",  "\"", "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(Mux,           "AT+CMUX=0",   "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(Reboot,        "AT+CFUN=1,1", "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(NetworkTime,   "AT+CLTS=",    "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(Clock,         "AT+CCLK?",    "",   "+CCLK", SIM800_TIMEOUT_SHORT, cclk_parser)  \
+    X(CellInfo,      "AT+CENG=3;+CENG?", "", "+CENG", 5000,             ceng_parser)  \
+    X(CallerID,      "AT+CLIP=",    "",   "",      15000,                NULL)         \
+    X(HangUp,        "ATH",         "",   "",      20000,                NULL)         \
+    X(USSD,          "AT+CUSD=1,\"", "\"", "",     SIM800_USSD_TIMEOUT,  NULL)         \
+    X(ProfileMarker, "AT+SAPBR=4,", "",   "APN",   SIM800_TIMEOUT_SHORT, marker_parser)
+
+#if SIM800_USE_SMS
+#define SIM800_COMMANDS_SMS(X) \
+    X(SMSTextMode,   "AT+CMGF=1",   "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(DeleteAllSMS,  "AT+CMGD=1,4", "",   "",      25000,                NULL)         \
+    X(SendSMS,       "AT+CMGS=\"",  "\"", "+CMGS", 60000,                cmgs_parser)  \
+    X(ReadSMS,       "AT+CMGR=",    "",   "+CMGR", 5000,                 cmgr_parser)  \
+    X(ListSMS,       "AT+CMGL=",    "",   "+CMGL", 20000,                cmgl_parser)  \
+    X(SMSIndication, "AT+CNMI=",    "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SMSStorage,    "AT+CPMS?",    "",   "+CPMS", 5000,                 cpms_parser)  \
+    X(SMSParams,     "AT+CSMP=",    "",   "",      SIM800_TIMEOUT_SHORT, NULL)
+#else
+#define SIM800_COMMANDS_SMS(X)
+#endif
+
+#if SIM800_USE_PDU
+#define SIM800_COMMANDS_PDU(X) \
+    X(SMSPDUMode,    "AT+CMGF=0",   "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SendPDU,       "AT+CMGS=",    "",   "+CMGS", 60000,                cmgs_parser)
+#else
+#define SIM800_COMMANDS_PDU(X)
+#endif
+
+#if SIM800_USE_GPRS
+#define SIM800_COMMANDS_GPRS(X) \
+    X(SocketMux,     "AT+CIPMUX=",  "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SocketMode,    "AT+CIPMODE=", "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(CarrierDetect, "AT&C1",       "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(DataResume,    "ATO",         "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SocketRxGet,   "AT+CIPRXGET=", "",  "+CIPRXGET", SIM800_TIMEOUT_SHORT, ciprxget_parser) \
+    X(GPRSShut,      "AT+CIPSHUT",  "",   "SHUT OK", 65000,              shut_parser)  \
+    X(GPRSAttach,    "AT+CGATT=1",  "",   "",      10000,                NULL)         \
+    X(GPRSAPN,       "AT+CSTT=\"",  "\"", "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(GPRSUp,        "AT+CIICR",    "",   "",      85000,                NULL)         \
+    X(LocalIP,       "AT+CIFSR",    "",   "",      SIM800_TIMEOUT_SHORT, ip_parser)    \
+    X(DNSLookup,     "AT+CDNSGIP=\"", "\"", "",   SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SocketOpen,    "AT+CIPSTART=", "",  "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(SocketSend,    "AT+CIPSEND=", "",   "",      20000,                NULL)         \
+    X(SocketClose,   "AT+CIPCLOSE=", "",  "",      5000,                 NULL)
+#else
+#define SIM800_COMMANDS_GPRS(X)
+#endif
 
-#define RECEIVE_DATA_MAX_LENGTH					100
+#if SIM800_USE_HTTP
+#define SIM800_COMMANDS_HTTP(X) \
+    X(Bearer,        "AT+SAPBR=",   "",   "",      85000,                NULL)         \
+    X(BearerQuery,   "AT+SAPBR=2,1", "",  "+SAPBR", SIM800_TIMEOUT_SHORT, sapbr_parser) \
+    X(HttpInit,      "AT+HTTPINIT", "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(HttpTerm,      "AT+HTTPTERM", "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(HttpParam,     "AT+HTTPPARA=", "",  "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(HttpURL,       "AT+HTTPPARA=\"URL\",\"", "\"", "", SIM800_TIMEOUT_SHORT, NULL)   \
+    X(HttpData,      "AT+HTTPDATA=", "",  "",      20000,                NULL)         \
+    X(HttpAction,    "AT+HTTPACTION=", "", "",     SIM800_TIMEOUT_SHORT, NULL)         \
+    X(HttpRead,      "AT+HTTPREAD=", "",  "+HTTPREAD", 5000,             httpread_parser) \
+    X(Location,      "AT+CLBS=1,1", "",   "+CLBS", 60000,                clbs_parser)
+#else
+#define SIM800_COMMANDS_HTTP(X)
+#endif
 
-#define RX_BUFFER_LENGTH						100
+#if SIM800_USE_SLEEP
+#define SIM800_COMMANDS_SLEEP(X) \
+    X(SlowClock,     "AT+CSCLK=",   "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(RingConfig,    "AT+CFGRI=",   "",   "",      SIM800_TIMEOUT_SHORT, NULL)
+#else
+#define SIM800_COMMANDS_SLEEP(X)
+#endif
 
-#define EXPECTED_CODES_MAX_COUNT				10
+#if SIM800_USE_PHONEBOOK
+#define SIM800_COMMANDS_PHONEBOOK(X) \
+    X(PhonebookSize, "AT+CPBR=?",   "",   "+CPBR", SIM800_TIMEOUT_SHORT, cpbr_size_parser) \
+    X(PhonebookRead, "AT+CPBR=",    "",   "+CPBR", 30000,                cpbr_parser)
+#else
+#define SIM800_COMMANDS_PHONEBOOK(X)
+#endif
 
-#define SMS_SENDER_MAX_LEN						20
-#define SMS_TEXT_MAX_LEN						100
-#define SMS_TX_MAX_LEN							100
+#if SIM800_USE_GNSS
+#define SIM800_COMMANDS_GNSS(X) \
+    X(GNSSPower,     "AT+CGNSPWR=", "",   "",      SIM800_TIMEOUT_SHORT, NULL)         \
+    X(GNSSReport,    "AT+CGNSURC=", "",   "",      SIM800_TIMEOUT_SHORT, NULL)
+#else
+#define SIM800_COMMANDS_GNSS(X)
+#endif
 
-extern UART_HandleTypeDef *sim800_uart;
-#define SIM800_UART								sim800_uart
+#if SIM800_USE_FS
+#define SIM800_COMMANDS_FS(X) \
+    X(FSCreate,      "AT+FSCREATE=C:\\User\\", "", "", SIM800_TIMEOUT_SHORT, NULL)     \
+    X(FSWrite,       "AT+FSWRITE=C:\\User\\", "", "",  10000,                NULL)     \
+    X(FSRead,        "AT+FSREAD=C:\\User\\", "", "",   10000,                NULL)     \
+    X(FSSize,        "AT+FSFLSIZE=C:\\User\\", "", "+FSFLSIZE", SIM800_TIMEOUT_SHORT, fsflsize_parser) \
+    X(FSDelete,      "AT+FSDEL=C:\\User\\", "", "",    SIM800_TIMEOUT_SHORT, NULL)
+#else
+#define SIM800_COMMANDS_FS(X)
+#endif
+
+#if SIM800_USE_REG_CACHE
+#define SIM800_COMMANDS_REG_CACHE(X) \
+    X(Operator,      "AT+COPS=3,2;+COPS?", "", "+COPS", SIM800_TIMEOUT_SHORT, cops_parser) \
+    X(Band,          "AT+CBAND?",   "",   "+CBAND", SIM800_TIMEOUT_SHORT, cband_parser) \
+    X(SelectOperator, "AT+COPS=4,2,\"", "\"", "", 120000,               NULL)         \
+    X(SelectBand,    "AT+CBAND=\"", "\"", "",     SIM800_TIMEOUT_SHORT, NULL)
+#else
+#define SIM800_COMMANDS_REG_CACHE(X)
+#endif
 
 
 /**
@@ -40,6 +183,92 @@ typedef enum
 } SIM800_Status_t;
 
 
+/**
+ * @brief   Enumeration of the final result codes, see SIM800_Error_t.
+ */
+typedef enum
+{
+    SIM800_Error_None,                          /*!< "OK". */
+    SIM800_Error_Generic,                       /*!< "ERROR", no cause is reported. */
+    SIM800_Error_CME,                           /*!< "+CME ERROR: <n>", equipment, SIM card or network error. */
+    SIM800_Error_CMS,                           /*!< "+CMS ERROR: <n>", SMS service error. */
+} SIM800_ErrorType_t;
+
+
+/**
+ * @brief   Enumeration of frequent causes of "+CME ERROR" (3GPP TS 27.007).
+ */
+typedef enum
+{
+    SIM800_CME_NotAllowed           = 3,        /*!< Operation not allowed. */
+    SIM800_CME_NotSupported         = 4,        /*!< Operation not supported. */
+    SIM800_CME_SIMNotInserted       = 10,       /*!< SIM card not inserted. */
+    SIM800_CME_SIMPINRequired       = 11,       /*!< SIM PIN required. */
+    SIM800_CME_SIMPUKRequired       = 12,       /*!< SIM PUK required. */
+    SIM800_CME_SIMFailure           = 13,       /*!< SIM card failure. */
+    SIM800_CME_SIMBusy              = 14,       /*!< SIM card busy. */
+    SIM800_CME_IncorrectPassword    = 16,       /*!< Incorrect password. */
+    SIM800_CME_MemoryFull           = 20,       /*!< Memory full. */
+    SIM800_CME_InvalidIndex         = 21,       /*!< Invalid index. */
+    SIM800_CME_NotFound             = 22,       /*!< Not found. */
+    SIM800_CME_NoNetwork            = 30,       /*!< No network service. */
+    SIM800_CME_NetworkTimeout       = 31,       /*!< Network timeout. */
+    SIM800_CME_Unknown              = 100,      /*!< Unknown error. */
+} SIM800_CMECause_t;
+
+
+/**
+ * @brief   Enumeration of frequent causes of "+CMS ERROR" (3GPP TS 27.005).
+ */
+typedef enum
+{
+    SIM800_CMS_NetworkOutOfOrder    = 38,       /*!< Network out of order. */
+    SIM800_CMS_TemporaryFailure     = 41,       /*!< Temporary network failure. */
+    SIM800_CMS_Congestion           = 42,       /*!< Network congestion. */
+    SIM800_CMS_ResourcesUnavailable = 47,       /*!< Network resources unavailable. */
+    SIM800_CMS_MEFailure            = 300,      /*!< Phone failure. */
+    SIM800_CMS_NotAllowed           = 302,      /*!< Operation not allowed. */
+    SIM800_CMS_InvalidPDUParameter  = 304,      /*!< Invalid PDU mode parameter. */
+    SIM800_CMS_InvalidTextParameter = 305,      /*!< Invalid text mode parameter. */
+    SIM800_CMS_SIMNotInserted       = 310,      /*!< SIM card not inserted. */
+    SIM800_CMS_SIMPINRequired       = 311,      /*!< SIM PIN required. */
+    SIM800_CMS_SIMFailure           = 313,      /*!< SIM card failure. */
+    SIM800_CMS_SIMBusy              = 314,      /*!< SIM card busy. */
+    SIM800_CMS_MemoryFailure        = 320,      /*!< Memory failure. */
+    SIM800_CMS_InvalidIndex         = 321,      /*!< Invalid memory index. */
+    SIM800_CMS_MemoryFull           = 322,      /*!< Memory full. */
+    SIM800_CMS_SMSCUnknown          = 330,      /*!< Service centre address unknown. */
+    SIM800_CMS_NoNetwork            = 331,      /*!< No network service. */
+    SIM800_CMS_NetworkTimeout       = 332,      /*!< Network timeout. */
+    SIM800_CMS_Unknown              = 500,      /*!< Unknown error. */
+} SIM800_CMSCause_t;
+
+
+/**
+ * @brief   Structure representing the final result code of the last finished command.
+ *
+ * The cause is numeric only in the numeric error mode ("AT+CMEE=1", the default of SIM800_Init),
+ * verbose causes ("AT+CMEE=2") are stored as 0.
+ */
+typedef struct
+{
+    SIM800_ErrorType_t type;                    /*!< Kind of the final result code. */
+    uint16_t cause;                             /*!< Cause of "+CME ERROR" or "+CMS ERROR", see SIM800_CMECause_t and SIM800_CMSCause_t. */
+} SIM800_Error_t;
+
+
+/**
+ * @brief   Enumeration of supported AT commands, generated from SIM800_COMMANDS.
+ */
+typedef enum
+{
+#define SIM800_COMMAND_ID(name, command, suffix, code, timeout, parser)		SIM800_Cmd_##name,
+    SIM800_COMMANDS(SIM800_COMMAND_ID)
+#undef SIM800_COMMAND_ID
+    SIM800_Cmd_Count,
+} SIM800_Command_t;
+
+
 /**
  * @brief   Enumeration of expected message code states.
  */
@@ -65,6 +294,60 @@ typedef enum
 } SIM800_ReceivingStatus_t;
 
 
+/**
+ * @brief   Enumeration of data prompt states.
+ *
+ * Commands followed by a data block (e.g., AT+CMGS) answer with the "> " prompt, which is not terminated
+ * by a newline. It is recognised by SIM800_Process only while a prompt is awaited.
+ */
+typedef enum
+{
+    SIM800_Prompt_None,  						/*!< No prompt is awaited. */
+    SIM800_Prompt_Waiting,  					/*!< Awaiting the prompt. */
+    SIM800_Prompt_Received,  					/*!< Prompt received, the data block can be sent. */
+} SIM800_PromptState_t;
+
+
+/**
+ * @brief   Enumeration of request states, see SIM800_Poll.
+ */
+typedef enum
+{
+    SIM800_Request_Queued,  					/*!< Submitted, the command is not sent yet. */
+    SIM800_Request_WaitingPrompt,  				/*!< Command sent, awaiting the "> " data prompt. */
+    SIM800_Request_WaitingResult,  				/*!< Command sent, awaiting the final result code. */
+} SIM800_RequestState_t;
+
+
+/**
+ * @brief   Enumeration of receiving modes.
+ *
+ * SIM800_RxMode_IT arms a one-byte interrupt reception for every received character.
+ * SIM800_RxMode_DMA uses the receive ring as a circular DMA buffer together with the UART
+ * IDLE-line event, so the CPU is woken once per burst (or per half buffer) instead of once per byte.
+ * The DMA mode requires the UART RX DMA stream to be configured in circular mode.
+ */
+typedef enum
+{
+    SIM800_RxMode_IT,  							/*!< One-byte interrupt reception (default). */
+    SIM800_RxMode_DMA,  						/*!< Circular DMA reception with idle-line detection. */
+} SIM800_RxMode_t;
+
+
+/**
+ * @brief   Enumeration of transmitting modes.
+ *
+ * Both modes send the queued blocks one after another, the next block is started from the
+ * TX-complete interrupt (see SIM800_TxCpltHandler). SIM800_TxMode_DMA moves the bytes by DMA
+ * and requires the UART TX DMA stream to be configured in normal mode.
+ */
+typedef enum
+{
+    SIM800_TxMode_IT,  							/*!< Interrupt driven transmission (default). */
+    SIM800_TxMode_DMA,  						/*!< DMA transmission. */
+} SIM800_TxMode_t;
+
+
 /**
  * @brief   Enumeration of network registration statuses.
  *
@@ -83,93 +366,1843 @@ typedef enum
 
 
 /**
- * @brief   Structure representing a expected message codes.
+ * @brief   Bits of the boot state of the module, set by the power-on notifications.
+ */
+typedef enum
+{
+    SIM800_Boot_Ready       = 0x01,             /*!< "RDY": the module has started. */
+    SIM800_Boot_FullFunc    = 0x02,             /*!< "+CFUN: 1": full functionality. */
+    SIM800_Boot_SIMReady    = 0x04,             /*!< "+CPIN: READY": the SIM card is ready. */
+    SIM800_Boot_CallReady   = 0x08,             /*!< "Call Ready": calls can be made. */
+    SIM800_Boot_SMSReady    = 0x10,             /*!< "SMS Ready": SMS messages can be sent and received. */
+    SIM800_Boot_Configured  = 0x80,             /*!< The module has been configured by SIM800_Init. */
+} SIM800_BootState_t;
+
+
+/**
+ * @brief   Structure representing battery charge information.
+ *
+ * This structure represents battery charge information, including charge status, connection level, and battery voltage.
  */
 typedef struct
 {
-    char code[CODE_MAX_LENGTH];                 /*!< Message code. */
-    size_t code_length;                       	/*!< Length of the message code. */
-    char data[RECEIVE_DATA_MAX_LENGTH];         /*!< Message data. */
-    SIM800_ExpectedCodeState_t state;         /*!< Message state. */
-    void (*handle)(void *, uint32_t);           /*!< Message handler function. */
-} SIM800_ExpectedCode_t;
+    uint8_t charge_status;     						/*!< Charge status: 0 - Not charging, 1 - Charging, 2 - Charging has finished. */
+    uint8_t conection_level;   						/*!< Battery connection level. */
+    uint16_t battery_level;    						/*!< Battery voltage (mV). */
+} SIM800_Battery_t;
 
 
 /**
- * @brief   Structure representing the SIM800 module handle.
+ * @brief   Structure representing the signal quality reported by "AT+CSQ".
  */
 typedef struct
 {
-    char rxBuffer[RX_BUFFER_LENGTH];             /*!< Receive buffer. */
-    uint32_t rxCounter;                          /*!< Receive counter. */
-    char rcvdByte;                               /*!< Received byte. */
+    uint8_t rssi;                                   /*!< Signal strength: 0 - -115 dBm or less, 31 - -52 dBm or more, 99 - unknown. */
+    uint8_t ber;                                    /*!< Bit error rate: 0...7, 99 - unknown. */
+} SIM800_Signal_t;
 
-    SIM800_ExpectedCode_t expected_codes[EXPECTED_CODES_MAX_COUNT];  /*!< Array of expected codes and messages. */
 
-    size_t expected_codes_count;                  /*!< Count of expected codes. */
-    uint32_t curProccesPacket_index;              /*!< Index of the current processing packet. */
-    SIM800_ReceivingStatus_t recStatus;           /*!< Receiving status. */
-} SIM800_Handle_t;
+/**
+ * @brief   Structure representing a cell reported by the engineering mode ("AT+CENG=3").
+ */
+typedef struct
+{
+    uint16_t mcc;                                   /*!< Mobile country code. */
+    uint16_t mnc;                                   /*!< Mobile network code. */
+    uint16_t lac;                                   /*!< Location area code. */
+    uint16_t cellId;                                /*!< Cell ID, 0 - no cell. */
+    uint8_t bsic;                                   /*!< Base station identity code. */
+    uint8_t rxl;                                    /*!< Receive level: 0 - -110 dBm or less, 63 - -48 dBm or more. */
+} SIM800_Cell_t;
 
 
 /**
- * @brief   Structure representing battery charge information.
+ * @brief   Structure representing the serving and the neighbour cells, see SIM800_GetCellInfo.
+ */
+typedef struct
+{
+    SIM800_Cell_t cells[SIM800_CELL_COUNT];         /*!< Serving cell first, then the neighbour cells. */
+    uint8_t count;                                  /*!< Count of cells. */
+} SIM800_CellInfo_t;
+
+
+/**
+ * @brief   Structure representing the location of the module reported by "AT+CLBS", see SIM800_GetLocation.
+ */
+typedef struct
+{
+    int32_t longitude;                              /*!< Longitude (millionths of a degree, east positive). */
+    int32_t latitude;                               /*!< Latitude (millionths of a degree, north positive). */
+    uint16_t accuracy;                              /*!< Accuracy (m). */
+} SIM800_Location_t;
+
+
+/**
+ * @brief   Structure representing the statistics of the signal samples, see SIM800_GetSignalStats.
  *
- * This structure represents battery charge information, including charge status, connection level, and battery voltage.
+ * Samples with an unknown signal strength (99) are only counted in unknown.
  */
 typedef struct
 {
-    uint8_t charge_status;     						/*!< Charge status: 0 - Not charging, 1 - Charging, 2 - Charging has finished. */
-    uint8_t conection_level;   						/*!< Battery connection level. */
-    uint16_t battery_level;    						/*!< Battery voltage (mV). */
-} SIM800_Battery_t;
+    uint8_t count;                                  /*!< Count of samples in the window. */
+    uint8_t unknown;                                /*!< Count of samples without a signal strength. */
+    uint8_t rssiMin;                                /*!< Lowest signal strength, 99 if all samples are unknown. */
+    uint8_t rssiMean;                               /*!< Mean signal strength, 99 if all samples are unknown. */
+    uint8_t rssiMax;                                /*!< Highest signal strength, 99 if all samples are unknown. */
+    uint8_t berMax;                                 /*!< Highest bit error rate, 99 if unknown in all samples. */
+} SIM800_SignalStats_t;
 
 
 /**
- * @brief   Structure representing SMS message information.
+ * @brief   Structure representing the background sampler of the signal quality, see SIM800_ManageSignalSampling.
+ */
+typedef struct
+{
+    SIM800_Signal_t samples[SIM800_SIGNAL_SAMPLES]; /*!< Ring of the latest samples. */
+    uint32_t head;                                  /*!< Free-running index of the next sample. */
+    uint32_t period;                                /*!< Sampling period (ms), 0 - sampling disabled. */
+    uint32_t tick;                                  /*!< Tick of the last sample. */
+    uint8_t pending;                                /*!< 1 while a sample is submitted. */
+    SIM800_Signal_t sample;                         /*!< Sample being read. */
+} SIM800_SignalSampler_t;
+
+
+/**
+ * @brief   Structure representing the clock kept from the network time, see SIM800_ManageNetworkTime.
  *
- * This structure represents SMS message information, including sender phone number, and text of this message.
+ * The time is kept as seconds since 2000-01-01 00:00 UTC at a tick, so reading it is a local computation.
  */
 typedef struct
 {
-    char sender[SMS_SENDER_MAX_LEN];
-    char text[SMS_TEXT_MAX_LEN];
-} SIM800_SMSMessage_t;
+    uint8_t zoneCode;                               /*!< Index + 1 of the *PSUTTZ expected code, 0 - synchronisation disabled. */
+    uint8_t dstCode;                                /*!< Index + 1 of the DST expected code. */
+    uint8_t valid;                                  /*!< 1 once the time has been received. */
+    uint8_t dst;                                    /*!< Daylight saving adjustment reported by the network (hours). */
+    int8_t zone;                                    /*!< Offset of the local time from UTC in quarters of an hour. */
+    uint32_t seconds;                               /*!< Seconds since 2000-01-01 00:00 UTC at tick. */
+    uint32_t tick;                                  /*!< Tick of seconds. */
+} SIM800_NetworkTime_t;
 
 
+/**
+ * @brief   Enumeration of the handling of the incoming voice calls, see SIM800_ManageCalls.
+ */
+typedef enum
+{
+    SIM800_Calls_Off,                           /*!< The calls are not reported ("AT+CLIP=0"). */
+    SIM800_Calls_Notify,                        /*!< SIM800_IncomingCallCallBack is invoked, the call keeps ringing. */
+    SIM800_Calls_Reject,                        /*!< SIM800_IncomingCallCallBack is invoked and the call is rejected at once ("ATH"). */
+} SIM800_CallMode_t;
 
 
-/*********************************************************************************************
- *								Supported user functions
- ********************************************************************************************/
+/**
+ * @brief   Structure representing the caller of an incoming voice call ("+CLIP").
+ */
+typedef struct
+{
+    char number[SIM800_CALLER_LENGTH];          /*!< Phone number of the caller, empty if it is not available. */
+    uint8_t type;                               /*!< Type of the number: 145 - international, 129 - national. */
+    uint8_t validity;                           /*!< 0 - valid, 1 - withheld by the caller, 2 - not available. */
+} SIM800_Caller_t;
 
-SIM800_Status_t SIM800_ManageReceiving				(SIM800_Handle_t *handle, uint8_t enordi);
-SIM800_Status_t SIM800_GetBatteryInfo				(SIM800_Handle_t *handle, SIM800_Battery_t *battery);
-SIM800_Status_t SIM800_GetStatus					(SIM800_Handle_t *handle);
 
-SIM800_NetworkRegStatus_t SIM800_GetNetworkRegStatus(SIM800_Handle_t *handle);
+/**
+ * @brief   Structure representing the state of the incoming voice calls, see SIM800_ManageCalls.
+ *
+ * A call rings with "RING" and, with the caller ID enabled, "+CLIP" every few seconds. A "RING" or
+ * "+CLIP" later than SIM800_CALL_RING_GAP after the previous one, or after the call has ended, starts a new call.
+ */
+typedef struct
+{
+    SIM800_CallMode_t mode;                     /*!< Handling of the calls. */
+    uint8_t ringCode;                           /*!< Index + 1 of the RING expected code, 0 - calls not reported. */
+    uint8_t clipCode;                           /*!< Index + 1 of the +CLIP expected code. */
+    uint8_t ringing;                            /*!< 1 while a call rings. */
+    uint8_t reported;                           /*!< 1 once the caller of the ringing call has been reported. */
+    uint8_t hangUp;                             /*!< 1 while "ATH" of a rejected call is submitted. */
+    uint32_t tick;                              /*!< Tick of the last "RING" or "+CLIP". */
+    uint32_t calls;                             /*!< Count of incoming calls. */
+    SIM800_Caller_t caller;                     /*!< Caller of the last call. */
+} SIM800_Call_t;
 
-SIM800_Status_t SIM800_SetSMSTextMode				(SIM800_Handle_t *handle);
-SIM800_Status_t SIM800_DeleteAllSMSMessages			(SIM800_Handle_t *handle);
-SIM800_Status_t SIM800_SendSMSMessage				(SIM800_Handle_t *handle, char *destination, char *message);
-SIM800_Status_t SIM800_ManageSMSNotifications		(SIM800_Handle_t *handle, uint8_t enordi);
-SIM800_Status_t SIM800_RequestSMSMessage			(SIM800_Handle_t *handle, uint32_t sms_index);
 
-void SIM800_MessageHandler							(SIM800_Handle_t *handle);
+/**
+ * @brief   Structure representing the configuration applied by SIM800_Init.
+ */
+typedef struct
+{
+    uint8_t textMode;                           /*!< 1 - SMS text mode ("AT+CMGF=1"), 0 - PDU mode ("AT+CMGF=0"). */
+    uint8_t smsNotifications;                   /*!< 1 - report new SMS messages ("AT+CNMI=2,1") and handle them, see SIM800_ManageSMSNotifications. */
+    uint8_t errorMode;                          /*!< Error reporting mode, "AT+CMEE=<n>": 0 - ERROR, 1 - numeric causes, 2 - verbose causes, see SIM800_Error_t. */
+    uint8_t regNotifications;                   /*!< Registration notifications mode, see SIM800_ManageRegNotifications, 0 - disabled. */
+    const char *charset;                        /*!< Character set ("AT+CSCS"), e.g. "GSM" or "UCS2" (UTF-8 texts), NULL - keep the default. */
+    const char *storage;                        /*!< SMS storage ("AT+CPMS"), e.g. "SM", NULL - keep the default. */
+    uint32_t timeout;                           /*!< Time to wait for the module and the SIM card to get ready (ms), 0 - SIM800_INIT_TIMEOUT. */
+    uint8_t saveProfile;                        /*!< 1 - store the settings in the profile of the module ("AT&W") and skip them
+                                                     while the profile matches, see SIM800_Init. */
+} SIM800_Config_t;
 
 
+/**
+ * @brief   Enumeration of the values kept in the cache of the handle, see SIM800_SetCacheTTL.
+ */
+typedef enum
+{
+    SIM800_Cache_Battery,                       /*!< Battery information, SIM800_GetBatteryInfo. */
+    SIM800_Cache_Signal,                        /*!< Signal quality, SIM800_GetSignalQuality. */
+    SIM800_Cache_IMEI,                          /*!< IMEI of the module, SIM800_GetIMEI. */
+    SIM800_Cache_ICCID,                         /*!< ICCID of the SIM card, SIM800_GetICCID. */
+    SIM800_Cache_CellInfo,                      /*!< Serving and neighbour cells, SIM800_GetCellInfo. */
+#if SIM800_USE_HTTP
+    SIM800_Cache_Location,                      /*!< Location of the module, SIM800_GetLocation. */
+#endif
+    SIM800_Cache_Count,
+} SIM800_CacheItem_t;
 
 
-/*********************************************************************************************
- *										Callback functions
- ********************************************************************************************/
+/**
+ * @brief   Structure representing the state of a cached value.
+ */
+typedef struct
+{
+    uint32_t ttl;                               /*!< Time the value is served from the cache (ms), 0 - not cached. */
+    uint8_t background;                         /*!< 1 if an expired value is refreshed by SIM800_Poll while the stale one is served. */
+    uint8_t valid;                              /*!< 1 if the cached value has been read from the module. */
+    uint8_t pending;                            /*!< 1 while a background refresh is submitted. */
+    uint32_t tick;                              /*!< Tick at which the value has been read. */
+} SIM800_CacheEntry_t;
+
+
+/**
+ * @brief   Structure representing the retry policy of a command, see SIM800_SetRetryPolicy.
+ *
+ * A request finished by a "+CME ERROR" or "+CMS ERROR" with a retryable cause is sent again after a backoff
+ * that starts at delay and doubles for every attempt up to maxDelay. Timeouts are never retried: the module may
+ * still be executing the command (e.g. an SMS message may have been sent).
+ */
+typedef struct
+{
+    uint8_t attempts;                           /*!< Maximum count of attempts, the first one included. */
+    uint32_t delay;                             /*!< Backoff before the first retry (ms). */
+    uint32_t maxDelay;                          /*!< Upper bound of the backoff (ms). */
+    const uint16_t *causes;                     /*!< Retryable causes, NULL - the transient network and SIM busy causes. */
+    uint8_t causeCount;                         /*!< Count of causes. */
+} SIM800_RetryPolicy_t;
+
+
+/**
+ * @brief   Structure representing a command with a retry policy.
+ */
+typedef struct
+{
+    SIM800_Command_t cmd;                       /*!< Command. */
+    const SIM800_RetryPolicy_t *policy;         /*!< Retry policy, a constant structure: it is not copied. NULL - unused. */
+} SIM800_RetryRule_t;
+
+
+/**
+ * @brief   Enumeration of the notifications delivered through the event queue, see SIM800_Event_t.
+ */
+typedef enum
+{
+    SIM800_Event_NewSMS,                        /*!< SIM800_NewSMSNotificationCallBack, value - storage index. */
+    SIM800_Event_SMSStorageLow,                 /*!< SIM800_SMSStorageLowCallBack. */
+    SIM800_Event_SMSDelivery,                   /*!< SIM800_SMSDeliveryCallBack, arg - reference, arg2 - status, value - latency. */
+    SIM800_Event_NetworkReg,                    /*!< SIM800_NetworkRegCallBack, arg - status. */
+    SIM800_Event_NetworkTime,                   /*!< SIM800_NetworkTimeCallBack, value - seconds since 2000, arg - zone. */
+    SIM800_Event_Reset,                         /*!< SIM800_ResetCallBack. */
+    SIM800_Event_Socket,                        /*!< SIM800_SocketCallBack, arg - socket, arg2 - event. */
+    SIM800_Event_Bearer,                        /*!< SIM800_BearerCallBack, arg - state. */
+    SIM800_Event_SMSReceived,                   /*!< SIM800_RcvdSMSCallBack, data - the message, delivered at once by the parser. */
+    SIM800_Event_Call,                          /*!< SIM800_IncomingCallCallBack, data - the caller. */
+    SIM800_Event_USSD,                          /*!< A "+CUSD" response, data - the response; see SIM800_SendUSSD for the query callback. */
+    SIM800_Event_GNSS,                          /*!< SIM800_GNSSCallBack, data - the position. */
+} SIM800_EventType_t;
+
+
+/*
+ * Masks of the events of SIM800_Subscribe
+ */
+#define SIM800_EVT(type)						(1UL << (type))
+#define SIM800_EVT_NEWSMS						SIM800_EVT(SIM800_Event_NewSMS)
+#define SIM800_EVT_STORAGE_LOW					SIM800_EVT(SIM800_Event_SMSStorageLow)
+#define SIM800_EVT_DELIVERY						SIM800_EVT(SIM800_Event_SMSDelivery)
+#define SIM800_EVT_CREG							SIM800_EVT(SIM800_Event_NetworkReg)
+#define SIM800_EVT_TIME							SIM800_EVT(SIM800_Event_NetworkTime)
+#define SIM800_EVT_RESET						SIM800_EVT(SIM800_Event_Reset)
+#define SIM800_EVT_SOCKET						SIM800_EVT(SIM800_Event_Socket)
+#define SIM800_EVT_BEARER						SIM800_EVT(SIM800_Event_Bearer)
+#define SIM800_EVT_SMS							SIM800_EVT(SIM800_Event_SMSReceived)
+#define SIM800_EVT_CALL							SIM800_EVT(SIM800_Event_Call)
+#define SIM800_EVT_USSD							SIM800_EVT(SIM800_Event_USSD)
+#define SIM800_EVT_GNSS							SIM800_EVT(SIM800_Event_GNSS)
+#define SIM800_EVT_ALL							0xFFFFFFFFUL
+
+
+/**
+ * @brief   Structure representing a notification waiting for its callback.
+ */
+typedef struct
+{
+    uint8_t type;                               /*!< Notification, see SIM800_EventType_t. */
+    uint8_t arg;                                /*!< First argument of the callback. */
+    uint8_t arg2;                               /*!< Second argument of the callback. */
+    uint32_t value;                             /*!< Wide argument of the callback. */
+    const void *data;                           /*!< Data valid during the callback, NULL for most queued events. */
+} SIM800_Event_t;
+
+
+/**
+ * @brief   Structure representing the queue of the notifications, drained by SIM800_Poll.
+ *
+ * The parsers only post the notification, the callback runs later from SIM800_Poll once the line
+ * dispatch is over, never nested in another callback of the queue.
+ */
+typedef struct
+{
+    SIM800_Event_t events[SIM800_EVENT_QUEUE_LENGTH];  /*!< Ring of notifications. */
+    uint8_t head;                               /*!< Free-running write index. */
+    uint8_t tail;                               /*!< Free-running read index. */
+    uint8_t dispatching;                        /*!< 1 while a callback of the queue runs. */
+    uint32_t dropped;                           /*!< Notifications lost because the queue was full. */
+} SIM800_EventQueue_t;
+
+
+#if SIM800_USE_STATS
+
+/**
+ * @brief   Structure representing the counters of the driver, see SIM800_GetStats.
+ *
+ * The counters wrap around, the ones of a command stop at 0xFFFF.
+ */
+typedef struct
+{
+    uint32_t rxBytes;                           /*!< Characters received. */
+    uint32_t lines;                             /*!< Non-empty lines received. */
+    uint32_t overruns;                          /*!< Characters lost because the receive ring was full. */
+    uint32_t truncated;                         /*!< Response fields cut to fit their buffer, e.g. a long SMS text. */
+    uint32_t unmatched;                         /*!< Lines no expected code took, e.g. notifications that are not enabled. */
+    uint32_t timeouts;                          /*!< Requests timed out. */
+    uint16_t commandTimeouts[SIM800_Cmd_Count]; /*!< Requests timed out per command. */
+    uint32_t retries;                           /*!< Requests sent again, see SIM800_SetRetryPolicy. */
+    uint32_t txErrors;                          /*!< Blocks the UART refused to send. */
+    uint32_t uartOverruns;                      /*!< UART overrun errors (ORE). */
+    uint32_t uartFraming;                       /*!< UART framing errors (FE). */
+    uint32_t uartNoise;                         /*!< UART noise errors (NE). */
+    uint32_t uartParity;                        /*!< UART parity errors (PE). */
+    uint32_t resets;                            /*!< Unexpected resets of the module. */
+    uint32_t eventsDropped;                     /*!< Notifications lost because the event queue was full. */
+} SIM800_Stats_t;
+
+#endif /* SIM800_USE_STATS */
+
+
+#if SIM800_USE_LATENCY
+
+/**
+ * @brief   Enumeration of the stages of a command measured by the latency histograms, see SIM800_GetLatency.
+ */
+typedef enum
+{
+    SIM800_Latency_Serial,                      /*!< From the start of the command to the end of its transmission. */
+    SIM800_Latency_Module,                      /*!< From the end of the transmission to the first response line. */
+    SIM800_Latency_Response,                    /*!< From the first response line to the final result code. */
+    SIM800_Latency_Total,                       /*!< From the start of the command to the final result code. */
+    SIM800_Latency_Count,
+} SIM800_LatencyStage_t;
+
+
+/**
+ * @brief   Structure representing the latency histograms of a command.
+ *
+ * Bucket 0 counts the stages shorter than 1 us, bucket n the ones of 2^(n-1) to 2^n us, the last bucket
+ * everything longer. The counts stop at 0xFFFF.
+ */
+typedef struct
+{
+    SIM800_Command_t cmd;                       /*!< Command. */
+    uint32_t count;                             /*!< Count of requests finished with "OK", the ones in the histograms. */
+    uint32_t failed;                            /*!< Count of requests finished with an error or a timeout. */
+    uint16_t histogram[SIM800_Latency_Count][SIM800_LATENCY_BUCKETS];  /*!< Histograms of the stages. */
+} SIM800_Latency_t;
+
+
+/**
+ * @brief   Structure representing the latency measurement of the request queue.
+ *
+ * The request being executed is stamped with the DWT cycle counter (and the tick, for stages longer than the
+ * counter wraps in) when it starts, when its command has been transmitted, at its first response line and at
+ * its final result code.
+ */
+typedef struct
+{
+    volatile uint8_t stage;                     /*!< Next stamp of the request being measured, 0 - none is measured. */
+    uint8_t index;                              /*!< Expected code of the request being measured. */
+    SIM800_Command_t cmd;                       /*!< Command of the request being measured. */
+    uint32_t txEnd;                             /*!< Transmit queue index following the command. */
+    uint32_t cycles[SIM800_Latency_Count];      /*!< Cycle counter at the start, transmission, first line and final result code. */
+    uint32_t ticks[SIM800_Latency_Count];       /*!< Tick at the same stamps. */
+    SIM800_Latency_t commands[SIM800_LATENCY_COMMANDS];  /*!< Histograms of the measured commands. */
+    uint32_t untracked;                         /*!< Count of requests of commands that found no free histograms. */
+} SIM800_LatencyMonitor_t;
+
+#endif /* SIM800_USE_LATENCY */
+
+
+#if SIM800_USE_ISR_BUDGET
+
+/**
+ * @brief   Structure representing the execution time of the interrupt handlers, see SIM800_GetISRStats.
+ */
+typedef struct
+{
+    uint32_t count;                             /*!< Count of handler runs. */
+    uint32_t exceeded;                          /*!< Count of runs longer than the budget. */
+    uint32_t max;                               /*!< Longest run (ns). */
+    uint32_t mean;                              /*!< Mean run (ns). */
+} SIM800_ISRStats_t;
+
+
+/**
+ * @brief   Structure representing the measurement of the interrupt handlers, see SIM800_SetISRBudget.
+ */
+typedef struct
+{
+    uint32_t count;                             /*!< Count of handler runs. */
+    uint32_t exceeded;                          /*!< Count of runs longer than the budget. */
+    uint32_t max;                               /*!< Longest run (core clock cycles). */
+    uint64_t total;                             /*!< Sum of the runs (core clock cycles). */
+    uint32_t budget;                            /*!< Longest allowed run (core clock cycles), 0 - no budget. */
+} SIM800_ISRMonitor_t;
+
+#endif /* SIM800_USE_ISR_BUDGET */
+
+
+/**
+ * @brief   Enumeration of the states of the health watchdog, see SIM800_ManageWatchdog.
+ */
+typedef enum
+{
+    SIM800_Watchdog_Off,                        /*!< The watchdog is disabled. */
+    SIM800_Watchdog_Healthy,                    /*!< The module answers, the timeouts in a row are counted. */
+    SIM800_Watchdog_Probing,                    /*!< Too many timeouts in a row, the module is probed with "AT". */
+    SIM800_Watchdog_Rebooting,                  /*!< The probes failed, "AT+CFUN=1,1" has been sent. */
+    SIM800_Watchdog_PowerCycling,               /*!< The module did not restart, SIM800_PowerCycleCallBack has been invoked. */
+    SIM800_Watchdog_Restoring,                  /*!< The module has restarted, the configuration of SIM800_Init is sent again. */
+} SIM800_WatchdogState_t;
+
+
+/**
+ * @brief   Structure representing the health watchdog of the module.
+ */
+typedef struct
+{
+    SIM800_WatchdogState_t state;               /*!< State of the watchdog. */
+    uint8_t timeouts;                           /*!< Count of requests timed out in a row. */
+    uint8_t probes;                             /*!< Count of failed probes in a row. */
+    uint8_t step;                               /*!< Current step of the restoration. */
+    uint8_t busy;                               /*!< 1 while a request of the watchdog is submitted. */
+    uint32_t tick;                              /*!< Tick at which the current state has been entered. */
+    uint32_t recoveries;                        /*!< Count of restorations of the module. */
+    char line[TX_ARENA_LENGTH / 2];             /*!< Settings of SIM800_Init sent by the restoration. */
+} SIM800_Watchdog_t;
+
+
+/**
+ * @brief   Structure representing a date and time of the network, e.g. "23/11/05,10:00:00+12".
+ *
+ * The time is the local time of the network, zone is its offset from UTC.
+ */
+typedef struct
+{
+    uint16_t year;                                  /*!< Year, e.g. 2023, 0 - no time. */
+    uint8_t month;                                  /*!< Month: 1...12. */
+    uint8_t day;                                    /*!< Day of the month: 1...31. */
+    uint8_t hour;                                   /*!< Hour: 0...23. */
+    uint8_t minute;                                 /*!< Minute: 0...59. */
+    uint8_t second;                                 /*!< Second: 0...59. */
+    int8_t zone;                                    /*!< Offset of the local time from UTC in quarters of an hour, e.g. +12 - UTC+3. */
+} SIM800_Time_t;
+
+
+#if SIM800_USE_GNSS
+
+/**
+ * @brief   Structure representing a position of the GNSS receiver, see SIM800_ManageGNSSStream.
+ *
+ * The values are fixed-point, the fields the receiver leaves empty (without a fix) are 0.
+ */
+typedef struct
+{
+    uint8_t fix;                                /*!< 1 - the position is fixed, 0 - not yet. */
+    SIM800_Time_t time;                         /*!< UTC time of the position, zone 0. */
+    int32_t latitude;                           /*!< Latitude (millionths of a degree, north positive). */
+    int32_t longitude;                          /*!< Longitude (millionths of a degree, east positive). */
+    int32_t altitude;                           /*!< Altitude above the mean sea level (cm). */
+    uint16_t speed;                             /*!< Speed over ground (hundredths of km/h). */
+    uint16_t course;                            /*!< Course over ground (tenths of a degree from north). */
+    uint16_t hdop;                              /*!< Horizontal dilution of precision (tenths). */
+    uint8_t satellitesInView;                   /*!< Satellites in view. */
+    uint8_t satellitesUsed;                     /*!< Satellites used for the position. */
+} SIM800_GNSSFix_t;
+
+
+/**
+ * @brief   Structure representing the state of the GNSS receiver, see SIM800_ManageGNSS.
+ */
+typedef struct
+{
+    uint8_t power;                              /*!< 1 while the receiver is powered ("AT+CGNSPWR=1"). */
+    uint8_t urcCode;                            /*!< Index + 1 of the +UGNSINF expected code, 0 - no stream. */
+    uint8_t period;                             /*!< Positions per report of the stream ("AT+CGNSURC=<n>"). */
+    uint32_t reports;                           /*!< Count of positions received. */
+    SIM800_GNSSFix_t fix;                       /*!< Last position. */
+} SIM800_GNSS_t;
+
+#endif /* SIM800_USE_GNSS */
+
+
+#if SIM800_USE_REG_CACHE
+
+/**
+ * @brief   Structure representing the operator and the band of the last registration, see SIM800_SetRegCache.
+ */
+typedef struct
+{
+    char plmn[SIM800_PLMN_LENGTH];              /*!< Numeric operator (MCC and MNC), e.g. "25001", empty - none. */
+    char band[SIM800_BAND_LENGTH];              /*!< Band selection ("AT+CBAND?"), e.g. "EGSM_DCS_MODE", empty - not known. */
+} SIM800_RegCache_t;
+
+
+/**
+ * @brief   Structure representing the state of the registration cache and the registration time.
+ */
+typedef struct
+{
+    SIM800_RegCache_t cache;                    /*!< Operator and band selected at boot, updated by every registration. */
+    SIM800_RegCache_t read;                     /*!< Operator and band being read after a registration. */
+    uint8_t record;                             /*!< 1 once registered, SIM800_Poll reads the operator and the band. */
+    uint8_t pending;                            /*!< 1 while a read is submitted. */
+    uint8_t timing;                             /*!< 1 from SIM800_Init until the registration. */
+    uint8_t targeted;                           /*!< 1 while the boot waits for the registration on the cached band. */
+    uint8_t cached;                             /*!< 1 if the last boot selected the cached operator. */
+    uint32_t bootTick;                          /*!< Tick of the start of SIM800_Init. */
+    uint32_t time;                              /*!< Time to register of the last boot (ms), 0 - not registered yet. */
+} SIM800_RegCacheState_t;
+
+#endif /* SIM800_USE_REG_CACHE */
+
+
+/**
+ * @brief   Structure representing a USSD response ("+CUSD"), see SIM800_SendUSSD.
+ */
+typedef struct
+{
+    uint8_t status;                             /*!< 0 - done, 1 - the network waits for a reply, 2 - ended by the network, 4 - not supported, 5 - timed out. */
+    uint8_t dcs;                                /*!< Data coding scheme, e.g. 15 - GSM 7 bit, 72 - UCS2. */
+    char text[SIM800_USSD_LENGTH];              /*!< Text of the response, UTF-8 once a UCS2 response is decoded. */
+} SIM800_USSD_t;
+
+
+/**
+ * @brief   Structure representing the last account balance parsed from a USSD response.
+ */
+typedef struct
+{
+    uint8_t valid;                              /*!< 1 once a balance has been parsed. */
+    int32_t value;                              /*!< Balance in hundredths of the currency unit, e.g. 12345 - "123.45". */
+    uint32_t tick;                              /*!< Tick of the response. */
+    SIM800_Time_t time;                         /*!< Network time of the response, year 0 - no network time. */
+} SIM800_Balance_t;
+
+
+/**
+ * @brief   Enumeration of the encodings of SMS messages.
+ */
+typedef enum
+{
+    SIM800_SMSEncoding_GSM = 0,                 /*!< GSM 7-bit alphabet (or the module character set), the text is ASCII. */
+    SIM800_SMSEncoding_8Bit,                    /*!< 8-bit data, the printable characters are kept. */
+    SIM800_SMSEncoding_UCS2,                    /*!< UCS2, the text is converted to UTF-8. */
+} SIM800_SMSEncoding_t;
+
+
+/**
+ * @brief   Structure representing SMS message information.
+ *
+ * This structure represents SMS message information, including sender phone number, and text of this message.
+ */
+typedef struct
+{
+    char sender[SMS_SENDER_MAX_LEN];
+    char text[SMS_TEXT_MAX_LEN];
+    uint16_t index;                                 /*!< Storage index of the message, set by SIM800_ReadAllSMS. */
+    uint16_t partRef;                               /*!< Reference of the long message the part belongs to (PDU mode). */
+    uint8_t partCount;                              /*!< Count of parts of the long message, 0 - single message. */
+    uint8_t partIndex;                              /*!< Index of the part, from 1. */
+    SIM800_SMSEncoding_t encoding;                  /*!< Encoding the message has been received in. */
+    SIM800_Time_t timestamp;                        /*!< Service centre time stamp, year 0 if the header carries none. */
+} SIM800_SMSMessage_t;
+
+
+/**
+ * @brief   Structure representing a long SMS message being reassembled from its parts.
+ */
+typedef struct
+{
+    uint8_t used;                               /*!< 1 if the entry is in use. */
+    uint8_t count;                              /*!< Count of parts. */
+    uint8_t received;                           /*!< Bit mask of the received parts. */
+    uint16_t reference;                         /*!< Reference shared by the parts. */
+    uint32_t tick;                              /*!< Tick at which the first part has been received. */
+    char sender[SMS_SENDER_MAX_LEN];            /*!< Sender phone number. */
+    uint8_t lengths[SIM800_SMS_CONCAT_PARTS];   /*!< Lengths of the parts. */
+    uint16_t length;                            /*!< Length of the reassembled text. */
+    char text[SIM800_SMS_CONCAT_PARTS * SIM800_SMS_PART_TEXT + 1];  /*!< Text, the part n is kept at (n - 1) * SIM800_SMS_PART_TEXT until complete. */
+} SIM800_LongSMS_t;
+
+
+/**
+ * @brief   Structure representing the occupancy of the SMS storage the received messages are stored in.
+ */
+typedef struct
+{
+    uint16_t used;                              /*!< Count of stored messages. */
+    uint16_t total;                             /*!< Capacity of the storage, 0 - unknown. */
+} SIM800_SMSStorage_t;
+
+
+/**
+ * @brief   Structure representing a sent SMS message waiting for its delivery report.
+ */
+typedef struct
+{
+    uint8_t used;                               /*!< 1 if the entry is in use. */
+    uint8_t reference;                          /*!< Message reference returned by +CMGS. */
+    uint32_t tickStart;                         /*!< Tick at which the message has been submitted to the module. */
+} SIM800_SMSReport_t;
+
+
+/**
+ * @brief   Enumeration of the delivery modes of incoming SMS messages, see SIM800_ManageSMSDelivery.
+ */
+typedef enum
+{
+    SIM800_SMSDelivery_Stored,                  /*!< Messages are stored and announced by +CMTI ("AT+CNMI=2,1"). */
+    SIM800_SMSDelivery_Direct,                  /*!< Messages are forwarded by +CMT without being stored ("AT+CNMI=2,2"). */
+} SIM800_SMSDelivery_t;
+
+
+/**
+ * @brief   Enumeration of the SMS message filters of SIM800_ReadAllSMS.
+ */
+typedef enum
+{
+    SIM800_SMS_Unread,                          /*!< Received unread messages ("REC UNREAD"). */
+    SIM800_SMS_Read,                            /*!< Received read messages ("REC READ"). */
+    SIM800_SMS_Unsent,                          /*!< Stored unsent messages ("STO UNSENT"). */
+    SIM800_SMS_Sent,                            /*!< Stored sent messages ("STO SENT"). */
+    SIM800_SMS_All,                             /*!< All messages ("ALL"). */
+    SIM800_SMS_FilterCount,
+} SIM800_SMSFilter_t;
+
+
+/**
+ * @brief   Enumeration of the socket types of SIM800_SocketOpen.
+ */
+typedef enum
+{
+    SIM800_Socket_TCP,                          /*!< TCP connection. */
+    SIM800_Socket_UDP,                          /*!< UDP "connection" to one remote address. */
+} SIM800_SocketType_t;
+
+
+/**
+ * @brief   Enumeration of socket states.
+ */
+typedef enum
+{
+    SIM800_Socket_Closed,                       /*!< Not connected. */
+    SIM800_Socket_Connecting,                   /*!< "AT+CIPSTART" accepted, awaiting "n, CONNECT OK". */
+    SIM800_Socket_Connected,                    /*!< Connected, data can be sent. */
+} SIM800_SocketState_t;
+
+
+/**
+ * @brief   Enumeration of the socket events of SIM800_SocketCallBack.
+ */
+typedef enum
+{
+    SIM800_SocketEvent_Connected,               /*!< "n, CONNECT OK": the connection is established. */
+    SIM800_SocketEvent_ConnectFailed,           /*!< "n, CONNECT FAIL": the connection could not be established. */
+    SIM800_SocketEvent_Closed,                  /*!< "n, CLOSED": the connection is closed by the remote side or the network. */
+    SIM800_SocketEvent_Received,                /*!< Data received, see SIM800_SocketRecv. */
+    SIM800_SocketEvent_Pending,                 /*!< Data waiting in the module in manual receive mode, see SIM800_SocketRead. */
+} SIM800_SocketEvent_t;
+
+
+/**
+ * @brief   Enumeration of the states of the transparent data pipe, see SIM800_TransparentInit.
+ *
+ * While the pipe is online or escaping, the received characters are not parsed as lines. No command
+ * is sent from the moment "AT+CIPSTART" is accepted until the pipe leaves data mode.
+ */
+typedef enum
+{
+    SIM800_Transparent_Off,                     /*!< Transparent mode not initialised. */
+    SIM800_Transparent_Idle,                    /*!< Initialised, not connected. */
+    SIM800_Transparent_Connecting,              /*!< "AT+CIPSTART" accepted, awaiting "CONNECT". */
+    SIM800_Transparent_Online,                  /*!< Data mode, every byte belongs to the connection. */
+    SIM800_Transparent_Escaping,                /*!< "+++" sent, the received bytes still belong to the connection. */
+    SIM800_Transparent_EscapeAnswer,            /*!< Awaiting the "OK" of "+++", the received characters are lines again. */
+    SIM800_Transparent_Suspended,               /*!< Command mode, the connection is kept, see SIM800_TransparentResume. */
+} SIM800_Transparent_t;
+
+
+/**
+ * @brief   Enumeration of the states of the GPRS bearer, see SIM800_BearerUp.
+ */
+typedef enum
+{
+    SIM800_Bearer_Down,                         /*!< No PDP context, reconnected after the backoff delay while wanted. */
+    SIM800_Bearer_Connecting,                   /*!< "AT+CGATT", "AT+CSTT", "AT+CIICR" and "AT+CIFSR" in progress. */
+    SIM800_Bearer_Up,                           /*!< PDP context active, handle->localIP is valid. */
+} SIM800_BearerState_t;
+
+
+/**
+ * @brief   Structure representing the GPRS bearer shared by the sockets, the transparent pipe and HTTP.
+ */
+typedef struct
+{
+    const char *apn;                            /*!< Access point name, NULL - not initialised, see SIM800_BearerInit. */
+    SIM800_BearerState_t state;                 /*!< State of the PDP context. */
+    uint8_t wanted;                             /*!< 1 if the bearer is kept up, see SIM800_BearerUp. */
+    uint8_t step;                               /*!< Step of the bring-up in progress. */
+    uint8_t busy;                               /*!< 1 while a request of the bring-up is submitted. */
+    uint8_t shut;                               /*!< 1 if the IP stack must be shut ("AT+CIPSHUT") before the bring-up. */
+    uint8_t pdp;                                /*!< Index + 1 of the +PDP expected code. */
+    uint16_t failures;                          /*!< Count of failed bring-ups in a row. */
+    uint32_t retryTick;                         /*!< Tick of the next bring-up while the bearer is down. */
+    uint32_t deacts;                            /*!< Count of "+PDP: DEACT" notifications. */
+} SIM800_Bearer_t;
+
+
+/**
+ * @brief   Structure representing a host name resolved by "AT+CDNSGIP", see SIM800_Resolve.
+ */
+typedef struct
+{
+    char host[SIM800_SOCKET_HOST_MAX + 1];      /*!< Host name, empty - unused entry. */
+    char ip[16];                                /*!< Resolved IP address. */
+    uint32_t tick;                              /*!< Tick of the lookup, the entry expires SIM800_DNS_TTL later. */
+} SIM800_DNSEntry_t;
+
+
+/**
+ * @brief   Structure representing the cache of resolved host names.
+ */
+typedef struct
+{
+    SIM800_DNSEntry_t entries[SIM800_DNS_CACHE_SIZE];  /*!< Resolved host names. */
+    char ip[16];                                /*!< Address reported by the lookup in progress. */
+    uint8_t done;                               /*!< 1 once the lookup in progress has reported its result. */
+    uint8_t found;                              /*!< 1 if the lookup in progress has resolved the host name. */
+    uint32_t hits;                              /*!< Count of the host names found in the cache. */
+    uint32_t lookups;                           /*!< Count of the "AT+CDNSGIP" lookups. */
+} SIM800_DNS_t;
+
+
+/**
+ * @brief   Structure representing a connection of the multi-connection mode ("AT+CIPMUX=1").
+ */
+typedef struct
+{
+    SIM800_SocketState_t state;                 /*!< Connection state. */
+    uint8_t rx[SIM800_SOCKET_RX_LENGTH];        /*!< Ring of received data, read by SIM800_SocketRecv. */
+    uint32_t rxHead;                            /*!< Free-running write index. */
+    uint32_t rxTail;                            /*!< Free-running read index. */
+    uint32_t rxDropped;                         /*!< Count of received bytes dropped because the ring was full. */
+    uint8_t rxPending;                          /*!< 1 if data is waiting in the module in manual receive mode. */
+} SIM800_Socket_t;
+
+
+/**
+ * @brief   Structure representing one "AT+CIPRXGET=2" read, see SIM800_SubmitSocketRead.
+ *
+ * The structure and the buffer are pinned: they must stay valid until the read is finished.
+ */
+typedef struct
+{
+    uint8_t *buffer;                            /*!< Destination buffer, the payload is copied straight into it. */
+    uint16_t size;                              /*!< Size of the buffer, at most SIM800_SOCKET_TX_MAX bytes are read. */
+    uint16_t length;                            /*!< Count of bytes read. */
+    uint16_t remaining;                         /*!< Count of bytes still waiting in the module. */
+    uint8_t socket;                             /*!< Socket number. */
+    uint8_t header;                             /*!< 1 once the header of the response has been parsed. */
+} SIM800_SocketRead_t;
+
+
+/**
+ * @brief   Structure representing a received line kept in place in the receive ring.
+ *
+ * The line is not copied anywhere, it is described by its position in handle->rxRing.
+ * The terminating "\r\n" is not included in the length. A line longer than RX_LINE_CHUNK_LENGTH
+ * is described in several chunks, every chunk but the first one is marked as continued.
+ */
+typedef struct
+{
+    uint32_t start;                             /*!< Free-running ring index of the first character. */
+    uint16_t length;                            /*!< Count of characters in the line. */
+    uint8_t continued;                          /*!< 1 if this is a continuation chunk of a long line. */
+    uint8_t complete;                           /*!< 1 if the line ends with this chunk. */
+} SIM800_Line_t;
+
+
+typedef struct SIM800_Handle SIM800_Handle_t;
+
+
+/**
+ * @brief   Callback invoked when a queued transmit block has been sent (from the TX-complete interrupt).
+ *
+ * The status is SIM800_ERROR if the UART refused the block. The callback may queue further blocks.
+ */
+typedef void (*SIM800_TxCallback_t)(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+
+
+/**
+ * @brief   Structure representing a link replacing the UART of a handle, see SIM800_AttachLink.
+ *
+ * A link is the transport of the handle: a virtual channel of the multiplexer, a USART driven through the
+ * LL drivers (sim800_ll.c) or a simulated module. The functions are called from SIM800_Process and the
+ * submitting code; receive is also called from SIM800_LinkInput, i.e. from the interrupt feeding it.
+ */
+typedef struct
+{
+    uint16_t (*transmit)(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);  /*!< Takes as many
+                                                  bytes as it can and returns their count, the rest is offered again later. */
+    void (*poll)(SIM800_Handle_t *handle, void *ctx);  /*!< Moves the received bytes in (SIM800_LinkInput) and the sent
+                                                  ones out, called whenever the handle checks its transmission, may be NULL. */
+    SIM800_Status_t (*receive)(SIM800_Handle_t *handle, uint8_t enordi, void *ctx);  /*!< Starts (ENABLE) or stops
+                                                  (DISABLE) the reception, stopped at RX_HIGH_WATER with flow control, may be NULL. */
+    SIM800_Status_t (*configure)(SIM800_Handle_t *handle, uint32_t baud, uint32_t flow, void *ctx);  /*!< Sets the baud
+                                                  rate and the flow control (UART_HWCONTROL_...), NULL - the link has none. */
+    uint32_t (*baud)(SIM800_Handle_t *handle, void *ctx);  /*!< Returns the baud rate, NULL - the link has none. */
+} SIM800_Link_t;
+
+
+/**
+ * @brief   Callback receiving all the characters of a handle instead of the line parser, see SIM800_EnterMux.
+ *
+ * The bytes are passed straight from the receive ring and are only valid during the call. The
+ * callback is invoked from SIM800_Process.
+ */
+typedef void (*SIM800_RawRxCallback_t)(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+
+
+#define SIM800_TRACE_MAGIC						"S8TR"	/* Start of a dump of the trace. */
+#define SIM800_TRACE_VERSION					1		/* Version of the format, follows the magic. */
+#define SIM800_TRACE_HEADER						7		/* Bytes of the header of a record. */
+
+/**
+ * @brief   Enumeration of the types of the trace records.
+ */
+typedef enum
+{
+    SIM800_Trace_RX = 1,                        /*!< A line (or a chunk of a long line) received, with its terminator. */
+    SIM800_Trace_TX = 2,                        /*!< A block queued for transmission. */
+} SIM800_TraceType_t;
+
+
+#if SIM800_USE_TRACE
+
+/**
+ * @brief   Structure representing the trace ring of the traffic with the module, see SIM800_TraceDump.
+ *
+ * Every record is a header - the type (1 byte), the count of characters (2 bytes) and the tick (4 bytes), both
+ * little-endian - followed by the characters. The oldest records are overwritten by the new ones.
+ */
+typedef struct
+{
+    uint8_t ring[SIM800_TRACE_LENGTH];          /*!< Records. */
+    uint32_t head;                              /*!< Free-running index of the next record. */
+    uint32_t tail;                              /*!< Free-running index of the oldest record. */
+    uint32_t dropped;                           /*!< Count of records overwritten. */
+    volatile uint8_t paused;                    /*!< 1 while the trace is dumped, nothing is recorded. */
+} SIM800_Trace_t;
+
+
+/**
+ * @brief   Callback writing a piece of the dump of the trace, e.g. to the SWO or a debug UART, see SIM800_TraceDump.
+ */
+typedef void (*SIM800_TraceWriter_t)(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+
+#endif /* SIM800_USE_TRACE */
+
+
+#if SIM800_USE_SLEEP
+
+/**
+ * @brief   Enumeration of the states of the sleep mode of the module, see SIM800_ManageSleep.
+ */
+typedef enum
+{
+    SIM800_Sleep_Off,                           /*!< Sleep mode disabled. */
+    SIM800_Sleep_Awake,                         /*!< DTR low, the module takes commands. */
+    SIM800_Sleep_Waking,                        /*!< DTR pulled low, the module wakes up within SIM800_SLEEP_WAKE_DELAY. */
+    SIM800_Sleep_Asleep,                        /*!< DTR high, the module sleeps while it has nothing to report. */
+} SIM800_SleepState_t;
+
+
+/**
+ * @brief   Structure representing the sleep mode of the module and of the MCU, see SIM800_ManageSleep.
+ */
+typedef struct
+{
+    GPIO_TypeDef *dtrPort;                      /*!< Port of the pin driving DTR. */
+    uint16_t dtrPin;                            /*!< Pin driving DTR. */
+    SIM800_SleepState_t state;                  /*!< State of the module. */
+    uint32_t tick;                              /*!< Tick of the last traffic, of DTR falling while waking. */
+    uint32_t rxSeen;                            /*!< Receive ring write index at the last check. */
+    volatile uint8_t ring;                      /*!< Set by SIM800_RIHandler. */
+    uint32_t stops;                             /*!< Count of STOP mode entries by SIM800_EnterStop. */
+} SIM800_Sleep_t;
+
+#endif /* SIM800_USE_SLEEP */
+
+
+
+/**
+ * @brief   Callback receiving the body of an HTTP response, see SIM800_HttpGet.
+ *
+ * The bytes are passed straight from the receive ring and are only valid during the call. The
+ * callback is invoked from SIM800_Process, it must not call blocking functions.
+ */
+typedef void (*SIM800_HttpBodyCallback_t)(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+
+
+/**
+ * @brief   Structure representing the state of the HTTP client.
+ */
+typedef struct
+{
+    uint8_t bearer;                             /*!< 1 if the bearer is known to be open. */
+    uint8_t done;                               /*!< 1 once the result of "AT+HTTPACTION" has been received. */
+    uint16_t status;                            /*!< HTTP status code of the last request. */
+    uint32_t length;                            /*!< Length of the body of the last response. */
+    SIM800_HttpBodyCallback_t body;             /*!< Callback receiving the body, may be NULL. */
+    void *ctx;                                  /*!< Argument of the body callback. */
+} SIM800_Http_t;
+
+
+/**
+ * @brief   Callback invoked by SIM800_Poll when a submitted request is finished.
+ *
+ * The status is the one the corresponding blocking function would return. The callback may submit
+ * further requests and call blocking functions.
+ */
+typedef void (*SIM800_RequestCallback_t)(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+
+
+/**
+ * @brief   Callback invoked by SIM800_Poll when the response of SIM800_SendUSSD is received.
+ *
+ * The status is SIM800_OK with the response, SIM800_TIMEOUT if no "+CUSD" came within SIM800_USSD_TIMEOUT,
+ * SIM800_ERROR if the command was refused (the response is then empty). The response is only valid during the call.
+ * The callback may submit requests and call blocking functions, e.g. SIM800_SendUSSD of a menu reply.
+ */
+typedef void (*SIM800_USSDCallback_t)(SIM800_Handle_t *handle, SIM800_Status_t status, const SIM800_USSD_t *ussd, void *ctx);
+
+
+/**
+ * @brief   Structure representing the state of the USSD queries, see SIM800_SendUSSD.
+ *
+ * A "+CUSD" line longer than a line chunk is parsed chunk by chunk: the text is copied as it arrives, its data
+ * coding scheme follows it, so a UCS2 text is decoded in place once the line is complete.
+ */
+typedef struct
+{
+    uint8_t code;                               /*!< Index + 1 of the +CUSD expected code, 0 - not registered yet. */
+    uint8_t state;                              /*!< Query: 0 - none, 1 - its "+CUSD" is awaited, 2 - its callback is due. */
+    SIM800_Status_t status;                     /*!< Status handed to the callback of the query. */
+    uint8_t field;                              /*!< Part of the line being parsed: 0 - status, 1 - text, 2 - coding scheme. */
+    uint16_t length;                            /*!< Count of characters of the text copied so far. */
+    uint32_t tick;                              /*!< Tick of the submission of the query. */
+    SIM800_USSDCallback_t callback;             /*!< Callback of the query, may be NULL. */
+    void *ctx;                                  /*!< Argument of the callback. */
+    SIM800_USSD_t response;                     /*!< Last response, also the ones the network sends on its own. */
+    SIM800_Balance_t balance;                   /*!< Last balance, see SIM800_GetBalance. */
+} SIM800_USSDSession_t;
+
+
+#if SIM800_USE_PHONEBOOK
+
+/**
+ * @brief   Structure representing the in-RAM index of the SIM phonebook, see SIM800_LoadPhonebook.
+ *
+ * A number is kept as a key of its last SIM800_PHONEBOOK_DIGITS digits and their count, the keys are sorted
+ * so a sender is looked up by a binary search. The national and the international form of a number match.
+ */
+typedef struct
+{
+    uint64_t keys[SIM800_PHONEBOOK_ENTRIES];    /*!< Sorted keys of the numbers. */
+    uint16_t count;                             /*!< Count of keys. */
+    uint16_t size;                              /*!< Count of entries of the SIM phonebook ("AT+CPBR=?"). */
+    uint16_t dropped;                           /*!< Entries of the last load that did not fit into the index. */
+    uint8_t valid;                              /*!< 1 once the phonebook has been loaded. */
+    uint8_t loading;                            /*!< 1 while a load is submitted. */
+    uint8_t stale;                              /*!< 1 if the index is to be loaded again in the background. */
+    uint32_t tick;                              /*!< Tick of the end of the last load. */
+    uint32_t refresh;                           /*!< Period (ms) of the background reload, 0 - none. */
+    char arg[12];                               /*!< Index range of "AT+CPBR=". */
+    SIM800_RequestCallback_t done;              /*!< Completion callback of the load, may be NULL. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+} SIM800_Phonebook_t;
+
+#endif /* SIM800_USE_PHONEBOOK */
+
+
+/**
+ * @brief   Callback invoked by SIM800_Poll for every SMS message of a listing, see SIM800_ReadAllSMS.
+ *
+ * The message is only valid during the call. The callback is invoked while the listing is being
+ * parsed, it may submit requests but must not call blocking functions.
+ */
+typedef void (*SIM800_SMSCallback_t)(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message, void *ctx);
+
+
+/**
+ * @brief   Callback invoked by SIM800_Poll when the message of a recipient of SIM800_SendSMSBatch is finished.
+ *
+ * The recipients are finished in their order. The callback may submit requests and call blocking functions.
+ */
+typedef void (*SIM800_SMSBatchCallback_t)(SIM800_Handle_t *handle, uint16_t recipient, SIM800_Status_t status, void *ctx);
+
+
+/**
+ * @brief   Structure representing the state of the SMS listing in progress.
+ */
+typedef struct
+{
+    SIM800_SMSCallback_t callback;              /*!< Callback invoked for every message. */
+    void *ctx;                                  /*!< Argument of the message callback. */
+    SIM800_RequestCallback_t done;              /*!< Completion callback of the listing, may be NULL. */
+    void *doneCtx;                              /*!< Argument of the completion callback. */
+    uint16_t lines;                             /*!< Count of lines (and line chunks) of the current message, 0 - none. */
+    uint16_t count;                             /*!< Count of messages delivered. */
+    uint8_t active;                             /*!< 1 while a listing is submitted. */
+} SIM800_SMSList_t;
+
+
+/**
+ * @brief   Structure representing the state of the SMS batch in progress, see SIM800_SendSMSBatch.
+ */
+typedef struct
+{
+    const char *const *recipients;              /*!< Destination phone numbers. */
+    uint16_t count;                             /*!< Count of recipients, 0 - no batch in progress. */
+    uint16_t next;                              /*!< Next recipient to submit. */
+    uint16_t finished;                          /*!< Count of recipients finished. */
+    const char *text;                           /*!< Message sent to every recipient. */
+    SIM800_SMSBatchCallback_t result;           /*!< Callback invoked for every recipient, may be NULL. */
+    void *ctx;                                  /*!< Argument of the callback. */
+} SIM800_SMSBatch_t;
+
+
+/**
+ * @brief   Enumeration of the priority classes of SIM800_QueueSMS, the highest first.
+ */
+typedef enum
+{
+    SIM800_SMSPriority_Critical,                /*!< Alarms. */
+    SIM800_SMSPriority_High,                    /*!< Messages the user waits for. */
+    SIM800_SMSPriority_Normal,                  /*!< Reports. */
+    SIM800_SMSPriority_Low,                     /*!< Telemetry. */
+    SIM800_SMSPriority_Count,
+} SIM800_SMSPriority_t;
+
+
+/**
+ * @brief   Structure representing the rate limits of the SMS scheduler, see SIM800_SetSMSRateLimit.
+ *
+ * Each limit is a token bucket: burst messages may leave back to back, then one more every period.
+ */
+typedef struct
+{
+    uint16_t burst;                             /*!< Messages of the module sent back to back. */
+    uint32_t period;                            /*!< Time after which the module may send one more message (ms), 0 - no limit. */
+    uint16_t destBurst;                         /*!< Messages one destination gets back to back. */
+    uint32_t destPeriod;                        /*!< Time after which one destination may get one more message (ms), 0 - no limit. */
+} SIM800_SMSRateLimit_t;
+
+
+/**
+ * @brief   Structure representing a message waiting in the SMS scheduler.
+ */
+typedef struct
+{
+    const char *destination;                    /*!< Destination phone number, NULL - the slot is free. */
+    const char *text;                           /*!< SMS message. */
+    uint32_t key;                               /*!< Hash of the destination. */
+    uint32_t order;                             /*!< Order of the submission, the oldest of a class leaves first. */
+    uint8_t priority;                           /*!< Priority class, see SIM800_SMSPriority_t. */
+    SIM800_RequestCallback_t done;              /*!< Completion callback, may be NULL. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+} SIM800_SMSJob_t;
+
+
+/**
+ * @brief   Structure representing the rate of a destination of the SMS scheduler.
+ */
+typedef struct
+{
+    uint32_t key;                               /*!< Hash of the destination. */
+    uint32_t tat;                               /*!< Tick at which the bucket is full again, not ahead of now - free. */
+} SIM800_SMSBucket_t;
+
+
+/**
+ * @brief   Structure representing a message of the SMS scheduler in the request queue.
+ */
+typedef struct
+{
+    SIM800_RequestCallback_t done;              /*!< Completion callback, may be NULL. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+    uint8_t busy;                               /*!< 1 while the slot holds a message. */
+} SIM800_SMSFlight_t;
+
+
+/**
+ * @brief   Structure representing the state of the SMS scheduler, see SIM800_QueueSMS.
+ */
+typedef struct
+{
+    SIM800_SMSJob_t jobs[SIM800_SMS_SCHED_LENGTH];  /*!< Waiting messages. */
+    uint32_t order;                             /*!< Order of the next submission. */
+    SIM800_SMSRateLimit_t limit;                /*!< Rate limits. */
+    uint8_t configured;                         /*!< 1 once the limits are set, the defaults of sim800_config.h otherwise. */
+    uint32_t tat;                               /*!< Tick at which the bucket of the module is full again. */
+    SIM800_SMSBucket_t buckets[SIM800_SMS_DEST_BUCKETS];  /*!< Rates of the recent destinations. */
+    SIM800_SMSFlight_t flight[SIM800_SMS_BATCH_INFLIGHT];  /*!< Messages in flight, the index of a slot is the context of its request. */
+    uint8_t flightCount;                        /*!< Count of messages in flight. */
+} SIM800_SMSScheduler_t;
+
+
+/**
+ * @brief   Structure representing a block waiting in the transmit queue.
+ *
+ * The data is either pinned (the owner keeps it unchanged until the block is sent) or copied
+ * into handle->txArena, in which case arena is the count of arena bytes released with the block.
+ */
+typedef struct
+{
+    const uint8_t *data;                        /*!< Data to send. */
+    uint16_t length;                            /*!< Count of bytes to send. */
+    uint16_t arena;                             /*!< Count of handle->txArena bytes owned by the block. */
+    SIM800_TxCallback_t done;                   /*!< Completion callback, may be NULL. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+} SIM800_TxBlock_t;
+
+
+/**
+ * @brief   Structure representing one piece of a scattered data block, see SIM800_SocketSendV.
+ */
+typedef struct
+{
+    const uint8_t *data;                        /*!< Bytes of the piece, pinned until the block is sent. */
+    uint16_t length;                            /*!< Count of bytes of the piece. */
+} SIM800_IOVec_t;
+
+
+#if SIM800_USE_SMS
+
+/**
+ * @brief   Structure representing a fixed SMS message with one variable field, see SIM800_PrepareSMSTemplate.
+ *
+ * The constant parts are encoded once: in text mode the text is sent as three pieces straight from the prefix
+ * and the suffix, in PDU mode the whole SMS-SUBMIT is packed in advance. A send only writes the field into
+ * the template (its septets in PDU mode), so one template is sent by one request at a time.
+ */
+typedef struct
+{
+    const char *destination;                    /*!< Destination phone number, as given. */
+    SIM800_IOVec_t text[3];                     /*!< Text of the message: the prefix, the field and the suffix. */
+    char field[SIM800_SMS_TEMPLATE_FIELD];      /*!< Field of the message being sent, padded with spaces. */
+    uint8_t fieldLength;                        /*!< Characters of the field. */
+#if SIM800_USE_PDU
+    uint8_t pdu[SIM800_PDU_MAX_OCTETS];         /*!< SMS-SUBMIT of the message, the field is written into it. */
+    uint8_t pduLength;                          /*!< Octets of pdu, 0 - the text does not fit into one message. */
+    uint16_t fieldBit;                          /*!< Bit offset of the field in pdu. */
+#endif
+    uint8_t reference;                          /*!< Message reference of the last send ("+CMGS: <mr>"). */
+    volatile uint8_t busy;                      /*!< 1 while a send of the template is in flight. */
+    SIM800_RequestCallback_t done;              /*!< Completion callback of the send in flight. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+} SIM800_SMSTemplate_t;
+
+#endif /* SIM800_USE_SMS */
+
+
+#if SIM800_USE_FS
+
+/**
+ * @brief   Structure representing a file in the flash of the module (C:\User\), see SIM800_FSOpen.
+ *
+ * The blocks written are appended to the file by "AT+FSWRITE" straight from the caller's buffers and read
+ * back by "AT+FSREAD" in windows of any size, so a payload larger than the RAM of the MCU can be staged in
+ * the module. One write of a file is in flight at a time.
+ */
+typedef struct
+{
+    char name[SIM800_FS_NAME_MAX + 1];          /*!< Name of the file. */
+    uint32_t size;                              /*!< Size of the file, the written blocks included. */
+    char arg[SIM800_FS_NAME_MAX + 16];          /*!< Argument of the write in flight. */
+    uint16_t length;                            /*!< Count of bytes of the write in flight. */
+    volatile uint8_t busy;                      /*!< 1 while a write is in flight. */
+    SIM800_RequestCallback_t done;              /*!< Completion callback of the write in flight. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+} SIM800_File_t;
+
+#endif /* SIM800_USE_FS */
+
+
+/**
+ * @brief   Structure representing one query of a batch, see SIM800_SubmitBatch.
+ */
+typedef struct
+{
+    SIM800_Command_t cmd;                       /*!< Query command, e.g. SIM800_Cmd_BatteryInfo. */
+    void *response;                             /*!< Structure filled by the response parser of the command. */
+    SIM800_Status_t status;                     /*!< Status of the query, set when the batch is finished. */
+    uint8_t index;                              /*!< Index of the expected code of the query (internal). */
+} SIM800_BatchItem_t;
+
+
+/**
+ * @brief   Structure representing the options of one request, see the SIM800_Submit...Ex functions.
+ *
+ * The options are passed with the call, so every task can give its requests their own; a zeroed structure
+ * gives the defaults.
+ */
+typedef struct
+{
+    uint32_t timeout;                           /*!< Maximum response time (ms), 0 - the timeout of the command table. */
+    uint32_t deadline;                          /*!< Tick the request must be finished by, 0 - none, see SIM800_SetDeadline. */
+    uint32_t token;                             /*!< Cancel token, 0 - none, see SIM800_Cancel. */
+} SIM800_RequestOptions_t;
+
+
+/**
+ * @brief   Structure representing a submitted AT command request.
+ *
+ * The argument and data strings are pinned: they must stay unchanged until the request is finished.
+ */
+typedef struct
+{
+    SIM800_Command_t cmd;                       /*!< Command to execute. */
+    const char *arg;                            /*!< Command argument, NULL if the command has none. */
+    const char *data;                           /*!< Data block sent on the "> " prompt, NULL if the command has none. */
+    uint16_t dataHex;                           /*!< Length of a binary data block sent in hex, 0 - the data block is a string. */
+    uint16_t dataLength;                        /*!< Length of a binary data block sent as it is, 0 - the data block is a string. */
+    const SIM800_IOVec_t *iov;                  /*!< Pieces of a scattered binary data block, NULL - the data block is data. */
+    uint8_t iovCount;                           /*!< Count of pieces. */
+    uint8_t ucs2;                               /*!< 1 if the argument and the data are UTF-8 sent as UCS2 hex. */
+    char number[11];                            /*!< Storage of a numeric argument. */
+    void *response;                             /*!< Structure filled by the response parser, may be NULL. */
+    SIM800_BatchItem_t *batch;                  /*!< Queries combined into the command line, NULL for a single command. */
+    uint8_t batchCount;                         /*!< Count of combined queries. */
+    SIM800_RequestCallback_t done;              /*!< Completion callback, may be NULL. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+    SIM800_RequestState_t state;                /*!< Request state. */
+    uint8_t index;                              /*!< Index of the expected code of the command. */
+    uint8_t attempt;                            /*!< Count of attempts made, see SIM800_SetRetryPolicy. */
+    uint32_t backoff;                           /*!< Time to wait before the command is sent again (ms). */
+    uint32_t timeout;                           /*!< Maximum response time (ms). */
+    uint32_t tickStart;                         /*!< Tick at which the command has been sent. */
+    uint32_t deadline;                          /*!< Tick the request must be finished by, 0 - none, see SIM800_SetDeadline. */
+    uint32_t token;                             /*!< Cancel token, 0 - none, see SIM800_Cancel. */
+    uint8_t cancel;                             /*!< 1 - cancelled at the end of its transfer, 2 - cancelled, the final result is drained. */
+    SIM800_Status_t cancelStatus;               /*!< Status the cancelled request is finished with. */
+} SIM800_Request_t;
+
+
+/**
+ * @brief   Structure representing a expected message codes.
+ *
+ * The response lines are not stored, every line is handed to the parser as soon as it is received
+ * and the parser fills the response structure, so a response of any length needs constant memory.
+ * The code text is not copied either, it points to a constant string (a literal or the command table),
+ * which keeps the descriptor small: the handle holds one per command, notification and socket.
+ */
+typedef struct
+{
+    const char *code;                           /*!< Message code, a constant string. */
+    SIM800_Status_t (*parser)(SIM800_Handle_t *, uint8_t, const SIM800_Line_t *);  /*!< Response line parser. */
+    void *response;                             /*!< Structure filled by the parser. */
+    void (*handle)(void *, uint32_t);           /*!< Message handler function. */
+    SIM800_Status_t parsed;                     /*!< Parse status of the response. */
+    SIM800_Status_t result;                     /*!< Final result: SIM800_OK for "OK", SIM800_ERROR otherwise. */
+    SIM800_ExpectedCodeState_t state;           /*!< Message state. */
+    uint16_t lines_count;                       /*!< Count of response lines (and line chunks) parsed so far. */
+    uint8_t code_length;                        /*!< Length of the message code. */
+    uint8_t next;                               /*!< Next expected code in the same dispatch bucket (index + 1, 0 - none). */
+} SIM800_ExpectedCode_t;
+
+
+/**
+ * @brief   Callback of an event subscriber, see SIM800_Subscribe.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *event: Event, see SIM800_EventType_t for its arguments.
+ * @param   *ctx: Argument given to SIM800_Subscribe.
+ */
+typedef void (*SIM800_EventCallback_t)(SIM800_Handle_t *handle, const SIM800_Event_t *event, void *ctx);
+
+
+/**
+ * @brief   Structure representing an event subscriber.
+ */
+typedef struct
+{
+    uint32_t mask;                              /*!< Events taken, SIM800_EVT_... combined. */
+    SIM800_EventCallback_t callback;            /*!< Callback, NULL - the entry is free. */
+    void *ctx;                                  /*!< Argument of the callback. */
+} SIM800_Subscriber_t;
+
+
+/*
+ * Return values of a flow function, see SIM800_FlowFunction_t
+ */
+#define SIM800_FLOW_WAITING						0		/* The flow waits, it is resumed by SIM800_Poll. */
+#define SIM800_FLOW_ENDED						1		/* The flow has ended, it is removed from the handle. */
+
+
+typedef struct SIM800_Flow SIM800_Flow_t;
+
+
+/**
+ * @brief   Body of a flow, written with the macros of sim800_flow.h.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *flow: Pointer to the flow structure, its ctx is the argument given to SIM800_StartFlow.
+ * @retval  SIM800_FLOW_WAITING or SIM800_FLOW_ENDED.
+ */
+typedef uint8_t (*SIM800_FlowFunction_t)(SIM800_Handle_t *handle, SIM800_Flow_t *flow);
+
+
+/**
+ * @brief   Structure representing a flow, a stackless coroutine resumed by SIM800_Poll, see sim800_flow.h.
+ *
+ * The structure is the whole state of the flow: the point it waits at and the status of the request it
+ * awaited. The local variables of the function do not survive a wait, keep them in ctx or make them static.
+ */
+struct SIM800_Flow
+{
+    uint16_t line;                              /*!< Resume point, the source line of the last wait, 0 - the start. */
+    volatile uint8_t pending;                   /*!< 1 while the flow awaits the completion of a request. */
+    SIM800_Status_t status;                     /*!< Status of the last awaited request. */
+    uint32_t tick;                              /*!< Start of SIM800_FLOW_DELAY. */
+    SIM800_FlowFunction_t function;             /*!< Body of the flow. */
+    void *ctx;                                  /*!< Argument of the application. */
+    SIM800_Flow_t *next;                        /*!< Next flow of the handle. */
+};
+
+
+/**
+ * @brief   Structure representing the SIM800 module handle.
+ */
+struct SIM800_Handle
+{
+    UART_HandleTypeDef *uart;                    /*!< UART the module is connected to, must be set before receiving is started. */
+    const SIM800_Link_t *link;                   /*!< Link replacing the UART, NULL - none, see SIM800_AttachLink. */
+    void *linkCtx;                               /*!< Argument of the link functions. */
+    uint16_t linkOffset;                         /*!< Count of bytes of the block at txTail the link has taken. */
+    uint8_t linkSending;                         /*!< Set while the queued blocks are handed to the link, guards against re-entrance. */
+    SIM800_RawRxCallback_t rawRx;                /*!< Receiver of all the characters, NULL - they are parsed as lines. */
+    void *rawCtx;                                /*!< Argument of the raw receiver. */
+    uint32_t baudRate;                           /*!< Last baud rate verified by SIM800_NegotiateBaud or SIM800_AutoBaud, 0 - unknown. */
+
+    char rcvdByte;                               /*!< Received byte. */
+
+    SIM800_RxMode_t rxMode;                      /*!< Receiving mode, must be set before receiving is started. */
+    uint8_t rxRing[RX_RING_LENGTH];              /*!< Single-producer/single-consumer receive ring (DMA buffer in DMA mode). */
+    volatile uint32_t rxHead;                    /*!< Free-running write index, advanced only by the UART ISR. */
+    volatile uint32_t rxTail;                    /*!< Free-running release index, advanced only by SIM800_Process. */
+    uint32_t rxScan;                             /*!< Free-running index of the next character to parse. */
+    uint32_t rxLineStart;                        /*!< Free-running index of the first character of the current line. */
+    uint8_t rxChunked;                           /*!< 1 if the current line has been handed over partially already. */
+    uint32_t rxOverruns;                         /*!< Count of ring overruns (bytes lost before they were processed). */
+    uint8_t processing;                          /*!< Set while SIM800_Process parses, guards against re-entrance. */
+    uint8_t flowControl;                         /*!< 1 if RTS/CTS flow control is enabled, see SIM800_ManageFlowControl. */
+    volatile uint8_t rxStalled;                  /*!< 1 while the reception is stopped at the high-water mark. */
+    volatile uint8_t rxRestart;                  /*!< 1 if the HAL has stopped the DMA reception on an error. */
+    SIM800_PromptState_t prompt;                 /*!< State of the "> " data prompt. */
+
+    SIM800_TxMode_t txMode;                      /*!< Transmitting mode. */
+    SIM800_TxBlock_t txQueue[TX_QUEUE_LENGTH];   /*!< Queue of blocks to transmit, the block at txTail is being sent. */
+    volatile uint32_t txHead;                    /*!< Free-running queue write index, advanced by the submitting code. */
+    volatile uint32_t txTail;                    /*!< Free-running queue read index, advanced when a block is sent. */
+    volatile uint8_t txBusy;                     /*!< 1 while the block at txTail is being sent. */
+    uint8_t txArena[TX_ARENA_LENGTH];            /*!< Ring of copies of transient transmit data (command arguments). */
+    uint32_t txArenaHead;                        /*!< Free-running arena allocation index. */
+    volatile uint32_t txArenaTail;               /*!< Free-running arena release index. */
+    uint32_t txErrors;                           /*!< Count of blocks the UART refused to send. */
+
+    SIM800_Request_t requests[REQUEST_QUEUE_LENGTH];  /*!< Queue of submitted requests, the request at reqTail is executed. */
+    volatile uint32_t reqHead;                    /*!< Free-running request queue write index. */
+    volatile uint32_t reqTail;                    /*!< Free-running request queue read index. */
+    uint32_t reqPrimask;                          /*!< PRIMASK of the task submitting a request, see claim_request. */
+    SIM800_RequestOptions_t nextOptions;          /*!< Options of the next request of the application, see SIM800_SetTimeout. */
+
+    SIM800_ExpectedCode_t expected_codes[EXPECTED_CODES_MAX_COUNT];  /*!< Array of expected codes and messages. */
+    uint8_t dispatch[DISPATCH_TABLE_SIZE];        /*!< Hash buckets of expected codes by code (index + 1, 0 - empty). */
+
+    size_t expected_codes_count;                  /*!< Count of expected codes. */
+    uint32_t curProccesPacket_index;              /*!< Index of the expected code the response lines are handed to. */
+    SIM800_ReceivingStatus_t recStatus;           /*!< Receiving status. */
+#if SIM800_USE_SMS
+    uint8_t smsNotifications;                     /*!< Index + 1 of the +CMTI expected code, 0 - notifications disabled. */
+    uint8_t smsDirect;                            /*!< Index + 1 of the +CMT expected code, 0 - direct delivery disabled. */
+    uint8_t smsPDU;                               /*!< 1 if the module is in SMS PDU mode ("AT+CMGF=0"). */
+    uint8_t smsUCS2;                              /*!< 1 if the character set of the module is UCS2 ("AT+CSCS=\"UCS2\""). */
+    uint16_t ucs2Code;                            /*!< Hex digits of the UCS2 character being received. */
+    uint8_t ucs2Digits;                           /*!< Count of received hex digits of ucs2Code. */
+    uint16_t ucs2High;                            /*!< Pending high surrogate, 0 - none. */
+#if SIM800_USE_PDU
+    uint8_t pduRx[SIM800_PDU_MAX_OCTETS];         /*!< PDU of the message being received. */
+    uint16_t pduRxLength;                         /*!< Count of octets in pduRx. */
+    uint8_t pduRxNibble;                          /*!< Pending high nibble of the next octet, 0xFF - none. */
+    uint8_t pduRxDone;                            /*!< 1 once the PDU line of the message is complete. */
+    uint8_t smsConcatRef;                         /*!< Reference of the next sent long message. */
+    SIM800_LongSMS_t longSMS[SIM800_SMS_CONCAT_MAX];  /*!< Long messages being reassembled. */
+#endif
+    uint8_t smsReports;                           /*!< Index + 1 of the +CDS expected code, 0 - delivery reports disabled. */
+    SIM800_SMSReport_t reports[SIM800_SMS_REPORTS_MAX];  /*!< Sent messages waiting for their delivery reports. */
+    uint8_t smsAutoDelete;                        /*!< 1 if the messages are deleted once consumed, see SIM800_ManageSMSAutoDelete. */
+    SIM800_SMSStorage_t smsStorage;               /*!< Occupancy of the SMS storage. */
+    uint16_t smsDeletes[SIM800_SMS_DELETE_BATCH]; /*!< Indices of the consumed messages waiting for deletion. */
+    uint8_t smsDeleteCount;                       /*!< Count of indices in smsDeletes. */
+    uint8_t smsDeleteRead;                        /*!< 1 if more messages were consumed than fit smsDeletes, all read ones are deleted. */
+    uint8_t smsDeletePending;                     /*!< 1 while a deletion is submitted. */
+    char smsDeleteLine[SIM800_SMS_DELETE_BATCH * 10];  /*!< Command line of the submitted deletion. */
+#endif
+    uint8_t regNotifications;                     /*!< Index + 1 of the +CREG expected code, 0 - notifications disabled. */
+    SIM800_NetworkRegStatus_t regStatus;          /*!< Last network registration status reported by the module. */
+    uint16_t regLac;                              /*!< Location area code of the serving cell, reported in mode 2. */
+    uint16_t regCellId;                           /*!< Cell ID of the serving cell, reported in mode 2. */
+#if SIM800_USE_REG_CACHE
+    SIM800_RegCacheState_t regCache;              /*!< Operator and band of the last registration, see SIM800_SetRegCache. */
+#endif
+    SIM800_Call_t call;                           /*!< Incoming voice calls, see SIM800_ManageCalls. */
+#if SIM800_USE_GNSS
+    SIM800_GNSS_t gnss;                           /*!< GNSS receiver of the SIM808/SIM868, see SIM800_ManageGNSS. */
+#endif
+    SIM800_USSDSession_t ussd;                    /*!< USSD queries, see SIM800_SendUSSD. */
+    uint8_t bootState;                            /*!< Boot state bits, see SIM800_BootState_t. */
+    uint32_t resets;                              /*!< Count of unexpected module resets detected. */
+    SIM800_Error_t lastError;                     /*!< Final result code of the last finished command, valid in its completion callback. */
+
+#if SIM800_USE_SMS
+    SIM800_SMSMessage_t smsSlots[SIM800_SMS_QUEUE_LENGTH];  /*!< Inbound SMS messages, the slot at smsHead is being parsed. */
+    volatile uint32_t smsHead;                    /*!< Free-running inbound queue write index. */
+    volatile uint32_t smsTail;                    /*!< Free-running inbound queue read index, advanced by SIM800_ReleaseSMS. */
+    uint32_t smsFreed;                            /*!< Free-running index of the released slots handled by SIM800_Poll. */
+    uint8_t smsQueue;                             /*!< 1 if the received messages are queued, see SIM800_ManageSMSQueue. */
+    uint32_t smsDropped;                          /*!< Count of messages not queued because the queue was full. */
+    SIM800_SMSList_t smsList;                     /*!< State of SIM800_ReadAllSMS. */
+    SIM800_SMSBatch_t smsBatch;                   /*!< State of SIM800_SendSMSBatch. */
+    SIM800_SMSScheduler_t smsSched;               /*!< State of SIM800_QueueSMS. */
+#endif
+
+    SIM800_CacheEntry_t cache[SIM800_Cache_Count];  /*!< State of the cached values, see SIM800_SetCacheTTL. */
+    SIM800_RetryRule_t retry[SIM800_RETRY_RULES];   /*!< Commands retried on transient errors, see SIM800_SetRetryPolicy. */
+    uint32_t retries;                             /*!< Count of requests sent again. */
+    SIM800_EventQueue_t events;                   /*!< Notifications awaiting their callback, drained by SIM800_Poll. */
+    SIM800_Subscriber_t subscribers[SIM800_SUBSCRIBERS];  /*!< Event subscribers, see SIM800_Subscribe. */
+    SIM800_Flow_t *flows;                         /*!< Flows resumed by SIM800_Poll, see SIM800_StartFlow. */
+#if SIM800_USE_STATS
+    SIM800_Stats_t stats;                         /*!< Counters of the driver, see SIM800_GetStats. */
+    uint32_t rxCounted;                           /*!< Receive ring write index counted in rxBytes. */
+#endif
+#if SIM800_USE_LATENCY
+    SIM800_LatencyMonitor_t latency;              /*!< Latency histograms of the commands, see SIM800_GetLatency. */
+#endif
+#if SIM800_USE_ISR_BUDGET
+    SIM800_ISRMonitor_t isr;                      /*!< Execution time of the interrupt handlers, see SIM800_SetISRBudget. */
+#endif
+#if SIM800_USE_TRACE
+    SIM800_Trace_t trace;                         /*!< Trace ring of the traffic, see SIM800_TraceDump. */
+#endif
+#if SIM800_USE_SLEEP
+    SIM800_Sleep_t sleep;                         /*!< Sleep mode of the module, see SIM800_ManageSleep. */
+#endif
+#if SIM800_USE_PHONEBOOK
+    SIM800_Phonebook_t phonebook;                 /*!< Index of the SIM phonebook, see SIM800_LoadPhonebook. */
+#endif
+    const SIM800_Config_t *config;                /*!< Configuration applied by SIM800_Init, replayed by the watchdog. */
+    SIM800_Watchdog_t watchdog;                   /*!< Health watchdog, see SIM800_ManageWatchdog. */
+    SIM800_Battery_t battery;                     /*!< Cached battery information. */
+    SIM800_Signal_t signal;                       /*!< Cached signal quality. */
+    SIM800_SignalSampler_t signalSampler;         /*!< Background sampler of the signal quality. */
+    SIM800_NetworkTime_t time;                    /*!< Clock kept from the network time. */
+    char imei[SIM800_ID_LENGTH];                  /*!< Cached IMEI. */
+    char iccid[SIM800_ID_LENGTH];                 /*!< Cached ICCID. */
+    SIM800_CellInfo_t cellInfo;                   /*!< Cached serving and neighbour cells. */
+#if SIM800_USE_HTTP
+    SIM800_Location_t location;                   /*!< Cached location. */
+#endif
+
+#if SIM800_USE_GPRS
+    SIM800_Socket_t sockets[SIM800_SOCKET_COUNT]; /*!< Connections of the multi-connection mode. */
+    uint8_t socketNotifications;                  /*!< Index + 1 of the +RECEIVE expected code, 0 - sockets not initialised. */
+    uint16_t rxRaw;                               /*!< Count of raw data bytes of "+RECEIVE" still to receive. */
+    uint8_t rxRawSocket;                          /*!< Socket the raw data is received by. */
+    uint8_t *rxRawBuffer;                         /*!< Buffer the raw data of "+CIPRXGET: 2" is copied to, NULL - the socket ring. */
+    uint8_t socketManual;                         /*!< Index + 1 of the +CIPRXGET expected code, 0 - automatic receive mode. */
+#if SIM800_USE_HTTP
+    uint8_t rxRawHttp;                            /*!< 1 if the raw data is the body of an HTTP response, see SIM800_Http_t. */
+    SIM800_Http_t http;                           /*!< State of the HTTP client. */
+#endif
+    SIM800_Bearer_t bearer;                       /*!< GPRS bearer. */
+    SIM800_DNS_t dns;                             /*!< Cache of resolved host names. */
+    char localIP[16];                             /*!< Local IP address reported by "AT+CIFSR". */
+    SIM800_Transparent_t transparent;             /*!< State of the transparent data pipe. */
+    volatile uint8_t carrierLost;                 /*!< Set by SIM800_DCDHandler, the connection ends at carrierHead. */
+    volatile uint32_t carrierHead;                /*!< Receive ring write index at which the carrier has been lost. */
+#endif
+};
+
+
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_ManageReceiving				(SIM800_Handle_t *handle, uint8_t enordi);
+void SIM800_AttachLink								(SIM800_Handle_t *handle, const SIM800_Link_t *link, void *ctx);
+uint16_t SIM800_LinkInput							(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length);
+SIM800_Status_t SIM800_EnterMux						(SIM800_Handle_t *handle, SIM800_RawRxCallback_t rx, void *ctx);
+void SIM800_LeaveMux								(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_Init							(SIM800_Handle_t *handle, const SIM800_Config_t *config);
+SIM800_Status_t SIM800_GetBatteryInfo				(SIM800_Handle_t *handle, SIM800_Battery_t *battery);
+SIM800_Status_t SIM800_GetStatus					(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_Query						(SIM800_Handle_t *handle, const char *command, const char *code,
+													 const char *format, ...);
+
+SIM800_NetworkRegStatus_t SIM800_GetNetworkRegStatus(SIM800_Handle_t *handle);
+
+SIM800_Status_t SIM800_SetCharset					(SIM800_Handle_t *handle, const char *charset);
+
+#if SIM800_USE_SMS
+SIM800_Status_t SIM800_SetSMSTextMode				(SIM800_Handle_t *handle);
+#if SIM800_USE_PDU
+SIM800_Status_t SIM800_SetSMSPDUMode				(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_SendLongSMSMessage			(SIM800_Handle_t *handle, const char *destination, const char *text);
+#endif
+SIM800_Status_t SIM800_DeleteAllSMSMessages			(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_SendSMSMessage				(SIM800_Handle_t *handle, char *destination, char *message);
+SIM800_Status_t SIM800_SendSMSMessageRef			(SIM800_Handle_t *handle, const char *destination, const char *message,
+													 uint8_t *reference);
+SIM800_Status_t SIM800_PrepareSMSTemplate			(SIM800_SMSTemplate_t *tpl, const char *destination, const char *prefix,
+													 uint8_t fieldLength, const char *suffix);
+SIM800_Status_t SIM800_SendSMSTemplate				(SIM800_Handle_t *handle, SIM800_SMSTemplate_t *tpl, const char *field);
+SIM800_Status_t SIM800_ManageDeliveryReports		(SIM800_Handle_t *handle, uint8_t enordi);
+SIM800_Status_t SIM800_SendSMSBatch					(SIM800_Handle_t *handle, const char *const *recipients, uint16_t count,
+													 const char *text, SIM800_SMSBatchCallback_t result, void *ctx);
+SIM800_Status_t SIM800_QueueSMS						(SIM800_Handle_t *handle, const char *destination, const char *text,
+													 SIM800_SMSPriority_t priority, SIM800_RequestCallback_t done, void *ctx);
+void SIM800_SetSMSRateLimit							(SIM800_Handle_t *handle, const SIM800_SMSRateLimit_t *limit);
+SIM800_Status_t SIM800_ManageSMSNotifications		(SIM800_Handle_t *handle, uint8_t enordi);
+SIM800_Status_t SIM800_RequestSMSMessage			(SIM800_Handle_t *handle, uint32_t sms_index);
+SIM800_Status_t SIM800_DeleteSMSMessage				(SIM800_Handle_t *handle, uint32_t sms_index);
+SIM800_Status_t SIM800_GetSMSStorage				(SIM800_Handle_t *handle, SIM800_SMSStorage_t *storage);
+SIM800_Status_t SIM800_ManageSMSAutoDelete			(SIM800_Handle_t *handle, uint8_t enordi);
+void SIM800_ManageSMSQueue							(SIM800_Handle_t *handle, uint8_t enordi);
+SIM800_SMSMessage_t *SIM800_ReceiveSMS				(SIM800_Handle_t *handle);
+void SIM800_ReleaseSMS								(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_ManageSMSDelivery			(SIM800_Handle_t *handle, SIM800_SMSDelivery_t mode);
+SIM800_Status_t SIM800_ReadAllSMS					(SIM800_Handle_t *handle, SIM800_SMSFilter_t filter,
+													 SIM800_SMSCallback_t callback, void *ctx);
+#endif /* SIM800_USE_SMS */
+
+#if SIM800_USE_GPRS
+SIM800_Status_t SIM800_BearerInit					(SIM800_Handle_t *handle, const char *apn);
+SIM800_Status_t SIM800_BearerUp						(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_BearerDown					(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_Resolve						(SIM800_Handle_t *handle, const char *host, char *ip);
+void SIM800_DNSInvalidate							(SIM800_Handle_t *handle, const char *host);
+
+SIM800_Status_t SIM800_SocketInit					(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_SocketOpen					(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketType_t type,
+													 const char *host, uint16_t port);
+SIM800_Status_t SIM800_SocketSend					(SIM800_Handle_t *handle, uint8_t socket, const uint8_t *data, uint16_t length);
+SIM800_Status_t SIM800_SocketSendV					(SIM800_Handle_t *handle, uint8_t socket, const SIM800_IOVec_t *iov, uint8_t count);
+uint16_t SIM800_SocketRecv							(SIM800_Handle_t *handle, uint8_t socket, uint8_t *buffer, uint16_t size);
+SIM800_Status_t SIM800_SocketClose					(SIM800_Handle_t *handle, uint8_t socket);
+SIM800_Status_t SIM800_ManageManualReceive			(SIM800_Handle_t *handle, uint8_t enordi);
+SIM800_Status_t SIM800_SocketRead					(SIM800_Handle_t *handle, uint8_t socket, uint8_t *buffer, uint16_t size,
+													 uint16_t *length);
+
+#if SIM800_USE_HTTP
+SIM800_Status_t SIM800_HttpGet						(SIM800_Handle_t *handle, const char *url, uint16_t *status,
+													 SIM800_HttpBodyCallback_t body, void *ctx);
+SIM800_Status_t SIM800_HttpPost						(SIM800_Handle_t *handle, const char *url, const char *contentType,
+													 const uint8_t *data, uint16_t length, uint16_t *status,
+													 SIM800_HttpBodyCallback_t body, void *ctx);
+#endif
+
+SIM800_Status_t SIM800_TransparentInit				(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_TransparentOpen				(SIM800_Handle_t *handle, SIM800_SocketType_t type, const char *host, uint16_t port);
+SIM800_Status_t SIM800_TransparentSend				(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length,
+													 SIM800_TxCallback_t done, void *ctx);
+SIM800_Status_t SIM800_TransparentEscape			(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_TransparentResume			(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_TransparentClose				(SIM800_Handle_t *handle);
+#endif /* SIM800_USE_GPRS */
+
+SIM800_Status_t SIM800_SubmitStatus					(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitStatusEx				(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitBatteryInfo			(SIM800_Handle_t *handle, SIM800_Battery_t *battery,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitBatteryInfoEx			(SIM800_Handle_t *handle, SIM800_Battery_t *battery,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitNetworkRegStatus		(SIM800_Handle_t *handle, SIM800_NetworkRegStatus_t *status,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitNetworkRegStatusEx		(SIM800_Handle_t *handle, SIM800_NetworkRegStatus_t *status,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+#if SIM800_USE_SMS
+SIM800_Status_t SIM800_SubmitSMSTextMode			(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitSMSTextModeEx			(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitDeleteAllSMSMessages	(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitDeleteAllSMSMessagesEx	(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitSMSMessage				(SIM800_Handle_t *handle, const char *destination, const char *message,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitSMSMessageEx			(SIM800_Handle_t *handle, const char *destination, const char *message,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitSMSTemplate			(SIM800_Handle_t *handle, SIM800_SMSTemplate_t *tpl, const char *field,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitSMSTemplateEx			(SIM800_Handle_t *handle, SIM800_SMSTemplate_t *tpl, const char *field,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitReadSMSMessage			(SIM800_Handle_t *handle, uint32_t sms_index, SIM800_SMSMessage_t *message,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitReadSMSMessageEx		(SIM800_Handle_t *handle, uint32_t sms_index, SIM800_SMSMessage_t *message,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitReadAllSMS				(SIM800_Handle_t *handle, SIM800_SMSFilter_t filter,
+													 SIM800_SMSCallback_t callback, void *ctx,
+													 SIM800_RequestCallback_t done, void *doneCtx);
+SIM800_Status_t SIM800_SubmitReadAllSMSEx			(SIM800_Handle_t *handle, SIM800_SMSFilter_t filter,
+													 SIM800_SMSCallback_t callback, void *ctx,
+													 SIM800_RequestCallback_t done, void *doneCtx,
+													 const SIM800_RequestOptions_t *options);
+#endif
+#if SIM800_USE_GPRS
+SIM800_Status_t SIM800_SubmitSocketSend				(SIM800_Handle_t *handle, uint8_t socket, const uint8_t *data, uint16_t length,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitSocketSendEx			(SIM800_Handle_t *handle, uint8_t socket, const uint8_t *data, uint16_t length,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitSocketSendV			(SIM800_Handle_t *handle, uint8_t socket, const SIM800_IOVec_t *iov, uint8_t count,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitSocketSendVEx			(SIM800_Handle_t *handle, uint8_t socket, const SIM800_IOVec_t *iov, uint8_t count,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_SubmitSocketRead				(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketRead_t *read,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitSocketReadEx			(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketRead_t *read,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+#endif
+
+SIM800_Status_t SIM800_NegotiateBaud				(SIM800_Handle_t *handle, uint32_t baud);
+SIM800_Status_t SIM800_AutoBaud						(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_ManageFlowControl			(SIM800_Handle_t *handle, uint8_t enordi);
+
+SIM800_Status_t SIM800_GetSignalQuality			(SIM800_Handle_t *handle, SIM800_Signal_t *signal);
+void SIM800_ManageSignalSampling					(SIM800_Handle_t *handle, uint32_t period);
+SIM800_Status_t SIM800_GetSignalStats				(SIM800_Handle_t *handle, uint8_t window, SIM800_SignalStats_t *stats);
+uint8_t SIM800_IsSignalUsable						(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_GetIMEI						(SIM800_Handle_t *handle, char *imei);
+SIM800_Status_t SIM800_GetICCID						(SIM800_Handle_t *handle, char *iccid);
+SIM800_Status_t SIM800_GetCellInfo					(SIM800_Handle_t *handle, SIM800_CellInfo_t *info);
+#if SIM800_USE_HTTP
+SIM800_Status_t SIM800_GetLocation					(SIM800_Handle_t *handle, SIM800_Location_t *location);
+#endif
+
+void SIM800_SetCacheTTL								(SIM800_Handle_t *handle, SIM800_CacheItem_t item, uint32_t ttl, uint8_t background);
+void SIM800_InvalidateCache							(SIM800_Handle_t *handle, SIM800_CacheItem_t item);
+SIM800_Status_t SIM800_SetRetryPolicy				(SIM800_Handle_t *handle, SIM800_Command_t cmd,
+													 const SIM800_RetryPolicy_t *policy);
+SIM800_Status_t SIM800_Subscribe					(SIM800_Handle_t *handle, uint32_t mask, SIM800_EventCallback_t callback,
+													 void *ctx);
+void SIM800_Unsubscribe								(SIM800_Handle_t *handle, SIM800_EventCallback_t callback, void *ctx);
+SIM800_Status_t SIM800_StartFlow					(SIM800_Handle_t *handle, SIM800_Flow_t *flow, SIM800_FlowFunction_t function,
+													 void *ctx);
+void SIM800_StopFlow								(SIM800_Handle_t *handle, SIM800_Flow_t *flow);
+void SIM800_FlowCallback							(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+void SIM800_FlowSubmitted							(SIM800_Flow_t *flow, SIM800_Status_t status);
+SIM800_Status_t SIM800_ManageWatchdog				(SIM800_Handle_t *handle, uint8_t enordi);
+#if SIM800_USE_SLEEP
+SIM800_Status_t SIM800_ManageSleep					(SIM800_Handle_t *handle, GPIO_TypeDef *dtrPort, uint16_t dtrPin);
+SIM800_Status_t SIM800_EnterStop					(SIM800_Handle_t *handle);
+#endif
+#if SIM800_USE_PHONEBOOK
+SIM800_Status_t SIM800_LoadPhonebook				(SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_SubmitLoadPhonebook			(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitLoadPhonebookEx		(SIM800_Handle_t *handle, SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+uint8_t SIM800_IsInPhonebook						(SIM800_Handle_t *handle, const char *number);
+void SIM800_SetPhonebookRefresh						(SIM800_Handle_t *handle, uint32_t period);
+void SIM800_InvalidatePhonebook						(SIM800_Handle_t *handle);
+#endif
+#if SIM800_USE_STATS
+void SIM800_GetStats								(SIM800_Handle_t *handle, SIM800_Stats_t *stats);
+void SIM800_ResetStats								(SIM800_Handle_t *handle);
+#endif
+#if SIM800_USE_LATENCY
+SIM800_Status_t SIM800_GetLatency					(SIM800_Handle_t *handle, SIM800_Command_t cmd, SIM800_Latency_t *latency);
+void SIM800_ResetLatency							(SIM800_Handle_t *handle);
+#endif
+#if SIM800_USE_ISR_BUDGET
+void SIM800_SetISRBudget							(SIM800_Handle_t *handle, uint32_t budget);
+void SIM800_GetISRStats								(SIM800_Handle_t *handle, SIM800_ISRStats_t *stats);
+void SIM800_ResetISRStats							(SIM800_Handle_t *handle);
+#endif
+#if SIM800_USE_TRACE
+void SIM800_TraceDump								(SIM800_Handle_t *handle, SIM800_TraceWriter_t write, void *ctx);
+void SIM800_TraceClear								(SIM800_Handle_t *handle);
+#endif
+
+SIM800_Status_t SIM800_ManageRegNotifications		(SIM800_Handle_t *handle, uint8_t mode);
+#if SIM800_USE_REG_CACHE
+void SIM800_SetRegCache								(SIM800_Handle_t *handle, const SIM800_RegCache_t *cache);
+uint32_t SIM800_GetRegTime							(SIM800_Handle_t *handle, uint8_t *cached);
+#endif
+SIM800_Status_t SIM800_ManageNetworkTime			(SIM800_Handle_t *handle, uint8_t enordi);
+SIM800_Status_t SIM800_GetTime						(SIM800_Handle_t *handle, SIM800_Time_t *time);
+SIM800_Status_t SIM800_ManageCalls					(SIM800_Handle_t *handle, SIM800_CallMode_t mode);
+SIM800_Status_t SIM800_HangUp						(SIM800_Handle_t *handle);
+#if SIM800_USE_GNSS
+SIM800_Status_t SIM800_ManageGNSS					(SIM800_Handle_t *handle, uint8_t enordi);
+SIM800_Status_t SIM800_ManageGNSSStream				(SIM800_Handle_t *handle, uint8_t period);
+SIM800_Status_t SIM800_GetGNSSFix					(SIM800_Handle_t *handle, SIM800_GNSSFix_t *fix);
+#endif
+#if SIM800_USE_FS
+SIM800_Status_t SIM800_FSOpen						(SIM800_Handle_t *handle, SIM800_File_t *file, const char *name, uint8_t create);
+SIM800_Status_t SIM800_FSWrite						(SIM800_Handle_t *handle, SIM800_File_t *file, const uint8_t *data, uint16_t length);
+SIM800_Status_t SIM800_SubmitFSWrite				(SIM800_Handle_t *handle, SIM800_File_t *file, const uint8_t *data, uint16_t length,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitFSWriteEx				(SIM800_Handle_t *handle, SIM800_File_t *file, const uint8_t *data, uint16_t length,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_FSRead						(SIM800_Handle_t *handle, SIM800_File_t *file, uint32_t position, uint8_t *buffer,
+													 uint16_t length);
+SIM800_Status_t SIM800_FSDelete						(SIM800_Handle_t *handle, SIM800_File_t *file);
+SIM800_Status_t SIM800_SocketSendFile				(SIM800_Handle_t *handle, uint8_t socket, SIM800_File_t *file, uint32_t position,
+													 uint32_t length, uint8_t *buffer, uint16_t size);
+#endif
+SIM800_Status_t SIM800_SendUSSD						(SIM800_Handle_t *handle, const char *code, SIM800_USSDCallback_t callback,
+													 void *ctx);
+SIM800_Status_t SIM800_SendUSSDEx					(SIM800_Handle_t *handle, const char *code, SIM800_USSDCallback_t callback,
+													 void *ctx,
+													 const SIM800_RequestOptions_t *options);
+SIM800_Status_t SIM800_GetBalance					(SIM800_Handle_t *handle, SIM800_Balance_t *balance);
+
+void SIM800_SetTimeout								(SIM800_Handle_t *handle, uint32_t timeout);
+void SIM800_SetDeadline								(SIM800_Handle_t *handle, uint32_t deadline);
+void SIM800_SetCancelToken							(SIM800_Handle_t *handle, uint32_t token);
+uint8_t SIM800_Cancel								(SIM800_Handle_t *handle, uint32_t token);
+
+SIM800_Status_t SIM800_QueryBatch					(SIM800_Handle_t *handle, SIM800_BatchItem_t *items, uint8_t count);
+SIM800_Status_t SIM800_SubmitBatch					(SIM800_Handle_t *handle, SIM800_BatchItem_t *items, uint8_t count,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_SubmitBatchEx				(SIM800_Handle_t *handle, SIM800_BatchItem_t *items, uint8_t count,
+													 SIM800_RequestCallback_t done, void *ctx,
+													 const SIM800_RequestOptions_t *options);
+
+SIM800_Status_t SIM800_Transmit						(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length,
+													 SIM800_TxCallback_t done, void *ctx);
+
+void SIM800_MessageHandler							(SIM800_Handle_t *handle);
+void SIM800_RxEventHandler							(SIM800_Handle_t *handle, uint16_t pos);
+void SIM800_TxCpltHandler							(SIM800_Handle_t *handle);
+void SIM800_ErrorHandler							(SIM800_Handle_t *handle);
+void SIM800_DCDHandler								(SIM800_Handle_t *handle);
+#if SIM800_USE_SLEEP
+void SIM800_RIHandler								(SIM800_Handle_t *handle);
+#endif
+void SIM800_Process									(SIM800_Handle_t *handle);
+
+SIM800_Handle_t *SIM800_GetHandle					(UART_HandleTypeDef *huart);
+void SIM800_UART_RxCpltCallback						(UART_HandleTypeDef *huart);
+void SIM800_UART_RxEventCallback					(UART_HandleTypeDef *huart, uint16_t pos);
+void SIM800_UART_TxCpltCallback						(UART_HandleTypeDef *huart);
+void SIM800_UART_ErrorCallback						(UART_HandleTypeDef *huart);
+void SIM800_Poll									(SIM800_Handle_t *handle);
+
+
+
+
+/*********************************************************************************************
+ *									OS abstraction functions
+ ********************************************************************************************/
+
+void SIM800_OS_Wait(SIM800_Handle_t *handle, uint32_t timeout);
+void SIM800_OS_Signal(SIM800_Handle_t *handle);
+uint8_t SIM800_OS_IsExecutor(SIM800_Handle_t *handle);
+#if SIM800_USE_SLEEP
+void SIM800_OS_Stop(SIM800_Handle_t *handle);
+#endif
+
+
+
+
+/*********************************************************************************************
+ *										Callback functions
+ ********************************************************************************************/
+
+void SIM800_NewSMSNotificationCallBack(SIM800_Handle_t *handle, uint32_t sms_index);
+void SIM800_RcvdSMSCallBack(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message);
+void SIM800_RcvdLongSMSCallBack(SIM800_Handle_t *handle, SIM800_LongSMS_t *message);
+void SIM800_NetworkRegCallBack(SIM800_Handle_t *handle, SIM800_NetworkRegStatus_t status);
+#if SIM800_USE_REG_CACHE
+void SIM800_RegCacheCallBack(SIM800_Handle_t *handle, const SIM800_RegCache_t *cache);
+#endif
+void SIM800_NetworkTimeCallBack(SIM800_Handle_t *handle, const SIM800_Time_t *time);
+void SIM800_ResetCallBack(SIM800_Handle_t *handle);
+void SIM800_IncomingCallCallBack(SIM800_Handle_t *handle, const SIM800_Caller_t *caller);
+#if SIM800_USE_GNSS
+void SIM800_GNSSCallBack(SIM800_Handle_t *handle, const SIM800_GNSSFix_t *fix);
+#endif
+void SIM800_PowerCycleCallBack(SIM800_Handle_t *handle);
+void SIM800_WatchdogCallBack(SIM800_Handle_t *handle, SIM800_WatchdogState_t state);
+#if SIM800_USE_ISR_BUDGET
+void SIM800_ISRBudgetCallBack(SIM800_Handle_t *handle, uint32_t duration);
+#endif
+void SIM800_SMSStorageLowCallBack(SIM800_Handle_t *handle, SIM800_SMSStorage_t *storage);
+void SIM800_SMSDeliveryCallBack(SIM800_Handle_t *handle, uint8_t reference, uint8_t status, uint32_t latency);
+void SIM800_TransparentRxCallBack(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length);
+void SIM800_TransparentClosedCallBack(SIM800_Handle_t *handle);
+void SIM800_SocketCallBack(SIM800_Handle_t *handle, uint8_t socket, SIM800_SocketEvent_t event);
+void SIM800_BearerCallBack(SIM800_Handle_t *handle, SIM800_BearerState_t state);
 
-void SIM800_NewSMSNotificationCallBack(SIM800_Handle_t *handle, uint32_t sms_index);
-void SIM800_RcvdSMSCallBack(SIM800_Handle_t *handle, SIM800_SMSMessage_t *message);
 
 
 
 
 
+#ifdef __cplusplus
+}
+#endif
 
 #endif /* INC_SIM800_H_ */
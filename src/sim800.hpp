@@ -0,0 +1,259 @@
+/*
+ * sim800.hpp
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_HPP_
+#define INC_SIM800_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include "sim800.h"
+
+
+/*
+ * C++17 wrapper of the driver, header only.
+ *
+ * Modem<Transport> owns a handle and forwards to the C functions, every member is inline and adds no state
+ * of its own. The callbacks are function objects: the C callback is a trampoline instantiated for the type
+ * of the object, so the call of the object is inlined into it. Command lines of SIM800_Query are assembled
+ * at compile time by command():
+ *
+ *     struct Usart1 { static UART_HandleTypeDef *uart() { return &huart1; } };
+ *
+ *     static constexpr auto ReadClock = sim800::command("AT+CCLK?");
+ *     sim800::Modem<Usart1> modem;
+ *
+ *     modem.init();
+ *     if (auto battery = modem.battery())
+ *     {
+ *         // battery->battery_level
+ *     }
+ *
+ * The commands of the driver itself come from its command table (see SIM800_COMMANDS), their text is in
+ * flash already; the wrapper does not build them again.
+ */
+
+namespace sim800
+{
+
+using Status = SIM800_Status_t;
+using Battery = SIM800_Battery_t;
+using Signal = SIM800_Signal_t;
+using Time = SIM800_Time_t;
+using RegStatus = SIM800_NetworkRegStatus_t;
+using Event = SIM800_Event_t;
+
+
+/**
+ * @brief   Structure representing a command line assembled at compile time, see command().
+ */
+template <std::size_t N>
+struct Command
+{
+    char text[N];                               /*!< Characters, '\0' terminated. */
+
+    constexpr const char *c_str() const { return text; }
+    static constexpr std::size_t size() { return N - 1; }
+};
+
+
+namespace detail
+{
+
+/*
+ * Count of characters of a part of command(): a string literal or a Command
+ */
+template <typename T>
+struct part_length;
+
+template <std::size_t N>
+struct part_length<char[N]>
+{
+    static constexpr std::size_t value = N - 1;
+};
+
+template <std::size_t N>
+struct part_length<Command<N>>
+{
+    static constexpr std::size_t value = N - 1;
+};
+
+template <std::size_t N>
+constexpr const char *part_chars(const char (&part)[N])
+{
+    return part;
+}
+
+template <std::size_t N>
+constexpr const char *part_chars(const Command<N> &part)
+{
+    return part.text;
+}
+
+constexpr std::size_t digits(std::uint32_t value)
+{
+    std::size_t count = 1;
+
+    while (value >= 10)
+    {
+        value /= 10;
+        count++;
+    }
+
+    return count;
+}
+
+template <std::size_t N>
+constexpr std::size_t append(char (&out)[N], std::size_t at, const char *part, std::size_t length)
+{
+    for (std::size_t i = 0; i < length; i++)
+    {
+        out[at + i] = part[i];
+    }
+
+    return at + length;
+}
+
+} /* namespace detail */
+
+
+/**
+ * @brief   Decimal text of a number known at compile time, a part of command().
+ */
+template <std::uint32_t Value>
+constexpr Command<detail::digits(Value) + 1> number()
+{
+    Command<detail::digits(Value) + 1> out{};
+    std::uint32_t value = Value;
+
+    for (std::size_t i = detail::digits(Value); i-- > 0; value /= 10)
+    {
+        out.text[i] = static_cast<char>('0' + value % 10);
+    }
+
+    return out;
+}
+
+
+/**
+ * @brief   Joins string literals and numbers into a command line at compile time.
+ *
+ *     constexpr auto ReadFirst = sim800::command("AT+CMGR=", sim800::number<1>());  // "AT+CMGR=1"
+ */
+template <typename... Parts>
+constexpr Command<(detail::part_length<Parts>::value + ... + 1)> command(const Parts &... parts)
+{
+    Command<(detail::part_length<Parts>::value + ... + 1)> out{};
+    std::size_t at = 0;
+
+    ((at = detail::append(out.text, at, detail::part_chars(parts), detail::part_length<Parts>::value)), ...);
+    out.text[at] = '\0';
+
+    return out;
+}
+
+
+/**
+ * @brief   Class representing a module on a UART.
+ *
+ * Transport names the UART: a type with a static member function uart() returning its HAL handle.
+ * The handle of the C driver is reachable through handle() for the functions the class does not wrap.
+ */
+template <typename Transport>
+class Modem
+{
+    static_assert(std::is_same_v<decltype(Transport::uart()), UART_HandleTypeDef *>,
+                  "Transport must have a static UART_HandleTypeDef *uart()");
+
+public:
+    Modem() { handle_.uart = Transport::uart(); }
+
+    Modem(const Modem &) = delete;
+    Modem &operator=(const Modem &) = delete;
+
+    SIM800_Handle_t *handle() { return &handle_; }
+
+    Status init(const SIM800_Config_t *config = nullptr) { return SIM800_Init(&handle_, config); }
+    void poll() { SIM800_Poll(&handle_); }
+
+    std::optional<Battery> battery() { return result(&SIM800_GetBatteryInfo); }
+    std::optional<Signal> signal() { return result(&SIM800_GetSignalQuality); }
+    std::optional<Time> time() { return result(&SIM800_GetTime); }
+    RegStatus registration() { return SIM800_GetNetworkRegStatus(&handle_); }
+
+#if SIM800_USE_SMS
+    Status sendSms(const char *destination, const char *text)
+    {
+        return SIM800_SendSMSMessageRef(&handle_, destination, text, nullptr);
+    }
+
+    /**
+     * @brief   Submits an SMS message, done(Status) is called by poll(); done must stay valid until then.
+     */
+    template <typename F>
+    Status submitSms(const char *destination, const char *text, F &done)
+    {
+        return SIM800_SubmitSMSMessage(&handle_, destination, text, &requestTrampoline<F>, &done);
+    }
+#endif /* SIM800_USE_SMS */
+
+    /**
+     * @brief   Queries a command without a function of its own, see SIM800_Query.
+     */
+    template <std::size_t N, typename... Fields>
+    Status query(const Command<N> &command, const char *code, const char *format, Fields... fields)
+    {
+        return SIM800_Query(&handle_, command.c_str(), code, format, fields...);
+    }
+
+    /**
+     * @brief   Subscribes a function object to events, callback(const Event &) is called by poll().
+     */
+    template <typename F>
+    Status subscribe(std::uint32_t mask, F &callback)
+    {
+        return SIM800_Subscribe(&handle_, mask, &eventTrampoline<F>, &callback);
+    }
+
+    template <typename F>
+    void unsubscribe(F &callback)
+    {
+        SIM800_Unsubscribe(&handle_, &eventTrampoline<F>, &callback);
+    }
+
+private:
+    template <typename T>
+    std::optional<T> result(Status (*get)(SIM800_Handle_t *, T *))
+    {
+        T value{};
+
+        if (get(&handle_, &value) != SIM800_OK)
+        {
+            return std::nullopt;
+        }
+
+        return value;
+    }
+
+    template <typename F>
+    static void requestTrampoline(SIM800_Handle_t *, SIM800_Status_t status, void *ctx)
+    {
+        (*static_cast<F *>(ctx))(status);
+    }
+
+    template <typename F>
+    static void eventTrampoline(SIM800_Handle_t *, const SIM800_Event_t *event, void *ctx)
+    {
+        (*static_cast<F *>(ctx))(*event);
+    }
+
+    SIM800_Handle_t handle_{};
+};
+
+} /* namespace sim800 */
+
+#endif /* INC_SIM800_HPP_ */
@@ -0,0 +1,563 @@
+/*
+ * sim800_cmux.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_cmux.h"
+
+#if SIM800_USE_CMUX
+
+/*
+ * Fields of the frames of the basic option
+ */
+#define CMUX_FLAG								0xF9
+#define CMUX_EA									0x01	/* Extension bit, set in the last octet of a field. */
+#define CMUX_CR									0x02	/* Command/response bit. */
+#define CMUX_PF									0x10	/* Poll/final bit of the control field. */
+
+#define CMUX_SABM								0x2F
+#define CMUX_UA									0x63
+#define CMUX_DM									0x0F
+#define CMUX_DISC								0x43
+#define CMUX_UIH								0xEF
+
+/*
+ * Types of the control channel messages, with the extension bit
+ */
+#define CMUX_MSC								0xE1	/* Modem status command. */
+#define CMUX_CLD								0xC1	/* Multiplexer close down. */
+
+#define CMUX_FCS_GOOD							0xCF	/* Remainder of a header followed by its FCS. */
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint8_t cmux_fcs(uint8_t fcs, uint8_t octet);
+static SIM800_Status_t cmux_send(SIM800_CMUX_t *mux, uint8_t dlci, uint8_t control, const uint8_t *data, uint16_t length);
+static SIM800_Status_t cmux_open(SIM800_CMUX_t *mux, uint8_t dlci);
+static void cmux_frame(SIM800_CMUX_t *mux);
+
+static void cmux_rx(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+static uint16_t cmux_transmit(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+static void cmux_poll(SIM800_Handle_t *handle, void *ctx);
+static void cmux_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+
+
+static const SIM800_Link_t cmux_link = { &cmux_transmit, &cmux_poll, NULL, NULL, NULL };
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Starts the multiplexer and opens its virtual channels.
+ *
+ * The module is switched to the multiplexer mode ("AT+CMUX=0"), the control channel and the channels
+ * DLCI 1 ... count are opened, and every channel handle is linked to its channel. The channel handles
+ * are then started by SIM800_Init like a handle of a UART, e.g. one for the commands, one for the data
+ * of the sockets or HTTP and one for the notifications: the module reports a notification on the
+ * channel whose settings enabled it. From then on handle must not be used, call SIM800_CMUX_Poll
+ * instead of SIM800_Poll.
+ *
+ * @param   *mux: Pointer to the multiplexer structure.
+ * @param   *handle: Pointer to the SIM800 handle structure of the UART, see SIM800_Init.
+ * @param   *channels: Handles of the channels (zeroed, not receiving), channels[i] is DLCI i + 1.
+ * @param   count: Count of channels, 1 ... SIM800_CMUX_CHANNELS.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if a channel is not acknowledged in time.
+ */
+SIM800_Status_t SIM800_CMUX_Start(SIM800_CMUX_t *mux, SIM800_Handle_t *handle,
+                                  SIM800_Handle_t *const *channels, uint8_t count)
+{
+    SIM800_Status_t status;
+
+    if (count == 0 || count > SIM800_CMUX_CHANNELS)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (channels[i] == NULL || channels[i] == handle || channels[i]->recStatus == SIM800_Receives)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    memset(mux, 0, sizeof(*mux));
+    mux->handle = handle;
+    for (uint8_t i = 0; i < SIM800_CMUX_TX_FRAMES; i++)
+    {
+        mux->frames[i].mux = mux;
+    }
+
+    if ((status = SIM800_EnterMux(handle, &cmux_rx, mux)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    for (uint8_t dlci = 0; dlci <= count; dlci++)
+    {
+        if ((status = cmux_open(mux, dlci)) != SIM800_OK)
+        {
+            SIM800_LeaveMux(handle);
+            return status;
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        mux->channels[i] = channels[i];
+        SIM800_AttachLink(channels[i], &cmux_link, mux);
+    }
+    mux->count = count;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Closes the multiplexer down, the module returns to the AT command mode on the UART.
+ *
+ * The channel handles stop receiving and are detached from the multiplexer.
+ *
+ * @param   *mux: Pointer to the multiplexer structure, see SIM800_CMUX_Start.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT if the close down is not sent in time.
+ */
+SIM800_Status_t SIM800_CMUX_Stop(SIM800_CMUX_t *mux)
+{
+    static const uint8_t cld[] = { CMUX_CLD | CMUX_CR, CMUX_EA };
+    uint32_t tickStart = HAL_GetTick();
+    uint8_t pending = 1;
+
+    if (cmux_send(mux, 0, CMUX_UIH, cld, sizeof(cld)) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The frames still queued must reach the module before the UART carries lines again
+    while (pending)
+    {
+        SIM800_Process(mux->handle);
+
+        pending = 0;
+        for (uint8_t i = 0; i < SIM800_CMUX_TX_FRAMES; i++)
+        {
+            pending |= mux->frames[i].busy;
+        }
+
+        if (pending && HAL_GetTick() - tickStart > SIM800_CMUX_OPEN_TIMEOUT)
+        {
+            return SIM800_TIMEOUT;
+        }
+    }
+
+    SIM800_LeaveMux(mux->handle);
+
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        SIM800_ManageReceiving(mux->channels[i], DISABLE);
+        SIM800_AttachLink(mux->channels[i], NULL, NULL);
+        mux->channels[i] = NULL;
+    }
+    mux->count = 0;
+    mux->opened = 0;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Drives the multiplexer and all its channel handles.
+ *
+ * This function must be called regularly from the main loop or a task instead of SIM800_Poll. The
+ * frames received by the UART are split into the receive rings of the channels, then every channel
+ * handle is polled, see SIM800_Poll. The blocking functions of a channel handle drive the
+ * multiplexer themselves while they wait.
+ *
+ * @param   *mux: Pointer to the multiplexer structure, see SIM800_CMUX_Start.
+ */
+void SIM800_CMUX_Poll(SIM800_CMUX_t *mux)
+{
+    SIM800_Process(mux->handle);
+
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        SIM800_Poll(mux->channels[i]);
+    }
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Adds an octet to the frame check sequence (the reflected CRC-8 of GSM 07.10, polynomial 0x07).
+ *
+ * @param   fcs: FCS so far, 0xFF for the first octet.
+ * @param   octet: Octet to add.
+ * @retval  The updated FCS, the transmitted one is 0xFF minus the FCS of the header.
+ */
+static uint8_t cmux_fcs(uint8_t fcs, uint8_t octet)
+{
+    fcs ^= octet;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        fcs = (fcs & 1) ? (fcs >> 1) ^ 0xE0 : fcs >> 1;
+    }
+
+    return fcs;
+}
+
+
+/**
+ * @brief   Queues a frame for the UART.
+ *
+ * The frame is encoded into a free frame buffer and queued pinned, see SIM800_Transmit. The commands
+ * of the station (and the data of the channels) carry the C/R bit, "UA" is a response.
+ *
+ * @param   *mux: Pointer to the multiplexer structure.
+ * @param   dlci: Channel of the frame, 0 - the control channel.
+ * @param   control: Control field.
+ * @param   *data: Information field, may be NULL if length is 0.
+ * @param   length: Length of the information field, at most SIM800_CMUX_FRAME_MAX.
+ * @retval  SIM800_OK on success, SIM800_ERROR if no frame buffer is free or the UART refuses the frame.
+ */
+static SIM800_Status_t cmux_send(SIM800_CMUX_t *mux, uint8_t dlci, uint8_t control, const uint8_t *data, uint16_t length)
+{
+    SIM800_CMUXFrame_t *frame = NULL;
+    uint8_t *p;
+    uint8_t fcs = 0xFF;
+
+    // The TX-complete callback only ever releases frames, a free one can be taken without a lock
+    for (uint8_t i = 0; i < SIM800_CMUX_TX_FRAMES && frame == NULL; i++)
+    {
+        if (!mux->frames[i].busy)
+        {
+            frame = &mux->frames[i];
+        }
+    }
+
+    if (frame == NULL || length > SIM800_CMUX_FRAME_MAX)
+    {
+        return SIM800_ERROR;
+    }
+    frame->busy = 1;
+
+    // <flag><address><control><length><information><FCS><flag>
+    p = frame->data;
+    *p++ = CMUX_FLAG;
+    *p++ = (dlci << 2) | (control == CMUX_UA ? 0 : CMUX_CR) | CMUX_EA;
+    *p++ = control;
+    *p++ = (length << 1) | CMUX_EA;
+
+    for (uint8_t i = 1; i < 4; i++)
+    {
+        fcs = cmux_fcs(fcs, frame->data[i]);
+    }
+
+    if (length != 0)
+    {
+        memcpy(p, data, length);
+        p += length;
+    }
+    *p++ = 0xFF - fcs;
+    *p++ = CMUX_FLAG;
+
+    if (SIM800_Transmit(mux->handle, frame->data, p - frame->data, &cmux_sent, frame) != SIM800_OK)
+    {
+        frame->busy = 0;
+        return SIM800_ERROR;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Opens a channel ("SABM") and waits for its acknowledgement ("UA").
+ *
+ * The modem status of an opened virtual channel is set ("MSC": ready to communicate and to receive).
+ *
+ * @param   *mux: Pointer to the multiplexer structure.
+ * @param   dlci: Channel to open, 0 - the control channel.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the channel is refused, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t cmux_open(SIM800_CMUX_t *mux, uint8_t dlci)
+{
+    uint8_t msc[] = { CMUX_MSC | CMUX_CR, (2 << 1) | CMUX_EA, (dlci << 2) | CMUX_CR | CMUX_EA, 0x0D };
+    uint32_t tickStart = HAL_GetTick();
+    uint8_t bit = 1 << dlci;
+
+    if (cmux_send(mux, dlci, CMUX_SABM | CMUX_PF, NULL, 0) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    while (!(mux->opened & bit))
+    {
+        SIM800_Process(mux->handle);
+
+        if (mux->refused & bit)
+        {
+            return SIM800_ERROR;
+        }
+
+        if (HAL_GetTick() - tickStart > SIM800_CMUX_OPEN_TIMEOUT)
+        {
+            return SIM800_TIMEOUT;
+        }
+
+        SIM800_OS_Wait(mux->handle, SIM800_WAIT_SLICE);
+    }
+
+    if (dlci != 0 && cmux_send(mux, 0, CMUX_UIH, msc, sizeof(msc)) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Handles a received frame.
+ *
+ * "UA" and "DM" answer the opening of a channel, "DISC" of the module is acknowledged. The information
+ * of "UIH" on a virtual channel goes to the receive ring of its handle, the commands of the control
+ * channel are answered by sending them back as responses.
+ *
+ * @param   *mux: Pointer to the multiplexer structure.
+ */
+static void cmux_frame(SIM800_CMUX_t *mux)
+{
+    uint8_t dlci = mux->rxAddress >> 2;
+    uint8_t control = mux->rxControl & ~CMUX_PF;
+    SIM800_Handle_t *channel;
+    uint16_t count;
+
+    mux->rxFrames++;
+
+    if (dlci > SIM800_CMUX_CHANNELS)
+    {
+        return;
+    }
+
+    switch (control)
+    {
+    case CMUX_UA:
+        mux->opened |= 1 << dlci;
+        break;
+
+    case CMUX_DM:
+        mux->refused |= 1 << dlci;
+        mux->opened &= ~(1 << dlci);
+        break;
+
+    case CMUX_DISC:
+        mux->opened &= ~(1 << dlci);
+        cmux_send(mux, dlci, CMUX_UA | CMUX_PF, NULL, 0);
+        break;
+
+    case CMUX_UIH:
+        if (dlci == 0)
+        {
+            if (mux->rxLength != 0 && (mux->rxInfo[0] & CMUX_CR))
+            {
+                mux->rxInfo[0] &= ~CMUX_CR;
+                cmux_send(mux, 0, CMUX_UIH, mux->rxInfo, mux->rxLength);
+            }
+        }
+        else if (dlci <= mux->count && (channel = mux->channels[dlci - 1]) != NULL)
+        {
+            count = SIM800_LinkInput(channel, mux->rxInfo, mux->rxLength);
+            mux->rxDropped += mux->rxLength - count;
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+
+/**
+ * @brief   Decodes the characters of the UART into frames, see SIM800_EnterMux.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of the UART.
+ * @param   *data: Received characters.
+ * @param   length: Count of characters.
+ * @param   *ctx: Pointer to the multiplexer structure.
+ */
+static void cmux_rx(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx)
+{
+    SIM800_CMUX_t *mux = (SIM800_CMUX_t *)ctx;
+    uint8_t c;
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        c = data[i];
+
+        switch (mux->rxState)
+        {
+        case SIM800_CMUX_Hunt:
+            if (c == CMUX_FLAG)
+            {
+                mux->rxState = SIM800_CMUX_Address;
+            }
+            break;
+
+        case SIM800_CMUX_Address:
+            // The closing flag of a frame may be followed by the opening flag of the next one
+            if (c != CMUX_FLAG)
+            {
+                mux->rxAddress = c;
+                mux->rxFcs = cmux_fcs(0xFF, c);
+                mux->rxState = SIM800_CMUX_Control;
+            }
+            break;
+
+        case SIM800_CMUX_Control:
+            mux->rxControl = c;
+            mux->rxFcs = cmux_fcs(mux->rxFcs, c);
+            mux->rxState = SIM800_CMUX_Length;
+            break;
+
+        case SIM800_CMUX_Length:
+        case SIM800_CMUX_Length2:
+            mux->rxFcs = cmux_fcs(mux->rxFcs, c);
+            if (mux->rxState == SIM800_CMUX_Length)
+            {
+                mux->rxLength = c >> 1;
+            }
+            else
+            {
+                mux->rxLength |= (uint16_t)c << 7;
+            }
+            mux->rxCount = 0;
+
+            if (mux->rxState == SIM800_CMUX_Length && !(c & CMUX_EA))
+            {
+                mux->rxState = SIM800_CMUX_Length2;
+            }
+            else if (mux->rxLength > SIM800_CMUX_FRAME_MAX)
+            {
+                mux->rxErrors++;
+                mux->rxState = SIM800_CMUX_Hunt;
+            }
+            else
+            {
+                mux->rxState = mux->rxLength != 0 ? SIM800_CMUX_Info : SIM800_CMUX_FCS;
+            }
+            break;
+
+        case SIM800_CMUX_Info:
+            mux->rxInfo[mux->rxCount++] = c;
+            if (mux->rxCount == mux->rxLength)
+            {
+                mux->rxState = SIM800_CMUX_FCS;
+            }
+            break;
+
+        case SIM800_CMUX_FCS:
+            mux->rxFcs = cmux_fcs(mux->rxFcs, c);
+            mux->rxState = SIM800_CMUX_Close;
+            break;
+
+        case SIM800_CMUX_Close:
+            if (c == CMUX_FLAG && mux->rxFcs == CMUX_FCS_GOOD)
+            {
+                cmux_frame(mux);
+                mux->rxState = SIM800_CMUX_Address;
+            }
+            else
+            {
+                mux->rxErrors++;
+                mux->rxState = (c == CMUX_FLAG) ? SIM800_CMUX_Address : SIM800_CMUX_Hunt;
+            }
+            break;
+        }
+    }
+}
+
+
+/**
+ * @brief   Sends the data of a channel handle in "UIH" frames, see SIM800_Link_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of the channel.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @param   *ctx: Pointer to the multiplexer structure.
+ * @retval  Count of bytes queued, the rest waits for free frame buffers.
+ */
+static uint16_t cmux_transmit(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx)
+{
+    SIM800_CMUX_t *mux = (SIM800_CMUX_t *)ctx;
+    uint16_t sent = 0;
+    uint16_t count;
+    uint8_t dlci = 0;
+
+    for (uint8_t i = 0; i < mux->count; i++)
+    {
+        if (mux->channels[i] == handle)
+        {
+            dlci = i + 1;
+        }
+    }
+
+    if (dlci == 0)
+    {
+        // A detached channel drops its data instead of stalling its queue
+        return length;
+    }
+
+    while (sent < length)
+    {
+        count = length - sent;
+        if (count > SIM800_CMUX_FRAME_MAX)
+        {
+            count = SIM800_CMUX_FRAME_MAX;
+        }
+
+        if (cmux_send(mux, dlci, CMUX_UIH, &data[sent], count) != SIM800_OK)
+        {
+            break;
+        }
+        sent += count;
+    }
+
+    return sent;
+}
+
+
+/**
+ * @brief   Drives the UART of the multiplexer while a channel handle waits, see SIM800_Link_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of the channel.
+ * @param   *ctx: Pointer to the multiplexer structure.
+ */
+static void cmux_poll(SIM800_Handle_t *handle, void *ctx)
+{
+    SIM800_Process(((SIM800_CMUX_t *)ctx)->handle);
+}
+
+
+/**
+ * @brief   Releases a frame buffer once the UART has sent it (from the TX-complete interrupt).
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of the UART.
+ * @param   status: Status of the transmission.
+ * @param   *ctx: Pointer to the frame.
+ */
+static void cmux_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    ((SIM800_CMUXFrame_t *)ctx)->busy = 0;
+}
+
+#endif /* SIM800_USE_CMUX */
@@ -0,0 +1,124 @@
+/*
+ * sim800_cmux.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_CMUX_H_
+#define INC_SIM800_CMUX_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_CMUX
+
+#ifndef SIM800_CMUX_CHANNELS
+#define SIM800_CMUX_CHANNELS					3		/* Virtual channels (DLCI 1 ... 3), the module supports at most 3. */
+#endif
+
+#ifndef SIM800_CMUX_FRAME_MAX
+#define SIM800_CMUX_FRAME_MAX					127		/* Longest information field, the N1 default of "AT+CMUX=0". */
+#endif
+
+#ifndef SIM800_CMUX_TX_FRAMES
+#define SIM800_CMUX_TX_FRAMES					4		/* Frames queued for the UART at a time. */
+#endif
+
+#ifndef SIM800_CMUX_OPEN_TIMEOUT
+#define SIM800_CMUX_OPEN_TIMEOUT				3000	/* Time the module may take to acknowledge a channel (ms). */
+#endif
+
+#if SIM800_CMUX_CHANNELS > 3 || SIM800_CMUX_TX_FRAMES >= TX_QUEUE_LENGTH
+#error "SIM800_CMUX_CHANNELS must not exceed 3, SIM800_CMUX_TX_FRAMES must be less than TX_QUEUE_LENGTH"
+#endif
+
+/* The frames are sent with a one-octet length field, and "AT+CMUX=0" leaves the module at N1 = 127 */
+#if SIM800_CMUX_FRAME_MAX < 1 || SIM800_CMUX_FRAME_MAX > 127
+#error "SIM800_CMUX_FRAME_MAX must be between 1 and 127"
+#endif
+
+
+typedef struct SIM800_CMUX SIM800_CMUX_t;
+
+
+/**
+ * @brief   Enumeration of the states of the frame decoder.
+ */
+typedef enum
+{
+    SIM800_CMUX_Hunt,                           /*!< Waiting for the opening flag. */
+    SIM800_CMUX_Address,                        /*!< Waiting for the address field, repeated flags are skipped. */
+    SIM800_CMUX_Control,                        /*!< Waiting for the control field. */
+    SIM800_CMUX_Length,                         /*!< Waiting for the (first) length octet. */
+    SIM800_CMUX_Length2,                        /*!< Waiting for the second length octet. */
+    SIM800_CMUX_Info,                           /*!< Receiving the information field. */
+    SIM800_CMUX_FCS,                            /*!< Waiting for the frame check sequence. */
+    SIM800_CMUX_Close,                          /*!< Waiting for the closing flag. */
+} SIM800_CMUXRxState_t;
+
+
+/**
+ * @brief   Structure representing a frame queued for the UART.
+ *
+ * The frame is pinned while it is sent, the TX-complete callback releases it.
+ */
+typedef struct
+{
+    SIM800_CMUX_t *mux;                         /*!< Multiplexer the frame belongs to. */
+    volatile uint8_t busy;                      /*!< 1 while the frame is queued. */
+    uint8_t data[SIM800_CMUX_FRAME_MAX + 6];    /*!< Flag, address, control, length, information, FCS and flag. */
+} SIM800_CMUXFrame_t;
+
+
+/**
+ * @brief   Structure representing the GSM 07.10 multiplexer running on the UART of a handle.
+ *
+ * The handle of the UART carries the frames only. Every virtual channel is a handle of its own, linked
+ * to the multiplexer (see SIM800_AttachLink): it has its own receive ring, line parser, request queue
+ * and notifications, so commands on one channel overlap with the data of another one.
+ */
+struct SIM800_CMUX
+{
+    SIM800_Handle_t *handle;                    /*!< Handle of the UART. */
+    SIM800_Handle_t *channels[SIM800_CMUX_CHANNELS];  /*!< Handle of the channel of DLCI i + 1, NULL - unused. */
+    uint8_t count;                              /*!< Count of channels. */
+    volatile uint8_t opened;                    /*!< Bit per DLCI acknowledged by "UA". */
+    volatile uint8_t refused;                   /*!< Bit per DLCI refused by "DM". */
+    SIM800_CMUXRxState_t rxState;               /*!< State of the frame decoder. */
+    uint8_t rxAddress;                          /*!< Address field of the frame being received. */
+    uint8_t rxControl;                          /*!< Control field of the frame being received. */
+    uint8_t rxFcs;                              /*!< Running FCS of the header of the frame being received. */
+    uint16_t rxLength;                          /*!< Length of the information field. */
+    uint16_t rxCount;                           /*!< Count of information octets received. */
+    uint8_t rxInfo[SIM800_CMUX_FRAME_MAX];      /*!< Information field of the frame being received. */
+    SIM800_CMUXFrame_t frames[SIM800_CMUX_TX_FRAMES];  /*!< Frames queued for the UART. */
+    uint32_t rxFrames;                          /*!< Count of frames received. */
+    uint32_t rxErrors;                          /*!< Count of frames dropped for a bad FCS, length or closing flag. */
+    uint32_t rxDropped;                         /*!< Count of channel bytes dropped because the ring of the channel was full. */
+};
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_CMUX_Start					(SIM800_CMUX_t *mux, SIM800_Handle_t *handle,
+													 SIM800_Handle_t *const *channels, uint8_t count);
+SIM800_Status_t SIM800_CMUX_Stop					(SIM800_CMUX_t *mux);
+void SIM800_CMUX_Poll								(SIM800_CMUX_t *mux);
+
+
+
+
+#endif /* SIM800_USE_CMUX */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_CMUX_H_ */
@@ -0,0 +1,512 @@
+/*
+ * sim800_config.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_CONFIG_H_
+#define INC_SIM800_CONFIG_H_
+
+/*
+ * Compile-time configuration of the library.
+ *
+ * Every value below is a default, define it beforehand to change it: on the compiler command line
+ * (e.g. -DSIM800_USE_MQTT=0) or in sim800_user_config.h, which is included when SIM800_USER_CONFIG
+ * is defined. A disabled feature compiles to nothing: its commands, handle fields and functions
+ * are left out, so small targets only pay for the features they use.
+ */
+#ifdef SIM800_USER_CONFIG
+#include "sim800_user_config.h"
+#endif
+
+
+/*********************************************************************************************
+ *											Features
+ ********************************************************************************************/
+
+#ifndef SIM800_USE_SMS
+#define SIM800_USE_SMS							1		/* Sending, receiving, storing and listing SMS messages. */
+#endif
+
+#ifndef SIM800_USE_PDU
+#define SIM800_USE_PDU							1		/* SMS PDU mode: long messages, PDU delivery and status reports. */
+#endif
+
+#ifndef SIM800_USE_GPRS
+#define SIM800_USE_GPRS							1		/* GPRS bearer, DNS cache, TCP/UDP sockets and the transparent pipe. */
+#endif
+
+#ifndef SIM800_USE_HTTP
+#define SIM800_USE_HTTP							1		/* HTTP client (sim800.c). */
+#endif
+
+#ifndef SIM800_USE_MQTT
+#define SIM800_USE_MQTT							1		/* MQTT client (sim800_mqtt.c). */
+#endif
+
+#ifndef SIM800_USE_CMUX
+#define SIM800_USE_CMUX							1		/* GSM 07.10 multiplexer (sim800_cmux.c). */
+#endif
+
+#ifndef SIM800_USE_LL
+#define SIM800_USE_LL							0		/* USART driven through the LL drivers as the link of a handle (sim800_ll.c). */
+#endif
+
+#ifndef SIM800_USE_OTA
+#define SIM800_USE_OTA							1		/* Firmware download into the MCU flash (sim800_ota.c). */
+#endif
+
+#ifndef SIM800_USE_SLEEP
+#define SIM800_USE_SLEEP						0		/* Sleep of the module on DTR ("AT+CSCLK=1") and STOP mode of the MCU, see SIM800_ManageSleep. */
+#endif
+
+#ifndef SIM800_USE_PHONEBOOK
+#define SIM800_USE_PHONEBOOK					1		/* In-RAM index of the SIM phonebook for sender checks, see SIM800_LoadPhonebook. */
+#endif
+
+#ifndef SIM800_USE_GNSS
+#define SIM800_USE_GNSS							0		/* GNSS receiver of the SIM808/SIM868 and its position stream, see SIM800_ManageGNSS. */
+#endif
+
+#ifndef SIM800_USE_FS
+#define SIM800_USE_FS							0		/* Files in the flash of the module ("AT+FS..."), see SIM800_FSOpen. */
+#endif
+
+#ifndef SIM800_USE_REG_CACHE
+#define SIM800_USE_REG_CACHE					0		/* Operator and band of the last registration selected at boot, see SIM800_SetRegCache. */
+#endif
+
+#ifndef SIM800_USE_OUTBOX
+#define SIM800_USE_OUTBOX						0		/* SMS outbox in reserved flash sectors of the MCU (sim800_outbox.c). */
+#endif
+
+#ifndef SIM800_USE_TELEMETRY
+#define SIM800_USE_TELEMETRY					0		/* Readings aggregated into dense frames for the outbox or a socket (sim800_telemetry.c). */
+#endif
+
+#ifndef SIM800_USE_STATS
+#define SIM800_USE_STATS						1		/* Counters of the traffic and of the errors, see SIM800_GetStats. */
+#endif
+
+#ifndef SIM800_USE_LATENCY
+#define SIM800_USE_LATENCY						0		/* Per-command latency histograms from the DWT cycle counter (Cortex-M3 and up). */
+#endif
+
+#ifndef SIM800_USE_ISR_BUDGET
+#define SIM800_USE_ISR_BUDGET					0		/* Execution time of the interrupt handlers from the DWT cycle counter. */
+#endif
+
+#ifndef SIM800_USE_TRACE
+#define SIM800_USE_TRACE						0		/* Trace ring of the lines sent and received, see SIM800_TraceDump. */
+#endif
+
+#if SIM800_USE_PDU && !SIM800_USE_SMS
+#error "SIM800_USE_PDU requires SIM800_USE_SMS"
+#endif
+
+#if (SIM800_USE_HTTP || SIM800_USE_MQTT) && !SIM800_USE_GPRS
+#error "SIM800_USE_HTTP and SIM800_USE_MQTT require SIM800_USE_GPRS"
+#endif
+
+#if SIM800_USE_FS && !SIM800_USE_GPRS
+#error "SIM800_USE_FS requires SIM800_USE_GPRS"
+#endif
+
+#if SIM800_USE_OTA && !SIM800_USE_HTTP
+#error "SIM800_USE_OTA requires SIM800_USE_HTTP"
+#endif
+
+#if SIM800_USE_OUTBOX && !SIM800_USE_SMS
+#error "SIM800_USE_OUTBOX requires SIM800_USE_SMS"
+#endif
+
+
+/*********************************************************************************************
+ *										Core and timing
+ ********************************************************************************************/
+
+#ifndef SIM800_MAX_DELAY
+#define SIM800_MAX_DELAY						32000
+#endif
+
+#ifndef SIM800_TIMEOUT_SHORT
+#define SIM800_TIMEOUT_SHORT					300		/* Response time of the commands answered at once (ms). */
+#endif
+
+#ifndef SIM800_PROMPT_TIMEOUT
+#define SIM800_PROMPT_TIMEOUT					5000	/* Maximum time to wait for the "> " data prompt (ms). */
+#endif
+
+#ifndef SIM800_CANCEL_DRAIN
+#define SIM800_CANCEL_DRAIN						2000	/* Time a cancelled command may take to return its final result (ms). */
+#endif
+
+#ifndef SIM800_WAIT_SLICE
+#define SIM800_WAIT_SLICE						10		/* Longest sleep of a blocking function between two checks (ms). */
+#endif
+
+#ifndef SIM800_BAUD_PROBES
+#define SIM800_BAUD_PROBES						3		/* Count of "AT" probes verifying the link at a baud rate. */
+#endif
+
+#ifndef SIM800_INIT_TIMEOUT
+#define SIM800_INIT_TIMEOUT						10000	/* Default time SIM800_Init waits for the module and the SIM card (ms). */
+#endif
+
+#ifndef SIM800_PROFILE_CID
+#define SIM800_PROFILE_CID						3		/* Bearer profile whose APN keeps the fingerprint of the saved settings, see SIM800_Config_t. */
+#endif
+
+#ifndef SIM800_SIM_POLL_PERIOD
+#define SIM800_SIM_POLL_PERIOD					1000	/* Period of the SIM card checks of SIM800_Init (ms). */
+#endif
+
+#ifndef SIM800_REG_FALLBACK
+#define SIM800_REG_FALLBACK						30000	/* Time to register on the cached band before all bands are selected again (ms). */
+#endif
+
+#define SIM800_PLMN_LENGTH						8		/* Numeric operator, MCC and MNC ("25001"), with the terminating '\0'. */
+
+#define SIM800_BAND_LENGTH						28		/* Band selection of "AT+CBAND" (e.g. "EGSM_DCS_MODE"), with the terminating '\0'. */
+
+#ifndef SIM800_WATCHDOG_TIMEOUTS
+#define SIM800_WATCHDOG_TIMEOUTS				3		/* Requests timed out in a row that make the watchdog probe the module. */
+#endif
+
+#ifndef SIM800_WATCHDOG_PROBES
+#define SIM800_WATCHDOG_PROBES					2		/* Failed probes in a row that make the watchdog restart the module. */
+#endif
+
+#ifndef SIM800_WATCHDOG_RESTART
+#define SIM800_WATCHDOG_RESTART					15000	/* Time a restarted module gets to report "SMS Ready" (ms). */
+#endif
+
+#ifndef SIM800_SLEEP_IDLE
+#define SIM800_SLEEP_IDLE						100		/* Time without traffic after which DTR is raised and the module may sleep (ms). */
+#endif
+
+#ifndef SIM800_SLEEP_WAKE_DELAY
+#define SIM800_SLEEP_WAKE_DELAY					60		/* Time the module needs after DTR falls before it takes commands (ms). */
+#endif
+
+#ifndef SIM800_PHONEBOOK_ENTRIES
+#define SIM800_PHONEBOOK_ENTRIES				64		/* Numbers kept in the phonebook index, 8 bytes each. */
+#endif
+
+#ifndef SIM800_PHONEBOOK_DIGITS
+#define SIM800_PHONEBOOK_DIGITS					10		/* Trailing digits of a number compared, at most 17. */
+#endif
+
+#if SIM800_PHONEBOOK_DIGITS > 17
+#error "SIM800_PHONEBOOK_DIGITS must be at most 17"
+#endif
+
+#ifndef SIM800_PHONEBOOK_RETRY
+#define SIM800_PHONEBOOK_RETRY					10000	/* Delay before a failed or invalidated phonebook load is repeated (ms). */
+#endif
+
+#ifndef SIM800_SIGNAL_SAMPLES
+#define SIM800_SIGNAL_SAMPLES					8		/* Signal samples kept by the sampler, must be a power of two. */
+#endif
+
+#ifndef SIM800_SIGNAL_MIN_RSSI
+#define SIM800_SIGNAL_MIN_RSSI					5		/* Lowest usable signal strength of "AT+CSQ" (5 - about -105 dBm). */
+#endif
+
+#ifndef SIM800_CELL_COUNT
+#define SIM800_CELL_COUNT						7		/* Cells kept by SIM800_GetCellInfo, the serving cell and up to 6 neighbours. */
+#endif
+
+#ifndef SIM800_TIME_MIN_YEAR
+#define SIM800_TIME_MIN_YEAR					2020	/* Earlier times are the default clock of the module, not a network time. */
+#endif
+
+#ifndef SIM800_CALLER_LENGTH
+#define SIM800_CALLER_LENGTH					24		/* Size of the caller number of an incoming call, the terminating '\0' included. */
+#endif
+
+#ifndef SIM800_CALL_RING_GAP
+#define SIM800_CALL_RING_GAP					8000	/* Longest time between two "RING" of one incoming call (ms). */
+#endif
+
+#ifndef SIM800_USSD_LENGTH
+#define SIM800_USSD_LENGTH						256		/* Size of the text of a USSD response, a UCS2 text takes 4 hex digits per character until it is decoded. */
+#endif
+
+#ifndef SIM800_USSD_TIMEOUT
+#define SIM800_USSD_TIMEOUT						20000	/* Longest wait for the "+CUSD" response of a USSD query (ms). */
+#endif
+
+#ifndef SIM800_ID_LENGTH
+#define SIM800_ID_LENGTH						22		/* Size of an IMEI or ICCID buffer, the terminating '\0' included. */
+#endif
+
+#define SIM800_CACHE_FOREVER					0xFFFFFFFF	/* TTL of a cached value that never expires. */
+
+#define CODE_MAX_LENGTH							12		/* Longest expected code ("+HTTPACTION") and its terminator. */
+
+
+/*********************************************************************************************
+ *										Buffers and queues
+ ********************************************************************************************/
+
+#ifndef RX_RING_LENGTH
+#define RX_RING_LENGTH							512		/* Must be a power of two. */
+#endif
+
+#define RX_LINE_CHUNK_LENGTH					(RX_RING_LENGTH / 4)
+
+#define RX_HIGH_WATER							(RX_RING_LENGTH / 2)	/* Fill level stopping the reception with flow control. In DMA
+																		 * mode half of the ring may arrive before the next event. */
+#define RX_LOW_WATER							(RX_RING_LENGTH / 4)	/* Fill level resuming the reception with flow control. */
+
+#ifndef DISPATCH_TABLE_SIZE
+#define DISPATCH_TABLE_SIZE						16		/* Must be a power of two. */
+#endif
+
+#ifndef TX_QUEUE_LENGTH
+#define TX_QUEUE_LENGTH							8		/* Must be a power of two. */
+#endif
+
+#ifndef TX_ARENA_LENGTH
+#define TX_ARENA_LENGTH							256		/* Must be a power of two. */
+#endif
+
+#ifndef REQUEST_QUEUE_LENGTH
+#define REQUEST_QUEUE_LENGTH					4		/* Must be a power of two. */
+#endif
+
+#ifndef SIM800_EVENT_QUEUE_LENGTH
+#define SIM800_EVENT_QUEUE_LENGTH				8		/* Notifications awaiting their callback, must be a power of two. */
+#endif
+
+#ifndef SIM800_SUBSCRIBERS
+#define SIM800_SUBSCRIBERS						4		/* Count of event subscribers, see SIM800_Subscribe. */
+#endif
+
+#ifndef SIM800_BATCH_MAX_ITEMS
+#define SIM800_BATCH_MAX_ITEMS					4		/* Maximum count of queries combined into one command line. */
+#endif
+
+#ifndef SIM800_QUERY_MAX_FIELDS
+#define SIM800_QUERY_MAX_FIELDS					8		/* Maximum count of conversions in the format of SIM800_Query. */
+#endif
+
+#ifndef SIM800_RETRY_RULES
+#define SIM800_RETRY_RULES						2		/* Count of commands that can have a retry policy. */
+#endif
+
+#ifndef SIM800_LATENCY_COMMANDS
+#define SIM800_LATENCY_COMMANDS					8		/* Count of commands with latency histograms, see SIM800_GetLatency. */
+#endif
+
+#ifndef SIM800_LATENCY_BUCKETS
+#define SIM800_LATENCY_BUCKETS					24		/* Buckets of a latency histogram, the last one starts at 2^(n-2) us. */
+#endif
+
+#ifndef SIM800_TRACE_LENGTH
+#define SIM800_TRACE_LENGTH						1024	/* Bytes of the trace ring, must be a power of two. */
+#endif
+
+#ifndef SIM800_TRACE_RECORD_MAX
+#define SIM800_TRACE_RECORD_MAX					128		/* Characters kept of a traced line, the rest is cut. */
+#endif
+
+#ifndef UART_TABLE_SIZE
+#define UART_TABLE_SIZE							8		/* Must be a power of two, at least twice the count of modems. */
+#endif
+
+#if (RX_RING_LENGTH & (RX_RING_LENGTH - 1)) != 0 || RX_RING_LENGTH < 128
+#error "RX_RING_LENGTH must be a power of two, at least 128"
+#endif
+
+#if (DISPATCH_TABLE_SIZE & (DISPATCH_TABLE_SIZE - 1)) != 0
+#error "DISPATCH_TABLE_SIZE must be a power of two"
+#endif
+
+#if (TX_QUEUE_LENGTH & (TX_QUEUE_LENGTH - 1)) != 0
+#error "TX_QUEUE_LENGTH must be a power of two"
+#endif
+
+#if (SIM800_SIGNAL_SAMPLES & (SIM800_SIGNAL_SAMPLES - 1)) != 0 || SIM800_SIGNAL_SAMPLES > 128
+#error "SIM800_SIGNAL_SAMPLES must be a power of two, at most 128"
+#endif
+
+#if (SIM800_TRACE_LENGTH & (SIM800_TRACE_LENGTH - 1)) != 0 || SIM800_TRACE_LENGTH > 32768 || \
+    SIM800_TRACE_RECORD_MAX + 7 > SIM800_TRACE_LENGTH
+#error "SIM800_TRACE_LENGTH must be a power of two, at most 32768, with room for a record of SIM800_TRACE_RECORD_MAX"
+#endif
+
+#if (TX_ARENA_LENGTH & (TX_ARENA_LENGTH - 1)) != 0 || TX_ARENA_LENGTH < 128
+#error "TX_ARENA_LENGTH must be a power of two, at least 128"
+#endif
+
+#if (REQUEST_QUEUE_LENGTH & (REQUEST_QUEUE_LENGTH - 1)) != 0
+#error "REQUEST_QUEUE_LENGTH must be a power of two"
+#endif
+
+#if (SIM800_EVENT_QUEUE_LENGTH & (SIM800_EVENT_QUEUE_LENGTH - 1)) != 0 || SIM800_EVENT_QUEUE_LENGTH > 128
+#error "SIM800_EVENT_QUEUE_LENGTH must be a power of two, at most 128"
+#endif
+
+#if (UART_TABLE_SIZE & (UART_TABLE_SIZE - 1)) != 0
+#error "UART_TABLE_SIZE must be a power of two"
+#endif
+
+
+/*********************************************************************************************
+ *												SMS
+ ********************************************************************************************/
+
+#ifndef SIM800_SMS_DELETE_BATCH
+#define SIM800_SMS_DELETE_BATCH					8		/* Count of consumed messages deleted by one command line. */
+#endif
+
+#ifndef SIM800_SMS_LOW_SPACE
+#define SIM800_SMS_LOW_SPACE					2		/* Free storage slots below which SIM800_SMSStorageLowCallBack is called. */
+#endif
+
+#ifndef SIM800_SMS_REPORTS_MAX
+#define SIM800_SMS_REPORTS_MAX					8		/* Count of sent messages waiting for their delivery reports. */
+#endif
+
+#ifndef SIM800_SMS_BATCH_INFLIGHT
+#define SIM800_SMS_BATCH_INFLIGHT				2		/* Messages of SIM800_SendSMSBatch (and of the scheduler) queued at a time, the rest of the queue stays free. */
+#endif
+
+#ifndef SIM800_SMS_TEMPLATE_FIELD
+#define SIM800_SMS_TEMPLATE_FIELD				16		/* Longest variable field of an SMS template, see SIM800_PrepareSMSTemplate. */
+#endif
+
+#ifndef SIM800_SMS_SCHED_LENGTH
+#define SIM800_SMS_SCHED_LENGTH					8		/* Messages waiting in the priority scheduler, see SIM800_QueueSMS. */
+#endif
+
+#ifndef SIM800_SMS_RATE_BURST
+#define SIM800_SMS_RATE_BURST					5		/* Scheduled messages the module may send back to back. */
+#endif
+
+#ifndef SIM800_SMS_RATE_PERIOD
+#define SIM800_SMS_RATE_PERIOD					10000	/* Time after which the module may send one more scheduled message (ms). */
+#endif
+
+#ifndef SIM800_SMS_DEST_BURST
+#define SIM800_SMS_DEST_BURST					3		/* Scheduled messages one destination may get back to back. */
+#endif
+
+#ifndef SIM800_SMS_DEST_PERIOD
+#define SIM800_SMS_DEST_PERIOD					60000	/* Time after which one destination may get one more scheduled message (ms). */
+#endif
+
+#ifndef SIM800_SMS_DEST_BUCKETS
+#define SIM800_SMS_DEST_BUCKETS					8		/* Destinations whose rate is tracked at a time. */
+#endif
+
+#ifndef SIM800_SMS_QUEUE_LENGTH
+#define SIM800_SMS_QUEUE_LENGTH					4		/* Count of inbound SMS message slots, one is always kept for parsing. */
+#endif
+
+#define SMS_SENDER_MAX_LEN						20
+#define SMS_TEXT_MAX_LEN						161
+#define SMS_TX_MAX_LEN							100
+#define SMS_UCS2_MAX_LEN						70		/* Characters of a single UCS2 message. */
+#define SIM800_PDU_MAX_OCTETS					176		/* Service centre address (12) and the longest TPDU (164). */
+
+#ifndef SIM800_SMS_CONCAT_MAX
+#define SIM800_SMS_CONCAT_MAX					2		/* Long messages reassembled at a time. */
+#endif
+
+#ifndef SIM800_SMS_CONCAT_PARTS
+#define SIM800_SMS_CONCAT_PARTS					4		/* Maximum count of parts of a received long message, at most 8. */
+#endif
+
+#ifndef SIM800_SMS_CONCAT_TIMEOUT
+#define SIM800_SMS_CONCAT_TIMEOUT				300000	/* Time the parts of an incomplete long message are kept (ms). */
+#endif
+
+#define SIM800_SMS_PART_TEXT					153		/* Maximum count of characters of one part. */
+
+#if (SIM800_SMS_QUEUE_LENGTH & (SIM800_SMS_QUEUE_LENGTH - 1)) != 0 || SIM800_SMS_QUEUE_LENGTH < 2
+#error "SIM800_SMS_QUEUE_LENGTH must be a power of two, at least 2"
+#endif
+
+#if SIM800_SMS_CONCAT_PARTS > 8
+#error "SIM800_SMS_CONCAT_PARTS must not exceed 8"
+#endif
+
+
+/*********************************************************************************************
+ *										GPRS and HTTP
+ ********************************************************************************************/
+
+#ifndef SIM800_SOCKET_COUNT
+#define SIM800_SOCKET_COUNT						6		/* Connections of "AT+CIPMUX=1", at most 6. */
+#endif
+
+#ifndef SIM800_SOCKET_RX_LENGTH
+#define SIM800_SOCKET_RX_LENGTH					256		/* Received data buffered per socket, must be a power of two. */
+#endif
+
+#define SIM800_SOCKET_TX_MAX					1460	/* Longest data block of one "AT+CIPSEND". */
+
+#ifndef SIM800_SOCKET_HOST_MAX
+#define SIM800_SOCKET_HOST_MAX					64		/* Longest host name of SIM800_SocketOpen. */
+#endif
+
+#ifndef SIM800_BEARER_RETRY_MIN
+#define SIM800_BEARER_RETRY_MIN					2000	/* First delay of the reconnection of the GPRS bearer (ms), doubled on every failure. */
+#endif
+
+#ifndef SIM800_BEARER_RETRY_MAX
+#define SIM800_BEARER_RETRY_MAX					300000	/* Longest delay of the reconnection of the GPRS bearer (ms). */
+#endif
+
+#ifndef SIM800_DNS_CACHE_SIZE
+#define SIM800_DNS_CACHE_SIZE					4		/* Host names kept resolved by SIM800_Resolve. */
+#endif
+
+#ifndef SIM800_DNS_TTL
+#define SIM800_DNS_TTL							600000	/* Time a resolved address is used without a new lookup (ms). */
+#endif
+
+#ifndef SIM800_DNS_TIMEOUT
+#define SIM800_DNS_TIMEOUT						30000	/* Time "AT+CDNSGIP" may take to report the result (ms). */
+#endif
+
+#ifndef SIM800_TRANSPARENT_GUARD
+#define SIM800_TRANSPARENT_GUARD				1000	/* Silence before and after the "+++" escape sequence (ms). */
+#endif
+
+#ifndef SIM800_TRANSPARENT_CONNECT_TIMEOUT
+#define SIM800_TRANSPARENT_CONNECT_TIMEOUT		75000	/* Time "AT+CIPSTART" may take to report "CONNECT" (ms). */
+#endif
+
+#define SIM800_HTTP_URL_MAX						(TX_ARENA_LENGTH / 2)	/* Longest URL of the HTTP client. */
+
+#define SIM800_HTTP_READ_CHUNK					(RX_RING_LENGTH / 2)	/* Body bytes read by one "AT+HTTPREAD", a chunk fits the receive ring. */
+
+#ifndef SIM800_HTTP_TIMEOUT
+#define SIM800_HTTP_TIMEOUT						120000	/* Time "AT+HTTPACTION" may take to report the result (ms). */
+#endif
+
+#ifndef SIM800_FS_NAME_MAX
+#define SIM800_FS_NAME_MAX						24		/* Longest file name in C:\User\ of the module file system. */
+#endif
+
+#define SIM800_FS_CHUNK_MAX						10240	/* Longest block of one "AT+FSWRITE" or "AT+FSREAD". */
+
+#if SIM800_SOCKET_COUNT > 6 || (SIM800_SOCKET_RX_LENGTH & (SIM800_SOCKET_RX_LENGTH - 1)) != 0
+#error "SIM800_SOCKET_COUNT must not exceed 6, SIM800_SOCKET_RX_LENGTH must be a power of two"
+#endif
+
+
+/*
+ * Expected codes of the handle: the commands and notifications (RING, +CLIP and +CUSD among them), plus one code
+ * per socket, +RECEIVE, +CDNSGIP and +PDP with GPRS, +HTTPACTION with HTTP, and +UGNSINF with GNSS.
+ */
+#define EXPECTED_CODES_MAX_COUNT				(13 + (SIM800_USE_GPRS ? SIM800_SOCKET_COUNT + 3 : 0) + SIM800_USE_HTTP + SIM800_USE_GNSS)
+
+
+
+
+#endif /* INC_SIM800_CONFIG_H_ */
@@ -0,0 +1,196 @@
+/*
+ * sim800_dispatch.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "ctype.h"
+#include "sim800_dispatch.h"
+
+#if SIM800_USE_SMS
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static int compare_keyword(const char *token, uint32_t length, const char *keyword);
+static uint8_t sender_allowed(const SIM800_Dispatcher_t *dispatcher, const char *sender);
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Checks the command table of a dispatcher.
+ *
+ * The keywords must be non-empty, in upper case and sorted in strictly ascending strcmp order,
+ * otherwise some of them would never be found. Call it once at startup (or in a debug build).
+ *
+ * @param   *dispatcher: Pointer to the dispatcher.
+ * @retval  SIM800_OK if the table is valid, SIM800_ERROR otherwise.
+ */
+SIM800_Status_t SIM800_Dispatch_Check(const SIM800_Dispatcher_t *dispatcher)
+{
+    const char *keyword;
+
+    for (uint16_t i = 0; i < dispatcher->count; i++)
+    {
+        keyword = dispatcher->keywords[i].keyword;
+
+        if (keyword == NULL || keyword[0] == '\0' || dispatcher->keywords[i].handler == NULL)
+        {
+            return SIM800_ERROR;
+        }
+
+        for (const char *c = keyword; *c != '\0'; c++)
+        {
+            if (islower((unsigned char)*c) || isspace((unsigned char)*c))
+            {
+                return SIM800_ERROR;
+            }
+        }
+
+        if (i > 0 && strcmp(dispatcher->keywords[i - 1].keyword, keyword) >= 0)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Dispatches a received SMS message to the handler of its keyword.
+ *
+ * The keyword is the first word of the text, the rest of the text is passed to the handler as
+ * its arguments. The keyword is looked up by a binary search of the sorted command table, so the
+ * cost grows with the logarithm of the count of commands. Messages from senders that are not
+ * allowed are ignored.
+ *
+ * @param   *dispatcher: Pointer to the dispatcher.
+ * @param   *handle: Pointer to the SIM800 handle structure the message is received by.
+ * @param   *message: Pointer to the received message.
+ * @retval  SIM800_OK if a command handler is invoked, SIM800_ERROR if the sender is not allowed
+ *          or the keyword is unknown.
+ */
+SIM800_Status_t SIM800_Dispatch_SMS(const SIM800_Dispatcher_t *dispatcher, SIM800_Handle_t *handle,
+                                    const SIM800_SMSMessage_t *message)
+{
+    const char *token = message->text;
+    const char *args;
+    uint32_t length = 0;
+    uint16_t low = 0, high = dispatcher->count;
+    uint16_t mid;
+    int result;
+
+    if (!sender_allowed(dispatcher, message->sender))
+    {
+        return SIM800_ERROR;
+    }
+
+    while (*token == ' ')
+    {
+        token++;
+    }
+
+    while (token[length] != '\0' && token[length] != ' ' && token[length] != '\r' && token[length] != '\n')
+    {
+        length++;
+    }
+
+    args = token + length;
+    while (*args == ' ')
+    {
+        args++;
+    }
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        result = compare_keyword(token, length, dispatcher->keywords[mid].keyword);
+
+        if (result == 0)
+        {
+            dispatcher->keywords[mid].handler(handle, message, args, dispatcher->ctx);
+            return SIM800_OK;
+        }
+
+        if (result < 0)
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+
+    if (dispatcher->unknown != NULL)
+    {
+        dispatcher->unknown(handle, message, token, dispatcher->ctx);
+    }
+
+    return SIM800_ERROR;
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Compares a word of the text with a keyword, ignoring the case of the word.
+ *
+ * @param   *token: Pointer to the word, not terminated.
+ * @param   length: Length of the word.
+ * @param   *keyword: Keyword in upper case.
+ * @retval  Less than, equal to or greater than zero as the word sorts before, equal to or after the keyword.
+ */
+static int compare_keyword(const char *token, uint32_t length, const char *keyword)
+{
+    unsigned char c;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        c = (unsigned char)toupper((unsigned char)token[i]);
+
+        if (c != (unsigned char)keyword[i])
+        {
+            // The terminating '\0' of a shorter keyword sorts first
+            return (int)c - (int)(unsigned char)keyword[i];
+        }
+    }
+
+    return keyword[length] == '\0' ? 0 : -1;
+}
+
+
+/**
+ * @brief   Checks if the sender of a message may send commands.
+ *
+ * @param   *dispatcher: Pointer to the dispatcher.
+ * @param   *sender: Phone number of the sender.
+ * @retval  1 if the sender is allowed, 0 otherwise.
+ */
+static uint8_t sender_allowed(const SIM800_Dispatcher_t *dispatcher, const char *sender)
+{
+    if (dispatcher->senders == NULL)
+    {
+        return 1;
+    }
+
+    for (uint16_t i = 0; i < dispatcher->sendersCount; i++)
+    {
+        if (strcmp(dispatcher->senders[i], sender) == 0)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#endif /* SIM800_USE_SMS */
@@ -0,0 +1,84 @@
+/*
+ * sim800_dispatch.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_DISPATCH_H_
+#define INC_SIM800_DISPATCH_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_SMS
+
+/*
+ * Count of the entries of a keyword or sender table
+ */
+#ifndef SIM800_DISPATCH_COUNT
+#define SIM800_DISPATCH_COUNT(table)			(sizeof(table) / sizeof((table)[0]))
+#endif
+
+
+/**
+ * @brief   Handler of an SMS command.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure the message is received by.
+ * @param   *message: Pointer to the received message.
+ * @param   *args: Text following the keyword, leading spaces skipped ("" if there is none).
+ * @param   *ctx: Argument of the dispatcher.
+ */
+typedef void (*SIM800_KeywordHandler_t)(SIM800_Handle_t *handle, const SIM800_SMSMessage_t *message,
+                                        const char *args, void *ctx);
+
+
+/**
+ * @brief   Structure representing a keyword of an SMS command.
+ */
+typedef struct
+{
+    const char *keyword;                        /*!< Keyword in upper case, matched case-insensitively. */
+    SIM800_KeywordHandler_t handler;            /*!< Handler of the command. */
+} SIM800_Keyword_t;
+
+
+/**
+ * @brief   Structure representing an SMS command dispatcher.
+ *
+ * The command table is defined at compile time and must be sorted by keyword (strcmp order), so a
+ * keyword is found by a binary search; see SIM800_Dispatch_Check.
+ */
+typedef struct
+{
+    const SIM800_Keyword_t *keywords;           /*!< Sorted keyword table. */
+    uint16_t count;                             /*!< Count of keywords. */
+    const char *const *senders;                 /*!< Phone numbers allowed to send commands, NULL - anyone. */
+    uint16_t sendersCount;                      /*!< Count of allowed phone numbers. */
+    SIM800_KeywordHandler_t unknown;            /*!< Handler of unknown keywords from allowed senders, gets the whole text, may be NULL. */
+    void *ctx;                                  /*!< Argument of the handlers. */
+} SIM800_Dispatcher_t;
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_Dispatch_Check				(const SIM800_Dispatcher_t *dispatcher);
+SIM800_Status_t SIM800_Dispatch_SMS					(const SIM800_Dispatcher_t *dispatcher, SIM800_Handle_t *handle,
+													 const SIM800_SMSMessage_t *message);
+
+
+
+
+#endif /* SIM800_USE_SMS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_DISPATCH_H_ */
@@ -0,0 +1,90 @@
+/*
+ * sim800_flow.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_FLOW_H_
+#define INC_SIM800_FLOW_H_
+
+#include "sim800.h"
+
+
+/*
+ * Stackless coroutines over the non-blocking functions.
+ *
+ * A multi-step flow is written as sequential code that waits at every SIM800_AWAIT, SIM800_FLOW_WAIT_UNTIL and
+ * SIM800_FLOW_DELAY; the function returns there and SIM800_Poll calls it again, it continues at the same
+ * point (the source line of the wait is kept in the flow, a switch jumps back to it). A flow costs its
+ * SIM800_Flow_t only, no stack of its own:
+ *
+ *     static uint8_t alarm(SIM800_Handle_t *handle, SIM800_Flow_t *flow)
+ *     {
+ *         static SIM800_Battery_t battery;
+ *
+ *         SIM800_FLOW_BEGIN(flow);
+ *
+ *         SIM800_FLOW_WAIT_UNTIL(flow, handle->regStatus == SIM800_Registered_HomeNetwork ||
+ *                                      handle->regStatus == SIM800_Registered_Roaming);
+ *         SIM800_AWAIT(flow, SIM800_SubmitBatteryInfo(handle, &battery, SIM800_CONTINUE(flow)));
+ *         if (flow->status == SIM800_OK && battery.battery_level < 3500)
+ *         {
+ *             SIM800_AWAIT(flow, SIM800_SubmitSMSMessage(handle, "+79991234567", "Battery low", SIM800_CONTINUE(flow)));
+ *         }
+ *
+ *         SIM800_FLOW_END(flow);
+ *     }
+ *
+ *     SIM800_StartFlow(&sim800h, &alarmFlow, &alarm, NULL);
+ *
+ * The local variables do not survive a wait, keep them in flow->ctx or make them static. The waits must be in
+ * the function of the flow itself (not in a switch of its own, not in a function it calls), one per line, within
+ * the first 65535 lines of the source file.
+ */
+
+/*
+ * Opens the body of a flow, the first statement of the function
+ */
+#define SIM800_FLOW_BEGIN(flow)					switch ((flow)->line) { case 0:
+
+/*
+ * Closes the body of a flow, the flow ends there
+ */
+#define SIM800_FLOW_END(flow)					} (flow)->line = 0; return SIM800_FLOW_ENDED
+
+/*
+ * Ends the flow at once
+ */
+#define SIM800_FLOW_EXIT(flow)					do { (flow)->line = 0; return SIM800_FLOW_ENDED; } while (0)
+
+/*
+ * Waits until a condition holds, it is checked at every SIM800_Poll
+ */
+#define SIM800_FLOW_WAIT_UNTIL(flow, condition)	\
+    do { (flow)->line = __LINE__; case __LINE__: if (!(condition)) { return SIM800_FLOW_WAITING; } } while (0)
+
+/*
+ * Lets the other flows and the driver run, the flow goes on at the next SIM800_Poll
+ */
+#define SIM800_FLOW_YIELD(flow)					do { (flow)->line = __LINE__; return SIM800_FLOW_WAITING; case __LINE__:; } while (0)
+
+/*
+ * Waits for a time (ms)
+ */
+#define SIM800_FLOW_DELAY(flow, ms)				\
+    do { (flow)->tick = HAL_GetTick(); SIM800_FLOW_WAIT_UNTIL(flow, HAL_GetTick() - (flow)->tick >= (ms)); } while (0)
+
+/*
+ * Completion callback and its argument for the SIM800_Submit function awaited by SIM800_AWAIT
+ */
+#define SIM800_CONTINUE(flow)					&SIM800_FlowCallback, (flow)
+
+/*
+ * Submits a request and waits for its completion, its status is in flow->status then. A request that is not
+ * queued (e.g. the request queue is full) is not awaited, flow->status is the status of the submission
+ */
+#define SIM800_AWAIT(flow, submit)				\
+    do { (flow)->pending = 1; SIM800_FlowSubmitted((flow), (submit)); SIM800_FLOW_WAIT_UNTIL(flow, (flow)->pending == 0); } while (0)
+
+
+#endif /* INC_SIM800_FLOW_H_ */
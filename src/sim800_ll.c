@@ -0,0 +1,217 @@
+/*
+ * sim800_ll.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "sim800_ll.h"
+
+#if SIM800_USE_LL
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint16_t ll_transmit(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+static SIM800_Status_t ll_receive(SIM800_Handle_t *handle, uint8_t enordi, void *ctx);
+static SIM800_Status_t ll_configure(SIM800_Handle_t *handle, uint32_t baud, uint32_t flow, void *ctx);
+static uint32_t ll_baud(SIM800_Handle_t *handle, void *ctx);
+
+
+static const SIM800_Link_t ll_link = { &ll_transmit, NULL, &ll_receive, &ll_configure, &ll_baud };
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Makes a USART driven through the LL drivers the link of a handle.
+ *
+ * Call it before SIM800_Init, which starts the reception, and route the interrupt of the USART to
+ * SIM800_LL_IRQHandler. The USART must be initialised and its interrupt enabled in the NVIC.
+ *
+ * @param   *ll: Pointer to the USART structure.
+ * @param   *handle: Pointer to the SIM800 handle structure, it must not be receiving yet.
+ * @param   *usart: Registers of the USART, e.g. USART1.
+ * @param   clock: Clock of the USART (Hz), e.g. the PCLK2 frequency for USART1.
+ */
+void SIM800_LL_Attach(SIM800_LL_t *ll, SIM800_Handle_t *handle, USART_TypeDef *usart, uint32_t clock)
+{
+    ll->handle = handle;
+    ll->usart = usart;
+    ll->clock = clock;
+    ll->txHead = 0;
+    ll->txTail = 0;
+
+    SIM800_AttachLink(handle, &ll_link, ll);
+}
+
+
+/**
+ * @brief   Handles the interrupt of the USART, call it from USARTx_IRQHandler.
+ *
+ * The status register is read once: a received character (or the one completing an overrun) is written
+ * to the receive ring, the next queued character is sent while the transmit ring has one. The errors
+ * are counted by their type, see SIM800_GetStats.
+ *
+ * @param   *ll: Pointer to the USART structure.
+ */
+void SIM800_LL_IRQHandler(SIM800_LL_t *ll)
+{
+    USART_TypeDef *usart = ll->usart;
+    uint32_t status = LL_USART_ReadReg(usart, SR);
+    uint32_t tail;
+    uint8_t byte;
+
+    if ((status & (USART_SR_RXNE | USART_SR_ORE)) != 0 && LL_USART_IsEnabledIT_RXNE(usart))
+    {
+        // Reading the data register after the status register clears the error flags too
+        byte = LL_USART_ReceiveData8(usart);
+
+#if SIM800_USE_STATS
+        ll->handle->stats.uartOverruns += (status & USART_SR_ORE) != 0;
+        ll->handle->stats.uartFraming += (status & USART_SR_FE) != 0;
+        ll->handle->stats.uartNoise += (status & USART_SR_NE) != 0;
+        ll->handle->stats.uartParity += (status & USART_SR_PE) != 0;
+#endif
+
+        if ((status & USART_SR_RXNE) != 0)
+        {
+            SIM800_LinkInput(ll->handle, &byte, 1);
+        }
+    }
+
+    if ((status & USART_SR_TXE) != 0 && LL_USART_IsEnabledIT_TXE(usart))
+    {
+        tail = ll->txTail;
+
+        if (tail == ll->txHead)
+        {
+            LL_USART_DisableIT_TXE(usart);
+        }
+        else
+        {
+            LL_USART_TransmitData8(usart, ll->tx[tail & (SIM800_LL_TX_LENGTH - 1)]);
+            ll->txTail = tail + 1;
+        }
+    }
+}
+
+
+
+
+/*********************************************************************************************
+ *								Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Copies the data of the handle into the transmit ring, see SIM800_Link_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Data to send.
+ * @param   length: Count of bytes to send.
+ * @param   *ctx: Pointer to the USART structure.
+ * @retval  Count of bytes queued, the rest waits for room in the ring.
+ */
+static uint16_t ll_transmit(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx)
+{
+    SIM800_LL_t *ll = (SIM800_LL_t *)ctx;
+    uint32_t head = ll->txHead;
+    uint16_t count = 0;
+
+    while (count < length && head - ll->txTail < SIM800_LL_TX_LENGTH)
+    {
+        ll->tx[head++ & (SIM800_LL_TX_LENGTH - 1)] = data[count++];
+    }
+
+    if (count != 0)
+    {
+        // Make sure the characters are written before the interrupt sees them
+        __DMB();
+        ll->txHead = head;
+        LL_USART_EnableIT_TXE(ll->usart);
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Starts or stops the reception of the USART, see SIM800_Link_t.
+ *
+ * While the reception is stopped, the next character stays in the data register; with flow control
+ * the USART holds RTS high meanwhile, so the module pauses.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   enordi: ENABLE(1) to start receiving, DISABLE(0) to stop receiving.
+ * @param   *ctx: Pointer to the USART structure.
+ * @retval  SIM800_OK.
+ */
+static SIM800_Status_t ll_receive(SIM800_Handle_t *handle, uint8_t enordi, void *ctx)
+{
+    SIM800_LL_t *ll = (SIM800_LL_t *)ctx;
+
+    if (enordi == ENABLE)
+    {
+        LL_USART_EnableIT_ERROR(ll->usart);
+        LL_USART_EnableIT_RXNE(ll->usart);
+        LL_USART_Enable(ll->usart);
+    }
+    else
+    {
+        LL_USART_DisableIT_RXNE(ll->usart);
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Sets the baud rate and the hardware flow control of the USART, see SIM800_Link_t.
+ *
+ * The characters still in the transmit ring are sent with the old configuration first.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   baud: Baud rate to set.
+ * @param   flow: Hardware flow control to set, UART_HWCONTROL_NONE or UART_HWCONTROL_RTS_CTS.
+ * @param   *ctx: Pointer to the USART structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the transmit ring does not drain.
+ */
+static SIM800_Status_t ll_configure(SIM800_Handle_t *handle, uint32_t baud, uint32_t flow, void *ctx)
+{
+    SIM800_LL_t *ll = (SIM800_LL_t *)ctx;
+    uint32_t tickStart = HAL_GetTick();
+
+    while (ll->txTail != ll->txHead || !LL_USART_IsActiveFlag_TC(ll->usart))
+    {
+        if (HAL_GetTick() - tickStart > SIM800_MAX_DELAY)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    LL_USART_Disable(ll->usart);
+    LL_USART_SetBaudRate(ll->usart, ll->clock, LL_USART_OVERSAMPLING_16, baud);
+    LL_USART_SetHWFlowCtrl(ll->usart, flow);
+    LL_USART_Enable(ll->usart);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Returns the baud rate of the USART, see SIM800_Link_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *ctx: Pointer to the USART structure.
+ * @retval  Baud rate.
+ */
+static uint32_t ll_baud(SIM800_Handle_t *handle, void *ctx)
+{
+    SIM800_LL_t *ll = (SIM800_LL_t *)ctx;
+
+    return LL_USART_GetBaudRate(ll->usart, ll->clock, LL_USART_OVERSAMPLING_16);
+}
+
+#endif /* SIM800_USE_LL */
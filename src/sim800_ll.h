@@ -0,0 +1,69 @@
+/*
+ * sim800_ll.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_LL_H_
+#define INC_SIM800_LL_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_LL
+
+#include "stm32f4xx_ll_usart.h"
+
+#ifndef SIM800_LL_TX_LENGTH
+#define SIM800_LL_TX_LENGTH						256		/* Transmit ring of the USART, a power of 2. */
+#endif
+
+#if (SIM800_LL_TX_LENGTH & (SIM800_LL_TX_LENGTH - 1)) != 0
+#error "SIM800_LL_TX_LENGTH must be a power of 2"
+#endif
+
+
+/**
+ * @brief   Structure representing a USART driven through the LL drivers, the link of a handle.
+ *
+ * The USART is the transport of the handle instead of a HAL UART handle: one interrupt handler moves
+ * every received character into the receive ring (SIM800_LinkInput) and every queued one out of the
+ * transmit ring, with a single read of the status register and no HAL state machine in between. The
+ * queued blocks are copied into the transmit ring as far as it has room, the rest is offered again by
+ * SIM800_Process. The USART itself (pins, frame format, NVIC) is set up by the application, e.g. with
+ * LL_USART_Init; SIM800_NegotiateBaud, SIM800_AutoBaud and SIM800_ManageFlowControl work as with a UART.
+ */
+typedef struct
+{
+    SIM800_Handle_t *handle;                    /*!< Handle the USART is the link of. */
+    USART_TypeDef *usart;                       /*!< Registers of the USART, e.g. USART1. */
+    uint32_t clock;                             /*!< Clock of the USART (Hz), the baud rate is derived from it. */
+    uint8_t tx[SIM800_LL_TX_LENGTH];            /*!< Transmit ring. */
+    volatile uint32_t txHead;                   /*!< Write index of the transmit ring, advanced by SIM800_Process. */
+    volatile uint32_t txTail;                   /*!< Read index of the transmit ring, advanced by the interrupt. */
+} SIM800_LL_t;
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+void SIM800_LL_Attach								(SIM800_LL_t *ll, SIM800_Handle_t *handle, USART_TypeDef *usart,
+														 uint32_t clock);
+void SIM800_LL_IRQHandler							(SIM800_LL_t *ll);
+
+
+
+
+#endif /* SIM800_USE_LL */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_LL_H_ */
@@ -0,0 +1,720 @@
+/*
+ * sim800_mqtt.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_mqtt.h"
+
+#if SIM800_USE_MQTT
+
+/*
+ * Types of the control packets, the high nibble of the first byte
+ */
+#define MQTT_CONNECT							0x10
+#define MQTT_CONNACK							0x20
+#define MQTT_PUBLISH							0x30
+#define MQTT_PUBACK								0x40
+#define MQTT_SUBSCRIBE							0x82	/* Including the reserved flags. */
+#define MQTT_SUBACK								0x90
+#define MQTT_PINGREQ							0xC0
+#define MQTT_PINGRESP							0xD0
+#define MQTT_DISCONNECT							0xE0
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint8_t *mqtt_begin(SIM800_MQTT_t *client, uint8_t type, uint32_t remaining);
+static uint8_t *put_u16(uint8_t *p, uint16_t value);
+static uint8_t *put_str(uint8_t *p, const char *str, uint16_t length);
+static uint16_t next_id(SIM800_MQTT_t *client);
+static void mqtt_flush(SIM800_MQTT_t *client);
+static void mqtt_read(SIM800_MQTT_t *client);
+static void mqtt_decode(SIM800_MQTT_t *client);
+static void mqtt_packet(SIM800_MQTT_t *client, uint8_t type, const uint8_t *p, uint32_t length);
+static void mqtt_consume(SIM800_MQTT_t *client, uint32_t count);
+static void mqtt_lost(SIM800_MQTT_t *client);
+
+static void mqtt_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void mqtt_received(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Prepares an MQTT client.
+ *
+ * The client runs on a socket of the multi-connection mode in manual receive mode: call SIM800_SocketInit
+ * and SIM800_ManageManualReceive before connecting. The socket must not be used by the application.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @param   *handle: Pointer to the SIM800 handle structure of the modem.
+ * @param   socket: Socket of the connection.
+ * @param   message: Callback receiving the published messages, may be NULL.
+ * @param   event: Callback receiving the events of the client, may be NULL.
+ * @param   *ctx: Argument of the application, stored in client->ctx.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the socket number is invalid.
+ */
+SIM800_Status_t SIM800_MQTT_Init(SIM800_MQTT_t *client, SIM800_Handle_t *handle, uint8_t socket,
+                                 SIM800_MQTTMessageCallback_t message, SIM800_MQTTEventCallback_t event,
+                                 void *ctx)
+{
+    if (socket >= SIM800_SOCKET_COUNT)
+    {
+        return SIM800_ERROR;
+    }
+
+    memset(client, 0, sizeof(*client));
+    client->handle = handle;
+    client->socket = socket;
+    client->message = message;
+    client->event = event;
+    client->ctx = ctx;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Starts a session with a broker.
+ *
+ * The function returns once the module accepts the connection, the session is established later by
+ * SIM800_MQTT_Poll: "CONNECT" is sent as soon as the TCP connection is open, and "CONNACK" invokes the
+ * event callback with SIM800_MQTTEvent_Connected (or SIM800_MQTTEvent_Refused). A connection left over
+ * from a lost session is closed first.
+ *
+ * @param   *client: Pointer to the client structure, see SIM800_MQTT_Init.
+ * @param   *host: Host name or IP address of the broker.
+ * @param   port: Port of the broker, e.g. 1883.
+ * @param   *options: Pointer to the options of the session, the strings are copied.
+ * @retval  SIM800_OK if the connection is being opened, SIM800_ERROR on failure (also for a password without
+ *          a user name, which MQTT 3.1.1 does not allow), SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_MQTT_Connect(SIM800_MQTT_t *client, const char *host, uint16_t port,
+                                    const SIM800_MQTTOptions_t *options)
+{
+    SIM800_Socket_t *socket = &client->handle->sockets[client->socket];
+    SIM800_Status_t status;
+    uint16_t idLength = strlen(options->clientId);
+    uint16_t userLength = options->username != NULL ? strlen(options->username) : 0;
+    uint16_t passLength = options->password != NULL ? strlen(options->password) : 0;
+    uint32_t remaining = 10 + 2 + idLength;
+    uint8_t flags = options->cleanSession ? 0x02 : 0x00;
+    uint8_t *p;
+
+    if (client->state != SIM800_MQTT_Disconnected || client->handle->socketManual == 0 || client->txBusy || client->rxBusy ||
+        (options->password != NULL && options->username == NULL))
+    {
+        return SIM800_ERROR;
+    }
+
+    if (options->username != NULL)
+    {
+        remaining += 2 + userLength;
+        flags |= 0x80;
+    }
+    if (options->password != NULL)
+    {
+        remaining += 2 + passLength;
+        flags |= 0x40;
+    }
+
+    if (socket->state != SIM800_Socket_Closed && (status = SIM800_SocketClose(client->handle, client->socket)) != SIM800_OK)
+    {
+        return status;
+    }
+
+    client->keepAlive = options->keepAlive != 0 ? options->keepAlive : SIM800_MQTT_DEFAULT_KEEP_ALIVE;
+    client->txLength[0] = 0;
+    client->txLength[1] = 0;
+    client->txFill = 0;
+    client->rxLength = 0;
+    client->rxSkip = 0;
+    client->pingPending = 0;
+
+    if ((p = mqtt_begin(client, MQTT_CONNECT, remaining)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    // Protocol name and level 4 (3.1.1), flags, keep alive, then the payload
+    p = put_str(p, "MQTT", 4);
+    *p++ = 4;
+    *p++ = flags;
+    p = put_u16(p, client->keepAlive);
+    p = put_str(p, options->clientId, idLength);
+    if (options->username != NULL)
+    {
+        p = put_str(p, options->username, userLength);
+    }
+    if (options->password != NULL)
+    {
+        put_str(p, options->password, passLength);
+    }
+
+    if ((status = SIM800_SocketOpen(client->handle, client->socket, SIM800_Socket_TCP, host, port)) != SIM800_OK)
+    {
+        client->txLength[0] = 0;
+        return status;
+    }
+
+    client->state = SIM800_MQTT_Connecting;
+    client->tickStart = HAL_GetTick();
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Queues a message for publishing.
+ *
+ * The packet is encoded into the packet buffer and sent by SIM800_MQTT_Poll. A QoS 1 message is
+ * acknowledged by SIM800_MQTTEvent_Published with its packet identifier.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @param   *topic: Topic name.
+ * @param   *payload: Payload, copied into the packet.
+ * @param   length: Length of the payload.
+ * @param   qos: 0 or 1.
+ * @param   *packetId: Pointer to store the packet identifier of a QoS 1 message, may be NULL.
+ * @retval  SIM800_OK if the message is queued, SIM800_ERROR if the session is not established or the
+ *          packet buffer is full (retry after SIM800_MQTT_Poll).
+ */
+SIM800_Status_t SIM800_MQTT_Publish(SIM800_MQTT_t *client, const char *topic, const uint8_t *payload,
+                                    uint16_t length, uint8_t qos, uint16_t *packetId)
+{
+    uint16_t topicLength = strlen(topic);
+    uint32_t remaining = 2 + topicLength + (qos != 0 ? 2 : 0) + length;
+    uint16_t id = 0;
+    uint8_t *p;
+
+    if (client->state != SIM800_MQTT_Connected || qos > 1 || topicLength == 0 ||
+        (p = mqtt_begin(client, MQTT_PUBLISH | (qos << 1), remaining)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    p = put_str(p, topic, topicLength);
+    if (qos != 0)
+    {
+        id = next_id(client);
+        p = put_u16(p, id);
+    }
+    memcpy(p, payload, length);
+
+    if (packetId != NULL)
+    {
+        *packetId = id;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Queues a subscription.
+ *
+ * The subscription is confirmed by SIM800_MQTTEvent_Subscribed (or SIM800_MQTTEvent_SubscribeFailed)
+ * with its packet identifier.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @param   *topic: Topic filter.
+ * @param   qos: Maximum QoS of the messages, 0 or 1.
+ * @param   *packetId: Pointer to store the packet identifier, may be NULL.
+ * @retval  SIM800_OK if the subscription is queued, SIM800_ERROR if the session is not established or the
+ *          packet buffer is full.
+ */
+SIM800_Status_t SIM800_MQTT_Subscribe(SIM800_MQTT_t *client, const char *topic, uint8_t qos, uint16_t *packetId)
+{
+    uint16_t topicLength = strlen(topic);
+    uint16_t id;
+    uint8_t *p;
+
+    if (client->state != SIM800_MQTT_Connected || qos > 1 || topicLength == 0 ||
+        (p = mqtt_begin(client, MQTT_SUBSCRIBE, 2 + 2 + topicLength + 1)) == NULL)
+    {
+        return SIM800_ERROR;
+    }
+
+    id = next_id(client);
+    p = put_u16(p, id);
+    p = put_str(p, topic, topicLength);
+    *p = qos;
+
+    if (packetId != NULL)
+    {
+        *packetId = id;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Ends the session.
+ *
+ * "DISCONNECT" is sent after the packets queued so far, then the connection is closed. No event is
+ * reported for a session ended by this function.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_MQTT_Disconnect(SIM800_MQTT_t *client)
+{
+    uint32_t tickStart = HAL_GetTick();
+
+    if (client->state == SIM800_MQTT_Connected && mqtt_begin(client, MQTT_DISCONNECT, 0) != NULL)
+    {
+        while (client->state == SIM800_MQTT_Connected && (client->txBusy || client->txLength[client->txFill] != 0))
+        {
+            SIM800_MQTT_Poll(client);
+
+            if (HAL_GetTick() - tickStart > SIM800_MQTT_CONNECT_TIMEOUT)
+            {
+                break;
+            }
+
+            SIM800_OS_Wait(client->handle, SIM800_WAIT_SLICE);
+        }
+    }
+
+    client->state = SIM800_MQTT_Disconnected;
+
+    if (client->handle->sockets[client->socket].state == SIM800_Socket_Closed)
+    {
+        return SIM800_OK;
+    }
+
+    return SIM800_SocketClose(client->handle, client->socket);
+}
+
+
+/**
+ * @brief   Drives the MQTT client.
+ *
+ * This function must be called regularly instead of calling SIM800_Poll for the modem. It polls the
+ * modem, sends the queued packets, reads and decodes the received packets and keeps the session alive:
+ * "PINGREQ" is queued once nothing has been sent for the keep alive, and a session whose "PINGRESP"
+ * (or "CONNACK") is overdue is reported as SIM800_MQTTEvent_Disconnected.
+ *
+ * @param   *client: Pointer to the client structure.
+ */
+void SIM800_MQTT_Poll(SIM800_MQTT_t *client)
+{
+    SIM800_Socket_t *socket = &client->handle->sockets[client->socket];
+    uint32_t keepAlive = (uint32_t)client->keepAlive * 1000;
+
+    SIM800_Poll(client->handle);
+
+    if (client->state == SIM800_MQTT_Disconnected)
+    {
+        return;
+    }
+
+    if (socket->state == SIM800_Socket_Closed ||
+        (client->state == SIM800_MQTT_Connecting && HAL_GetTick() - client->tickStart > SIM800_MQTT_CONNECT_TIMEOUT) ||
+        (client->pingPending && HAL_GetTick() - client->pingTick > keepAlive))
+    {
+        mqtt_lost(client);
+        return;
+    }
+
+    if (client->state == SIM800_MQTT_Connected && !client->pingPending && HAL_GetTick() - client->txTick >= keepAlive &&
+        mqtt_begin(client, MQTT_PINGREQ, 0) != NULL)
+    {
+        client->pingPending = 1;
+        client->pingTick = HAL_GetTick();
+    }
+
+    mqtt_flush(client);
+    mqtt_read(client);
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Appends the fixed header of a packet to the packet buffer being filled.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @param   type: First byte of the packet (type and flags).
+ * @param   remaining: Remaining length of the packet.
+ * @retval  Pointer to the variable header of the packet, NULL if the packet does not fit.
+ */
+static uint8_t *mqtt_begin(SIM800_MQTT_t *client, uint8_t type, uint32_t remaining)
+{
+    uint16_t *length = &client->txLength[client->txFill];
+    uint32_t size = 2 + remaining + (remaining >= 128) + (remaining >= 16384);
+    uint8_t *p = &client->tx[client->txFill][*length];
+
+    if (*length + size > SIM800_MQTT_TX_LENGTH)
+    {
+        return NULL;
+    }
+
+    *length += size;
+    *p++ = type;
+
+    // Variable length, 7 bits per byte, least significant first
+    do
+    {
+        *p = remaining & 0x7F;
+        remaining >>= 7;
+        *p++ |= (remaining != 0) ? 0x80 : 0x00;
+    } while (remaining != 0);
+
+    return p;
+}
+
+
+/**
+ * @brief   Writes a big-endian 16-bit value.
+ *
+ * @param   *p: Destination.
+ * @param   value: Value to write.
+ * @retval  Pointer past the value.
+ */
+static uint8_t *put_u16(uint8_t *p, uint16_t value)
+{
+    *p++ = value >> 8;
+    *p++ = value & 0xFF;
+
+    return p;
+}
+
+
+/**
+ * @brief   Writes a length-prefixed string.
+ *
+ * @param   *p: Destination.
+ * @param   *str: String to write.
+ * @param   length: Length of the string.
+ * @retval  Pointer past the string.
+ */
+static uint8_t *put_str(uint8_t *p, const char *str, uint16_t length)
+{
+    p = put_u16(p, length);
+    memcpy(p, str, length);
+
+    return p + length;
+}
+
+
+/**
+ * @brief   Takes the next packet identifier, 0 is skipped.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @retval  Packet identifier.
+ */
+static uint16_t next_id(SIM800_MQTT_t *client)
+{
+    if (++client->nextId == 0)
+    {
+        client->nextId = 1;
+    }
+
+    return client->nextId;
+}
+
+
+/**
+ * @brief   Sends the filled packet buffer unless the other one is still being sent.
+ *
+ * The buffer is sent by "AT+CIPSEND" straight from the client, the following packets are encoded
+ * into the other buffer meanwhile.
+ *
+ * @param   *client: Pointer to the client structure.
+ */
+static void mqtt_flush(SIM800_MQTT_t *client)
+{
+    uint8_t fill = client->txFill;
+
+    if (client->txBusy || client->txLength[fill] == 0 ||
+        client->handle->sockets[client->socket].state != SIM800_Socket_Connected)
+    {
+        return;
+    }
+
+    if (SIM800_SubmitSocketSendEx(client->handle, client->socket, client->tx[fill], client->txLength[fill],
+                                  &mqtt_sent, client, NULL) == SIM800_OK)
+    {
+        client->txBusy = 1;
+        client->txFill = fill ^ 1;
+        client->txTick = HAL_GetTick();
+    }
+}
+
+
+/**
+ * @brief   Reads the data waiting in the module into the free part of the receive buffer.
+ *
+ * @param   *client: Pointer to the client structure.
+ */
+static void mqtt_read(SIM800_MQTT_t *client)
+{
+    if (client->rxBusy || !client->handle->sockets[client->socket].rxPending)
+    {
+        return;
+    }
+
+    client->read.buffer = &client->rx[client->rxLength];
+    client->read.size = SIM800_MQTT_RX_LENGTH - client->rxLength;
+
+    if (SIM800_SubmitSocketReadEx(client->handle, client->socket, &client->read, &mqtt_received, client, NULL) == SIM800_OK)
+    {
+        client->rxBusy = 1;
+    }
+}
+
+
+/**
+ * @brief   Decodes the complete packets of the receive buffer.
+ *
+ * A packet longer than the receive buffer is skipped as it arrives, the rest of a partial packet stays
+ * in the buffer until the read of its remainder.
+ *
+ * @param   *client: Pointer to the client structure.
+ */
+static void mqtt_decode(SIM800_MQTT_t *client)
+{
+    uint32_t remaining;
+    uint32_t header;
+    uint32_t count;
+
+    while (client->rxLength != 0)
+    {
+        if (client->rxSkip != 0)
+        {
+            count = (client->rxSkip < client->rxLength) ? client->rxSkip : client->rxLength;
+            client->rxSkip -= count;
+            mqtt_consume(client, count);
+            continue;
+        }
+
+        // Variable length of at most 4 bytes following the first byte
+        remaining = 0;
+        for (header = 1; header < client->rxLength && header <= 4; header++)
+        {
+            remaining |= (uint32_t)(client->rx[header] & 0x7F) << (7 * (header - 1));
+            if ((client->rx[header] & 0x80) == 0)
+            {
+                break;
+            }
+        }
+
+        if (header > 4)
+        {
+            // Malformed length, the stream can not be followed any more
+            mqtt_lost(client);
+            return;
+        }
+
+        if (header == client->rxLength)
+        {
+            return;
+        }
+        header++;
+
+        if (header + remaining > SIM800_MQTT_RX_LENGTH)
+        {
+            client->rxSkipped++;
+            client->rxSkip = header + remaining;
+            continue;
+        }
+
+        if (client->rxLength < header + remaining)
+        {
+            return;
+        }
+
+        mqtt_packet(client, client->rx[0], &client->rx[header], remaining);
+        mqtt_consume(client, header + remaining);
+    }
+}
+
+
+/**
+ * @brief   Handles a received packet.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @param   type: First byte of the packet (type and flags).
+ * @param   *p: Pointer to the variable header of the packet.
+ * @param   length: Remaining length of the packet.
+ */
+static void mqtt_packet(SIM800_MQTT_t *client, uint8_t type, const uint8_t *p, uint32_t length)
+{
+    uint16_t topicLength;
+    uint32_t offset;
+    uint16_t id = 0;
+    uint8_t *ack;
+
+    switch (type & 0xF0)
+    {
+        case MQTT_CONNACK:
+            if (client->state != SIM800_MQTT_Connecting || length < 2)
+            {
+                break;
+            }
+
+            if (p[1] == 0)
+            {
+                client->state = SIM800_MQTT_Connected;
+                client->txTick = HAL_GetTick();
+            }
+            else
+            {
+                // The broker closes the connection after a refusal
+                client->state = SIM800_MQTT_Disconnected;
+            }
+
+            if (client->event != NULL)
+            {
+                client->event(client, p[1] == 0 ? SIM800_MQTTEvent_Connected : SIM800_MQTTEvent_Refused, p[1]);
+            }
+            break;
+
+        case MQTT_PUBLISH:
+            topicLength = (length >= 2) ? (p[0] << 8) | p[1] : 0;
+            offset = 2 + (uint32_t)topicLength;
+            if (offset > length)
+            {
+                break;
+            }
+
+            if (type & 0x06)
+            {
+                if (offset + 2 > length)
+                {
+                    break;
+                }
+                id = (p[offset] << 8) | p[offset + 1];
+                offset += 2;
+            }
+
+            if (client->message != NULL)
+            {
+                client->message(client, (const char *)&p[2], topicLength, &p[offset], length - offset);
+            }
+
+            // Only QoS 0 and 1 are subscribed to; an acknowledgement that does not fit is sent again
+            // by the broker on the next session
+            if ((type & 0x06) == 0x02 && (ack = mqtt_begin(client, MQTT_PUBACK, 2)) != NULL)
+            {
+                put_u16(ack, id);
+            }
+            break;
+
+        case MQTT_PUBACK:
+            if (length >= 2 && client->event != NULL)
+            {
+                client->event(client, SIM800_MQTTEvent_Published, (p[0] << 8) | p[1]);
+            }
+            break;
+
+        case MQTT_SUBACK:
+            if (length >= 3 && client->event != NULL)
+            {
+                client->event(client, (p[2] & 0x80) ? SIM800_MQTTEvent_SubscribeFailed : SIM800_MQTTEvent_Subscribed,
+                              (p[0] << 8) | p[1]);
+            }
+            break;
+
+        case MQTT_PINGRESP:
+            client->pingPending = 0;
+            break;
+
+        default:
+            break;
+    }
+}
+
+
+/**
+ * @brief   Drops bytes from the start of the receive buffer.
+ *
+ * @param   *client: Pointer to the client structure.
+ * @param   count: Count of bytes to drop.
+ */
+static void mqtt_consume(SIM800_MQTT_t *client, uint32_t count)
+{
+    client->rxLength -= count;
+    memmove(client->rx, &client->rx[count], client->rxLength);
+}
+
+
+/**
+ * @brief   Ends a session lost to the network or the broker.
+ *
+ * @param   *client: Pointer to the client structure.
+ */
+static void mqtt_lost(SIM800_MQTT_t *client)
+{
+    if (client->state == SIM800_MQTT_Disconnected)
+    {
+        return;
+    }
+
+    client->state = SIM800_MQTT_Disconnected;
+    client->txLength[client->txFill] = 0;
+    client->rxLength = 0;
+    client->rxSkip = 0;
+    client->pingPending = 0;
+
+    if (client->event != NULL)
+    {
+        client->event(client, SIM800_MQTTEvent_Disconnected, 0);
+    }
+}
+
+
+/**
+ * @brief   Completion callback of the send of a packet buffer.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the client structure.
+ */
+static void mqtt_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_MQTT_t *client = (SIM800_MQTT_t *)ctx;
+
+    client->txLength[client->txFill ^ 1] = 0;
+    client->txBusy = 0;
+
+    if (status != SIM800_OK)
+    {
+        mqtt_lost(client);
+    }
+}
+
+
+/**
+ * @brief   Completion callback of a read of the received data.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the client structure.
+ */
+static void mqtt_received(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_MQTT_t *client = (SIM800_MQTT_t *)ctx;
+
+    client->rxBusy = 0;
+
+    if (status != SIM800_OK || client->state == SIM800_MQTT_Disconnected)
+    {
+        return;
+    }
+
+    client->rxLength += client->read.length;
+    mqtt_decode(client);
+}
+
+#endif /* SIM800_USE_MQTT */
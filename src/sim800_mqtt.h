@@ -0,0 +1,152 @@
+/*
+ * sim800_mqtt.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_MQTT_H_
+#define INC_SIM800_MQTT_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_MQTT
+
+#ifndef SIM800_MQTT_TX_LENGTH
+#define SIM800_MQTT_TX_LENGTH					256		/* Size of each of the two packet buffers, the largest packet sent. */
+#endif
+
+#ifndef SIM800_MQTT_RX_LENGTH
+#define SIM800_MQTT_RX_LENGTH					512		/* Largest packet received, longer ones are skipped. */
+#endif
+
+#ifndef SIM800_MQTT_CONNECT_TIMEOUT
+#define SIM800_MQTT_CONNECT_TIMEOUT				30000	/* Time the connection and "CONNACK" may take (ms). */
+#endif
+
+#ifndef SIM800_MQTT_DEFAULT_KEEP_ALIVE
+#define SIM800_MQTT_DEFAULT_KEEP_ALIVE			60		/* Keep alive of a client without one set (s). */
+#endif
+
+
+typedef struct SIM800_MQTT SIM800_MQTT_t;
+
+
+/**
+ * @brief   Enumeration of the client states.
+ */
+typedef enum
+{
+    SIM800_MQTT_Disconnected,                   /*!< No session, see SIM800_MQTT_Connect. */
+    SIM800_MQTT_Connecting,                     /*!< Waiting for the TCP connection and "CONNACK". */
+    SIM800_MQTT_Connected,                      /*!< Session established. */
+} SIM800_MQTTState_t;
+
+
+/**
+ * @brief   Enumeration of the client events.
+ */
+typedef enum
+{
+    SIM800_MQTTEvent_Connected,                 /*!< "CONNACK" accepted the session. */
+    SIM800_MQTTEvent_Refused,                   /*!< "CONNACK" refused the session, the argument is the return code. */
+    SIM800_MQTTEvent_Disconnected,              /*!< The connection is lost or could not be established. */
+    SIM800_MQTTEvent_Published,                 /*!< "PUBACK" of a QoS 1 message, the argument is its packet identifier. */
+    SIM800_MQTTEvent_Subscribed,                /*!< "SUBACK" granted a subscription, the argument is its packet identifier. */
+    SIM800_MQTTEvent_SubscribeFailed,           /*!< "SUBACK" refused a subscription, the argument is its packet identifier. */
+} SIM800_MQTTEvent_t;
+
+
+/**
+ * @brief   Callback receiving a published message.
+ *
+ * The topic (not terminated) and the payload point into the receive buffer of the client and are only
+ * valid during the call. The callback is invoked from SIM800_MQTT_Poll, it must not call blocking functions.
+ */
+typedef void (*SIM800_MQTTMessageCallback_t)(SIM800_MQTT_t *client, const char *topic, uint16_t topicLength,
+                                             const uint8_t *payload, uint16_t length);
+
+
+/**
+ * @brief   Callback receiving the events of the client, invoked from SIM800_MQTT_Poll.
+ */
+typedef void (*SIM800_MQTTEventCallback_t)(SIM800_MQTT_t *client, SIM800_MQTTEvent_t event, uint16_t argument);
+
+
+/**
+ * @brief   Structure representing the options of a session, see SIM800_MQTT_Connect.
+ */
+typedef struct
+{
+    const char *clientId;                       /*!< Client identifier. */
+    const char *username;                       /*!< User name, NULL - none. */
+    const char *password;                       /*!< Password, NULL - none; it needs a user name. */
+    uint16_t keepAlive;                         /*!< Keep alive (s), 0 - SIM800_MQTT_DEFAULT_KEEP_ALIVE. */
+    uint8_t cleanSession;                       /*!< 1 - the broker drops the state of an earlier session. */
+} SIM800_MQTTOptions_t;
+
+
+/**
+ * @brief   Structure representing an MQTT 3.1.1 client running on a socket.
+ *
+ * The packets are encoded straight into one of two buffers: one is filled while the other one is sent by
+ * "AT+CIPSEND" as it is, so the packets queued meanwhile leave in one TCP segment. The received data is
+ * read by "AT+CIPRXGET" into the receive buffer and decoded there.
+ */
+struct SIM800_MQTT
+{
+    SIM800_Handle_t *handle;                    /*!< Handle of the modem. */
+    uint8_t socket;                             /*!< Socket of the connection. */
+    SIM800_MQTTState_t state;                   /*!< Session state. */
+    uint16_t keepAlive;                         /*!< Keep alive of the session (s). */
+    uint16_t nextId;                            /*!< Last packet identifier used. */
+    uint32_t tickStart;                         /*!< Tick at which the connection has been started. */
+    uint32_t txTick;                            /*!< Tick at which the last packet has been sent. */
+    uint32_t pingTick;                          /*!< Tick at which "PINGREQ" has been queued. */
+    uint8_t pingPending;                        /*!< 1 while "PINGRESP" is awaited. */
+    uint8_t tx[2][SIM800_MQTT_TX_LENGTH];       /*!< Packet buffers. */
+    uint16_t txLength[2];                       /*!< Count of bytes queued in the packet buffers. */
+    uint8_t txFill;                             /*!< Index of the buffer the packets are encoded into. */
+    uint8_t txBusy;                             /*!< 1 while the other buffer is being sent. */
+    uint8_t rx[SIM800_MQTT_RX_LENGTH];          /*!< Receive buffer. */
+    uint16_t rxLength;                          /*!< Count of bytes in the receive buffer. */
+    uint32_t rxSkip;                            /*!< Count of bytes of a too long packet still to skip. */
+    uint32_t rxSkipped;                         /*!< Count of packets skipped because they were too long. */
+    SIM800_SocketRead_t read;                   /*!< Read of the received data. */
+    uint8_t rxBusy;                             /*!< 1 while a read is submitted. */
+    SIM800_MQTTMessageCallback_t message;       /*!< Callback receiving the messages, may be NULL. */
+    SIM800_MQTTEventCallback_t event;           /*!< Callback receiving the events, may be NULL. */
+    void *ctx;                                  /*!< Argument of the application. */
+};
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_MQTT_Init					(SIM800_MQTT_t *client, SIM800_Handle_t *handle, uint8_t socket,
+													 SIM800_MQTTMessageCallback_t message, SIM800_MQTTEventCallback_t event,
+													 void *ctx);
+SIM800_Status_t SIM800_MQTT_Connect					(SIM800_MQTT_t *client, const char *host, uint16_t port,
+													 const SIM800_MQTTOptions_t *options);
+SIM800_Status_t SIM800_MQTT_Publish					(SIM800_MQTT_t *client, const char *topic, const uint8_t *payload,
+													 uint16_t length, uint8_t qos, uint16_t *packetId);
+SIM800_Status_t SIM800_MQTT_Subscribe				(SIM800_MQTT_t *client, const char *topic, uint8_t qos, uint16_t *packetId);
+SIM800_Status_t SIM800_MQTT_Disconnect				(SIM800_MQTT_t *client);
+void SIM800_MQTT_Poll								(SIM800_MQTT_t *client);
+
+
+
+
+#endif /* SIM800_USE_MQTT */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_MQTT_H_ */
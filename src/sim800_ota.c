@@ -0,0 +1,342 @@
+/*
+ * sim800_ota.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_ota.h"
+
+#if SIM800_USE_OTA
+
+#define OTA_SMALL_SECTOR						0x4000	/* Sectors 0 ... 3. */
+#define OTA_MEDIUM_SECTOR						0x10000	/* Sector 4. */
+#define OTA_LARGE_SECTOR						0x20000	/* Sectors 5 ... */
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint32_t ota_sector(uint32_t address);
+static uint32_t ota_sector_start(uint32_t sector);
+static SIM800_Status_t ota_program(SIM800_OTA_t *ota, uint8_t wait);
+
+static void ota_body(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx);
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Unlocks the flash and starts erasing the area of an image.
+ *
+ * The erase is interrupt-driven, route HAL_FLASH_EndOfOperationCallback and HAL_FLASH_OperationErrorCallback
+ * to SIM800_OTA_EndOfOperation and SIM800_OTA_OperationError, and call HAL_FLASH_IRQHandler from
+ * FLASH_IRQHandler. The flash stays unlocked until SIM800_OTA_Finish.
+ *
+ * @param   *ota: Pointer to the image structure.
+ * @param   address: Address of the image, the start of a sector (e.g. 0x08020000).
+ * @param   size: Size of the area of the image, the sectors it touches are erased.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+SIM800_Status_t SIM800_OTA_Begin(SIM800_OTA_t *ota, uint32_t address, uint32_t size)
+{
+    FLASH_EraseInitTypeDef erase = { 0 };
+    uint32_t first = ota_sector(address);
+
+    if (size == 0 || address < FLASH_BASE || ota_sector_start(first) != address)
+    {
+        return SIM800_ERROR;
+    }
+
+    memset(ota, 0, sizeof(*ota));
+    ota->start = address;
+    ota->end = address + size;
+    ota->programmed = address;
+
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = first;
+    erase.NbSectors = ota_sector(ota->end - 1) - first + 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    ota->erasing = 1;
+    if (HAL_FLASHEx_Erase_IT(&erase) != HAL_OK)
+    {
+        ota->erasing = 0;
+        HAL_FLASH_Lock();
+        return SIM800_ERROR;
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Appends bytes to the image.
+ *
+ * The bytes are copied into the buffer being filled. A full buffer is programmed at once unless the
+ * area is still being erased, then the other buffer takes the following bytes; the function only
+ * waits for the erase once both buffers are full.
+ *
+ * @param   *ota: Pointer to the image structure, see SIM800_OTA_Begin.
+ * @param   *data: Bytes of the image.
+ * @param   length: Count of bytes.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure or if the image does not fit, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_OTA_Write(SIM800_OTA_t *ota, const uint8_t *data, uint16_t length)
+{
+    SIM800_Status_t status;
+    uint16_t count;
+
+    if (ota->error || length > ota->end - ota->start - ota->length)
+    {
+        ota->error = 1;
+        return SIM800_ERROR;
+    }
+
+    while (length != 0)
+    {
+        count = SIM800_OTA_BUFFER_LENGTH - ota->fill;
+        if (count > length)
+        {
+            count = length;
+        }
+
+        memcpy(&ota->buffer[ota->current][ota->fill], data, count);
+        ota->fill += count;
+        ota->length += count;
+        data += count;
+        length -= count;
+
+        if (ota->fill == SIM800_OTA_BUFFER_LENGTH)
+        {
+            // The other buffer must be programmed before it can be filled again
+            if ((status = ota_program(ota, 1)) != SIM800_OK)
+            {
+                return status;
+            }
+
+            ota->pending = ota->fill;
+            ota->pendingOffset = 0;
+            ota->current ^= 1;
+            ota->fill = 0;
+        }
+    }
+
+    return ota_program(ota, 0);
+}
+
+
+/**
+ * @brief   Programs the rest of the image and locks the flash.
+ *
+ * The last word is padded with 0xFF.
+ *
+ * @param   *ota: Pointer to the image structure, see SIM800_OTA_Begin.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_OTA_Finish(SIM800_OTA_t *ota)
+{
+    SIM800_Status_t status;
+
+    if ((status = ota_program(ota, 1)) == SIM800_OK && ota->fill != 0)
+    {
+        while (ota->fill % 4 != 0)
+        {
+            ota->buffer[ota->current][ota->fill++] = 0xFF;
+        }
+
+        ota->pending = ota->fill;
+        ota->pendingOffset = 0;
+        ota->current ^= 1;
+        ota->fill = 0;
+
+        status = ota_program(ota, 1);
+    }
+
+    HAL_FLASH_Lock();
+
+    return ota->error ? SIM800_ERROR : status;
+}
+
+
+/**
+ * @brief   Downloads an image over HTTP straight into the flash.
+ *
+ * The body is read in chunks of SIM800_HTTP_READ_CHUNK bytes, see SIM800_HttpGet, and every chunk is
+ * written from the receive ring to the program buffers. The image is finished (SIM800_OTA_Finish) in
+ * any case, it is complete only if the server answered 200 and the whole body has been received.
+ *
+ * @param   *ota: Pointer to the image structure, see SIM800_OTA_Begin.
+ * @param   *handle: Pointer to the SIM800 handle structure, see SIM800_BearerInit.
+ * @param   *url: URL of the image.
+ * @param   *status: Pointer to store the HTTP status code.
+ * @retval  SIM800_OK if the image is complete, SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+SIM800_Status_t SIM800_OTA_HttpDownload(SIM800_OTA_t *ota, SIM800_Handle_t *handle, const char *url,
+                                        uint16_t *status)
+{
+    SIM800_Status_t ret = SIM800_HttpGet(handle, url, status, &ota_body, ota);
+    SIM800_Status_t finished = SIM800_OTA_Finish(ota);
+
+    if (ret != SIM800_OK)
+    {
+        return ret;
+    }
+
+    if (*status != 200 || ota->length != handle->http.length)
+    {
+        return SIM800_ERROR;
+    }
+
+    return finished;
+}
+
+
+/**
+ * @brief   Handles the end of a flash operation.
+ *
+ * Call this function from HAL_FLASH_EndOfOperationCallback.
+ *
+ * @param   *ota: Pointer to the image structure.
+ * @param   value: Argument of the HAL callback, 0xFFFFFFFF once the last sector is erased.
+ */
+void SIM800_OTA_EndOfOperation(SIM800_OTA_t *ota, uint32_t value)
+{
+    if (value == 0xFFFFFFFF)
+    {
+        ota->erasing = 0;
+    }
+}
+
+
+/**
+ * @brief   Handles an error of a flash operation, the image is failed.
+ *
+ * Call this function from HAL_FLASH_OperationErrorCallback.
+ *
+ * @param   *ota: Pointer to the image structure.
+ * @param   value: Argument of the HAL callback.
+ */
+void SIM800_OTA_OperationError(SIM800_OTA_t *ota, uint32_t value)
+{
+    ota->error = 1;
+    ota->erasing = 0;
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Finds the sector of an address.
+ *
+ * @param   address: Flash address.
+ * @retval  Sector number.
+ */
+static uint32_t ota_sector(uint32_t address)
+{
+    uint32_t offset = address - FLASH_BASE;
+
+    if (offset < 4 * OTA_SMALL_SECTOR)
+    {
+        return offset / OTA_SMALL_SECTOR;
+    }
+
+    if (offset < 4 * OTA_SMALL_SECTOR + OTA_MEDIUM_SECTOR)
+    {
+        return 4;
+    }
+
+    return 4 + offset / OTA_LARGE_SECTOR;
+}
+
+
+/**
+ * @brief   Gives the start address of a sector.
+ *
+ * @param   sector: Sector number.
+ * @retval  Flash address.
+ */
+static uint32_t ota_sector_start(uint32_t sector)
+{
+    if (sector <= 4)
+    {
+        return FLASH_BASE + sector * OTA_SMALL_SECTOR;
+    }
+
+    return FLASH_BASE + (sector - 4) * OTA_LARGE_SECTOR;
+}
+
+
+/**
+ * @brief   Programs the rest of the full buffer.
+ *
+ * Nothing is programmed while the area is being erased: the function returns at once, or waits for the
+ * end of the erase.
+ *
+ * @param   *ota: Pointer to the image structure.
+ * @param   wait: 1 to wait for the end of the erase.
+ * @retval  SIM800_OK on success (or if the erase is not finished yet), SIM800_ERROR on failure, SIM800_TIMEOUT on timeout.
+ */
+static SIM800_Status_t ota_program(SIM800_OTA_t *ota, uint8_t wait)
+{
+    const uint8_t *buffer = ota->buffer[ota->current ^ 1];
+    uint32_t tickStart = HAL_GetTick();
+    uint32_t word;
+
+    while (ota->erasing && wait && !ota->error)
+    {
+        if (HAL_GetTick() - tickStart > SIM800_OTA_ERASE_TIMEOUT)
+        {
+            return SIM800_TIMEOUT;
+        }
+    }
+
+    while (!ota->erasing && !ota->error && ota->pendingOffset < ota->pending)
+    {
+        memcpy(&word, &buffer[ota->pendingOffset], sizeof(word));
+
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, ota->programmed, word) != HAL_OK)
+        {
+            ota->error = 1;
+            break;
+        }
+
+        ota->programmed += sizeof(word);
+        ota->pendingOffset += sizeof(word);
+    }
+
+    if (ota->pendingOffset == ota->pending)
+    {
+        ota->pending = 0;
+        ota->pendingOffset = 0;
+    }
+
+    return ota->error ? SIM800_ERROR : SIM800_OK;
+}
+
+
+/**
+ * @brief   Writes a piece of the body of the HTTP response to the image, see SIM800_HttpBodyCallback_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *data: Bytes of the body.
+ * @param   length: Count of bytes.
+ * @param   *ctx: Pointer to the image structure.
+ */
+static void ota_body(SIM800_Handle_t *handle, const uint8_t *data, uint16_t length, void *ctx)
+{
+    // A failure is kept in the image structure, the rest of the body is dropped
+    SIM800_OTA_Write((SIM800_OTA_t *)ctx, data, length);
+}
+
+#endif /* SIM800_USE_OTA */
@@ -0,0 +1,79 @@
+/*
+ * sim800_ota.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_OTA_H_
+#define INC_SIM800_OTA_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_OTA
+
+#ifndef SIM800_OTA_BUFFER_LENGTH
+#define SIM800_OTA_BUFFER_LENGTH				SIM800_HTTP_READ_CHUNK	/* Size of each of the two program buffers, a multiple of 4. */
+#endif
+
+#ifndef SIM800_OTA_ERASE_TIMEOUT
+#define SIM800_OTA_ERASE_TIMEOUT				30000	/* Time the erase of the image area may take (ms). */
+#endif
+
+#if (SIM800_OTA_BUFFER_LENGTH % 4) != 0
+#error "SIM800_OTA_BUFFER_LENGTH must be a multiple of 4"
+#endif
+
+
+/**
+ * @brief   Structure representing a firmware image being written to the flash of the MCU.
+ *
+ * The image is never held in RAM, it passes through two buffers: a full buffer is programmed while the
+ * modem keeps receiving into the ring, and while the flash is still busy erasing, the other buffer takes
+ * the following bytes. The area of the image is erased in the background (interrupt-driven erase) from
+ * SIM800_OTA_Begin on, so the erase overlaps with the HTTP request. The sector layout is the one of the
+ * single bank STM32F4 devices (4 x 16 KB, 64 KB, then 128 KB sectors).
+ */
+typedef struct
+{
+    uint32_t start;                             /*!< Address of the image. */
+    uint32_t end;                               /*!< Address behind the area of the image. */
+    uint32_t length;                            /*!< Count of bytes received. */
+    uint32_t programmed;                        /*!< Address behind the last programmed word. */
+    volatile uint8_t erasing;                   /*!< 1 while the area of the image is being erased. */
+    volatile uint8_t error;                     /*!< 1 once the flash has reported an error or the image did not fit. */
+    uint8_t buffer[2][SIM800_OTA_BUFFER_LENGTH];  /*!< Program buffers. */
+    uint8_t current;                            /*!< Index of the buffer being filled. */
+    uint16_t fill;                              /*!< Count of bytes in the buffer being filled. */
+    uint16_t pending;                           /*!< Count of bytes of the other buffer to program, 0 - none. */
+    uint16_t pendingOffset;                     /*!< Count of bytes of the other buffer programmed already. */
+} SIM800_OTA_t;
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_OTA_Begin					(SIM800_OTA_t *ota, uint32_t address, uint32_t size);
+SIM800_Status_t SIM800_OTA_Write					(SIM800_OTA_t *ota, const uint8_t *data, uint16_t length);
+SIM800_Status_t SIM800_OTA_Finish					(SIM800_OTA_t *ota);
+SIM800_Status_t SIM800_OTA_HttpDownload				(SIM800_OTA_t *ota, SIM800_Handle_t *handle, const char *url,
+													 uint16_t *status);
+void SIM800_OTA_EndOfOperation						(SIM800_OTA_t *ota, uint32_t value);
+void SIM800_OTA_OperationError						(SIM800_OTA_t *ota, uint32_t value);
+
+
+
+
+#endif /* SIM800_USE_OTA */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_OTA_H_ */
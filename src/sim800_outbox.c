@@ -0,0 +1,689 @@
+/*
+ * sim800_outbox.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_outbox.h"
+
+#if SIM800_USE_OUTBOX
+
+#define OUTBOX_SECTOR_MAGIC						0x314F4253UL	/* "SBO1", first word of a formatted sector. */
+#define OUTBOX_SECTOR_HEADER					16		/* Magic, generation, sequence and CRC. */
+#define OUTBOX_RECORD_MAGIC						0xB0C5U	/* Upper half of the first word of a record. */
+#define OUTBOX_RECORD_MAX_WORDS					0xFFFU	/* Largest body of a record (words). */
+#define OUTBOX_ERASED							0xFFFFFFFFUL
+
+#define OUTBOX_NUMBER_WORDS						((SIM800_CALLER_LENGTH + 3) / 4)
+#define OUTBOX_TEXT_WORDS						((SIM800_OUTBOX_TEXT_LENGTH + 1 + 3) / 4)
+
+
+/*
+ * Types of the log records
+ *
+ * A record is the header word (magic, type and count of body words), the sequence number, the body and
+ * the CRC-32 of all of them. The header is programmed first, so a record cut by a reset is skipped.
+ */
+typedef enum
+{
+    OUTBOX_Record_Message = 1,                  /* Body: the destination, then the text, both padded with '\0'. */
+    OUTBOX_Record_Sent,                         /* No body, the message of the sequence number is sent. */
+    OUTBOX_Record_Dropped,                      /* No body, the message of the sequence number is given up. */
+} outbox_record_t;
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint32_t outbox_word(uint32_t address);
+static uint32_t outbox_crc(uint32_t crc, uint32_t word);
+static uint8_t outbox_header(const SIM800_OutboxSector_t *sector, uint32_t *generation, uint32_t *sequence);
+static SIM800_Status_t outbox_program(uint32_t address, const uint32_t *words, uint32_t count);
+static SIM800_Status_t outbox_load(SIM800_Outbox_t *outbox);
+static void outbox_replay(SIM800_Outbox_t *outbox, uint32_t address, uint32_t end);
+static SIM800_Status_t outbox_compact(SIM800_Outbox_t *outbox);
+static SIM800_Status_t outbox_append(SIM800_Outbox_t *outbox, outbox_record_t type, uint32_t sequence,
+                                     const uint32_t *body, uint16_t words);
+static SIM800_OutboxEntry_t *outbox_find(SIM800_Outbox_t *outbox, uint32_t sequence);
+static void outbox_close(SIM800_Outbox_t *outbox, SIM800_OutboxEntry_t *entry, SIM800_Status_t status);
+static void outbox_drain(SIM800_Outbox_t *outbox);
+
+static void outbox_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void outbox_event(SIM800_Handle_t *handle, const SIM800_Event_t *event, void *ctx);
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Opens the outbox kept in the reserved flash sectors.
+ *
+ * The log is read back: the sector of the highest generation holds it, and the messages without a
+ * sent or dropped record wait again. Sectors holding no log (e.g. on the first start) are formatted.
+ * The outbox subscribes to the network registration events (see SIM800_Subscribe), and the messages
+ * leave as soon as the module is registered. The sectors are erased by the blocking HAL_FLASHEx_Erase,
+ * not during a firmware download (sim800_ota.c).
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @param   *handle: Pointer to the SIM800 handle structure of the modem.
+ * @param   *sectors: SIM800_OUTBOX_SECTORS sectors reserved for the outbox, used by nothing else.
+ * @param   callback: Callback receiving the end of the messages, may be NULL.
+ * @param   *ctx: Argument of the application, stored in outbox->ctx.
+ * @retval  SIM800_OK on success, SIM800_ERROR on a flash failure, an invalid sector or no free subscriber.
+ */
+SIM800_Status_t SIM800_Outbox_Init(SIM800_Outbox_t *outbox, SIM800_Handle_t *handle,
+                                   const SIM800_OutboxSector_t *sectors, SIM800_OutboxCallback_t callback,
+                                   void *ctx)
+{
+    for (uint8_t i = 0; i < SIM800_OUTBOX_SECTORS; i++)
+    {
+        if (sectors[i].address < FLASH_BASE || sectors[i].address % 4 != 0 || sectors[i].size % 4 != 0 ||
+            sectors[i].size < 4 * OUTBOX_SECTOR_HEADER)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    memset(outbox, 0, sizeof(*outbox));
+    memcpy(outbox->sectors, sectors, sizeof(outbox->sectors));
+    outbox->handle = handle;
+    outbox->callback = callback;
+    outbox->ctx = ctx;
+
+    if (outbox_load(outbox) != SIM800_OK || SIM800_Subscribe(handle, SIM800_EVT_CREG, &outbox_event, outbox) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    outbox_drain(outbox);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Stores a message in the outbox.
+ *
+ * The message is programmed into the flash before the function returns, it is sent at once if the module
+ * is registered, otherwise once "+CREG" reports the registration. A full sector is compacted into the
+ * next one first, which erases that sector.
+ *
+ * @param   *outbox: Pointer to the outbox structure, see SIM800_Outbox_Init.
+ * @param   *destination: Phone number of the recipient, shorter than SIM800_CALLER_LENGTH.
+ * @param   *text: Text of the message, at most SIM800_OUTBOX_TEXT_LENGTH characters.
+ * @param   *sequence: Pointer to store the sequence number of the message, may be NULL.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the outbox is full, a string is too long or the flash fails.
+ */
+SIM800_Status_t SIM800_Outbox_Put(SIM800_Outbox_t *outbox, const char *destination, const char *text,
+                                  uint32_t *sequence)
+{
+    uint32_t body[OUTBOX_NUMBER_WORDS + OUTBOX_TEXT_WORDS] = { 0 };
+    size_t destinationLength = strlen(destination), textLength = strlen(text);
+    uint32_t address;
+
+    if (outbox->count == SIM800_OUTBOX_MESSAGES || destinationLength == 0 ||
+        destinationLength >= SIM800_CALLER_LENGTH || textLength > SIM800_OUTBOX_TEXT_LENGTH)
+    {
+        return SIM800_ERROR;
+    }
+
+    memcpy(body, destination, destinationLength);
+    memcpy((uint8_t *)body + OUTBOX_NUMBER_WORDS * 4, text, textLength);
+
+    if (outbox_append(outbox, OUTBOX_Record_Message, outbox->nextSequence, body,
+                      OUTBOX_NUMBER_WORDS + (textLength + 1 + 3) / 4) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The record ends at the write address
+    address = outbox->write - 4 * (3 + OUTBOX_NUMBER_WORDS + (textLength + 1 + 3) / 4);
+
+    outbox->entries[outbox->count].sequence = outbox->nextSequence;
+    outbox->entries[outbox->count].address = address;
+    outbox->entries[outbox->count].inFlight = 0;
+    outbox->entries[outbox->count].attempts = 0;
+    outbox->count++;
+
+    if (sequence != NULL)
+    {
+        *sequence = outbox->nextSequence;
+    }
+    outbox->nextSequence++;
+
+    outbox_drain(outbox);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Gives the count of messages waiting in the outbox, the ones in flight included.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @retval  Count of messages.
+ */
+uint8_t SIM800_Outbox_Pending(const SIM800_Outbox_t *outbox)
+{
+    return outbox->count;
+}
+
+
+/**
+ * @brief   Resumes the sends once SIM800_OUTBOX_RETRY has passed after a failure, call it from the main loop.
+ *
+ * It also submits the messages a full request queue has refused.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ */
+void SIM800_Outbox_Poll(SIM800_Outbox_t *outbox)
+{
+    if (outbox->retry && HAL_GetTick() - outbox->retryTick >= SIM800_OUTBOX_RETRY)
+    {
+        outbox->retry = 0;
+    }
+
+    outbox_drain(outbox);
+}
+
+
+
+
+/*********************************************************************************************
+ *								Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Reads a word of the flash.
+ *
+ * @param   address: Flash address, a multiple of 4.
+ * @retval  Word.
+ */
+static uint32_t outbox_word(uint32_t address)
+{
+    return *(const volatile uint32_t *)(uintptr_t)address;
+}
+
+
+/**
+ * @brief   Adds a word, least significant byte first, to a CRC-32 (reflected, polynomial 0x04C11DB7).
+ *
+ * @param   crc: CRC so far, 0xFFFFFFFF at the start.
+ * @param   word: Word.
+ * @retval  Updated CRC, inverted by the caller at the end.
+ */
+static uint32_t outbox_crc(uint32_t crc, uint32_t word)
+{
+    crc ^= word;
+
+    for (uint8_t bit = 0; bit < 32; bit++)
+    {
+        crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1)));
+    }
+
+    return crc;
+}
+
+
+/**
+ * @brief   Checks the header of a sector.
+ *
+ * @param   *sector: Pointer to the sector.
+ * @param   *generation: Pointer to store the generation of the sector.
+ * @param   *sequence: Pointer to store the first sequence number of its log.
+ * @retval  1 if the sector holds a log, 0 otherwise.
+ */
+static uint8_t outbox_header(const SIM800_OutboxSector_t *sector, uint32_t *generation, uint32_t *sequence)
+{
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        crc = outbox_crc(crc, outbox_word(sector->address + 4 * i));
+    }
+
+    if (outbox_word(sector->address) != OUTBOX_SECTOR_MAGIC || ~crc != outbox_word(sector->address + 12))
+    {
+        return 0;
+    }
+
+    *generation = outbox_word(sector->address + 4);
+    *sequence = outbox_word(sector->address + 8);
+
+    return 1;
+}
+
+
+/**
+ * @brief   Programs words into the flash.
+ *
+ * @param   address: Flash address, a multiple of 4, erased.
+ * @param   *words: Words, they may be in the flash themselves.
+ * @param   count: Count of words.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+static SIM800_Status_t outbox_program(uint32_t address, const uint32_t *words, uint32_t count)
+{
+    SIM800_Status_t status = SIM800_OK;
+
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, address + 4 * i, words[i]) != HAL_OK)
+        {
+            status = SIM800_ERROR;
+            break;
+        }
+    }
+
+    HAL_FLASH_Lock();
+
+    return status;
+}
+
+
+/**
+ * @brief   Finds the active sector and reads its log back.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR if no sector could be formatted.
+ */
+static SIM800_Status_t outbox_load(SIM800_Outbox_t *outbox)
+{
+    uint32_t generation, sequence;
+    uint8_t found = 0;
+
+    for (uint8_t i = 0; i < SIM800_OUTBOX_SECTORS; i++)
+    {
+        if (outbox_header(&outbox->sectors[i], &generation, &sequence) && (!found || generation > outbox->generation))
+        {
+            found = 1;
+            outbox->active = i;
+            outbox->generation = generation;
+            outbox->nextSequence = sequence;
+        }
+    }
+
+    if (!found)
+    {
+        // Format the first sector: an empty log compacted into it
+        outbox->active = SIM800_OUTBOX_SECTORS - 1;
+        outbox->generation = 0;
+        outbox->nextSequence = 1;
+        return outbox_compact(outbox);
+    }
+
+    outbox_replay(outbox, outbox->sectors[outbox->active].address + OUTBOX_SECTOR_HEADER,
+                  outbox->sectors[outbox->active].address + outbox->sectors[outbox->active].size);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Applies the records of the active sector to the list of waiting messages.
+ *
+ * A record failing its CRC (cut by a reset) is skipped. A damaged header ends the log: nothing is
+ * appended behind it any more, the next record compacts the sector.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @param   address: Address of the first record.
+ * @param   end: Address behind the sector.
+ */
+static void outbox_replay(SIM800_Outbox_t *outbox, uint32_t address, uint32_t end)
+{
+    SIM800_OutboxEntry_t *entry;
+    uint32_t header, words, next, crc, sequence;
+
+    while (address + 12 <= end && (header = outbox_word(address)) != OUTBOX_ERASED)
+    {
+        words = header & OUTBOX_RECORD_MAX_WORDS;
+        next = address + 4 * (3 + words);
+
+        if ((header >> 16) != OUTBOX_RECORD_MAGIC || next > end)
+        {
+            address = end;
+            break;
+        }
+
+        crc = 0xFFFFFFFFUL;
+        for (uint32_t i = address; i < next - 4; i += 4)
+        {
+            crc = outbox_crc(crc, outbox_word(i));
+        }
+
+        sequence = outbox_word(address + 4);
+
+        if (~crc == outbox_word(next - 4))
+        {
+            if (sequence >= outbox->nextSequence)
+            {
+                outbox->nextSequence = sequence + 1;
+            }
+
+            if (((header >> 12) & 0xF) == OUTBOX_Record_Message)
+            {
+                if (words > OUTBOX_NUMBER_WORDS && outbox->count < SIM800_OUTBOX_MESSAGES)
+                {
+                    outbox->entries[outbox->count].sequence = sequence;
+                    outbox->entries[outbox->count].address = address;
+                    outbox->count++;
+                }
+            }
+            else if ((entry = outbox_find(outbox, sequence)) != NULL)
+            {
+                memmove(entry, entry + 1, (uint8_t *)&outbox->entries[outbox->count] - (uint8_t *)(entry + 1));
+                outbox->count--;
+            }
+        }
+
+        address = next;
+    }
+
+    outbox->write = address;
+}
+
+
+/**
+ * @brief   Copies the waiting messages into the next sector, which becomes the active one.
+ *
+ * The records are copied before the header of the sector is programmed, so a reset in between leaves
+ * the old sector active. The old sector is kept as it is for the messages still in flight, the sector
+ * taken is refused while one of them points into it.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+static SIM800_Status_t outbox_compact(SIM800_Outbox_t *outbox)
+{
+    uint8_t target = (outbox->active + 1) % SIM800_OUTBOX_SECTORS;
+    SIM800_OutboxSector_t *sector = &outbox->sectors[target];
+    FLASH_EraseInitTypeDef erase = { 0 };
+    uint32_t header[4] = { OUTBOX_SECTOR_MAGIC, outbox->generation + 1, outbox->nextSequence, 0xFFFFFFFFUL };
+    uint32_t write = sector->address + OUTBOX_SECTOR_HEADER, size, sectorError;
+    HAL_StatusTypeDef result;
+
+    for (uint8_t i = 0; i < SIM800_OUTBOX_PIPELINE; i++)
+    {
+        if (outbox->flight[i].busy && outbox->flight[i].address - sector->address < sector->size)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+    erase.Sector = sector->sector;
+    erase.NbSectors = 1;
+    erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+
+    if (HAL_FLASH_Unlock() != HAL_OK)
+    {
+        return SIM800_ERROR;
+    }
+    result = HAL_FLASHEx_Erase(&erase, &sectorError);
+    HAL_FLASH_Lock();
+
+    if (result != HAL_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    for (uint8_t i = 0; i < outbox->count; i++)
+    {
+        size = 4 * (3 + (outbox_word(outbox->entries[i].address) & OUTBOX_RECORD_MAX_WORDS));
+
+        if (write + size > sector->address + sector->size ||
+            outbox_program(write, (const uint32_t *)(uintptr_t)outbox->entries[i].address, size / 4) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+        write += size;
+    }
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        header[3] = outbox_crc(header[3], header[i]);
+    }
+    header[3] = ~header[3];
+
+    if (outbox_program(sector->address, header, 4) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    // The copies are laid out in the order of the entries
+    write = sector->address + OUTBOX_SECTOR_HEADER;
+    for (uint8_t i = 0; i < outbox->count; i++)
+    {
+        size = 4 * (3 + (outbox_word(outbox->entries[i].address) & OUTBOX_RECORD_MAX_WORDS));
+        outbox->entries[i].address = write;
+        write += size;
+    }
+
+    outbox->active = target;
+    outbox->generation++;
+    outbox->write = write;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Appends a record to the log, the sector is compacted first if the record does not fit.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @param   type: Type of the record.
+ * @param   sequence: Sequence number of the message.
+ * @param   *body: Body of the record, NULL if there is none.
+ * @param   words: Count of words of the body.
+ * @retval  SIM800_OK on success, SIM800_ERROR on failure.
+ */
+static SIM800_Status_t outbox_append(SIM800_Outbox_t *outbox, outbox_record_t type, uint32_t sequence,
+                                     const uint32_t *body, uint16_t words)
+{
+    const SIM800_OutboxSector_t *sector = &outbox->sectors[outbox->active];
+    uint32_t head[2] = { (uint32_t)OUTBOX_RECORD_MAGIC << 16 | (uint32_t)type << 12 | words, sequence };
+    uint32_t crc = 0xFFFFFFFFUL, size = 4 * (3 + words);
+
+    if (outbox->write + size > sector->address + sector->size)
+    {
+        if (outbox_compact(outbox) != SIM800_OK)
+        {
+            return SIM800_ERROR;
+        }
+
+        sector = &outbox->sectors[outbox->active];
+        if (outbox->write + size > sector->address + sector->size)
+        {
+            return SIM800_ERROR;
+        }
+    }
+
+    crc = outbox_crc(outbox_crc(crc, head[0]), head[1]);
+    for (uint16_t i = 0; i < words; i++)
+    {
+        crc = outbox_crc(crc, body[i]);
+    }
+    crc = ~crc;
+
+    if (outbox_program(outbox->write, head, 2) != SIM800_OK ||
+        outbox_program(outbox->write + 8, body, words) != SIM800_OK ||
+        outbox_program(outbox->write + size - 4, &crc, 1) != SIM800_OK)
+    {
+        // The words are partly programmed, nothing is appended behind them
+        outbox->write = sector->address + sector->size;
+        return SIM800_ERROR;
+    }
+
+    outbox->write += size;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Finds a waiting message.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @param   sequence: Sequence number of the message.
+ * @retval  Pointer to the entry of the message, NULL if it is not waiting.
+ */
+static SIM800_OutboxEntry_t *outbox_find(SIM800_Outbox_t *outbox, uint32_t sequence)
+{
+    for (uint8_t i = 0; i < outbox->count; i++)
+    {
+        if (outbox->entries[i].sequence == sequence)
+        {
+            return &outbox->entries[i];
+        }
+    }
+
+    return NULL;
+}
+
+
+/**
+ * @brief   Records the end of a message and removes it from the waiting ones.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @param   *entry: Pointer to the entry of the message.
+ * @param   status: SIM800_OK if the message is sent, SIM800_ERROR if it is dropped.
+ */
+static void outbox_close(SIM800_Outbox_t *outbox, SIM800_OutboxEntry_t *entry, SIM800_Status_t status)
+{
+    uint32_t sequence = entry->sequence;
+
+    memmove(entry, entry + 1, (uint8_t *)&outbox->entries[outbox->count] - (uint8_t *)(entry + 1));
+    outbox->count--;
+
+    // Without the record the message is sent again after a reset
+    outbox_append(outbox, (status == SIM800_OK) ? OUTBOX_Record_Sent : OUTBOX_Record_Dropped, sequence, NULL, 0);
+
+    if (outbox->callback != NULL)
+    {
+        outbox->callback(outbox, sequence, status);
+    }
+}
+
+
+/**
+ * @brief   Submits the waiting messages while the module is registered, SIM800_OUTBOX_PIPELINE at once.
+ *
+ * The destination and the text are sent straight from the flash. Every request gets a slot of its own as
+ * its context, so a request ended early (e.g. by SIM800_Cancel) does not end another message.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ */
+static void outbox_drain(SIM800_Outbox_t *outbox)
+{
+    SIM800_NetworkRegStatus_t status = outbox->handle->regStatus;
+    SIM800_OutboxFlight_t *slot = NULL;
+    SIM800_OutboxEntry_t *entry;
+    const char *record;
+
+    if ((status != SIM800_Registered_HomeNetwork && status != SIM800_Registered_Roaming) || outbox->retry)
+    {
+        return;
+    }
+
+    for (uint8_t i = 0; i < outbox->count && outbox->flightCount < SIM800_OUTBOX_PIPELINE; i++)
+    {
+        entry = &outbox->entries[i];
+        if (entry->inFlight)
+        {
+            continue;
+        }
+
+        for (uint8_t j = 0; j < SIM800_OUTBOX_PIPELINE; j++)
+        {
+            if (!outbox->flight[j].busy)
+            {
+                slot = &outbox->flight[j];
+                break;
+            }
+        }
+
+        slot->outbox = outbox;
+        slot->sequence = entry->sequence;
+        slot->address = entry->address;
+
+        record = (const char *)(uintptr_t)(entry->address + 8);
+        if (SIM800_SubmitSMSMessageEx(outbox->handle, record, record + 4 * OUTBOX_NUMBER_WORDS, &outbox_sent, slot,
+                                      NULL) != SIM800_OK)
+        {
+            // The request queue is full, try again on the next poll
+            return;
+        }
+
+        entry->inFlight = 1;
+        slot->busy = 1;
+        outbox->flightCount++;
+    }
+}
+
+
+/**
+ * @brief   Handles the end of a send, in whatever order the requests end.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the slot of the message.
+ */
+static void outbox_sent(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_OutboxFlight_t *slot = ctx;
+    SIM800_Outbox_t *outbox = slot->outbox;
+    SIM800_OutboxEntry_t *entry;
+
+    // A request of the outbox before SIM800_Outbox_Init opened it again
+    if (!slot->busy)
+    {
+        return;
+    }
+    slot->busy = 0;
+    outbox->flightCount--;
+
+    if ((entry = outbox_find(outbox, slot->sequence)) == NULL)
+    {
+        return;
+    }
+    entry->inFlight = 0;
+
+    if (status == SIM800_OK)
+    {
+        outbox_close(outbox, entry, SIM800_OK);
+    }
+    else if (++entry->attempts >= SIM800_OUTBOX_ATTEMPTS)
+    {
+        outbox_close(outbox, entry, SIM800_ERROR);
+    }
+    else
+    {
+        outbox->retry = 1;
+        outbox->retryTick = HAL_GetTick();
+    }
+
+    outbox_drain(outbox);
+}
+
+
+/**
+ * @brief   Starts the sends once the module reports its registration, see SIM800_EventCallback_t.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure.
+ * @param   *event: Network registration event.
+ * @param   *ctx: Pointer to the outbox structure.
+ */
+static void outbox_event(SIM800_Handle_t *handle, const SIM800_Event_t *event, void *ctx)
+{
+    outbox_drain(ctx);
+}
+
+#endif /* SIM800_USE_OUTBOX */
@@ -0,0 +1,154 @@
+/*
+ * sim800_outbox.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_OUTBOX_H_
+#define INC_SIM800_OUTBOX_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_OUTBOX
+
+#ifndef SIM800_OUTBOX_SECTORS
+#define SIM800_OUTBOX_SECTORS					2		/* Count of flash sectors the log rotates through. */
+#endif
+
+#ifndef SIM800_OUTBOX_MESSAGES
+#define SIM800_OUTBOX_MESSAGES					16		/* Most messages waiting to be sent. */
+#endif
+
+#ifndef SIM800_OUTBOX_TEXT_LENGTH
+#define SIM800_OUTBOX_TEXT_LENGTH				(SMS_TX_MAX_LEN - 3)	/* Longest text of a message, the terminating '\0' excluded. */
+#endif
+
+#ifndef SIM800_OUTBOX_PIPELINE
+#define SIM800_OUTBOX_PIPELINE					2		/* Messages submitted to the request queue at once. */
+#endif
+
+#ifndef SIM800_OUTBOX_ATTEMPTS
+#define SIM800_OUTBOX_ATTEMPTS					5		/* Failed sends after which a message is dropped. */
+#endif
+
+#ifndef SIM800_OUTBOX_RETRY
+#define SIM800_OUTBOX_RETRY						30000	/* Wait after a failed send before the next one (ms). */
+#endif
+
+#if SIM800_OUTBOX_SECTORS < 2
+#error "SIM800_OUTBOX_SECTORS must be at least 2"
+#endif
+
+#if SIM800_OUTBOX_PIPELINE < 1 || SIM800_OUTBOX_PIPELINE > SIM800_OUTBOX_MESSAGES
+#error "SIM800_OUTBOX_PIPELINE must be between 1 and SIM800_OUTBOX_MESSAGES"
+#endif
+
+
+typedef struct SIM800_Outbox SIM800_Outbox_t;
+
+
+/**
+ * @brief   Structure representing a flash sector reserved for the outbox.
+ */
+typedef struct
+{
+    uint32_t address;                           /*!< Start of the sector (e.g. 0x08008000). */
+    uint32_t size;                              /*!< Size of the sector. */
+    uint32_t sector;                            /*!< Sector number given to HAL_FLASHEx_Erase. */
+} SIM800_OutboxSector_t;
+
+
+/**
+ * @brief   Callback receiving the end of a message, invoked from SIM800_Poll and SIM800_Outbox_Poll.
+ *
+ * @param   *outbox: Pointer to the outbox structure.
+ * @param   sequence: Sequence number given by SIM800_Outbox_Put.
+ * @param   status: SIM800_OK if the message is sent, SIM800_ERROR if it is dropped after SIM800_OUTBOX_ATTEMPTS.
+ */
+typedef void (*SIM800_OutboxCallback_t)(SIM800_Outbox_t *outbox, uint32_t sequence, SIM800_Status_t status);
+
+
+/**
+ * @brief   Structure representing a message waiting in the outbox.
+ */
+typedef struct
+{
+    uint32_t sequence;                          /*!< Sequence number of the message. */
+    uint32_t address;                           /*!< Address of its record in the flash. */
+    uint8_t inFlight;                           /*!< 1 while the message is in the request queue. */
+    uint8_t attempts;                           /*!< Count of failed sends since the start. */
+} SIM800_OutboxEntry_t;
+
+
+/**
+ * @brief   Structure representing a message in the request queue, the context of its request.
+ */
+typedef struct
+{
+    SIM800_Outbox_t *outbox;                    /*!< Outbox of the message. */
+    uint32_t sequence;                          /*!< Sequence number of the message. */
+    uint32_t address;                           /*!< Address of its record in the flash. */
+    uint8_t busy;                               /*!< 1 while the slot holds a message. */
+} SIM800_OutboxFlight_t;
+
+
+/**
+ * @brief   Structure representing an SMS outbox kept in the flash of the MCU.
+ *
+ * The messages are appended to a log in the reserved sectors and survive a reset of the MCU: each
+ * record carries a sequence number, and a sent (or dropped) message gets a record of its own naming
+ * that number, so a message is never sent again after a restart once its end has been recorded. The
+ * log is only ever appended to; once a sector is full, the messages still waiting are copied into the
+ * next sector, which is erased first, so the erases rotate through all the sectors. The records are
+ * read in place, the RAM only holds their addresses.
+ *
+ * The messages are sent while the network registration reported by "+CREG" is the home network or
+ * roaming; enable the notifications with SIM800_ManageRegNotifications.
+ */
+struct SIM800_Outbox
+{
+    SIM800_Handle_t *handle;                    /*!< Handle of the modem. */
+    SIM800_OutboxSector_t sectors[SIM800_OUTBOX_SECTORS];  /*!< Reserved sectors. */
+    uint8_t active;                             /*!< Index of the sector holding the log. */
+    uint32_t generation;                        /*!< Generation of the active sector, the highest one is active. */
+    uint32_t write;                             /*!< Address behind the last record. */
+    uint32_t nextSequence;                      /*!< Sequence number of the next message. */
+    SIM800_OutboxEntry_t entries[SIM800_OUTBOX_MESSAGES];  /*!< Waiting messages, in sequence order. */
+    uint8_t count;                              /*!< Count of waiting messages. */
+    SIM800_OutboxFlight_t flight[SIM800_OUTBOX_PIPELINE];  /*!< Messages in flight, in any order. */
+    uint8_t flightCount;                        /*!< Count of messages in flight. */
+    uint32_t retryTick;                         /*!< Tick of the last failed send. */
+    uint8_t retry;                              /*!< 1 while the sends wait for SIM800_OUTBOX_RETRY. */
+    SIM800_OutboxCallback_t callback;           /*!< Callback receiving the end of the messages, may be NULL. */
+    void *ctx;                                  /*!< Argument of the application. */
+};
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_Outbox_Init					(SIM800_Outbox_t *outbox, SIM800_Handle_t *handle,
+													 const SIM800_OutboxSector_t *sectors, SIM800_OutboxCallback_t callback,
+													 void *ctx);
+SIM800_Status_t SIM800_Outbox_Put					(SIM800_Outbox_t *outbox, const char *destination, const char *text,
+													 uint32_t *sequence);
+uint8_t SIM800_Outbox_Pending						(const SIM800_Outbox_t *outbox);
+void SIM800_Outbox_Poll								(SIM800_Outbox_t *outbox);
+
+
+
+
+#endif /* SIM800_USE_OUTBOX */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_OUTBOX_H_ */
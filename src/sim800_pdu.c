@@ -0,0 +1,803 @@
+/*
+ * sim800_pdu.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_pdu.h"
+
+#if SIM800_USE_SMS
+
+#if SIM800_USE_PDU
+
+#define GSM_ESCAPE				0x1B		/* Septet announcing a character of the extension table. */
+#define GSM_UNKNOWN				0x3F		/* '?', sent for the characters GSM 7-bit has not. */
+#define GSM_EXTENDED			0x80		/* Mark of a character of the extension table in gsm_from_ascii. */
+
+
+/*
+ * Alphabets of the user data, selected by the data coding scheme
+ */
+typedef enum
+{
+    alphabet_gsm7,
+    alphabet_8bit,
+    alphabet_ucs2,
+} alphabet_t;
+
+
+/*
+ * ASCII to GSM 7-bit alphabet, the characters of the extension table are marked by GSM_EXTENDED
+ */
+static const uint8_t gsm_from_ascii[128] =
+{
+    0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x0A, 0x3F, 0x8A, 0x0D, 0x3F, 0x3F,
+    0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F,
+    0x20, 0x21, 0x22, 0x23, 0x02, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    0x00, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0xBC, 0xAF, 0xBE, 0x94, 0x11,
+    0x3F, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0xA8, 0xC0, 0xA9, 0xBD, 0x3F,
+};
+
+
+/*
+ * GSM 7-bit default alphabet to ASCII, the characters ASCII has not become '?'
+ */
+static const char ascii_from_gsm[128] =
+{
+    0x40, 0x3F, 0x24, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x0A, 0x3F, 0x3F, 0x0D, 0x3F, 0x3F,
+    0x3F, 0x5F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F,
+    0x20, 0x21, 0x22, 0x23, 0x3F, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    0x3F, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F,
+    0x3F, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F,
+    0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x3F, 0x3F, 0x3F, 0x3F, 0x3F,
+};
+
+
+/*
+ * GSM 7-bit extension table to ASCII, 0 - not defined (shown as the character of the default alphabet)
+ */
+static const char ascii_from_extension[128] =
+{
+    [0x0A] = '\f', [0x14] = '^', [0x28] = '{', [0x29] = '}', [0x2F] = '\\',
+    [0x3C] = '[', [0x3D] = '~', [0x3E] = ']', [0x40] = '|',
+};
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint16_t septets_from_text(const char *text, uint16_t length, uint8_t *septets, uint16_t limit);
+static void pack_septets(uint8_t *out, uint32_t bit, const uint8_t *septets, uint16_t count);
+static void unpack_septets(const uint8_t *in, uint32_t octets, uint32_t first, uint16_t count, uint8_t *septets);
+static SIM800_Status_t skip_address(const uint8_t *pdu, uint16_t length, uint32_t *p);
+static void decode_timestamp(const uint8_t *scts, SIM800_Time_t *time);
+
+#endif /* SIM800_USE_PDU */
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+#if SIM800_USE_PDU
+
+/**
+ * @brief   Counts the septets a text takes in the GSM 7-bit alphabet.
+ *
+ * The characters of the extension table (e.g., '{' or '~') take two septets.
+ *
+ * @param   *text: Text to count.
+ * @param   length: Length of the text.
+ * @retval  Count of septets.
+ */
+uint16_t SIM800_PDU_Septets(const char *text, uint16_t length)
+{
+    uint16_t count = length;
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        count += gsm_from_ascii[(uint8_t)text[i] & 0x7F] >> 7;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Finds how many characters of a text fit into a count of septets.
+ *
+ * An escaped character is never split between two parts.
+ *
+ * @param   *text: Text to split.
+ * @param   length: Length of the text.
+ * @param   septets: Count of available septets.
+ * @retval  Count of characters that fit.
+ */
+uint16_t SIM800_PDU_Split(const char *text, uint16_t length, uint16_t septets)
+{
+    uint16_t used = 0, n;
+    uint16_t i;
+
+    for (i = 0; i < length; i++)
+    {
+        n = 1 + (gsm_from_ascii[(uint8_t)text[i] & 0x7F] >> 7);
+        if (used + n > septets)
+        {
+            break;
+        }
+        used += n;
+    }
+
+    return i;
+}
+
+
+/**
+ * @brief   Encodes an SMS-SUBMIT PDU with a GSM 7-bit text.
+ *
+ * The PDU starts with an empty service centre address, so the module uses its stored one; the length
+ * given to "AT+CMGS=" is the returned length minus one. The validity period is relative (one day).
+ * A part of a long message gets the concatenation header (8-bit reference), its text is placed after
+ * one fill bit so it starts on a septet boundary.
+ *
+ * @param   *pdu: Buffer of at least SIM800_PDU_MAX_OCTETS bytes.
+ * @param   *destination: Destination phone number, digits with an optional leading '+'.
+ * @param   *text: Text of the message or of the part, it is not terminated.
+ * @param   length: Length of the text.
+ * @param   *concat: Concatenation header, NULL for a single message.
+ * @param   report: 1 to request a status report.
+ * @retval  Length of the PDU, 0 if the number is invalid or the text does not fit.
+ */
+uint16_t SIM800_PDU_EncodeSubmit(uint8_t *pdu, const char *destination, const char *text, uint16_t length,
+                                 const SIM800_PDUConcat_t *concat, uint8_t report)
+{
+    uint8_t septets[SIM800_PDU_SINGLE_SEPTETS];
+    uint8_t type = 0x81, digits;
+    uint16_t count, limit = SIM800_PDU_SINGLE_SEPTETS;
+    uint32_t bit = 0;
+    uint8_t *ud;
+    uint16_t p = 0;
+
+    if (*destination == '+')
+    {
+        type = 0x91;
+        destination++;
+    }
+
+    digits = strlen(destination);
+    if (digits == 0 || digits > 20)
+    {
+        return 0;
+    }
+
+    pdu[p++] = 0x00;
+    // SMS-SUBMIT, relative validity period, user data header and status report request if needed
+    pdu[p++] = 0x11 | (report ? 0x20 : 0) | (concat != NULL ? 0x40 : 0);
+    pdu[p++] = 0x00;
+    pdu[p++] = digits;
+    pdu[p++] = type;
+
+    // The digits are swapped in pairs, an odd count is padded by 0xF
+    for (uint8_t i = 0; i < digits; i += 2)
+    {
+        if (destination[i] < '0' || destination[i] > '9' ||
+            (i + 1 < digits && (destination[i + 1] < '0' || destination[i + 1] > '9')))
+        {
+            return 0;
+        }
+        pdu[p++] = (destination[i] - '0') | ((i + 1 < digits ? destination[i + 1] - '0' : 0x0F) << 4);
+    }
+
+    pdu[p++] = 0x00;
+    pdu[p++] = 0x00;
+    pdu[p++] = 0xA7;
+
+    ud = &pdu[p + 1];
+
+    if (concat != NULL)
+    {
+        ud[0] = 5;
+        ud[1] = 0x00;
+        ud[2] = 3;
+        ud[3] = concat->reference & 0xFF;
+        ud[4] = concat->count;
+        ud[5] = concat->index;
+        ud[6] = 0x00;
+
+        // 6 octets of header and one fill bit take 7 septets
+        bit = 49;
+        limit = SIM800_PDU_PART_SEPTETS;
+    }
+
+    if ((count = septets_from_text(text, length, septets, limit)) == 0xFFFF)
+    {
+        return 0;
+    }
+
+    pack_septets(ud, bit, septets, count);
+    bit += 7u * count;
+
+    pdu[p] = (bit + 6) / 7;
+
+    return p + 1 + (bit + 7) / 8;
+}
+
+
+/**
+ * @brief   Writes a text over septets already packed into a PDU, the bits around them are kept.
+ *
+ * Every character takes one septet, so the length of the region does not change: a character of the
+ * extension table or without a GSM 7-bit equivalent is written as '?', the region is padded with spaces.
+ *
+ * @param   *pdu: Packed PDU, e.g. one encoded by SIM800_PDU_EncodeSubmit.
+ * @param   bit: Bit offset of the first septet of the region in the PDU.
+ * @param   *text: Text to write, '\0' terminated.
+ * @param   count: Count of septets of the region.
+ */
+void SIM800_PDU_PatchSeptets(uint8_t *pdu, uint32_t bit, const char *text, uint16_t count)
+{
+    uint16_t shifted, mask;
+    uint8_t code;
+
+    for (uint16_t i = 0; i < count; i++, bit += 7)
+    {
+        // The end of the text pads the rest
+        code = ' ';
+
+        if (*text != '\0')
+        {
+            code = gsm_from_ascii[(uint8_t)*text & 0x7F];
+            if (((uint8_t)*text++ & 0x80) || (code & GSM_EXTENDED))
+            {
+                code = GSM_UNKNOWN;
+            }
+        }
+
+        shifted = (uint16_t)code << (bit % 8);
+        mask = (uint16_t)0x7F << (bit % 8);
+
+        pdu[bit / 8] = (pdu[bit / 8] & ~mask) | (uint8_t)shifted;
+        if (bit % 8 > 1)
+        {
+            pdu[bit / 8 + 1] = (pdu[bit / 8 + 1] & ~(mask >> 8)) | (uint8_t)(shifted >> 8);
+        }
+    }
+}
+
+
+/**
+ * @brief   Decodes an SMS-DELIVER PDU into a message.
+ *
+ * The sender, the time stamp, the text and the concatenation header (8-bit or 16-bit reference) are
+ * extracted; the other fields are skipped. GSM 7-bit texts are converted to ASCII, characters without an ASCII
+ * equivalent become '?'; UCS2 texts are converted to UTF-8. A text longer than the message structure
+ * is truncated.
+ *
+ * @param   *pdu: PDU as received, starting with the service centre address.
+ * @param   length: Length of the PDU.
+ * @param   *message: Pointer to the message structure, its storage index is kept.
+ * @retval  SIM800_OK if the PDU is decoded, SIM800_ERROR if it is not a valid SMS-DELIVER.
+ */
+SIM800_Status_t SIM800_PDU_DecodeDeliver(const uint8_t *pdu, uint16_t length, SIM800_SMSMessage_t *message)
+{
+    uint8_t septets[SIM800_PDU_SINGLE_SEPTETS];
+    const uint8_t *ud;
+    uint8_t fo, digits, type, dcs, udl, nibble;
+    uint16_t header = 0, len = 0, count;
+    uint32_t octets, p = 0, q, first;
+    alphabet_t alphabet = alphabet_gsm7;
+    uint8_t escaped = 0;
+
+    memset(message->sender, 0, sizeof(message->sender));
+    memset(message->text, 0, sizeof(message->text));
+    message->partRef = 0;
+    message->partCount = 0;
+    message->partIndex = 0;
+    message->encoding = SIM800_SMSEncoding_GSM;
+    memset(&message->timestamp, 0, sizeof(message->timestamp));
+
+    if (length < 1 || (p = 1 + pdu[0]) + 2 > length)
+        return SIM800_ERROR;
+
+    fo = pdu[p++];
+    if ((fo & 0x03) != 0x00)
+        return SIM800_ERROR;
+
+    digits = pdu[p++];
+    type = pdu[p++];
+    octets = (digits + 1) / 2;
+    if (p + octets + 10 > length)
+        return SIM800_ERROR;
+
+    if ((type & 0x70) == 0x50)
+    {
+        // Alphanumeric sender, GSM 7-bit packed
+        count = digits * 4u / 7;
+        if (count > SMS_SENDER_MAX_LEN - 1)
+            count = SMS_SENDER_MAX_LEN - 1;
+
+        unpack_septets(&pdu[p], octets, 0, count, septets);
+        for (uint16_t s = 0; s < count; s++)
+        {
+            message->sender[len++] = ascii_from_gsm[septets[s]];
+        }
+    }
+    else
+    {
+        if (type == 0x91)
+            message->sender[len++] = '+';
+
+        for (uint8_t i = 0; i < digits && len < SMS_SENDER_MAX_LEN - 1; i++)
+        {
+            nibble = (i & 1) ? pdu[p + i / 2] >> 4 : pdu[p + i / 2] & 0x0F;
+            if (nibble < 10)
+                message->sender[len++] = '0' + nibble;
+        }
+    }
+    p += octets;
+
+    // Protocol identifier, data coding scheme, service centre time stamp
+    dcs = pdu[p + 1];
+    decode_timestamp(&pdu[p + 2], &message->timestamp);
+    p += 9;
+    udl = pdu[p++];
+    ud = &pdu[p];
+    octets = length - p;
+
+    if ((dcs & 0xC0) == 0x00)
+        alphabet = (alphabet_t)((dcs >> 2) & 0x03);
+    else if ((dcs & 0xF0) == 0xF0)
+        alphabet = (dcs & 0x04) ? alphabet_8bit : alphabet_gsm7;
+    else if ((dcs & 0xF0) == 0xE0)
+        alphabet = alphabet_ucs2;
+
+    if (alphabet > alphabet_ucs2)
+        return SIM800_ERROR;
+
+    message->encoding = (alphabet == alphabet_ucs2) ? SIM800_SMSEncoding_UCS2 :
+                        (alphabet == alphabet_8bit) ? SIM800_SMSEncoding_8Bit : SIM800_SMSEncoding_GSM;
+
+    if (fo & 0x40)
+    {
+        if (octets == 0 || (header = ud[0] + 1) > octets)
+            return SIM800_ERROR;
+
+        for (q = 1; q + 1 < header; q += 2 + ud[q + 1])
+        {
+            if (ud[q] == 0x00 && ud[q + 1] == 3 && q + 5 <= header)
+            {
+                message->partRef = ud[q + 2];
+                message->partCount = ud[q + 3];
+                message->partIndex = ud[q + 4];
+            }
+            else if (ud[q] == 0x08 && ud[q + 1] == 4 && q + 6 <= header)
+            {
+                message->partRef = (ud[q + 2] << 8) | ud[q + 3];
+                message->partCount = ud[q + 4];
+                message->partIndex = ud[q + 5];
+            }
+        }
+    }
+
+    len = 0;
+
+    if (alphabet == alphabet_gsm7)
+    {
+        // The text starts at the first septet boundary after the header
+        first = (header * 8 + 6) / 7;
+        count = 0;
+        if (udl > first && octets * 8 / 7 > first)
+        {
+            count = udl - first;
+            if (count > octets * 8 / 7 - first)
+                count = octets * 8 / 7 - first;
+            if (count > SIM800_PDU_SINGLE_SEPTETS)
+                count = SIM800_PDU_SINGLE_SEPTETS;
+        }
+
+        unpack_septets(ud, octets, first, count, septets);
+
+        for (uint16_t s = 0; s < count && len < SMS_TEXT_MAX_LEN - 1; s++)
+        {
+            if (!escaped && septets[s] == GSM_ESCAPE)
+            {
+                escaped = 1;
+                continue;
+            }
+
+            if (escaped && ascii_from_extension[septets[s]] != 0)
+                message->text[len++] = ascii_from_extension[septets[s]];
+            else
+                message->text[len++] = ascii_from_gsm[septets[s]];
+            escaped = 0;
+        }
+    }
+    else if (alphabet == alphabet_8bit)
+    {
+        for (q = header; q < udl && q < octets && len < SMS_TEXT_MAX_LEN - 1; q++)
+        {
+            message->text[len++] = (ud[q] >= 0x20 && ud[q] < 0x7F) ? (char)ud[q] : '?';
+        }
+    }
+    else
+    {
+        uint32_t code, high = 0;
+        char utf8[4];
+        uint8_t n;
+
+        for (q = header; q + 1 < udl && q + 1 < octets; q += 2)
+        {
+            code = (ud[q] << 8) | ud[q + 1];
+
+            // A character outside the basic plane is sent as a surrogate pair
+            if (code >= 0xD800 && code < 0xDC00)
+            {
+                high = code;
+                continue;
+            }
+            if (code >= 0xDC00 && code < 0xE000)
+            {
+                code = high ? 0x10000 + ((high - 0xD800) << 10) + (code - 0xDC00) : 0xFFFD;
+            }
+            high = 0;
+
+            // A character that does not fit is not split
+            if ((n = SIM800_UTF8_Encode(code, utf8)) > SMS_TEXT_MAX_LEN - 1 - len)
+                break;
+
+            memcpy(&message->text[len], utf8, n);
+            len += n;
+        }
+    }
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Decodes an SMS-STATUS-REPORT PDU.
+ *
+ * @param   *pdu: PDU as received, starting with the service centre address.
+ * @param   length: Length of the PDU.
+ * @param   *reference: Pointer to the reference of the reported message.
+ * @param   *status: Pointer to the status of the report, 0..31 - delivered, 32..63 - still trying,
+ *          64 and above - delivery failed.
+ * @retval  SIM800_OK if the PDU is decoded, SIM800_ERROR if it is not a valid SMS-STATUS-REPORT.
+ */
+SIM800_Status_t SIM800_PDU_DecodeStatusReport(const uint8_t *pdu, uint16_t length, uint8_t *reference, uint8_t *status)
+{
+    uint32_t p;
+
+    if (length < 1 || (p = 1 + pdu[0]) + 3 > length)
+        return SIM800_ERROR;
+
+    if ((pdu[p++] & 0x03) != 0x02)
+        return SIM800_ERROR;
+
+    *reference = pdu[p++];
+
+    // Recipient address, service centre time stamp and discharge time
+    if (skip_address(pdu, length, &p) != SIM800_OK || p + 15 > length)
+        return SIM800_ERROR;
+    p += 14;
+
+    *status = pdu[p];
+
+    return SIM800_OK;
+}
+
+#endif /* SIM800_USE_PDU */
+
+
+/**
+ * @brief   Converts a character to UTF-8.
+ *
+ * @param   code: Unicode code point, an invalid one is converted as U+FFFD.
+ * @param   *out: Buffer of at least 4 bytes, not terminated.
+ * @retval  Count of bytes, 1..4.
+ */
+uint8_t SIM800_UTF8_Encode(uint32_t code, char *out)
+{
+    if (code < 0x80)
+    {
+        out[0] = (char)code;
+        return 1;
+    }
+
+    if (code < 0x800)
+    {
+        out[0] = (char)(0xC0 | (code >> 6));
+        out[1] = (char)(0x80 | (code & 0x3F));
+        return 2;
+    }
+
+    if (code > 0x10FFFF || (code >= 0xD800 && code < 0xE000))
+    {
+        code = 0xFFFD;
+    }
+
+    if (code < 0x10000)
+    {
+        out[0] = (char)(0xE0 | (code >> 12));
+        out[1] = (char)(0x80 | ((code >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (code & 0x3F));
+        return 3;
+    }
+
+    out[0] = (char)(0xF0 | (code >> 18));
+    out[1] = (char)(0x80 | ((code >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((code >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (code & 0x3F));
+    return 4;
+}
+
+
+/**
+ * @brief   Reads a character of a UTF-8 text.
+ *
+ * A malformed sequence is read as U+FFFD, one byte at a time, so the text is never overrun.
+ *
+ * @param   **text: Pointer to the position in the text, moved past the character. It must not be at the end.
+ * @retval  Unicode code point.
+ */
+uint32_t SIM800_UTF8_Decode(const char **text)
+{
+    const uint8_t *c = (const uint8_t *)*text;
+    uint32_t code;
+    uint8_t n;
+
+    if (c[0] < 0x80)
+    {
+        *text += 1;
+        return c[0];
+    }
+
+    if ((c[0] & 0xE0) == 0xC0)
+    {
+        code = c[0] & 0x1F;
+        n = 1;
+    }
+    else if ((c[0] & 0xF0) == 0xE0)
+    {
+        code = c[0] & 0x0F;
+        n = 2;
+    }
+    else if ((c[0] & 0xF8) == 0xF0)
+    {
+        code = c[0] & 0x07;
+        n = 3;
+    }
+    else
+    {
+        *text += 1;
+        return 0xFFFD;
+    }
+
+    for (uint8_t i = 1; i <= n; i++)
+    {
+        if ((c[i] & 0xC0) != 0x80)
+        {
+            *text += 1;
+            return 0xFFFD;
+        }
+        code = (code << 6) | (c[i] & 0x3F);
+    }
+
+    *text += 1 + n;
+
+    return code;
+}
+
+
+#if SIM800_USE_PDU
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Converts an ASCII text to GSM 7-bit septets.
+ *
+ * @param   *text: Text to convert, it is not terminated.
+ * @param   length: Length of the text.
+ * @param   *septets: Buffer of at least limit septets.
+ * @param   limit: Count of available septets.
+ * @retval  Count of septets, 0xFFFF if the text does not fit.
+ */
+static uint16_t septets_from_text(const char *text, uint16_t length, uint8_t *septets, uint16_t limit)
+{
+    uint16_t count = 0;
+    uint8_t code;
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        code = gsm_from_ascii[(uint8_t)text[i] & 0x7F];
+
+        if ((uint8_t)text[i] & 0x80)
+        {
+            code = GSM_UNKNOWN;
+        }
+
+        if (count + 1 + (code >> 7) > limit)
+        {
+            return 0xFFFF;
+        }
+
+        if (code & GSM_EXTENDED)
+        {
+            septets[count++] = GSM_ESCAPE;
+        }
+        septets[count++] = code & 0x7F;
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief   Packs septets into a buffer.
+ *
+ * The septets are collected in a register and stored by octets, whenever the position is on an octet
+ * boundary eight septets are packed at once into seven octets. The bits below the start position in
+ * its octet are kept.
+ *
+ * @param   *out: Buffer of packed septets.
+ * @param   bit: Bit offset of the first septet.
+ * @param   *septets: Septets to pack.
+ * @param   count: Count of septets.
+ */
+static void pack_septets(uint8_t *out, uint32_t bit, const uint8_t *septets, uint16_t count)
+{
+    uint8_t bits = bit % 8;
+    uint32_t acc;
+    uint64_t word;
+    uint16_t i = 0;
+
+    out += bit / 8;
+    acc = *out & ((1u << bits) - 1);
+
+    while (i < count)
+    {
+        if (bits == 0 && count - i >= 8)
+        {
+            word = 0;
+            for (uint8_t k = 0; k < 8; k++)
+                word |= (uint64_t)septets[i + k] << (7 * k);
+            for (uint8_t k = 0; k < 7; k++)
+                out[k] = (uint8_t)(word >> (8 * k));
+
+            out += 7;
+            i += 8;
+            continue;
+        }
+
+        acc |= (uint32_t)septets[i++] << bits;
+        bits += 7;
+
+        if (bits >= 8)
+        {
+            *out++ = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+
+    if (bits != 0)
+    {
+        *out = (uint8_t)acc;
+    }
+}
+
+
+/**
+ * @brief   Unpacks septets from a buffer.
+ *
+ * The reverse of pack_septets, a septet cut by the end of the buffer is padded with zeros.
+ *
+ * @param   *in: Buffer of packed septets.
+ * @param   octets: Length of the buffer.
+ * @param   first: Index of the first septet to unpack.
+ * @param   count: Count of septets.
+ * @param   *septets: Buffer of at least count septets.
+ */
+static void unpack_septets(const uint8_t *in, uint32_t octets, uint32_t first, uint16_t count, uint8_t *septets)
+{
+    uint32_t p = first * 7 / 8;
+    uint8_t shift = first * 7 % 8;
+    uint32_t acc = 0;
+    uint8_t bits = 0;
+    uint64_t word;
+    uint16_t i = 0;
+
+    if (shift != 0 && p < octets)
+    {
+        acc = in[p++] >> shift;
+        bits = 8 - shift;
+    }
+
+    while (i < count)
+    {
+        if (bits == 0 && count - i >= 8 && p + 7 <= octets)
+        {
+            word = 0;
+            for (uint8_t k = 0; k < 7; k++)
+                word |= (uint64_t)in[p + k] << (8 * k);
+            for (uint8_t k = 0; k < 8; k++)
+                septets[i + k] = (word >> (7 * k)) & 0x7F;
+
+            p += 7;
+            i += 8;
+            continue;
+        }
+
+        if (bits < 7)
+        {
+            if (p < octets)
+                acc |= (uint32_t)in[p++] << bits;
+            bits += 8;
+        }
+
+        septets[i++] = acc & 0x7F;
+        acc >>= 7;
+        bits -= 7;
+    }
+}
+
+
+/**
+ * @brief   Skips an address field (length in digits, type, swapped digits).
+ *
+ * @param   *pdu: PDU.
+ * @param   length: Length of the PDU.
+ * @param   *p: Pointer to the position of the field, moved past it.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the field is cut.
+ */
+static SIM800_Status_t skip_address(const uint8_t *pdu, uint16_t length, uint32_t *p)
+{
+    if (*p + 2 > length)
+        return SIM800_ERROR;
+
+    *p += 2 + (pdu[*p] + 1) / 2;
+
+    return (*p <= length) ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Decodes a service centre time stamp (7 octets of swapped digits, the sign of the zone in bit 3).
+ *
+ * @param   *scts: Time stamp.
+ * @param   *time: Pointer to store the time, left empty if the time stamp is invalid.
+ */
+static void decode_timestamp(const uint8_t *scts, SIM800_Time_t *time)
+{
+    uint8_t values[7];
+
+    for (uint8_t i = 0; i < 7; i++)
+    {
+        values[i] = (scts[i] & (i == 6 ? 0x07 : 0x0F)) * 10 + (scts[i] >> 4);
+    }
+
+    if (values[1] < 1 || values[1] > 12 || values[2] < 1 || values[2] > 31 || values[3] > 23 ||
+        values[4] > 59 || values[5] > 59 || values[6] > 56)
+        return;
+
+    time->year = 2000 + values[0];
+    time->month = values[1];
+    time->day = values[2];
+    time->hour = values[3];
+    time->minute = values[4];
+    time->second = values[5];
+    time->zone = (scts[6] & 0x08) ? -values[6] : values[6];
+}
+
+#endif /* SIM800_USE_PDU */
+
+#endif /* SIM800_USE_SMS */
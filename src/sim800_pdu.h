@@ -0,0 +1,62 @@
+/*
+ * sim800_pdu.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_PDU_H_
+#define INC_SIM800_PDU_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_SMS
+
+#define SIM800_PDU_SINGLE_SEPTETS				160		/* Septets of the user data of a single message. */
+
+#define SIM800_PDU_PART_SEPTETS					153		/* Septets of a part of a long message, the header takes 7. */
+
+
+/**
+ * @brief   Structure representing the concatenation header of a part of a long message.
+ */
+typedef struct
+{
+    uint16_t reference;                         /*!< Reference shared by all parts of the message. */
+    uint8_t count;                              /*!< Count of parts, 0 - single message. */
+    uint8_t index;                              /*!< Index of the part, from 1. */
+} SIM800_PDUConcat_t;
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+#if SIM800_USE_PDU
+uint16_t SIM800_PDU_Septets						(const char *text, uint16_t length);
+uint16_t SIM800_PDU_Split						(const char *text, uint16_t length, uint16_t septets);
+uint16_t SIM800_PDU_EncodeSubmit				(uint8_t *pdu, const char *destination, const char *text, uint16_t length,
+												 const SIM800_PDUConcat_t *concat, uint8_t report);
+void SIM800_PDU_PatchSeptets					(uint8_t *pdu, uint32_t bit, const char *text, uint16_t count);
+SIM800_Status_t SIM800_PDU_DecodeDeliver		(const uint8_t *pdu, uint16_t length, SIM800_SMSMessage_t *message);
+SIM800_Status_t SIM800_PDU_DecodeStatusReport	(const uint8_t *pdu, uint16_t length, uint8_t *reference, uint8_t *status);
+#endif /* SIM800_USE_PDU */
+
+uint8_t SIM800_UTF8_Encode						(uint32_t code, char *out);
+uint32_t SIM800_UTF8_Decode						(const char **text);
+
+
+
+
+#endif /* SIM800_USE_SMS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_PDU_H_ */
@@ -0,0 +1,447 @@
+/*
+ * sim800_pool.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_pool.h"
+
+#if SIM800_USE_SMS
+
+/*
+ * Result of an attempt to hand a job to a modem
+ */
+typedef enum
+{
+    assign_done,        // The message is submitted to a modem
+    assign_pending,     // The candidate modems are busy, try again later
+    assign_failed,      // No modem is left to try
+} assign_result_t;
+
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static SIM800_PoolJob_t *start_job(SIM800_Pool_t *pool, const char *destination, const char *message,
+                                   SIM800_RequestCallback_t done, void *ctx);
+static assign_result_t assign_job(SIM800_Pool_t *pool, SIM800_PoolJob_t *job);
+static void fill_batch(SIM800_Pool_t *pool);
+static void finish_recipient(SIM800_Pool_t *pool, SIM800_Handle_t *handle, uint16_t recipient, SIM800_Status_t status);
+static void finish_job(SIM800_PoolJob_t *job, SIM800_Handle_t *handle, SIM800_Status_t status);
+
+static void pool_sms_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void pool_reg_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+static void pool_batch_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx);
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Adds a modem to the pool.
+ *
+ * The modem must be ready to send SMS messages (receiving started, SMS text mode set).
+ * Until its first registration check it is assumed to be registered.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ * @param   *handle: Pointer to the SIM800 handle structure of the modem.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the pool is full.
+ */
+SIM800_Status_t SIM800_Pool_AddModem(SIM800_Pool_t *pool, SIM800_Handle_t *handle)
+{
+    SIM800_PoolModem_t *modem;
+
+    if (pool->count >= SIM800_POOL_MAX_MODEMS)
+    {
+        return SIM800_ERROR;
+    }
+
+    modem = &pool->modems[pool->count++];
+
+    memset(modem, 0, sizeof(*modem));
+    modem->handle = handle;
+    modem->available = 1;
+    modem->latency = SIM800_POOL_DEFAULT_LATENCY;
+    modem->reg = SIM800_Registration_Unknown;
+    modem->regTick = HAL_GetTick() - SIM800_POOL_REG_PERIOD;
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Sends an SMS message by the least loaded modem of the pool.
+ *
+ * The function returns without waiting. The message is submitted to the available modem with the
+ * lowest expected completion time, the count of its queued requests times its recent send latency.
+ * If the modem fails to send the message, it is submitted to the next modem that has not tried it yet;
+ * a modem that times out is not used until its next successful registration check.
+ * The completion callback receives the handle of the modem that finished the message (NULL if there
+ * was none) and the status of the last attempt.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ * @param   *destination: Destination phone number, must stay unchanged until completion.
+ * @param   *message: SMS message to be sent, must stay unchanged until completion.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  SIM800_OK if the message is accepted, SIM800_ERROR if the pool is full or no modem is available.
+ */
+SIM800_Status_t SIM800_Pool_SendSMSMessage(SIM800_Pool_t *pool, const char *destination, const char *message,
+                                           SIM800_RequestCallback_t done, void *ctx)
+{
+    return start_job(pool, destination, message, done, ctx) != NULL ? SIM800_OK : SIM800_ERROR;
+}
+
+
+/**
+ * @brief   Sends one SMS message to several recipients by the modems of the pool.
+ *
+ * The function returns without waiting. Every recipient becomes a job of its own, so the recipients are
+ * spread across the modems like single messages. At most SIM800_POOL_BATCH_JOBS jobs are taken at a time,
+ * the next recipients are started by SIM800_Pool_Poll. The result callback receives the handle of the modem
+ * that finished the recipient (NULL if there was none); the recipients may finish out of order.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ * @param   *recipients: Destination phone numbers, must stay unchanged until the batch is finished.
+ * @param   count: Count of recipients.
+ * @param   *text: SMS message to be sent, must stay unchanged until the batch is finished.
+ * @param   result: Callback invoked once per recipient, may be NULL.
+ * @param   *ctx: Argument of the callback.
+ * @retval  SIM800_OK if the batch is started, SIM800_ERROR if a batch is in progress.
+ */
+SIM800_Status_t SIM800_Pool_SendSMSBatch(SIM800_Pool_t *pool, const char *const *recipients, uint16_t count,
+                                         const char *text, SIM800_SMSBatchCallback_t result, void *ctx)
+{
+    SIM800_SMSBatch_t *batch = &pool->batch;
+
+    if (batch->count != 0 || count == 0)
+    {
+        return SIM800_ERROR;
+    }
+
+    batch->recipients = recipients;
+    batch->next = 0;
+    batch->finished = 0;
+    batch->text = text;
+    batch->result = result;
+    batch->ctx = ctx;
+    batch->count = count;
+
+    fill_batch(pool);
+
+    return SIM800_OK;
+}
+
+
+/**
+ * @brief   Drives the modems of the pool.
+ *
+ * This function must be called regularly instead of calling SIM800_Poll for every modem. It polls
+ * the modems, checks their network registration every SIM800_POOL_REG_PERIOD and hands the waiting
+ * messages to the modems that have room for them.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ */
+void SIM800_Pool_Poll(SIM800_Pool_t *pool)
+{
+    SIM800_PoolModem_t *modem;
+
+    for (uint32_t i = 0; i < pool->count; i++)
+    {
+        modem = &pool->modems[i];
+
+        SIM800_Poll(modem->handle);
+
+        if (!modem->regPending && HAL_GetTick() - modem->regTick >= SIM800_POOL_REG_PERIOD &&
+            SIM800_SubmitNetworkRegStatusEx(modem->handle, &modem->reg, &pool_reg_done, modem, NULL) == SIM800_OK)
+        {
+            modem->regPending = 1;
+            modem->regTick = HAL_GetTick();
+        }
+    }
+
+    for (uint32_t i = 0; i < SIM800_POOL_MAX_JOBS; i++)
+    {
+        if (pool->jobs[i].used && pool->jobs[i].modem < 0 && assign_job(pool, &pool->jobs[i]) == assign_failed)
+        {
+            finish_job(&pool->jobs[i], NULL, SIM800_ERROR);
+        }
+    }
+
+    fill_batch(pool);
+}
+
+
+/*********************************************************************************************
+ *										Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Takes a free job and submits it to a modem.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ * @param   *destination: Destination phone number.
+ * @param   *message: SMS message to be sent.
+ * @param   done: Completion callback, may be NULL.
+ * @param   *ctx: Argument of the completion callback.
+ * @retval  Pointer to the job, NULL if the pool is full or no modem is available.
+ */
+static SIM800_PoolJob_t *start_job(SIM800_Pool_t *pool, const char *destination, const char *message,
+                                   SIM800_RequestCallback_t done, void *ctx)
+{
+    SIM800_PoolJob_t *job = NULL;
+
+    for (uint32_t i = 0; i < SIM800_POOL_MAX_JOBS; i++)
+    {
+        if (!pool->jobs[i].used)
+        {
+            job = &pool->jobs[i];
+            break;
+        }
+    }
+
+    if (job == NULL)
+    {
+        return NULL;
+    }
+
+    job->pool = pool;
+    job->destination = destination;
+    job->message = message;
+    job->done = done;
+    job->ctx = ctx;
+    job->modem = -1;
+    job->tried = 0;
+    job->used = 1;
+
+    if (assign_job(pool, job) == assign_failed)
+    {
+        job->used = 0;
+        return NULL;
+    }
+
+    return job;
+}
+
+
+/**
+ * @brief   Submits a job to the least loaded modem that has not tried it yet.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ * @param   *job: Pointer to the job.
+ * @retval  assign_done if the message is submitted, assign_pending if all candidate modems have full
+ *          request queues or no usable signal, assign_failed if there is no candidate modem.
+ */
+static assign_result_t assign_job(SIM800_Pool_t *pool, SIM800_PoolJob_t *job)
+{
+    SIM800_PoolModem_t *modem;
+    uint32_t score, best_score = UINT32_MAX;
+    uint32_t depth;
+    int8_t best = -1;
+    uint8_t candidates = 0;
+
+    for (uint32_t i = 0; i < pool->count; i++)
+    {
+        modem = &pool->modems[i];
+
+        if (!modem->available || (job->tried & (1 << i)))
+        {
+            continue;
+        }
+        candidates++;
+
+        // A modem without a usable signal holds the message back, see SIM800_IsSignalUsable
+        depth = modem->handle->reqHead - modem->handle->reqTail;
+        if (depth >= REQUEST_QUEUE_LENGTH || !SIM800_IsSignalUsable(modem->handle))
+        {
+            continue;
+        }
+
+        // Expected time until the message is sent by this modem
+        score = (depth + 1) * modem->latency;
+        if (score < best_score)
+        {
+            best_score = score;
+            best = i;
+        }
+    }
+
+    if (best < 0)
+    {
+        return candidates ? assign_pending : assign_failed;
+    }
+
+    modem = &pool->modems[best];
+
+    if (SIM800_SubmitSMSMessageEx(modem->handle, job->destination, job->message, &pool_sms_done, job, NULL) != SIM800_OK)
+    {
+        // The message itself is rejected (e.g., too long), no modem would take it
+        return assign_failed;
+    }
+
+    job->modem = best;
+    job->tried |= 1 << best;
+    job->tickStart = HAL_GetTick();
+    modem->inflight++;
+
+    return assign_done;
+}
+
+
+/**
+ * @brief   Starts the next recipients of the batch while it takes fewer than SIM800_POOL_BATCH_JOBS jobs.
+ *
+ * A recipient no modem would take is finished at once with SIM800_ERROR.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ */
+static void fill_batch(SIM800_Pool_t *pool)
+{
+    SIM800_SMSBatch_t *batch = &pool->batch;
+    SIM800_PoolJob_t *job;
+    uint32_t free_jobs = 0;
+
+    for (uint32_t i = 0; i < SIM800_POOL_MAX_JOBS; i++)
+    {
+        free_jobs += !pool->jobs[i].used;
+    }
+
+    while (batch->next < batch->count && batch->next - batch->finished < SIM800_POOL_BATCH_JOBS && free_jobs != 0)
+    {
+        // The job is its own context, so the recipient is known when it is finished
+        if ((job = start_job(pool, batch->recipients[batch->next], batch->text, &pool_batch_done, NULL)) != NULL)
+        {
+            job->ctx = job;
+            job->recipient = batch->next++;
+            free_jobs--;
+            continue;
+        }
+
+        finish_recipient(pool, NULL, batch->next++, SIM800_ERROR);
+    }
+}
+
+
+/**
+ * @brief   Releases a job and invokes its completion callback.
+ *
+ * @param   *job: Pointer to the job.
+ * @param   *handle: Handle of the modem that finished the job, may be NULL.
+ * @param   status: Status of the job.
+ */
+static void finish_job(SIM800_PoolJob_t *job, SIM800_Handle_t *handle, SIM800_Status_t status)
+{
+    SIM800_RequestCallback_t done = job->done;
+    void *ctx = job->ctx;
+
+    job->used = 0;
+
+    if (done != NULL)
+    {
+        done(handle, status, ctx);
+    }
+}
+
+
+/**
+ * @brief   Handles the end of an SMS message submitted to a modem of the pool.
+ *
+ * On success the send latency of the modem is averaged in. On failure the message is submitted to
+ * another modem, a modem that has timed out is taken out of service until its next registration check.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of the modem.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the job.
+ */
+static void pool_sms_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_PoolJob_t *job = (SIM800_PoolJob_t *)ctx;
+    SIM800_PoolModem_t *modem = &job->pool->modems[job->modem];
+    int32_t latency = HAL_GetTick() - job->tickStart;
+
+    modem->inflight--;
+    job->modem = -1;
+
+    if (status == SIM800_OK)
+    {
+        modem->sent++;
+        modem->latency += (latency - (int32_t)modem->latency) / 4;
+        finish_job(job, handle, SIM800_OK);
+        return;
+    }
+
+    modem->failures++;
+    if (status == SIM800_TIMEOUT)
+    {
+        modem->available = 0;
+    }
+
+    // Fail over to another modem, a pending job is assigned by SIM800_Pool_Poll
+    if (assign_job(job->pool, job) == assign_failed)
+    {
+        finish_job(job, handle, status);
+    }
+}
+
+
+/**
+ * @brief   Handles the end of a registration check of a modem of the pool.
+ *
+ * @param   *handle: Pointer to the SIM800 handle structure of the modem.
+ * @param   status: Status of the request.
+ * @param   *ctx: Pointer to the pool modem structure.
+ */
+static void pool_reg_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_PoolModem_t *modem = (SIM800_PoolModem_t *)ctx;
+
+    modem->regPending = 0;
+    modem->available = status == SIM800_OK &&
+                       (modem->reg == SIM800_Registered_HomeNetwork || modem->reg == SIM800_Registered_Roaming);
+}
+
+
+/**
+ * @brief   Handles the end of a job of the batch.
+ *
+ * @param   *handle: Handle of the modem that finished the job, may be NULL.
+ * @param   status: Status of the job.
+ * @param   *ctx: Pointer to the finished job.
+ */
+static void pool_batch_done(SIM800_Handle_t *handle, SIM800_Status_t status, void *ctx)
+{
+    SIM800_PoolJob_t *job = (SIM800_PoolJob_t *)ctx;
+
+    finish_recipient(job->pool, handle, job->recipient, status);
+}
+
+
+/**
+ * @brief   Counts a finished recipient of the batch and invokes the result callback.
+ *
+ * @param   *pool: Pointer to the pool structure.
+ * @param   *handle: Handle of the modem that finished the recipient, may be NULL.
+ * @param   recipient: Index of the recipient.
+ * @param   status: Status of the recipient.
+ */
+static void finish_recipient(SIM800_Pool_t *pool, SIM800_Handle_t *handle, uint16_t recipient, SIM800_Status_t status)
+{
+    SIM800_SMSBatch_t *batch = &pool->batch;
+    SIM800_SMSBatchCallback_t result = batch->result;
+    void *result_ctx = batch->ctx;
+
+    if (++batch->finished == batch->count)
+    {
+        batch->count = 0;
+    }
+
+    if (result != NULL)
+    {
+        result(handle, recipient, status, result_ctx);
+    }
+}
+
+#endif /* SIM800_USE_SMS */
@@ -0,0 +1,117 @@
+/*
+ * sim800_pool.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_POOL_H_
+#define INC_SIM800_POOL_H_
+
+#include "sim800.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_SMS
+
+#ifndef SIM800_POOL_MAX_MODEMS
+#define SIM800_POOL_MAX_MODEMS					4		/* At most 8, the tried modems are kept in a bit mask. */
+#endif
+
+#ifndef SIM800_POOL_MAX_JOBS
+#define SIM800_POOL_MAX_JOBS					8
+#endif
+
+#ifndef SIM800_POOL_BATCH_JOBS
+#define SIM800_POOL_BATCH_JOBS					4		/* Jobs a batch may take at a time, the rest stay free for single messages. */
+#endif
+
+#ifndef SIM800_POOL_REG_PERIOD
+#define SIM800_POOL_REG_PERIOD					30000	/* Period of the network registration checks (ms). */
+#endif
+
+#ifndef SIM800_POOL_DEFAULT_LATENCY
+#define SIM800_POOL_DEFAULT_LATENCY				3000	/* Assumed SMS send latency of a modem without history (ms). */
+#endif
+
+#if SIM800_POOL_MAX_MODEMS > 8
+#error "SIM800_POOL_MAX_MODEMS must not exceed 8"
+#endif
+
+
+typedef struct SIM800_Pool SIM800_Pool_t;
+
+
+/**
+ * @brief   Structure representing a modem of the pool.
+ */
+typedef struct
+{
+    SIM800_Handle_t *handle;                    /*!< Handle of the modem. */
+    uint8_t available;                          /*!< 1 if the modem takes new messages. */
+    uint8_t inflight;                           /*!< Count of messages submitted to the modem and not finished yet. */
+    uint32_t latency;                           /*!< Moving average of the SMS send latency (ms). */
+    uint32_t sent;                              /*!< Count of messages sent. */
+    uint32_t failures;                          /*!< Count of failed sends. */
+    SIM800_NetworkRegStatus_t reg;              /*!< Last network registration status. */
+    uint8_t regPending;                         /*!< 1 while a registration check is submitted. */
+    uint32_t regTick;                           /*!< Tick of the last registration check. */
+} SIM800_PoolModem_t;
+
+
+/**
+ * @brief   Structure representing an SMS message waiting in the pool.
+ *
+ * The destination and the message are pinned: they must stay unchanged until the job is finished.
+ */
+typedef struct
+{
+    SIM800_Pool_t *pool;                        /*!< Pool of the job. */
+    const char *destination;                    /*!< Destination phone number. */
+    const char *message;                        /*!< SMS message. */
+    SIM800_RequestCallback_t done;              /*!< Completion callback, may be NULL. */
+    void *ctx;                                  /*!< Argument of the completion callback. */
+    uint8_t used;                               /*!< 1 if the job slot is in use. */
+    uint16_t recipient;                         /*!< Index of the batch recipient, see SIM800_Pool_SendSMSBatch. */
+    int8_t modem;                               /*!< Index of the modem sending the message, -1 - not assigned. */
+    uint8_t tried;                              /*!< Bit mask of the modems the message has been submitted to. */
+    uint32_t tickStart;                         /*!< Tick at which the message has been submitted to the modem. */
+} SIM800_PoolJob_t;
+
+
+/**
+ * @brief   Structure representing a pool of modems sharing the outgoing SMS messages.
+ */
+struct SIM800_Pool
+{
+    SIM800_PoolModem_t modems[SIM800_POOL_MAX_MODEMS];  /*!< Modems of the pool. */
+    uint8_t count;                                     /*!< Count of modems. */
+    SIM800_PoolJob_t jobs[SIM800_POOL_MAX_JOBS];        /*!< SMS messages being sent. */
+    SIM800_SMSBatch_t batch;                           /*!< SMS batch in progress. */
+};
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_Pool_AddModem				(SIM800_Pool_t *pool, SIM800_Handle_t *handle);
+SIM800_Status_t SIM800_Pool_SendSMSMessage			(SIM800_Pool_t *pool, const char *destination, const char *message,
+													 SIM800_RequestCallback_t done, void *ctx);
+SIM800_Status_t SIM800_Pool_SendSMSBatch			(SIM800_Pool_t *pool, const char *const *recipients, uint16_t count,
+													 const char *text, SIM800_SMSBatchCallback_t result, void *ctx);
+void SIM800_Pool_Poll								(SIM800_Pool_t *pool);
+
+
+
+
+#endif /* SIM800_USE_SMS */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_POOL_H_ */
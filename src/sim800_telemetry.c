@@ -0,0 +1,307 @@
+/*
+ * sim800_telemetry.c
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#include "string.h"
+#include "sim800_telemetry.h"
+
+#if SIM800_USE_TELEMETRY
+
+/*
+ * Static helpful functions
+ * See the functions definitions for more details
+ */
+static uint8_t telemetry_varint(uint8_t *out, uint32_t value);
+static uint8_t telemetry_reading(SIM800_Telemetry_t *telemetry, uint8_t *out, uint8_t channel, int32_t value,
+                                 uint32_t tick);
+static void telemetry_start(SIM800_Telemetry_t *telemetry, uint32_t tick);
+
+#if SIM800_USE_OUTBOX
+static SIM800_Status_t telemetry_outbox_sink(SIM800_Telemetry_t *telemetry, const uint8_t *frame, uint16_t length);
+#endif
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Prepares the aggregation of readings into frames handed to a sink.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   capacity: Largest frame, between SIM800_TELEMETRY_HEADER_MAX + SIM800_TELEMETRY_READING_MAX and
+ *                    SIM800_TELEMETRY_FRAME_MAX, e.g. the payload of one TCP packet.
+ * @param   maxAge: Age of the first reading that flushes the frame (ms), 0 - flush on size and urgency only.
+ * @param   sink: Callback receiving the frames.
+ * @param   *ctx: Argument of the application, stored in telemetry->ctx.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the capacity is out of range or the sink is NULL.
+ */
+SIM800_Status_t SIM800_Telemetry_Init(SIM800_Telemetry_t *telemetry, uint16_t capacity, uint32_t maxAge,
+                                      SIM800_TelemetrySink_t sink, void *ctx)
+{
+    if (sink == NULL || capacity < SIM800_TELEMETRY_HEADER_MAX + SIM800_TELEMETRY_READING_MAX ||
+        capacity > SIM800_TELEMETRY_FRAME_MAX)
+    {
+        return SIM800_ERROR;
+    }
+
+    memset(telemetry, 0, sizeof(*telemetry));
+    telemetry->capacity = capacity;
+    telemetry->maxAge = maxAge;
+    telemetry->sink = sink;
+    telemetry->ctx = ctx;
+
+    return SIM800_OK;
+}
+
+
+#if SIM800_USE_OUTBOX
+/**
+ * @brief   Prepares the aggregation of readings into text messages put into an outbox.
+ *
+ * A frame is sent as the base64 text of one message, so it is as large as SIM800_OUTBOX_TEXT_LENGTH allows:
+ * 3 bytes for every 4 characters.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   *outbox: Pointer to the outbox structure, see SIM800_Outbox_Init.
+ * @param   *destination: Phone number of the recipient, it must stay valid.
+ * @param   maxAge: Age of the first reading that flushes the frame (ms), 0 - flush on size and urgency only.
+ * @retval  SIM800_OK on success, SIM800_ERROR if a message cannot hold the header and one reading.
+ */
+SIM800_Status_t SIM800_Telemetry_InitOutbox(SIM800_Telemetry_t *telemetry, SIM800_Outbox_t *outbox,
+                                            const char *destination, uint32_t maxAge)
+{
+    uint32_t capacity = SIM800_OUTBOX_TEXT_LENGTH / 4 * 3;
+
+    if (SIM800_Telemetry_Init(telemetry, capacity < SIM800_TELEMETRY_FRAME_MAX ? capacity : SIM800_TELEMETRY_FRAME_MAX,
+                              maxAge, &telemetry_outbox_sink, NULL) != SIM800_OK)
+    {
+        return SIM800_ERROR;
+    }
+
+    telemetry->outbox = outbox;
+    telemetry->destination = destination;
+
+    return SIM800_OK;
+}
+#endif /* SIM800_USE_OUTBOX */
+
+
+/**
+ * @brief   Adds a reading to the frame.
+ *
+ * A reading that does not fit flushes the frame first and starts the next one. An urgent reading
+ * (e.g. an alarm) flushes the frame it ends at once.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   channel: Channel (type) of the reading, below SIM800_TELEMETRY_CHANNELS.
+ * @param   value: Value, in the units of the channel (e.g. mV, 0.1 degrees).
+ * @param   urgent: 1 to flush the frame with the reading, 0 otherwise.
+ * @retval  SIM800_OK on success, SIM800_ERROR if the channel is invalid or the sink refuses the full frame;
+ *          the reading is not added then. The status of the sink for an urgent reading, which is added.
+ */
+SIM800_Status_t SIM800_Telemetry_Add(SIM800_Telemetry_t *telemetry, uint8_t channel, int32_t value,
+                                     uint8_t urgent)
+{
+    uint8_t reading[SIM800_TELEMETRY_READING_MAX];
+    uint32_t tick = HAL_GetTick();
+    uint8_t length;
+
+    if (channel >= SIM800_TELEMETRY_CHANNELS)
+    {
+        return SIM800_ERROR;
+    }
+
+    if (telemetry->length != 0)
+    {
+        length = telemetry_reading(telemetry, reading, channel, value, tick);
+
+        if (telemetry->length + length > telemetry->capacity)
+        {
+            if (SIM800_Telemetry_Flush(telemetry) != SIM800_OK)
+            {
+                return SIM800_ERROR;
+            }
+        }
+    }
+
+    if (telemetry->length == 0)
+    {
+        // The deltas of a new frame start again
+        telemetry_start(telemetry, tick);
+        length = telemetry_reading(telemetry, reading, channel, value, tick);
+    }
+
+    memcpy(&telemetry->frame[telemetry->length], reading, length);
+    telemetry->length += length;
+    telemetry->last[channel] = value;
+    telemetry->seen |= 1UL << channel;
+    telemetry->lastTick = tick - (tick - telemetry->lastTick) % SIM800_TELEMETRY_TIME_UNIT;
+
+    return urgent ? SIM800_Telemetry_Flush(telemetry) : SIM800_OK;
+}
+
+
+/**
+ * @brief   Hands the frame to the sink at once.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @retval  SIM800_OK if the frame is taken or empty, the status of the sink otherwise; the frame stays then.
+ */
+SIM800_Status_t SIM800_Telemetry_Flush(SIM800_Telemetry_t *telemetry)
+{
+    SIM800_Status_t status;
+
+    if (telemetry->length == 0)
+    {
+        return SIM800_OK;
+    }
+
+    if ((status = telemetry->sink(telemetry, telemetry->frame, telemetry->length)) == SIM800_OK)
+    {
+        telemetry->length = 0;
+        telemetry->sequence++;
+    }
+
+    return status;
+}
+
+
+/**
+ * @brief   Flushes the frame once its first reading is older than maxAge, call it from the main loop.
+ *
+ * A frame the sink has refused is offered again at every call then.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ */
+void SIM800_Telemetry_Poll(SIM800_Telemetry_t *telemetry)
+{
+    if (telemetry->length != 0 && telemetry->maxAge != 0 && HAL_GetTick() - telemetry->firstTick >= telemetry->maxAge)
+    {
+        SIM800_Telemetry_Flush(telemetry);
+    }
+}
+
+
+
+
+/*********************************************************************************************
+ *								Static helpful functions
+ ********************************************************************************************/
+
+/**
+ * @brief   Writes a varint: groups of 7 bits, least significant first, the upper bit set when another follows.
+ *
+ * @param   *out: Buffer of at least 5 bytes.
+ * @param   value: Value.
+ * @retval  Count of bytes written.
+ */
+static uint8_t telemetry_varint(uint8_t *out, uint32_t value)
+{
+    uint8_t count = 0;
+
+    while (value >= 0x80)
+    {
+        out[count++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[count++] = (uint8_t)value;
+
+    return count;
+}
+
+
+/**
+ * @brief   Encodes a reading after the readings already in the frame.
+ *
+ * The difference of the values is taken modulo 2^32, so any two values give a delta of 5 bytes at most.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   *out: Buffer of SIM800_TELEMETRY_READING_MAX bytes.
+ * @param   channel: Channel of the reading.
+ * @param   value: Value of the reading.
+ * @param   tick: Tick of the reading.
+ * @retval  Count of bytes written.
+ */
+static uint8_t telemetry_reading(SIM800_Telemetry_t *telemetry, uint8_t *out, uint8_t channel, int32_t value,
+                                 uint32_t tick)
+{
+    uint32_t delta = (uint32_t)value;
+    uint8_t length;
+
+    if (telemetry->seen & (1UL << channel))
+    {
+        delta -= (uint32_t)telemetry->last[channel];
+    }
+
+    length = telemetry_varint(out, channel);
+    length += telemetry_varint(&out[length], (tick - telemetry->lastTick) / SIM800_TELEMETRY_TIME_UNIT);
+
+    // Zigzag: the small negative deltas stay small too
+    length += telemetry_varint(&out[length], (delta << 1) ^ (0UL - (delta >> 31)));
+
+    return length;
+}
+
+
+/**
+ * @brief   Starts a frame with its header.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   tick: Tick of the first reading.
+ */
+static void telemetry_start(SIM800_Telemetry_t *telemetry, uint32_t tick)
+{
+    telemetry->frame[0] = SIM800_TELEMETRY_VERSION;
+    telemetry->length = 1;
+    telemetry->length += telemetry_varint(&telemetry->frame[telemetry->length], telemetry->sequence);
+    telemetry->length += telemetry_varint(&telemetry->frame[telemetry->length], tick / SIM800_TELEMETRY_TIME_UNIT);
+
+    telemetry->firstTick = tick;
+    telemetry->lastTick = tick;
+    telemetry->seen = 0;
+}
+
+
+#if SIM800_USE_OUTBOX
+/**
+ * @brief   Puts a frame into the outbox as the base64 text of a message, see SIM800_TelemetrySink_t.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   *frame: Encoded frame.
+ * @param   length: Count of bytes of the frame, at most SIM800_OUTBOX_TEXT_LENGTH / 4 * 3.
+ * @retval  Status of SIM800_Outbox_Put.
+ */
+static SIM800_Status_t telemetry_outbox_sink(SIM800_Telemetry_t *telemetry, const uint8_t *frame, uint16_t length)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    char text[SIM800_OUTBOX_TEXT_LENGTH + 1];
+    uint16_t count = 0;
+    uint32_t group;
+
+    for (uint16_t i = 0; i < length; i += 3)
+    {
+        group = (uint32_t)frame[i] << 16;
+        if (i + 1 < length)
+        {
+            group |= (uint32_t)frame[i + 1] << 8;
+        }
+        if (i + 2 < length)
+        {
+            group |= frame[i + 2];
+        }
+
+        text[count++] = alphabet[(group >> 18) & 0x3F];
+        text[count++] = alphabet[(group >> 12) & 0x3F];
+        text[count++] = i + 1 < length ? alphabet[(group >> 6) & 0x3F] : '=';
+        text[count++] = i + 2 < length ? alphabet[group & 0x3F] : '=';
+    }
+    text[count] = '\0';
+
+    return SIM800_Outbox_Put(telemetry->outbox, telemetry->destination, text, NULL);
+}
+#endif /* SIM800_USE_OUTBOX */
+
+#endif /* SIM800_USE_TELEMETRY */
@@ -0,0 +1,126 @@
+/*
+ * sim800_telemetry.h
+ *
+ *  Created on: Oct 14, 2026
+ */
+
+#ifndef INC_SIM800_TELEMETRY_H_
+#define INC_SIM800_TELEMETRY_H_
+
+#include "sim800.h"
+#if SIM800_USE_OUTBOX
+#include "sim800_outbox.h"
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if SIM800_USE_TELEMETRY
+
+#ifndef SIM800_TELEMETRY_FRAME_MAX
+#define SIM800_TELEMETRY_FRAME_MAX				128		/* Largest frame (bytes), e.g. the payload of one TCP packet. */
+#endif
+
+#ifndef SIM800_TELEMETRY_CHANNELS
+#define SIM800_TELEMETRY_CHANNELS				8		/* Count of channels (types of readings), at most 32. */
+#endif
+
+#ifndef SIM800_TELEMETRY_TIME_UNIT
+#define SIM800_TELEMETRY_TIME_UNIT				1000	/* Resolution of the time of the readings (ms). */
+#endif
+
+#define SIM800_TELEMETRY_VERSION				1		/* First byte of a frame. */
+
+#define SIM800_TELEMETRY_HEADER_MAX				11		/* Version, sequence and time of the first reading, at most. */
+#define SIM800_TELEMETRY_READING_MAX			11		/* Channel, time and value of a reading, at most. */
+
+#if SIM800_TELEMETRY_CHANNELS < 1 || SIM800_TELEMETRY_CHANNELS > 32
+#error "SIM800_TELEMETRY_CHANNELS must be between 1 and 32"
+#endif
+
+#if SIM800_TELEMETRY_FRAME_MAX < SIM800_TELEMETRY_HEADER_MAX + SIM800_TELEMETRY_READING_MAX || SIM800_TELEMETRY_FRAME_MAX > 0xFFFF
+#error "SIM800_TELEMETRY_FRAME_MAX must hold the header and one reading"
+#endif
+
+
+typedef struct SIM800_Telemetry SIM800_Telemetry_t;
+
+
+/**
+ * @brief   Callback receiving a complete frame, invoked from SIM800_Telemetry_Add, _Flush and _Poll.
+ *
+ * The frame is only valid during the call: copy it or send it before returning.
+ *
+ * @param   *telemetry: Pointer to the telemetry structure.
+ * @param   *frame: Encoded frame, see SIM800_Telemetry_t.
+ * @param   length: Count of bytes of the frame.
+ * @retval  SIM800_OK if the frame is taken, any other status keeps it for the next flush.
+ */
+typedef SIM800_Status_t (*SIM800_TelemetrySink_t)(SIM800_Telemetry_t *telemetry, const uint8_t *frame, uint16_t length);
+
+
+/**
+ * @brief   Structure representing readings aggregated into frames.
+ *
+ * The readings are collected into one frame, which is handed to the sink once the next reading does not fit,
+ * once its first reading is older than maxAge, or at once after an urgent reading. A frame is:
+ *  - SIM800_TELEMETRY_VERSION, one byte;
+ *  - the sequence number of the frame, a varint;
+ *  - the time of the first reading (HAL_GetTick / SIM800_TELEMETRY_TIME_UNIT), a varint;
+ *  - per reading: its channel, its time after the reading before (SIM800_TELEMETRY_TIME_UNIT), both varints, and
+ *    its value after the reading of the same channel before, a zigzag varint (the first one of a channel after 0).
+ * The varints are little-endian groups of 7 bits, the upper bit of a byte set when another one follows. Every
+ * frame is decoded on its own, a lost message takes no other with it. A slow sensor gives readings of 2 or 3
+ * bytes, against the dozens of characters of one text message per reading.
+ *
+ * The time is the uptime of the MCU; a reading of a clock channel (e.g. the seconds from SIM800_GetTime) lets
+ * the receiver place it in the calendar.
+ */
+struct SIM800_Telemetry
+{
+    uint8_t frame[SIM800_TELEMETRY_FRAME_MAX];  /*!< Frame being filled. */
+    uint16_t length;                            /*!< Count of bytes of the frame, 0 - no reading yet. */
+    uint16_t capacity;                          /*!< Largest frame handed to the sink. */
+    uint32_t maxAge;                            /*!< Age of the first reading that flushes the frame (ms), 0 - none. */
+    uint32_t sequence;                          /*!< Sequence number of the frame being filled. */
+    uint32_t firstTick;                         /*!< Tick of the first reading of the frame. */
+    uint32_t lastTick;                          /*!< Tick of the last reading, rounded down to SIM800_TELEMETRY_TIME_UNIT. */
+    int32_t last[SIM800_TELEMETRY_CHANNELS];    /*!< Last value of every channel in the frame. */
+    uint32_t seen;                              /*!< Bit per channel with a value in the frame. */
+    SIM800_TelemetrySink_t sink;                /*!< Callback receiving the frames. */
+#if SIM800_USE_OUTBOX
+    SIM800_Outbox_t *outbox;                    /*!< Outbox the frames are put into, see SIM800_Telemetry_InitOutbox. */
+    const char *destination;                    /*!< Phone number the frames are sent to. */
+#endif
+    void *ctx;                                  /*!< Argument of the application. */
+};
+
+
+
+
+/*********************************************************************************************
+ *								Supported user functions
+ ********************************************************************************************/
+
+SIM800_Status_t SIM800_Telemetry_Init				(SIM800_Telemetry_t *telemetry, uint16_t capacity, uint32_t maxAge,
+														 SIM800_TelemetrySink_t sink, void *ctx);
+#if SIM800_USE_OUTBOX
+SIM800_Status_t SIM800_Telemetry_InitOutbox			(SIM800_Telemetry_t *telemetry, SIM800_Outbox_t *outbox,
+														 const char *destination, uint32_t maxAge);
+#endif
+SIM800_Status_t SIM800_Telemetry_Add				(SIM800_Telemetry_t *telemetry, uint8_t channel, int32_t value,
+														 uint8_t urgent);
+SIM800_Status_t SIM800_Telemetry_Flush				(SIM800_Telemetry_t *telemetry);
+void SIM800_Telemetry_Poll							(SIM800_Telemetry_t *telemetry);
+
+
+
+
+#endif /* SIM800_USE_TELEMETRY */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INC_SIM800_TELEMETRY_H_ */